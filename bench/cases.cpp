@@ -0,0 +1,573 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+
+namespace xft::bench {
+
+namespace {
+
+using Shape = std::vector<int64_t>;
+using UnaryFn = int (*)(xft_tensor_t, xft_tensor_t*);
+using BinaryFn = int (*)(xft_tensor_t, xft_tensor_t, xft_tensor_t*);
+using ReduceFn = int (*)(xft_tensor_t, int64_t, int32_t, int32_t, xft_tensor_t*);
+
+int64_t numel(const Shape& s) {
+  int64_t n = 1;
+  for (int64_t d : s) n *= d;
+  return n;
+}
+
+std::string str(const Shape& s) {
+  std::string out = "[";
+  for (size_t i = 0; i < s.size(); i++) out += (i ? "," : "") + std::to_string(s[i]);
+  return out + "]";
+}
+
+// Runs fn and frees its result.
+template <typename F>
+void discard(F&& fn) {
+  xft_tensor_t out;
+  check(fn(&out));
+  xft_tensor_free(out);
+}
+
+Case unary_case(const char* op, UnaryFn fn, double flops_per_elem, const Shape& shape,
+                int32_t dtype, Device dev) {
+  const double n = numel(shape);
+  Case c{op, str(shape), dtype, dev, flops_per_elem * n, 2 * n * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random(shape, dtype, dev.type, 0.1, 2.0));
+    return std::function<void()>(
+        [=] { discard([&](xft_tensor_t* o) { return fn(x->get(), o); }); });
+  };
+  return c;
+}
+
+Case binary_case(const char* op, BinaryFn fn, const Shape& a_shape, const Shape& b_shape,
+                 int32_t dtype, Device dev) {
+  const double n = numel(a_shape);
+  const double bytes = (2 * n + numel(b_shape)) * dtype_size(dtype);
+  Case c{op, str(a_shape) + "+" + str(b_shape), dtype, dev, n, bytes, {}};
+  c.make = [=] {
+    auto a = std::make_shared<Tensor>(Tensor::random(a_shape, dtype, dev.type));
+    auto b = std::make_shared<Tensor>(Tensor::random(b_shape, dtype, dev.type, 1.0, 2.0));
+    return std::function<void()>(
+        [=] { discard([&](xft_tensor_t* o) { return fn(a->get(), b->get(), o); }); });
+  };
+  return c;
+}
+
+// a is [rows, cols] read through a transposed view of a [cols, rows] tensor.
+Case transposed_binary_case(const char* op, BinaryFn fn, int64_t rows, int64_t cols,
+                            int32_t dtype, Device dev) {
+  const double n = static_cast<double>(rows) * cols;
+  Case c{op, str({rows, cols}) + "^T+" + str({cols, rows}), dtype, dev, n,
+         3 * n * dtype_size(dtype), {}};
+  c.make = [=] {
+    Tensor base = Tensor::random({rows, cols}, dtype, dev.type);
+    xft_tensor_t view;
+    check(xft_tensor_transpose(base.get(), 0, 1, &view));
+    auto a = std::make_shared<Tensor>(view);
+    auto b = std::make_shared<Tensor>(Tensor::random({cols, rows}, dtype, dev.type));
+    return std::function<void()>(
+        [=] { discard([&](xft_tensor_t* o) { return fn(a->get(), b->get(), o); }); });
+  };
+  return c;
+}
+
+// dim < 0 with all_dims reduces everything.
+Case reduce_case(const char* op, ReduceFn fn, const Shape& shape, int64_t dim, bool all_dims,
+                 int32_t dtype, Device dev) {
+  const double n = numel(shape);
+  const std::string where = all_dims ? "all" : "dim" + std::to_string(dim);
+  Case c{op, str(shape) + ":" + where, dtype, dev, n, n * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random(shape, dtype, dev.type));
+    return std::function<void()>([=] {
+      discard([&](xft_tensor_t* o) { return fn(x->get(), dim, all_dims, 0, o); });
+    });
+  };
+  return c;
+}
+
+Case softmax_case(const Shape& shape, int64_t dim, int32_t dtype, Device dev) {
+  const double n = numel(shape);
+  // max, subtract, exp, sum, scale.
+  Case c{"softmax", str(shape) + ":dim" + std::to_string(dim), dtype, dev, 5 * n,
+         2 * n * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random(shape, dtype, dev.type));
+    return std::function<void()>(
+        [=] { discard([&](xft_tensor_t* o) { return xft_softmax(x->get(), dim, o); }); });
+  };
+  return c;
+}
+
+// Layer norm over the last dim, composed from the public ops: the baseline
+// the fused kernel is measured against.
+Case layernorm_unfused_case(int64_t rows, int64_t cols, int32_t dtype, Device dev) {
+  const double n = static_cast<double>(rows) * cols;
+  Case c{"layernorm_unfused", str({rows, cols}), dtype, dev, 8 * n,
+         (2 * n + 2.0 * cols) * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({rows, cols}, dtype, dev.type));
+    auto gamma = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    auto beta = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    auto eps = std::make_shared<Tensor>(Tensor::random({}, dtype, dev.type, 1e-5, 1e-5));
+    return std::function<void()>([=] {
+      xft_tensor_t h;
+      check(xft_mean(x->get(), -1, 0, 1, &h));
+      Tensor mean(h);
+      check(xft_sub(x->get(), mean.get(), &h));
+      Tensor xc(h);
+      check(xft_mul(xc.get(), xc.get(), &h));
+      Tensor sq(h);
+      check(xft_mean(sq.get(), -1, 0, 1, &h));
+      Tensor var(h);
+      check(xft_add(var.get(), eps->get(), &h));
+      Tensor var_eps(h);
+      check(xft_sqrt(var_eps.get(), &h));
+      Tensor std_dev(h);
+      check(xft_div(xc.get(), std_dev.get(), &h));
+      Tensor normed(h);
+      check(xft_mul(normed.get(), gamma->get(), &h));
+      Tensor scaled(h);
+      discard([&](xft_tensor_t* o) { return xft_add(scaled.get(), beta->get(), o); });
+    });
+  };
+  return c;
+}
+
+Case layernorm_case(int64_t rows, int64_t cols, int32_t dtype, Device dev) {
+  const double n = static_cast<double>(rows) * cols;
+  Case c{"layernorm", str({rows, cols}), dtype, dev, 8 * n,
+         (2 * n + 2.0 * cols) * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({rows, cols}, dtype, dev.type));
+    auto gamma = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    auto beta = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    return std::function<void()>([=] {
+      discard([&](xft_tensor_t* o) {
+        return xft_layer_norm(x->get(), gamma->get(), beta->get(), 1e-5, o);
+      });
+    });
+  };
+  return c;
+}
+
+Case bias_gelu_case(int64_t rows, int64_t cols, int32_t dtype, Device dev) {
+  const double n = static_cast<double>(rows) * cols;
+  Case c{"bias_gelu", str({rows, cols}), dtype, dev, 9 * n,
+         (2 * n + cols) * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({rows, cols}, dtype, dev.type));
+    auto bias = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    return std::function<void()>([=] {
+      discard([&](xft_tensor_t* o) { return xft_bias_gelu(x->get(), bias->get(), o); });
+    });
+  };
+  return c;
+}
+
+Case bias_dropout_residual_case(int64_t rows, int64_t cols, int32_t dtype, Device dev) {
+  const double n = static_cast<double>(rows) * cols;
+  Case c{"bias_dropout_residual", str({rows, cols}), dtype, dev, 4 * n,
+         (3 * n + cols) * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({rows, cols}, dtype, dev.type));
+    auto bias = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    auto res = std::make_shared<Tensor>(Tensor::random({rows, cols}, dtype, dev.type));
+    return std::function<void()>([=] {
+      discard([&](xft_tensor_t* o) {
+        return xft_bias_dropout_residual(x->get(), bias->get(), res->get(), 0.1, 1, o);
+      });
+    });
+  };
+  return c;
+}
+
+Case attention_case(int64_t heads, int64_t seq, int64_t head_dim, bool causal, int32_t dtype,
+                    Device dev) {
+  const Shape shape{heads, seq, head_dim};
+  // QK^T and PV, halved under the causal mask.
+  const double flops = 4.0 * heads * seq * seq * head_dim * (causal ? 0.5 : 1.0);
+  Case c{"sdpa", str(shape) + (causal ? ":causal" : ""), dtype, dev, flops,
+         4.0 * heads * seq * head_dim * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto q = std::make_shared<Tensor>(Tensor::random(shape, dtype, dev.type));
+    auto k = std::make_shared<Tensor>(Tensor::random(shape, dtype, dev.type));
+    auto v = std::make_shared<Tensor>(Tensor::random(shape, dtype, dev.type));
+    return std::function<void()>([=] {
+      discard([&](xft_tensor_t* o) {
+        return xft_scaled_dot_product_attention(q->get(), k->get(), v->get(), causal, 0.0, o);
+      });
+    });
+  };
+  return c;
+}
+
+// sigmoid(x * w + b) * x + tanh(x): six pointwise ops, run eagerly (six
+// passes through memory) or traced in lazy mode and run as one fused loop.
+Case pointwise_chain_case(int64_t rows, int64_t cols, bool lazy, int32_t dtype, Device dev) {
+  const double n = static_cast<double>(rows) * cols;
+  Case c{lazy ? "pointwise_chain_lazy" : "pointwise_chain", str({rows, cols}), dtype, dev, 8 * n,
+         (2 * n + 2.0 * cols) * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({rows, cols}, dtype, dev.type));
+    auto w = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    auto b = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    return std::function<void()>([=] {
+      check(xft_set_lazy_enabled(lazy));
+      xft_tensor_t h;
+      check(xft_mul(x->get(), w->get(), &h));
+      Tensor xw(h);
+      check(xft_add(xw.get(), b->get(), &h));
+      Tensor pre(h);
+      check(xft_sigmoid(pre.get(), &h));
+      Tensor gate(h);
+      check(xft_mul(gate.get(), x->get(), &h));
+      Tensor gated(h);
+      check(xft_tanh(x->get(), &h));
+      Tensor t(h);
+      check(xft_add(gated.get(), t.get(), &h));
+      Tensor out(h);
+      check(xft_set_lazy_enabled(0));
+      check(xft_tensor_materialize(out.get()));
+    });
+  };
+  return c;
+}
+
+// The same chain as served under inference mode: each step writes over the
+// intermediate it consumes (out=), so it allocates two buffers instead of
+// five.
+Case pointwise_chain_inplace_case(int64_t rows, int64_t cols, int32_t dtype, Device dev) {
+  const double n = static_cast<double>(rows) * cols;
+  Case c{"pointwise_chain_inplace", str({rows, cols}), dtype, dev, 8 * n,
+         (2 * n + 2.0 * cols) * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({rows, cols}, dtype, dev.type));
+    auto w = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    auto b = std::make_shared<Tensor>(Tensor::random({cols}, dtype, dev.type));
+    return std::function<void()>([=] {
+      check(xft_set_inference_mode(1));
+      xft_tensor_t h;
+      check(xft_mul(x->get(), w->get(), &h));
+      Tensor y(h);
+      check(xft_add_out(y.get(), b->get(), y.get()));
+      check(xft_sigmoid_out(y.get(), y.get()));
+      check(xft_mul_out(y.get(), x->get(), y.get()));
+      check(xft_tanh(x->get(), &h));
+      Tensor t(h);
+      check(xft_add_out(y.get(), t.get(), y.get()));
+      check(xft_set_inference_mode(0));
+      check(xft_set_grad_enabled(1));
+    });
+  };
+  return c;
+}
+
+// `steps` dependent tanh calls on a small tensor: launch-bound, so it
+// measures per-kernel overhead, eagerly or replayed from a CUDA graph.
+Case launch_chain_case(int64_t n, int steps, bool graphed, int32_t dtype, Device dev) {
+  const double total = static_cast<double>(n) * steps;
+  Case c{graphed ? "launch_chain_graph" : "launch_chain",
+         str({n}) + "x" + std::to_string(steps), dtype, dev, total,
+         2 * total * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({n}, dtype, dev.type));
+    auto chain = [=] {
+      xft_tensor_t h;
+      check(xft_tanh(x->get(), &h));
+      Tensor y(h);
+      for (int i = 1; i < steps; i++) {
+        check(xft_tanh(y.get(), &h));
+        y = Tensor(h);
+      }
+      return y;
+    };
+    if (!graphed) return std::function<void()>([=] { chain(); });
+    void* stream = nullptr;
+    check(xft_cuda_stream_create(dev.index, 0, &stream));
+    void* raw = nullptr;
+    check(xft_cuda_graph_create(&raw));
+    std::shared_ptr<void> graph(raw, [stream](void* g) {
+      xft_cuda_graph_destroy(g);
+      xft_cuda_stream_destroy(stream);
+    });
+    dev.synchronize();
+    check(xft_cuda_set_current_stream(dev.index, stream));
+    check(xft_cuda_graph_capture_begin(graph.get(), dev.index, 0));
+    auto out = std::make_shared<Tensor>(chain());
+    check(xft_cuda_graph_capture_end(graph.get()));
+    check(xft_cuda_set_current_stream(dev.index, nullptr));
+    return std::function<void()>([=] {
+      (void)out;
+      check(xft_cuda_graph_replay(graph.get()));
+    });
+  };
+  return c;
+}
+
+// `steps` dependent add / scalar mul / relu calls on a tiny tensor. The
+// arithmetic is negligible, so this measures what each op costs to
+// dispatch: argument checks, iterator setup and the kernel lookup.
+Case dispatch_chain_case(int64_t n, int steps, int32_t dtype, Device dev) {
+  const double total = static_cast<double>(n) * steps;
+  Case c{"dispatch_chain", str({n}) + "x" + std::to_string(steps), dtype, dev, total,
+         3 * total * dtype_size(dtype), {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({n}, dtype, dev.type));
+    return std::function<void()>([=] {
+      xft_tensor_t h;
+      Tensor y;
+      for (int i = 0; i < steps; i++) {
+        const xft_tensor_t in = i == 0 ? x->get() : y.get();
+        switch (i % 3) {
+          case 0: check(xft_add(in, x->get(), &h)); break;
+          case 1: check(xft_mul_scalar(in, 0.5, 0, &h)); break;
+          default: check(xft_relu(in, &h)); break;
+        }
+        y = Tensor(h);
+      }
+    });
+  };
+  return c;
+}
+
+// One fused Adam step over `count` parameters of `numel` elements each:
+// the shape of a model's optimizer step, many smallish tensors.
+Case adam_step_case(int64_t count, int64_t numel, int32_t dtype, Device dev) {
+  const double n = static_cast<double>(count) * numel;
+  Case c{"adam_step", std::to_string(count) + "x" + str({numel}), dtype, dev, 12 * n,
+         7 * n * dtype_size(dtype), {}};
+  c.make = [=] {
+    struct State {
+      std::vector<Tensor> p, g, m, v;
+      std::vector<xft_tensor_t> hp, hg, hm, hv;
+      int64_t step = 0;
+    };
+    auto st = std::make_shared<State>();
+    for (int64_t i = 0; i < count; i++) {
+      st->p.push_back(Tensor::random({numel}, dtype, dev.type));
+      st->g.push_back(Tensor::random({numel}, dtype, dev.type));
+      st->m.push_back(Tensor::random({numel}, dtype, dev.type));
+      st->v.push_back(Tensor::random({numel}, dtype, dev.type, 0.0, 1.0));
+      st->hp.push_back(st->p.back().get());
+      st->hg.push_back(st->g.back().get());
+      st->hm.push_back(st->m.back().get());
+      st->hv.push_back(st->v.back().get());
+    }
+    return std::function<void()>([=] {
+      check(xft_adam_step(st->hp.data(), st->hg.data(), st->hm.data(), st->hv.data(), count,
+                          1e-3, 0.9, 0.999, 1e-8, 0.01, 1, ++st->step));
+    });
+  };
+  return c;
+}
+
+Case matmul_case(int64_t batch, int64_t m, int64_t k, int64_t n, int32_t dtype, Device dev) {
+  const Shape a_shape = batch > 1 ? Shape{batch, m, k} : Shape{m, k};
+  const Shape b_shape = batch > 1 ? Shape{batch, k, n} : Shape{k, n};
+  const double flops = 2.0 * batch * m * n * k;
+  const double bytes = static_cast<double>(batch) * (m * k + k * n + m * n) * dtype_size(dtype);
+  Case c{"matmul", str(a_shape) + "@" + str(b_shape), dtype, dev, flops, bytes, {}};
+  c.make = [=] {
+    auto a = std::make_shared<Tensor>(Tensor::random(a_shape, dtype, dev.type));
+    auto b = std::make_shared<Tensor>(Tensor::random(b_shape, dtype, dev.type));
+    return std::function<void()>(
+        [=] { discard([&](xft_tensor_t* o) { return xft_matmul(a->get(), b->get(), o); }); });
+  };
+  return c;
+}
+
+// x [m, k] @ w^T for a [n, k] weight in `bits`, the decode-shaped product
+// that is bound by weight bytes; compare matmul of [1, k] @ [k, n].
+Case quantized_linear_case(int bits, bool dynamic, int64_t m, int64_t k, int64_t n,
+                           int32_t dtype, Device dev) {
+  const double flops = 2.0 * m * n * k;
+  const double bytes = n * k * bits / 8.0 + (m * k + m * n) * dtype_size(dtype);
+  const std::string op = std::string("quantized_linear_int") + std::to_string(bits) +
+                         (dynamic ? "_dynamic" : "");
+  Case c{op, str({m, k}) + "@" + str({n, k}) + "^T", dtype, dev, flops, bytes, {}};
+  c.make = [=] {
+    auto x = std::make_shared<Tensor>(Tensor::random({m, k}, dtype, dev.type));
+    Tensor w = Tensor::random({n, k}, dtype, dev.type);
+    xft_tensor_t data, scales;
+    check(xft_quantize_weight(w.get(), bits, bits == 4 ? 128 : 0, &data, &scales));
+    auto d = std::make_shared<Tensor>(data);
+    auto s = std::make_shared<Tensor>(scales);
+    return std::function<void()>([=] {
+      discard([&](xft_tensor_t* o) {
+        return xft_quantized_linear(x->get(), d->get(), s->get(), nullptr, dynamic, o);
+      });
+    });
+  };
+  return c;
+}
+
+// An R x R, stride-1, same-padded conv2d with a channels-last input (the
+// result stays channels last); flops count the multiply-adds of the
+// implicit GEMM.
+Case conv2d_case(int64_t n, int64_t ch, int64_t hw, int64_t k, int64_t r, int32_t dtype,
+                 Device dev) {
+  const double flops = 2.0 * n * k * hw * hw * ch * r * r;
+  const double bytes = static_cast<double>(n * hw * hw * (ch + k) + k * ch * r * r) *
+                       dtype_size(dtype);
+  Case c{"conv2d_nhwc", str({n, ch, hw, hw}) + "*" + str({k, ch, r, r}), dtype, dev, flops,
+         bytes, {}};
+  c.make = [=] {
+    Tensor nchw = Tensor::random({n, ch, hw, hw}, dtype, dev.type);
+    xft_tensor_t h;
+    check(xft_tensor_contiguous(nchw.get(), 1, &h));
+    auto x = std::make_shared<Tensor>(h);
+    auto w = std::make_shared<Tensor>(Tensor::random({k, ch, r, r}, dtype, dev.type));
+    return std::function<void()>([=] {
+      discard([&](xft_tensor_t* o) {
+        return xft_conv2d(x->get(), w->get(), nullptr, 1, 1, r / 2, r / 2, 1, 1, 1, o);
+      });
+    });
+  };
+  return c;
+}
+
+// One decode step of paged attention for `batch` sequences whose lengths
+// spread evenly over (max_len / 2, max_len], heads query heads sharing
+// kv_heads cached ones. Bound by reading the cached keys and values.
+Case paged_attention_case(int64_t batch, int64_t max_len, int64_t heads, int64_t kv_heads,
+                          int64_t head_dim, int64_t block_size, int32_t dtype, Device dev) {
+  std::vector<int64_t> lens(batch);
+  int64_t tokens = 0, blocks = 0;
+  for (int64_t b = 0; b < batch; b++) {
+    lens[b] = max_len / 2 + (b + 1) * (max_len / 2) / batch;
+    tokens += lens[b];
+    blocks += (lens[b] + block_size - 1) / block_size;
+  }
+  const double flops = 4.0 * tokens * heads * head_dim;
+  const double bytes = 2.0 * tokens * kv_heads * head_dim * dtype_size(dtype);
+  Case c{"paged_attention",
+         std::to_string(batch) + "x" + std::to_string(max_len) + "/" + std::to_string(heads) +
+             ":" + std::to_string(kv_heads) + "x" + std::to_string(head_dim),
+         dtype, dev, flops, bytes, {}};
+  c.make = [=] {
+    void* raw;
+    check(xft_paged_kv_cache_create(1, blocks, block_size, kv_heads, head_dim, dtype, dev.type,
+                                    dev.index, &raw));
+    std::shared_ptr<void> cache(raw, [](void* p) { xft_paged_kv_cache_destroy(p); });
+    std::vector<int64_t> seqs(batch);
+    for (int64_t& s : seqs) check(xft_paged_kv_cache_add_sequence(cache.get(), &s));
+    xft_tensor_t h;
+    check(xft_paged_kv_cache_append_slots(cache.get(), seqs.data(), lens.data(), batch, &h));
+    Tensor slots(h);
+    Tensor k = Tensor::random({tokens, kv_heads, head_dim}, dtype, dev.type);
+    Tensor v = Tensor::random({tokens, kv_heads, head_dim}, dtype, dev.type);
+    check(xft_paged_kv_cache_store(cache.get(), 0, slots.get(), k.get(), v.get()));
+    check(xft_paged_kv_cache_block_tables(cache.get(), seqs.data(), batch, &h));
+    auto tables = std::make_shared<Tensor>(h);
+    check(xft_paged_kv_cache_context_lens(cache.get(), seqs.data(), batch, &h));
+    auto ctx = std::make_shared<Tensor>(h);
+    check(xft_paged_kv_cache_key_cache(cache.get(), 0, &h));
+    auto kc = std::make_shared<Tensor>(h);
+    check(xft_paged_kv_cache_value_cache(cache.get(), 0, &h));
+    auto vc = std::make_shared<Tensor>(h);
+    auto q = std::make_shared<Tensor>(Tensor::random({batch, heads, head_dim}, dtype, dev.type));
+    return std::function<void()>([=] {
+      (void)cache;
+      discard([&](xft_tensor_t* o) {
+        return xft_paged_attention(q->get(), kc->get(), vc->get(), tables->get(), ctx->get(),
+                                   0.0, o);
+      });
+    });
+  };
+  return c;
+}
+
+void add_cases(std::vector<Case>& cases, int32_t dtype, Device dev) {
+  for (int64_t s : {256, 512, 1024}) cases.push_back(matmul_case(1, s, s, s, dtype, dev));
+  cases.push_back(matmul_case(1, 4096, 1024, 64, dtype, dev));
+  cases.push_back(matmul_case(16, 128, 64, 128, dtype, dev));
+  if (dtype == kFloat32) {
+    cases.push_back(matmul_case(1, 1, 4096, 4096, dtype, dev));
+    cases.push_back(quantized_linear_case(8, false, 1, 4096, 4096, dtype, dev));
+    cases.push_back(quantized_linear_case(8, true, 1, 4096, 4096, dtype, dev));
+    cases.push_back(quantized_linear_case(4, false, 1, 4096, 4096, dtype, dev));
+  }
+
+  cases.push_back(conv2d_case(8, 64, 56, 64, 3, dtype, dev));
+
+  cases.push_back(softmax_case({4096, 1024}, -1, dtype, dev));
+  cases.push_back(softmax_case({1024, 4096}, 0, dtype, dev));
+  cases.push_back(attention_case(8, 1024, 64, false, dtype, dev));
+  cases.push_back(attention_case(8, 1024, 64, true, dtype, dev));
+  cases.push_back(paged_attention_case(16, 2048, 32, 8, 128, 16, dtype, dev));
+  cases.push_back(layernorm_unfused_case(4096, 1024, dtype, dev));
+  cases.push_back(layernorm_case(4096, 1024, dtype, dev));
+  cases.push_back(bias_gelu_case(4096, 1024, dtype, dev));
+  cases.push_back(bias_dropout_residual_case(4096, 1024, dtype, dev));
+  cases.push_back(pointwise_chain_case(4096, 1024, false, dtype, dev));
+  cases.push_back(pointwise_chain_case(4096, 1024, true, dtype, dev));
+  cases.push_back(pointwise_chain_inplace_case(4096, 1024, dtype, dev));
+  cases.push_back(adam_step_case(1000, 4096, dtype, dev));
+  cases.push_back(dispatch_chain_case(16, 256, dtype, dev));
+  if (dev.type == kCUDA) {
+    cases.push_back(launch_chain_case(4096, 256, false, dtype, dev));
+    cases.push_back(launch_chain_case(4096, 256, true, dtype, dev));
+  }
+
+  const Shape big{1 << 22};
+  cases.push_back(binary_case("add", xft_add, big, big, dtype, dev));
+  cases.push_back(binary_case("mul", xft_mul, big, {}, dtype, dev));
+  cases.push_back(binary_case("add", xft_add, {2048, 2048}, {2048}, dtype, dev));
+  cases.push_back(transposed_binary_case("add", xft_add, 2048, 2048, dtype, dev));
+  cases.push_back(unary_case("relu", xft_relu, 1, big, dtype, dev));
+  cases.push_back(unary_case("exp", xft_exp, 1, big, dtype, dev));
+  cases.push_back(unary_case("tanh", xft_tanh, 1, big, dtype, dev));
+  cases.push_back(unary_case("gelu", xft_gelu, 8, big, dtype, dev));
+
+  cases.push_back(reduce_case("sum", xft_sum, big, 0, true, dtype, dev));
+  cases.push_back(reduce_case("sum", xft_sum, {2048, 2048}, 1, false, dtype, dev));
+  cases.push_back(reduce_case("sum", xft_sum, {2048, 2048}, 0, false, dtype, dev));
+  cases.push_back(reduce_case("amax", xft_amax, {2048, 2048}, 1, false, dtype, dev));
+}
+
+// The 16-bit dtypes on the ops autocast sends to them, plus the memory-bound
+// ones whose traffic they halve.
+void add_half_cases(std::vector<Case>& cases, int32_t dtype, Device dev) {
+  for (int64_t s : {1024, 4096}) cases.push_back(matmul_case(1, s, s, s, dtype, dev));
+  cases.push_back(matmul_case(16, 128, 64, 128, dtype, dev));
+  cases.push_back(attention_case(8, 1024, 64, true, dtype, dev));
+  cases.push_back(paged_attention_case(16, 2048, 32, 8, 128, 16, dtype, dev));
+  cases.push_back(softmax_case({4096, 1024}, -1, dtype, dev));
+  cases.push_back(layernorm_case(4096, 1024, dtype, dev));
+  cases.push_back(bias_gelu_case(4096, 1024, dtype, dev));
+  cases.push_back(pointwise_chain_case(4096, 1024, false, dtype, dev));
+  cases.push_back(pointwise_chain_case(4096, 1024, true, dtype, dev));
+  cases.push_back(binary_case("add", xft_add, {1 << 22}, {1 << 22}, dtype, dev));
+}
+
+}  // namespace
+
+std::vector<Case> all_cases(const Options& opts) {
+  std::vector<Device> devices;
+  if (opts.device != "cuda") devices.push_back({kCPU, 0});
+  if (opts.device != "cpu") {
+    int32_t available = 0;
+    check(xft_cuda_is_available(&available));
+    if (available) {
+      devices.push_back({kCUDA, 0});
+    } else if (opts.device == "cuda") {
+      throw std::runtime_error("--device cuda: no CUDA device available");
+    }
+  }
+  std::vector<Case> cases;
+  for (const Device& dev : devices) {
+    for (int32_t dtype : {kFloat32, kFloat64}) add_cases(cases, dtype, dev);
+    for (int32_t dtype : {kFloat16, kBFloat16}) add_half_cases(cases, dtype, dev);
+  }
+  return cases;
+}
+
+}  // namespace xft::bench
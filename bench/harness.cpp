@@ -0,0 +1,212 @@
+#include "harness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace xft::bench {
+
+const char* dtype_name(int32_t dtype) {
+  switch (dtype) {
+    case kFloat32: return "float32";
+    case kFloat64: return "float64";
+    case kFloat16: return "float16";
+    case kBFloat16: return "bfloat16";
+  }
+  return "unknown";
+}
+
+int64_t dtype_size(int32_t dtype) {
+  switch (dtype) {
+    case kFloat64: return 8;
+    case kFloat16:
+    case kBFloat16: return 2;
+  }
+  return 4;
+}
+
+void check(int rc) {
+  if (rc != 0) throw std::runtime_error(xft_last_error());
+}
+
+Tensor& Tensor::operator=(Tensor&& o) noexcept {
+  std::swap(h_, o.h_);
+  return *this;
+}
+
+Tensor::~Tensor() {
+  if (h_ != nullptr) xft_tensor_free(h_);
+}
+
+Tensor Tensor::random(const std::vector<int64_t>& shape, int32_t dtype, int32_t device,
+                      double lo, double hi) {
+  int64_t n = 1;
+  for (int64_t s : shape) n *= s;
+  std::mt19937_64 gen(n);
+  std::uniform_real_distribution<double> dist(lo, hi);
+  std::vector<double> values(n);
+  for (double& v : values) v = dist(gen);
+
+  xft_tensor_t host, typed, placed;
+  check(xft_tensor_from_buffer(values.data(), shape.data(), shape.size(), kFloat64, &host));
+  Tensor h(host);
+  check(xft_tensor_to_dtype(host, dtype, &typed));
+  Tensor t(typed);
+  if (device == kCPU) return t;
+  check(xft_tensor_to_device(typed, device, 0, 0, &placed));
+  return Tensor(placed);
+}
+
+std::string Device::str() const {
+  return type == kCPU ? std::string("cpu") : "cuda:" + std::to_string(index);
+}
+
+void Device::synchronize() const {
+  if (type == kCUDA) check(xft_cuda_synchronize(index));
+}
+
+std::string Case::name() const {
+  return op + "/" + dtype_name(dtype) + "/" + shape + "/" + device.str();
+}
+
+namespace {
+
+void usage(const char* prog) {
+  std::printf(
+      "usage: %s [options]\n"
+      "  --out PATH           JSON lines output (default bench_output.txt)\n"
+      "  --append             append to --out instead of truncating it\n"
+      "  --filter SUBSTR      only cases whose name contains SUBSTR\n"
+      "  --device cpu|cuda|all\n"
+      "  --warmup N           untimed calls per case (default 3)\n"
+      "  --reps N             timed samples per case (default 20)\n"
+      "  --min-sample-ms X    repeat fast calls until a sample takes X ms (default 1)\n"
+      "  --threads N          CPU worker threads\n"
+      "  --label TEXT         tag stored in every record\n"
+      "  --list               print case names and exit\n",
+      prog);
+}
+
+std::string escape(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+double percentile(std::vector<double> sorted, double q) {
+  std::sort(sorted.begin(), sorted.end());
+  const size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+}  // namespace
+
+Options parse_args(int argc, char** argv) {
+  Options opts;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        std::fprintf(stderr, "%s: missing value for %s\n", argv[0], arg.c_str());
+        std::exit(2);
+      }
+      return argv[++i];
+    };
+    if (arg == "--out") {
+      opts.out = value();
+    } else if (arg == "--append") {
+      opts.append = true;
+    } else if (arg == "--filter") {
+      opts.filter = value();
+    } else if (arg == "--device") {
+      opts.device = value();
+    } else if (arg == "--warmup") {
+      opts.warmup = std::atoi(value().c_str());
+    } else if (arg == "--reps") {
+      opts.reps = std::max(1, std::atoi(value().c_str()));
+    } else if (arg == "--min-sample-ms") {
+      opts.min_sample_ms = std::atof(value().c_str());
+    } else if (arg == "--threads") {
+      opts.threads = std::atoi(value().c_str());
+    } else if (arg == "--label") {
+      opts.label = value();
+    } else if (arg == "--list") {
+      opts.list = true;
+    } else if (arg == "--help" || arg == "-h") {
+      usage(argv[0]);
+      std::exit(0);
+    } else {
+      std::fprintf(stderr, "%s: unknown option %s\n", argv[0], arg.c_str());
+      usage(argv[0]);
+      std::exit(2);
+    }
+  }
+  if (opts.device != "cpu" && opts.device != "cuda" && opts.device != "all") {
+    std::fprintf(stderr, "%s: --device must be cpu, cuda or all\n", argv[0]);
+    std::exit(2);
+  }
+  return opts;
+}
+
+Result run_case(const Case& c, const Options& opts) {
+  using clock = std::chrono::steady_clock;
+  const std::function<void()> call = c.make();
+  for (int i = 0; i < opts.warmup; i++) call();
+  c.device.synchronize();
+
+  auto time_ms = [&](int64_t iters) {
+    c.device.synchronize();
+    const auto start = clock::now();
+    for (int64_t i = 0; i < iters; i++) call();
+    c.device.synchronize();
+    return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  };
+
+  // Batch calls that are much shorter than the timer and sync overhead.
+  Result r;
+  const double once = time_ms(1);
+  if (once < opts.min_sample_ms) {
+    r.iters = std::min<int64_t>(10000, static_cast<int64_t>(opts.min_sample_ms / once) + 1);
+  }
+  for (int i = 0; i < opts.reps; i++) r.ms.push_back(time_ms(r.iters) / r.iters);
+  r.median_ms = percentile(r.ms, 0.5);
+  r.p95_ms = percentile(r.ms, 0.95);
+  r.min_ms = *std::min_element(r.ms.begin(), r.ms.end());
+  return r;
+}
+
+std::string to_json(const Case& c, const Result& r, const Options& opts) {
+  const char* isa = "";
+  int32_t threads = 0;
+  check(xft_cpu_capability(&isa));
+  check(xft_get_num_threads(&threads));
+  const double seconds = r.median_ms * 1e-3;
+
+  std::ostringstream os;
+  os.precision(6);
+  os << "{\"name\":\"" << escape(c.name()) << "\",\"op\":\"" << c.op << "\",\"dtype\":\""
+     << dtype_name(c.dtype) << "\",\"shape\":\"" << c.shape << "\",\"device\":\""
+     << c.device.str() << "\"";
+  if (c.device.type == kCPU) os << ",\"threads\":" << threads << ",\"isa\":\"" << isa << "\"";
+  if (!opts.label.empty()) os << ",\"label\":\"" << escape(opts.label) << "\"";
+  os << ",\"warmup\":" << opts.warmup << ",\"reps\":" << r.ms.size() << ",\"iters\":" << r.iters
+     << ",\"median_ms\":" << r.median_ms << ",\"p95_ms\":" << r.p95_ms
+     << ",\"min_ms\":" << r.min_ms;
+  if (c.flops > 0) os << ",\"gflops\":" << c.flops / seconds * 1e-9;
+  if (c.bytes > 0) os << ",\"gbps\":" << c.bytes / seconds * 1e-9;
+  // Arithmetic intensity, for placing the case on a roofline plot.
+  if (c.flops > 0 && c.bytes > 0) os << ",\"flops_per_byte\":" << c.flops / c.bytes;
+  os << "}";
+  return os.str();
+}
+
+}  // namespace xft::bench
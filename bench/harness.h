@@ -0,0 +1,96 @@
+#pragma once
+
+// Micro-benchmark harness over the C ABI. Each case times one op call
+// end to end (allocation of the result included), synchronizing the
+// device around every sample, and is reported as one JSON line.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "api/c_api.h"
+
+namespace xft::bench {
+
+// Codes from csrc/core/dtype.h and csrc/core/device.h.
+enum DTypeCode : int32_t { kFloat32 = 0, kFloat64 = 1, kFloat16 = 6, kBFloat16 = 7 };
+enum DeviceCode : int32_t { kCPU = 0, kCUDA = 1 };
+
+const char* dtype_name(int32_t dtype);
+int64_t dtype_size(int32_t dtype);
+
+// Throws std::runtime_error with xft_last_error() when rc != 0.
+void check(int rc);
+
+// Owning xft_tensor_t handle.
+class Tensor {
+ public:
+  Tensor() = default;
+  explicit Tensor(xft_tensor_t h) : h_(h) {}
+  Tensor(Tensor&& o) noexcept : h_(o.h_) { o.h_ = nullptr; }
+  Tensor& operator=(Tensor&& o) noexcept;
+  Tensor(const Tensor&) = delete;
+  Tensor& operator=(const Tensor&) = delete;
+  ~Tensor();
+
+  xft_tensor_t get() const { return h_; }
+
+  // Uniform values in [lo, hi) of `dtype`, on the given device.
+  static Tensor random(const std::vector<int64_t>& shape, int32_t dtype, int32_t device,
+                       double lo = -1.0, double hi = 1.0);
+
+ private:
+  xft_tensor_t h_ = nullptr;
+};
+
+struct Device {
+  int32_t type = kCPU;
+  int32_t index = 0;
+  std::string str() const;
+  void synchronize() const;
+};
+
+// One benchmark. `make` allocates the inputs and returns the timed call; it
+// only runs for cases that pass the filter.
+struct Case {
+  std::string op;     // e.g. "matmul"
+  std::string shape;  // human-readable operand shapes
+  int32_t dtype = kFloat32;
+  Device device;
+  double flops = 0;  // per call; 0 when not meaningful
+  double bytes = 0;  // minimum bytes moved per call
+  std::function<std::function<void()>()> make;
+
+  std::string name() const;
+};
+
+struct Options {
+  std::string out = "bench_output.txt";
+  std::string filter;  // substring of Case::name()
+  std::string device = "all";
+  std::string label;  // copied into every record, e.g. a release tag
+  int warmup = 3;
+  int reps = 20;
+  double min_sample_ms = 1.0;
+  int threads = 0;  // 0 keeps the library default
+  bool append = false;
+  bool list = false;
+};
+
+// Parses argv; exits on --help or a bad flag.
+Options parse_args(int argc, char** argv);
+
+// Registers every case for the devices `opts` selects (cases.cpp).
+std::vector<Case> all_cases(const Options& opts);
+
+struct Result {
+  int64_t iters = 1;        // calls per sample
+  std::vector<double> ms;   // per-call time of each sample
+  double median_ms = 0, p95_ms = 0, min_ms = 0;
+};
+
+Result run_case(const Case& c, const Options& opts);
+std::string to_json(const Case& c, const Result& r, const Options& opts);
+
+}  // namespace xft::bench
@@ -0,0 +1,46 @@
+// xft_bench: runs the micro-benchmarks in cases.cpp and writes one JSON
+// object per case to --out (bench_output.txt by default).
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+
+#include "harness.h"
+
+int main(int argc, char** argv) {
+  using namespace xft::bench;
+  const Options opts = parse_args(argc, argv);
+  try {
+    if (opts.threads > 0) check(xft_set_num_threads(opts.threads));
+    std::vector<Case> cases = all_cases(opts);
+    if (opts.list) {
+      for (const Case& c : cases) {
+        if (c.name().find(opts.filter) != std::string::npos) std::printf("%s\n", c.name().c_str());
+      }
+      return 0;
+    }
+
+    std::ofstream out(opts.out, opts.append ? std::ios::app : std::ios::trunc);
+    if (!out) {
+      std::fprintf(stderr, "xft_bench: cannot open %s\n", opts.out.c_str());
+      return 1;
+    }
+    int failures = 0;
+    for (const Case& c : cases) {
+      if (c.name().find(opts.filter) == std::string::npos) continue;
+      try {
+        const Result r = run_case(c, opts);
+        out << to_json(c, r, opts) << "\n" << std::flush;
+        std::printf("%-52s median %10.4f ms  p95 %10.4f ms\n", c.name().c_str(), r.median_ms,
+                    r.p95_ms);
+      } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s: %s\n", c.name().c_str(), e.what());
+        failures++;
+      }
+    }
+    return failures == 0 ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "xft_bench: %s\n", e.what());
+    return 1;
+  }
+}
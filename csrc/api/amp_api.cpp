@@ -0,0 +1,45 @@
+#include <vector>
+
+#include "api/api_utils.h"
+#include "core/autocast.h"
+#include "ops/amp.h"
+
+using namespace xft;
+using namespace xft::api;
+
+extern "C" {
+
+int xft_autocast_set_enabled(int32_t device_type, int32_t enabled) {
+  XFT_API_BEGIN()
+  autocast::set_enabled(static_cast<DeviceType>(device_type), enabled != 0);
+  XFT_API_END()
+}
+
+int xft_autocast_is_enabled(int32_t device_type, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = autocast::is_enabled(static_cast<DeviceType>(device_type)) ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_autocast_set_dtype(int32_t device_type, int32_t dtype) {
+  XFT_API_BEGIN()
+  autocast::set_dtype(static_cast<DeviceType>(device_type), static_cast<DType>(dtype));
+  XFT_API_END()
+}
+
+int xft_autocast_get_dtype(int32_t device_type, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = static_cast<int32_t>(autocast::get_dtype(static_cast<DeviceType>(device_type)));
+  XFT_API_END()
+}
+
+int xft_amp_unscale_(const xft_tensor_t* tensors, int64_t n, double inv_scale,
+                     int32_t* found_inf) {
+  XFT_API_BEGIN()
+  std::vector<Tensor> grads;
+  for (int64_t i = 0; i < n; i++) grads.push_back(unwrap_optional(tensors[i]));
+  *found_inf = unscale_(grads, inv_scale) ? 1 : 0;
+  XFT_API_END()
+}
+
+}  // extern "C"
@@ -0,0 +1,51 @@
+#pragma once
+
+// Helpers shared by the C API translation units. Not part of the ABI.
+
+#include <exception>
+#include <string>
+
+#include "api/c_api.h"
+#include "core/tensor.h"
+
+namespace xft::api {
+
+void set_last_error(const std::string& msg);
+
+inline Tensor& unwrap(xft_tensor_t t) {
+  XFT_CHECK(t != nullptr, "null tensor handle");
+  return *reinterpret_cast<Tensor*>(t);
+}
+
+// For parameters documented as "NULL for none".
+inline Tensor unwrap_optional(xft_tensor_t t) {
+  return t != nullptr ? *reinterpret_cast<Tensor*>(t) : Tensor();
+}
+
+inline xft_tensor_t wrap(Tensor t) {
+  return reinterpret_cast<xft_tensor_t>(new Tensor(std::move(t)));
+}
+
+inline Shape to_shape(const int64_t* data, int64_t n) {
+  return n > 0 ? Shape(data, data + n) : Shape();
+}
+
+inline Device to_device(int32_t type, int32_t index) {
+  return Device(static_cast<DeviceType>(type), index);
+}
+
+inline MemoryFormat to_memory_format(int32_t code) {
+  XFT_CHECK(code == 0 || code == 1, "invalid memory format code ", code);
+  return static_cast<MemoryFormat>(code);
+}
+
+}  // namespace xft::api
+
+#define XFT_API_BEGIN() try {
+#define XFT_API_END()                              \
+  }                                                \
+  catch (const std::exception& e) {                \
+    ::xft::api::set_last_error(e.what());          \
+    return -1;                                     \
+  }                                                \
+  return 0;
@@ -0,0 +1,158 @@
+#include <memory>
+#include <vector>
+
+#include "api/api_utils.h"
+#include "autograd/checkpoint.h"
+#include "autograd/engine.h"
+#include "autograd/grad_mode.h"
+#include "autograd/node.h"
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+// The caller's segment callback; calls `release` once the last copy of the
+// CheckpointFn holding it is gone.
+class SegmentCallback {
+ public:
+  SegmentCallback(xft_segment_fn fn, xft_release_fn release, void* ctx)
+      : fn_(fn), release_(release), ctx_(ctx) {}
+  ~SegmentCallback() {
+    if (release_ != nullptr) release_(ctx_);
+  }
+
+  SegmentCallback(const SegmentCallback&) = delete;
+  SegmentCallback& operator=(const SegmentCallback&) = delete;
+
+  std::vector<Tensor> operator()(const std::vector<Tensor>& inputs) const {
+    std::vector<xft_tensor_t> in;
+    for (const Tensor& t : inputs) in.push_back(t.defined() ? wrap(t) : nullptr);
+    std::vector<xft_tensor_t> out(XFT_CHECKPOINT_MAX_OUTPUTS, nullptr);
+    int64_t n = 0;
+    const int status = fn_(ctx_, in.data(), static_cast<int64_t>(in.size()), out.data(),
+                           static_cast<int64_t>(out.size()), &n);
+    std::vector<Tensor> outputs;
+    for (int64_t i = 0; i < n && i < static_cast<int64_t>(out.size()); i++) {
+      outputs.push_back(out[i] != nullptr ? unwrap(out[i]) : Tensor());
+      delete reinterpret_cast<Tensor*>(out[i]);
+    }
+    XFT_CHECK(status == 0, "checkpoint: the checkpointed function failed");
+    XFT_CHECK(n >= 0 && n <= static_cast<int64_t>(out.size()), "checkpoint: at most ",
+              XFT_CHECKPOINT_MAX_OUTPUTS, " outputs are supported, got ", n);
+    return outputs;
+  }
+
+ private:
+  xft_segment_fn fn_;
+  xft_release_fn release_;
+  void* ctx_;
+};
+
+}  // namespace
+
+extern "C" {
+
+int xft_tensor_requires_grad(xft_tensor_t t, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).requires_grad() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_tensor_set_requires_grad(xft_tensor_t t, int32_t requires_grad) {
+  XFT_API_BEGIN()
+  unwrap(t).set_requires_grad(requires_grad != 0);
+  XFT_API_END()
+}
+
+int xft_tensor_is_leaf(xft_tensor_t t, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).is_leaf() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_tensor_grad(xft_tensor_t t, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  Tensor g = unwrap(t).grad();
+  *out = g.defined() ? wrap(std::move(g)) : nullptr;
+  XFT_API_END()
+}
+
+int xft_tensor_set_grad(xft_tensor_t t, xft_tensor_t grad) {
+  XFT_API_BEGIN()
+  unwrap(t).set_grad(grad != nullptr ? unwrap(grad) : Tensor());
+  XFT_API_END()
+}
+
+int xft_tensor_grad_fn_name(xft_tensor_t t, const char** out) {
+  XFT_API_BEGIN()
+  std::shared_ptr<autograd::Node> fn = unwrap(t).grad_fn();
+  *out = fn ? fn->name() : nullptr;
+  XFT_API_END()
+}
+
+int xft_tensor_detach(xft_tensor_t t, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).detach());
+  XFT_API_END()
+}
+
+int xft_backward(xft_tensor_t t, xft_tensor_t grad, int32_t retain_graph) {
+  XFT_API_BEGIN()
+  autograd::backward(unwrap(t), grad != nullptr ? unwrap(grad) : Tensor(), retain_graph != 0);
+  XFT_API_END()
+}
+
+int xft_set_grad_enabled(int32_t enabled) {
+  XFT_API_BEGIN()
+  autograd::GradMode::set_enabled(enabled != 0);
+  XFT_API_END()
+}
+
+int xft_is_grad_enabled(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = autograd::GradMode::is_enabled() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_set_inference_mode(int32_t enabled) {
+  XFT_API_BEGIN()
+  autograd::InferenceMode::set_enabled(enabled != 0);
+  if (enabled != 0) autograd::GradMode::set_enabled(false);
+  XFT_API_END()
+}
+
+int xft_is_inference_mode_enabled(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = autograd::InferenceMode::is_enabled() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_tensor_is_inference(xft_tensor_t t, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).is_inference() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_checkpoint(xft_segment_fn fn, xft_release_fn release, void* ctx,
+                   const xft_tensor_t* inputs, int64_t n_inputs, xft_tensor_t* outputs,
+                   int64_t max_outputs, int64_t* n_outputs) {
+  // Owns ctx from here on, whatever happens below.
+  auto callback = std::make_shared<SegmentCallback>(fn, release, ctx);
+  XFT_API_BEGIN()
+  XFT_CHECK(fn != nullptr, "checkpoint: null function");
+  std::vector<Tensor> in;
+  for (int64_t i = 0; i < n_inputs; i++) {
+    in.push_back(inputs[i] != nullptr ? unwrap(inputs[i]) : Tensor());
+  }
+  std::vector<Tensor> out = autograd::checkpoint(
+      [callback](const std::vector<Tensor>& args) { return (*callback)(args); }, in);
+  callback.reset();
+  XFT_CHECK(static_cast<int64_t>(out.size()) <= max_outputs, "checkpoint: ", out.size(),
+            " outputs do not fit in ", max_outputs);
+  for (size_t i = 0; i < out.size(); i++) outputs[i] = out[i].defined() ? wrap(out[i]) : nullptr;
+  *n_outputs = static_cast<int64_t>(out.size());
+  XFT_API_END()
+}
+
+}  // extern "C"
@@ -0,0 +1,477 @@
+#pragma once
+
+// Flat C ABI exported by libxft.so. The Python package binds these with
+// ctypes; every function returns 0 on success and -1 on failure, with the
+// message available from xft_last_error(). New handles come back through
+// out-parameters and are released with xft_tensor_free().
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XFT_EXPORT __attribute__((visibility("default")))
+
+typedef struct xft_tensor_* xft_tensor_t;
+typedef struct xft_state_dict_* xft_state_dict_t;
+typedef struct xft_profile_* xft_profile_t;
+
+XFT_EXPORT const char* xft_last_error(void);
+
+// ---- construction / lifetime ----
+XFT_EXPORT int xft_tensor_empty(const int64_t* shape, int64_t ndim, int32_t dtype,
+                                int32_t device_type, int32_t device_index, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_from_buffer(const void* data, const int64_t* shape, int64_t ndim,
+                                      int32_t dtype, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_free(xft_tensor_t t);
+// A second handle to the same tensor, autograd state included. Both must
+// be freed.
+XFT_EXPORT int xft_tensor_new_handle(xft_tensor_t t, xft_tensor_t* out);
+
+// ---- metadata ----
+XFT_EXPORT int xft_tensor_ndim(xft_tensor_t t, int64_t* out);
+XFT_EXPORT int xft_tensor_shape(xft_tensor_t t, int64_t* out);
+XFT_EXPORT int xft_tensor_strides(xft_tensor_t t, int64_t* out);
+XFT_EXPORT int xft_tensor_offset(xft_tensor_t t, int64_t* out);
+XFT_EXPORT int xft_tensor_dtype(xft_tensor_t t, int32_t* out);
+XFT_EXPORT int xft_tensor_device(xft_tensor_t t, int32_t* type, int32_t* index);
+XFT_EXPORT int xft_tensor_data_ptr(xft_tensor_t t, void** out);
+XFT_EXPORT int xft_tensor_storage_ptr(xft_tensor_t t, void** out);
+// memory_format is a MemoryFormat code (core/tensor.h): 0 contiguous, 1
+// channels last.
+XFT_EXPORT int xft_tensor_is_contiguous(xft_tensor_t t, int32_t memory_format, int32_t* out);
+
+// Copies the tensor's elements, in row-major order, into a host buffer of
+// exactly numel * element_size bytes.
+XFT_EXPORT int xft_tensor_to_buffer(xft_tensor_t t, void* dst, size_t nbytes);
+
+// ---- views ----
+XFT_EXPORT int xft_tensor_view(xft_tensor_t t, const int64_t* shape, int64_t ndim,
+                               xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_reshape(xft_tensor_t t, const int64_t* shape, int64_t ndim,
+                                  xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_transpose(xft_tensor_t t, int64_t d0, int64_t d1, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_permute(xft_tensor_t t, const int64_t* dims, int64_t ndim,
+                                  xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_slice(xft_tensor_t t, int64_t dim, int64_t start, int64_t end,
+                                int64_t step, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_select(xft_tensor_t t, int64_t dim, int64_t index, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_expand(xft_tensor_t t, const int64_t* shape, int64_t ndim,
+                                 xft_tensor_t* out);
+// all_dims != 0 squeezes every size-1 dim and ignores `dim`.
+XFT_EXPORT int xft_tensor_squeeze(xft_tensor_t t, int64_t dim, int32_t all_dims,
+                                  xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_unsqueeze(xft_tensor_t t, int64_t dim, xft_tensor_t* out);
+
+// ---- copies ----
+XFT_EXPORT int xft_tensor_contiguous(xft_tensor_t t, int32_t memory_format, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_clone(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_to_dtype(xft_tensor_t t, int32_t dtype, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_to_device(xft_tensor_t t, int32_t device_type, int32_t device_index,
+                                    int32_t non_blocking, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_copy_(xft_tensor_t dst, xft_tensor_t src, int32_t non_blocking);
+XFT_EXPORT int xft_tensor_fill_(xft_tensor_t t, double value);
+
+// ---- CUDA runtime ----
+// These are always exported; in a CPU-only build is_available reports 0 and
+// the rest fail with a descriptive error.
+XFT_EXPORT int xft_cuda_is_available(int32_t* out);
+XFT_EXPORT int xft_cuda_device_count(int32_t* out);
+XFT_EXPORT int xft_cuda_synchronize(int32_t device);
+XFT_EXPORT int xft_cuda_empty_cache(void);
+// Writes up to n counters, in xft::cuda::MemoryStats field order.
+XFT_EXPORT int xft_cuda_memory_stats(int32_t device, int64_t* out, int64_t n);
+XFT_EXPORT int xft_cuda_reset_peak_memory_stats(int32_t device);
+
+// ---- streams and events ----
+// Streams and events are passed as opaque cudaStream_t / cudaEvent_t values;
+// a null stream is the legacy default stream.
+XFT_EXPORT int xft_cuda_stream_create(int32_t device, int32_t priority, void** out);
+XFT_EXPORT int xft_cuda_stream_destroy(void* stream);
+XFT_EXPORT int xft_cuda_current_stream(int32_t device, void** out);
+XFT_EXPORT int xft_cuda_set_current_stream(int32_t device, void* stream);
+XFT_EXPORT int xft_cuda_stream_synchronize(void* stream);
+XFT_EXPORT int xft_cuda_stream_query(void* stream, int32_t* done);
+XFT_EXPORT int xft_cuda_stream_wait_event(void* stream, void* event);
+XFT_EXPORT int xft_cuda_event_create(int32_t device, int32_t enable_timing, void** out);
+XFT_EXPORT int xft_cuda_event_destroy(void* event);
+XFT_EXPORT int xft_cuda_event_record(void* event, void* stream);
+XFT_EXPORT int xft_cuda_event_synchronize(void* event);
+XFT_EXPORT int xft_cuda_event_query(void* event, int32_t* done);
+XFT_EXPORT int xft_cuda_event_elapsed_time(void* start, void* end, float* ms);
+// Marks t's memory as in use on `stream` so the allocator does not recycle it
+// before that stream's pending work is done.
+XFT_EXPORT int xft_tensor_record_stream(xft_tensor_t t, void* stream);
+
+// ---- CUDA graphs ----
+// An opaque cuda::CUDAGraph (cuda/graph.h). capture_begin records the
+// calling thread's work on the current stream of `device` (not the legacy
+// default stream) until capture_end; allocations made there come from
+// memory pool `pool`, or a new one when it is 0. replay relaunches it on
+// the current stream.
+XFT_EXPORT int xft_cuda_graph_create(void** out);
+XFT_EXPORT int xft_cuda_graph_destroy(void* graph);
+XFT_EXPORT int xft_cuda_graph_capture_begin(void* graph, int32_t device, uint64_t pool);
+XFT_EXPORT int xft_cuda_graph_capture_end(void* graph);
+XFT_EXPORT int xft_cuda_graph_replay(void* graph);
+XFT_EXPORT int xft_cuda_graph_reset(void* graph);
+XFT_EXPORT int xft_cuda_graph_pool(void* graph, uint64_t* out);
+// A fresh pool id, for graphs meant to share one pool.
+XFT_EXPORT int xft_cuda_graph_pool_handle(uint64_t* out);
+
+// ---- pinned host memory ----
+XFT_EXPORT int xft_tensor_pin_memory(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_is_pinned(xft_tensor_t t, int32_t* out);
+XFT_EXPORT int xft_cuda_host_empty_cache(void);
+// Writes up to n counters, in xft::cuda::HostMemoryStats field order.
+XFT_EXPORT int xft_cuda_host_memory_stats(int64_t* out, int64_t n);
+
+// ---- ops ----
+// Results are new, dense tensors on the operands' device.
+XFT_EXPORT int xft_matmul(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+XFT_EXPORT int xft_mm(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+XFT_EXPORT int xft_bmm(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+
+// Broadcasting binary ops.
+XFT_EXPORT int xft_add(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+XFT_EXPORT int xft_sub(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+XFT_EXPORT int xft_mul(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+XFT_EXPORT int xft_div(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+XFT_EXPORT int xft_maximum(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+XFT_EXPORT int xft_minimum(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out);
+// The same with a Python-style scalar operand: op(t, value), or op(value, t)
+// when reverse is nonzero. The scalar takes t's dtype and device, as a 0-d
+// tensor would; integer dtypes need an integral value.
+XFT_EXPORT int xft_add_scalar(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t* out);
+XFT_EXPORT int xft_sub_scalar(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t* out);
+XFT_EXPORT int xft_mul_scalar(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t* out);
+XFT_EXPORT int xft_div_scalar(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t* out);
+XFT_EXPORT int xft_maximum_scalar(xft_tensor_t t, double value, int32_t reverse,
+                                  xft_tensor_t* out);
+XFT_EXPORT int xft_minimum_scalar(xft_tensor_t t, double value, int32_t reverse,
+                                  xft_tensor_t* out);
+
+XFT_EXPORT int xft_exp(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_log(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_sqrt(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_tanh(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_sigmoid(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_relu(xft_tensor_t t, xft_tensor_t* out);
+XFT_EXPORT int xft_gelu(xft_tensor_t t, xft_tensor_t* out);
+
+// The elementwise ops above writing into an existing `out` (xft::add_out
+// and friends in ops/elementwise.h): it must have the result's shape, dtype
+// and device, and may be one of the inputs for an in-place update.
+XFT_EXPORT int xft_add_out(xft_tensor_t a, xft_tensor_t b, xft_tensor_t out);
+XFT_EXPORT int xft_sub_out(xft_tensor_t a, xft_tensor_t b, xft_tensor_t out);
+XFT_EXPORT int xft_mul_out(xft_tensor_t a, xft_tensor_t b, xft_tensor_t out);
+XFT_EXPORT int xft_div_out(xft_tensor_t a, xft_tensor_t b, xft_tensor_t out);
+XFT_EXPORT int xft_maximum_out(xft_tensor_t a, xft_tensor_t b, xft_tensor_t out);
+XFT_EXPORT int xft_minimum_out(xft_tensor_t a, xft_tensor_t b, xft_tensor_t out);
+XFT_EXPORT int xft_add_scalar_out(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t out);
+XFT_EXPORT int xft_sub_scalar_out(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t out);
+XFT_EXPORT int xft_mul_scalar_out(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t out);
+XFT_EXPORT int xft_div_scalar_out(xft_tensor_t t, double value, int32_t reverse, xft_tensor_t out);
+XFT_EXPORT int xft_maximum_scalar_out(xft_tensor_t t, double value, int32_t reverse,
+                                      xft_tensor_t out);
+XFT_EXPORT int xft_minimum_scalar_out(xft_tensor_t t, double value, int32_t reverse,
+                                      xft_tensor_t out);
+XFT_EXPORT int xft_exp_out(xft_tensor_t t, xft_tensor_t out);
+XFT_EXPORT int xft_log_out(xft_tensor_t t, xft_tensor_t out);
+XFT_EXPORT int xft_sqrt_out(xft_tensor_t t, xft_tensor_t out);
+XFT_EXPORT int xft_tanh_out(xft_tensor_t t, xft_tensor_t out);
+XFT_EXPORT int xft_sigmoid_out(xft_tensor_t t, xft_tensor_t out);
+XFT_EXPORT int xft_relu_out(xft_tensor_t t, xft_tensor_t out);
+XFT_EXPORT int xft_gelu_out(xft_tensor_t t, xft_tensor_t out);
+
+// Reductions over `dim`, or over every element when all_dims is nonzero.
+XFT_EXPORT int xft_sum(xft_tensor_t t, int64_t dim, int32_t all_dims, int32_t keepdim,
+                       xft_tensor_t* out);
+XFT_EXPORT int xft_mean(xft_tensor_t t, int64_t dim, int32_t all_dims, int32_t keepdim,
+                        xft_tensor_t* out);
+XFT_EXPORT int xft_amax(xft_tensor_t t, int64_t dim, int32_t all_dims, int32_t keepdim,
+                        xft_tensor_t* out);
+XFT_EXPORT int xft_softmax(xft_tensor_t t, int64_t dim, xft_tensor_t* out);
+
+// Fused ops over the last dim (see ops/fused.h). weight and bias are NULL
+// for none, except bias_gelu's.
+XFT_EXPORT int xft_layer_norm(xft_tensor_t x, xft_tensor_t weight, xft_tensor_t bias, double eps,
+                              xft_tensor_t* out);
+XFT_EXPORT int xft_rms_norm(xft_tensor_t x, xft_tensor_t weight, double eps, xft_tensor_t* out);
+XFT_EXPORT int xft_bias_gelu(xft_tensor_t x, xft_tensor_t bias, xft_tensor_t* out);
+XFT_EXPORT int xft_bias_dropout_residual(xft_tensor_t x, xft_tensor_t bias,
+                                         xft_tensor_t residual, double p, int32_t train,
+                                         xft_tensor_t* out);
+
+// Flash-style attention over the last two dims (see ops/attention.h); a
+// scale of 0 means 1 / sqrt(head dim).
+XFT_EXPORT int xft_scaled_dot_product_attention(xft_tensor_t q, xft_tensor_t k, xft_tensor_t v,
+                                                int32_t is_causal, double scale,
+                                                xft_tensor_t* out);
+
+// 2-D convolution of an NCHW (or channels-last) input (see ops/conv.h);
+// bias is NULL for none.
+XFT_EXPORT int xft_conv2d(xft_tensor_t x, xft_tensor_t weight, xft_tensor_t bias,
+                          int64_t stride_h, int64_t stride_w, int64_t pad_h, int64_t pad_w,
+                          int64_t dilation_h, int64_t dilation_w, int64_t groups,
+                          xft_tensor_t* out);
+
+// Quantized linear layers for inference (see ops/quantized.h). A quantized
+// weight is a (data, scales) pair: int8 data for 8 bits, packed uint8 for
+// 4; group_size 0 means one group per row. bias is NULL for none; dynamic
+// quantizes x's rows to int8 as well.
+XFT_EXPORT int xft_quantize_weight(xft_tensor_t weight, int32_t bits, int64_t group_size,
+                                   xft_tensor_t* data, xft_tensor_t* scales);
+XFT_EXPORT int xft_dequantize_weight(xft_tensor_t data, xft_tensor_t scales, xft_tensor_t* out);
+XFT_EXPORT int xft_quantized_linear(xft_tensor_t x, xft_tensor_t data, xft_tensor_t scales,
+                                    xft_tensor_t bias, int32_t dynamic, xft_tensor_t* out);
+
+// Decode attention over a block-paged KV cache (see ops/paged_attention.h);
+// scale 0 means 1 / sqrt(head_dim).
+XFT_EXPORT int xft_paged_attention(xft_tensor_t q, xft_tensor_t key_cache,
+                                   xft_tensor_t value_cache, xft_tensor_t block_tables,
+                                   xft_tensor_t context_lens, double scale, xft_tensor_t* out);
+// An opaque PagedKVCache. seqs arrays hold ids from add_sequence; the
+// cache tensors returned are new handles to the cache's own storage.
+XFT_EXPORT int xft_paged_kv_cache_create(int64_t num_layers, int64_t num_blocks,
+                                         int64_t block_size, int64_t num_heads,
+                                         int64_t head_dim, int32_t dtype, int32_t device_type,
+                                         int32_t device_index, void** out);
+XFT_EXPORT int xft_paged_kv_cache_destroy(void* cache);
+XFT_EXPORT int xft_paged_kv_cache_add_sequence(void* cache, int64_t* out);
+XFT_EXPORT int xft_paged_kv_cache_remove_sequence(void* cache, int64_t seq);
+XFT_EXPORT int xft_paged_kv_cache_append_slots(void* cache, const int64_t* seqs,
+                                               const int64_t* num_tokens, int64_t n,
+                                               xft_tensor_t* out);
+XFT_EXPORT int xft_paged_kv_cache_store(void* cache, int64_t layer, xft_tensor_t slots,
+                                        xft_tensor_t k, xft_tensor_t v);
+XFT_EXPORT int xft_paged_kv_cache_block_tables(void* cache, const int64_t* seqs, int64_t n,
+                                               xft_tensor_t* out);
+XFT_EXPORT int xft_paged_kv_cache_context_lens(void* cache, const int64_t* seqs, int64_t n,
+                                               xft_tensor_t* out);
+XFT_EXPORT int xft_paged_kv_cache_key_cache(void* cache, int64_t layer, xft_tensor_t* out);
+XFT_EXPORT int xft_paged_kv_cache_value_cache(void* cache, int64_t layer, xft_tensor_t* out);
+XFT_EXPORT int xft_paged_kv_cache_length(void* cache, int64_t seq, int64_t* out);
+XFT_EXPORT int xft_paged_kv_cache_num_free_blocks(void* cache, int64_t* out);
+
+// Random tensors from the device's default Philox generator. A generator's
+// state is its (seed, offset) pair; manual_seed resets every device's.
+XFT_EXPORT int xft_manual_seed(uint64_t seed);
+XFT_EXPORT int xft_rng_get_state(int32_t device_type, int32_t device_index, uint64_t* seed,
+                                 uint64_t* offset);
+XFT_EXPORT int xft_rng_set_state(int32_t device_type, int32_t device_index, uint64_t seed,
+                                 uint64_t offset);
+XFT_EXPORT int xft_rand(const int64_t* shape, int64_t ndim, int32_t dtype, int32_t device_type,
+                        int32_t device_index, xft_tensor_t* out);
+XFT_EXPORT int xft_randn(const int64_t* shape, int64_t ndim, int32_t dtype, int32_t device_type,
+                         int32_t device_index, xft_tensor_t* out);
+XFT_EXPORT int xft_dropout(xft_tensor_t t, double p, int32_t train, xft_tensor_t* out);
+
+// Size of the CPU worker pool, the calling thread included.
+XFT_EXPORT int xft_set_num_threads(int32_t n);
+XFT_EXPORT int xft_get_num_threads(int32_t* out);
+// Runs an empty parallel_for over [begin, end) and writes the chunks it was
+// split into to bounds[2 * capacity] as (begin, end) pairs, in order, and
+// their number to count.
+XFT_EXPORT int xft_parallel_chunks(int64_t begin, int64_t end, int64_t grain, int64_t* bounds,
+                                   int64_t capacity, int64_t* count);
+// Name of the SIMD kernel set in use ("default", "avx2" or "avx512"). The
+// string is static.
+XFT_EXPORT int xft_cpu_capability(const char** out);
+// Per-shape kernel autotuning (see core/autotune.h). cache_path's string
+// stays valid until the calling thread's next call; "" means no file.
+XFT_EXPORT int xft_autotune_set_enabled(int32_t enabled);
+XFT_EXPORT int xft_autotune_is_enabled(int32_t* out);
+XFT_EXPORT int xft_autotune_set_cache_path(const char* path);
+XFT_EXPORT int xft_autotune_cache_path(const char** out);
+XFT_EXPORT int xft_autotune_clear(int32_t remove_file);
+
+// ---- mixed precision ----
+// Per-thread autocast state for one device type (see core/autocast.h);
+// the dtype must be float16 or bfloat16.
+XFT_EXPORT int xft_autocast_set_enabled(int32_t device_type, int32_t enabled);
+XFT_EXPORT int xft_autocast_is_enabled(int32_t device_type, int32_t* out);
+XFT_EXPORT int xft_autocast_set_dtype(int32_t device_type, int32_t dtype);
+XFT_EXPORT int xft_autocast_get_dtype(int32_t device_type, int32_t* out);
+// Multiplies the n tensors (NULL entries skipped) in place by inv_scale and
+// writes 1 to found_inf if any result is inf or NaN, else 0.
+XFT_EXPORT int xft_amp_unscale_(const xft_tensor_t* tensors, int64_t n, double inv_scale,
+                                int32_t* found_inf);
+
+// ---- optimizers ----
+// Fused steps over n parameters (see ops/optim.h); the arrays are parallel.
+// momentum_buffers may be NULL when momentum is 0. clip_grad_norm_ skips
+// NULL grads and writes their total norm as a new float32 scalar.
+XFT_EXPORT int xft_sgd_step(const xft_tensor_t* params, const xft_tensor_t* grads,
+                            const xft_tensor_t* momentum_buffers, int64_t n, double lr,
+                            double momentum, double dampening, double weight_decay,
+                            int32_t nesterov, int32_t first_step);
+XFT_EXPORT int xft_adam_step(const xft_tensor_t* params, const xft_tensor_t* grads,
+                             const xft_tensor_t* exp_avgs, const xft_tensor_t* exp_avg_sqs,
+                             int64_t n, double lr, double beta1, double beta2, double eps,
+                             double weight_decay, int32_t decoupled_weight_decay, int64_t step);
+XFT_EXPORT int xft_clip_grad_norm_(const xft_tensor_t* grads, int64_t n, double max_norm,
+                                   xft_tensor_t* out);
+
+// ---- lazy mode ----
+// Per-thread switch (see lazy/lazy.h): pointwise ops on floating tensors
+// return pending tensors, computed as one fused kernel on first access.
+XFT_EXPORT int xft_set_lazy_enabled(int32_t enabled);
+XFT_EXPORT int xft_is_lazy_enabled(int32_t* out);
+XFT_EXPORT int xft_tensor_is_lazy(xft_tensor_t t, int32_t* out);
+// Computes a pending tensor; a no-op for any other tensor.
+XFT_EXPORT int xft_tensor_materialize(xft_tensor_t t);
+// Writes up to n counters in lazy::Stats field order: traced_ops,
+// materializations, fused_ops, kernel_compiles, kernel_cache_hits.
+XFT_EXPORT int xft_lazy_stats(int64_t* out, int64_t n);
+XFT_EXPORT int xft_lazy_reset_stats(void);
+// Writes up to n fields of t's memory plan in lazy::PlanStats order: ops,
+// output_bytes, arena_bytes, unplanned_bytes, in_place, scratch_bytes,
+// peak_bytes. Nothing is run.
+XFT_EXPORT int xft_lazy_plan_stats(xft_tensor_t t, int64_t* out, int64_t n);
+// Runs the memory planner (see lazy/memory_plan.h) on n instructions: the
+// result size of each and the instructions producing its operands (-1 for
+// a program input or no operand). Writes each result's arena offset to
+// offsets[n] (-1 for the last) and arena_bytes, unplanned_bytes and
+// in_place to stats[3].
+XFT_EXPORT int xft_lazy_plan_memory(const int64_t* bytes, const int64_t* a, const int64_t* b,
+                                    int64_t n, int64_t alignment, int64_t* offsets,
+                                    int64_t* stats);
+
+// ---- shared memory ----
+// CPU tensors in POSIX shared-memory segments (see core/shared_memory.h).
+// xft_tensor_shared_name writes "" for other tensors; the string is valid
+// until the next call on the same thread.
+XFT_EXPORT int xft_tensor_empty_shared(const int64_t* shape, int64_t ndim, int32_t dtype,
+                                       xft_tensor_t* out);
+XFT_EXPORT int xft_tensor_shared_name(xft_tensor_t t, const char** out);
+XFT_EXPORT int xft_tensor_open_shared(const char* name, const int64_t* shape, int64_t ndim,
+                                      int32_t dtype, int32_t unlink, xft_tensor_t* out);
+XFT_EXPORT int xft_unlink_shared(const char* name);
+
+// ---- serialization ----
+// Flat checkpoint files (see core/serialize.h). xft_save writes the n named
+// tensors to `path`. xft_load reads one back as a state dict, released with
+// xft_state_dict_free(); for the CPU its tensors alias a copy-on-write
+// mapping of the file. Entry names are owned by the state dict, and entry
+// writes a new tensor handle.
+XFT_EXPORT int xft_save(const char* path, const char* const* names, const xft_tensor_t* tensors,
+                        int64_t n);
+XFT_EXPORT int xft_load(const char* path, int32_t device_type, int32_t device_index,
+                        xft_state_dict_t* out);
+XFT_EXPORT int xft_state_dict_size(xft_state_dict_t d, int64_t* out);
+XFT_EXPORT int xft_state_dict_entry(xft_state_dict_t d, int64_t i, const char** name,
+                                    xft_tensor_t* tensor);
+XFT_EXPORT int xft_state_dict_free(xft_state_dict_t d);
+
+// ---- out-of-core streaming ----
+// Chunked access to one tensor of a checkpoint too large to load (see
+// core/streaming.h and ops/streaming.h). chunk_bytes 0 means the default
+// (64 MiB). reader_next writes the next chunk and its first row, or NULL
+// after the last; reader_info writes the dtype code, the rank and up to
+// max_ndim sizes. A writer's file replaces `path` only on close.
+XFT_EXPORT int xft_chunk_reader_create(const char* path, const char* name, int64_t chunk_bytes,
+                                       int32_t device_type, int32_t device_index, void** out);
+XFT_EXPORT int xft_chunk_reader_destroy(void* reader);
+XFT_EXPORT int xft_chunk_reader_info(void* reader, int32_t* dtype, int64_t* ndim, int64_t* shape,
+                                     int64_t max_ndim);
+XFT_EXPORT int xft_chunk_reader_next(void* reader, xft_tensor_t* out, int64_t* row);
+XFT_EXPORT int xft_chunk_writer_create(const char* path, const char* name, const int64_t* shape,
+                                       int64_t ndim, int32_t dtype, void** out);
+XFT_EXPORT int xft_chunk_writer_destroy(void* writer);
+XFT_EXPORT int xft_chunk_writer_write(void* writer, xft_tensor_t rows);
+XFT_EXPORT int xft_chunk_writer_close(void* writer);
+// Streamed reductions, as xft_sum and friends; the result is on the CPU.
+XFT_EXPORT int xft_stream_sum(const char* path, const char* name, int64_t dim, int32_t all_dims,
+                              int32_t keepdim, int64_t chunk_bytes, xft_tensor_t* out);
+XFT_EXPORT int xft_stream_mean(const char* path, const char* name, int64_t dim,
+                               int32_t all_dims, int32_t keepdim, int64_t chunk_bytes,
+                               xft_tensor_t* out);
+XFT_EXPORT int xft_stream_amax(const char* path, const char* name, int64_t dim,
+                               int32_t all_dims, int32_t keepdim, int64_t chunk_bytes,
+                               xft_tensor_t* out);
+// The stored [N, K] matrix times v ([K] or [K, M]), on v's device.
+XFT_EXPORT int xft_stream_matvec(const char* path, const char* name, xft_tensor_t v,
+                                 int64_t chunk_bytes, xft_tensor_t* out);
+
+// ---- profiler ----
+// Op-level profiling sessions (see core/profiler.h). stop returns the
+// recorded events as a profile, released with xft_profile_free(). Event i
+// writes its name (static) and up to n fields in this order: device_type,
+// device_index, thread, depth, start_ns, end_ns, self_ns, cuda_start_ns,
+// cuda_ns, alloc_bytes. Its input shapes come back as a JSON list of
+// lists, owned by the profile.
+XFT_EXPORT int xft_profiler_start(int32_t record_shapes, int32_t cuda_timing);
+XFT_EXPORT int xft_profiler_stop(xft_profile_t* out);
+XFT_EXPORT int xft_profiler_is_enabled(int32_t* out);
+XFT_EXPORT int xft_profile_size(xft_profile_t p, int64_t* out);
+XFT_EXPORT int xft_profile_event(xft_profile_t p, int64_t i, const char** name, int64_t* fields,
+                                 int64_t n);
+XFT_EXPORT int xft_profile_event_shapes(xft_profile_t p, int64_t i, const char** out);
+XFT_EXPORT int xft_profile_export_chrome_trace(xft_profile_t p, const char* path);
+XFT_EXPORT int xft_profile_free(xft_profile_t p);
+
+// ---- distributed ----
+// NCCL process groups and the DistributedDataParallel gradient reducer (see
+// distributed/). Without XFT_USE_NCCL is_available reports 0 and every other
+// call fails. A communicator id is XFT_NCCL_UNIQUE_ID_BYTES opaque bytes that
+// rank 0 makes and sends to the others; create blocks until all ranks join.
+// Collectives are in place and the current stream waits for them. A reducer
+// keeps its process group alive; destroying it removes its hooks from the
+// parameters.
+#define XFT_NCCL_UNIQUE_ID_BYTES 128
+XFT_EXPORT int xft_distributed_is_available(int32_t* out);
+XFT_EXPORT int xft_nccl_unique_id(char* out, int64_t n);
+XFT_EXPORT int xft_process_group_create(const char* id, int64_t id_len, int32_t rank,
+                                        int32_t world_size, int32_t device, void** out);
+XFT_EXPORT int xft_process_group_destroy(void* pg);
+XFT_EXPORT int xft_process_group_all_reduce_(void* pg, xft_tensor_t t, int32_t average);
+XFT_EXPORT int xft_process_group_broadcast_(void* pg, xft_tensor_t t, int32_t root);
+XFT_EXPORT int xft_ddp_create(void* pg, const xft_tensor_t* params, int64_t n,
+                              int64_t bucket_cap_bytes, void** out);
+XFT_EXPORT int xft_ddp_destroy(void* ddp);
+XFT_EXPORT int xft_ddp_set_sync(void* ddp, int32_t enabled);
+XFT_EXPORT int xft_ddp_num_buckets(void* ddp, int64_t* out);
+
+// ---- autograd ----
+// The graph and backward pass run in C++ (csrc/autograd). grad and
+// grad_fn_name write NULL when there is none; the name string is static.
+XFT_EXPORT int xft_tensor_requires_grad(xft_tensor_t t, int32_t* out);
+XFT_EXPORT int xft_tensor_set_requires_grad(xft_tensor_t t, int32_t requires_grad);
+XFT_EXPORT int xft_tensor_is_leaf(xft_tensor_t t, int32_t* out);
+XFT_EXPORT int xft_tensor_grad(xft_tensor_t t, xft_tensor_t* out);
+// A NULL grad clears it.
+XFT_EXPORT int xft_tensor_set_grad(xft_tensor_t t, xft_tensor_t grad);
+XFT_EXPORT int xft_tensor_grad_fn_name(xft_tensor_t t, const char** out);
+XFT_EXPORT int xft_tensor_detach(xft_tensor_t t, xft_tensor_t* out);
+// grad may be NULL for single-element tensors.
+XFT_EXPORT int xft_backward(xft_tensor_t t, xft_tensor_t grad, int32_t retain_graph);
+// Per-thread grad mode.
+XFT_EXPORT int xft_set_grad_enabled(int32_t enabled);
+XFT_EXPORT int xft_is_grad_enabled(int32_t* out);
+// Per-thread inference mode (autograd/grad_mode.h); enabling it also turns
+// grad mode off until it is disabled again.
+XFT_EXPORT int xft_set_inference_mode(int32_t enabled);
+XFT_EXPORT int xft_is_inference_mode_enabled(int32_t* out);
+XFT_EXPORT int xft_tensor_is_inference(xft_tensor_t t, int32_t* out);
+
+// Activation checkpointing (csrc/autograd/checkpoint.h). `fn` runs the
+// segment: it takes ownership of the n_inputs handles (NULL for an absent
+// input), writes at most max_outputs new handles to `outputs` and their
+// count to n_outputs, and returns 0, or -1 on error. It is called once now
+// and again during backward. `release` is called exactly once, when
+// neither can happen any more, so the caller can free `ctx`.
+typedef int (*xft_segment_fn)(void* ctx, xft_tensor_t* inputs, int64_t n_inputs,
+                              xft_tensor_t* outputs, int64_t max_outputs, int64_t* n_outputs);
+typedef void (*xft_release_fn)(void* ctx);
+#define XFT_CHECKPOINT_MAX_OUTPUTS 64
+// Writes the segment's outputs, which carry its backward node, like fn.
+XFT_EXPORT int xft_checkpoint(xft_segment_fn fn, xft_release_fn release, void* ctx,
+                              const xft_tensor_t* inputs, int64_t n_inputs,
+                              xft_tensor_t* outputs, int64_t max_outputs, int64_t* n_outputs);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+#include "api/api_utils.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/caching_allocator.h"
+#include "cuda/cuda_utils.h"
+#include "cuda/host_allocator.h"
+#endif
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+#ifndef XFT_USE_CUDA
+[[noreturn]] void no_cuda() { XFT_FAIL("xft was built without CUDA support (XFT_USE_CUDA=OFF)"); }
+#endif
+
+}  // namespace
+
+extern "C" {
+
+int xft_cuda_is_available(int32_t* out) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  *out = cuda::device_count() > 0 ? 1 : 0;
+#else
+  *out = 0;
+#endif
+  XFT_API_END()
+}
+
+int xft_cuda_device_count(int32_t* out) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  *out = cuda::device_count();
+#else
+  *out = 0;
+#endif
+  XFT_API_END()
+}
+
+int xft_cuda_synchronize(int32_t device) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  cuda::DeviceGuard guard(device);
+  XFT_CUDA_CHECK(cudaDeviceSynchronize());
+#else
+  (void)device;
+  no_cuda();
+#endif
+  XFT_API_END()
+}
+
+int xft_cuda_empty_cache(void) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  cuda::caching_allocator()->empty_cache();
+#else
+  no_cuda();
+#endif
+  XFT_API_END()
+}
+
+int xft_cuda_memory_stats(int32_t device, int64_t* out, int64_t n) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  cuda::MemoryStats stats = cuda::caching_allocator()->stats(device);
+  const auto* fields = reinterpret_cast<const int64_t*>(&stats);
+  for (int64_t i = 0; i < n && i < cuda::kNumMemoryStats; i++) out[i] = fields[i];
+#else
+  (void)device;
+  (void)out;
+  (void)n;
+  no_cuda();
+#endif
+  XFT_API_END()
+}
+
+int xft_cuda_reset_peak_memory_stats(int32_t device) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  cuda::caching_allocator()->reset_peak_stats(device);
+#else
+  (void)device;
+  no_cuda();
+#endif
+  XFT_API_END()
+}
+
+int xft_tensor_pin_memory(xft_tensor_t t, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  *out = wrap(cuda::pin_memory(unwrap(t)));
+#else
+  (void)t;
+  (void)out;
+  no_cuda();
+#endif
+  XFT_API_END()
+}
+
+int xft_tensor_is_pinned(xft_tensor_t t, int32_t* out) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  *out = cuda::is_pinned(unwrap(t)) ? 1 : 0;
+#else
+  (void)t;
+  *out = 0;
+#endif
+  XFT_API_END()
+}
+
+int xft_cuda_host_empty_cache(void) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  cuda::host_allocator()->empty_cache();
+#else
+  no_cuda();
+#endif
+  XFT_API_END()
+}
+
+int xft_cuda_host_memory_stats(int64_t* out, int64_t n) {
+  XFT_API_BEGIN()
+#ifdef XFT_USE_CUDA
+  cuda::HostMemoryStats stats = cuda::host_allocator()->stats();
+  const auto* fields = reinterpret_cast<const int64_t*>(&stats);
+  for (int64_t i = 0; i < n && i < cuda::kNumHostMemoryStats; i++) out[i] = fields[i];
+#else
+  (void)out;
+  (void)n;
+  no_cuda();
+#endif
+  XFT_API_END()
+}
+
+}  // extern "C"
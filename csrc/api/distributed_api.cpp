@@ -0,0 +1,145 @@
+#include "api/api_utils.h"
+
+#ifdef XFT_USE_NCCL
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "distributed/process_group.h"
+#include "distributed/reducer.h"
+#endif
+
+using namespace xft;
+using namespace xft::api;
+
+#ifdef XFT_USE_NCCL
+
+using xft::distributed::ProcessGroupNCCL;
+using xft::distributed::Reducer;
+
+namespace {
+
+// Handles own a reference, so a reducer can outlive the handle it was
+// created from.
+std::shared_ptr<ProcessGroupNCCL>& as_group(void* pg) {
+  XFT_CHECK(pg != nullptr, "null process group handle");
+  return *static_cast<std::shared_ptr<ProcessGroupNCCL>*>(pg);
+}
+
+Reducer& as_reducer(void* ddp) {
+  XFT_CHECK(ddp != nullptr, "null DistributedDataParallel handle");
+  return *static_cast<Reducer*>(ddp);
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_distributed_is_available(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = 1;
+  XFT_API_END()
+}
+
+int xft_nccl_unique_id(char* out, int64_t n) {
+  XFT_API_BEGIN()
+  XFT_CHECK(n >= XFT_NCCL_UNIQUE_ID_BYTES, "nccl_unique_id: the buffer needs ",
+            XFT_NCCL_UNIQUE_ID_BYTES, " bytes, got ", n);
+  const std::string id = ProcessGroupNCCL::unique_id();
+  id.copy(out, id.size());
+  XFT_API_END()
+}
+
+int xft_process_group_create(const char* id, int64_t id_len, int32_t rank, int32_t world_size,
+                             int32_t device, void** out) {
+  XFT_API_BEGIN()
+  auto group = std::make_shared<ProcessGroupNCCL>(std::string(id, static_cast<size_t>(id_len)),
+                                                  rank, world_size, device);
+  *out = new std::shared_ptr<ProcessGroupNCCL>(std::move(group));
+  XFT_API_END()
+}
+
+int xft_process_group_destroy(void* pg) {
+  XFT_API_BEGIN()
+  delete static_cast<std::shared_ptr<ProcessGroupNCCL>*>(pg);
+  XFT_API_END()
+}
+
+int xft_process_group_all_reduce_(void* pg, xft_tensor_t t, int32_t average) {
+  XFT_API_BEGIN()
+  as_group(pg)->all_reduce_(unwrap(t), average != 0);
+  XFT_API_END()
+}
+
+int xft_process_group_broadcast_(void* pg, xft_tensor_t t, int32_t root) {
+  XFT_API_BEGIN()
+  as_group(pg)->broadcast_(unwrap(t), root);
+  XFT_API_END()
+}
+
+int xft_ddp_create(void* pg, const xft_tensor_t* params, int64_t n, int64_t bucket_cap_bytes,
+                   void** out) {
+  XFT_API_BEGIN()
+  std::vector<Tensor> list;
+  list.reserve(n);
+  for (int64_t i = 0; i < n; i++) list.push_back(unwrap(params[i]));
+  *out = new Reducer(as_group(pg), std::move(list), bucket_cap_bytes);
+  XFT_API_END()
+}
+
+int xft_ddp_destroy(void* ddp) {
+  XFT_API_BEGIN()
+  delete static_cast<Reducer*>(ddp);
+  XFT_API_END()
+}
+
+int xft_ddp_set_sync(void* ddp, int32_t enabled) {
+  XFT_API_BEGIN()
+  as_reducer(ddp).set_sync(enabled != 0);
+  XFT_API_END()
+}
+
+int xft_ddp_num_buckets(void* ddp, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = static_cast<int64_t>(as_reducer(ddp).num_buckets());
+  XFT_API_END()
+}
+
+}  // extern "C"
+
+#else  // !XFT_USE_NCCL
+
+namespace {
+
+int unavailable() {
+  set_last_error("xft was built without NCCL support (XFT_USE_NCCL=OFF)");
+  return -1;
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_distributed_is_available(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = 0;
+  XFT_API_END()
+}
+
+int xft_nccl_unique_id(char*, int64_t) { return unavailable(); }
+int xft_process_group_create(const char*, int64_t, int32_t, int32_t, int32_t, void**) {
+  return unavailable();
+}
+int xft_process_group_destroy(void*) { return unavailable(); }
+int xft_process_group_all_reduce_(void*, xft_tensor_t, int32_t) { return unavailable(); }
+int xft_process_group_broadcast_(void*, xft_tensor_t, int32_t) { return unavailable(); }
+int xft_ddp_create(void*, const xft_tensor_t*, int64_t, int64_t, void**) {
+  return unavailable();
+}
+int xft_ddp_destroy(void*) { return unavailable(); }
+int xft_ddp_set_sync(void*, int32_t) { return unavailable(); }
+int xft_ddp_num_buckets(void*, int64_t*) { return unavailable(); }
+
+}  // extern "C"
+
+#endif  // XFT_USE_NCCL
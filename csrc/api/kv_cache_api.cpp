@@ -0,0 +1,103 @@
+#include <vector>
+
+#include "api/api_utils.h"
+#include "ops/paged_attention.h"
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+PagedKVCache& as_cache(void* cache) {
+  XFT_CHECK(cache != nullptr, "null PagedKVCache handle");
+  return *static_cast<PagedKVCache*>(cache);
+}
+
+std::vector<int64_t> to_vector(const int64_t* data, int64_t n) {
+  return n > 0 ? std::vector<int64_t>(data, data + n) : std::vector<int64_t>();
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_paged_kv_cache_create(int64_t num_layers, int64_t num_blocks, int64_t block_size,
+                              int64_t num_heads, int64_t head_dim, int32_t dtype,
+                              int32_t device_type, int32_t device_index, void** out) {
+  XFT_API_BEGIN()
+  *out = new PagedKVCache(num_layers, num_blocks, block_size, num_heads, head_dim,
+                          static_cast<DType>(dtype), to_device(device_type, device_index));
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_destroy(void* cache) {
+  XFT_API_BEGIN()
+  delete static_cast<PagedKVCache*>(cache);
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_add_sequence(void* cache, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = as_cache(cache).add_sequence();
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_remove_sequence(void* cache, int64_t seq) {
+  XFT_API_BEGIN()
+  as_cache(cache).remove_sequence(seq);
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_append_slots(void* cache, const int64_t* seqs, const int64_t* num_tokens,
+                                    int64_t n, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(as_cache(cache).append_slots(to_vector(seqs, n), to_vector(num_tokens, n)));
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_store(void* cache, int64_t layer, xft_tensor_t slots, xft_tensor_t k,
+                             xft_tensor_t v) {
+  XFT_API_BEGIN()
+  as_cache(cache).store(layer, unwrap(slots), unwrap(k), unwrap(v));
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_block_tables(void* cache, const int64_t* seqs, int64_t n,
+                                    xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(as_cache(cache).block_tables(to_vector(seqs, n)));
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_context_lens(void* cache, const int64_t* seqs, int64_t n,
+                                    xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(as_cache(cache).context_lens(to_vector(seqs, n)));
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_key_cache(void* cache, int64_t layer, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(as_cache(cache).key_cache(layer));
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_value_cache(void* cache, int64_t layer, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(as_cache(cache).value_cache(layer));
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_length(void* cache, int64_t seq, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = as_cache(cache).length(seq);
+  XFT_API_END()
+}
+
+int xft_paged_kv_cache_num_free_blocks(void* cache, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = as_cache(cache).num_free_blocks();
+  XFT_API_END()
+}
+
+}  // extern "C"
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <vector>
+
+#include "api/api_utils.h"
+#include "lazy/lazy.h"
+#include "lazy/memory_plan.h"
+
+using namespace xft;
+using namespace xft::api;
+
+extern "C" {
+
+int xft_set_lazy_enabled(int32_t enabled) {
+  XFT_API_BEGIN()
+  lazy::LazyMode::set_enabled(enabled != 0);
+  XFT_API_END()
+}
+
+int xft_is_lazy_enabled(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = lazy::LazyMode::is_enabled() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_tensor_is_lazy(xft_tensor_t t, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).is_lazy() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_tensor_materialize(xft_tensor_t t) {
+  XFT_API_BEGIN()
+  unwrap(t).materialize();
+  XFT_API_END()
+}
+
+int xft_lazy_stats(int64_t* out, int64_t n) {
+  XFT_API_BEGIN()
+  lazy::Stats stats = lazy::stats();
+  const auto* fields = reinterpret_cast<const int64_t*>(&stats);
+  for (int64_t i = 0; i < n && i < lazy::kNumStats; i++) out[i] = fields[i];
+  XFT_API_END()
+}
+
+int xft_lazy_reset_stats() {
+  XFT_API_BEGIN()
+  lazy::reset_stats();
+  XFT_API_END()
+}
+
+int xft_lazy_plan_stats(xft_tensor_t t, int64_t* out, int64_t n) {
+  XFT_API_BEGIN()
+  lazy::PlanStats stats = lazy::plan_stats(unwrap(t));
+  const auto* fields = reinterpret_cast<const int64_t*>(&stats);
+  for (int64_t i = 0; i < n && i < lazy::kNumPlanStats; i++) out[i] = fields[i];
+  XFT_API_END()
+}
+
+int xft_lazy_plan_memory(const int64_t* bytes, const int64_t* a, const int64_t* b, int64_t n,
+                         int64_t alignment, int64_t* offsets, int64_t* stats) {
+  XFT_API_BEGIN()
+  XFT_CHECK(alignment > 0, "plan_memory: alignment must be positive, got ", alignment);
+  std::vector<lazy::PlanNode> nodes(static_cast<size_t>(n));
+  for (int64_t i = 0; i < n; i++) {
+    XFT_CHECK(bytes[i] >= 0, "plan_memory: instruction ", i, " has negative size");
+    XFT_CHECK(a[i] >= -1 && a[i] < i && b[i] >= -1 && b[i] < i, "plan_memory: instruction ",
+              i, " must take its operands from earlier instructions");
+    nodes[i] = {bytes[i], static_cast<int>(a[i]), static_cast<int>(b[i])};
+  }
+  const lazy::MemoryPlan plan = lazy::plan_memory(nodes, alignment);
+  std::copy(plan.offsets.begin(), plan.offsets.end(), offsets);
+  stats[0] = plan.arena_bytes;
+  stats[1] = plan.unplanned_bytes;
+  stats[2] = plan.in_place;
+  XFT_API_END()
+}
+
+}  // extern "C"
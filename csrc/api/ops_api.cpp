@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "api/api_utils.h"
+#include "core/autotune.h"
+#include "core/parallel.h"
+#include "cpu/kernels.h"
+#include "ops/attention.h"
+#include "ops/conv.h"
+#include "ops/paged_attention.h"
+#include "ops/elementwise.h"
+#include "ops/fused.h"
+#include "ops/matmul.h"
+#include "ops/quantized.h"
+#include "ops/random.h"
+#include "ops/reduce.h"
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+// The 0-d operand a Python scalar stands for in the *_scalar ops.
+Tensor scalar_like(double value, const Tensor& t, const char* name) {
+  XFT_CHECK(is_floating(t.dtype()) || std::nearbyint(value) == value, name, ": scalar ", value,
+            " is not representable as ", dtype_name(t.dtype()));
+  Tensor s = Tensor::empty({}, t.dtype(), t.device());
+  s.fill_(value);
+  return s;
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_matmul(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(matmul(unwrap(a), unwrap(b)));
+  XFT_API_END()
+}
+
+int xft_mm(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(mm(unwrap(a), unwrap(b)));
+  XFT_API_END()
+}
+
+int xft_bmm(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(bmm(unwrap(a), unwrap(b)));
+  XFT_API_END()
+}
+
+#define XFT_BINARY_API(name)                                             \
+  int xft_##name(xft_tensor_t a, xft_tensor_t b, xft_tensor_t* out) {    \
+    XFT_API_BEGIN()                                                      \
+    *out = wrap(name(unwrap(a), unwrap(b)));                             \
+    XFT_API_END()                                                        \
+  }
+
+#define XFT_BINARY_SCALAR_API(name)                                                    \
+  int xft_##name##_scalar(xft_tensor_t t, double value, int32_t reverse,               \
+                          xft_tensor_t* out) {                                         \
+    XFT_API_BEGIN()                                                                    \
+    const Tensor& a = unwrap(t);                                                       \
+    const Tensor s = scalar_like(value, a, #name);                                     \
+    *out = wrap(reverse != 0 ? name(s, a) : name(a, s));                               \
+    XFT_API_END()                                                                      \
+  }
+
+#define XFT_UNARY_API(name)                            \
+  int xft_##name(xft_tensor_t t, xft_tensor_t* out) { \
+    XFT_API_BEGIN()                                    \
+    *out = wrap(name(unwrap(t)));                      \
+    XFT_API_END()                                      \
+  }
+
+#define XFT_BINARY_OUT_API(name)                                         \
+  int xft_##name##_out(xft_tensor_t a, xft_tensor_t b, xft_tensor_t out) { \
+    XFT_API_BEGIN()                                                        \
+    name##_out(unwrap(out), unwrap(a), unwrap(b));                         \
+    XFT_API_END()                                                          \
+  }
+
+#define XFT_BINARY_SCALAR_OUT_API(name)                                                \
+  int xft_##name##_scalar_out(xft_tensor_t t, double value, int32_t reverse,           \
+                              xft_tensor_t out) {                                      \
+    XFT_API_BEGIN()                                                                    \
+    const Tensor& a = unwrap(t);                                                       \
+    const Tensor s = scalar_like(value, a, #name);                                     \
+    if (reverse != 0) {                                                                \
+      name##_out(unwrap(out), s, a);                                                   \
+    } else {                                                                           \
+      name##_out(unwrap(out), a, s);                                                   \
+    }                                                                                  \
+    XFT_API_END()                                                                      \
+  }
+
+#define XFT_UNARY_OUT_API(name)                                  \
+  int xft_##name##_out(xft_tensor_t t, xft_tensor_t out) {       \
+    XFT_API_BEGIN()                                              \
+    name##_out(unwrap(out), unwrap(t));                          \
+    XFT_API_END()                                                \
+  }
+
+#define XFT_REDUCE_API(name)                                                               \
+  int xft_##name(xft_tensor_t t, int64_t dim, int32_t all_dims, int32_t keepdim,          \
+                 xft_tensor_t* out) {                                                      \
+    XFT_API_BEGIN()                                                                        \
+    *out = wrap(all_dims ? name(unwrap(t)) : name(unwrap(t), dim, keepdim != 0));          \
+    XFT_API_END()                                                                          \
+  }
+
+XFT_BINARY_API(add)
+XFT_BINARY_API(sub)
+XFT_BINARY_API(mul)
+XFT_BINARY_API(div)
+XFT_BINARY_API(maximum)
+XFT_BINARY_API(minimum)
+XFT_BINARY_SCALAR_API(add)
+XFT_BINARY_SCALAR_API(sub)
+XFT_BINARY_SCALAR_API(mul)
+XFT_BINARY_SCALAR_API(div)
+XFT_BINARY_SCALAR_API(maximum)
+XFT_BINARY_SCALAR_API(minimum)
+
+XFT_UNARY_API(exp)
+XFT_UNARY_API(log)
+XFT_UNARY_API(sqrt)
+XFT_UNARY_API(tanh)
+XFT_UNARY_API(sigmoid)
+XFT_UNARY_API(relu)
+XFT_UNARY_API(gelu)
+
+XFT_BINARY_OUT_API(add)
+XFT_BINARY_OUT_API(sub)
+XFT_BINARY_OUT_API(mul)
+XFT_BINARY_OUT_API(div)
+XFT_BINARY_OUT_API(maximum)
+XFT_BINARY_OUT_API(minimum)
+XFT_BINARY_SCALAR_OUT_API(add)
+XFT_BINARY_SCALAR_OUT_API(sub)
+XFT_BINARY_SCALAR_OUT_API(mul)
+XFT_BINARY_SCALAR_OUT_API(div)
+XFT_BINARY_SCALAR_OUT_API(maximum)
+XFT_BINARY_SCALAR_OUT_API(minimum)
+
+XFT_UNARY_OUT_API(exp)
+XFT_UNARY_OUT_API(log)
+XFT_UNARY_OUT_API(sqrt)
+XFT_UNARY_OUT_API(tanh)
+XFT_UNARY_OUT_API(sigmoid)
+XFT_UNARY_OUT_API(relu)
+XFT_UNARY_OUT_API(gelu)
+
+XFT_REDUCE_API(sum)
+XFT_REDUCE_API(mean)
+XFT_REDUCE_API(amax)
+
+int xft_softmax(xft_tensor_t t, int64_t dim, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(softmax(unwrap(t), dim));
+  XFT_API_END()
+}
+
+int xft_layer_norm(xft_tensor_t x, xft_tensor_t weight, xft_tensor_t bias, double eps,
+                   xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(layer_norm(unwrap(x), unwrap_optional(weight), unwrap_optional(bias), eps));
+  XFT_API_END()
+}
+
+int xft_rms_norm(xft_tensor_t x, xft_tensor_t weight, double eps, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(rms_norm(unwrap(x), unwrap_optional(weight), eps));
+  XFT_API_END()
+}
+
+int xft_bias_gelu(xft_tensor_t x, xft_tensor_t bias, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(bias_gelu(unwrap(x), unwrap(bias)));
+  XFT_API_END()
+}
+
+int xft_bias_dropout_residual(xft_tensor_t x, xft_tensor_t bias, xft_tensor_t residual, double p,
+                              int32_t train, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(
+      bias_dropout_residual(unwrap(x), unwrap_optional(bias), unwrap(residual), p, train != 0));
+  XFT_API_END()
+}
+
+int xft_scaled_dot_product_attention(xft_tensor_t q, xft_tensor_t k, xft_tensor_t v,
+                                     int32_t is_causal, double scale, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  const std::optional<double> s = scale != 0.0 ? std::optional<double>(scale) : std::nullopt;
+  *out = wrap(scaled_dot_product_attention(unwrap(q), unwrap(k), unwrap(v), is_causal != 0, s));
+  XFT_API_END()
+}
+
+int xft_conv2d(xft_tensor_t x, xft_tensor_t weight, xft_tensor_t bias, int64_t stride_h,
+               int64_t stride_w, int64_t pad_h, int64_t pad_w, int64_t dilation_h,
+               int64_t dilation_w, int64_t groups, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  Conv2dParams p;
+  p.stride = {stride_h, stride_w};
+  p.padding = {pad_h, pad_w};
+  p.dilation = {dilation_h, dilation_w};
+  p.groups = groups;
+  *out = wrap(conv2d(unwrap(x), unwrap(weight), unwrap_optional(bias), p));
+  XFT_API_END()
+}
+
+int xft_quantize_weight(xft_tensor_t weight, int32_t bits, int64_t group_size,
+                        xft_tensor_t* data, xft_tensor_t* scales) {
+  XFT_API_BEGIN()
+  QuantizedWeight q = quantize_weight(unwrap(weight), bits, group_size);
+  *data = wrap(std::move(q.data));
+  *scales = wrap(std::move(q.scales));
+  XFT_API_END()
+}
+
+int xft_dequantize_weight(xft_tensor_t data, xft_tensor_t scales, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(dequantize_weight({unwrap(data), unwrap(scales)}));
+  XFT_API_END()
+}
+
+int xft_quantized_linear(xft_tensor_t x, xft_tensor_t data, xft_tensor_t scales,
+                         xft_tensor_t bias, int32_t dynamic, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(quantized_linear(unwrap(x), {unwrap(data), unwrap(scales)}, unwrap_optional(bias),
+                               dynamic != 0));
+  XFT_API_END()
+}
+
+int xft_paged_attention(xft_tensor_t q, xft_tensor_t key_cache, xft_tensor_t value_cache,
+                        xft_tensor_t block_tables, xft_tensor_t context_lens, double scale,
+                        xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  const std::optional<double> s = scale != 0.0 ? std::optional<double>(scale) : std::nullopt;
+  *out = wrap(paged_attention(unwrap(q), unwrap(key_cache), unwrap(value_cache),
+                              unwrap(block_tables), unwrap(context_lens), s));
+  XFT_API_END()
+}
+
+int xft_manual_seed(uint64_t seed) {
+  XFT_API_BEGIN()
+  manual_seed(seed);
+  XFT_API_END()
+}
+
+int xft_rng_get_state(int32_t device_type, int32_t device_index, uint64_t* seed,
+                      uint64_t* offset) {
+  XFT_API_BEGIN()
+  const GeneratorState state = default_generator(to_device(device_type, device_index)).state();
+  *seed = state.seed;
+  *offset = state.offset;
+  XFT_API_END()
+}
+
+int xft_rng_set_state(int32_t device_type, int32_t device_index, uint64_t seed,
+                      uint64_t offset) {
+  XFT_API_BEGIN()
+  default_generator(to_device(device_type, device_index)).set_state({seed, offset});
+  XFT_API_END()
+}
+
+int xft_rand(const int64_t* shape, int64_t ndim, int32_t dtype, int32_t device_type,
+             int32_t device_index, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(rand(to_shape(shape, ndim), static_cast<DType>(dtype),
+                   to_device(device_type, device_index)));
+  XFT_API_END()
+}
+
+int xft_randn(const int64_t* shape, int64_t ndim, int32_t dtype, int32_t device_type,
+              int32_t device_index, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(randn(to_shape(shape, ndim), static_cast<DType>(dtype),
+                    to_device(device_type, device_index)));
+  XFT_API_END()
+}
+
+int xft_dropout(xft_tensor_t t, double p, int32_t train, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(dropout(unwrap(t), p, train != 0));
+  XFT_API_END()
+}
+
+int xft_set_num_threads(int32_t n) {
+  XFT_API_BEGIN()
+  set_num_threads(n);
+  XFT_API_END()
+}
+
+int xft_get_num_threads(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = get_num_threads();
+  XFT_API_END()
+}
+
+int xft_parallel_chunks(int64_t begin, int64_t end, int64_t grain, int64_t* bounds,
+                        int64_t capacity, int64_t* count) {
+  XFT_API_BEGIN()
+  std::mutex mutex;
+  std::vector<std::pair<int64_t, int64_t>> chunks;
+  parallel_for(begin, end, grain, [&](int64_t lo, int64_t hi) {
+    std::lock_guard<std::mutex> lock(mutex);
+    chunks.emplace_back(lo, hi);
+  });
+  XFT_CHECK(static_cast<int64_t>(chunks.size()) <= capacity, "parallel_chunks: ",
+            chunks.size(), " chunks do not fit in ", capacity);
+  std::sort(chunks.begin(), chunks.end());
+  for (size_t i = 0; i < chunks.size(); i++) {
+    bounds[2 * i] = chunks[i].first;
+    bounds[2 * i + 1] = chunks[i].second;
+  }
+  *count = static_cast<int64_t>(chunks.size());
+  XFT_API_END()
+}
+
+int xft_cpu_capability(const char** out) {
+  XFT_API_BEGIN()
+  *out = cpu::capability_name(cpu::cpu_capability());
+  XFT_API_END()
+}
+
+int xft_autotune_set_enabled(int32_t enabled) {
+  XFT_API_BEGIN()
+  autotune::set_enabled(enabled != 0);
+  XFT_API_END()
+}
+
+int xft_autotune_is_enabled(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = autotune::enabled() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_autotune_set_cache_path(const char* path) {
+  XFT_API_BEGIN()
+  autotune::set_cache_path(path != nullptr ? path : "");
+  XFT_API_END()
+}
+
+int xft_autotune_cache_path(const char** out) {
+  XFT_API_BEGIN()
+  thread_local std::string path;
+  path = autotune::cache_path();
+  *out = path.c_str();
+  XFT_API_END()
+}
+
+int xft_autotune_clear(int32_t remove_file) {
+  XFT_API_BEGIN()
+  autotune::clear(remove_file != 0);
+  XFT_API_END()
+}
+
+}  // extern "C"
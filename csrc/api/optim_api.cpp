@@ -0,0 +1,62 @@
+#include <vector>
+
+#include "api/api_utils.h"
+#include "ops/optim.h"
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+std::vector<Tensor> unwrap_list(const xft_tensor_t* tensors, int64_t n) {
+  std::vector<Tensor> out;
+  out.reserve(n);
+  for (int64_t i = 0; i < n; i++) out.push_back(unwrap_optional(tensors[i]));
+  return out;
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_sgd_step(const xft_tensor_t* params, const xft_tensor_t* grads,
+                 const xft_tensor_t* momentum_buffers, int64_t n, double lr, double momentum,
+                 double dampening, double weight_decay, int32_t nesterov, int32_t first_step) {
+  XFT_API_BEGIN()
+  SGDOptions options;
+  options.lr = lr;
+  options.momentum = momentum;
+  options.dampening = dampening;
+  options.weight_decay = weight_decay;
+  options.nesterov = nesterov != 0;
+  const std::vector<Tensor> bufs =
+      momentum_buffers != nullptr ? unwrap_list(momentum_buffers, n) : std::vector<Tensor>();
+  sgd_step(unwrap_list(params, n), unwrap_list(grads, n), bufs, options, first_step != 0);
+  XFT_API_END()
+}
+
+int xft_adam_step(const xft_tensor_t* params, const xft_tensor_t* grads,
+                  const xft_tensor_t* exp_avgs, const xft_tensor_t* exp_avg_sqs, int64_t n,
+                  double lr, double beta1, double beta2, double eps, double weight_decay,
+                  int32_t decoupled_weight_decay, int64_t step) {
+  XFT_API_BEGIN()
+  AdamOptions options;
+  options.lr = lr;
+  options.beta1 = beta1;
+  options.beta2 = beta2;
+  options.eps = eps;
+  options.weight_decay = weight_decay;
+  options.decoupled_weight_decay = decoupled_weight_decay != 0;
+  adam_step(unwrap_list(params, n), unwrap_list(grads, n), unwrap_list(exp_avgs, n),
+            unwrap_list(exp_avg_sqs, n), options, step);
+  XFT_API_END()
+}
+
+int xft_clip_grad_norm_(const xft_tensor_t* grads, int64_t n, double max_norm,
+                        xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(clip_grad_norm_(unwrap_list(grads, n), max_norm));
+  XFT_API_END()
+}
+
+}  // extern "C"
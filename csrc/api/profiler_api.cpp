@@ -0,0 +1,122 @@
+#include "api/api_utils.h"
+
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/profiler.h"
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+struct Profile {
+  std::vector<profiler::Event> events;
+  std::vector<std::string> shapes;  // JSON, made on first request
+};
+
+Profile& unwrap_profile(xft_profile_t p) {
+  XFT_CHECK(p != nullptr, "null profile handle");
+  return *reinterpret_cast<Profile*>(p);
+}
+
+const profiler::Event& event_at(const Profile& profile, int64_t i) {
+  XFT_CHECK(i >= 0 && i < static_cast<int64_t>(profile.events.size()), "profile event index ",
+            i, " out of range");
+  return profile.events[i];
+}
+
+std::string shapes_json(const std::vector<Shape>& shapes) {
+  std::ostringstream os;
+  os << '[';
+  for (size_t i = 0; i < shapes.size(); i++) {
+    os << (i ? ", [" : "[");
+    for (size_t d = 0; d < shapes[i].size(); d++) os << (d ? ", " : "") << shapes[i][d];
+    os << ']';
+  }
+  os << ']';
+  return os.str();
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_profiler_start(int32_t record_shapes, int32_t cuda_timing) {
+  XFT_API_BEGIN()
+  profiler::Options options;
+  options.record_shapes = record_shapes != 0;
+  options.cuda_timing = cuda_timing != 0;
+  profiler::start(options);
+  XFT_API_END()
+}
+
+int xft_profiler_stop(xft_profile_t* out) {
+  XFT_API_BEGIN()
+  auto profile = std::make_unique<Profile>();
+  profile->events = profiler::stop();
+  *out = reinterpret_cast<xft_profile_t>(profile.release());
+  XFT_API_END()
+}
+
+int xft_profiler_is_enabled(int32_t* out) {
+  XFT_API_BEGIN()
+  *out = profiler::is_enabled() ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_profile_size(xft_profile_t p, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = static_cast<int64_t>(unwrap_profile(p).events.size());
+  XFT_API_END()
+}
+
+int xft_profile_event(xft_profile_t p, int64_t i, const char** name, int64_t* fields,
+                      int64_t n) {
+  XFT_API_BEGIN()
+  const profiler::Event& ev = event_at(unwrap_profile(p), i);
+  *name = ev.name;
+  const int64_t values[] = {static_cast<int64_t>(ev.device.type),
+                            ev.device.index,
+                            static_cast<int64_t>(ev.thread),
+                            ev.depth,
+                            ev.start_ns,
+                            ev.end_ns,
+                            ev.self_ns,
+                            ev.cuda_start_ns,
+                            ev.cuda_ns,
+                            ev.alloc_bytes};
+  for (int64_t k = 0; k < n && k < static_cast<int64_t>(std::size(values)); k++) {
+    fields[k] = values[k];
+  }
+  XFT_API_END()
+}
+
+int xft_profile_event_shapes(xft_profile_t p, int64_t i, const char** out) {
+  XFT_API_BEGIN()
+  Profile& profile = unwrap_profile(p);
+  const profiler::Event& ev = event_at(profile, i);
+  if (profile.shapes.empty()) profile.shapes.resize(profile.events.size());
+  std::string& s = profile.shapes[i];
+  if (s.empty()) s = shapes_json(ev.shapes);
+  *out = s.c_str();
+  XFT_API_END()
+}
+
+int xft_profile_export_chrome_trace(xft_profile_t p, const char* path) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr, "export_chrome_trace: null path");
+  profiler::export_chrome_trace(unwrap_profile(p).events, path);
+  XFT_API_END()
+}
+
+int xft_profile_free(xft_profile_t p) {
+  XFT_API_BEGIN()
+  delete reinterpret_cast<Profile*>(p);
+  XFT_API_END()
+}
+
+}  // extern "C"
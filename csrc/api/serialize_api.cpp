@@ -0,0 +1,64 @@
+#include "api/api_utils.h"
+
+#include <memory>
+
+#include "core/serialize.h"
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+NamedTensors& unwrap_dict(xft_state_dict_t d) {
+  XFT_CHECK(d != nullptr, "null state dict handle");
+  return *reinterpret_cast<NamedTensors*>(d);
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_save(const char* path, const char* const* names, const xft_tensor_t* tensors,
+             int64_t n) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr, "save: null path");
+  NamedTensors entries;
+  entries.reserve(n);
+  for (int64_t i = 0; i < n; i++) entries.emplace_back(names[i], unwrap(tensors[i]));
+  save(entries, path);
+  XFT_API_END()
+}
+
+int xft_load(const char* path, int32_t device_type, int32_t device_index,
+             xft_state_dict_t* out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr, "load: null path");
+  auto dict = std::make_unique<NamedTensors>(load(path, to_device(device_type, device_index)));
+  *out = reinterpret_cast<xft_state_dict_t>(dict.release());
+  XFT_API_END()
+}
+
+int xft_state_dict_size(xft_state_dict_t d, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = static_cast<int64_t>(unwrap_dict(d).size());
+  XFT_API_END()
+}
+
+int xft_state_dict_entry(xft_state_dict_t d, int64_t i, const char** name,
+                         xft_tensor_t* tensor) {
+  XFT_API_BEGIN()
+  NamedTensors& dict = unwrap_dict(d);
+  XFT_CHECK(i >= 0 && i < static_cast<int64_t>(dict.size()), "state dict index ", i,
+            " out of range");
+  *name = dict[i].first.c_str();
+  *tensor = wrap(dict[i].second);
+  XFT_API_END()
+}
+
+int xft_state_dict_free(xft_state_dict_t d) {
+  XFT_API_BEGIN()
+  delete reinterpret_cast<NamedTensors*>(d);
+  XFT_API_END()
+}
+
+}  // extern "C"
@@ -0,0 +1,39 @@
+#include "api/api_utils.h"
+#include "core/shared_memory.h"
+
+using namespace xft;
+using namespace xft::api;
+
+extern "C" {
+
+int xft_tensor_empty_shared(const int64_t* shape, int64_t ndim, int32_t dtype,
+                            xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(empty_shared(to_shape(shape, ndim), static_cast<DType>(dtype)));
+  XFT_API_END()
+}
+
+int xft_tensor_shared_name(xft_tensor_t t, const char** out) {
+  XFT_API_BEGIN()
+  thread_local std::string name;
+  name = shared_memory_name(unwrap(t));
+  *out = name.c_str();
+  XFT_API_END()
+}
+
+int xft_tensor_open_shared(const char* name, const int64_t* shape, int64_t ndim, int32_t dtype,
+                           int32_t unlink, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(name != nullptr, "open_shared: null name");
+  *out = wrap(open_shared(name, to_shape(shape, ndim), static_cast<DType>(dtype), unlink != 0));
+  XFT_API_END()
+}
+
+int xft_unlink_shared(const char* name) {
+  XFT_API_BEGIN()
+  XFT_CHECK(name != nullptr, "unlink_shared: null name");
+  unlink_shared(name);
+  XFT_API_END()
+}
+
+}  // extern "C"
@@ -0,0 +1,214 @@
+#include "api/api_utils.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/caching_allocator.h"
+#include "cuda/cuda_utils.h"
+#include "cuda/graph.h"
+#include "cuda/stream.h"
+#endif
+
+using namespace xft;
+using namespace xft::api;
+
+#ifdef XFT_USE_CUDA
+
+namespace {
+
+cudaStream_t as_stream(void* s) { return static_cast<cudaStream_t>(s); }
+cudaEvent_t as_event(void* e) { return static_cast<cudaEvent_t>(e); }
+cuda::CUDAGraph* as_graph(void* g) { return static_cast<cuda::CUDAGraph*>(g); }
+
+// cudaErrorNotReady is an answer, not a failure.
+int32_t query_done(cudaError_t err) {
+  if (err == cudaErrorNotReady) {
+    cudaGetLastError();
+    return 0;
+  }
+  XFT_CUDA_CHECK(err);
+  return 1;
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_cuda_stream_create(int32_t device, int32_t priority, void** out) {
+  XFT_API_BEGIN()
+  *out = cuda::create_stream(device, priority);
+  XFT_API_END()
+}
+
+int xft_cuda_stream_destroy(void* stream) {
+  XFT_API_BEGIN()
+  cuda::destroy_stream(as_stream(stream));
+  XFT_API_END()
+}
+
+int xft_cuda_current_stream(int32_t device, void** out) {
+  XFT_API_BEGIN()
+  *out = cuda::current_stream(device);
+  XFT_API_END()
+}
+
+int xft_cuda_set_current_stream(int32_t device, void* stream) {
+  XFT_API_BEGIN()
+  cuda::set_current_stream(device, as_stream(stream));
+  XFT_API_END()
+}
+
+int xft_cuda_stream_synchronize(void* stream) {
+  XFT_API_BEGIN()
+  XFT_CUDA_CHECK(cudaStreamSynchronize(as_stream(stream)));
+  XFT_API_END()
+}
+
+int xft_cuda_stream_query(void* stream, int32_t* done) {
+  XFT_API_BEGIN()
+  *done = query_done(cudaStreamQuery(as_stream(stream)));
+  XFT_API_END()
+}
+
+int xft_cuda_stream_wait_event(void* stream, void* event) {
+  XFT_API_BEGIN()
+  XFT_CUDA_CHECK(cudaStreamWaitEvent(as_stream(stream), as_event(event), 0));
+  XFT_API_END()
+}
+
+int xft_cuda_event_create(int32_t device, int32_t enable_timing, void** out) {
+  XFT_API_BEGIN()
+  cuda::DeviceGuard guard(device);
+  cudaEvent_t event;
+  XFT_CUDA_CHECK(
+      cudaEventCreateWithFlags(&event, enable_timing ? cudaEventDefault : cudaEventDisableTiming));
+  *out = event;
+  XFT_API_END()
+}
+
+int xft_cuda_event_destroy(void* event) {
+  XFT_API_BEGIN()
+  XFT_CUDA_CHECK(cudaEventDestroy(as_event(event)));
+  XFT_API_END()
+}
+
+int xft_cuda_event_record(void* event, void* stream) {
+  XFT_API_BEGIN()
+  XFT_CUDA_CHECK(cudaEventRecord(as_event(event), as_stream(stream)));
+  XFT_API_END()
+}
+
+int xft_cuda_event_synchronize(void* event) {
+  XFT_API_BEGIN()
+  XFT_CUDA_CHECK(cudaEventSynchronize(as_event(event)));
+  XFT_API_END()
+}
+
+int xft_cuda_event_query(void* event, int32_t* done) {
+  XFT_API_BEGIN()
+  *done = query_done(cudaEventQuery(as_event(event)));
+  XFT_API_END()
+}
+
+int xft_cuda_event_elapsed_time(void* start, void* end, float* ms) {
+  XFT_API_BEGIN()
+  XFT_CUDA_CHECK(cudaEventElapsedTime(ms, as_event(start), as_event(end)));
+  XFT_API_END()
+}
+
+int xft_tensor_record_stream(xft_tensor_t t, void* stream) {
+  XFT_API_BEGIN()
+  const Tensor& tensor = unwrap(t);
+  XFT_CHECK(tensor.device().is_cuda(), "record_stream: expected a CUDA tensor");
+  cuda::caching_allocator()->record_stream(tensor.storage()->data(), tensor.device().index,
+                                           as_stream(stream));
+  XFT_API_END()
+}
+
+int xft_cuda_graph_create(void** out) {
+  XFT_API_BEGIN()
+  *out = new cuda::CUDAGraph();
+  XFT_API_END()
+}
+
+int xft_cuda_graph_destroy(void* graph) {
+  XFT_API_BEGIN()
+  delete as_graph(graph);
+  XFT_API_END()
+}
+
+int xft_cuda_graph_capture_begin(void* graph, int32_t device, uint64_t pool) {
+  XFT_API_BEGIN()
+  as_graph(graph)->capture_begin(device, pool);
+  XFT_API_END()
+}
+
+int xft_cuda_graph_capture_end(void* graph) {
+  XFT_API_BEGIN()
+  as_graph(graph)->capture_end();
+  XFT_API_END()
+}
+
+int xft_cuda_graph_replay(void* graph) {
+  XFT_API_BEGIN()
+  as_graph(graph)->replay();
+  XFT_API_END()
+}
+
+int xft_cuda_graph_reset(void* graph) {
+  XFT_API_BEGIN()
+  as_graph(graph)->reset();
+  XFT_API_END()
+}
+
+int xft_cuda_graph_pool(void* graph, uint64_t* out) {
+  XFT_API_BEGIN()
+  *out = as_graph(graph)->pool();
+  XFT_API_END()
+}
+
+int xft_cuda_graph_pool_handle(uint64_t* out) {
+  XFT_API_BEGIN()
+  *out = cuda::CachingAllocator::new_pool_id();
+  XFT_API_END()
+}
+
+}  // extern "C"
+
+#else  // !XFT_USE_CUDA
+
+namespace {
+
+int unavailable() {
+  set_last_error("xft was built without CUDA support (XFT_USE_CUDA=OFF)");
+  return -1;
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_cuda_stream_create(int32_t, int32_t, void**) { return unavailable(); }
+int xft_cuda_stream_destroy(void*) { return unavailable(); }
+int xft_cuda_current_stream(int32_t, void**) { return unavailable(); }
+int xft_cuda_set_current_stream(int32_t, void*) { return unavailable(); }
+int xft_cuda_stream_synchronize(void*) { return unavailable(); }
+int xft_cuda_stream_query(void*, int32_t*) { return unavailable(); }
+int xft_cuda_stream_wait_event(void*, void*) { return unavailable(); }
+int xft_cuda_event_create(int32_t, int32_t, void**) { return unavailable(); }
+int xft_cuda_event_destroy(void*) { return unavailable(); }
+int xft_cuda_event_record(void*, void*) { return unavailable(); }
+int xft_cuda_event_synchronize(void*) { return unavailable(); }
+int xft_cuda_event_query(void*, int32_t*) { return unavailable(); }
+int xft_cuda_event_elapsed_time(void*, void*, float*) { return unavailable(); }
+int xft_tensor_record_stream(xft_tensor_t, void*) { return unavailable(); }
+int xft_cuda_graph_create(void**) { return unavailable(); }
+int xft_cuda_graph_destroy(void*) { return unavailable(); }
+int xft_cuda_graph_capture_begin(void*, int32_t, uint64_t) { return unavailable(); }
+int xft_cuda_graph_capture_end(void*) { return unavailable(); }
+int xft_cuda_graph_replay(void*) { return unavailable(); }
+int xft_cuda_graph_reset(void*) { return unavailable(); }
+int xft_cuda_graph_pool(void*, uint64_t*) { return unavailable(); }
+int xft_cuda_graph_pool_handle(uint64_t*) { return unavailable(); }
+
+}  // extern "C"
+
+#endif  // XFT_USE_CUDA
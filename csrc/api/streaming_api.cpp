@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <optional>
+
+#include "api/api_utils.h"
+#include "core/streaming.h"
+#include "ops/streaming.h"
+
+using namespace xft;
+using namespace xft::api;
+
+namespace {
+
+ChunkReader& as_reader(void* reader) {
+  XFT_CHECK(reader != nullptr, "null ChunkReader handle");
+  return *static_cast<ChunkReader*>(reader);
+}
+
+ChunkWriter& as_writer(void* writer) {
+  XFT_CHECK(writer != nullptr, "null ChunkWriter handle");
+  return *static_cast<ChunkWriter*>(writer);
+}
+
+size_t to_chunk_bytes(int64_t chunk_bytes) {
+  XFT_CHECK(chunk_bytes >= 0, "stream: bad chunk size ", chunk_bytes);
+  return chunk_bytes == 0 ? kDefaultChunkBytes : static_cast<size_t>(chunk_bytes);
+}
+
+std::optional<int64_t> to_dim(int64_t dim, int32_t all_dims) {
+  return all_dims ? std::nullopt : std::optional<int64_t>(dim);
+}
+
+}  // namespace
+
+extern "C" {
+
+int xft_chunk_reader_create(const char* path, const char* name, int64_t chunk_bytes,
+                            int32_t device_type, int32_t device_index, void** out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr && name != nullptr, "stream: null path or name");
+  *out = new ChunkReader(path, name, to_chunk_bytes(chunk_bytes),
+                         to_device(device_type, device_index));
+  XFT_API_END()
+}
+
+int xft_chunk_reader_destroy(void* reader) {
+  XFT_API_BEGIN()
+  delete static_cast<ChunkReader*>(reader);
+  XFT_API_END()
+}
+
+int xft_chunk_reader_info(void* reader, int32_t* dtype, int64_t* ndim, int64_t* shape,
+                          int64_t max_ndim) {
+  XFT_API_BEGIN()
+  const ChunkReader& r = as_reader(reader);
+  *dtype = static_cast<int32_t>(r.dtype());
+  *ndim = static_cast<int64_t>(r.sizes().size());
+  for (int64_t d = 0; d < std::min(*ndim, max_ndim); d++) shape[d] = r.sizes()[d];
+  XFT_API_END()
+}
+
+int xft_chunk_reader_next(void* reader, xft_tensor_t* out, int64_t* row) {
+  XFT_API_BEGIN()
+  Tensor chunk = as_reader(reader).next(row);
+  *out = chunk.defined() ? wrap(std::move(chunk)) : nullptr;
+  XFT_API_END()
+}
+
+int xft_chunk_writer_create(const char* path, const char* name, const int64_t* shape,
+                            int64_t ndim, int32_t dtype, void** out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr && name != nullptr, "stream: null path or name");
+  *out = new ChunkWriter(path, name, to_shape(shape, ndim), static_cast<DType>(dtype));
+  XFT_API_END()
+}
+
+int xft_chunk_writer_destroy(void* writer) {
+  XFT_API_BEGIN()
+  delete static_cast<ChunkWriter*>(writer);
+  XFT_API_END()
+}
+
+int xft_chunk_writer_write(void* writer, xft_tensor_t rows) {
+  XFT_API_BEGIN()
+  as_writer(writer).write(unwrap(rows));
+  XFT_API_END()
+}
+
+int xft_chunk_writer_close(void* writer) {
+  XFT_API_BEGIN()
+  as_writer(writer).close();
+  XFT_API_END()
+}
+
+int xft_stream_sum(const char* path, const char* name, int64_t dim, int32_t all_dims,
+                   int32_t keepdim, int64_t chunk_bytes, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr && name != nullptr, "stream: null path or name");
+  *out = wrap(streaming::sum(path, name, to_dim(dim, all_dims), keepdim != 0,
+                             to_chunk_bytes(chunk_bytes)));
+  XFT_API_END()
+}
+
+int xft_stream_mean(const char* path, const char* name, int64_t dim, int32_t all_dims,
+                    int32_t keepdim, int64_t chunk_bytes, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr && name != nullptr, "stream: null path or name");
+  *out = wrap(streaming::mean(path, name, to_dim(dim, all_dims), keepdim != 0,
+                              to_chunk_bytes(chunk_bytes)));
+  XFT_API_END()
+}
+
+int xft_stream_amax(const char* path, const char* name, int64_t dim, int32_t all_dims,
+                    int32_t keepdim, int64_t chunk_bytes, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr && name != nullptr, "stream: null path or name");
+  *out = wrap(streaming::amax(path, name, to_dim(dim, all_dims), keepdim != 0,
+                              to_chunk_bytes(chunk_bytes)));
+  XFT_API_END()
+}
+
+int xft_stream_matvec(const char* path, const char* name, xft_tensor_t v, int64_t chunk_bytes,
+                      xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  XFT_CHECK(path != nullptr && name != nullptr, "stream: null path or name");
+  *out = wrap(streaming::matvec(path, name, unwrap(v), to_chunk_bytes(chunk_bytes)));
+  XFT_API_END()
+}
+
+}  // extern "C"
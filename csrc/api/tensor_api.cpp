@@ -0,0 +1,213 @@
+#include <cstring>
+
+#include "api/api_utils.h"
+
+namespace xft::api {
+
+namespace {
+thread_local std::string g_last_error;
+}
+
+void set_last_error(const std::string& msg) { g_last_error = msg; }
+
+}  // namespace xft::api
+
+using namespace xft;
+using namespace xft::api;
+
+extern "C" {
+
+const char* xft_last_error(void) { return g_last_error.c_str(); }
+
+int xft_tensor_empty(const int64_t* shape, int64_t ndim, int32_t dtype, int32_t device_type,
+                     int32_t device_index, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(Tensor::empty(to_shape(shape, ndim), static_cast<DType>(dtype),
+                            to_device(device_type, device_index)));
+  XFT_API_END()
+}
+
+int xft_tensor_from_buffer(const void* data, const int64_t* shape, int64_t ndim, int32_t dtype,
+                           xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  Tensor t = Tensor::empty(to_shape(shape, ndim), static_cast<DType>(dtype));
+  if (t.nbytes() > 0) std::memcpy(t.data_ptr(), data, t.nbytes());
+  *out = wrap(std::move(t));
+  XFT_API_END()
+}
+
+int xft_tensor_free(xft_tensor_t t) {
+  XFT_API_BEGIN()
+  delete reinterpret_cast<Tensor*>(t);
+  XFT_API_END()
+}
+
+int xft_tensor_new_handle(xft_tensor_t t, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t));
+  XFT_API_END()
+}
+
+int xft_tensor_ndim(xft_tensor_t t, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).dim();
+  XFT_API_END()
+}
+
+int xft_tensor_shape(xft_tensor_t t, int64_t* out) {
+  XFT_API_BEGIN()
+  const Shape& s = unwrap(t).sizes();
+  std::copy(s.begin(), s.end(), out);
+  XFT_API_END()
+}
+
+int xft_tensor_strides(xft_tensor_t t, int64_t* out) {
+  XFT_API_BEGIN()
+  const Shape& s = unwrap(t).strides();
+  std::copy(s.begin(), s.end(), out);
+  XFT_API_END()
+}
+
+int xft_tensor_offset(xft_tensor_t t, int64_t* out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).storage_offset();
+  XFT_API_END()
+}
+
+int xft_tensor_dtype(xft_tensor_t t, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = static_cast<int32_t>(unwrap(t).dtype());
+  XFT_API_END()
+}
+
+int xft_tensor_device(xft_tensor_t t, int32_t* type, int32_t* index) {
+  XFT_API_BEGIN()
+  Device d = unwrap(t).device();
+  *type = static_cast<int32_t>(d.type);
+  *index = d.index;
+  XFT_API_END()
+}
+
+int xft_tensor_data_ptr(xft_tensor_t t, void** out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).data_ptr();
+  XFT_API_END()
+}
+
+int xft_tensor_storage_ptr(xft_tensor_t t, void** out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).storage()->data();
+  XFT_API_END()
+}
+
+int xft_tensor_is_contiguous(xft_tensor_t t, int32_t memory_format, int32_t* out) {
+  XFT_API_BEGIN()
+  *out = unwrap(t).is_contiguous(to_memory_format(memory_format)) ? 1 : 0;
+  XFT_API_END()
+}
+
+int xft_tensor_to_buffer(xft_tensor_t t, void* dst, size_t nbytes) {
+  XFT_API_BEGIN()
+  const Tensor& src = unwrap(t);
+  XFT_CHECK(nbytes == src.nbytes(), "to_buffer: expected ", src.nbytes(), " bytes, got ", nbytes);
+  if (nbytes == 0) return 0;
+  Tensor host = Tensor::from_storage(
+      std::make_shared<Storage>(dst, nbytes, Device(), nullptr), src.sizes(),
+      contiguous_strides(src.sizes()), 0, src.dtype());
+  host.copy_(src.detach());
+  XFT_API_END()
+}
+
+int xft_tensor_view(xft_tensor_t t, const int64_t* shape, int64_t ndim, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).view(to_shape(shape, ndim)));
+  XFT_API_END()
+}
+
+int xft_tensor_reshape(xft_tensor_t t, const int64_t* shape, int64_t ndim, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).reshape(to_shape(shape, ndim)));
+  XFT_API_END()
+}
+
+int xft_tensor_transpose(xft_tensor_t t, int64_t d0, int64_t d1, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).transpose(d0, d1));
+  XFT_API_END()
+}
+
+int xft_tensor_permute(xft_tensor_t t, const int64_t* dims, int64_t ndim, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).permute(to_shape(dims, ndim)));
+  XFT_API_END()
+}
+
+int xft_tensor_slice(xft_tensor_t t, int64_t dim, int64_t start, int64_t end, int64_t step,
+                     xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).slice(dim, start, end, step));
+  XFT_API_END()
+}
+
+int xft_tensor_select(xft_tensor_t t, int64_t dim, int64_t index, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).select(dim, index));
+  XFT_API_END()
+}
+
+int xft_tensor_expand(xft_tensor_t t, const int64_t* shape, int64_t ndim, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).expand(to_shape(shape, ndim)));
+  XFT_API_END()
+}
+
+int xft_tensor_squeeze(xft_tensor_t t, int64_t dim, int32_t all_dims, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(all_dims ? unwrap(t).squeeze() : unwrap(t).squeeze(dim));
+  XFT_API_END()
+}
+
+int xft_tensor_unsqueeze(xft_tensor_t t, int64_t dim, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).unsqueeze(dim));
+  XFT_API_END()
+}
+
+int xft_tensor_contiguous(xft_tensor_t t, int32_t memory_format, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).contiguous(to_memory_format(memory_format)));
+  XFT_API_END()
+}
+
+int xft_tensor_clone(xft_tensor_t t, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).clone());
+  XFT_API_END()
+}
+
+int xft_tensor_to_dtype(xft_tensor_t t, int32_t dtype, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).to(static_cast<DType>(dtype)));
+  XFT_API_END()
+}
+
+int xft_tensor_to_device(xft_tensor_t t, int32_t device_type, int32_t device_index,
+                         int32_t non_blocking, xft_tensor_t* out) {
+  XFT_API_BEGIN()
+  *out = wrap(unwrap(t).to(to_device(device_type, device_index), non_blocking != 0));
+  XFT_API_END()
+}
+
+int xft_tensor_copy_(xft_tensor_t dst, xft_tensor_t src, int32_t non_blocking) {
+  XFT_API_BEGIN()
+  unwrap(dst).copy_(unwrap(src), non_blocking != 0);
+  XFT_API_END()
+}
+
+int xft_tensor_fill_(xft_tensor_t t, double value) {
+  XFT_API_BEGIN()
+  unwrap(t).fill_(value);
+  XFT_API_END()
+}
+
+}  // extern "C"
@@ -0,0 +1,150 @@
+#include "autograd/checkpoint.h"
+
+#include <cstddef>
+#include <utility>
+
+#include "autograd/engine.h"
+#include "autograd/grad_mode.h"
+#include "autograd/node.h"
+#include "core/autocast.h"
+#include "core/generator.h"
+
+namespace xft::autograd {
+
+namespace {
+
+using RngStates = std::vector<std::pair<Device, GeneratorState>>;
+
+// The CPU generator plus one per CUDA device among the inputs.
+RngStates capture_rng(const std::vector<Tensor>& inputs) {
+  RngStates states{{Device(), default_generator(Device()).state()}};
+  for (const Tensor& t : inputs) {
+    if (!t.defined() || !t.device().is_cuda()) continue;
+    bool seen = false;
+    for (const auto& s : states) seen = seen || s.first == t.device();
+    if (!seen) states.emplace_back(t.device(), default_generator(t.device()).state());
+  }
+  return states;
+}
+
+// Rewinds the generators to `saved` for a scope, then restores where they
+// were, so a replay neither repeats nor skips numbers for later ops.
+class RngReplay {
+ public:
+  explicit RngReplay(const RngStates& saved) {
+    for (const auto& [device, state] : saved) {
+      Generator& gen = default_generator(device);
+      current_.emplace_back(device, gen.state());
+      gen.set_state(state);
+    }
+  }
+  ~RngReplay() {
+    for (const auto& [device, state] : current_) default_generator(device).set_state(state);
+  }
+
+  RngReplay(const RngReplay&) = delete;
+  RngReplay& operator=(const RngReplay&) = delete;
+
+ private:
+  RngStates current_;
+};
+
+class CheckpointBackward : public Node {
+ public:
+  CheckpointBackward(CheckpointFn fn, const std::vector<Tensor>& inputs, RngStates rng,
+                     autocast::State amp, size_t num_outputs)
+      : fn_(std::move(fn)), rng_(std::move(rng)), amp_(amp), num_outputs_(num_outputs) {
+    for (const Tensor& t : inputs) {
+      inputs_.push_back(t.defined() ? SavedTensor(t) : SavedTensor());
+      defined_.push_back(t.defined());
+    }
+  }
+
+  const char* name() const override { return "CheckpointBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    fn_ = nullptr;
+    for (SavedTensor& t : inputs_) t.release();
+  }
+
+ private:
+  CheckpointFn fn_;
+  std::vector<SavedTensor> inputs_;
+  std::vector<bool> defined_;
+  RngStates rng_;
+  autocast::State amp_;
+  size_t num_outputs_;
+};
+
+std::vector<Tensor> CheckpointBackward::apply(std::vector<Tensor>&& grads) {
+  // Fresh leaves each time, so a retained graph can be replayed again.
+  std::vector<Tensor> inputs(inputs_.size());
+  for (size_t i = 0; i < inputs_.size(); i++) {
+    if (!defined_[i]) continue;
+    inputs[i] = inputs_[i].unpack().detach();
+    if (needs_input_grad(i)) inputs[i].set_requires_grad(true);
+  }
+  XFT_CHECK(fn_, "checkpoint: the segment was already freed");
+  std::vector<Tensor> outputs;
+  {
+    // Recompute with the forward's generators and autocast state, so the
+    // replay makes the same draws and casts.
+    RngReplay replay(rng_);
+    autocast::StateGuard amp(amp_);
+    AutoGradMode grad_mode(true);
+    outputs = fn_(inputs);
+  }
+  XFT_CHECK(outputs.size() == num_outputs_, "checkpoint: recomputation returned ",
+            outputs.size(), " outputs, the forward returned ", num_outputs_);
+
+  grads.resize(num_outputs_);
+  std::vector<Tensor> roots, root_grads;
+  for (size_t i = 0; i < num_outputs_; i++) {
+    if (!grads[i].defined() || !outputs[i].defined() || !outputs[i].requires_grad()) continue;
+    roots.push_back(outputs[i]);
+    root_grads.push_back(std::move(grads[i]));
+  }
+  if (!roots.empty()) backward(roots, root_grads);
+
+  std::vector<Tensor> result(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (needs_input_grad(i)) result[i] = inputs[i].grad();
+  }
+  return result;
+}
+
+}  // namespace
+
+std::vector<Tensor> checkpoint(const CheckpointFn& fn, const std::vector<Tensor>& inputs) {
+  RngStates rng = capture_rng(inputs);
+  std::vector<Tensor> detached(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (inputs[i].defined()) detached[i] = inputs[i].detach();
+  }
+  std::vector<Tensor> outputs;
+  {
+    NoGradGuard no_grad;
+    outputs = fn(detached);
+  }
+
+  bool record = GradMode::is_enabled();
+  if (record) {
+    record = false;
+    for (const Tensor& t : inputs) record = record || (t.defined() && t.requires_grad());
+  }
+  if (!record) return outputs;
+
+  auto node = std::make_shared<CheckpointBackward>(fn, inputs, std::move(rng),
+                                                   autocast::state(), outputs.size());
+  for (const Tensor& t : inputs) node->add_next_edge(t.defined() ? gradient_edge(t) : Edge{});
+  for (size_t i = 0; i < outputs.size(); i++) {
+    if (!outputs[i].defined() || !is_floating(outputs[i].dtype())) continue;
+    // A fresh alias, in case fn handed back a tensor that has history of
+    // its own (one of its inputs, or something it captured).
+    outputs[i] = outputs[i].detach();
+    set_grad_fn(outputs[i], node, static_cast<int>(i));
+  }
+  return outputs;
+}
+
+}  // namespace xft::autograd
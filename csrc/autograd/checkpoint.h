@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace xft::autograd {
+
+// A segment of the forward pass as a function of its tensor inputs.
+using CheckpointFn = std::function<std::vector<Tensor>(const std::vector<Tensor>&)>;
+
+// Activation checkpointing. Runs fn(inputs) with grad mode off, so nothing
+// inside the segment is saved, and ties its floating outputs to a single
+// CheckpointBackward node that keeps only the inputs. During backward the
+// node reruns fn with grad mode on, then backpropagates through the
+// recomputed graph from every output that received a gradient.
+//
+// The recomputation starts from the generator states (CPU and the inputs'
+// CUDA devices) the forward started from, so dropout and other random ops
+// draw exactly what they drew the first time; the generators are put back
+// afterwards. Tensors fn uses without taking them as inputs (weights, say)
+// get their gradients accumulated directly during that inner pass. Nothing
+// is recorded unless grad mode is on and some input requires grad, so the
+// segment's input should, as the output of earlier layers usually does.
+std::vector<Tensor> checkpoint(const CheckpointFn& fn, const std::vector<Tensor>& inputs);
+
+}  // namespace xft::autograd
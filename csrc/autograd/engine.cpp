@@ -0,0 +1,164 @@
+#include "autograd/engine.h"
+
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "autograd/grad_mode.h"
+#include "autograd/node.h"
+#include "core/autocast.h"
+#include "core/profiler.h"
+#include "ops/elementwise.h"
+
+namespace xft::autograd {
+
+namespace {
+
+thread_local int t_depth = 0;
+thread_local uint64_t t_pass_id = 0;
+thread_local std::vector<std::function<void()>> t_callbacks;
+
+// Tracks backward nesting; the outermost level owns the queued callbacks.
+class PassGuard {
+ public:
+  PassGuard() {
+    if (t_depth++ == 0) {
+      t_pass_id++;
+      t_callbacks.clear();
+    }
+  }
+  ~PassGuard() {
+    if (--t_depth == 0) t_callbacks.clear();
+  }
+  PassGuard(const PassGuard&) = delete;
+  PassGuard& operator=(const PassGuard&) = delete;
+  bool outermost() const { return t_depth == 1; }
+};
+
+// Number of edges into each node reachable from the roots.
+std::unordered_map<Node*, int> count_dependencies(const std::vector<Node*>& roots) {
+  std::unordered_map<Node*, int> deps;
+  std::vector<Node*> stack;
+  for (Node* root : roots) {
+    if (deps.try_emplace(root, 0).second) stack.push_back(root);
+  }
+  while (!stack.empty()) {
+    Node* node = stack.back();
+    stack.pop_back();
+    for (const Edge& e : node->next_edges()) {
+      if (!e.valid()) continue;
+      auto [it, inserted] = deps.try_emplace(e.node.get(), 0);
+      it->second++;
+      if (inserted) stack.push_back(e.node.get());
+    }
+  }
+  return deps;
+}
+
+struct LaterFirst {
+  bool operator()(const Node* a, const Node* b) const {
+    return a->sequence_nr() < b->sequence_nr();
+  }
+};
+
+void accumulate(std::vector<Tensor>& buffer, int input_nr, Tensor&& grad) {
+  if (static_cast<int>(buffer.size()) <= input_nr) buffer.resize(input_nr + 1);
+  Tensor& slot = buffer[input_nr];
+  slot = slot.defined() ? add(slot, grad) : std::move(grad);
+}
+
+Tensor root_grad(const Tensor& root, const Tensor& grad) {
+  XFT_CHECK(root.defined() && root.requires_grad(),
+            "backward: tensor does not require grad and has no grad_fn");
+  if (!grad.defined()) {
+    XFT_CHECK(root.numel() == 1,
+              "backward: grad can be omitted only for single-element tensors, got shape with ",
+              root.numel(), " elements");
+    Tensor ones = Tensor::empty(root.sizes(), root.dtype(), root.device());
+    ones.fill_(1.0);
+    return ones;
+  }
+  XFT_CHECK(grad.sizes() == root.sizes(), "backward: grad shape does not match the tensor");
+  XFT_CHECK(grad.dtype() == root.dtype() && grad.device() == root.device(),
+            "backward: grad must have the tensor's dtype and device");
+  return grad.detach();
+}
+
+}  // namespace
+
+void backward(const Tensor& root, const Tensor& grad, bool retain_graph) {
+  backward(std::vector<Tensor>{root}, std::vector<Tensor>{grad}, retain_graph);
+}
+
+void backward(const std::vector<Tensor>& roots, const std::vector<Tensor>& grads,
+              bool retain_graph) {
+  XFT_CHECK(roots.size() == grads.size(), "backward: got ", roots.size(), " tensors but ",
+            grads.size(), " grads");
+  XFT_RECORD_OP("backward");
+  PassGuard pass;
+  NoGradGuard no_grad;
+  // Gradients keep the dtypes the forward's casts recorded.
+  autocast::StateGuard no_autocast{autocast::State{}};
+  std::vector<Node*> root_nodes;
+  std::unordered_map<Node*, std::vector<Tensor>> buffers;
+  for (size_t i = 0; i < roots.size(); i++) {
+    Tensor g = root_grad(roots[i], grads[i]);
+    const Edge edge = gradient_edge(roots[i]);
+    root_nodes.push_back(edge.node.get());
+    accumulate(buffers[edge.node.get()], edge.input_nr, std::move(g));
+  }
+  std::unordered_map<Node*, int> deps = count_dependencies(root_nodes);
+
+  // A root that another root feeds waits for it like any other node.
+  std::priority_queue<Node*, std::vector<Node*>, LaterFirst> ready;
+  for (Node* node : root_nodes) {
+    if (deps[node] == 0) {
+      deps[node] = -1;
+      ready.push(node);
+    }
+  }
+  while (!ready.empty()) {
+    Node* node = ready.top();
+    ready.pop();
+    std::vector<Tensor> inputs;
+    if (auto it = buffers.find(node); it != buffers.end()) {
+      inputs = std::move(it->second);
+      buffers.erase(it);
+    }
+    if (inputs.empty()) inputs.resize(1);
+    std::vector<Tensor> outputs;
+    {
+      XFT_RECORD_OP(node->name(), inputs);
+      outputs = node->apply(std::move(inputs));
+    }
+    if (!retain_graph) node->release_saved();
+
+    const std::vector<Edge>& edges = node->next_edges();
+    XFT_CHECK(outputs.empty() || outputs.size() == edges.size(), "backward: ", node->name(),
+              " returned ", outputs.size(), " gradients for ", edges.size(), " inputs");
+    for (size_t i = 0; i < edges.size(); i++) {
+      const Edge& e = edges[i];
+      if (!e.valid()) continue;
+      Node* next = e.node.get();
+      if (i < outputs.size() && outputs[i].defined()) {
+        accumulate(buffers[next], e.input_nr, std::move(outputs[i]));
+      }
+      if (--deps[next] == 0) ready.push(next);
+    }
+  }
+  if (!pass.outermost()) return;
+  // A callback may queue more.
+  for (size_t i = 0; i < t_callbacks.size(); i++) {
+    std::function<void()> callback = std::move(t_callbacks[i]);
+    callback();
+  }
+}
+
+void queue_callback(std::function<void()> callback) {
+  XFT_CHECK(t_depth > 0, "queue_callback: no backward pass is running on this thread");
+  t_callbacks.push_back(std::move(callback));
+}
+
+uint64_t backward_pass_id() { return t_pass_id; }
+
+}  // namespace xft::autograd
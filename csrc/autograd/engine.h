@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace xft::autograd {
+
+// Backpropagates from `root` and accumulates into grad() of every leaf that
+// requires grad. `grad` is d(loss)/d(root); it may be omitted for a
+// single-element root, where it defaults to 1.
+//
+// The graph is walked once, in C++, in dependency order: a node runs when
+// every node that feeds it has run. Unless retain_graph, each node frees its
+// saved tensors right after it runs, and its incoming gradients are dropped
+// as soon as they are consumed. Backward runs with grad mode off, so it does
+// not record a graph of its own.
+void backward(const Tensor& root, const Tensor& grad = Tensor(), bool retain_graph = false);
+
+// One pass from several roots at once, grads[i] going with roots[i]. Used
+// by checkpoint to backpropagate a recomputed segment from all its outputs.
+void backward(const std::vector<Tensor>& roots, const std::vector<Tensor>& grads,
+              bool retain_graph = false);
+
+// Runs `callback` on this thread once the outermost backward in progress on
+// it finishes, after every gradient is accumulated; callbacks queued during
+// one pass run in order. Hooks use it to finish work for a whole pass.
+// Callbacks are dropped if backward throws. Must be called from inside
+// backward.
+void queue_callback(std::function<void()> callback);
+
+// Counts outermost backward passes started on this thread, so a hook can
+// tell a new pass from the one it saw last (nested backward, as in
+// checkpoint, stays in the same pass).
+uint64_t backward_pass_id();
+
+}  // namespace xft::autograd
@@ -0,0 +1,276 @@
+#include "autograd/functions.h"
+
+#include "ops/attention.h"
+#include "ops/elementwise.h"
+#include "ops/fused.h"
+#include "ops/matmul.h"
+#include "ops/reduce.h"
+
+namespace xft::autograd {
+
+namespace {
+
+Tensor scalar_like(double value, const Tensor& like) {
+  Tensor t = Tensor::empty({}, like.dtype(), like.device());
+  t.fill_(value);
+  return t;
+}
+
+Tensor neg(const Tensor& t) { return mul(t, scalar_like(-1.0, t)); }
+
+}  // namespace
+
+Tensor sum_to(const Tensor& grad, const Shape& shape) {
+  if (grad.sizes() == shape) return grad;
+  Tensor g = grad;
+  const int64_t lead = g.dim() - static_cast<int64_t>(shape.size());
+  for (int64_t d = 0; d < lead; d++) g = sum(g, 0, /*keepdim=*/false);
+  for (size_t d = 0; d < shape.size(); d++) {
+    if (shape[d] == 1 && g.size(d) != 1) g = sum(g, d, /*keepdim=*/true);
+  }
+  return g;
+}
+
+// ---- elementwise ----
+
+std::vector<Tensor> AddBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  return {needs_input_grad(0) ? sum_to(g, a_sizes_) : Tensor(),
+          needs_input_grad(1) ? sum_to(g, b_sizes_) : Tensor()};
+}
+
+std::vector<Tensor> SubBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  return {needs_input_grad(0) ? sum_to(g, a_sizes_) : Tensor(),
+          needs_input_grad(1) ? neg(sum_to(g, b_sizes_)) : Tensor()};
+}
+
+std::vector<Tensor> MulBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  const Tensor a = a_.unpack(), b = b_.unpack();
+  return {needs_input_grad(0) ? sum_to(mul(g, b), a.sizes()) : Tensor(),
+          needs_input_grad(1) ? sum_to(mul(g, a), b.sizes()) : Tensor()};
+}
+
+std::vector<Tensor> DivBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  const Tensor a = a_.unpack(), b = b_.unpack();
+  const Tensor ga = div(g, b);
+  Tensor gb;
+  // d(a / b)/db = -(a / b) / b.
+  if (needs_input_grad(1)) gb = sum_to(neg(mul(ga, div(a, b))), b.sizes());
+  return {needs_input_grad(0) ? sum_to(ga, a.sizes()) : Tensor(), gb};
+}
+
+std::vector<Tensor> MaximumBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  const Tensor a = a_.unpack(), b = b_.unpack();
+  const Tensor ga = mul(g, is_min_ ? ge_mask(b, a) : ge_mask(a, b));
+  return {needs_input_grad(0) ? sum_to(ga, a.sizes()) : Tensor(),
+          needs_input_grad(1) ? sum_to(sub(g, ga), b.sizes()) : Tensor()};
+}
+
+std::vector<Tensor> ExpBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {mul(grads[0], out_.unpack())};
+}
+
+std::vector<Tensor> LogBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {div(grads[0], self_.unpack())};
+}
+
+std::vector<Tensor> SqrtBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  const Tensor out = out_.unpack();
+  return {div(grads[0], mul(out, scalar_like(2.0, out)))};
+}
+
+const char* ActivationBackward::name() const {
+  switch (op_) {
+    case BinaryOp::ReluBackward: return "ReluBackward";
+    case BinaryOp::SigmoidBackward: return "SigmoidBackward";
+    case BinaryOp::TanhBackward: return "TanhBackward";
+    case BinaryOp::GeluBackward: return "GeluBackward";
+    default: return "ActivationBackward";
+  }
+}
+
+std::vector<Tensor> ActivationBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  const Tensor saved = saved_.unpack();
+  switch (op_) {
+    case BinaryOp::ReluBackward: return {relu_backward(g, saved)};
+    case BinaryOp::SigmoidBackward: return {sigmoid_backward(g, saved)};
+    case BinaryOp::TanhBackward: return {tanh_backward(g, saved)};
+    case BinaryOp::GeluBackward: return {gelu_backward(g, saved)};
+    default: XFT_FAIL("ActivationBackward: unexpected op ", static_cast<int>(op_));
+  }
+}
+
+std::vector<Tensor> DropoutBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {mul(grads[0], mask_.unpack())};
+}
+
+// ---- reductions ----
+
+Tensor ReduceDims::expand(const Tensor& grad) const {
+  if (all_dims || keepdim) return grad.expand(sizes);
+  return grad.unsqueeze(dim).expand(sizes);
+}
+
+std::vector<Tensor> SumBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {dims_.expand(grads[0])};
+}
+
+std::vector<Tensor> MeanBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  return {dims_.expand(mul(g, scalar_like(1.0 / static_cast<double>(count_), g)))};
+}
+
+std::vector<Tensor> AmaxBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  const Tensor mask = eq_mask(self_.unpack(), dims_.expand(out_.unpack()));
+  const Tensor count = dims_.all_dims ? sum(mask) : sum(mask, dims_.dim, /*keepdim=*/true);
+  return {mul(dims_.expand(g), div(mask, count))};
+}
+
+std::vector<Tensor> SoftmaxBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  return {softmax_backward(g, out_.unpack(), dim_)};
+}
+
+// ---- fused ----
+
+std::vector<Tensor> LayerNormBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  NormGrads r = layer_norm_backward(rms_, g, x_.unpack(), mean_.unpack(), rstd_.unpack(),
+                                    weight_.unpack(), needs_input_grad(1), needs_input_grad(2));
+  return {needs_input_grad(0) ? r.dx : Tensor(), r.dweight, r.dbias};
+}
+
+std::vector<Tensor> BiasGeluBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  auto [dx, dbias] = bias_gelu_backward(g, x_.unpack(), bias_.unpack(), needs_input_grad(1));
+  return {needs_input_grad(0) ? dx : Tensor(), dbias};
+}
+
+std::vector<Tensor> BiasDropoutResidualBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  Tensor dx;
+  if (needs_input_grad(0) || needs_input_grad(1)) {
+    dx = dropout_mask_backward(g, keep_, scale_, rng_);
+  }
+  return {needs_input_grad(0) ? dx : Tensor(),
+          needs_input_grad(1) ? sum_to_last_dim(dx) : Tensor(),
+          needs_input_grad(2) ? g : Tensor()};
+}
+
+// ---- matmul ----
+
+std::vector<Tensor> MatmulBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  const Tensor a = a_.unpack(), b = b_.unpack();
+  // Lift 1-D operands to matrices so both products below are plain matmuls;
+  // the broadcast batch dims are then summed away.
+  const Tensor a2 = a.dim() == 1 ? a.unsqueeze(0) : a;
+  const Tensor b2 = b.dim() == 1 ? b.unsqueeze(-1) : b;
+  // g has no m dim when a is 1-D and no n dim when b is; a dot product's g
+  // is 0-d.
+  Tensor g2 = g;
+  if (a.dim() == 1) g2 = g2.unsqueeze(b.dim() == 1 ? g2.dim() : g2.dim() - 1);
+  if (b.dim() == 1) g2 = g2.unsqueeze(g2.dim());
+  Tensor ga, gb;
+  if (needs_input_grad(0)) {
+    ga = sum_to(matmul(g2, b2.transpose(-1, -2)), a2.sizes());
+    if (a.dim() == 1) ga = ga.squeeze(0);
+  }
+  if (needs_input_grad(1)) {
+    gb = sum_to(matmul(a2.transpose(-1, -2), g2), b2.sizes());
+    if (b.dim() == 1) gb = gb.squeeze(-1);
+  }
+  return {ga, gb};
+}
+
+// ---- attention ----
+
+std::vector<Tensor> AttentionBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  AttentionGrads r = scaled_dot_product_attention_backward(
+      g, q_.unpack(), k_.unpack(), v_.unpack(), out_.unpack(), lse_.unpack(), is_causal_, scale_);
+  return {needs_input_grad(0) ? r.dq : Tensor(), needs_input_grad(1) ? r.dk : Tensor(),
+          needs_input_grad(2) ? r.dv : Tensor()};
+}
+
+// ---- convolution ----
+
+std::vector<Tensor> Conv2dBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  Conv2dGrads r = conv2d_backward(g, x_.unpack(), weight_.unpack(), params_, x_format_,
+                                  needs_input_grad(0), needs_input_grad(1), needs_input_grad(2));
+  return {r.dx, r.dweight, r.dbias};
+}
+
+// ---- views and copies ----
+
+std::vector<Tensor> ReshapeBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {grads[0].reshape(sizes_)};
+}
+
+std::vector<Tensor> TransposeBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {grads[0].transpose(d0_, d1_)};
+}
+
+std::vector<Tensor> PermuteBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  std::vector<int64_t> inverse(dims_.size());
+  for (size_t i = 0; i < dims_.size(); i++) inverse[dims_[i]] = static_cast<int64_t>(i);
+  return {grads[0].permute(inverse)};
+}
+
+std::vector<Tensor> ExpandBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {sum_to(grads[0], sizes_)};
+}
+
+std::vector<Tensor> SliceBackward::apply(std::vector<Tensor>&& grads) {
+  const Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  Tensor out = Tensor::zeros(sizes_, g.dtype(), g.device());
+  if (step_ == 0) {
+    out.select(dim_, start_).copy_(g);
+  } else {
+    out.slice(dim_, start_, start_ + g.size(dim_) * step_, step_).copy_(g);
+  }
+  return {out};
+}
+
+std::vector<Tensor> CloneBackward::apply(std::vector<Tensor>&& grads) {
+  return {std::move(grads[0])};
+}
+
+std::vector<Tensor> ToBackward::apply(std::vector<Tensor>&& grads) {
+  if (!grads[0].defined()) return {};
+  return {grads[0].to(device_).to(dtype_)};
+}
+
+}  // namespace xft::autograd
@@ -0,0 +1,398 @@
+#pragma once
+
+// Backward nodes for the differentiable ops. Each op records its node with
+// autograd::record() right after computing its result; the formulas live in
+// functions.cpp and are written in terms of the ops themselves.
+
+#include <vector>
+
+#include "autograd/node.h"
+#include "core/generator.h"
+#include "ops/conv.h"
+#include "ops/op_kinds.h"
+
+namespace xft::autograd {
+
+// Sums `grad` down to `shape`, undoing NumPy broadcasting.
+Tensor sum_to(const Tensor& grad, const Shape& shape);
+
+// ---- elementwise ----
+
+class AddBackward : public Node {
+ public:
+  AddBackward(const Tensor& a, const Tensor& b) : a_sizes_(a.sizes()), b_sizes_(b.sizes()) {}
+  const char* name() const override { return "AddBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  Shape a_sizes_, b_sizes_;
+};
+
+class SubBackward : public Node {
+ public:
+  SubBackward(const Tensor& a, const Tensor& b) : a_sizes_(a.sizes()), b_sizes_(b.sizes()) {}
+  const char* name() const override { return "SubBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  Shape a_sizes_, b_sizes_;
+};
+
+class MulBackward : public Node {
+ public:
+  MulBackward(const Tensor& a, const Tensor& b) : a_(a), b_(b) {}
+  const char* name() const override { return "MulBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    a_.release();
+    b_.release();
+  }
+
+ private:
+  SavedTensor a_, b_;
+};
+
+class DivBackward : public Node {
+ public:
+  DivBackward(const Tensor& a, const Tensor& b) : a_(a), b_(b) {}
+  const char* name() const override { return "DivBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    a_.release();
+    b_.release();
+  }
+
+ private:
+  SavedTensor a_, b_;
+};
+
+// maximum and minimum; ties send the gradient to the first operand.
+class MaximumBackward : public Node {
+ public:
+  MaximumBackward(const Tensor& a, const Tensor& b, bool is_min) : a_(a), b_(b), is_min_(is_min) {}
+  const char* name() const override { return is_min_ ? "MinimumBackward" : "MaximumBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    a_.release();
+    b_.release();
+  }
+
+ private:
+  SavedTensor a_, b_;
+  bool is_min_;
+};
+
+class ExpBackward : public Node {
+ public:
+  explicit ExpBackward(const Tensor& out) : out_(out) {}
+  const char* name() const override { return "ExpBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override { out_.release(); }
+
+ private:
+  SavedTensor out_;
+};
+
+class LogBackward : public Node {
+ public:
+  explicit LogBackward(const Tensor& self) : self_(self) {}
+  const char* name() const override { return "LogBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override { self_.release(); }
+
+ private:
+  SavedTensor self_;
+};
+
+class SqrtBackward : public Node {
+ public:
+  explicit SqrtBackward(const Tensor& out) : out_(out) {}
+  const char* name() const override { return "SqrtBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override { out_.release(); }
+
+ private:
+  SavedTensor out_;
+};
+
+// relu, sigmoid, tanh and gelu, through their fused *Backward kernels.
+class ActivationBackward : public Node {
+ public:
+  ActivationBackward(BinaryOp op, const Tensor& saved) : op_(op), saved_(saved) {}
+  const char* name() const override;
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override { saved_.release(); }
+
+ private:
+  BinaryOp op_;
+  SavedTensor saved_;
+};
+
+// dropout: the mask already holds 0 or 1 / (1 - p).
+class DropoutBackward : public Node {
+ public:
+  explicit DropoutBackward(const Tensor& mask) : mask_(mask) {}
+  const char* name() const override { return "DropoutBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override { mask_.release(); }
+
+ private:
+  SavedTensor mask_;
+};
+
+// ---- reductions ----
+
+// Shared by sum, mean and amax: where the reduced dims were. all_dims
+// reduces every element; otherwise `dim` (already wrapped).
+struct ReduceDims {
+  Shape sizes;
+  int64_t dim = 0;
+  bool keepdim = false;
+  bool all_dims = true;
+
+  // grad broadcast back over the input shape (a stride-0 view).
+  Tensor expand(const Tensor& grad) const;
+};
+
+class SumBackward : public Node {
+ public:
+  explicit SumBackward(ReduceDims dims) : dims_(std::move(dims)) {}
+  const char* name() const override { return "SumBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  ReduceDims dims_;
+};
+
+class MeanBackward : public Node {
+ public:
+  MeanBackward(ReduceDims dims, int64_t count) : dims_(std::move(dims)), count_(count) {}
+  const char* name() const override { return "MeanBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  ReduceDims dims_;
+  int64_t count_;
+};
+
+// The gradient is split evenly between tied maxima.
+class AmaxBackward : public Node {
+ public:
+  AmaxBackward(ReduceDims dims, const Tensor& self, const Tensor& out)
+      : dims_(std::move(dims)), self_(self), out_(out) {}
+  const char* name() const override { return "AmaxBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    self_.release();
+    out_.release();
+  }
+
+ private:
+  ReduceDims dims_;
+  SavedTensor self_, out_;
+};
+
+class SoftmaxBackward : public Node {
+ public:
+  SoftmaxBackward(const Tensor& out, int64_t dim) : out_(out), dim_(dim) {}
+  const char* name() const override { return "SoftmaxBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override { out_.release(); }
+
+ private:
+  SavedTensor out_;
+  int64_t dim_;
+};
+
+// ---- fused ----
+
+// layer_norm and rms_norm, over inputs {x, weight, bias}. Saves the
+// per-row statistics from the forward; mean is undefined for rms_norm.
+class LayerNormBackward : public Node {
+ public:
+  LayerNormBackward(bool rms, const Tensor& x, const Tensor& weight, const Tensor& mean,
+                    const Tensor& rstd)
+      : rms_(rms), x_(x), weight_(weight), mean_(mean), rstd_(rstd) {}
+  const char* name() const override { return rms_ ? "RmsNormBackward" : "LayerNormBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    x_.release();
+    weight_.release();
+    mean_.release();
+    rstd_.release();
+  }
+
+ private:
+  bool rms_;
+  SavedTensor x_, weight_, mean_, rstd_;
+};
+
+class BiasGeluBackward : public Node {
+ public:
+  BiasGeluBackward(const Tensor& x, const Tensor& bias) : x_(x), bias_(bias) {}
+  const char* name() const override { return "BiasGeluBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    x_.release();
+    bias_.release();
+  }
+
+ private:
+  SavedTensor x_, bias_;
+};
+
+// bias_dropout_residual, over inputs {x, bias, residual}. Saves no mask:
+// backward regenerates it from the Philox state the forward drew it at.
+class BiasDropoutResidualBackward : public Node {
+ public:
+  BiasDropoutResidualBackward(double keep, double scale, GeneratorState rng)
+      : keep_(keep), scale_(scale), rng_(rng) {}
+  const char* name() const override { return "BiasDropoutResidualBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  double keep_, scale_;
+  GeneratorState rng_;
+};
+
+// ---- matmul ----
+
+// matmul, mm and bmm (NumPy semantics, including 1-D operands and batch
+// broadcasting).
+class MatmulBackward : public Node {
+ public:
+  MatmulBackward(const Tensor& a, const Tensor& b) : a_(a), b_(b) {}
+  const char* name() const override { return "MatmulBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    a_.release();
+    b_.release();
+  }
+
+ private:
+  SavedTensor a_, b_;
+};
+
+// ---- attention ----
+
+// scaled_dot_product_attention, over inputs {q, k, v}. Saves the output
+// and per-row logsumexp; the probabilities are recomputed, never stored.
+class AttentionBackward : public Node {
+ public:
+  AttentionBackward(const Tensor& q, const Tensor& k, const Tensor& v, const Tensor& out,
+                    const Tensor& lse, bool is_causal, double scale)
+      : q_(q), k_(k), v_(v), out_(out), lse_(lse), is_causal_(is_causal), scale_(scale) {}
+  const char* name() const override { return "ScaledDotProductAttentionBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    q_.release();
+    k_.release();
+    v_.release();
+    out_.release();
+    lse_.release();
+  }
+
+ private:
+  SavedTensor q_, k_, v_, out_, lse_;
+  bool is_causal_;
+  double scale_;
+};
+
+// ---- convolution ----
+
+// conv2d, over inputs {x, weight, bias}. Saves x in channels last, as the
+// kernels read it, and the memory format dx should take.
+class Conv2dBackward : public Node {
+ public:
+  Conv2dBackward(const Tensor& x, const Tensor& weight, const Conv2dParams& params,
+                 MemoryFormat x_format)
+      : x_(x), weight_(weight), params_(params), x_format_(x_format) {}
+  const char* name() const override { return "Conv2dBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+  void release_saved() override {
+    x_.release();
+    weight_.release();
+  }
+
+ private:
+  SavedTensor x_, weight_;
+  Conv2dParams params_;
+  MemoryFormat x_format_;
+};
+
+// ---- views and copies ----
+
+// view, reshape, squeeze and unsqueeze.
+class ReshapeBackward : public Node {
+ public:
+  explicit ReshapeBackward(const Tensor& self) : sizes_(self.sizes()) {}
+  const char* name() const override { return "ReshapeBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  Shape sizes_;
+};
+
+class TransposeBackward : public Node {
+ public:
+  TransposeBackward(int64_t d0, int64_t d1) : d0_(d0), d1_(d1) {}
+  const char* name() const override { return "TransposeBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  int64_t d0_, d1_;
+};
+
+class PermuteBackward : public Node {
+ public:
+  explicit PermuteBackward(std::vector<int64_t> dims) : dims_(std::move(dims)) {}
+  const char* name() const override { return "PermuteBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  std::vector<int64_t> dims_;
+};
+
+class ExpandBackward : public Node {
+ public:
+  explicit ExpandBackward(const Tensor& self) : sizes_(self.sizes()) {}
+  const char* name() const override { return "ExpandBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  Shape sizes_;
+};
+
+// slice (start already clamped) and select (step 0 marks a selected dim).
+class SliceBackward : public Node {
+ public:
+  SliceBackward(const Tensor& self, int64_t dim, int64_t start, int64_t step)
+      : sizes_(self.sizes()), dim_(dim), start_(start), step_(step) {}
+  const char* name() const override { return step_ == 0 ? "SelectBackward" : "SliceBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  Shape sizes_;
+  int64_t dim_, start_, step_;
+};
+
+// clone and contiguous: the gradient passes through unchanged.
+class CloneBackward : public Node {
+ public:
+  const char* name() const override { return "CloneBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+};
+
+// to(dtype) and to(device): the gradient goes back to the input's.
+class ToBackward : public Node {
+ public:
+  explicit ToBackward(const Tensor& self) : dtype_(self.dtype()), device_(self.device()) {}
+  const char* name() const override { return "ToBackward"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  DType dtype_;
+  Device device_;
+};
+
+}  // namespace xft::autograd
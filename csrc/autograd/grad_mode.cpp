@@ -0,0 +1,18 @@
+#include "autograd/grad_mode.h"
+
+namespace xft::autograd {
+
+namespace {
+thread_local bool t_grad_enabled = true;
+thread_local bool t_inference_enabled = false;
+}  // namespace
+
+bool GradMode::is_enabled() { return t_grad_enabled; }
+
+void GradMode::set_enabled(bool enabled) { t_grad_enabled = enabled; }
+
+bool InferenceMode::is_enabled() { return t_inference_enabled; }
+
+void InferenceMode::set_enabled(bool enabled) { t_inference_enabled = enabled; }
+
+}  // namespace xft::autograd
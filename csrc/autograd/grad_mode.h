@@ -0,0 +1,62 @@
+#pragma once
+
+namespace xft::autograd {
+
+// Per-thread switch for graph recording. While disabled, ops produce plain
+// tensors with no grad_fn even when their inputs require grad. backward()
+// runs with it disabled.
+struct GradMode {
+  static bool is_enabled();
+  static void set_enabled(bool enabled);
+};
+
+// Sets grad mode for a scope and restores the previous value on exit.
+class AutoGradMode {
+ public:
+  explicit AutoGradMode(bool enabled) : prev_(GradMode::is_enabled()) {
+    GradMode::set_enabled(enabled);
+  }
+  ~AutoGradMode() { GradMode::set_enabled(prev_); }
+
+  AutoGradMode(const AutoGradMode&) = delete;
+  AutoGradMode& operator=(const AutoGradMode&) = delete;
+
+ private:
+  bool prev_;
+};
+
+class NoGradGuard : public AutoGradMode {
+ public:
+  NoGradGuard() : AutoGradMode(false) {}
+};
+
+// Per-thread switch for serving code that never calls backward. It implies
+// grad mode off. Tensors allocated while it is on are inference tensors
+// (Tensor::is_inference()): they can never require grad or be saved for
+// backward, so no graph outside the scope can keep them alive. Elementwise
+// ops also write their result over a cast they made of their own input
+// instead of allocating another buffer.
+struct InferenceMode {
+  static bool is_enabled();
+  static void set_enabled(bool enabled);
+};
+
+// Sets inference mode for a scope, with grad mode off while it is on, and
+// restores both on exit.
+class InferenceModeGuard {
+ public:
+  explicit InferenceModeGuard(bool enabled = true)
+      : prev_(InferenceMode::is_enabled()), grad_(enabled ? false : GradMode::is_enabled()) {
+    InferenceMode::set_enabled(enabled);
+  }
+  ~InferenceModeGuard() { InferenceMode::set_enabled(prev_); }
+
+  InferenceModeGuard(const InferenceModeGuard&) = delete;
+  InferenceModeGuard& operator=(const InferenceModeGuard&) = delete;
+
+ private:
+  bool prev_;
+  AutoGradMode grad_;
+};
+
+}  // namespace xft::autograd
@@ -0,0 +1,118 @@
+#include "autograd/node.h"
+
+#include <atomic>
+
+#include "ops/elementwise.h"
+
+namespace xft::autograd {
+
+namespace {
+std::atomic<uint64_t> g_next_sequence_nr{0};
+std::atomic<int64_t> g_next_hook_id{0};
+}  // namespace
+
+SavedTensor::SavedTensor(const Tensor& t) {
+  if (!t.defined()) return;
+  XFT_CHECK(!t.is_inference(),
+            "autograd: a tensor created under inference_mode cannot be saved for backward; "
+            "clone() it outside inference_mode first");
+  tensor_ = t.detach();
+  version_ = t.storage()->version();
+}
+
+Tensor SavedTensor::unpack() const {
+  XFT_CHECK(!released_,
+            "backward: saved tensors were already freed; pass retain_graph=true to the first "
+            "backward() to run backward through the graph more than once");
+  if (tensor_.defined()) {
+    XFT_CHECK(tensor_.storage()->version() == version_,
+              "backward: a tensor saved for backward was modified in place");
+  }
+  return tensor_;
+}
+
+Node::Node() : sequence_nr_(g_next_sequence_nr.fetch_add(1, std::memory_order_relaxed)) {}
+
+Node::~Node() {
+  // Nodes only this one keeps alive have their edges moved onto a local
+  // stack before they die, so each destructor frees a bounded amount.
+  std::vector<std::shared_ptr<Node>> stack;
+  for (Edge& e : next_edges_) {
+    if (e.node && e.node.use_count() == 1) stack.push_back(std::move(e.node));
+  }
+  while (!stack.empty()) {
+    std::shared_ptr<Node> node = std::move(stack.back());
+    stack.pop_back();
+    for (Edge& e : node->next_edges_) {
+      if (e.node && e.node.use_count() == 1) stack.push_back(std::move(e.node));
+    }
+  }
+}
+
+std::vector<Tensor> AccumulateGrad::apply(std::vector<Tensor>&& grads) {
+  Tensor& g = grads[0];
+  if (!g.defined()) return {};
+  AutogradMeta* meta = variable_.impl()->autograd.get();
+  if (meta->grad.defined()) {
+    meta->grad = add(meta->grad, g);
+  } else if (g.is_contiguous() && g.use_count() == 1 && g.storage().use_count() == 1) {
+    // Nothing else can see this buffer, so the leaf can keep it.
+    meta->grad = std::move(g);
+  } else {
+    meta->grad = g.clone();
+  }
+  if (!meta->post_accumulate_grad_hooks.empty()) {
+    // A copy, so hooks may remove themselves.
+    const auto hooks = meta->post_accumulate_grad_hooks;
+    for (const auto& entry : hooks) entry.second(variable_);
+  }
+  return {};
+}
+
+int64_t add_post_accumulate_grad_hook(const Tensor& t, PostAccumulateGradHook hook) {
+  XFT_CHECK(t.defined() && t.requires_grad() && t.is_leaf(),
+            "post-accumulate-grad hooks go on leaves that require grad");
+  const int64_t id = g_next_hook_id.fetch_add(1, std::memory_order_relaxed);
+  t.impl()->autograd->post_accumulate_grad_hooks.emplace_back(id, std::move(hook));
+  return id;
+}
+
+void remove_post_accumulate_grad_hook(const Tensor& t, int64_t id) {
+  AutogradMeta* meta = t.impl()->autograd.get();
+  if (meta == nullptr) return;
+  auto& hooks = meta->post_accumulate_grad_hooks;
+  for (auto it = hooks.begin(); it != hooks.end(); ++it) {
+    if (it->first == id) {
+      hooks.erase(it);
+      return;
+    }
+  }
+}
+
+Edge gradient_edge(const Tensor& t) {
+  AutogradMeta* meta = t.impl()->autograd.get();
+  if (meta == nullptr) return {};
+  if (meta->grad_fn) return {meta->grad_fn, meta->output_nr};
+  if (!meta->requires_grad) return {};
+  std::shared_ptr<Node> acc = meta->grad_accumulator.lock();
+  if (!acc) {
+    acc = std::make_shared<AccumulateGrad>(t);
+    meta->grad_accumulator = acc;
+  }
+  return {std::move(acc), 0};
+}
+
+void set_history(const Tensor& out, std::shared_ptr<Node> node,
+                 std::initializer_list<Tensor> inputs) {
+  for (const Tensor& t : inputs) node->add_next_edge(t.defined() ? gradient_edge(t) : Edge{});
+  set_grad_fn(out, std::move(node), 0);
+}
+
+void set_grad_fn(const Tensor& out, std::shared_ptr<Node> node, int output_nr) {
+  auto& meta = out.impl()->autograd;
+  if (!meta) meta = std::make_shared<AutogradMeta>();
+  meta->grad_fn = std::move(node);
+  meta->output_nr = output_nr;
+}
+
+}  // namespace xft::autograd
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "autograd/grad_mode.h"
+#include "core/tensor.h"
+
+namespace xft::autograd {
+
+class Node;
+
+// Called with a leaf after backward accumulated into its grad().
+using PostAccumulateGradHook = std::function<void(const Tensor& leaf)>;
+
+// Where a gradient goes: input `input_nr` of `node`. An edge with no node
+// means the forward input did not require grad.
+struct Edge {
+  std::shared_ptr<Node> node;
+  int input_nr = 0;
+
+  bool valid() const { return node != nullptr; }
+};
+
+// Autograd state hung off a TensorImpl. A tensor requires grad either as a
+// leaf the user marked, or as the output of a recorded op (grad_fn set).
+struct AutogradMeta {
+  bool requires_grad = false;
+  Tensor grad;
+  std::shared_ptr<Node> grad_fn;
+  int output_nr = 0;
+  // The AccumulateGrad node of a leaf, shared by every op that uses it
+  // while some graph still refers to it.
+  std::weak_ptr<Node> grad_accumulator;
+  // Run in registration order, by id.
+  std::vector<std::pair<int64_t, PostAccumulateGradHook>> post_accumulate_grad_hooks;
+};
+
+// A tensor kept for backward. It holds a detached alias (so saving an op's
+// own output does not form a reference cycle through grad_fn) and the
+// storage version at save time, to catch later in-place writes.
+class SavedTensor {
+ public:
+  SavedTensor() = default;
+  explicit SavedTensor(const Tensor& t);
+
+  Tensor unpack() const;
+  void release() {
+    tensor_ = Tensor();
+    released_ = true;
+  }
+
+ private:
+  Tensor tensor_;
+  uint64_t version_ = 0;
+  bool released_ = false;
+};
+
+// One recorded op in the backward graph. apply() maps the gradient of the
+// op's output to one gradient per next edge (in forward input order); an
+// undefined tensor means "no gradient".
+class Node {
+ public:
+  Node();
+  // Tears down long chains iteratively; the default recursive release of
+  // next_edges_ would overflow the stack on deep graphs.
+  virtual ~Node();
+
+  Node(const Node&) = delete;
+  Node& operator=(const Node&) = delete;
+
+  virtual const char* name() const = 0;
+  virtual std::vector<Tensor> apply(std::vector<Tensor>&& grads) = 0;
+  // Frees saved tensors once backward has consumed them.
+  virtual void release_saved() {}
+
+  const std::vector<Edge>& next_edges() const { return next_edges_; }
+  void add_next_edge(Edge edge) { next_edges_.push_back(std::move(edge)); }
+  // Whether input i of the forward op needs a gradient at all.
+  bool needs_input_grad(size_t i) const {
+    return i < next_edges_.size() && next_edges_[i].valid();
+  }
+  // Creation order; later nodes run first when several are ready.
+  uint64_t sequence_nr() const { return sequence_nr_; }
+
+ private:
+  std::vector<Edge> next_edges_;
+  uint64_t sequence_nr_;
+};
+
+// Sink for a leaf: adds incoming gradients into leaf.grad().
+class AccumulateGrad : public Node {
+ public:
+  explicit AccumulateGrad(Tensor variable) : variable_(std::move(variable)) {}
+
+  const char* name() const override { return "AccumulateGrad"; }
+  std::vector<Tensor> apply(std::vector<Tensor>&& grads) override;
+
+ private:
+  Tensor variable_;
+};
+
+// The edge a gradient for `t` should flow into: its grad_fn, a leaf's
+// AccumulateGrad, or an invalid edge when t does not require grad.
+Edge gradient_edge(const Tensor& t);
+
+// Registers `hook` on leaf `t`, which must require grad, and returns an id
+// for remove_post_accumulate_grad_hook. Hooks run on the backward thread,
+// after the leaf's grad() holds the new total.
+int64_t add_post_accumulate_grad_hook(const Tensor& t, PostAccumulateGradHook hook);
+void remove_post_accumulate_grad_hook(const Tensor& t, int64_t id);
+
+// True when grad mode is on and any input requires grad.
+inline bool needs_grad(std::initializer_list<Tensor> inputs) {
+  if (!GradMode::is_enabled()) return false;
+  for (const Tensor& t : inputs) {
+    if (t.defined() && t.requires_grad()) return true;
+  }
+  return false;
+}
+
+// Makes `node` the grad_fn of `out`, with one next edge per input.
+void set_history(const Tensor& out, std::shared_ptr<Node> node,
+                 std::initializer_list<Tensor> inputs);
+// Makes `node`, whose edges are already in place, the grad_fn of output
+// `output_nr` of a multi-output op.
+void set_grad_fn(const Tensor& out, std::shared_ptr<Node> node, int output_nr);
+
+// Records op `NodeT` (constructed from args) producing `out` from `inputs`,
+// if any input requires grad. Ops call this after computing their result.
+template <typename NodeT, typename... Args>
+void record(const Tensor& out, std::initializer_list<Tensor> inputs, Args&&... args) {
+  if (!needs_grad(inputs)) return;
+  set_history(out, std::make_shared<NodeT>(std::forward<Args>(args)...), inputs);
+}
+
+}  // namespace xft::autograd
@@ -0,0 +1,52 @@
+#include "core/allocator.h"
+
+#include <cstdlib>
+
+#include "core/macros.h"
+
+namespace xft {
+
+namespace {
+
+constexpr size_t kCpuAlignment = 64;
+
+class CpuAllocator final : public Allocator {
+ public:
+  void* allocate(size_t nbytes, Device) override {
+    if (nbytes == 0) return nullptr;
+    size_t rounded = (nbytes + kCpuAlignment - 1) / kCpuAlignment * kCpuAlignment;
+    void* ptr = std::aligned_alloc(kCpuAlignment, rounded);
+    XFT_CHECK(ptr != nullptr, "cpu allocator: out of memory allocating ", nbytes, " bytes");
+    return ptr;
+  }
+
+  void deallocate(void* ptr, Device) override { std::free(ptr); }
+};
+
+// Function-local so backends may register from their own static
+// initializers regardless of translation-unit init order.
+Allocator*& allocator_slot(DeviceType type) {
+  static Allocator* slots[2] = {cpu_allocator(), nullptr};
+  return slots[static_cast<int>(type)];
+}
+
+}  // namespace
+
+Allocator* cpu_allocator() {
+  static CpuAllocator allocator;
+  return &allocator;
+}
+
+Allocator* get_allocator(DeviceType type) {
+  Allocator* a = allocator_slot(type);
+  XFT_CHECK(a != nullptr, "no allocator registered for ",
+            type == DeviceType::CUDA ? "cuda" : "cpu",
+            " (was xft built with XFT_USE_CUDA?)");
+  return a;
+}
+
+void set_allocator(DeviceType type, Allocator* allocator) {
+  allocator_slot(type) = allocator;
+}
+
+}  // namespace xft
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+#include "core/device.h"
+
+namespace xft {
+
+// Backends provide one allocator per device type. Storage asks the registry
+// for memory and hands the pointer back to the same allocator when freed.
+class Allocator {
+ public:
+  virtual ~Allocator() = default;
+  virtual void* allocate(size_t nbytes, Device device) = 0;
+  virtual void deallocate(void* ptr, Device device) = 0;
+};
+
+// 64-byte aligned host memory, so SIMD kernels can use aligned loads.
+Allocator* cpu_allocator();
+
+Allocator* get_allocator(DeviceType type);
+void set_allocator(DeviceType type, Allocator* allocator);
+
+}  // namespace xft
@@ -0,0 +1,63 @@
+#include "core/autocast.h"
+
+namespace xft::autocast {
+
+namespace {
+
+thread_local State t_state;
+
+int slot(DeviceType type) { return type == DeviceType::CUDA ? 1 : 0; }
+
+bool active_for(const Tensor& t) {
+  return t.defined() && t_state.enabled[slot(t.device().type)];
+}
+
+// Wider floating dtypes rank higher; float16 and bfloat16 tie, and a tie
+// between the two resolves to float32.
+int rank(DType dtype) {
+  switch (dtype) {
+    case DType::Float64: return 3;
+    case DType::Float32: return 2;
+    case DType::Float16:
+    case DType::BFloat16: return 1;
+    default: return 0;
+  }
+}
+
+}  // namespace
+
+State state() { return t_state; }
+
+void set_state(const State& state) { t_state = state; }
+
+bool is_enabled(DeviceType type) { return t_state.enabled[slot(type)]; }
+
+void set_enabled(DeviceType type, bool enabled) { t_state.enabled[slot(type)] = enabled; }
+
+DType get_dtype(DeviceType type) { return t_state.dtype[slot(type)]; }
+
+void set_dtype(DeviceType type, DType dtype) {
+  XFT_CHECK(is_reduced_floating(dtype), "autocast: expected float16 or bfloat16, got ",
+            dtype_name(dtype));
+  t_state.dtype[slot(type)] = dtype;
+}
+
+Tensor to_lower(const Tensor& t) {
+  if (!active_for(t) || t.dtype() != DType::Float32) return t;
+  return t.to(get_dtype(t.device().type));
+}
+
+Tensor to_float32(const Tensor& t) {
+  if (!active_for(t) || !is_reduced_floating(t.dtype())) return t;
+  return t.to(DType::Float32);
+}
+
+std::pair<Tensor, Tensor> promote(const Tensor& a, const Tensor& b) {
+  if (!active_for(a) || !b.defined() || a.dtype() == b.dtype()) return {a, b};
+  const int ra = rank(a.dtype()), rb = rank(b.dtype());
+  if (ra == 0 || rb == 0) return {a, b};
+  const DType to = ra == rb ? DType::Float32 : (ra > rb ? a.dtype() : b.dtype());
+  return {a.to(to), b.to(to)};
+}
+
+}  // namespace xft::autocast
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <utility>
+
+#include "core/tensor.h"
+
+namespace xft::autocast {
+
+// Per-thread automatic mixed precision, one switch and one lower-precision
+// dtype per device type (float16 on CUDA and bfloat16 on CPU by default).
+// While it is on for a tensor's device, ops cast their floating inputs at
+// entry through the differentiable Tensor::to():
+//  - matmul-like ops (matmul, mm, bmm, scaled_dot_product_attention,
+//    conv2d) run float32 inputs in the lower dtype;
+//  - precision-sensitive ops (sum, mean, softmax, layer_norm, rms_norm, exp,
+//    log) run 16-bit inputs in float32;
+//  - binary ops and the fused epilogues promote mixed floating inputs to
+//    the widest dtype among them.
+// float64 is never cast. backward() runs with autocast off; the casts
+// recorded in the forward already give every gradient its input's dtype.
+struct State {
+  bool enabled[2] = {false, false};
+  DType dtype[2] = {DType::BFloat16, DType::Float16};
+};
+
+State state();
+void set_state(const State& state);
+
+bool is_enabled(DeviceType type);
+void set_enabled(DeviceType type, bool enabled);
+DType get_dtype(DeviceType type);
+// dtype must be float16 or bfloat16.
+void set_dtype(DeviceType type, DType dtype);
+
+// Installs a state for a scope and restores the previous one on exit.
+class StateGuard {
+ public:
+  explicit StateGuard(const State& state) : prev_(autocast::state()) { set_state(state); }
+  ~StateGuard() { set_state(prev_); }
+
+  StateGuard(const StateGuard&) = delete;
+  StateGuard& operator=(const StateGuard&) = delete;
+
+ private:
+  State prev_;
+};
+
+// The entry casts; each returns its input unchanged when autocast is off for
+// the tensor's device or the policy does not apply to its dtype.
+// float32 -> the lower dtype.
+Tensor to_lower(const Tensor& t);
+// float16 / bfloat16 -> float32.
+Tensor to_float32(const Tensor& t);
+// Both operands -> the widest floating dtype of the two, when they differ.
+std::pair<Tensor, Tensor> promote(const Tensor& a, const Tensor& b);
+
+}  // namespace xft::autocast
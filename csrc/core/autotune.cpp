@@ -0,0 +1,196 @@
+#include "core/autotune.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "core/parallel.h"
+#include "cpu/kernels.h"
+
+namespace xft::autotune {
+
+namespace {
+
+// Timed runs per candidate; the first also warms caches and page tables,
+// and the minimum discards it along with scheduling noise. A run as long as
+// kLongRun is timed only once: the noise is small next to it, and big
+// problems would otherwise make the first call very slow.
+constexpr int kRuns = 3;
+constexpr double kLongRun = 0.05;
+
+bool default_enabled() {
+  const char* env = std::getenv("XFT_AUTOTUNE");
+  return env == nullptr || *env == '\0' || std::strcmp(env, "0") != 0;
+}
+
+std::string default_cache_path() {
+  if (const char* env = std::getenv("XFT_AUTOTUNE_CACHE")) return env;
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && *xdg != '\0') {
+    return std::string(xdg) + "/xft/autotune.txt";
+  }
+  if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+    return std::string(home) + "/.cache/xft/autotune.txt";
+  }
+  return "";
+}
+
+// Winners by key, backed by an append-only file. The cache is best effort:
+// a file that cannot be read or written just means more tuning.
+class Cache {
+ public:
+  std::string path() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return path_;
+  }
+
+  void set_path(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    winners_.clear();
+    loaded_ = false;
+  }
+
+  void clear(bool remove_file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    winners_.clear();
+    if (remove_file && !path_.empty()) {
+      std::error_code ec;
+      std::filesystem::remove(path_, ec);
+    }
+    // Nothing left to read back.
+    loaded_ = true;
+  }
+
+  bool find(const std::string& key, std::string& winner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    load();
+    auto it = winners_.find(key);
+    if (it == winners_.end()) return false;
+    winner = it->second;
+    return true;
+  }
+
+  void insert(const std::string& key, const std::string& winner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    load();
+    winners_[key] = winner;
+    if (path_.empty()) return;
+    std::error_code ec;
+    const std::filesystem::path parent = std::filesystem::path(path_).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+    // A writer that died mid-line leaves no trailing newline; start a new
+    // line rather than extend its fragment.
+    bool mid_line = false;
+    if (std::ifstream tail(path_, std::ios::binary | std::ios::ate); tail && tail.tellg() > 0) {
+      tail.seekg(-1, std::ios::end);
+      mid_line = tail.get() != '\n';
+    }
+    std::ofstream out(path_, std::ios::app);
+    if (out) out << (mid_line ? "\n" : "") << key << ' ' << winner << '\n';
+  }
+
+ private:
+  void load() {
+    if (loaded_) return;
+    loaded_ = true;
+    if (path_.empty()) return;
+    std::ifstream in(path_);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') continue;
+      const size_t space = line.find(' ');
+      if (space == std::string::npos || space == 0 || space + 1 == line.size()) continue;
+      winners_[line.substr(0, space)] = line.substr(space + 1);
+    }
+  }
+
+  std::mutex mutex_;
+  std::string path_ = default_cache_path();
+  bool loaded_ = false;
+  std::unordered_map<std::string, std::string> winners_;
+};
+
+Cache& cache() {
+  static Cache* c = new Cache();
+  return *c;
+}
+
+std::atomic<bool>& enabled_flag() {
+  static std::atomic<bool> flag(default_enabled());
+  return flag;
+}
+
+}  // namespace
+
+bool enabled() { return enabled_flag().load(std::memory_order_relaxed); }
+
+void set_enabled(bool on) { enabled_flag().store(on, std::memory_order_relaxed); }
+
+std::string cache_path() { return cache().path(); }
+
+void set_cache_path(const std::string& path) { cache().set_path(path); }
+
+void clear(bool remove_file) { cache().clear(remove_file); }
+
+std::string make_key(const std::string& arch, const char* op, DType dtype,
+                     std::initializer_list<int64_t> dims) {
+  std::ostringstream key;
+  key << arch << '/' << op << '/' << dtype_name(dtype) << '/';
+  bool first = true;
+  for (int64_t d : dims) {
+    if (!first) key << 'x';
+    key << d;
+    first = false;
+  }
+  return key.str();
+}
+
+std::string cpu_arch() {
+  return std::string("cpu-") + cpu::capability_name(cpu::cpu_capability()) + "-t" +
+         std::to_string(get_num_threads());
+}
+
+int select(const std::string& key, const std::vector<std::string>& candidates,
+           const std::function<double(int)>& time) {
+  if (!enabled() || candidates.size() < 2) return 0;
+  std::string winner;
+  if (cache().find(key, winner)) {
+    auto it = std::find(candidates.begin(), candidates.end(), winner);
+    if (it != candidates.end()) return static_cast<int>(it - candidates.begin());
+  }
+  if (!time) return 0;
+  int best = 0;
+  double best_time = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < static_cast<int>(candidates.size()); i++) {
+    const double t = time(i);
+    if (t < best_time) {
+      best = i;
+      best_time = t;
+    }
+  }
+  cache().insert(key, candidates[best]);
+  return best;
+}
+
+double time_cpu(const std::function<void()>& fn) {
+  using Clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::infinity();
+  for (int r = 0; r < kRuns; r++) {
+    const auto start = Clock::now();
+    fn();
+    const double t = std::chrono::duration<double>(Clock::now() - start).count();
+    best = std::min(best, t);
+    if (t >= kLongRun) break;
+  }
+  return best;
+}
+
+}  // namespace xft::autotune
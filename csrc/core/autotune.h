@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "core/dtype.h"
+
+namespace xft::autotune {
+
+// Per-shape kernel selection. No one tile shape is fastest across the
+// problems a model runs: a skinny GEMM wants small tiles to fill the
+// machine, a large square one big tiles for reuse. A tuned kernel lists the
+// configurations it can run as named candidates; on the first call for a
+// shape, select() times every candidate on the real operands and keeps the
+// fastest, and later calls (in this process and, through the on-disk cache,
+// in later ones) go straight to it.
+//
+// Candidate 0 is always the kernel's heuristic default: it runs when tuning
+// is off, for problems too small to be worth timing, and while a CUDA
+// stream is being captured.
+
+// XFT_AUTOTUNE=0 turns tuning off (default on); set_enabled overrides it.
+// While off, select() returns 0 without consulting the cache.
+bool enabled();
+void set_enabled(bool on);
+
+// The cache file: XFT_AUTOTUNE_CACHE if set, else autotune.txt under
+// $XDG_CACHE_HOME/xft or ~/.cache/xft. Each line is "key winner", appended
+// as winners are found, with later lines taking precedence; it is read on
+// the first select(). An empty path keeps winners in memory only. Setting
+// a path drops the winners loaded so far and reads the new file.
+std::string cache_path();
+void set_cache_path(const std::string& path);
+
+// Forgets every winner in memory, so shapes are timed again; with
+// remove_file the cache file is deleted too.
+void clear(bool remove_file = false);
+
+// The cache key of one problem: the hardware it was timed on (cpu_arch()
+// or a CUDA "sm_XX"), the op, the dtype and the dims that change which
+// candidate wins.
+std::string make_key(const std::string& arch, const char* op, DType dtype,
+                     std::initializer_list<int64_t> dims);
+
+// "cpu-<capability>-t<threads>": the kernel table in use and the thread
+// count both move the best tiles.
+std::string cpu_arch();
+
+// The index into `candidates` to run for `key`: the cached winner when
+// there is one, otherwise the fastest by time(i) (seconds for one run of
+// candidate i), which is then cached. Only the candidates' names are
+// stored, so a list that changes between releases just retunes.
+// time may leave any candidate's output behind; callers run the winner
+// again when the candidates do not compute bit-identical results. With no
+// time function (while a CUDA stream is captured, say) an uncached key
+// gets 0 and stays uncached.
+int select(const std::string& key, const std::vector<std::string>& candidates,
+           const std::function<double(int)>& time);
+
+// Seconds for one call of fn on the CPU: the best of a few runs (one for
+// long ones).
+double time_cpu(const std::function<void()>& fn);
+
+}  // namespace xft::autotune
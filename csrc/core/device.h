@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "core/macros.h"
+
+namespace xft {
+
+enum class DeviceType : int32_t {
+  CPU = 0,
+  CUDA = 1,
+};
+constexpr int kNumDeviceTypes = 2;
+
+struct Device {
+  DeviceType type = DeviceType::CPU;
+  int index = 0;
+
+  Device() = default;
+  Device(DeviceType t, int i = 0) : type(t), index(i) {}
+
+  bool is_cpu() const { return type == DeviceType::CPU; }
+  bool is_cuda() const { return type == DeviceType::CUDA; }
+
+  bool operator==(const Device& o) const { return type == o.type && index == o.index; }
+  bool operator!=(const Device& o) const { return !(*this == o); }
+
+  std::string str() const {
+    return is_cpu() ? std::string("cpu") : "cuda:" + std::to_string(index);
+  }
+};
+
+}  // namespace xft
@@ -0,0 +1,23 @@
+#include "core/dispatch.h"
+
+#include "cpu/kernels.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/elementwise.h"
+#endif
+
+namespace xft {
+
+const ElementwiseKernels& elementwise_kernels() {
+  static const ElementwiseKernels table = [] {
+    ElementwiseKernels t;
+    cpu::cpu_kernels().register_elementwise(t);
+#ifdef XFT_USE_CUDA
+    cuda::register_elementwise(t);
+#endif
+    return t;
+  }();
+  return table;
+}
+
+}  // namespace xft
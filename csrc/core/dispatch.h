@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/device.h"
+#include "core/dtype.h"
+#include "core/macros.h"
+#include "core/tensor_iterator.h"
+#include "ops/op_kinds.h"
+
+namespace xft {
+
+// Kernel tables keyed by (op, device type, dtype). Backends fill their
+// slots once, with template instantiations for one op and one element type
+// (see register_kernels), so an op finds its kernel with one indexed load
+// and the kernel's inner loop never switches on op or dtype. A null slot
+// means no kernel: either the backend lacks it or the dtype is invalid for
+// the op.
+template <typename Op, int kNumOps, typename Fn>
+class DispatchTable {
+ public:
+  void set(Op op, DeviceType device, DType dtype, Fn fn) { slots_[index(op, device, dtype)] = fn; }
+
+  Fn find(Op op, DeviceType device, DType dtype) const {
+    return slots_[index(op, device, dtype)];
+  }
+
+  // find(), throwing when there is no kernel.
+  Fn lookup(Op op, Device device, DType dtype, const char* name) const {
+    const Fn fn = find(op, device.type, dtype);
+    XFT_CHECK(fn != nullptr, name, ": no kernel for ", dtype_name(dtype), " tensors on ",
+              device.str());
+    return fn;
+  }
+
+ private:
+  static int index(Op op, DeviceType device, DType dtype) {
+    return (static_cast<int>(op) * kNumDeviceTypes + static_cast<int>(device)) * kNumDTypes +
+           static_cast<int>(dtype);
+  }
+
+  Fn slots_[kNumOps * kNumDeviceTypes * kNumDTypes] = {};
+};
+
+template <auto... kOps>
+struct OpList {};
+template <typename... Ts>
+struct TypeList {};
+
+// Sets K<op, T>::run as the `device` kernel of every op in kOps for every
+// element type T in Ts:
+//
+//   register_kernels<BinaryKernelFor>(table.binary, DeviceType::CPU,
+//                                     OpList<BinaryOp::Add, BinaryOp::Sub>(),
+//                                     TypeList<float, double>());
+template <template <auto, typename> class K, typename Table, auto kOp, typename... Ts>
+void register_op(Table& table, DeviceType device, TypeList<Ts...>) {
+  (table.set(kOp, device, DTypeOf<Ts>::value, &K<kOp, Ts>::run), ...);
+}
+
+template <template <auto, typename> class K, typename Table, auto... kOps, typename... Ts>
+void register_kernels(Table& table, DeviceType device, OpList<kOps...>, TypeList<Ts...> types) {
+  (register_op<K, Table, kOps>(table, device, types), ...);
+}
+
+// The element types of each elementwise op family.
+using FloatingTypes = TypeList<float, double, Half, BFloat16>;
+using NumericTypes = TypeList<float, double, int32_t, int64_t, uint8_t, Half, BFloat16>;
+using UnaryOps = OpList<UnaryOp::Exp, UnaryOp::Log, UnaryOp::Sqrt, UnaryOp::Tanh,
+                        UnaryOp::Sigmoid, UnaryOp::Relu, UnaryOp::Gelu>;
+// Ops for every numeric dtype, and the activation backwards (floating only).
+using ArithmeticOps = OpList<BinaryOp::Add, BinaryOp::Sub, BinaryOp::Mul, BinaryOp::Div,
+                             BinaryOp::Maximum, BinaryOp::Minimum, BinaryOp::GeMask,
+                             BinaryOp::EqMask>;
+using BackwardOps = OpList<BinaryOp::ReluBackward, BinaryOp::SigmoidBackward,
+                           BinaryOp::TanhBackward, BinaryOp::GeluBackward>;
+
+// An elementwise kernel over a built TensorIterator with operand 0 the
+// output: on CPU it splits the iteration over the thread pool, on CUDA it
+// launches on the current stream of the iterator's device.
+using ElementwiseKernel = void (*)(const TensorIterator& iter);
+
+struct ElementwiseKernels {
+  DispatchTable<UnaryOp, kNumUnaryOps, ElementwiseKernel> unary;
+  DispatchTable<BinaryOp, kNumBinaryOps, ElementwiseKernel> binary;
+};
+
+// Built on first use from the CPU kernels of the active ISA (cpu_kernels())
+// and, in CUDA builds, cuda/elementwise.cu.
+const ElementwiseKernels& elementwise_kernels();
+
+}  // namespace xft
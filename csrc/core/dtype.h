@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core/half.h"
+#include "core/macros.h"
+
+namespace xft {
+
+// Numeric codes are part of the C ABI (xft/dtype.py mirrors them).
+enum class DType : int32_t {
+  Float32 = 0,
+  Float64 = 1,
+  Int32 = 2,
+  Int64 = 3,
+  UInt8 = 4,
+  Bool = 5,
+  Float16 = 6,
+  BFloat16 = 7,
+  Int8 = 8,
+};
+constexpr int kNumDTypes = 9;
+
+inline size_t element_size(DType dtype) {
+  switch (dtype) {
+    case DType::Float32: return 4;
+    case DType::Float64: return 8;
+    case DType::Int32: return 4;
+    case DType::Int64: return 8;
+    case DType::UInt8: return 1;
+    case DType::Bool: return 1;
+    case DType::Float16: return 2;
+    case DType::BFloat16: return 2;
+    case DType::Int8: return 1;
+  }
+  XFT_FAIL("unknown dtype ", static_cast<int>(dtype));
+}
+
+inline const char* dtype_name(DType dtype) {
+  switch (dtype) {
+    case DType::Float32: return "float32";
+    case DType::Float64: return "float64";
+    case DType::Int32: return "int32";
+    case DType::Int64: return "int64";
+    case DType::UInt8: return "uint8";
+    case DType::Bool: return "bool";
+    case DType::Float16: return "float16";
+    case DType::BFloat16: return "bfloat16";
+    case DType::Int8: return "int8";
+  }
+  return "unknown";
+}
+
+// The 16-bit floats are storage formats: kernels compute them in float.
+inline bool is_reduced_floating(DType dtype) {
+  return dtype == DType::Float16 || dtype == DType::BFloat16;
+}
+
+inline bool is_floating(DType dtype) {
+  return dtype == DType::Float32 || dtype == DType::Float64 || is_reduced_floating(dtype);
+}
+
+// The DType of a C++ element type, for code templated on it.
+template <typename T>
+struct DTypeOf;
+template <> struct DTypeOf<float> { static constexpr DType value = DType::Float32; };
+template <> struct DTypeOf<double> { static constexpr DType value = DType::Float64; };
+template <> struct DTypeOf<int32_t> { static constexpr DType value = DType::Int32; };
+template <> struct DTypeOf<int64_t> { static constexpr DType value = DType::Int64; };
+template <> struct DTypeOf<uint8_t> { static constexpr DType value = DType::UInt8; };
+template <> struct DTypeOf<bool> { static constexpr DType value = DType::Bool; };
+template <> struct DTypeOf<Half> { static constexpr DType value = DType::Float16; };
+template <> struct DTypeOf<BFloat16> { static constexpr DType value = DType::BFloat16; };
+template <> struct DTypeOf<int8_t> { static constexpr DType value = DType::Int8; };
+
+}  // namespace xft
+
+// Runs the lambda body with `scalar_t` bound to the C++ type of DTYPE.
+#define XFT_DISPATCH_CASE(ENUM, TYPE, ...) \
+  case ::xft::DType::ENUM: {               \
+    using scalar_t = TYPE;                 \
+    __VA_ARGS__();                         \
+    break;                                 \
+  }
+
+#define XFT_DISPATCH_ALL_TYPES(DTYPE, NAME, ...)                  \
+  switch (DTYPE) {                                                \
+    XFT_DISPATCH_CASE(Float32, float, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Float64, double, __VA_ARGS__)               \
+    XFT_DISPATCH_CASE(Int32, int32_t, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Int64, int64_t, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(UInt8, uint8_t, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Bool, bool, __VA_ARGS__)                    \
+    default:                                                      \
+      XFT_FAIL(NAME, ": unsupported dtype ", ::xft::dtype_name(DTYPE)); \
+  }
+
+// ALL_TYPES plus the 16-bit floats and int8 (a storage type for quantized
+// weights, ops/quantized.h), for copies and fills.
+#define XFT_DISPATCH_ALL_TYPES_AND_HALF(DTYPE, NAME, ...)         \
+  switch (DTYPE) {                                                \
+    XFT_DISPATCH_CASE(Float32, float, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Float64, double, __VA_ARGS__)               \
+    XFT_DISPATCH_CASE(Int32, int32_t, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Int64, int64_t, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(UInt8, uint8_t, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Bool, bool, __VA_ARGS__)                    \
+    XFT_DISPATCH_CASE(Float16, ::xft::Half, __VA_ARGS__)          \
+    XFT_DISPATCH_CASE(BFloat16, ::xft::BFloat16, __VA_ARGS__)     \
+    XFT_DISPATCH_CASE(Int8, int8_t, __VA_ARGS__)                  \
+    default:                                                      \
+      XFT_FAIL(NAME, ": unsupported dtype ", ::xft::dtype_name(DTYPE)); \
+  }
+
+#define XFT_DISPATCH_FLOATING_TYPES(DTYPE, NAME, ...)             \
+  switch (DTYPE) {                                                \
+    XFT_DISPATCH_CASE(Float32, float, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Float64, double, __VA_ARGS__)               \
+    default:                                                      \
+      XFT_FAIL(NAME, ": unsupported dtype ", ::xft::dtype_name(DTYPE)); \
+  }
+
+#define XFT_DISPATCH_HALF_TYPES(DTYPE, NAME, ...)                 \
+  switch (DTYPE) {                                                \
+    XFT_DISPATCH_CASE(Float16, ::xft::Half, __VA_ARGS__)          \
+    XFT_DISPATCH_CASE(BFloat16, ::xft::BFloat16, __VA_ARGS__)     \
+    default:                                                      \
+      XFT_FAIL(NAME, ": unsupported dtype ", ::xft::dtype_name(DTYPE)); \
+  }
+
+#define XFT_DISPATCH_FLOATING_AND_HALF_TYPES(DTYPE, NAME, ...)    \
+  switch (DTYPE) {                                                \
+    XFT_DISPATCH_CASE(Float32, float, __VA_ARGS__)                \
+    XFT_DISPATCH_CASE(Float64, double, __VA_ARGS__)               \
+    XFT_DISPATCH_CASE(Float16, ::xft::Half, __VA_ARGS__)          \
+    XFT_DISPATCH_CASE(BFloat16, ::xft::BFloat16, __VA_ARGS__)     \
+    default:                                                      \
+      XFT_FAIL(NAME, ": unsupported dtype ", ::xft::dtype_name(DTYPE)); \
+  }
@@ -0,0 +1,74 @@
+#include "core/generator.h"
+
+#include <memory>
+#include <vector>
+
+namespace xft {
+
+GeneratorState Generator::reserve(uint64_t blocks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const GeneratorState first = state_;
+  state_.offset += blocks;
+  return first;
+}
+
+GeneratorState Generator::state() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return state_;
+}
+
+void Generator::set_state(const GeneratorState& state) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  state_ = state;
+}
+
+void Generator::begin_graph_capture(const uint64_t* base) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  XFT_CHECK(state_.graph_base == nullptr, "generator: a graph capture is already underway");
+  saved_ = state_;
+  state_ = {saved_.seed, 0, base};
+}
+
+uint64_t Generator::end_graph_capture() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  XFT_CHECK(state_.graph_base != nullptr, "generator: no graph capture is underway");
+  const uint64_t blocks = state_.offset;
+  state_ = saved_;
+  return blocks;
+}
+
+namespace {
+
+std::mutex g_mutex;
+uint64_t g_seed = kDefaultSeed;
+// Never freed, so references handed out stay valid.
+std::vector<std::unique_ptr<Generator>>* g_cuda = new std::vector<std::unique_ptr<Generator>>;
+
+Generator& cpu_generator() {
+  static Generator* gen = new Generator(kDefaultSeed);
+  return *gen;
+}
+
+}  // namespace
+
+Generator& default_generator(Device device) {
+  if (device.is_cpu()) return cpu_generator();
+  XFT_CHECK(device.index >= 0, "default_generator: bad device ", device.str());
+  std::lock_guard<std::mutex> lock(g_mutex);
+  auto& gens = *g_cuda;
+  if (gens.size() <= static_cast<size_t>(device.index)) gens.resize(device.index + 1);
+  auto& gen = gens[device.index];
+  if (!gen) gen = std::make_unique<Generator>(g_seed);
+  return *gen;
+}
+
+void manual_seed(uint64_t seed) {
+  cpu_generator().manual_seed(seed);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_seed = seed;
+  for (auto& gen : *g_cuda) {
+    if (gen) gen->manual_seed(seed);
+  }
+}
+
+}  // namespace xft
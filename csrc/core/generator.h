@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "core/device.h"
+
+namespace xft {
+
+constexpr uint64_t kDefaultSeed = 67280421310721ull;
+
+// Philox stream position: the key and the first unused block counter.
+struct GeneratorState {
+  uint64_t seed = kDefaultSeed;
+  uint64_t offset = 0;
+  // Set while a CUDA graph is being captured: the device address of the
+  // {seed, offset} pair the graph writes before each replay. Kernels then
+  // use that seed and count `offset` from that offset, so every replay
+  // draws fresh numbers.
+  const uint64_t* graph_base = nullptr;
+};
+
+// Per-device random stream (core/philox.h). Each random op reserves a
+// contiguous range of counters when it is launched, so the state fully
+// determines what the next ops draw; saving and restoring it replays them
+// exactly, which activation checkpointing relies on.
+class Generator {
+ public:
+  explicit Generator(uint64_t seed = kDefaultSeed) : state_{seed, 0} {}
+
+  Generator(const Generator&) = delete;
+  Generator& operator=(const Generator&) = delete;
+
+  // Reserves `blocks` fresh counters: returns the seed and the first of
+  // them, and advances past them.
+  GeneratorState reserve(uint64_t blocks);
+
+  GeneratorState state() const;
+  void set_state(const GeneratorState& state);
+  void manual_seed(uint64_t seed) { set_state({seed, 0}); }
+
+  // Between these, reserve() hands out offsets relative to `base` (see
+  // GeneratorState::graph_base) and the real state is left alone.
+  // end_graph_capture() returns how many counters the capture reserved,
+  // which each replay then reserves for real.
+  void begin_graph_capture(const uint64_t* base);
+  uint64_t end_graph_capture();
+
+ private:
+  mutable std::mutex mutex_;
+  GeneratorState state_;
+  GeneratorState saved_;  // the real state, during a graph capture
+};
+
+// The generator random ops on `device` draw from.
+Generator& default_generator(Device device);
+// Reseeds the CPU generator and every CUDA device's, including ones not
+// used yet.
+void manual_seed(uint64_t seed);
+
+}  // namespace xft
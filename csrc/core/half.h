@@ -0,0 +1,108 @@
+#pragma once
+
+// Host-side storage types for the 16-bit floating dtypes. Both are plain
+// bit patterns with round-to-nearest-even conversion from float; arithmetic
+// happens in float (the CPU kernels widen, CUDA kernels use __half and
+// __nv_bfloat16 with float accumulation, see cuda/dtype_utils.h).
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace xft {
+
+namespace detail {
+
+inline uint32_t float_bits(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  return x;
+}
+
+inline float bits_float(uint32_t x) {
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+// IEEE binary16: 1 sign, 5 exponent, 10 mantissa bits.
+inline uint16_t float_to_half_bits(float f) {
+  uint32_t x = float_bits(f);
+  const uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000u);
+  x &= 0x7fffffffu;
+  if (x > 0x7f800000u) return sign | 0x7e00u;   // NaN
+  if (x >= 0x47800000u) return sign | 0x7c00u;  // |f| >= 2^16: inf
+  if (x < 0x38800000u) {
+    // Below 2^-14 the result is subnormal: adding 0.5f lines the half's
+    // units up with float's last mantissa bit, so the FPU does the rounding.
+    return sign | static_cast<uint16_t>(float_bits(bits_float(x) + 0.5f) - 0x3f000000u);
+  }
+  // Rebias the exponent and round the 13 dropped bits to nearest even; a
+  // carry out of the mantissa bumps the exponent (up to inf) as it should.
+  x += (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu + ((x >> 13) & 1u);
+  return sign | static_cast<uint16_t>(x >> 13);
+}
+
+inline float half_bits_to_float(uint16_t h) {
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  const uint32_t exponent = (h >> 10) & 0x1fu;
+  const uint32_t mantissa = h & 0x3ffu;
+  if (exponent == 0x1f) return bits_float(sign | 0x7f800000u | (mantissa << 13));
+  if (exponent == 0) {
+    const float v = static_cast<float>(mantissa) * 5.9604644775390625e-8f;  // 2^-24
+    return sign ? -v : v;
+  }
+  return bits_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+// bfloat16 is the top half of a float32.
+inline uint16_t float_to_bfloat16_bits(float f) {
+  const uint32_t x = float_bits(f);
+  if ((x & 0x7fffffffu) > 0x7f800000u) return static_cast<uint16_t>((x >> 16) | 0x40u);
+  return static_cast<uint16_t>((x + 0x7fffu + ((x >> 16) & 1u)) >> 16);
+}
+
+inline float bfloat16_bits_to_float(uint16_t b) {
+  return bits_float(static_cast<uint32_t>(b) << 16);
+}
+
+}  // namespace detail
+
+// Converts from anything convertible to float (numbers and the other 16-bit
+// type); converts implicitly to float, so static_cast to any arithmetic type
+// goes through float.
+struct Half {
+  uint16_t x = 0;
+
+  Half() = default;
+  template <typename T, typename = std::enable_if_t<std::is_convertible_v<T, float> &&
+                                                    !std::is_same_v<T, Half>>>
+  explicit Half(T v) : x(detail::float_to_half_bits(static_cast<float>(v))) {}
+
+  static Half from_bits(uint16_t bits) {
+    Half h;
+    h.x = bits;
+    return h;
+  }
+  operator float() const { return detail::half_bits_to_float(x); }
+};
+
+struct BFloat16 {
+  uint16_t x = 0;
+
+  BFloat16() = default;
+  template <typename T, typename = std::enable_if_t<std::is_convertible_v<T, float> &&
+                                                    !std::is_same_v<T, BFloat16>>>
+  explicit BFloat16(T v) : x(detail::float_to_bfloat16_bits(static_cast<float>(v))) {}
+
+  static BFloat16 from_bits(uint16_t bits) {
+    BFloat16 b;
+    b.x = bits;
+    return b;
+  }
+  operator float() const { return detail::bfloat16_bits_to_float(x); }
+};
+
+static_assert(sizeof(Half) == 2 && sizeof(BFloat16) == 2);
+
+}  // namespace xft
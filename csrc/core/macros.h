@@ -0,0 +1,39 @@
+#pragma once
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace xft {
+
+// Every failure inside the core is an xft::Error. The C API boundary catches
+// it and turns it into a status code plus xft_last_error().
+class Error : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+namespace detail {
+
+template <typename... Args>
+std::string str(const Args&... args) {
+  std::ostringstream ss;
+  (ss << ... << args);
+  return ss.str();
+}
+
+[[noreturn]] inline void fail(const char* file, int line, const std::string& msg) {
+  throw Error(str(msg, " (", file, ":", line, ")"));
+}
+
+}  // namespace detail
+}  // namespace xft
+
+#define XFT_CHECK(cond, ...)                                                  \
+  do {                                                                        \
+    if (!(cond)) {                                                            \
+      ::xft::detail::fail(__FILE__, __LINE__, ::xft::detail::str(__VA_ARGS__)); \
+    }                                                                         \
+  } while (0)
+
+#define XFT_FAIL(...) ::xft::detail::fail(__FILE__, __LINE__, ::xft::detail::str(__VA_ARGS__))
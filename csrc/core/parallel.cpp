@@ -0,0 +1,202 @@
+#include "core/parallel.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/macros.h"
+
+namespace xft {
+
+namespace {
+
+thread_local bool t_in_parallel = false;
+
+// One parallel_for call. Lives on the caller's stack; workers only touch it
+// between taking and dropping a ThreadPool::busy_ reference.
+struct Job {
+  const std::function<void(int64_t, int64_t)>* fn;
+  int64_t begin, end, chunk;
+  int64_t num_chunks;
+  std::atomic<int64_t> next{0};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  // Claims chunks until none are left.
+  void run() {
+    const bool was_parallel = t_in_parallel;
+    t_in_parallel = true;
+    for (int64_t c = next.fetch_add(1); c < num_chunks; c = next.fetch_add(1)) {
+      const int64_t lo = begin + c * chunk;
+      const int64_t hi = std::min(end, lo + chunk);
+      try {
+        (*fn)(lo, hi);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+      }
+    }
+    t_in_parallel = was_parallel;
+  }
+};
+
+int default_num_threads() {
+  if (const char* env = std::getenv("XFT_NUM_THREADS")) {
+    const int n = std::atoi(env);
+    if (n > 0) return n;
+  }
+  const unsigned hw = std::thread::hardware_concurrency();
+  return hw > 0 ? static_cast<int>(hw) : 1;
+}
+
+// num_threads_ - 1 workers that sleep until a job is posted; the caller of
+// parallel_for is the remaining thread.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads) : num_threads_(num_threads) {}
+
+  int num_threads() const { return num_threads_.load(std::memory_order_relaxed); }
+
+  void resize(int num_threads) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    stop_workers();
+    num_threads_ = num_threads;
+  }
+
+  // False when another thread is using the pool; the caller then runs the
+  // job inline instead of waiting.
+  bool try_run(Job& job) {
+    std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+    if (!run_lock.owns_lock()) return false;
+    start_workers();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &job;
+      generation_++;
+    }
+    wake_.notify_all();
+    job.run();
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = nullptr;
+    idle_.wait(lock, [&] { return busy_ == 0; });
+    return true;
+  }
+
+ private:
+  void start_workers() {
+    const size_t want = static_cast<size_t>(num_threads() - 1);
+    if (workers_.size() == want) return;
+    stop_workers();
+    stop_ = false;
+    // Workers start from the current generation so they pick up the job
+    // about to be posted even if they get scheduled after it.
+    for (size_t i = 0; i < want; i++) {
+      workers_.emplace_back([this, seen = generation_] { worker_loop(seen); });
+    }
+  }
+
+  void stop_workers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t : workers_) t.join();
+    workers_.clear();
+  }
+
+  void worker_loop(uint64_t seen) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+      Job* job = job_;
+      if (job == nullptr) continue;
+      busy_++;
+      lock.unlock();
+      job->run();
+      lock.lock();
+      if (--busy_ == 0) idle_.notify_all();
+    }
+  }
+
+  std::atomic<int> num_threads_;
+  std::mutex run_mutex_;  // one parallel_for (or resize) at a time
+  std::mutex mutex_;      // guards everything below
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::vector<std::thread> workers_;
+  Job* job_ = nullptr;
+  uint64_t generation_ = 0;
+  int busy_ = 0;
+  bool stop_ = false;
+};
+
+// Heap-allocated and never destroyed: workers may still be parked at exit,
+// and a forked child must not touch the parent's threads, so it gets a new
+// pool and the old one is abandoned.
+ThreadPool* g_pool = nullptr;
+std::once_flag g_pool_once;
+
+void reset_after_fork() {
+  if (g_pool != nullptr) g_pool = new ThreadPool(g_pool->num_threads());
+}
+
+ThreadPool& pool() {
+  std::call_once(g_pool_once, [] {
+    g_pool = new ThreadPool(default_num_threads());
+    pthread_atfork(nullptr, nullptr, reset_after_fork);
+  });
+  return *g_pool;
+}
+
+}  // namespace
+
+void parallel_for(int64_t begin, int64_t end, int64_t grain,
+                  const std::function<void(int64_t, int64_t)>& fn) {
+  if (begin >= end) return;
+  grain = std::max<int64_t>(grain, 1);
+  const int64_t range = end - begin;
+  const int64_t max_chunks = (range + grain - 1) / grain;
+  if (max_chunks <= 1 || t_in_parallel) {
+    fn(begin, end);
+    return;
+  }
+  ThreadPool& p = pool();
+  const int64_t num_chunks = std::min<int64_t>(max_chunks, p.num_threads());
+  if (num_chunks <= 1) {
+    fn(begin, end);
+    return;
+  }
+
+  Job job;
+  job.fn = &fn;
+  job.begin = begin;
+  job.end = end;
+  job.chunk = (range + num_chunks - 1) / num_chunks;
+  job.num_chunks = (range + job.chunk - 1) / job.chunk;
+  if (!p.try_run(job)) {
+    fn(begin, end);
+    return;
+  }
+  if (job.error) std::rethrow_exception(job.error);
+}
+
+int get_num_threads() { return pool().num_threads(); }
+
+void set_num_threads(int n) {
+  XFT_CHECK(n > 0, "set_num_threads: expected a positive thread count, got ", n);
+  pool().resize(n);
+}
+
+bool in_parallel_region() { return t_in_parallel; }
+
+}  // namespace xft
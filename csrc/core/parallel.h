@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace xft {
+
+// Elementwise work below this many elements per thread is not worth a
+// wakeup; ops pass it (or a per-element cost-scaled version) as the grain.
+constexpr int64_t kGrainSize = 32768;
+
+// Splits [begin, end) into contiguous chunks of at least `grain` indices and
+// runs fn(chunk_begin, chunk_end) on the calling thread and the persistent
+// worker pool, returning once every chunk is done. The first exception
+// thrown by a chunk is rethrown here.
+//
+// Runs inline when the range fits in one grain, when the pool has a single
+// thread, from inside another parallel_for, or while another thread owns the
+// pool.
+void parallel_for(int64_t begin, int64_t end, int64_t grain,
+                  const std::function<void(int64_t, int64_t)>& fn);
+
+// Threads used by parallel_for, the caller included. Defaults to
+// XFT_NUM_THREADS if set, otherwise the hardware concurrency.
+int get_num_threads();
+// Resizes the pool; n must be positive. Waits for running work to finish.
+void set_num_threads(int n);
+
+bool in_parallel_region();
+
+}  // namespace xft
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Shared by host code and CUDA kernels.
+#ifdef __CUDACC__
+#define XFT_HOST_DEVICE __host__ __device__ __forceinline__
+#else
+#define XFT_HOST_DEVICE inline
+#endif
+
+namespace xft {
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+// 3"). It is counter-based: block `ctr` under key `seed` is a pure function
+// of the two, so random ops give the same values on every device, thread
+// count and launch shape, and replaying a saved counter replays the values.
+struct PhiloxBlock {
+  uint32_t w[4];
+};
+
+XFT_HOST_DEVICE void philox_mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+  const uint64_t p = static_cast<uint64_t>(a) * b;
+  hi = static_cast<uint32_t>(p >> 32);
+  lo = static_cast<uint32_t>(p);
+}
+
+XFT_HOST_DEVICE PhiloxBlock philox(uint64_t seed, uint64_t ctr) {
+  uint32_t c0 = static_cast<uint32_t>(ctr), c1 = static_cast<uint32_t>(ctr >> 32);
+  uint32_t c2 = 0, c3 = 0;
+  uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+  for (int round = 0; round < 10; round++) {
+    uint32_t hi0, lo0, hi1, lo1;
+    philox_mulhilo(0xD2511F53u, c0, hi0, lo0);
+    philox_mulhilo(0xCD9E8D57u, c2, hi1, lo1);
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  return {{c0, c1, c2, c3}};
+}
+
+// A launch's key and first counter. Ops captured into a CUDA graph read
+// them from the pair the graph rewrites before each replay
+// (GeneratorState::graph_base), and `offset` is relative to its counter.
+XFT_HOST_DEVICE void philox_resolve(const uint64_t* graph_base, uint64_t& seed,
+                                    uint64_t& offset) {
+  if (graph_base != nullptr) {
+    seed = graph_base[0];
+    offset += graph_base[1];
+  }
+}
+
+// Elements produced per Philox block: one 32-bit word per float, two per
+// double. Element i of a random op comes from block offset + i / per_block.
+template <typename T>
+constexpr int kPhiloxPerBlock = 16 / static_cast<int>(sizeof(T));
+
+// Uniform on [0, 1) with the full mantissa.
+XFT_HOST_DEVICE void philox_uniform(const PhiloxBlock& b, float* v) {
+  for (int i = 0; i < 4; i++) v[i] = static_cast<float>(b.w[i] >> 8) * 0x1p-24f;
+}
+
+XFT_HOST_DEVICE void philox_uniform(const PhiloxBlock& b, double* v) {
+  for (int i = 0; i < 2; i++) {
+    const uint64_t bits = (static_cast<uint64_t>(b.w[2 * i]) << 32) | b.w[2 * i + 1];
+    v[i] = static_cast<double>(bits >> 11) * 0x1p-53;
+  }
+}
+
+// Standard normals by Box-Muller over the block's uniforms, two at a time.
+XFT_HOST_DEVICE void philox_normal(const PhiloxBlock& b, float* v) {
+  float u[4];
+  philox_uniform(b, u);
+  for (int i = 0; i < 4; i += 2) {
+    const float r = ::sqrtf(-2.0f * ::logf(1.0f - u[i]));
+    const float theta = 6.2831853071795864f * u[i + 1];
+    v[i] = r * ::cosf(theta);
+    v[i + 1] = r * ::sinf(theta);
+  }
+}
+
+XFT_HOST_DEVICE void philox_normal(const PhiloxBlock& b, double* v) {
+  double u[2];
+  philox_uniform(b, u);
+  const double r = ::sqrt(-2.0 * ::log(1.0 - u[0]));
+  const double theta = 6.2831853071795864 * u[1];
+  v[0] = r * ::cos(theta);
+  v[1] = r * ::sin(theta);
+}
+
+}  // namespace xft
@@ -0,0 +1,375 @@
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#ifdef XFT_USE_CUDA
+#include "cuda/stream.h"
+#endif
+
+namespace xft::profiler {
+
+namespace detail {
+std::atomic<bool> g_enabled{false};
+}  // namespace detail
+
+namespace {
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#ifdef XFT_USE_CUDA
+// The two events around one scope's work on a stream.
+struct CudaSpan {
+  int device = -1;
+  cudaEvent_t start = nullptr;
+  cudaEvent_t end = nullptr;
+};
+
+// Where the device clock of one GPU sits on the session clock: `event`
+// completed at session time `ns`.
+struct CudaBase {
+  cudaEvent_t event = nullptr;
+  int64_t ns = 0;
+};
+
+void destroy_span(const CudaSpan& span) {
+  if (span.start != nullptr) cudaEventDestroy(span.start);
+  if (span.end != nullptr) cudaEventDestroy(span.end);
+}
+#endif
+
+// The events one thread recorded in one session. The thread appends and
+// stop() drains, so it has its own lock, uncontended in between.
+struct ThreadBuffer {
+  std::mutex mu;
+  std::vector<Event> events;
+#ifdef XFT_USE_CUDA
+  std::vector<std::pair<size_t, CudaSpan>> spans;  // by index into events
+#endif
+};
+
+struct Session {
+  uint64_t id = 0;
+  Options options;
+  int64_t t0 = 0;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+#ifdef XFT_USE_CUDA
+  std::map<int, CudaBase> cuda_bases;
+#endif
+};
+
+std::mutex g_mu;
+Session g_session;
+std::atomic<uint64_t> g_session_id{0};
+std::atomic<int64_t> g_t0{0};  // g_session.t0, readable without the lock
+
+struct OpenScope {
+  Event event;
+  uint64_t session = 0;
+  int64_t child_ns = 0;
+  int64_t alloc_at_start = 0;
+  bool has_device = false;
+#ifdef XFT_USE_CUDA
+  CudaSpan span;
+#endif
+};
+
+struct ThreadState {
+  uint64_t session = 0;
+  uint64_t thread = 0;
+  std::shared_ptr<ThreadBuffer> buffer;
+  std::vector<OpenScope> stack;
+  int64_t alloc_bytes = 0;  // running total while scopes are open
+};
+
+thread_local ThreadState t_state;
+
+void set_device(OpenScope& scope, Device device) {
+  if (scope.has_device) return;
+  scope.event.device = device;
+  scope.has_device = true;
+}
+
+// This thread's buffer in the current session, registered on first use.
+ThreadBuffer& thread_buffer(uint64_t session) {
+  ThreadState& st = t_state;
+  if (st.session != session || st.buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(g_mu);
+    st.buffer = std::make_shared<ThreadBuffer>();
+    st.thread = g_session.buffers.size();
+    st.session = session;
+    g_session.buffers.push_back(st.buffer);
+  }
+  return *st.buffer;
+}
+
+#ifdef XFT_USE_CUDA
+// The clock reference of `device`, made on first use with one
+// synchronization per device and session. The CUDA calls here run inside
+// scopes and their destructors, so failures only turn timing off for the
+// scope; a broken context will fail the op itself loudly enough.
+bool has_cuda_base(int device, cudaStream_t stream) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  if (g_session.cuda_bases.count(device) != 0) return true;
+  CudaBase base;
+  if (cudaEventCreate(&base.event) != cudaSuccess) return false;
+  if (cudaEventRecord(base.event, stream) != cudaSuccess ||
+      cudaEventSynchronize(base.event) != cudaSuccess) {
+    cudaEventDestroy(base.event);
+    return false;
+  }
+  base.ns = now_ns() - g_session.t0;
+  g_session.cuda_bases.emplace(device, base);
+  return true;
+}
+
+// Records the start event of a CUDA scope, unless the stream is being
+// captured into a graph (where events cannot time anything).
+void begin_cuda(OpenScope& scope) {
+  const int device = scope.event.device.index;
+  int prev = -1;
+  if (cudaGetDevice(&prev) != cudaSuccess || cudaSetDevice(device) != cudaSuccess) {
+    cudaGetLastError();
+    return;
+  }
+  cudaStream_t stream = cuda::current_stream(device);
+  cudaStreamCaptureStatus status = cudaStreamCaptureStatusNone;
+  CudaSpan span;
+  span.device = device;
+  const bool ok = cudaStreamIsCapturing(stream, &status) == cudaSuccess &&
+                  status == cudaStreamCaptureStatusNone && has_cuda_base(device, stream) &&
+                  cudaEventCreate(&span.start) == cudaSuccess &&
+                  cudaEventCreate(&span.end) == cudaSuccess &&
+                  cudaEventRecord(span.start, stream) == cudaSuccess;
+  if (ok) {
+    scope.span = span;
+  } else {
+    destroy_span(span);
+    cudaGetLastError();
+  }
+  cudaSetDevice(prev);
+}
+
+void end_cuda(OpenScope& scope) {
+  int prev = -1;
+  cudaGetDevice(&prev);
+  cudaSetDevice(scope.span.device);
+  if (cudaEventRecord(scope.span.end, cuda::current_stream(scope.span.device)) != cudaSuccess) {
+    cudaGetLastError();
+    destroy_span(scope.span);
+    scope.span = CudaSpan();
+  }
+  cudaSetDevice(prev);
+}
+
+// Fills in cuda_ns and cuda_start_ns; waits for the spans to complete.
+void resolve_spans(std::vector<Event>& events,
+                   const std::vector<std::pair<size_t, CudaSpan>>& spans,
+                   const std::map<int, CudaBase>& bases) {
+  for (const auto& [index, span] : spans) {
+    float ms = 0, offset_ms = 0;
+    const auto base = bases.find(span.device);
+    if (base != bases.end() && cudaEventSynchronize(span.end) == cudaSuccess &&
+        cudaEventElapsedTime(&ms, span.start, span.end) == cudaSuccess &&
+        cudaEventElapsedTime(&offset_ms, base->second.event, span.start) == cudaSuccess) {
+      events[index].cuda_ns = static_cast<int64_t>(static_cast<double>(ms) * 1e6);
+      events[index].cuda_start_ns =
+          base->second.ns + static_cast<int64_t>(static_cast<double>(offset_ms) * 1e6);
+    } else {
+      cudaGetLastError();
+    }
+    destroy_span(span);
+  }
+}
+#endif
+
+void write_escaped(std::FILE* f, const char* s) {
+  for (; *s != '\0'; s++) {
+    const char c = *s;
+    if (c == '"' || c == '\\') {
+      std::fprintf(f, "\\%c", c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      std::fprintf(f, "\\u%04x", c);
+    } else {
+      std::fputc(c, f);
+    }
+  }
+}
+
+void write_shapes(std::FILE* f, const std::vector<Shape>& shapes) {
+  std::fputc('[', f);
+  for (size_t i = 0; i < shapes.size(); i++) {
+    std::fprintf(f, "%s[", i ? ", " : "");
+    for (size_t d = 0; d < shapes[i].size(); d++) {
+      std::fprintf(f, "%s%lld", d ? ", " : "", static_cast<long long>(shapes[i][d]));
+    }
+    std::fputc(']', f);
+  }
+  std::fputc(']', f);
+}
+
+}  // namespace
+
+namespace detail {
+
+void begin(const char* name) {
+  ThreadState& st = t_state;
+  OpenScope scope;
+  scope.session = g_session_id.load(std::memory_order_acquire);
+  scope.event.name = name;
+  scope.event.depth = static_cast<int>(st.stack.size());
+  scope.alloc_at_start = st.alloc_bytes;
+  st.stack.push_back(std::move(scope));
+}
+
+void add_input(const Tensor& t) {
+  if (!t.defined()) return;
+  OpenScope& scope = t_state.stack.back();
+  set_device(scope, t.device());
+  if (g_session.options.record_shapes) scope.event.shapes.push_back(t.sizes());
+}
+
+void add_input(const std::vector<Tensor>& ts) {
+  for (const Tensor& t : ts) add_input(t);
+}
+
+void add_input(Device device) { set_device(t_state.stack.back(), device); }
+
+void start_timing() {
+  OpenScope& scope = t_state.stack.back();
+#ifdef XFT_USE_CUDA
+  if (scope.event.device.is_cuda() && g_session.options.cuda_timing) begin_cuda(scope);
+#endif
+  scope.event.start_ns = now_ns();
+}
+
+void end() {
+  ThreadState& st = t_state;
+  const int64_t end_ns = now_ns();
+  OpenScope scope = std::move(st.stack.back());
+  st.stack.pop_back();
+  const int64_t duration = end_ns - scope.event.start_ns;
+  if (!st.stack.empty()) st.stack.back().child_ns += duration;
+  const uint64_t session = g_session_id.load(std::memory_order_acquire);
+  if (!is_enabled() || scope.session != session) {
+#ifdef XFT_USE_CUDA
+    destroy_span(scope.span);
+#endif
+    return;
+  }
+#ifdef XFT_USE_CUDA
+  if (scope.span.start != nullptr) end_cuda(scope);
+#endif
+  Event& ev = scope.event;
+  ev.self_ns = duration - scope.child_ns;
+  ev.alloc_bytes = st.alloc_bytes - scope.alloc_at_start;
+  const int64_t t0 = g_t0.load(std::memory_order_relaxed);
+  ev.end_ns = end_ns - t0;
+  ev.start_ns -= t0;
+  ThreadBuffer& buffer = thread_buffer(session);
+  ev.thread = st.thread;
+  std::lock_guard<std::mutex> lock(buffer.mu);
+#ifdef XFT_USE_CUDA
+  if (scope.span.start != nullptr) buffer.spans.emplace_back(buffer.events.size(), scope.span);
+#endif
+  buffer.events.push_back(std::move(ev));
+}
+
+void record_alloc(size_t nbytes) {
+  ThreadState& st = t_state;
+  if (!st.stack.empty()) st.alloc_bytes += static_cast<int64_t>(nbytes);
+}
+
+}  // namespace detail
+
+void start(const Options& options) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  XFT_CHECK(!is_enabled(), "profiler: a session is already running");
+  g_session = Session();
+  g_session.id = g_session_id.load() + 1;
+  g_session.options = options;
+  g_session.t0 = now_ns();
+  g_t0.store(g_session.t0, std::memory_order_relaxed);
+  g_session_id.store(g_session.id, std::memory_order_release);
+  detail::g_enabled.store(true, std::memory_order_release);
+}
+
+std::vector<Event> stop() {
+  Session session;
+  {
+    std::lock_guard<std::mutex> lock(g_mu);
+    XFT_CHECK(is_enabled(), "profiler: no session is running");
+    detail::g_enabled.store(false, std::memory_order_release);
+    session = std::move(g_session);
+    g_session = Session();
+  }
+  std::vector<Event> events;
+  for (const auto& buffer : session.buffers) {
+    std::lock_guard<std::mutex> lock(buffer->mu);
+#ifdef XFT_USE_CUDA
+    resolve_spans(buffer->events, buffer->spans, session.cuda_bases);
+    buffer->spans.clear();
+#endif
+    for (Event& ev : buffer->events) events.push_back(std::move(ev));
+    buffer->events.clear();
+  }
+#ifdef XFT_USE_CUDA
+  for (const auto& [device, base] : session.cuda_bases) cudaEventDestroy(base.event);
+#endif
+  std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+    return a.start_ns != b.start_ns ? a.start_ns < b.start_ns : a.depth < b.depth;
+  });
+  return events;
+}
+
+void export_chrome_trace(const std::vector<Event>& events, const std::string& path) {
+  std::FILE* f = std::fopen(path.c_str(), "w");
+  XFT_CHECK(f != nullptr, "export_chrome_trace: cannot open ", path);
+  std::fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+  std::fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, "
+               "\"args\": {\"name\": \"host\"}}");
+  std::vector<int> devices;
+  for (const Event& ev : events) {
+    if (ev.cuda_ns >= 0 &&
+        std::find(devices.begin(), devices.end(), ev.device.index) == devices.end()) {
+      devices.push_back(ev.device.index);
+    }
+  }
+  for (int d : devices) {
+    std::fprintf(f, ",\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+                 "\"args\": {\"name\": \"cuda:%d\"}}", d + 1, d);
+  }
+  // Timestamps are microseconds, as doubles to keep the nanoseconds.
+  for (const Event& ev : events) {
+    std::fprintf(f, ",\n{\"name\": \"");
+    write_escaped(f, ev.name);
+    std::fprintf(f, "\", \"cat\": \"op\", \"ph\": \"X\", \"pid\": 0, \"tid\": %llu, "
+                 "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"device\": \"%s\", "
+                 "\"alloc_bytes\": %lld, \"input_shapes\": ",
+                 static_cast<unsigned long long>(ev.thread), ev.start_ns / 1e3,
+                 (ev.end_ns - ev.start_ns) / 1e3, ev.device.str().c_str(),
+                 static_cast<long long>(ev.alloc_bytes));
+    write_shapes(f, ev.shapes);
+    std::fprintf(f, "}}");
+    if (ev.cuda_ns >= 0) {
+      std::fprintf(f, ",\n{\"name\": \"");
+      write_escaped(f, ev.name);
+      std::fprintf(f, "\", \"cat\": \"kernel\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, "
+                   "\"ts\": %.3f, \"dur\": %.3f}",
+                   ev.device.index + 1, ev.depth, ev.cuda_start_ns / 1e3, ev.cuda_ns / 1e3);
+    }
+  }
+  std::fprintf(f, "\n]}\n");
+  const bool ok = std::ferror(f) == 0;
+  XFT_CHECK(std::fclose(f) == 0 && ok, "export_chrome_trace: failed writing ", path);
+}
+
+}  // namespace xft::profiler
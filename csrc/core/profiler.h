@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/device.h"
+#include "core/tensor.h"
+
+namespace xft::profiler {
+
+// Op-level profiler. While a session is active, every op scope (see
+// RecordScope) records its name, input shapes, device, wall time, the
+// bytes its tensors allocated and, for CUDA ops, the time its kernels took
+// on the device, timed with events on the current stream. Scopes nest:
+// an op called inside another (autograd nodes called by backward, matmul
+// inside attention) is a child of it, and self time excludes children.
+// Outside a session a scope costs one relaxed atomic load.
+
+struct Options {
+  bool record_shapes = true;
+  // Times CUDA ops with events; resolving them in stop() synchronizes.
+  bool cuda_timing = true;
+};
+
+struct Event {
+  const char* name = "";  // static, as given to RecordScope
+  std::vector<Shape> shapes;  // of the tensor inputs, if recorded
+  Device device;
+  uint64_t thread = 0;  // small per-session ids, in order of first event
+  int depth = 0;        // nesting level on its thread
+  int64_t start_ns = 0;  // wall clock, relative to the session start
+  int64_t end_ns = 0;
+  int64_t self_ns = 0;  // end - start minus the children's
+  // Kernel time between the scope's start and end on the current stream,
+  // and where that span sits on the session clock; -1 when not timed.
+  int64_t cuda_start_ns = -1;
+  int64_t cuda_ns = -1;
+  // Bytes of storage allocated inside the scope, children included.
+  int64_t alloc_bytes = 0;
+};
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+void begin(const char* name);
+void add_input(const Tensor& t);
+void add_input(const std::vector<Tensor>& ts);
+void add_input(Device device);
+void start_timing();
+void end();
+void record_alloc(size_t nbytes);
+}  // namespace detail
+
+inline bool is_enabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+
+// Starts a session; throws if one is already running.
+void start(const Options& options = Options());
+// Ends the session and returns its events, ordered by start time.
+std::vector<Event> stop();
+
+// Writes `events` as Chrome trace JSON (chrome://tracing, Perfetto): one
+// track per host thread and one per CUDA device for kernel spans.
+void export_chrome_trace(const std::vector<Event>& events, const std::string& path);
+
+// Counts a storage allocation towards the open scopes of this thread.
+inline void record_alloc(size_t nbytes) {
+  if (is_enabled()) detail::record_alloc(nbytes);
+}
+
+// Profiles the enclosing block as op `name`. The inputs (tensors, tensor
+// lists or a Device) give the shapes and the device; the first defined one
+// picks the device. `name` must outlive the session (a string literal).
+class RecordScope {
+ public:
+  template <typename... Inputs>
+  explicit RecordScope(const char* name, const Inputs&... inputs) {
+    if (!is_enabled()) return;
+    active_ = true;
+    detail::begin(name);
+    (detail::add_input(inputs), ...);
+    detail::start_timing();
+  }
+  ~RecordScope() {
+    if (active_) detail::end();
+  }
+
+  RecordScope(const RecordScope&) = delete;
+  RecordScope& operator=(const RecordScope&) = delete;
+
+ private:
+  bool active_ = false;
+};
+
+}  // namespace xft::profiler
+
+// Profiles the rest of the enclosing block as op `name`.
+#define XFT_RECORD_OP(name, ...) \
+  ::xft::profiler::RecordScope xft_record_scope__(name, ##__VA_ARGS__)
@@ -0,0 +1,374 @@
+#include "core/serialize.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+
+#include "autograd/grad_mode.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/host_allocator.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "checkpoint files are little-endian and read by mapping them");
+
+constexpr char kMagic[8] = {'X', 'F', 'T', 'S', 'A', 'V', 'E', '1'};
+constexpr size_t kPreambleBytes = sizeof(kMagic) + sizeof(uint64_t);
+// CUDA tensors move through pinned blocks of this size.
+constexpr size_t kStagingBytes = size_t(8) << 20;
+constexpr uint32_t kMaxRank = 64;
+// An index entry with an empty name and rank 0: name length, dtype, rank,
+// offset and byte count.
+constexpr uint64_t kMinEntryBytes = 4 + 4 + 4 + 8 + 8;
+
+uint64_t align_up(uint64_t n) {
+  return (n + kCheckpointAlignment - 1) / kCheckpointAlignment * kCheckpointAlignment;
+}
+
+uint64_t entry_bytes(const std::string& name, size_t rank) {
+  return sizeof(uint32_t) + name.size() + sizeof(int32_t) + sizeof(uint32_t) +
+         rank * sizeof(int64_t) + 2 * sizeof(uint64_t);
+}
+
+template <typename T>
+void put(std::string& buf, T value) {
+  buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Bounds-checked reads from the index.
+class Reader {
+ public:
+  Reader(const char* data, size_t size, const std::string& path)
+      : data_(data), left_(size), path_(path) {}
+
+  template <typename T>
+  T get() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string bytes(size_t n) {
+    const char* p = take(n);
+    return std::string(p, n);
+  }
+
+ private:
+  const char* take(size_t n) {
+    XFT_CHECK(n <= left_, "load: ", path_, ": truncated index");
+    const char* p = data_;
+    data_ += n;
+    left_ -= n;
+    return p;
+  }
+
+  const char* data_;
+  size_t left_;
+  const std::string& path_;
+};
+
+// The whole file, mapped copy-on-write; unmapped when the last view goes.
+StoragePtr map_file(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  XFT_CHECK(fd >= 0, "load: cannot open ", path, ": ", std::strerror(errno));
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    const int err = errno;
+    ::close(fd);
+    XFT_FAIL("load: cannot stat ", path, ": ", std::strerror(err));
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  if (size < kPreambleBytes) {
+    ::close(fd);
+    XFT_FAIL("load: ", path, " is not an xft checkpoint");
+  }
+  void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  const int err = errno;
+  ::close(fd);
+  XFT_CHECK(data != MAP_FAILED, "load: cannot map ", path, ": ", std::strerror(err));
+  return std::make_shared<Storage>(data, size, Device(),
+                                   [size](void* p) { ::munmap(p, size); });
+}
+
+// Reads exactly n bytes at `offset`, retrying short reads; false with errno
+// set on failure (0 at end of file).
+bool read_at(int fd, void* data, size_t n, uint64_t offset) {
+  char* p = static_cast<char*>(data);
+  while (n > 0) {
+    const ssize_t got = ::pread(fd, p, n, static_cast<off_t>(offset));
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) {
+      if (got == 0) errno = 0;
+      return false;
+    }
+    p += got;
+    n -= static_cast<size_t>(got);
+    offset += static_cast<uint64_t>(got);
+  }
+  return true;
+}
+
+// The index of a file of `size` bytes; `base` holds at least its preamble
+// and index.
+std::vector<CheckpointEntry> read_index(const char* base, uint64_t size, const std::string& path) {
+  XFT_CHECK(std::memcmp(base, kMagic, sizeof(kMagic)) == 0, "load: ", path,
+            " is not an xft checkpoint");
+  uint64_t index_bytes;
+  std::memcpy(&index_bytes, base + sizeof(kMagic), sizeof(index_bytes));
+  XFT_CHECK(index_bytes <= size - kPreambleBytes, "load: ", path, ": truncated index");
+  const uint64_t data_start = kPreambleBytes + index_bytes;
+
+  Reader in(base + kPreambleBytes, index_bytes, path);
+  const auto count = in.get<uint64_t>();
+  // Bounded by what the index can hold before anything is allocated for it.
+  XFT_CHECK(count <= (index_bytes - sizeof(count)) / kMinEntryBytes, "load: ", path,
+            ": corrupt index");
+  std::vector<CheckpointEntry> entries(count);
+  std::unordered_set<std::string> names;
+  for (CheckpointEntry& e : entries) {
+    e.name = in.bytes(in.get<uint32_t>());
+    XFT_CHECK(names.insert(e.name).second, "load: ", path, ": duplicate name '", e.name, "'");
+    const auto code = in.get<int32_t>();
+    XFT_CHECK(code >= 0 && code < kNumDTypes, "load: ", path,
+              ": '", e.name, "' has unknown dtype ", code);
+    e.dtype = static_cast<DType>(code);
+    const auto rank = in.get<uint32_t>();
+    XFT_CHECK(rank <= kMaxRank, "load: ", path, ": '", e.name, "' has rank ", rank);
+    // Saturates past the file size, which no valid entry reaches.
+    uint64_t numel = 1;
+    for (uint32_t d = 0; d < rank; d++) {
+      const auto n = in.get<int64_t>();
+      XFT_CHECK(n >= 0 && static_cast<uint64_t>(n) <= size, "load: ", path, ": '", e.name,
+                "' has bad size ", n);
+      e.sizes.push_back(n);
+      if (n == 0 || numel == 0) {
+        numel = 0;
+      } else {
+        numel = numel > size / n ? size + 1 : numel * n;
+      }
+    }
+    e.offset = in.get<uint64_t>();
+    e.nbytes = in.get<uint64_t>();
+    XFT_CHECK(numel <= size && e.nbytes == numel * element_size(e.dtype), "load: ", path,
+              ": '", e.name, "' does not match its shape");
+    XFT_CHECK(e.offset % kCheckpointAlignment == 0 && e.offset >= data_start &&
+                  e.nbytes <= size && e.offset <= size - e.nbytes,
+              "load: ", path, ": '", e.name, "' lies outside the data section");
+  }
+  return entries;
+}
+
+#ifdef XFT_USE_CUDA
+// `len` bytes of dense `t`, `pos` bytes in.
+Tensor byte_view(const Tensor& t, size_t pos, size_t len) {
+  const int64_t offset = t.storage_offset() * t.element_size() + pos;
+  return Tensor::from_storage(t.storage(), {static_cast<int64_t>(len)}, {1}, offset,
+                              DType::UInt8);
+}
+#endif
+
+class Writer {
+ public:
+  explicit Writer(const std::string& path) : path_(path) {
+    file_ = std::fopen(path.c_str(), "wb");
+    XFT_CHECK(file_ != nullptr, "save: cannot create ", path, ": ", std::strerror(errno));
+  }
+
+  ~Writer() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+      std::remove(path_.c_str());
+    }
+  }
+
+  void write(const void* data, size_t n) {
+    XFT_CHECK(std::fwrite(data, 1, n, file_) == n, "save: cannot write ", path_, ": ",
+              std::strerror(errno));
+    pos_ += n;
+  }
+
+  void pad_to(uint64_t pos) {
+    static const char zeros[kCheckpointAlignment] = {};
+    XFT_CHECK(pos >= pos_ && pos - pos_ < kCheckpointAlignment, "save: bad padding");
+    write(zeros, pos - pos_);
+  }
+
+  void write_tensor(const Tensor& t) {
+    if (t.device().is_cpu()) {
+      write(t.data_ptr(), t.nbytes());
+      return;
+    }
+#ifdef XFT_USE_CUDA
+    // Synchronous copies, so one staging block is reused throughout.
+    const size_t nbytes = t.nbytes();
+    Tensor staging =
+        cuda::empty_pinned({static_cast<int64_t>(std::min(nbytes, kStagingBytes))}, DType::UInt8);
+    for (size_t pos = 0; pos < nbytes; pos += kStagingBytes) {
+      const size_t len = std::min(kStagingBytes, nbytes - pos);
+      Tensor chunk = byte_view(staging, 0, len);
+      chunk.copy_(byte_view(t, pos, len));
+      write(staging.data_ptr(), len);
+    }
+#else
+    XFT_FAIL("save: ", t.device().str(), " is not supported by this build");
+#endif
+  }
+
+  // Closes the file; it is kept only after this succeeds.
+  void commit() {
+    FILE* f = file_;
+    file_ = nullptr;
+    if (std::fclose(f) != 0) {
+      const int err = errno;
+      std::remove(path_.c_str());
+      XFT_FAIL("save: cannot write ", path_, ": ", std::strerror(err));
+    }
+  }
+
+ private:
+  std::string path_;
+  FILE* file_ = nullptr;
+  uint64_t pos_ = 0;
+};
+
+#ifdef XFT_USE_CUDA
+// Fills dense CUDA `dst` from host memory. Each staging block goes back to
+// the pinned pool as soon as its copy is enqueued and is recycled once that
+// copy completes, so a few blocks cycle through however large the file is.
+void upload(const Tensor& dst, const char* src, size_t nbytes) {
+  for (size_t pos = 0; pos < nbytes; pos += kStagingBytes) {
+    const size_t len = std::min(kStagingBytes, nbytes - pos);
+    Tensor staging = cuda::empty_pinned({static_cast<int64_t>(len)}, DType::UInt8);
+    std::memcpy(staging.data_ptr(), src + pos, len);
+    byte_view(dst, pos, len).copy_(staging, /*non_blocking=*/true);
+  }
+}
+#endif
+
+}  // namespace
+
+std::string checkpoint_header(std::vector<CheckpointEntry>& entries) {
+  uint64_t index_bytes = sizeof(uint64_t);
+  for (const CheckpointEntry& e : entries) index_bytes += entry_bytes(e.name, e.sizes.size());
+  std::string header(kMagic, sizeof(kMagic));
+  put<uint64_t>(header, index_bytes);
+  put<uint64_t>(header, entries.size());
+  uint64_t end = kPreambleBytes + index_bytes;
+  for (CheckpointEntry& e : entries) {
+    e.offset = align_up(end);
+    e.nbytes = shape_numel(e.sizes) * element_size(e.dtype);
+    end = e.offset + e.nbytes;
+    put<uint32_t>(header, static_cast<uint32_t>(e.name.size()));
+    header += e.name;
+    put<int32_t>(header, static_cast<int32_t>(e.dtype));
+    put<uint32_t>(header, static_cast<uint32_t>(e.sizes.size()));
+    for (int64_t n : e.sizes) put<int64_t>(header, n);
+    put<uint64_t>(header, e.offset);
+    put<uint64_t>(header, e.nbytes);
+  }
+  return header;
+}
+
+void save(const NamedTensors& tensors, const std::string& path) {
+  autograd::NoGradGuard no_grad;
+  std::unordered_set<std::string> names;
+  std::vector<Tensor> dense;
+  std::vector<CheckpointEntry> entries;
+  dense.reserve(tensors.size());
+  for (const auto& [name, t] : tensors) {
+    XFT_CHECK(t.defined(), "save: '", name, "' is an undefined tensor");
+    XFT_CHECK(names.insert(name).second, "save: duplicate name '", name, "'");
+    dense.push_back(t.contiguous());
+    entries.push_back({name, t.dtype(), t.sizes()});
+  }
+  const std::string header = checkpoint_header(entries);
+
+  // Written beside the target and renamed over it, so a failed save never
+  // leaves a truncated checkpoint behind.
+  const std::string tmp = path + ".tmp";
+  Writer out(tmp);
+  out.write(header.data(), header.size());
+  for (size_t i = 0; i < dense.size(); i++) {
+    out.pad_to(entries[i].offset);
+    out.write_tensor(dense[i]);
+  }
+  out.commit();
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    const int err = errno;
+    std::remove(tmp.c_str());
+    XFT_FAIL("save: cannot replace ", path, ": ", std::strerror(err));
+  }
+}
+
+std::vector<CheckpointEntry> checkpoint_index(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  XFT_CHECK(fd >= 0, "load: cannot open ", path, ": ", std::strerror(errno));
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    const int err = errno;
+    ::close(fd);
+    XFT_FAIL("load: cannot stat ", path, ": ", std::strerror(err));
+  }
+  const auto size = static_cast<uint64_t>(st.st_size);
+  std::vector<char> header(kPreambleBytes);
+  bool ok = size >= kPreambleBytes && read_at(fd, header.data(), kPreambleBytes, 0);
+  if (ok) {
+    // A corrupt size is caught by read_index; read no more than the file.
+    uint64_t index_bytes;
+    std::memcpy(&index_bytes, header.data() + sizeof(kMagic), sizeof(index_bytes));
+    index_bytes = std::min<uint64_t>(index_bytes, size - kPreambleBytes);
+    header.resize(kPreambleBytes + index_bytes);
+    ok = read_at(fd, header.data() + kPreambleBytes, index_bytes, kPreambleBytes);
+  }
+  const int err = errno;
+  ::close(fd);
+  XFT_CHECK(ok || size >= kPreambleBytes, "load: ", path, " is not an xft checkpoint");
+  XFT_CHECK(ok, "load: cannot read ", path, ": ", err != 0 ? std::strerror(err) : "truncated");
+  return read_index(header.data(), size, path);
+}
+
+NamedTensors load(const std::string& path, Device device) {
+  StoragePtr file = map_file(path);
+  const std::vector<CheckpointEntry> entries =
+      read_index(static_cast<const char*>(file->data()), file->nbytes(), path);
+  NamedTensors out;
+  out.reserve(entries.size());
+  if (device.is_cpu()) {
+    for (const CheckpointEntry& e : entries) {
+      // Offsets are multiples of the alignment, hence of the element size.
+      const auto offset = static_cast<int64_t>(e.offset / element_size(e.dtype));
+      out.emplace_back(e.name, Tensor::from_storage(file, e.sizes, contiguous_strides(e.sizes),
+                                                    offset, e.dtype));
+    }
+    return out;
+  }
+#ifdef XFT_USE_CUDA
+  if (device.is_cuda()) {
+    // Read once, front to back.
+    ::madvise(file->data(), file->nbytes(), MADV_SEQUENTIAL);
+    const char* base = static_cast<const char*>(file->data());
+    for (const CheckpointEntry& e : entries) {
+      Tensor t = Tensor::empty(e.sizes, e.dtype, device);
+      upload(t, base + e.offset, e.nbytes);
+      out.emplace_back(e.name, std::move(t));
+    }
+    return out;
+  }
+#endif
+  XFT_FAIL("load: ", device.str(), " is not supported by this build");
+}
+
+}  // namespace xft
@@ -0,0 +1,61 @@
+#pragma once
+
+// Flat checkpoint files: a small index followed by each tensor's raw bytes,
+// so loading is a page mapping rather than a parse.
+//
+//   [0, 8)    magic "XFTSAVE1"
+//   [8, 16)   index size in bytes (uint64)
+//   [16, ..)  index: entry count (uint64), then per entry the name length
+//             (uint32) and bytes, dtype code (int32), rank (uint32), sizes
+//             (int64 each), file offset and byte count of the data (uint64)
+//   ...       zero padding; each tensor's bytes start at a multiple of
+//             kCheckpointAlignment and are dense, in row-major order.
+//
+// Integers are little-endian.
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace xft {
+
+constexpr size_t kCheckpointAlignment = 64;
+
+using NamedTensors = std::vector<std::pair<std::string, Tensor>>;
+
+// One tensor's entry in a checkpoint's index: where its dense bytes lie.
+struct CheckpointEntry {
+  std::string name;
+  DType dtype = DType::Float32;
+  Shape sizes;
+  uint64_t offset = 0;
+  uint64_t nbytes = 0;
+};
+
+// Writes `tensors` in order, replacing `path` only once the whole file is
+// written. Names must be unique. CUDA tensors are copied out in chunks
+// through the pinned pool rather than as whole host copies.
+void save(const NamedTensors& tensors, const std::string& path);
+
+// Reads a checkpoint back, in file order. For the CPU the file is mapped
+// copy-on-write and every tensor is a view of the mapping: nothing is read
+// until it is touched, pages are shared with other processes mapping the
+// same file, and in-place writes stay private to this process. For a CUDA
+// device the data is streamed through pinned staging blocks with async
+// copies ordered on the device's current stream.
+NamedTensors load(const std::string& path, Device device = Device());
+
+// The preamble and index that start a checkpoint of `entries`, in order,
+// laid out as save() does: offset and nbytes are filled in from each
+// entry's dtype and sizes. For writers that produce the data themselves.
+std::string checkpoint_header(std::vector<CheckpointEntry>& entries);
+
+// Reads just the index of a checkpoint, validated as load() does, without
+// touching any tensor's data. Out-of-core readers (core/streaming.h) start
+// from it.
+std::vector<CheckpointEntry> checkpoint_index(const std::string& path);
+
+}  // namespace xft
@@ -0,0 +1,102 @@
+#include "core/shared_memory.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace xft {
+
+namespace {
+
+std::mutex g_mutex;
+// The names segments were mapped under, by base address. Never freed, so
+// deleters running at exit stay safe.
+auto* g_names = new std::unordered_map<void*, std::string>;
+
+std::string new_name() {
+  static std::atomic<uint64_t> counter{0};
+  return "/xft_" + std::to_string(::getpid()) + "_" + std::to_string(counter++);
+}
+
+// Maps the open segment `fd` and closes it; `name` is recorded for
+// shared_memory_name() unless it is empty.
+StoragePtr map_segment(int fd, size_t nbytes, const std::string& name) {
+  // A zero-length mapping is invalid; one page backs empty tensors.
+  const size_t length = std::max<size_t>(nbytes, 1);
+  void* data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int err = errno;
+  ::close(fd);
+  XFT_CHECK(data != MAP_FAILED, "shared memory: cannot map ", name, ": ", std::strerror(err));
+  if (!name.empty()) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    (*g_names)[data] = name;
+  }
+  return std::make_shared<Storage>(data, nbytes, Device(), [length](void* p) {
+    {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_names->erase(p);
+    }
+    ::munmap(p, length);
+  });
+}
+
+}  // namespace
+
+Tensor empty_shared(const Shape& sizes, DType dtype) {
+  const size_t nbytes = shape_numel(sizes) * element_size(dtype);
+  const std::string name = new_name();
+  const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+  XFT_CHECK(fd >= 0, "shared memory: cannot create ", name, ": ", std::strerror(errno));
+  if (::ftruncate(fd, std::max<size_t>(nbytes, 1)) != 0) {
+    const int err = errno;
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    XFT_FAIL("shared memory: cannot size ", name, " to ", nbytes, " bytes: ",
+             std::strerror(err));
+  }
+  StoragePtr storage;
+  try {
+    storage = map_segment(fd, nbytes, name);
+  } catch (...) {
+    ::shm_unlink(name.c_str());
+    throw;
+  }
+  return Tensor::from_storage(std::move(storage), sizes, contiguous_strides(sizes), 0, dtype);
+}
+
+std::string shared_memory_name(const Tensor& t) {
+  if (!t.defined() || !t.device().is_cpu()) return "";
+  std::lock_guard<std::mutex> lock(g_mutex);
+  auto it = g_names->find(t.storage()->data());
+  return it != g_names->end() ? it->second : "";
+}
+
+Tensor open_shared(const std::string& name, const Shape& sizes, DType dtype, bool unlink) {
+  const size_t nbytes = shape_numel(sizes) * element_size(dtype);
+  const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+  XFT_CHECK(fd >= 0, "shared memory: cannot open ", name, ": ", std::strerror(errno));
+  if (unlink) ::shm_unlink(name.c_str());
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < nbytes) {
+    ::close(fd);
+    XFT_FAIL("shared memory: ", name, " is smaller than ", nbytes, " bytes");
+  }
+  StoragePtr storage = map_segment(fd, nbytes, unlink ? "" : name);
+  return Tensor::from_storage(std::move(storage), sizes, contiguous_strides(sizes), 0, dtype);
+}
+
+void unlink_shared(const std::string& name) {
+  XFT_CHECK(::shm_unlink(name.c_str()) == 0 || errno == ENOENT, "shared memory: cannot unlink ",
+            name, ": ", std::strerror(errno));
+}
+
+}  // namespace xft
@@ -0,0 +1,29 @@
+#pragma once
+
+// CPU tensors in POSIX shared memory, for handing data between processes
+// without copying it through a pipe: one process allocates and fills a
+// tensor, sends its segment name, and the other maps the same pages.
+
+#include <string>
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// A dense CPU tensor in a new shared-memory segment. The segment's name
+// stays registered until open_shared(..., unlink=true) or unlink_shared()
+// removes it; the memory itself lives until its last mapping goes.
+Tensor empty_shared(const Shape& sizes, DType dtype);
+
+// The name `t`'s storage was created or mapped under, or "" when it is not
+// a named segment (open_shared with `unlink` maps without one).
+std::string shared_memory_name(const Tensor& t);
+
+// Maps segment `name` as a dense tensor. With `unlink`, the name is removed
+// as well, so the segment is freed once every mapping of it is gone.
+Tensor open_shared(const std::string& name, const Shape& sizes, DType dtype, bool unlink);
+
+// Removes a segment's name without mapping it.
+void unlink_shared(const std::string& name);
+
+}  // namespace xft
@@ -0,0 +1,28 @@
+#include "core/storage.h"
+
+#include "core/allocator.h"
+#include "core/profiler.h"
+
+namespace xft {
+
+Storage::Storage(size_t nbytes, Device device, bool deferred)
+    : nbytes_(nbytes), device_(device) {
+  Allocator* allocator = get_allocator(device.type);
+  deleter_ = [allocator, device](void* p) { allocator->deallocate(p, device); };
+  if (!deferred) allocate();
+}
+
+void Storage::allocate() {
+  if (data_ != nullptr || nbytes_ == 0) return;
+  data_ = get_allocator(device_.type)->allocate(nbytes_, device_);
+  profiler::record_alloc(nbytes_);
+}
+
+Storage::Storage(void* data, size_t nbytes, Device device, Deleter deleter)
+    : data_(data), nbytes_(nbytes), device_(device), deleter_(std::move(deleter)) {}
+
+Storage::~Storage() {
+  if (data_ != nullptr && deleter_) deleter_(data_);
+}
+
+}  // namespace xft
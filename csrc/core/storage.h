@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "core/device.h"
+
+namespace xft {
+
+// A flat, untyped byte buffer. Tensors never own memory directly: any number
+// of views share one Storage through shared_ptr, and the buffer is released
+// when the last view goes away.
+class Storage {
+ public:
+  using Deleter = std::function<void(void*)>;
+
+  // Allocates nbytes from the device's registered allocator; with
+  // `deferred`, not until allocate() is called.
+  Storage(size_t nbytes, Device device, bool deferred = false);
+
+  // Adopts memory owned elsewhere (mmap'd files, shared memory, ...).
+  Storage(void* data, size_t nbytes, Device device, Deleter deleter);
+
+  ~Storage();
+
+  Storage(const Storage&) = delete;
+  Storage& operator=(const Storage&) = delete;
+
+  // For deferred storage (pending lazy results, which may never run): gets
+  // the memory now. A no-op once allocated.
+  void allocate();
+
+  void* data() const { return data_; }
+  size_t nbytes() const { return nbytes_; }
+  Device device() const { return device_; }
+
+  // Bumped by every in-place write through a tensor (copy_, fill_), so
+  // autograd can tell that a tensor it saved for backward has changed. Views
+  // share their base's counter.
+  uint64_t version() const { return version_.load(std::memory_order_relaxed); }
+  void bump_version() { version_.fetch_add(1, std::memory_order_relaxed); }
+
+ private:
+  void* data_ = nullptr;
+  size_t nbytes_ = 0;
+  Device device_;
+  Deleter deleter_;
+  std::atomic<uint64_t> version_{0};
+};
+
+using StoragePtr = std::shared_ptr<Storage>;
+
+}  // namespace xft
@@ -0,0 +1,294 @@
+#include "core/streaming.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "autograd/grad_mode.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/host_allocator.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// pread/pwrite of exactly n bytes, retrying short transfers.
+void read_fully(int fd, void* data, size_t n, uint64_t offset, const std::string& path) {
+  char* p = static_cast<char*>(data);
+  while (n > 0) {
+    const ssize_t got = ::pread(fd, p, n, static_cast<off_t>(offset));
+    if (got < 0 && errno == EINTR) continue;
+    XFT_CHECK(got != 0, "stream: ", path, ": unexpected end of file");
+    XFT_CHECK(got > 0, "stream: cannot read ", path, ": ", std::strerror(errno));
+    p += got;
+    n -= static_cast<size_t>(got);
+    offset += static_cast<uint64_t>(got);
+  }
+}
+
+void write_fully(int fd, const void* data, size_t n, uint64_t offset, const std::string& path) {
+  const char* p = static_cast<const char*>(data);
+  while (n > 0) {
+    const ssize_t put = ::pwrite(fd, p, n, static_cast<off_t>(offset));
+    if (put < 0 && errno == EINTR) continue;
+    XFT_CHECK(put > 0, "stream: cannot write ", path, ": ", std::strerror(errno));
+    p += put;
+    n -= static_cast<size_t>(put);
+    offset += static_cast<uint64_t>(put);
+  }
+}
+
+// Bytes of one row along dim 0.
+uint64_t row_bytes(const CheckpointEntry& e) {
+  uint64_t n = element_size(e.dtype);
+  for (size_t d = 1; d < e.sizes.size(); d++) n *= static_cast<uint64_t>(e.sizes[d]);
+  return n;
+}
+
+Shape chunk_shape(const Shape& sizes, int64_t rows) {
+  Shape s = sizes;
+  s[0] = rows;
+  return s;
+}
+
+}  // namespace
+
+IoThread::IoThread() : thread_([this] { run(); }) {}
+
+IoThread::~IoThread() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+std::future<void> IoThread::submit(std::function<void()> job) {
+  std::packaged_task<void()> task(std::move(job));
+  std::future<void> done = task.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(task));
+  }
+  wake_.notify_one();
+  return done;
+}
+
+void IoThread::run() {
+  for (;;) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) return;
+      task = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    task();
+  }
+}
+
+ChunkReader::ChunkReader(const std::string& path, const std::string& name, size_t chunk_bytes,
+                         Device device)
+    : path_(path), device_(device) {
+  XFT_CHECK(device.is_cpu() || device.is_cuda(), "stream: unknown device ", device.str());
+#ifndef XFT_USE_CUDA
+  XFT_CHECK(device.is_cpu(), "stream: ", device.str(), " is not supported by this build");
+#endif
+  bool found = false;
+  for (CheckpointEntry& e : checkpoint_index(path)) {
+    if (e.name == name) {
+      entry_ = std::move(e);
+      found = true;
+      break;
+    }
+  }
+  XFT_CHECK(found, "stream: ", path, " has no tensor '", name, "'");
+  XFT_CHECK(!entry_.sizes.empty(), "stream: '", name, "' is 0-d; there are no rows to stream");
+  rows_ = entry_.sizes[0];
+  row_bytes_ = row_bytes(entry_);
+  if (row_bytes_ == 0) {
+    chunk_rows_ = std::max<int64_t>(rows_, 1);
+  } else {
+    chunk_rows_ = std::max<int64_t>(1, static_cast<int64_t>(chunk_bytes / row_bytes_));
+  }
+  num_chunks_ = (rows_ + chunk_rows_ - 1) / chunk_rows_;
+
+  fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  XFT_CHECK(fd_ >= 0, "stream: cannot open ", path, ": ", std::strerror(errno));
+  ::posix_fadvise(fd_, static_cast<off_t>(entry_.offset), static_cast<off_t>(entry_.nbytes),
+                  POSIX_FADV_SEQUENTIAL);
+}
+
+ChunkReader::~ChunkReader() {
+  // The read in flight still uses the descriptor.
+  if (pending_read_.valid()) pending_read_.wait();
+  if (fd_ >= 0) ::close(fd_);
+}
+
+StoragePtr ChunkReader::take_buffer(size_t nbytes) {
+  for (const StoragePtr& b : buffers_) {
+    if (b.use_count() == 1 && b->nbytes() >= nbytes) return b;
+  }
+  buffers_.push_back(std::make_shared<Storage>(std::max<size_t>(nbytes, 1), Device()));
+  return buffers_.back();
+}
+
+void ChunkReader::read_ahead(int64_t chunk) {
+  const int64_t row0 = chunk * chunk_rows_;
+  const int64_t rows = std::min(chunk_rows_, rows_ - row0);
+  const Shape shape = chunk_shape(entry_.sizes, rows);
+  const size_t nbytes = static_cast<size_t>(rows) * row_bytes_;
+  // The buffer is picked here, on the caller's thread, so the pool is only
+  // ever touched by one thread.
+  Tensor buf;
+  if (device_.is_cpu()) {
+    buf = Tensor::from_storage(take_buffer(nbytes), shape, contiguous_strides(shape), 0,
+                               entry_.dtype);
+  } else {
+#ifdef XFT_USE_CUDA
+    buf = cuda::empty_pinned(shape, entry_.dtype);
+#endif
+  }
+  pending_ = buf;
+  const uint64_t offset = entry_.offset + static_cast<uint64_t>(row0) * row_bytes_;
+  pending_read_ = io_.submit([this, buf, nbytes, offset] {
+    if (nbytes == 0) return;
+    read_fully(fd_, buf.data_ptr(), nbytes, offset, path_);
+    // Every byte is read once; the page cache is better kept for data that
+    // is reused.
+    ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(nbytes),
+                    POSIX_FADV_DONTNEED);
+  });
+}
+
+Tensor ChunkReader::next(int64_t* row) {
+  if (next_chunk_ >= num_chunks_) return Tensor();
+  // Nothing is read until the first call, so a reader can be opened just
+  // for sizes() and dtype().
+  if (!pending_read_.valid()) read_ahead(next_chunk_);
+  try {
+    pending_read_.get();
+  } catch (...) {
+    // Nothing further can be read in order.
+    next_chunk_ = num_chunks_;
+    throw;
+  }
+  Tensor chunk = std::move(pending_);
+  if (row != nullptr) *row = next_chunk_ * chunk_rows_;
+  if (++next_chunk_ < num_chunks_) read_ahead(next_chunk_);
+  if (device_.is_cpu()) return chunk;
+  // The pinned block goes back to the pool with `chunk` and is recycled
+  // once this copy completes.
+  autograd::NoGradGuard no_grad;
+  return chunk.to(device_, /*non_blocking=*/true);
+}
+
+ChunkWriter::ChunkWriter(const std::string& path, const std::string& name, const Shape& sizes,
+                         DType dtype)
+    : path_(path), tmp_(path + ".tmp") {
+  XFT_CHECK(!sizes.empty(), "stream: cannot write 0-d '", name, "' by rows");
+  for (int64_t n : sizes) XFT_CHECK(n >= 0, "stream: bad size ", n, " for '", name, "'");
+  std::vector<CheckpointEntry> entries = {{name, dtype, sizes}};
+  const std::string header = checkpoint_header(entries);
+  entry_ = entries[0];
+  row_bytes_ = row_bytes(entry_);
+
+  fd_ = ::open(tmp_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  XFT_CHECK(fd_ >= 0, "stream: cannot create ", tmp_, ": ", std::strerror(errno));
+  try {
+    write_fully(fd_, header.data(), header.size(), 0, tmp_);
+    // Sized up front: the padding reads back as zeros, and rows land at
+    // their final offsets.
+    XFT_CHECK(::ftruncate(fd_, static_cast<off_t>(entry_.offset + entry_.nbytes)) == 0,
+              "stream: cannot write ", tmp_, ": ", std::strerror(errno));
+  } catch (...) {
+    abandon();
+    throw;
+  }
+}
+
+ChunkWriter::~ChunkWriter() {
+  if (fd_ < 0) return;
+  if (pending_write_.valid()) pending_write_.wait();
+  abandon();
+}
+
+void ChunkWriter::abandon() {
+  ::close(fd_);
+  fd_ = -1;
+  std::remove(tmp_.c_str());
+}
+
+void ChunkWriter::wait() {
+  if (!pending_write_.valid()) return;
+  try {
+    pending_write_.get();
+  } catch (...) {
+    abandon();
+    throw;
+  }
+}
+
+void ChunkWriter::write(const Tensor& rows) {
+  XFT_CHECK(fd_ >= 0, "stream: ", path_, " is already closed");
+  XFT_CHECK(rows.defined() && rows.dim() == static_cast<int64_t>(entry_.sizes.size()),
+            "stream: chunks of '", entry_.name, "' must have ", entry_.sizes.size(), " dims");
+  XFT_CHECK(rows.dtype() == entry_.dtype, "stream: expected ", dtype_name(entry_.dtype),
+            " rows for '", entry_.name, "', got ", dtype_name(rows.dtype()));
+  XFT_CHECK(rows.size(0) <= entry_.sizes[0] - next_row_, "stream: '", entry_.name, "' has only ",
+            entry_.sizes[0], " rows");
+  for (size_t d = 1; d < entry_.sizes.size(); d++) {
+    XFT_CHECK(rows.size(d) == entry_.sizes[d], "stream: chunk of '", entry_.name,
+              "' has size ", rows.size(d), " in dim ", d, ", expected ", entry_.sizes[d]);
+  }
+  Tensor host;
+  {
+    autograd::NoGradGuard no_grad;
+    host = rows.device().is_cpu() ? rows.contiguous() : rows.to(Device()).contiguous();
+  }
+  const uint64_t offset = entry_.offset + static_cast<uint64_t>(next_row_) * row_bytes_;
+  next_row_ += rows.size(0);
+  // One write in flight: this chunk is queued behind the previous one,
+  // which must finish before the caller gets to produce a third.
+  wait();
+  pending_write_ = io_.submit([this, host, offset] {
+    if (host.nbytes() == 0) return;
+    write_fully(fd_, host.data_ptr(), host.nbytes(), offset, tmp_);
+    // Written once: let the kernel write back and drop the pages.
+    ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(host.nbytes()),
+                    POSIX_FADV_DONTNEED);
+  });
+}
+
+void ChunkWriter::close() {
+  XFT_CHECK(fd_ >= 0, "stream: ", path_, " is already closed");
+  wait();
+  if (next_row_ != entry_.sizes[0]) {
+    abandon();
+    XFT_FAIL("stream: '", entry_.name, "' closed after ", next_row_, " of ", entry_.sizes[0],
+             " rows");
+  }
+  const int fd = fd_;
+  fd_ = -1;
+  if (::close(fd) != 0) {
+    const int err = errno;
+    std::remove(tmp_.c_str());
+    XFT_FAIL("stream: cannot write ", tmp_, ": ", std::strerror(err));
+  }
+  if (std::rename(tmp_.c_str(), path_.c_str()) != 0) {
+    const int err = errno;
+    std::remove(tmp_.c_str());
+    XFT_FAIL("stream: cannot replace ", path_, ": ", std::strerror(err));
+  }
+}
+
+}  // namespace xft
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/serialize.h"
+#include "core/tensor.h"
+
+namespace xft {
+
+// Out-of-core access to one tensor of a checkpoint file (core/serialize.h),
+// a chunk of whole rows along dim 0 at a time.
+//
+// load() maps the file and lets page faults bring data in, which suits
+// weights but not a dataset larger than RAM: a fault reads only a little
+// ahead, so compute stalls on the disk, and every page touched stays cached
+// until memory pressure evicts it, pushing out everything else. Streaming
+// instead reads each chunk with pread() on a background thread into a
+// buffer of its own while the caller computes on the previous one (double
+// buffering), and drops the chunk's pages from the page cache once read.
+
+constexpr size_t kDefaultChunkBytes = size_t(64) << 20;
+
+// One background thread running jobs in submission order.
+class IoThread {
+ public:
+  IoThread();
+  // Finishes the jobs already submitted.
+  ~IoThread();
+
+  IoThread(const IoThread&) = delete;
+  IoThread& operator=(const IoThread&) = delete;
+
+  // The future rethrows whatever the job threw.
+  std::future<void> submit(std::function<void()> job);
+
+ private:
+  void run();
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::packaged_task<void()>> jobs_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+// Reads tensor `name` of the checkpoint at `path` front to back, one chunk
+// of at most chunk_bytes (but at least one row) per next(). For a CUDA
+// device each chunk is read into a pinned block and copied to the device
+// asynchronously on its current stream. Not thread-safe.
+class ChunkReader {
+ public:
+  ChunkReader(const std::string& path, const std::string& name,
+              size_t chunk_bytes = kDefaultChunkBytes, Device device = Device());
+  ~ChunkReader();
+
+  ChunkReader(const ChunkReader&) = delete;
+  ChunkReader& operator=(const ChunkReader&) = delete;
+
+  // The next chunk, rows [row, row + chunk.size(0)) of the tensor, or an
+  // undefined tensor after the last; throws the reader thread's I/O errors.
+  // On the CPU a chunk's buffer is reused for a later chunk only once every
+  // view of it is gone, so chunks may be kept as long as needed.
+  Tensor next(int64_t* row = nullptr);
+
+  const Shape& sizes() const { return entry_.sizes; }
+  DType dtype() const { return entry_.dtype; }
+  Device device() const { return device_; }
+  int64_t rows_per_chunk() const { return chunk_rows_; }
+
+ private:
+  // Reads chunk `chunk` into pending_ on the I/O thread.
+  void read_ahead(int64_t chunk);
+  StoragePtr take_buffer(size_t nbytes);
+
+  CheckpointEntry entry_;
+  std::string path_;
+  Device device_;
+  int fd_ = -1;
+  int64_t rows_ = 0, chunk_rows_ = 1, num_chunks_ = 0, next_chunk_ = 0;
+  uint64_t row_bytes_ = 0;
+  // CPU buffers, recycled once the pool holds their only reference.
+  std::vector<StoragePtr> buffers_;
+  Tensor pending_;
+  std::future<void> pending_read_;
+  IoThread io_;
+};
+
+// Writes a checkpoint holding the single tensor `name` of `sizes` and
+// `dtype` a chunk of rows at a time, for results too large for memory.
+// Chunks are written behind on a background thread while the caller
+// computes the next. As with save(), the file is built beside `path` and
+// only renamed over it by close(), once every row has been written; a
+// writer destroyed before that removes it. Not thread-safe.
+class ChunkWriter {
+ public:
+  ChunkWriter(const std::string& path, const std::string& name, const Shape& sizes, DType dtype);
+  ~ChunkWriter();
+
+  ChunkWriter(const ChunkWriter&) = delete;
+  ChunkWriter& operator=(const ChunkWriter&) = delete;
+
+  // The next rows in order: [n, sizes[1:]...] of the writer's dtype, on
+  // any device.
+  void write(const Tensor& rows);
+  void close();
+
+  int64_t rows_written() const { return next_row_; }
+
+ private:
+  void wait();
+  void abandon();
+
+  CheckpointEntry entry_;
+  std::string path_, tmp_;
+  int fd_ = -1;
+  int64_t next_row_ = 0;
+  uint64_t row_bytes_ = 0;
+  std::future<void> pending_write_;
+  IoThread io_;
+};
+
+}  // namespace xft
@@ -0,0 +1,540 @@
+#include "core/tensor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include "autograd/functions.h"
+#include "core/profiler.h"
+#include "lazy/lazy.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/copy.h"
+#include "cuda/host_allocator.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// PyTorch-style stride inference: a view is possible when each group of new
+// dims maps onto a run of old dims that is itself contiguous in memory.
+std::optional<Shape> compute_view_strides(const Shape& old_sizes, const Shape& old_strides,
+                                          const Shape& new_sizes) {
+  Shape new_strides(new_sizes.size());
+  if (old_sizes.empty()) {
+    std::fill(new_strides.begin(), new_strides.end(), 1);
+    return new_strides;
+  }
+  if (shape_numel(old_sizes) == 0) {
+    return contiguous_strides(new_sizes);
+  }
+
+  int64_t view_d = static_cast<int64_t>(new_sizes.size()) - 1;
+  int64_t chunk_base_stride = old_strides.back();
+  int64_t tensor_numel = 1;
+  int64_t view_numel = 1;
+  for (int64_t tensor_d = static_cast<int64_t>(old_sizes.size()) - 1; tensor_d >= 0; tensor_d--) {
+    tensor_numel *= old_sizes[tensor_d];
+    if (tensor_d == 0 ||
+        (old_sizes[tensor_d - 1] != 1 &&
+         old_strides[tensor_d - 1] != tensor_numel * chunk_base_stride)) {
+      while (view_d >= 0 && (view_numel < tensor_numel || new_sizes[view_d] == 1)) {
+        new_strides[view_d] = view_numel * chunk_base_stride;
+        view_numel *= new_sizes[view_d];
+        view_d--;
+      }
+      if (view_numel != tensor_numel) return std::nullopt;
+      if (tensor_d > 0) {
+        chunk_base_stride = old_strides[tensor_d - 1];
+        tensor_numel = 1;
+        view_numel = 1;
+      }
+    }
+  }
+  if (view_d != -1) return std::nullopt;
+  return new_strides;
+}
+
+// Resolves a single -1 entry against numel.
+Shape infer_size(Shape sizes, int64_t numel) {
+  int64_t known = 1;
+  int64_t infer_dim = -1;
+  for (size_t i = 0; i < sizes.size(); i++) {
+    if (sizes[i] == -1) {
+      XFT_CHECK(infer_dim == -1, "view: only one dimension can be -1");
+      infer_dim = static_cast<int64_t>(i);
+    } else {
+      XFT_CHECK(sizes[i] >= 0, "view: invalid size ", sizes[i]);
+      known *= sizes[i];
+    }
+  }
+  if (infer_dim >= 0) {
+    XFT_CHECK(known != 0 && numel % known == 0, "view: cannot infer size for ", numel,
+              " elements");
+    sizes[infer_dim] = numel / known;
+  } else {
+    XFT_CHECK(known == numel, "view: shape does not match ", numel, " elements");
+  }
+  return sizes;
+}
+
+// Visits every element of `sizes`, passing byte offsets into two strided
+// buffers. The innermost dim runs as a tight loop.
+template <typename F>
+void for_each_pair(const Shape& sizes, const Shape& a_strides, size_t a_elsize,
+                   const Shape& b_strides, size_t b_elsize, F&& fn) {
+  const int64_t ndim = static_cast<int64_t>(sizes.size());
+  if (shape_numel(sizes) == 0) return;
+  if (ndim == 0) {
+    fn(0, 0);
+    return;
+  }
+  const int64_t inner = sizes[ndim - 1];
+  const int64_t a_inner = a_strides[ndim - 1] * static_cast<int64_t>(a_elsize);
+  const int64_t b_inner = b_strides[ndim - 1] * static_cast<int64_t>(b_elsize);
+  Shape counter(ndim, 0);
+  int64_t a_off = 0;
+  int64_t b_off = 0;
+  while (true) {
+    for (int64_t i = 0; i < inner; i++) fn(a_off + i * a_inner, b_off + i * b_inner);
+    int64_t d = ndim - 2;
+    for (; d >= 0; d--) {
+      counter[d]++;
+      a_off += a_strides[d] * static_cast<int64_t>(a_elsize);
+      b_off += b_strides[d] * static_cast<int64_t>(b_elsize);
+      if (counter[d] < sizes[d]) break;
+      a_off -= counter[d] * a_strides[d] * static_cast<int64_t>(a_elsize);
+      b_off -= counter[d] * b_strides[d] * static_cast<int64_t>(b_elsize);
+      counter[d] = 0;
+    }
+    if (d < 0) return;
+  }
+}
+
+void copy_cpu(const Tensor& dst, const Tensor& src) {
+  if (dst.dtype() == src.dtype() && dst.is_contiguous() && src.is_contiguous()) {
+    std::memcpy(dst.data_ptr(), src.data_ptr(), dst.nbytes());
+    return;
+  }
+  char* d = static_cast<char*>(dst.data_ptr());
+  const char* s = static_cast<const char*>(src.data_ptr());
+  XFT_DISPATCH_ALL_TYPES_AND_HALF(dst.dtype(), "copy_", [&] {
+    using dst_t = scalar_t;
+    XFT_DISPATCH_ALL_TYPES_AND_HALF(src.dtype(), "copy_", [&] {
+      for_each_pair(dst.sizes(), dst.strides(), dst.element_size(), src.strides(),
+                    src.element_size(), [&](int64_t doff, int64_t soff) {
+                      *reinterpret_cast<dst_t*>(d + doff) =
+                          static_cast<dst_t>(*reinterpret_cast<const scalar_t*>(s + soff));
+                    });
+    });
+  });
+}
+
+void check_inplace(const char* op, const Tensor& t) {
+  XFT_CHECK(!autograd::GradMode::is_enabled() || !t.requires_grad(), op,
+            ": a tensor that requires grad cannot be modified in place; do it under no_grad "
+            "or on a detach()ed alias");
+}
+
+// The k-th innermost dim in memory of an ndim-d tensor in `format`.
+constexpr int64_t kChannelsLastOrder[4] = {1, 3, 2, 0};
+inline int64_t memory_dim(MemoryFormat format, int64_t ndim, int64_t k) {
+  return format == MemoryFormat::ChannelsLast ? kChannelsLastOrder[k] : ndim - 1 - k;
+}
+
+// A dense copy in `format`, recorded for autograd like clone().
+Tensor dense_copy(const Tensor& t, MemoryFormat format) {
+  Tensor out = Tensor::empty(t.sizes(), t.dtype(), t.device(), format);
+  {
+    autograd::NoGradGuard no_grad;
+    out.copy_(t);
+  }
+  autograd::record<autograd::CloneBackward>(out, {t});
+  return out;
+}
+
+}  // namespace
+
+Shape contiguous_strides(const Shape& sizes) {
+  Shape strides(sizes.size());
+  int64_t acc = 1;
+  for (int64_t i = static_cast<int64_t>(sizes.size()) - 1; i >= 0; i--) {
+    strides[i] = acc;
+    acc *= std::max<int64_t>(sizes[i], 1);
+  }
+  return strides;
+}
+
+Shape format_strides(const Shape& sizes, MemoryFormat format) {
+  const int64_t ndim = static_cast<int64_t>(sizes.size());
+  XFT_CHECK(format != MemoryFormat::ChannelsLast || ndim == 4,
+            "channels_last needs a 4-d tensor, got ", ndim, "-d");
+  Shape strides(ndim);
+  int64_t acc = 1;
+  for (int64_t k = 0; k < ndim; k++) {
+    const int64_t d = memory_dim(format, ndim, k);
+    strides[d] = acc;
+    acc *= std::max<int64_t>(sizes[d], 1);
+  }
+  return strides;
+}
+
+int64_t shape_numel(const Shape& sizes) {
+  int64_t n = 1;
+  for (int64_t s : sizes) n *= s;
+  return n;
+}
+
+Shape broadcast_shapes(const Shape& a, const Shape& b) {
+  const size_t ndim = std::max(a.size(), b.size());
+  Shape out(ndim);
+  for (size_t i = 0; i < ndim; i++) {
+    const int64_t da = i < ndim - a.size() ? 1 : a[i - (ndim - a.size())];
+    const int64_t db = i < ndim - b.size() ? 1 : b[i - (ndim - b.size())];
+    XFT_CHECK(da == db || da == 1 || db == 1, "shapes cannot be broadcast: size ", da,
+              " vs ", db, " at dimension ", i);
+    out[i] = da == 1 ? db : da;
+  }
+  return out;
+}
+
+int64_t wrap_dim(int64_t dim, int64_t ndim) {
+  int64_t bound = std::max<int64_t>(ndim, 1);
+  XFT_CHECK(dim >= -bound && dim < bound, "dimension ", dim, " out of range for ", ndim,
+            "-d tensor");
+  return dim < 0 ? dim + bound : dim;
+}
+
+Tensor Tensor::empty(const Shape& sizes, DType dtype, Device device, MemoryFormat format) {
+  for (int64_t s : sizes) XFT_CHECK(s >= 0, "empty: negative size ", s);
+  auto impl = std::make_shared<TensorImpl>();
+  impl->storage = std::make_shared<Storage>(shape_numel(sizes) * xft::element_size(dtype), device);
+  impl->sizes = sizes;
+  impl->strides = format_strides(sizes, format);
+  impl->dtype = dtype;
+  impl->inference = autograd::InferenceMode::is_enabled();
+  return Tensor(std::move(impl));
+}
+
+Tensor Tensor::zeros(const Shape& sizes, DType dtype, Device device) {
+  Tensor t = empty(sizes, dtype, device);
+  t.fill_(0.0);
+  return t;
+}
+
+Tensor Tensor::from_storage(StoragePtr storage, const Shape& sizes, const Shape& strides,
+                            int64_t offset, DType dtype) {
+  XFT_CHECK(sizes.size() == strides.size(), "from_storage: sizes/strides rank mismatch");
+  auto impl = std::make_shared<TensorImpl>();
+  impl->storage = std::move(storage);
+  impl->sizes = sizes;
+  impl->strides = strides;
+  impl->offset = offset;
+  impl->dtype = dtype;
+  return Tensor(std::move(impl));
+}
+
+int64_t Tensor::size(int64_t d) const { return impl_->sizes[wrap_dim(d, dim())]; }
+
+int64_t Tensor::stride(int64_t d) const { return impl_->strides[wrap_dim(d, dim())]; }
+
+int64_t Tensor::numel() const { return shape_numel(impl_->sizes); }
+
+void* Tensor::data_ptr() const {
+  char* base = static_cast<char*>(storage()->data());
+  if (base == nullptr) return nullptr;
+  return base + impl_->offset * static_cast<int64_t>(element_size());
+}
+
+bool Tensor::is_contiguous(MemoryFormat format) const {
+  if (format == MemoryFormat::ChannelsLast && dim() != 4) return false;
+  int64_t expected = 1;
+  for (int64_t k = 0; k < dim(); k++) {
+    const int64_t i = memory_dim(format, dim(), k);
+    if (impl_->sizes[i] == 1) continue;
+    if (impl_->strides[i] != expected) return false;
+    expected *= impl_->sizes[i];
+  }
+  return true;
+}
+
+MemoryFormat Tensor::suggest_memory_format() const {
+  return is_contiguous(MemoryFormat::ChannelsLast) && !is_contiguous()
+             ? MemoryFormat::ChannelsLast
+             : MemoryFormat::Contiguous;
+}
+
+bool Tensor::requires_grad() const {
+  const autograd::AutogradMeta* meta = impl_->autograd.get();
+  return meta != nullptr && (meta->requires_grad || meta->grad_fn != nullptr);
+}
+
+Tensor& Tensor::set_requires_grad(bool requires_grad) {
+  XFT_CHECK(is_leaf(), "set_requires_grad: only leaf tensors can be changed; use detach()");
+  XFT_CHECK(!requires_grad || is_floating(dtype()),
+            "set_requires_grad: only floating tensors can require grad, got ",
+            dtype_name(dtype()));
+  XFT_CHECK(!requires_grad || !is_inference(),
+            "set_requires_grad: tensors created under inference_mode cannot require grad; "
+            "clone() it outside inference_mode first");
+  auto& meta = impl_->autograd;
+  if (!meta) meta = std::make_shared<autograd::AutogradMeta>();
+  meta->requires_grad = requires_grad;
+  return *this;
+}
+
+bool Tensor::is_leaf() const { return grad_fn() == nullptr; }
+
+Tensor Tensor::grad() const {
+  return impl_->autograd ? impl_->autograd->grad : Tensor();
+}
+
+void Tensor::set_grad(const Tensor& grad) {
+  XFT_CHECK(!grad.defined() || grad.sizes() == sizes(),
+            "set_grad: gradient shape does not match the tensor");
+  auto& meta = impl_->autograd;
+  if (!meta) meta = std::make_shared<autograd::AutogradMeta>();
+  meta->grad = grad;
+}
+
+std::shared_ptr<autograd::Node> Tensor::grad_fn() const {
+  return impl_->autograd ? impl_->autograd->grad_fn : nullptr;
+}
+
+void Tensor::materialize() const { lazy::materialize(*this); }
+
+Tensor Tensor::detach() const { return as_strided(impl_->sizes, impl_->strides, impl_->offset); }
+
+Tensor Tensor::as_strided(const Shape& sizes, const Shape& strides, int64_t offset) const {
+  Tensor out = from_storage(storage(), sizes, strides, offset, impl_->dtype);
+  out.impl_->inference = impl_->inference;
+  return out;
+}
+
+Tensor Tensor::view(Shape sizes) const {
+  sizes = infer_size(std::move(sizes), numel());
+  auto strides = compute_view_strides(impl_->sizes, impl_->strides, sizes);
+  XFT_CHECK(strides.has_value(),
+            "view: size is not compatible with the input's strides; use reshape() instead");
+  Tensor out = as_strided(sizes, *strides, impl_->offset);
+  autograd::record<autograd::ReshapeBackward>(out, {*this}, *this);
+  return out;
+}
+
+Tensor Tensor::transpose(int64_t d0, int64_t d1) const {
+  d0 = wrap_dim(d0, dim());
+  d1 = wrap_dim(d1, dim());
+  Shape sizes = impl_->sizes;
+  Shape strides = impl_->strides;
+  std::swap(sizes[d0], sizes[d1]);
+  std::swap(strides[d0], strides[d1]);
+  Tensor out = as_strided(sizes, strides, impl_->offset);
+  autograd::record<autograd::TransposeBackward>(out, {*this}, d0, d1);
+  return out;
+}
+
+Tensor Tensor::permute(const std::vector<int64_t>& dims) const {
+  XFT_CHECK(static_cast<int64_t>(dims.size()) == dim(), "permute: expected ", dim(),
+            " dims, got ", dims.size());
+  Shape sizes(dims.size());
+  Shape strides(dims.size());
+  std::vector<int64_t> wrapped(dims.size());
+  std::vector<bool> seen(dims.size(), false);
+  for (size_t i = 0; i < dims.size(); i++) {
+    int64_t d = wrap_dim(dims[i], dim());
+    XFT_CHECK(!seen[d], "permute: repeated dim ", d);
+    seen[d] = true;
+    wrapped[i] = d;
+    sizes[i] = impl_->sizes[d];
+    strides[i] = impl_->strides[d];
+  }
+  Tensor out = as_strided(sizes, strides, impl_->offset);
+  autograd::record<autograd::PermuteBackward>(out, {*this}, std::move(wrapped));
+  return out;
+}
+
+Tensor Tensor::slice(int64_t d, int64_t start, int64_t end, int64_t step) const {
+  d = wrap_dim(d, dim());
+  XFT_CHECK(step > 0, "slice: step must be positive");
+  const int64_t len = impl_->sizes[d];
+  if (start < 0) start += len;
+  if (end < 0) end += len;
+  start = std::clamp<int64_t>(start, 0, len);
+  end = std::clamp<int64_t>(end, start, len);
+  Shape sizes = impl_->sizes;
+  Shape strides = impl_->strides;
+  sizes[d] = (end - start + step - 1) / step;
+  strides[d] *= step;
+  Tensor out = as_strided(sizes, strides, impl_->offset + start * impl_->strides[d]);
+  autograd::record<autograd::SliceBackward>(out, {*this}, *this, d, start, step);
+  return out;
+}
+
+Tensor Tensor::select(int64_t d, int64_t index) const {
+  d = wrap_dim(d, dim());
+  const int64_t len = impl_->sizes[d];
+  if (index < 0) index += len;
+  XFT_CHECK(index >= 0 && index < len, "select: index out of range for dim of size ", len);
+  Shape sizes = impl_->sizes;
+  Shape strides = impl_->strides;
+  int64_t offset = impl_->offset + index * strides[d];
+  sizes.erase(sizes.begin() + d);
+  strides.erase(strides.begin() + d);
+  Tensor out = as_strided(sizes, strides, offset);
+  autograd::record<autograd::SliceBackward>(out, {*this}, *this, d, index, 0);
+  return out;
+}
+
+Tensor Tensor::expand(const Shape& sizes) const {
+  const int64_t ndim = static_cast<int64_t>(sizes.size());
+  XFT_CHECK(ndim >= dim(), "expand: target has fewer dims than the tensor");
+  Shape new_strides(ndim);
+  Shape new_sizes(ndim);
+  for (int64_t i = ndim - 1; i >= 0; i--) {
+    const int64_t src = i - (ndim - dim());
+    const int64_t target = sizes[i];
+    if (src < 0) {
+      XFT_CHECK(target >= 0, "expand: -1 not allowed for new leading dims");
+      new_sizes[i] = target;
+      new_strides[i] = 0;
+      continue;
+    }
+    const int64_t cur = impl_->sizes[src];
+    if (target == -1 || target == cur) {
+      new_sizes[i] = cur;
+      new_strides[i] = impl_->strides[src];
+    } else {
+      XFT_CHECK(cur == 1, "expand: dim ", src, " of size ", cur, " cannot expand to ", target);
+      new_sizes[i] = target;
+      new_strides[i] = 0;
+    }
+  }
+  Tensor out = as_strided(new_sizes, new_strides, impl_->offset);
+  autograd::record<autograd::ExpandBackward>(out, {*this}, *this);
+  return out;
+}
+
+Tensor Tensor::squeeze() const {
+  Shape sizes;
+  Shape strides;
+  for (int64_t i = 0; i < dim(); i++) {
+    if (impl_->sizes[i] == 1) continue;
+    sizes.push_back(impl_->sizes[i]);
+    strides.push_back(impl_->strides[i]);
+  }
+  Tensor out = as_strided(sizes, strides, impl_->offset);
+  autograd::record<autograd::ReshapeBackward>(out, {*this}, *this);
+  return out;
+}
+
+Tensor Tensor::squeeze(int64_t d) const {
+  d = wrap_dim(d, dim());
+  Shape sizes = impl_->sizes;
+  Shape strides = impl_->strides;
+  if (dim() > 0 && sizes[d] == 1) {
+    sizes.erase(sizes.begin() + d);
+    strides.erase(strides.begin() + d);
+  }
+  Tensor out = as_strided(sizes, strides, impl_->offset);
+  autograd::record<autograd::ReshapeBackward>(out, {*this}, *this);
+  return out;
+}
+
+Tensor Tensor::unsqueeze(int64_t d) const {
+  d = wrap_dim(d, dim() + 1);
+  Shape sizes = impl_->sizes;
+  Shape strides = impl_->strides;
+  int64_t stride = d < dim() ? impl_->sizes[d] * impl_->strides[d] : 1;
+  sizes.insert(sizes.begin() + d, 1);
+  strides.insert(strides.begin() + d, stride);
+  Tensor out = as_strided(sizes, strides, impl_->offset);
+  autograd::record<autograd::ReshapeBackward>(out, {*this}, *this);
+  return out;
+}
+
+Tensor Tensor::contiguous(MemoryFormat format) const {
+  if (is_contiguous(format)) return *this;
+  return dense_copy(*this, format);
+}
+
+Tensor Tensor::reshape(Shape sizes) const {
+  sizes = infer_size(std::move(sizes), numel());
+  if (compute_view_strides(impl_->sizes, impl_->strides, sizes)) return view(sizes);
+  return clone().view(sizes);
+}
+
+Tensor Tensor::clone() const { return dense_copy(*this, MemoryFormat::Contiguous); }
+
+Tensor Tensor::to(DType dtype) const {
+  if (dtype == this->dtype()) return *this;
+  Tensor out = empty(sizes(), dtype, device());
+  {
+    autograd::NoGradGuard no_grad;
+    out.copy_(*this);
+  }
+  autograd::record<autograd::ToBackward>(out, {*this}, *this);
+  return out;
+}
+
+Tensor Tensor::to(Device device, bool non_blocking) const {
+  if (device == this->device()) return *this;
+  Tensor out;
+#ifdef XFT_USE_CUDA
+  if (non_blocking && device.is_cpu()) out = cuda::empty_pinned(sizes(), dtype());
+#endif
+  if (!out.defined()) out = empty(sizes(), dtype(), device);
+  {
+    autograd::NoGradGuard no_grad;
+    out.copy_(*this, non_blocking);
+  }
+  autograd::record<autograd::ToBackward>(out, {*this}, *this);
+  return out;
+}
+
+Tensor& Tensor::copy_(const Tensor& src, bool non_blocking) {
+  XFT_RECORD_OP("copy_", *this, src);
+  XFT_CHECK(sizes() == src.sizes(), "copy_: shape mismatch");
+  check_inplace("copy_", *this);
+  XFT_CHECK(!autograd::GradMode::is_enabled() || !src.requires_grad(),
+            "copy_: in-place copies are not recorded by autograd, but the source requires "
+            "grad; use clone() or detach() the source");
+  // A pending result owns all of its storage, and this overwrites it.
+  if (src.impl() != impl()) lazy::discard(*this);
+  storage()->bump_version();
+  if (numel() == 0) return *this;
+#ifdef XFT_USE_CUDA
+  if (device().is_cuda() || src.device().is_cuda()) {
+    cuda::copy_(*this, src, non_blocking);
+    return *this;
+  }
+#endif
+  (void)non_blocking;
+  XFT_CHECK(device().is_cpu() && src.device().is_cpu(), "copy_: ", src.device().str(), " -> ",
+            device().str(), " is not supported by this build");
+  copy_cpu(*this, src);
+  return *this;
+}
+
+Tensor& Tensor::fill_(double value) {
+  XFT_RECORD_OP("fill_", *this);
+  check_inplace("fill_", *this);
+  lazy::discard(*this);
+  storage()->bump_version();
+#ifdef XFT_USE_CUDA
+  if (device().is_cuda()) {
+    cuda::fill_(*this, value);
+    return *this;
+  }
+#endif
+  XFT_CHECK(device().is_cpu(), "fill_: ", device().str(), " is not supported by this build");
+  char* base = static_cast<char*>(data_ptr());
+  XFT_DISPATCH_ALL_TYPES_AND_HALF(dtype(), "fill_", [&] {
+    const scalar_t v = static_cast<scalar_t>(value);
+    for_each_pair(sizes(), strides(), element_size(), strides(), element_size(),
+                  [&](int64_t off, int64_t) { *reinterpret_cast<scalar_t*>(base + off) = v; });
+  });
+  return *this;
+}
+
+}  // namespace xft
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/device.h"
+#include "core/dtype.h"
+#include "core/storage.h"
+
+namespace xft {
+
+using Shape = std::vector<int64_t>;
+
+namespace autograd {
+struct AutogradMeta;
+class Node;
+}  // namespace autograd
+
+namespace lazy {
+struct Expr;
+}  // namespace lazy
+
+// How a dense tensor orders its elements in memory. ChannelsLast applies
+// to 4-D [N, C, H, W] tensors and stores them as N, H, W, C: the sizes keep
+// the NCHW order and only the strides change, so every op still sees NCHW.
+enum class MemoryFormat { Contiguous = 0, ChannelsLast = 1 };
+
+// Shape, strides and offset (all in elements) over a shared Storage.
+struct TensorImpl {
+  StoragePtr storage;
+  Shape sizes;
+  Shape strides;
+  int64_t offset = 0;
+  DType dtype = DType::Float32;
+  // Set once the tensor takes part in autograd (csrc/autograd/node.h).
+  std::shared_ptr<autograd::AutogradMeta> autograd;
+  // Set while the tensor is a pending lazy result (csrc/lazy/lazy.h): the
+  // storage is allocated but not yet computed.
+  std::shared_ptr<const lazy::Expr> lazy;
+  // Allocated under inference mode (csrc/autograd/grad_mode.h), or a view
+  // of such a tensor; kept out of autograd for good.
+  bool inference = false;
+};
+
+// A cheap, copyable handle. Copying a Tensor aliases the same TensorImpl;
+// view ops create a new TensorImpl over the same Storage.
+class Tensor {
+ public:
+  Tensor() = default;
+  explicit Tensor(std::shared_ptr<TensorImpl> impl) : impl_(std::move(impl)) {}
+
+  static Tensor empty(const Shape& sizes, DType dtype, Device device = Device(),
+                      MemoryFormat format = MemoryFormat::Contiguous);
+  static Tensor zeros(const Shape& sizes, DType dtype, Device device = Device());
+  // A view over existing storage; the caller guarantees the extent fits.
+  static Tensor from_storage(StoragePtr storage, const Shape& sizes, const Shape& strides,
+                             int64_t offset, DType dtype);
+
+  bool defined() const { return impl_ != nullptr; }
+  TensorImpl* impl() const { return impl_.get(); }
+
+  int64_t dim() const { return static_cast<int64_t>(impl_->sizes.size()); }
+  const Shape& sizes() const { return impl_->sizes; }
+  const Shape& strides() const { return impl_->strides; }
+  int64_t size(int64_t d) const;
+  int64_t stride(int64_t d) const;
+  int64_t numel() const;
+  int64_t storage_offset() const { return impl_->offset; }
+  DType dtype() const { return impl_->dtype; }
+  Device device() const { return impl_->storage->device(); }
+  size_t element_size() const { return xft::element_size(impl_->dtype); }
+  size_t nbytes() const { return numel() * element_size(); }
+  // Materializes a pending lazy result first, like every data access.
+  const StoragePtr& storage() const {
+    if (impl_->lazy) materialize();
+    return impl_->storage;
+  }
+
+  // Address of element [0, ..., 0].
+  void* data_ptr() const;
+  template <typename T>
+  T* data() const { return static_cast<T*>(data_ptr()); }
+
+  bool is_contiguous(MemoryFormat format = MemoryFormat::Contiguous) const;
+  // ChannelsLast for a 4-D tensor laid out as NHWC (and not also NCHW, as
+  // when C or H * W is 1), Contiguous otherwise: the layout results derived
+  // from this tensor should take.
+  MemoryFormat suggest_memory_format() const;
+  bool is_alias_of(const Tensor& other) const {
+    return impl_->storage == other.impl_->storage;
+  }
+  // Handles sharing this tensor's TensorImpl.
+  long use_count() const { return impl_.use_count(); }
+
+  // ---- lazy mode (csrc/lazy) ----
+  bool is_lazy() const { return impl_->lazy != nullptr; }
+  // Computes a pending lazy result into its storage; a no-op otherwise.
+  void materialize() const;
+
+  // ---- autograd (csrc/autograd) ----
+  bool requires_grad() const;
+  // Marks a leaf as requiring grad; only floating tensors can.
+  Tensor& set_requires_grad(bool requires_grad);
+  // A leaf with no grad_fn, either created by the user or not tracked.
+  bool is_leaf() const;
+  // Accumulated gradient of a leaf; undefined until backward reaches it.
+  Tensor grad() const;
+  void set_grad(const Tensor& grad);
+  // The node that produced this tensor, or null for leaves.
+  std::shared_ptr<autograd::Node> grad_fn() const;
+  // Same data and view geometry, cut off from the graph.
+  Tensor detach() const;
+  // Allocated under inference mode; such tensors never require grad and
+  // are never saved for backward.
+  bool is_inference() const { return impl_->inference; }
+
+  // ---- views: never copy, always share storage ----
+  Tensor view(Shape sizes) const;
+  Tensor transpose(int64_t d0, int64_t d1) const;
+  Tensor permute(const std::vector<int64_t>& dims) const;
+  Tensor slice(int64_t dim, int64_t start, int64_t end, int64_t step = 1) const;
+  Tensor select(int64_t dim, int64_t index) const;
+  Tensor expand(const Shape& sizes) const;
+  Tensor squeeze() const;
+  Tensor squeeze(int64_t dim) const;
+  Tensor unsqueeze(int64_t dim) const;
+  // Not recorded by autograd; the view ops above build on it.
+  Tensor as_strided(const Shape& sizes, const Shape& strides, int64_t offset) const;
+
+  // ---- copies ----
+  // Returns *this when already dense in `format`, otherwise a copy that is.
+  Tensor contiguous(MemoryFormat format = MemoryFormat::Contiguous) const;
+  // view() when the strides allow it, contiguous().view() otherwise.
+  Tensor reshape(Shape sizes) const;
+  Tensor clone() const;
+  Tensor to(DType dtype) const;
+  // With non_blocking, CUDA transfers are enqueued on the current stream and
+  // may still be in flight on return; device-to-host results land in pinned
+  // memory.
+  Tensor to(Device device, bool non_blocking = false) const;
+  // Elementwise copy from src (same shape, any strides/dtype) into *this.
+  // In-place writes are refused on tensors that require grad while grad
+  // mode is on.
+  Tensor& copy_(const Tensor& src, bool non_blocking = false);
+  Tensor& fill_(double value);
+
+ private:
+  std::shared_ptr<TensorImpl> impl_;
+};
+
+// Row-major strides for a dense tensor of the given shape.
+Shape contiguous_strides(const Shape& sizes);
+// Strides of a dense tensor of the given shape in `format`; ChannelsLast
+// needs 4 dims.
+Shape format_strides(const Shape& sizes, MemoryFormat format);
+int64_t shape_numel(const Shape& sizes);
+// NumPy broadcasting: dims are aligned from the right and each pair must be
+// equal or contain a 1.
+Shape broadcast_shapes(const Shape& a, const Shape& b);
+// Wraps a possibly negative dim into [0, ndim).
+int64_t wrap_dim(int64_t dim, int64_t ndim);
+
+}  // namespace xft
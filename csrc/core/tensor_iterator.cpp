@@ -0,0 +1,146 @@
+#include "core/tensor_iterator.h"
+
+namespace xft {
+
+TensorIterator& TensorIterator::add_output(const Tensor& t) {
+  XFT_CHECK(num_outputs_ == ntensors(), "TensorIterator: add outputs before inputs");
+  operands_.push_back({t, nullptr, {}});
+  num_outputs_++;
+  return *this;
+}
+
+TensorIterator& TensorIterator::add_input(const Tensor& t) {
+  XFT_CHECK(t.defined(), "TensorIterator: undefined input");
+  operands_.push_back({t, nullptr, {}});
+  return *this;
+}
+
+TensorIterator& TensorIterator::check_same_dtype(bool check) {
+  check_same_dtype_ = check;
+  return *this;
+}
+
+TensorIterator& TensorIterator::build() {
+  XFT_CHECK(num_outputs_ > 0 && ntensors() > num_outputs_,
+            "TensorIterator: needs at least one output and one input");
+  XFT_CHECK(ntensors() <= kMaxOperands, "TensorIterator: at most ", kMaxOperands, " operands");
+
+  // Broadcast shape, device and dtype come from the inputs.
+  const Tensor& first = operands_[num_outputs_].tensor;
+  if (build_dense()) return *this;
+  device_ = first.device();
+  Shape sizes = first.sizes();
+  for (int i = num_outputs_; i < ntensors(); i++) {
+    const Tensor& t = operands_[i].tensor;
+    XFT_CHECK(t.device() == device_, "expected all tensors on the same device, got ",
+              device_.str(), " and ", t.device().str());
+    XFT_CHECK(!check_same_dtype_ || t.dtype() == first.dtype(), "dtype mismatch (",
+              dtype_name(first.dtype()), " vs ", dtype_name(t.dtype()), ")");
+    sizes = broadcast_shapes(sizes, t.sizes());
+  }
+  // Outputs follow a channels-last first input, so NHWC activations stay
+  // NHWC through elementwise ops and still iterate as one dense run.
+  const MemoryFormat format =
+      sizes == first.sizes() ? first.suggest_memory_format() : MemoryFormat::Contiguous;
+  for (int i = 0; i < num_outputs_; i++) {
+    Tensor& t = operands_[i].tensor;
+    if (!t.defined()) {
+      t = Tensor::empty(sizes, first.dtype(), device_, format);
+      continue;
+    }
+    XFT_CHECK(t.sizes() == sizes, "output shape does not match the broadcast shape of the inputs");
+    XFT_CHECK(t.device() == device_, "expected all tensors on the same device, got ",
+              device_.str(), " and ", t.device().str());
+    XFT_CHECK(!check_same_dtype_ || t.dtype() == first.dtype(), "dtype mismatch (",
+              dtype_name(t.dtype()), " vs ", dtype_name(first.dtype()), ")");
+  }
+  numel_ = shape_numel(sizes);
+
+  // Byte strides over the broadcast shape, innermost first.
+  const int64_t nd = static_cast<int64_t>(sizes.size());
+  shape_.assign(sizes.rbegin(), sizes.rend());
+  for (Operand& op : operands_) {
+    const Tensor& t = op.tensor;
+    const int64_t elsize = static_cast<int64_t>(t.element_size());
+    const int64_t lead = nd - t.dim();
+    op.strides.assign(nd, 0);
+    for (int64_t d = lead; d < nd; d++) {
+      if (t.size(d - lead) != 1) op.strides[nd - 1 - d] = t.stride(d - lead) * elsize;
+    }
+    op.data = static_cast<char*>(t.data_ptr());
+  }
+  coalesce_dimensions();
+  // A 0-d iteration is one element.
+  if (shape_.empty()) {
+    shape_.push_back(1);
+    for (Operand& op : operands_) op.strides.push_back(0);
+  }
+  return *this;
+}
+
+// Dense operands of one shape iterate as a single run with unit strides,
+// with no broadcasting or coalescing to work out: the common case for small
+// ops, where that work would cost more than the kernel.
+bool TensorIterator::build_dense() {
+  const Tensor& first = operands_[num_outputs_].tensor;
+  if (first.dim() == 0) return false;
+  for (int i = 0; i < ntensors(); i++) {
+    const Tensor& t = operands_[i].tensor;
+    if (i < num_outputs_ && !t.defined()) continue;
+    if (t.device() != first.device() || t.sizes() != first.sizes() || !t.is_contiguous() ||
+        (check_same_dtype_ && t.dtype() != first.dtype())) {
+      return false;
+    }
+  }
+  device_ = first.device();
+  numel_ = first.numel();
+  shape_.assign(1, numel_);
+  for (Operand& op : operands_) {
+    if (!op.tensor.defined()) op.tensor = Tensor::empty(first.sizes(), first.dtype(), device_);
+    op.strides.assign(1, static_cast<int64_t>(op.tensor.element_size()));
+    op.data = static_cast<char*>(op.tensor.data_ptr());
+  }
+  return true;
+}
+
+// Merges dim d into the run below it whenever every operand steps from the
+// end of one into the start of the next (or either dim has size 1).
+void TensorIterator::coalesce_dimensions() {
+  const int nd = ndim();
+  if (nd <= 1) return;
+  auto can_merge = [&](int inner, int outer) {
+    if (shape_[inner] == 1 || shape_[outer] == 1) return true;
+    for (const Operand& op : operands_) {
+      if (op.strides[inner] * shape_[inner] != op.strides[outer]) return false;
+    }
+    return true;
+  };
+  int prev = 0;
+  for (int d = 1; d < nd; d++) {
+    if (can_merge(prev, d)) {
+      if (shape_[prev] == 1) {
+        for (Operand& op : operands_) op.strides[prev] = op.strides[d];
+      }
+      shape_[prev] *= shape_[d];
+    } else {
+      prev++;
+      if (prev != d) {
+        shape_[prev] = shape_[d];
+        for (Operand& op : operands_) op.strides[prev] = op.strides[d];
+      }
+    }
+  }
+  shape_.resize(prev + 1);
+  for (Operand& op : operands_) op.strides.resize(prev + 1);
+}
+
+bool TensorIterator::is_trivial_1d() const {
+  if (ndim() != 1) return false;
+  for (const Operand& op : operands_) {
+    const int64_t s = op.strides[0];
+    if (s != 0 && s != static_cast<int64_t>(op.tensor.element_size())) return false;
+  }
+  return true;
+}
+
+}  // namespace xft
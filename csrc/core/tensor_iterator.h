@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "core/parallel.h"
+#include "core/tensor.h"
+
+namespace xft {
+
+// Shared iteration setup for elementwise kernels, on any device. Given
+// outputs and inputs it:
+//  - broadcasts the inputs to a common shape (NumPy rules) and allocates
+//    undefined outputs with it, densely, on the inputs' device;
+//  - expresses every operand as byte strides over that shape, with stride 0
+//    on broadcast dims;
+//  - coalesces adjacent dims that every operand walks contiguously, so a
+//    dense or simply broadcast operation ends up as a single 1-D loop.
+//
+// Dims are stored innermost first. Operands are numbered outputs first,
+// then inputs, in the order they were added.
+//
+//   TensorIterator iter;
+//   iter.add_output().add_input(a).add_input(b).build();
+//   iter.for_each([&](char** data, const int64_t* strides, int64_t n) { ... });
+class TensorIterator {
+ public:
+  static constexpr int kMaxOperands = 8;
+
+  TensorIterator() { operands_.reserve(4); }
+
+  // An undefined tensor asks build() to allocate the output.
+  TensorIterator& add_output(const Tensor& t = Tensor());
+  TensorIterator& add_input(const Tensor& t);
+  // By default all operands must share one dtype.
+  TensorIterator& check_same_dtype(bool check);
+  TensorIterator& build();
+
+  int ntensors() const { return static_cast<int>(operands_.size()); }
+  int noutputs() const { return num_outputs_; }
+  int ndim() const { return static_cast<int>(shape_.size()); }
+  // The coalesced iteration shape, innermost first.
+  const Shape& shape() const { return shape_; }
+  int64_t numel() const { return numel_; }
+  Device device() const { return device_; }
+  // The dtype of the first output.
+  DType dtype() const { return operands_[0].tensor.dtype(); }
+
+  const Tensor& tensor(int arg) const { return operands_[arg].tensor; }
+  const Tensor& output(int i = 0) const { return operands_[i].tensor; }
+  char* data(int arg) const { return operands_[arg].data; }
+  // Byte strides for operand `arg`, aligned with shape().
+  const Shape& strides(int arg) const { return operands_[arg].strides; }
+
+  // True when iteration is one dim in which every operand either steps by
+  // its element size or stays put (stride 0).
+  bool is_trivial_1d() const;
+
+  // Calls loop(data, inner_strides, n) over the linear range [begin, end)
+  // of the iteration space, one call per run of the innermost dim. data[i]
+  // points at operand i's first element of the run; inner_strides[i] is its
+  // byte stride within it.
+  template <typename F>
+  void serial_for_each(F&& loop, int64_t begin, int64_t end) const;
+  // serial_for_each over [0, numel()) split across the CPU thread pool.
+  template <typename F>
+  void for_each(F&& loop, int64_t grain = kGrainSize) const;
+
+ private:
+  struct Operand {
+    Tensor tensor;
+    char* data = nullptr;
+    Shape strides;
+  };
+
+  bool build_dense();
+  void coalesce_dimensions();
+
+  std::vector<Operand> operands_;
+  int num_outputs_ = 0;
+  bool check_same_dtype_ = true;
+  Shape shape_;
+  int64_t numel_ = 0;
+  Device device_;
+};
+
+template <typename F>
+void TensorIterator::serial_for_each(F&& loop, int64_t begin, int64_t end) const {
+  if (begin >= end) return;
+  const int nt = ntensors();
+  const int nd = ndim();
+  std::array<char*, kMaxOperands> ptrs{};
+  std::array<int64_t, kMaxOperands> inner{};
+  for (int i = 0; i < nt; i++) {
+    ptrs[i] = operands_[i].data;
+    inner[i] = operands_[i].strides[0];
+  }
+  if (nd == 1) {  // a single run: nothing to carry
+    for (int i = 0; i < nt; i++) ptrs[i] += begin * inner[i];
+    loop(ptrs.data(), inner.data(), end - begin);
+    return;
+  }
+
+  std::vector<int64_t> index(nd);
+  int64_t rem = begin;
+  for (int d = 0; d < nd; d++) {
+    index[d] = rem % shape_[d];
+    rem /= shape_[d];
+    for (int i = 0; i < nt; i++) ptrs[i] += index[d] * operands_[i].strides[d];
+  }
+
+  for (int64_t cur = begin; cur < end;) {
+    const int64_t n = std::min(shape_[0] - index[0], end - cur);
+    loop(ptrs.data(), inner.data(), n);
+    cur += n;
+    if (cur >= end) break;
+    // Step to the start of the next run, carrying into outer dims.
+    for (int i = 0; i < nt; i++) ptrs[i] += (n - shape_[0]) * inner[i];
+    index[0] = 0;
+    for (int d = 1; d < nd; d++) {
+      for (int i = 0; i < nt; i++) ptrs[i] += operands_[i].strides[d];
+      if (++index[d] < shape_[d]) break;
+      for (int i = 0; i < nt; i++) ptrs[i] -= shape_[d] * operands_[i].strides[d];
+      index[d] = 0;
+    }
+  }
+}
+
+template <typename F>
+void TensorIterator::for_each(F&& loop, int64_t grain) const {
+  parallel_for(0, numel_, grain,
+               [&](int64_t lo, int64_t hi) { serial_for_each(loop, lo, hi); });
+}
+
+}  // namespace xft
@@ -0,0 +1,100 @@
+#include "cpu/kernels.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "core/macros.h"
+
+namespace xft::cpu {
+
+namespace {
+
+CpuCapability detect() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+#if defined(XFT_CPU_HAVE_AVX512_VNNI)
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vnni")) {
+    return CpuCapability::AVX512VNNI;
+  }
+#endif
+#if defined(XFT_CPU_HAVE_AVX512)
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+    return CpuCapability::AVX512;
+  }
+#endif
+#if defined(XFT_CPU_HAVE_AVX2)
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return CpuCapability::AVX2;
+  }
+#endif
+#endif
+  return CpuCapability::Default;
+}
+
+CpuCapability select() {
+  CpuCapability cap = detect();
+  const char* env = std::getenv("XFT_CPU_CAPABILITY");
+  if (env == nullptr || *env == '\0') return cap;
+  CpuCapability requested;
+  if (std::strcmp(env, "default") == 0) {
+    requested = CpuCapability::Default;
+  } else if (std::strcmp(env, "avx2") == 0) {
+    requested = CpuCapability::AVX2;
+  } else if (std::strcmp(env, "avx512") == 0) {
+    requested = CpuCapability::AVX512;
+  } else if (std::strcmp(env, "avx512_vnni") == 0) {
+    requested = CpuCapability::AVX512VNNI;
+  } else {
+    XFT_FAIL("XFT_CPU_CAPABILITY must be default, avx2, avx512 or avx512_vnni, got '", env,
+             "'");
+  }
+  // The override can only step down: running wider code than the CPU has
+  // would fault.
+  return static_cast<int>(requested) < static_cast<int>(cap) ? requested : cap;
+}
+
+}  // namespace
+
+CpuCapability cpu_capability() {
+  static const CpuCapability cap = select();
+  return cap;
+}
+
+const char* capability_name(CpuCapability cap) {
+  switch (cap) {
+    case CpuCapability::Default:
+      return "default";
+    case CpuCapability::AVX2:
+      return "avx2";
+    case CpuCapability::AVX512:
+      return "avx512";
+    case CpuCapability::AVX512VNNI:
+      return "avx512_vnni";
+  }
+  return "unknown";
+}
+
+const CpuKernels& cpu_kernels() {
+  static const CpuKernels& table = []() -> const CpuKernels& {
+    switch (cpu_capability()) {
+#if defined(XFT_CPU_HAVE_AVX512_VNNI)
+      case CpuCapability::AVX512VNNI:
+        return avx512_vnni::kernels();
+#endif
+#if defined(XFT_CPU_HAVE_AVX512)
+      case CpuCapability::AVX512:
+        return avx512::kernels();
+#endif
+#if defined(XFT_CPU_HAVE_AVX2)
+      case CpuCapability::AVX2:
+        return avx2::kernels();
+#endif
+      default:
+        return default_isa::kernels();
+    }
+  }();
+  return table;
+}
+
+}  // namespace xft::cpu
@@ -0,0 +1,184 @@
+#pragma once
+
+// The CPU kernel table. Each ISA build of cpu/kernels_impl.h fills one
+// CpuKernels; cpu_kernels() picks the widest one the host supports on first
+// use, so a single libxft.so runs on every machine.
+//
+// Kernels work on already-validated buffers of one dtype; the ops in
+// csrc/ops handle shapes, broadcasting (via TensorIterator) and dtype checks.
+// float16 and bfloat16 buffers compute in float: the elementwise, reduce,
+// softmax, row and paged-attention kernels widen and narrow internally
+// (their layer-norm mean/rstd are float32), the attention and convolution
+// kernels are float32/float64 only.
+
+#include <cstdint>
+
+#include "core/dispatch.h"
+#include "core/dtype.h"
+#include "ops/conv.h"
+#include "ops/op_kinds.h"
+#include "ops/paged_attention.h"
+
+namespace xft::cpu {
+
+enum class CpuCapability { Default, AVX2, AVX512, AVX512VNNI };
+
+// One attention head: dense q [L, D], k [S, D], v [S, Dv] and an output
+// [L, Dv]. With causal, key j is hidden from query i when j > i.
+struct AttentionShape {
+  int64_t L, S, D, Dv;
+  double scale;
+  bool causal;
+};
+
+// A quantized linear layer, y [M, N] = x [M, K] @ dequant(w)^T, in the
+// weight formats of ops/quantized.h: int8 (bits 8) or packed int4 (bits 4)
+// rows of K, with a float32 scale per group of group_size columns (dividing
+// K) of each row.
+struct QuantizedShape {
+  int64_t M, N, K, group_size;
+  int bits;
+};
+
+// Elementwise loops over n elements with per-operand steps, in elements
+// (TensorIterator's inner strides). Unit steps, and step 0 for a broadcast
+// input, run straight off memory; other steps gather into vectors.
+//
+// out[i * out_step] = op(in[i * in_step]). Floating dtypes.
+using UnaryLoop = void (*)(const void* in, int64_t in_step, void* out, int64_t out_step,
+                           int64_t n);
+// out[i * out_step] = op(a[i * a_step], b[i * b_step]). Every dtype but Bool;
+// the *Backward ops take floating dtypes only.
+using BinaryLoop = void (*)(const void* a, int64_t a_step, const void* b, int64_t b_step,
+                            void* out, int64_t out_step, int64_t n);
+
+// Every slot is a CPU one.
+struct ElementwiseLoops {
+  DispatchTable<UnaryOp, kNumUnaryOps, UnaryLoop> unary;
+  DispatchTable<BinaryOp, kNumBinaryOps, BinaryLoop> binary;
+};
+
+struct CpuKernels {
+  // Elementwise loops, one per (op, dtype) with the op and element type
+  // compiled in; slots are null where the op rejects the dtype.
+  const ElementwiseLoops* loops;
+  // Fills the CPU slots of `table` with those loops, run under the
+  // iterator's for_each.
+  void (*register_elementwise)(ElementwiseKernels& table);
+  // Reduces the middle dim of a dense [outer, r, inner] buffer into
+  // [outer, inner]. Sum of an integer dtype writes int64; otherwise out has
+  // the input dtype. Max needs r > 0. Floating dtypes combine the rows
+  // `block` columns at a time (0 for all of them), which only moves the
+  // speed.
+  void (*reduce)(ReduceOp op, DType dtype, const void* in, void* out, int64_t outer, int64_t r,
+                 int64_t inner, int64_t block);
+  // Softmax over the middle dim of a dense [outer, r, inner] buffer.
+  void (*softmax)(DType dtype, const void* in, void* out, int64_t outer, int64_t r,
+                  int64_t inner);
+  // Its backward, grad_in = out * (grad - sum(grad * out)) over the same dim.
+  void (*softmax_backward)(DType dtype, const void* grad, const void* out, void* grad_in,
+                           int64_t outer, int64_t r, int64_t inner);
+
+  // Row kernels over dense [rows, cols] buffers. Floating dtypes; weight and
+  // bias are [cols] and may be null.
+  //
+  // Layer norm of each row, or RMS norm (no centring) when rms. Writes y and
+  // the per-row rstd, and the per-row mean unless rms (mean may be null).
+  void (*layer_norm)(DType dtype, bool rms, const void* x, const void* weight, const void* bias,
+                     double eps, void* y, void* mean, void* rstd, int64_t rows, int64_t cols);
+  // dx for those rows from the saved mean (null for rms) and rstd. Adds the
+  // rows' contributions to dweight (sum of dy * xhat) and dbias (sum of dy)
+  // when those are non-null.
+  void (*layer_norm_backward)(DType dtype, bool rms, const void* dy, const void* x,
+                              const void* mean, const void* rstd, const void* weight, void* dx,
+                              void* dweight, void* dbias, int64_t rows, int64_t cols);
+  // y = gelu(x + bias), and dx = dy * gelu'(x + bias). bias is required.
+  void (*bias_gelu)(DType dtype, const void* x, const void* bias, void* y, int64_t rows,
+                    int64_t cols);
+  void (*bias_gelu_backward)(DType dtype, const void* dy, const void* x, const void* bias,
+                             void* dx, int64_t rows, int64_t cols);
+  // Elements [first, first + n) of a dense tensor with `cols` columns:
+  // y = residual + mask * (x + bias), the mask being `scale` where the Philox
+  // uniform for that element (core/philox.h, counters from offset) is below
+  // `keep` and 0 elsewhere. bias and residual may be null. With x = dy and
+  // neither, this is also the backward.
+  void (*dropout_add)(DType dtype, const void* x, const void* bias, const void* residual,
+                      void* y, int64_t first, int64_t n, int64_t cols, double keep,
+                      double scale, uint64_t seed, uint64_t offset);
+  // Attention rows [begin, end) of one head, tiled over queries and keys
+  // with an online softmax so no [L, S] score matrix exists. Writes o and
+  // lse, the logsumexp of each row's scaled scores (-inf for no keys).
+  void (*attention)(DType dtype, const AttentionShape& a, const void* q, const void* k,
+                    const void* v, void* o, void* lse, int64_t begin, int64_t end);
+  // Backward in two passes that recompute the probabilities from lse. The
+  // dq pass writes query rows [begin, end) of dq and of delta = rowsum(dout
+  // * o); the dkv pass then writes key rows [begin, end) of dk and dv.
+  void (*attention_backward_dq)(DType dtype, const AttentionShape& a, const void* q,
+                                const void* k, const void* v, const void* o, const void* dout,
+                                const void* lse, void* delta, void* dq, int64_t begin,
+                                int64_t end);
+  void (*attention_backward_dkv)(DType dtype, const AttentionShape& a, const void* q,
+                                 const void* k, const void* v, const void* dout,
+                                 const void* lse, const void* delta, void* dk, void* dv,
+                                 int64_t begin, int64_t end);
+  // Decode attention over a paged cache (PagedAttentionShape) for the
+  // (sequence, kv head) pairs [begin, end) of B * Hkv: each pair's query
+  // heads walk the sequence's blocks together with an online softmax, so
+  // every key and value row is read once per group. All floating dtypes.
+  void (*paged_attention)(DType dtype, const PagedAttentionShape& a, const void* q,
+                          const void* key_cache, const void* value_cache,
+                          const int32_t* block_tables, const int32_t* context_lens, void* out,
+                          int64_t begin, int64_t end);
+  // Output columns [begin, end) of every row of a quantized linear layer;
+  // scales is [N, K / group_size], bias [N] or null, y float32 [M, N].
+  // Weight-only: x is float32, and weights are widened to float as they
+  // are read. Dynamic: x was quantized to int8 per row with scales xscale
+  // [M] (values in [-127, 127]); products accumulate in int32 per group,
+  // with VNNI (vpdpbusd) on AVX512-VNNI hosts.
+  void (*quantized_linear)(const QuantizedShape& s, const float* x, const void* w,
+                           const float* scales, const float* bias, float* y, int64_t begin,
+                           int64_t end);
+  void (*quantized_linear_dynamic)(const QuantizedShape& s, const int8_t* x, const float* xscale,
+                                   const void* w, const float* scales, const float* bias,
+                                   float* y, int64_t begin, int64_t end);
+  // 2-D convolution over dense channels-last buffers (ConvShape), as
+  // implicit GEMMs reading every filter tap's rows in place. Cg = C /
+  // groups and Kg = K / groups; `tiling` only moves the speed.
+  //
+  // Output pixels [begin, end) of y [N * OH * OW, K]; w is [R, S, Cg, K]
+  // and bias [K] or null.
+  void (*conv2d)(DType dtype, const ConvShape& s, const ConvTiling& tiling, const void* x,
+                 const void* w, const void* bias, void* y, int64_t begin, int64_t end);
+  // Input pixels [begin, end) of dx [N * H * W, C]; w is [R, S, K, Cg].
+  void (*conv2d_backward_input)(DType dtype, const ConvShape& s, const ConvTiling& tiling,
+                                const void* dy, const void* w, void* dx, int64_t begin,
+                                int64_t end);
+  // Rows [begin, end) of dw [R * S * Cg, K], the weight gradient in the
+  // forward's [R, S, Cg, K] layout, summed over every pixel.
+  void (*conv2d_backward_weight)(DType dtype, const ConvShape& s, const ConvTiling& tiling,
+                                 const void* x, const void* dy, void* dw, int64_t begin,
+                                 int64_t end);
+};
+
+// The capability in use: the best the CPU reports via CPUID, lowered (never
+// raised) by XFT_CPU_CAPABILITY=default|avx2|avx512|avx512_vnni.
+CpuCapability cpu_capability();
+const char* capability_name(CpuCapability cap);
+
+const CpuKernels& cpu_kernels();
+
+// Per-ISA tables; only those compiled into this build are defined.
+namespace default_isa {
+const CpuKernels& kernels();
+}
+namespace avx2 {
+const CpuKernels& kernels();
+}
+namespace avx512 {
+const CpuKernels& kernels();
+}
+namespace avx512_vnni {
+const CpuKernels& kernels();
+}
+
+}  // namespace xft::cpu
@@ -0,0 +1,4 @@
+// Compiled with -mavx2 -mfma; selected only when CPUID reports both.
+#define XFT_CPU_CAPABILITY avx2
+#define XFT_CPU_VEC_BYTES 32
+#include "cpu/kernels_impl.h"
@@ -0,0 +1,4 @@
+// Compiled with -mavx512f -mavx512dq; selected only when CPUID reports AVX-512F.
+#define XFT_CPU_CAPABILITY avx512
+#define XFT_CPU_VEC_BYTES 64
+#include "cpu/kernels_impl.h"
@@ -0,0 +1,6 @@
+// Compiled with -mavx512f -mavx512dq -mavx512bw -mavx512vnni; selected only
+// when CPUID reports all four. Differs from the AVX-512 build in the int8
+// dot products of the dynamic quantized linear kernel.
+#define XFT_CPU_CAPABILITY avx512_vnni
+#define XFT_CPU_VEC_BYTES 64
+#include "cpu/kernels_impl.h"
@@ -0,0 +1,4 @@
+// Baseline build: SSE2 on x86-64, NEON on AArch64.
+#define XFT_CPU_CAPABILITY default_isa
+#define XFT_CPU_VEC_BYTES 16
+#include "cpu/kernels_impl.h"
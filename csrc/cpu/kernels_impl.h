@@ -0,0 +1,1487 @@
+#pragma once
+
+// Body of the CPU kernels, compiled once per ISA by cpu/kernels_<isa>.cpp.
+// See cpu/vec.h for the vector types.
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "core/dispatch.h"
+#include "core/macros.h"
+#include "core/philox.h"
+#include "cpu/kernels.h"
+#include "cpu/vec.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace xft::cpu::XFT_CPU_CAPABILITY {
+
+namespace {
+
+// ---- 16-bit floats ----
+//
+// float16 and bfloat16 have no kernels of their own: each entry point
+// widens their operands to float, runs the float kernel and narrows the
+// results back, elementwise loops in chunks of kHalfChunk elements and row
+// kernels a call's rows at once.
+
+constexpr int64_t kHalfChunk = 1024;
+
+template <typename H>
+void widen(const void* src, int64_t step, float* dst, int64_t n) {
+  const H* s = static_cast<const H*>(src);
+  for (int64_t i = 0; i < n; i++) dst[i] = static_cast<float>(s[i * step]);
+}
+
+template <typename H>
+void narrow(const float* src, void* dst, int64_t step, int64_t n) {
+  H* d = static_cast<H*>(dst);
+  for (int64_t i = 0; i < n; i++) d[i * step] = H(src[i]);
+}
+
+// A float copy of n dense elements; empty for a null src.
+template <typename H>
+std::vector<float> widened(const void* src, int64_t n) {
+  std::vector<float> v(src != nullptr ? n : 0);
+  if (src != nullptr) widen<H>(src, 1, v.data(), n);
+  return v;
+}
+
+inline const float* data_or_null(const std::vector<float>& v) {
+  return v.empty() ? nullptr : v.data();
+}
+
+template <typename H>
+const H* offset(const void* p, int64_t elements) {
+  return static_cast<const H*>(p) + elements;
+}
+
+// out[i] = f(in[i]). The tail goes through a zero-padded vector so every
+// element sees the same arithmetic.
+template <typename T, typename F>
+void map_unary(const T* in, T* out, int64_t n, F f) {
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  int64_t i = 0;
+  for (; i + W <= n; i += W) store(out + i, f(load<V>(in + i)));
+  if (i < n) {
+    T buf[W] = {};
+    std::memcpy(buf, in + i, (n - i) * sizeof(T));
+    store(buf, f(load<V>(buf)));
+    std::memcpy(out + i, buf, (n - i) * sizeof(T));
+  }
+}
+
+// Strided form: lanes are gathered into a vector, transformed, and
+// scattered back.
+template <typename T, typename F>
+void map_unary(const T* in, int64_t in_step, T* out, int64_t out_step, int64_t n, F f) {
+  if (in_step == 1 && out_step == 1) return map_unary(in, out, n, f);
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  for (int64_t i = 0; i < n; i += W) {
+    const int64_t count = std::min(W, n - i);
+    T buf[W] = {};
+    for (int64_t j = 0; j < count; j++) buf[j] = in[(i + j) * in_step];
+    store(buf, f(load<V>(buf)));
+    for (int64_t j = 0; j < count; j++) out[(i + j) * out_step] = buf[j];
+  }
+}
+
+// The function of each unary op, on vectors.
+template <UnaryOp kOp>
+auto unary_fn() {
+  if constexpr (kOp == UnaryOp::Exp) return [](auto v) { return exp(v); };
+  if constexpr (kOp == UnaryOp::Log) return [](auto v) { return log(v); };
+  if constexpr (kOp == UnaryOp::Sqrt) return [](auto v) { return sqrt(v); };
+  if constexpr (kOp == UnaryOp::Tanh) return [](auto v) { return tanh(v); };
+  if constexpr (kOp == UnaryOp::Sigmoid) return [](auto v) { return sigmoid(v); };
+  if constexpr (kOp == UnaryOp::Relu) return [](auto v) { return relu(v); };
+  if constexpr (kOp == UnaryOp::Gelu) return [](auto v) { return gelu(v); };
+}
+
+template <typename T>
+constexpr bool kIsHalf = std::is_same_v<T, Half> || std::is_same_v<T, BFloat16>;
+
+template <UnaryOp kOp, typename T>
+struct UnaryLoopFor {
+  static void run(const void* in, int64_t in_step, void* out, int64_t out_step, int64_t n) {
+    if constexpr (kIsHalf<T>) {
+      float x[kHalfChunk], y[kHalfChunk];
+      for (int64_t i = 0; i < n; i += kHalfChunk) {
+        const int64_t m = std::min(kHalfChunk, n - i);
+        widen<T>(offset<T>(in, i * in_step), in_step, x, m);
+        map_unary(x, y, m, unary_fn<kOp>());
+        narrow<T>(y, static_cast<T*>(out) + i * out_step, out_step, m);
+      }
+    } else {
+      map_unary(static_cast<const T*>(in), in_step, static_cast<T*>(out), out_step, n,
+                unary_fn<kOp>());
+    }
+  }
+};
+
+// f takes two vectors. A scalar operand is splatted once; the tail is padded
+// with ones so integer division never sees a zero in the unused lanes. Types
+// without a vector type (bool) take the scalar loop.
+template <typename T, bool kAScalar, bool kBScalar, typename F>
+void map_binary(const T* a, const T* b, T* out, int64_t n, F f) {
+  if constexpr (VecType<T>::kValid) {
+    using V = vec_t<T>;
+    constexpr int64_t W = kLanes<T>;
+    const V va = kAScalar ? splat<V>(a[0]) : V{};
+    const V vb = kBScalar ? splat<V>(b[0]) : V{};
+    int64_t i = 0;
+    for (; i + W <= n; i += W) {
+      store(out + i, f(kAScalar ? va : load<V>(a + i), kBScalar ? vb : load<V>(b + i)));
+    }
+    if (i < n) {
+      T abuf[W], bbuf[W];
+      std::fill(abuf, abuf + W, T(1));
+      std::fill(bbuf, bbuf + W, T(1));
+      std::memcpy(abuf, a + i, (kAScalar ? 0 : n - i) * sizeof(T));
+      std::memcpy(bbuf, b + i, (kBScalar ? 0 : n - i) * sizeof(T));
+      store(abuf, f(kAScalar ? va : load<V>(abuf), kBScalar ? vb : load<V>(bbuf)));
+      std::memcpy(out + i, abuf, (n - i) * sizeof(T));
+    }
+  } else {
+    for (int64_t i = 0; i < n; i++) {
+      out[i] = static_cast<T>(f(a[kAScalar ? 0 : i], b[kBScalar ? 0 : i]));
+    }
+  }
+}
+
+// Arbitrary steps: gather both operands a vector at a time (padding with
+// ones, as above) and scatter the result.
+template <typename T, typename F>
+void map_binary_strided(const T* a, int64_t sa, const T* b, int64_t sb, T* out, int64_t so,
+                        int64_t n, F f) {
+  if constexpr (VecType<T>::kValid) {
+    using V = vec_t<T>;
+    constexpr int64_t W = kLanes<T>;
+    for (int64_t i = 0; i < n; i += W) {
+      const int64_t count = std::min(W, n - i);
+      T abuf[W], bbuf[W];
+      std::fill(abuf, abuf + W, T(1));
+      std::fill(bbuf, bbuf + W, T(1));
+      for (int64_t j = 0; j < count; j++) {
+        abuf[j] = a[(i + j) * sa];
+        bbuf[j] = b[(i + j) * sb];
+      }
+      store(abuf, f(load<V>(abuf), load<V>(bbuf)));
+      for (int64_t j = 0; j < count; j++) out[(i + j) * so] = abuf[j];
+    }
+  } else {
+    for (int64_t i = 0; i < n; i++) out[i * so] = static_cast<T>(f(a[i * sa], b[i * sb]));
+  }
+}
+
+template <typename T, typename F>
+void binary_steps(const T* a, int64_t sa, const T* b, int64_t sb, T* out, int64_t so,
+                  int64_t n, F f) {
+  const bool a_ok = sa == 0 || sa == 1, b_ok = sb == 0 || sb == 1;
+  if (so != 1 || !a_ok || !b_ok) return map_binary_strided(a, sa, b, sb, out, so, n, f);
+  if (sa == 0 && sb == 0) return map_binary<T, true, true>(a, b, out, n, f);
+  if (sa == 0) return map_binary<T, true, false>(a, b, out, n, f);
+  if (sb == 0) return map_binary<T, false, true>(a, b, out, n, f);
+  return map_binary<T, false, false>(a, b, out, n, f);
+}
+
+// The function of each binary op, on vectors of T.
+template <BinaryOp kOp, typename T>
+auto binary_fn() {
+  if constexpr (kOp == BinaryOp::Add) return [](auto x, auto y) { return x + y; };
+  if constexpr (kOp == BinaryOp::Sub) return [](auto x, auto y) { return x - y; };
+  if constexpr (kOp == BinaryOp::Mul) return [](auto x, auto y) { return x * y; };
+  if constexpr (kOp == BinaryOp::Div) return [](auto x, auto y) { return x / y; };
+  if constexpr (kOp == BinaryOp::Maximum) return [](auto x, auto y) { return max_op(x, y); };
+  if constexpr (kOp == BinaryOp::Minimum) return [](auto x, auto y) { return min_op(x, y); };
+  if constexpr (kOp == BinaryOp::GeMask) return [](auto x, auto y) { return ge_mask(x, y); };
+  if constexpr (kOp == BinaryOp::EqMask) return [](auto x, auto y) { return eq_mask(x, y); };
+  if constexpr (kOp == BinaryOp::ReluBackward) {
+    return [](auto g, auto y) { return y > 0 ? g : decltype(g){}; };
+  }
+  if constexpr (kOp == BinaryOp::SigmoidBackward) {
+    return [](auto g, auto y) { return g * y * (T(1) - y); };
+  }
+  if constexpr (kOp == BinaryOp::TanhBackward) {
+    return [](auto g, auto y) { return g * (T(1) - y * y); };
+  }
+  if constexpr (kOp == BinaryOp::GeluBackward) {
+    return [](auto g, auto x) { return g * gelu_grad(x); };
+  }
+}
+
+template <BinaryOp kOp, typename T>
+struct BinaryLoopFor {
+  static void run(const void* a, int64_t a_step, const void* b, int64_t b_step, void* out,
+                  int64_t out_step, int64_t n) {
+    if constexpr (kIsHalf<T>) {
+      float x[kHalfChunk], y[kHalfChunk], z[kHalfChunk];
+      for (int64_t i = 0; i < n; i += kHalfChunk) {
+        const int64_t m = std::min(kHalfChunk, n - i);
+        // A broadcast operand (step 0) widens to one repeated value.
+        widen<T>(offset<T>(a, i * a_step), a_step, x, m);
+        widen<T>(offset<T>(b, i * b_step), b_step, y, m);
+        map_binary<float, false, false>(x, y, z, m, binary_fn<kOp, float>());
+        narrow<T>(z, static_cast<T*>(out) + i * out_step, out_step, m);
+      }
+    } else {
+      binary_steps(static_cast<const T*>(a), a_step, static_cast<const T*>(b), b_step,
+                   static_cast<T*>(out), out_step, n, binary_fn<kOp, T>());
+    }
+  }
+};
+
+// The loops above under TensorIterator. Steps divide by a compile-time
+// element size.
+template <auto kOp, typename T>
+struct UnaryKernelFor {
+  static void run(const TensorIterator& iter) {
+    constexpr int64_t el = sizeof(T);
+    // Transcendentals cost several times a load/store; split them finer.
+    constexpr int64_t grain = kOp == UnaryOp::Relu ? kGrainSize : kGrainSize / 4;
+    iter.for_each(
+        [](char** data, const int64_t* strides, int64_t n) {
+          UnaryLoopFor<kOp, T>::run(data[1], strides[1] / el, data[0], strides[0] / el, n);
+        },
+        grain);
+  }
+};
+
+template <auto kOp, typename T>
+struct BinaryKernelFor {
+  static void run(const TensorIterator& iter) {
+    constexpr int64_t el = sizeof(T);
+    iter.for_each([](char** data, const int64_t* strides, int64_t n) {
+      BinaryLoopFor<kOp, T>::run(data[1], strides[1] / el, data[2], strides[2] / el, data[0],
+                                 strides[0] / el, n);
+    });
+  }
+};
+
+const ElementwiseLoops* elementwise_loops() {
+  static const ElementwiseLoops loops = [] {
+    ElementwiseLoops l;
+    register_kernels<UnaryLoopFor>(l.unary, DeviceType::CPU, UnaryOps(), FloatingTypes());
+    register_kernels<BinaryLoopFor>(l.binary, DeviceType::CPU, ArithmeticOps(), NumericTypes());
+    register_kernels<BinaryLoopFor>(l.binary, DeviceType::CPU, BackwardOps(), FloatingTypes());
+    return l;
+  }();
+  return &loops;
+}
+
+void register_elementwise(ElementwiseKernels& t) {
+  register_kernels<UnaryKernelFor>(t.unary, DeviceType::CPU, UnaryOps(), FloatingTypes());
+  register_kernels<BinaryKernelFor>(t.binary, DeviceType::CPU, ArithmeticOps(), NumericTypes());
+  register_kernels<BinaryKernelFor>(t.binary, DeviceType::CPU, BackwardOps(), FloatingTypes());
+}
+
+// ---- reductions ----
+
+template <typename T>
+struct SumOp {
+  static T identity() { return T(0); }
+  template <typename X>
+  static X combine(X a, X b) { return a + b; }
+  template <typename V>
+  static T horizontal(V v) { return hsum<T>(v); }
+};
+
+template <typename T>
+struct MaxOp {
+  static T identity() {
+    return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                : std::numeric_limits<T>::lowest();
+  }
+  template <typename X>
+  static X combine(X a, X b) { return max_op(a, b); }
+  template <typename V>
+  static T horizontal(V v) { return hmax<T>(v); }
+};
+
+// Reduction of a contiguous row. Four independent accumulators hide the
+// latency of the vector add/max chain.
+template <typename T, typename Op>
+T reduce_row(const T* p, int64_t n, T init) {
+  int64_t i = 0;
+  T acc = init;
+  if constexpr (VecType<T>::kValid) {
+    using V = vec_t<T>;
+    constexpr int64_t W = kLanes<T>;
+    if (n >= W) {
+      V acc0 = splat<V>(Op::identity()), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+      for (; i + 4 * W <= n; i += 4 * W) {
+        acc0 = Op::combine(acc0, load<V>(p + i));
+        acc1 = Op::combine(acc1, load<V>(p + i + W));
+        acc2 = Op::combine(acc2, load<V>(p + i + 2 * W));
+        acc3 = Op::combine(acc3, load<V>(p + i + 3 * W));
+      }
+      for (; i + W <= n; i += W) acc0 = Op::combine(acc0, load<V>(p + i));
+      acc = Op::combine(
+          acc, Op::horizontal(Op::combine(Op::combine(acc0, acc1), Op::combine(acc2, acc3))));
+    }
+  }
+  for (; i < n; i++) acc = Op::combine(acc, p[i]);
+  return acc;
+}
+
+// acc[j] = combine(acc[j], row[j]) over a contiguous run.
+template <typename T, typename Op>
+void combine_into(T* acc, const T* row, int64_t n) {
+  map_binary<T, false, false>(acc, row, acc, n,
+                              [](auto x, auto y) { return Op::combine(x, y); });
+}
+
+// With inner > 1 the r rows are combined into the output `block` columns
+// at a time, so the block being summed stays in L1 while the rows stream
+// past it.
+template <typename T, typename Op>
+void reduce_typed(const T* in, T* out, int64_t outer, int64_t r, int64_t inner,
+                  int64_t block) {
+  for (int64_t o = 0; o < outer; o++) {
+    const T* src = in + o * r * inner;
+    T* dst = out + o * inner;
+    if (inner == 1) {
+      dst[0] = r > 0 ? reduce_row<T, Op>(src + 1, r - 1, src[0]) : T(0);
+      continue;
+    }
+    if (r == 0) {
+      std::fill(dst, dst + inner, T(0));
+      continue;
+    }
+    for (int64_t c0 = 0; c0 < inner; c0 += block) {
+      const int64_t nc = std::min(block, inner - c0);
+      std::memcpy(dst + c0, src + c0, nc * sizeof(T));
+      for (int64_t j = 1; j < r; j++) combine_into<T, Op>(dst + c0, src + j * inner + c0, nc);
+    }
+  }
+}
+
+// Integer sums accumulate and store in int64 so uint8/int32 do not wrap.
+template <typename T>
+void sum_to_int64(const T* in, int64_t* out, int64_t outer, int64_t r, int64_t inner) {
+  for (int64_t o = 0; o < outer; o++) {
+    int64_t* dst = out + o * inner;
+    std::fill(dst, dst + inner, int64_t(0));
+    for (int64_t j = 0; j < r; j++) {
+      const T* src = in + (o * r + j) * inner;
+      for (int64_t i = 0; i < inner; i++) dst[i] += static_cast<int64_t>(src[i]);
+    }
+  }
+}
+
+template <typename T>
+void reduce_dispatch(ReduceOp op, const T* in, void* out, int64_t outer, int64_t r,
+                     int64_t inner, int64_t block) {
+  if (op == ReduceOp::Sum && !std::is_floating_point_v<T>) {
+    sum_to_int64(in, static_cast<int64_t*>(out), outer, r, inner);
+  } else if constexpr (std::is_same_v<T, bool>) {
+    // max over bool is "any"; sum of bool went to int64 above.
+    auto* dst = static_cast<bool*>(out);
+    for (int64_t o = 0; o < outer; o++) {
+      for (int64_t i = 0; i < inner; i++) {
+        bool any = false;
+        for (int64_t j = 0; j < r; j++) any |= in[(o * r + j) * inner + i];
+        dst[o * inner + i] = any;
+      }
+    }
+  } else if (op == ReduceOp::Sum) {
+    reduce_typed<T, SumOp<T>>(in, static_cast<T*>(out), outer, r, inner, block);
+  } else {
+    reduce_typed<T, MaxOp<T>>(in, static_cast<T*>(out), outer, r, inner, block);
+  }
+}
+
+void reduce(ReduceOp op, DType dtype, const void* in, void* out, int64_t outer, int64_t r,
+            int64_t inner, int64_t block) {
+  if (block <= 0) block = std::max<int64_t>(inner, 1);
+  if (is_reduced_floating(dtype)) {
+    XFT_DISPATCH_HALF_TYPES(dtype, "reduce", [&] {
+      const std::vector<float> x = widened<scalar_t>(in, outer * r * inner);
+      std::vector<float> y(outer * inner);
+      reduce_dispatch<float>(op, x.data(), y.data(), outer, r, inner, block);
+      narrow<scalar_t>(y.data(), out, 1, outer * inner);
+    });
+    return;
+  }
+  XFT_DISPATCH_ALL_TYPES(dtype, "reduce", [&] {
+    reduce_dispatch(op, static_cast<const scalar_t*>(in), out, outer, r, inner, block);
+  });
+}
+
+// ---- softmax ----
+
+template <typename T>
+void softmax_row(const T* in, T* out, int64_t n) {
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  const T mx = reduce_row<T, MaxOp<T>>(in + 1, n - 1, in[0]);
+  // exp(x - max) into out, summing as we go; the padded tail adds exp(-inf) = 0.
+  V vsum = V{};
+  int64_t i = 0;
+  for (; i + W <= n; i += W) {
+    const V e = exp(load<V>(in + i) - mx);
+    store(out + i, e);
+    vsum += e;
+  }
+  if (i < n) {
+    T buf[W];
+    std::fill(buf, buf + W, -INFINITY);
+    std::memcpy(buf, in + i, (n - i) * sizeof(T));
+    const V e = exp(load<V>(buf) - mx);
+    vsum += e;
+    store(buf, e);
+    std::memcpy(out + i, buf, (n - i) * sizeof(T));
+  }
+  const T scale = T(1) / hsum<T>(vsum);
+  map_unary(out, out, n, [scale](auto v) { return v * scale; });
+}
+
+// Softmax over dim r of [r, inner] rows: every step is a vertical vector op
+// across the contiguous inner dim.
+template <typename T>
+void softmax_columns(const T* in, T* out, int64_t r, int64_t inner, T* mx, T* sum) {
+  std::memcpy(mx, in, inner * sizeof(T));
+  for (int64_t j = 1; j < r; j++) combine_into<T, MaxOp<T>>(mx, in + j * inner, inner);
+  std::fill(sum, sum + inner, T(0));
+  for (int64_t j = 0; j < r; j++) {
+    T* row = out + j * inner;
+    map_binary<T, false, false>(in + j * inner, mx, row, inner,
+                                [](auto x, auto m) { return exp(x - m); });
+    combine_into<T, SumOp<T>>(sum, row, inner);
+  }
+  const T one = 1;
+  map_unary(sum, sum, inner, [one](auto v) { return one / v; });
+  for (int64_t j = 0; j < r; j++) {
+    T* row = out + j * inner;
+    map_binary<T, false, false>(row, sum, row, inner, [](auto x, auto s) { return x * s; });
+  }
+}
+
+void softmax(DType dtype, const void* in, void* out, int64_t outer, int64_t r, int64_t inner) {
+  if (r == 0) return;
+  if (is_reduced_floating(dtype)) {
+    XFT_DISPATCH_HALF_TYPES(dtype, "softmax", [&] {
+      const int64_t n = outer * r * inner;
+      const std::vector<float> x = widened<scalar_t>(in, n);
+      std::vector<float> y(n);
+      softmax(DType::Float32, x.data(), y.data(), outer, r, inner);
+      narrow<scalar_t>(y.data(), out, 1, n);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "softmax", [&] {
+    const auto* src = static_cast<const scalar_t*>(in);
+    auto* dst = static_cast<scalar_t*>(out);
+    if (inner == 1) {
+      for (int64_t o = 0; o < outer; o++) softmax_row(src + o * r, dst + o * r, r);
+      return;
+    }
+    std::vector<scalar_t> scratch(2 * inner);
+    for (int64_t o = 0; o < outer; o++) {
+      softmax_columns(src + o * r * inner, dst + o * r * inner, r, inner, scratch.data(),
+                      scratch.data() + inner);
+    }
+  });
+}
+
+// grad_in = out * (grad - sum(grad * out)) along r, fused into one pass
+// for the dot product and one for the result.
+template <typename T>
+void softmax_backward_row(const T* g, const T* y, T* dx, int64_t n) {
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  V vdot = V{};
+  int64_t i = 0;
+  for (; i + W <= n; i += W) vdot += load<V>(g + i) * load<V>(y + i);
+  T dot = hsum<T>(vdot);
+  for (; i < n; i++) dot += g[i] * y[i];
+  map_binary<T, false, false>(g, y, dx, n, [dot](auto gv, auto yv) { return yv * (gv - dot); });
+}
+
+template <typename T>
+void softmax_backward_columns(const T* g, const T* y, T* dx, int64_t r, int64_t inner, T* dot) {
+  std::fill(dot, dot + inner, T(0));
+  for (int64_t j = 0; j < r; j++) {
+    const T* gj = g + j * inner;
+    const T* yj = y + j * inner;
+    for (int64_t k = 0; k < inner; k++) dot[k] += gj[k] * yj[k];
+  }
+  for (int64_t j = 0; j < r; j++) {
+    const T* gj = g + j * inner;
+    const T* yj = y + j * inner;
+    T* dj = dx + j * inner;
+    for (int64_t k = 0; k < inner; k++) dj[k] = yj[k] * (gj[k] - dot[k]);
+  }
+}
+
+void softmax_backward(DType dtype, const void* grad, const void* out, void* grad_in,
+                      int64_t outer, int64_t r, int64_t inner) {
+  if (r == 0) return;
+  if (is_reduced_floating(dtype)) {
+    XFT_DISPATCH_HALF_TYPES(dtype, "softmax_backward", [&] {
+      const int64_t n = outer * r * inner;
+      const std::vector<float> g = widened<scalar_t>(grad, n), y = widened<scalar_t>(out, n);
+      std::vector<float> dx(n);
+      softmax_backward(DType::Float32, g.data(), y.data(), dx.data(), outer, r, inner);
+      narrow<scalar_t>(dx.data(), grad_in, 1, n);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "softmax_backward", [&] {
+    const auto* g = static_cast<const scalar_t*>(grad);
+    const auto* y = static_cast<const scalar_t*>(out);
+    auto* dx = static_cast<scalar_t*>(grad_in);
+    const int64_t slab = r * inner;
+    if (inner == 1) {
+      for (int64_t o = 0; o < outer; o++) softmax_backward_row(g + o * r, y + o * r, dx + o * r, r);
+      return;
+    }
+    std::vector<scalar_t> dot(inner);
+    for (int64_t o = 0; o < outer; o++) {
+      softmax_backward_columns(g + o * slab, y + o * slab, dx + o * slab, r, inner, dot.data());
+    }
+  });
+}
+
+// ---- layer norm / RMS norm ----
+
+// Statistics come from two passes over the row while it is in cache:
+// the mean, then the centred sum of squares (stable for large means).
+template <typename T>
+void layer_norm_row(bool rms, const T* x, const T* w, const T* b, T eps, T* y, T* mean_out,
+                    T* rstd_out, int64_t n) {
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  const T mean = rms ? T(0) : reduce_row<T, SumOp<T>>(x, n, T(0)) / static_cast<T>(n);
+  const V vm = splat<V>(mean);
+  V vss = V{};
+  int64_t i = 0;
+  for (; i + W <= n; i += W) {
+    const V d = load<V>(x + i) - vm;
+    vss += d * d;
+  }
+  T ss = hsum<T>(vss);
+  for (; i < n; i++) ss += (x[i] - mean) * (x[i] - mean);
+  const T rstd = T(1) / std::sqrt(ss / static_cast<T>(n) + eps);
+  if (mean_out != nullptr) *mean_out = mean;
+  *rstd_out = rstd;
+
+  const V vr = splat<V>(rstd);
+  for (i = 0; i + W <= n; i += W) {
+    V v = (load<V>(x + i) - vm) * vr;
+    if (w != nullptr) v *= load<V>(w + i);
+    if (b != nullptr) v += load<V>(b + i);
+    store(y + i, v);
+  }
+  for (; i < n; i++) {
+    T v = (x[i] - mean) * rstd;
+    if (w != nullptr) v *= w[i];
+    if (b != nullptr) v += b[i];
+    y[i] = v;
+  }
+}
+
+void layer_norm(DType dtype, bool rms, const void* x, const void* weight, const void* bias,
+                double eps, void* y, void* mean, void* rstd, int64_t rows, int64_t cols) {
+  if (is_reduced_floating(dtype)) {
+    // mean and rstd are float32 already.
+    XFT_DISPATCH_HALF_TYPES(dtype, "layer_norm", [&] {
+      const std::vector<float> px = widened<scalar_t>(x, rows * cols);
+      const std::vector<float> pw = widened<scalar_t>(weight, cols);
+      const std::vector<float> pb = widened<scalar_t>(bias, cols);
+      std::vector<float> py(rows * cols);
+      layer_norm(DType::Float32, rms, px.data(), data_or_null(pw), data_or_null(pb), eps,
+                 py.data(), mean, rstd, rows, cols);
+      narrow<scalar_t>(py.data(), y, 1, rows * cols);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "layer_norm", [&] {
+    const auto* px = static_cast<const scalar_t*>(x);
+    auto* py = static_cast<scalar_t*>(y);
+    auto* pm = static_cast<scalar_t*>(mean);
+    auto* pr = static_cast<scalar_t*>(rstd);
+    for (int64_t r = 0; r < rows; r++) {
+      layer_norm_row(rms, px + r * cols, static_cast<const scalar_t*>(weight),
+                     static_cast<const scalar_t*>(bias), static_cast<scalar_t>(eps),
+                     py + r * cols, pm != nullptr ? pm + r : nullptr, pr + r, cols);
+    }
+  });
+}
+
+// With xhat = (x - mean) * rstd and g = dy * w:
+//   dx = rstd * (g - mean(g) - xhat * mean(g * xhat))
+// (no mean(g) term for RMS norm, whose xhat is x * rstd).
+template <typename T>
+void layer_norm_backward_row(bool rms, const T* dy, const T* x, T mean, T rstd, const T* w,
+                             T* dx, T* dw, T* db, int64_t n) {
+  T sg = 0, sgx = 0;
+  for (int64_t i = 0; i < n; i++) {
+    const T xhat = (x[i] - mean) * rstd;
+    const T g = w != nullptr ? dy[i] * w[i] : dy[i];
+    sg += g;
+    sgx += g * xhat;
+  }
+  const T inv_n = T(1) / static_cast<T>(n);
+  const T c1 = rms ? T(0) : sg * inv_n;
+  const T c2 = sgx * inv_n;
+  for (int64_t i = 0; i < n; i++) {
+    const T xhat = (x[i] - mean) * rstd;
+    const T g = w != nullptr ? dy[i] * w[i] : dy[i];
+    dx[i] = rstd * (g - c1 - xhat * c2);
+    if (dw != nullptr) dw[i] += dy[i] * xhat;
+    if (db != nullptr) db[i] += dy[i];
+  }
+}
+
+void layer_norm_backward(DType dtype, bool rms, const void* dy, const void* x, const void* mean,
+                         const void* rstd, const void* weight, void* dx, void* dweight,
+                         void* dbias, int64_t rows, int64_t cols) {
+  if (is_reduced_floating(dtype)) {
+    // mean and rstd are float32 already; dweight / dbias accumulate in float.
+    XFT_DISPATCH_HALF_TYPES(dtype, "layer_norm_backward", [&] {
+      const std::vector<float> pg = widened<scalar_t>(dy, rows * cols);
+      const std::vector<float> px = widened<scalar_t>(x, rows * cols);
+      const std::vector<float> pw = widened<scalar_t>(weight, cols);
+      std::vector<float> dw = widened<scalar_t>(dweight, cols);
+      std::vector<float> db = widened<scalar_t>(dbias, cols);
+      std::vector<float> pd(rows * cols);
+      layer_norm_backward(DType::Float32, rms, pg.data(), px.data(), mean, rstd,
+                          data_or_null(pw), pd.data(), dw.empty() ? nullptr : dw.data(),
+                          db.empty() ? nullptr : db.data(), rows, cols);
+      narrow<scalar_t>(pd.data(), dx, 1, rows * cols);
+      if (!dw.empty()) narrow<scalar_t>(dw.data(), dweight, 1, cols);
+      if (!db.empty()) narrow<scalar_t>(db.data(), dbias, 1, cols);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "layer_norm_backward", [&] {
+    const auto* pm = static_cast<const scalar_t*>(mean);
+    const auto* pr = static_cast<const scalar_t*>(rstd);
+    for (int64_t r = 0; r < rows; r++) {
+      layer_norm_backward_row(rms, static_cast<const scalar_t*>(dy) + r * cols,
+                              static_cast<const scalar_t*>(x) + r * cols,
+                              pm != nullptr ? pm[r] : scalar_t(0), pr[r],
+                              static_cast<const scalar_t*>(weight),
+                              static_cast<scalar_t*>(dx) + r * cols,
+                              static_cast<scalar_t*>(dweight), static_cast<scalar_t*>(dbias),
+                              cols);
+    }
+  });
+}
+
+// ---- bias epilogues ----
+
+void bias_gelu(DType dtype, const void* x, const void* bias, void* y, int64_t rows,
+               int64_t cols) {
+  if (is_reduced_floating(dtype)) {
+    XFT_DISPATCH_HALF_TYPES(dtype, "bias_gelu", [&] {
+      const std::vector<float> px = widened<scalar_t>(x, rows * cols);
+      const std::vector<float> pb = widened<scalar_t>(bias, cols);
+      std::vector<float> py(rows * cols);
+      bias_gelu(DType::Float32, px.data(), pb.data(), py.data(), rows, cols);
+      narrow<scalar_t>(py.data(), y, 1, rows * cols);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "bias_gelu", [&] {
+    const auto* px = static_cast<const scalar_t*>(x);
+    const auto* pb = static_cast<const scalar_t*>(bias);
+    auto* py = static_cast<scalar_t*>(y);
+    for (int64_t r = 0; r < rows; r++) {
+      map_binary<scalar_t, false, false>(px + r * cols, pb, py + r * cols, cols,
+                                         [](auto a, auto b) { return gelu(a + b); });
+    }
+  });
+}
+
+void bias_gelu_backward(DType dtype, const void* dy, const void* x, const void* bias, void* dx,
+                        int64_t rows, int64_t cols) {
+  if (is_reduced_floating(dtype)) {
+    XFT_DISPATCH_HALF_TYPES(dtype, "bias_gelu_backward", [&] {
+      const std::vector<float> pg = widened<scalar_t>(dy, rows * cols);
+      const std::vector<float> px = widened<scalar_t>(x, rows * cols);
+      const std::vector<float> pb = widened<scalar_t>(bias, cols);
+      std::vector<float> pd(rows * cols);
+      bias_gelu_backward(DType::Float32, pg.data(), px.data(), pb.data(), pd.data(), rows, cols);
+      narrow<scalar_t>(pd.data(), dx, 1, rows * cols);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "bias_gelu_backward", [&] {
+    const auto* pb = static_cast<const scalar_t*>(bias);
+    for (int64_t r = 0; r < rows; r++) {
+      const auto* g = static_cast<const scalar_t*>(dy) + r * cols;
+      const auto* px = static_cast<const scalar_t*>(x) + r * cols;
+      auto* pd = static_cast<scalar_t*>(dx) + r * cols;
+      // x + bias goes through dx, which each vector step reads before writing.
+      map_binary<scalar_t, false, false>(px, pb, pd, cols, [](auto a, auto b) { return a + b; });
+      map_binary<scalar_t, false, false>(g, pd, pd, cols,
+                                         [](auto gv, auto s) { return gv * gelu_grad(s); });
+    }
+  });
+}
+
+template <typename T>
+void dropout_add_typed(const T* x, const T* bias, const T* residual, T* y, int64_t first,
+                       int64_t n, int64_t cols, T keep, T scale, uint64_t seed,
+                       uint64_t offset) {
+  constexpr int kPer = kPhiloxPerBlock<T>;
+  // Randoms are drawn kBatch Philox blocks at a time: the blocks are
+  // independent, so their rounds overlap instead of stalling on one chain.
+  constexpr int kBatch = 16;
+  // keep >= 1 is eval mode: nothing is dropped and no randoms are drawn.
+  const bool drop = keep < T(1);
+  T u[kBatch * kPer] = {};
+  int64_t col = bias != nullptr ? first % cols : 0;
+  for (int64_t i = 0; i < n;) {
+    // Batches are aligned to whole blocks; the first may start mid-block.
+    const int64_t idx = first + i;
+    const int64_t blk0 = idx / kPer;
+    const int w0 = static_cast<int>(idx % kPer);
+    if (drop) {
+      for (int k = 0; k < kBatch; k++) {
+        philox_uniform(philox(seed, offset + static_cast<uint64_t>(blk0 + k)), u + k * kPer);
+      }
+    }
+    const int64_t m = std::min<int64_t>(kBatch * kPer - w0, n - i);
+    for (int64_t j = 0; j < m; j++, i++) {
+      T v = x[i];
+      if (bias != nullptr) {
+        v += bias[col];
+        if (++col == cols) col = 0;
+      }
+      v = !drop || u[w0 + j] < keep ? v * scale : T(0);
+      y[i] = residual != nullptr ? residual[i] + v : v;
+    }
+  }
+}
+
+void dropout_add(DType dtype, const void* x, const void* bias, const void* residual, void* y,
+                 int64_t first, int64_t n, int64_t cols, double keep, double scale,
+                 uint64_t seed, uint64_t offset) {
+  if (is_reduced_floating(dtype)) {
+    // Same Philox words as float32: element i always sees the same mask.
+    XFT_DISPATCH_HALF_TYPES(dtype, "dropout_add", [&] {
+      const std::vector<float> px = widened<scalar_t>(x, n);
+      const std::vector<float> pb = widened<scalar_t>(bias, cols);
+      const std::vector<float> pr = widened<scalar_t>(residual, n);
+      std::vector<float> py(n);
+      dropout_add_typed<float>(px.data(), data_or_null(pb), data_or_null(pr), py.data(), first,
+                               n, cols, static_cast<float>(keep), static_cast<float>(scale),
+                               seed, offset);
+      narrow<scalar_t>(py.data(), y, 1, n);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "dropout_add", [&] {
+    dropout_add_typed(static_cast<const scalar_t*>(x), static_cast<const scalar_t*>(bias),
+                      static_cast<const scalar_t*>(residual), static_cast<scalar_t*>(y), first,
+                      n, cols, static_cast<scalar_t>(keep), static_cast<scalar_t>(scale), seed,
+                      offset);
+  });
+}
+
+// ---- attention ----
+
+// The tile sizes keep a key tile (and its value rows) resident in L1/L2
+// while every query row of the tile is walked over it.
+constexpr int64_t kAttnQueryTile = 32;
+constexpr int64_t kAttnKeyTile = 64;
+
+template <typename T>
+T dot(const T* a, const T* b, int64_t n) {
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  V acc = V{};
+  int64_t i = 0;
+  for (; i + W <= n; i += W) acc += load<V>(a + i) * load<V>(b + i);
+  T r = hsum<T>(acc);
+  for (; i < n; i++) r += a[i] * b[i];
+  return r;
+}
+
+// y = y * beta + alpha * x.
+template <typename T>
+void scale_axpy(T beta, T alpha, const T* x, T* y, int64_t n) {
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  const V vb = splat<V>(beta), va = splat<V>(alpha);
+  int64_t i = 0;
+  for (; i + W <= n; i += W) store(y + i, load<V>(y + i) * vb + va * load<V>(x + i));
+  for (; i < n; i++) y[i] = y[i] * beta + alpha * x[i];
+}
+
+// Keys of [kb, kb + nc) that query i may see.
+inline int64_t visible_keys(const AttentionShape& a, int64_t i, int64_t kb, int64_t nc) {
+  return a.causal ? std::max<int64_t>(0, std::min(nc, i - kb + 1)) : nc;
+}
+
+template <typename T>
+void attention_typed(const AttentionShape& a, const T* q, const T* k, const T* v, T* o, T* lse,
+                     int64_t begin, int64_t end) {
+  const T scale = static_cast<T>(a.scale);
+  const T neg_inf = -std::numeric_limits<T>::infinity();
+  std::vector<T> acc(kAttnQueryTile * a.Dv);
+  T m[kAttnQueryTile], l[kAttnQueryTile], s[kAttnKeyTile];
+  for (int64_t qb = begin; qb < end; qb += kAttnQueryTile) {
+    const int64_t nr = std::min(kAttnQueryTile, end - qb);
+    std::fill(acc.begin(), acc.end(), T(0));
+    std::fill(m, m + nr, neg_inf);
+    std::fill(l, l + nr, T(0));
+    const int64_t kend = a.causal ? std::min(a.S, qb + nr) : a.S;
+    for (int64_t kb = 0; kb < kend; kb += kAttnKeyTile) {
+      const int64_t nc = std::min(kAttnKeyTile, kend - kb);
+      for (int64_t r = 0; r < nr; r++) {
+        const int64_t i = qb + r;
+        const int64_t nj = visible_keys(a, i, kb, nc);
+        if (nj == 0) continue;
+        T mt = neg_inf;
+        for (int64_t j = 0; j < nj; j++) {
+          s[j] = dot(q + i * a.D, k + (kb + j) * a.D, a.D) * scale;
+          mt = std::max(mt, s[j]);
+        }
+        // Rescale what the earlier tiles accumulated to the new running max.
+        const T mnew = std::max(m[r], mt);
+        const T alpha = std::exp(m[r] - mnew);
+        T* accr = acc.data() + r * a.Dv;
+        T sum = T(0);
+        for (int64_t j = 0; j < nj; j++) {
+          const T p = std::exp(s[j] - mnew);
+          sum += p;
+          scale_axpy(j == 0 ? alpha : T(1), p, v + (kb + j) * a.Dv, accr, a.Dv);
+        }
+        l[r] = l[r] * alpha + sum;
+        m[r] = mnew;
+      }
+    }
+    for (int64_t r = 0; r < nr; r++) {
+      const int64_t i = qb + r;
+      const T inv = l[r] > T(0) ? T(1) / l[r] : T(0);
+      T* oi = o + i * a.Dv;
+      const T* accr = acc.data() + r * a.Dv;
+      for (int64_t c = 0; c < a.Dv; c++) oi[c] = accr[c] * inv;
+      lse[i] = l[r] > T(0) ? m[r] + std::log(l[r]) : neg_inf;
+    }
+  }
+}
+
+// dq_i = scale * sum_j p_ij (dp_ij - delta_i) k_j, dp_ij = dout_i . v_j.
+template <typename T>
+void attention_backward_dq_typed(const AttentionShape& a, const T* q, const T* k, const T* v,
+                                 const T* o, const T* dout, const T* lse, T* delta, T* dq,
+                                 int64_t begin, int64_t end) {
+  const T scale = static_cast<T>(a.scale);
+  for (int64_t i = begin; i < end; i++) {
+    delta[i] = dot(dout + i * a.Dv, o + i * a.Dv, a.Dv);
+    std::fill(dq + i * a.D, dq + (i + 1) * a.D, T(0));
+  }
+  for (int64_t qb = begin; qb < end; qb += kAttnQueryTile) {
+    const int64_t nr = std::min(kAttnQueryTile, end - qb);
+    const int64_t kend = a.causal ? std::min(a.S, qb + nr) : a.S;
+    for (int64_t kb = 0; kb < kend; kb += kAttnKeyTile) {
+      const int64_t nc = std::min(kAttnKeyTile, kend - kb);
+      for (int64_t r = 0; r < nr; r++) {
+        const int64_t i = qb + r;
+        const int64_t nj = visible_keys(a, i, kb, nc);
+        for (int64_t j = 0; j < nj; j++) {
+          const T* kj = k + (kb + j) * a.D;
+          const T p = std::exp(dot(q + i * a.D, kj, a.D) * scale - lse[i]);
+          const T dp = dot(dout + i * a.Dv, v + (kb + j) * a.Dv, a.Dv);
+          scale_axpy(T(1), scale * p * (dp - delta[i]), kj, dq + i * a.D, a.D);
+        }
+      }
+    }
+  }
+}
+
+// dv_j = sum_i p_ij dout_i and dk_j = scale * sum_i p_ij (dp_ij - delta_i) q_i.
+template <typename T>
+void attention_backward_dkv_typed(const AttentionShape& a, const T* q, const T* k, const T* v,
+                                  const T* dout, const T* lse, const T* delta, T* dk, T* dv,
+                                  int64_t begin, int64_t end) {
+  const T scale = static_cast<T>(a.scale);
+  std::fill(dk + begin * a.D, dk + end * a.D, T(0));
+  std::fill(dv + begin * a.Dv, dv + end * a.Dv, T(0));
+  for (int64_t kb = begin; kb < end; kb += kAttnKeyTile) {
+    const int64_t nc = std::min(kAttnKeyTile, end - kb);
+    // Under the causal mask only queries from kb on see this tile.
+    for (int64_t qb = a.causal ? kb : 0; qb < a.L; qb += kAttnQueryTile) {
+      const int64_t nr = std::min(kAttnQueryTile, a.L - qb);
+      for (int64_t c = 0; c < nc; c++) {
+        const int64_t j = kb + c;
+        const T* kj = k + j * a.D;
+        const T* vj = v + j * a.Dv;
+        for (int64_t r = a.causal ? std::max<int64_t>(0, j - qb) : 0; r < nr; r++) {
+          const int64_t i = qb + r;
+          if (lse[i] == -std::numeric_limits<T>::infinity()) continue;
+          const T p = std::exp(dot(q + i * a.D, kj, a.D) * scale - lse[i]);
+          const T dp = dot(dout + i * a.Dv, vj, a.Dv);
+          scale_axpy(T(1), p, dout + i * a.Dv, dv + j * a.Dv, a.Dv);
+          scale_axpy(T(1), scale * p * (dp - delta[i]), q + i * a.D, dk + j * a.D, a.D);
+        }
+      }
+    }
+  }
+}
+
+void attention(DType dtype, const AttentionShape& a, const void* q, const void* k, const void* v,
+               void* o, void* lse, int64_t begin, int64_t end) {
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "attention", [&] {
+    attention_typed(a, static_cast<const scalar_t*>(q), static_cast<const scalar_t*>(k),
+                    static_cast<const scalar_t*>(v), static_cast<scalar_t*>(o),
+                    static_cast<scalar_t*>(lse), begin, end);
+  });
+}
+
+void attention_backward_dq(DType dtype, const AttentionShape& a, const void* q, const void* k,
+                           const void* v, const void* o, const void* dout, const void* lse,
+                           void* delta, void* dq, int64_t begin, int64_t end) {
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "attention_backward", [&] {
+    attention_backward_dq_typed(
+        a, static_cast<const scalar_t*>(q), static_cast<const scalar_t*>(k),
+        static_cast<const scalar_t*>(v), static_cast<const scalar_t*>(o),
+        static_cast<const scalar_t*>(dout), static_cast<const scalar_t*>(lse),
+        static_cast<scalar_t*>(delta), static_cast<scalar_t*>(dq), begin, end);
+  });
+}
+
+void attention_backward_dkv(DType dtype, const AttentionShape& a, const void* q, const void* k,
+                            const void* v, const void* dout, const void* lse, const void* delta,
+                            void* dk, void* dv, int64_t begin, int64_t end) {
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "attention_backward", [&] {
+    attention_backward_dkv_typed(
+        a, static_cast<const scalar_t*>(q), static_cast<const scalar_t*>(k),
+        static_cast<const scalar_t*>(v), static_cast<const scalar_t*>(dout),
+        static_cast<const scalar_t*>(lse), static_cast<const scalar_t*>(delta),
+        static_cast<scalar_t*>(dk), static_cast<scalar_t*>(dv), begin, end);
+  });
+}
+
+// ---- paged attention ----
+
+// A cache row as a compute-type pointer: the row itself when the storage
+// is T, else widened into buf.
+template <typename S, typename T>
+const T* cache_row(const S* row, T* buf, int64_t n) {
+  if constexpr (std::is_same_v<S, T>) {
+    (void)buf;
+    (void)n;
+    return row;
+  } else {
+    widen<S>(row, 1, buf, n);
+    return buf;
+  }
+}
+
+// S is the storage type, T the compute type (float for the 16-bit ones).
+template <typename S, typename T>
+void paged_attention_typed(const PagedAttentionShape& a, const S* q, const S* key_cache,
+                           const S* value_cache, const int32_t* block_tables,
+                           const int32_t* context_lens, S* out, int64_t begin, int64_t end) {
+  const int64_t G = a.Hq / a.Hkv, D = a.D, bs = a.block_size;
+  const T neg_inf = -std::numeric_limits<T>::infinity();
+  // Per query head of the group: its scaled query, accumulator, running
+  // max and sum, and the block's scores.
+  std::vector<T> qs(G * D), acc(G * D), s(G * bs), buf(D);
+  std::vector<T> m(G), l(G), alpha(G);
+  for (int64_t task = begin; task < end; task++) {
+    const int64_t b = task / a.Hkv, kvh = task % a.Hkv;
+    const int64_t n = context_lens[b];
+    for (int64_t g = 0; g < G; g++) {
+      const S* qr = q + (b * a.Hq + kvh * G + g) * D;
+      for (int64_t d = 0; d < D; d++) qs[g * D + d] = static_cast<T>(qr[d]) * T(a.scale);
+    }
+    std::fill(acc.begin(), acc.end(), T(0));
+    std::fill(m.begin(), m.end(), neg_inf);
+    std::fill(l.begin(), l.end(), T(0));
+    const int32_t* table = block_tables + b * a.max_blocks;
+    for (int64_t kb = 0; kb < n; kb += bs) {
+      const int64_t nk = std::min(bs, n - kb);
+      const int64_t base = (static_cast<int64_t>(table[kb / bs]) * a.Hkv + kvh) * bs * D;
+      const S* kblock = key_cache + base;
+      const S* vblock = value_cache + base;
+      for (int64_t j = 0; j < nk; j++) {
+        const T* kr = cache_row(kblock + j * D, buf.data(), D);
+        for (int64_t g = 0; g < G; g++) s[g * bs + j] = dot(qs.data() + g * D, kr, D);
+      }
+      // Rescale what the earlier blocks accumulated to the new running max.
+      for (int64_t g = 0; g < G; g++) {
+        T mt = m[g];
+        for (int64_t j = 0; j < nk; j++) mt = std::max(mt, s[g * bs + j]);
+        alpha[g] = std::exp(m[g] - mt);
+        l[g] *= alpha[g];
+        m[g] = mt;
+        T* sg = s.data() + g * bs;
+        for (int64_t j = 0; j < nk; j++) {
+          sg[j] = std::exp(sg[j] - mt);
+          l[g] += sg[j];
+        }
+      }
+      for (int64_t j = 0; j < nk; j++) {
+        const T* vr = cache_row(vblock + j * D, buf.data(), D);
+        for (int64_t g = 0; g < G; g++) {
+          scale_axpy(j == 0 ? alpha[g] : T(1), s[g * bs + j], vr, acc.data() + g * D, D);
+        }
+      }
+    }
+    for (int64_t g = 0; g < G; g++) {
+      const T inv = l[g] > T(0) ? T(1) / l[g] : T(0);
+      S* o = out + (b * a.Hq + kvh * G + g) * D;
+      for (int64_t d = 0; d < D; d++) o[d] = S(acc[g * D + d] * inv);
+    }
+  }
+}
+
+void paged_attention(DType dtype, const PagedAttentionShape& a, const void* q,
+                     const void* key_cache, const void* value_cache, const int32_t* block_tables,
+                     const int32_t* context_lens, void* out, int64_t begin, int64_t end) {
+  auto run = [&](auto storage, auto compute) {
+    using S = decltype(storage);
+    using T = decltype(compute);
+    paged_attention_typed<S, T>(a, static_cast<const S*>(q), static_cast<const S*>(key_cache),
+                                static_cast<const S*>(value_cache), block_tables, context_lens,
+                                static_cast<S*>(out), begin, end);
+  };
+  if (is_reduced_floating(dtype)) {
+    XFT_DISPATCH_HALF_TYPES(dtype, "paged_attention", [&] { run(scalar_t(), float()); });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "paged_attention", [&] { run(scalar_t(), scalar_t()); });
+}
+
+// ---- Quantized linear ----
+//
+// Each call walks its output columns in blocks of kQuantCols: their weight
+// rows are decoded to int8 once (nothing to do for int8 weights) and every
+// row of x is run over the block, so each weight byte leaves memory once
+// per call while x stays in cache.
+
+constexpr int64_t kQuantCols = 4;
+
+// Row n of the weights as int8 values; int4 rows are unpacked into buf.
+const int8_t* weight_row(const QuantizedShape& s, const void* w, int64_t n, int8_t* buf) {
+  if (s.bits == 8) return static_cast<const int8_t*>(w) + n * s.K;
+  using V = vec_t<uint8_t>;
+  constexpr int64_t W = kLanes<uint8_t>;
+  const int64_t half = s.K / 2;
+  const uint8_t* p = static_cast<const uint8_t*>(w) + n * half;
+  auto* out = reinterpret_cast<uint8_t*>(buf);
+  int64_t k = 0;
+  // Wrapping uint8 arithmetic leaves the int8 bit patterns of q.
+  for (; k + W <= half; k += W) {
+    const V v = load<V>(p + k);
+    store(out + k, (v & 15) - 8);
+    store(out + half + k, (v >> 4) - 8);
+  }
+  for (; k < half; k++) {
+    buf[k] = static_cast<int8_t>((p[k] & 15) - 8);
+    buf[half + k] = static_cast<int8_t>((p[k] >> 4) - 8);
+  }
+  return buf;
+}
+
+// kLanes<float> int8 weights as floats. GCC scalarizes int8 -> float
+// vector conversions, so the x86 builds spell out vpmovsxbd + vcvtdq2ps.
+inline vfloat widen_int8(const int8_t* w) {
+#if defined(__AVX512F__)
+  // The zero-masked form: GCC 12 warns about the undefined source register
+  // of the unmasked one.
+  const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w));
+  return __builtin_convertvector(bitcast<vint32>(_mm512_maskz_cvtepi8_epi32(0xffff, b)), vfloat);
+#elif defined(__AVX2__)
+  const __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w));
+  return __builtin_convertvector(bitcast<vint32>(_mm256_cvtepi8_epi32(b)), vfloat);
+#else
+  vfloat v;
+  for (int64_t i = 0; i < kLanes<float>; i++) v[i] = w[i];
+  return v;
+#endif
+}
+
+// sum(x[i] * w[i]), the weights widened to float in registers.
+float dot_widen(const float* x, const int8_t* w, int64_t n) {
+  using V = vfloat;
+  constexpr int64_t W = kLanes<float>;
+  V acc0 = V{}, acc1 = V{};
+  int64_t i = 0;
+  for (; i + 2 * W <= n; i += 2 * W) {
+    acc0 += load<V>(x + i) * widen_int8(w + i);
+    acc1 += load<V>(x + i + W) * widen_int8(w + i + W);
+  }
+  for (; i + W <= n; i += W) acc0 += load<V>(x + i) * widen_int8(w + i);
+  float r = hsum<float>(acc0 + acc1);
+  for (; i < n; i++) r += x[i] * w[i];
+  return r;
+}
+
+// sum(x[i] * w[i]) in int32. x is in [-127, 127], so |x| fits a u8 and its
+// sign can move onto w: that gives the unsigned-by-signed byte products of
+// vpdpbusd (VNNI) and vpmaddubsw (AVX2), and keeps the latter's pair sums
+// below int16 saturation. VNNI builds finish 32-byte tails (a group of 32
+// int4 weights) on the AVX2 loop.
+int32_t dot_int8(const int8_t* x, const int8_t* w, int64_t n) {
+  int64_t i = 0;
+  int32_t r = 0;
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+  const __m512i zero = _mm512_setzero_si512();
+  __m512i acc512 = zero;
+  for (; i + 64 <= n; i += 64) {
+    const __m512i vx = _mm512_loadu_si512(x + i), vw = _mm512_loadu_si512(w + i);
+    const __m512i sw = _mm512_mask_sub_epi8(vw, _mm512_movepi8_mask(vx), zero, vw);
+    acc512 = _mm512_dpbusd_epi32(acc512, _mm512_abs_epi8(vx), sw);
+  }
+  r = hsum<int32_t>(bitcast<vint32>(acc512));
+#endif
+#if defined(__AVX2__)
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 32 <= n; i += 32) {
+    const __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+    const __m256i vw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i));
+    const __m256i p = _mm256_maddubs_epi16(_mm256_abs_epi8(vx), _mm256_sign_epi8(vw, vx));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p, ones));
+  }
+  __m128i h = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  h = _mm_hadd_epi32(h, h);
+  r += _mm_cvtsi128_si32(_mm_hadd_epi32(h, h));
+#endif
+  for (; i < n; i++) r += static_cast<int32_t>(x[i]) * w[i];
+  return r;
+}
+
+// fn(n0, nc, rows) for each block of nc <= kQuantCols columns from n0 in
+// [begin, end), rows[j] holding column n0 + j's weights as int8.
+template <typename F>
+void for_each_weight_block(const QuantizedShape& s, const void* w, int64_t begin, int64_t end,
+                           F&& fn) {
+  std::vector<int8_t> buf(s.bits == 8 ? 0 : kQuantCols * s.K);
+  const int8_t* rows[kQuantCols];
+  for (int64_t n0 = begin; n0 < end; n0 += kQuantCols) {
+    const int64_t nc = std::min(kQuantCols, end - n0);
+    for (int64_t j = 0; j < nc; j++) rows[j] = weight_row(s, w, n0 + j, buf.data() + j * s.K);
+    fn(n0, nc, rows);
+  }
+}
+
+void quantized_linear(const QuantizedShape& s, const float* x, const void* w,
+                      const float* scales, const float* bias, float* y, int64_t begin,
+                      int64_t end) {
+  const int64_t G = s.group_size, groups = s.K / G;
+  for_each_weight_block(s, w, begin, end, [&](int64_t n0, int64_t nc, const int8_t* const* rows) {
+    for (int64_t m = 0; m < s.M; m++) {
+      const float* xm = x + m * s.K;
+      for (int64_t j = 0; j < nc; j++) {
+        const float* sc = scales + (n0 + j) * groups;
+        float acc = bias != nullptr ? bias[n0 + j] : 0.0f;
+        for (int64_t g = 0; g < groups; g++) {
+          acc += sc[g] * dot_widen(xm + g * G, rows[j] + g * G, G);
+        }
+        y[m * s.N + n0 + j] = acc;
+      }
+    }
+  });
+}
+
+void quantized_linear_dynamic(const QuantizedShape& s, const int8_t* x, const float* xscale,
+                              const void* w, const float* scales, const float* bias, float* y,
+                              int64_t begin, int64_t end) {
+  const int64_t G = s.group_size, groups = s.K / G;
+  for_each_weight_block(s, w, begin, end, [&](int64_t n0, int64_t nc, const int8_t* const* rows) {
+    for (int64_t m = 0; m < s.M; m++) {
+      const int8_t* xm = x + m * s.K;
+      for (int64_t j = 0; j < nc; j++) {
+        const float* sc = scales + (n0 + j) * groups;
+        float acc = 0.0f;
+        for (int64_t g = 0; g < groups; g++) {
+          acc += sc[g] * static_cast<float>(dot_int8(xm + g * G, rows[j] + g * G, G));
+        }
+        y[m * s.N + n0 + j] = acc * xscale[m] + (bias != nullptr ? bias[n0 + j] : 0.0f);
+      }
+    }
+  });
+}
+
+// ---- convolution ----
+//
+// Implicit GEMM over channels-last buffers: at filter tap (r, s) the input
+// of an output pixel is one contiguous row of C channels, so each tap is a
+// GEMM whose A rows are read where they lie in x (or from a zero row where
+// the tap lands in the padding) and nothing is unfolded. A panel of up to
+// tiling.panel rows is walked one block of output columns at a time, so
+// the block's slice of the weights stays in L2 across the panel; each
+// register tile of the block accumulates over every tap and channel before
+// it is stored.
+
+// Rows [i0, i0 + kRows) and columns [j, j + kVecs * lanes) of
+//   c_i = init_i + sum over t < taps, p < depth of a(t, i)[p] * b(t)[p * ldb + j],
+// where init_i is c_i itself when accumulating, else bias (zero if null).
+template <int kRows, int kVecs, typename T, typename AFn, typename BFn>
+void conv_block(int64_t taps, int64_t depth, const AFn& a, const BFn& b, int64_t ldb,
+                T* const* c, int64_t i0, int64_t j, const T* bias, bool accumulate) {
+  using V = vec_t<T>;
+  constexpr int64_t W = kLanes<T>;
+  V acc[kRows][kVecs];
+  for (int i = 0; i < kRows; i++) {
+    for (int v = 0; v < kVecs; v++) {
+      acc[i][v] = accumulate         ? load<V>(c[i0 + i] + j + v * W)
+                  : bias != nullptr ? load<V>(bias + j + v * W)
+                                    : V{};
+    }
+  }
+  const T* ar[kRows];
+  for (int64_t t = 0; t < taps; t++) {
+    for (int i = 0; i < kRows; i++) ar[i] = a(t, i0 + i);
+    const T* bt = b(t) + j;
+    for (int64_t p = 0; p < depth; p++) {
+      V bv[kVecs];
+      for (int v = 0; v < kVecs; v++) bv[v] = load<V>(bt + p * ldb + v * W);
+      for (int i = 0; i < kRows; i++) {
+        const V ai = splat<V>(ar[i][p]);
+        for (int v = 0; v < kVecs; v++) acc[i][v] += ai * bv[v];
+      }
+    }
+  }
+  for (int i = 0; i < kRows; i++) {
+    for (int v = 0; v < kVecs; v++) store(c[i0 + i] + j + v * W, acc[i][v]);
+  }
+}
+
+// Rows [i0, rows) of a panel at columns [j, j + kVecs * lanes), kRows at a
+// time and the remainder in one shorter tile.
+template <int kRows, int kVecs, typename T, typename AFn, typename BFn>
+void conv_block_rows(int64_t i0, int64_t rows, int64_t taps, int64_t depth, const AFn& a,
+                     const BFn& b, int64_t ldb, T* const* c, int64_t j, const T* bias,
+                     bool accumulate) {
+  for (; i0 + kRows <= rows; i0 += kRows) {
+    conv_block<kRows, kVecs>(taps, depth, a, b, ldb, c, i0, j, bias, accumulate);
+  }
+  if constexpr (kRows > 1) {
+    if (i0 < rows) {
+      conv_block_rows<kRows - 1, kVecs>(i0, rows, taps, depth, a, b, ldb, c, j, bias,
+                                        accumulate);
+    }
+  }
+}
+
+// Columns from j on in blocks of kVecs vectors, then of halving widths down
+// to one vector; returns where the vector blocks stop.
+template <int kRows, int kVecs, typename T, typename AFn, typename BFn>
+int64_t conv_columns(int64_t j, int64_t rows, int64_t taps, int64_t depth, const AFn& a,
+                     const BFn& b, int64_t ldb, T* const* c, int64_t n, const T* bias,
+                     bool accumulate) {
+  constexpr int64_t W = kLanes<T>;
+  for (; j + kVecs * W <= n; j += kVecs * W) {
+    conv_block_rows<kRows, kVecs>(0, rows, taps, depth, a, b, ldb, c, j, bias, accumulate);
+  }
+  if constexpr (kVecs > 1) {
+    return conv_columns<kRows, kVecs / 2>(j, rows, taps, depth, a, b, ldb, c, n, bias,
+                                          accumulate);
+  }
+  return j;
+}
+
+// conv_block's sum for rows [0, rows) and columns [0, n), in the tiling's
+// register tile (4 x 2 for any tile it does not list).
+template <typename T, typename AFn, typename BFn>
+void conv_panel(const ConvTiling& tiling, int64_t rows, int64_t taps, int64_t depth,
+                const AFn& a, const BFn& b, int64_t ldb, T* const* c, int64_t n, const T* bias,
+                bool accumulate) {
+  int64_t j;
+  if (tiling.tile_rows == 6 && tiling.tile_vecs == 2) {
+    j = conv_columns<6, 2>(0, rows, taps, depth, a, b, ldb, c, n, bias, accumulate);
+  } else if (tiling.tile_rows == 2 && tiling.tile_vecs == 4) {
+    j = conv_columns<2, 4>(0, rows, taps, depth, a, b, ldb, c, n, bias, accumulate);
+  } else {
+    j = conv_columns<4, 2>(0, rows, taps, depth, a, b, ldb, c, n, bias, accumulate);
+  }
+  for (; j < n; j++) {
+    for (int64_t i = 0; i < rows; i++) {
+      T acc = accumulate ? c[i][j] : bias != nullptr ? bias[j] : T(0);
+      for (int64_t t = 0; t < taps; t++) {
+        const T* ai = a(t, i);
+        const T* bt = b(t) + j;
+        for (int64_t p = 0; p < depth; p++) acc += ai[p] * bt[p * ldb];
+      }
+      c[i][j] = acc;
+    }
+  }
+}
+
+// y [N * OH * OW, K] = sum over taps (r, s) of x_rs @ w_rs: row m of x_rs is
+// input pixel (oh * stride - pad + r * dilation, ...) of output pixel m.
+template <typename T>
+void conv2d_typed(const ConvShape& s, const ConvTiling& tiling, const T* x, const T* w,
+                  const T* bias, T* y, int64_t begin, int64_t end) {
+  const int64_t Cg = s.C / s.groups, Kg = s.K / s.groups, taps = s.R * s.S;
+  const int64_t panel = tiling.panel;
+  const std::vector<T> zeros(s.C, T(0));
+  // rows[t * panel + i] is the input row of tap live[t] for pixel i.
+  std::vector<const T*> rows(taps * panel);
+  std::vector<int64_t> live(taps);
+  std::vector<T*> c(panel);
+  for (int64_t m0 = begin; m0 < end; m0 += panel) {
+    const int64_t nr = std::min(panel, end - m0);
+    int64_t nlive = 0;
+    for (int64_t t = 0; t < taps; t++) {
+      bool any = false;
+      for (int64_t i = 0; i < nr; i++) {
+        const int64_t m = m0 + i, ow = m % s.OW, oh = m / s.OW % s.OH, n = m / (s.OW * s.OH);
+        const int64_t ih = oh * s.stride_h - s.pad_h + t / s.S * s.dilation_h;
+        const int64_t iw = ow * s.stride_w - s.pad_w + t % s.S * s.dilation_w;
+        const bool inside = ih >= 0 && ih < s.H && iw >= 0 && iw < s.W;
+        rows[nlive * panel + i] = inside ? x + ((n * s.H + ih) * s.W + iw) * s.C : zeros.data();
+        any = any || inside;
+      }
+      // Taps that fall in the padding for the whole panel are skipped.
+      if (any) live[nlive++] = t;
+    }
+    for (int64_t g = 0; g < s.groups; g++) {
+      for (int64_t i = 0; i < nr; i++) c[i] = y + (m0 + i) * s.K + g * Kg;
+      const auto a = [&](int64_t t, int64_t i) { return rows[t * panel + i] + g * Cg; };
+      const auto b = [&](int64_t t) { return w + live[t] * Cg * s.K + g * Kg; };
+      conv_panel(tiling, nr, nlive, Cg, a, b, s.K, c.data(), Kg,
+                 bias != nullptr ? bias + g * Kg : nullptr, false);
+    }
+  }
+}
+
+// dx [N * H * W, C] = sum over taps (r, s) of dy_rs @ w_rs^T, the same
+// product read the other way: row m of dy_rs is the output pixel that tap
+// (r, s) of input pixel m feeds, if any.
+template <typename T>
+void conv2d_backward_input_typed(const ConvShape& s, const ConvTiling& tiling, const T* dy,
+                                 const T* w, T* dx, int64_t begin, int64_t end) {
+  const int64_t Cg = s.C / s.groups, Kg = s.K / s.groups, taps = s.R * s.S;
+  const int64_t panel = tiling.panel;
+  const std::vector<T> zeros(s.K, T(0));
+  std::vector<const T*> rows(taps * panel);
+  std::vector<int64_t> live(taps);
+  std::vector<T*> c(panel);
+  for (int64_t m0 = begin; m0 < end; m0 += panel) {
+    const int64_t nr = std::min(panel, end - m0);
+    int64_t nlive = 0;
+    for (int64_t t = 0; t < taps; t++) {
+      bool any = false;
+      for (int64_t i = 0; i < nr; i++) {
+        const int64_t m = m0 + i, iw = m % s.W, ih = m / s.W % s.H, n = m / (s.W * s.H);
+        const int64_t hs = ih + s.pad_h - t / s.S * s.dilation_h;
+        const int64_t ws = iw + s.pad_w - t % s.S * s.dilation_w;
+        const int64_t oh = hs / s.stride_h, ow = ws / s.stride_w;
+        const bool inside = hs >= 0 && ws >= 0 && hs % s.stride_h == 0 &&
+                            ws % s.stride_w == 0 && oh < s.OH && ow < s.OW;
+        rows[nlive * panel + i] =
+            inside ? dy + ((n * s.OH + oh) * s.OW + ow) * s.K : zeros.data();
+        any = any || inside;
+      }
+      if (any) live[nlive++] = t;
+    }
+    for (int64_t g = 0; g < s.groups; g++) {
+      for (int64_t i = 0; i < nr; i++) c[i] = dx + (m0 + i) * s.C + g * Cg;
+      const auto a = [&](int64_t t, int64_t i) { return rows[t * panel + i] + g * Kg; };
+      const auto b = [&](int64_t t) { return w + live[t] * s.K * Cg + g * Kg * Cg; };
+      conv_panel(tiling, nr, nlive, Kg, a, b, Cg, c.data(), Cg,
+                 static_cast<const T*>(nullptr), false);
+    }
+  }
+}
+
+// dw_rs [Cg, Kg] = x_rs^T @ dy per group, reduced over the pixels in passes
+// of tiling.pixels: each pixel is one step of depth 1, and pixels whose tap
+// lands in the padding are left out.
+template <typename T>
+void conv2d_backward_weight_typed(const ConvShape& s, const ConvTiling& tiling, const T* x,
+                                  const T* dy, T* dw, int64_t begin, int64_t end) {
+  const int64_t Cg = s.C / s.groups, Kg = s.K / s.groups;
+  const int64_t M = s.N * s.OH * s.OW;
+  if (M == 0) {
+    std::fill(dw + begin * s.K, dw + end * s.K, T(0));
+    return;
+  }
+  std::vector<const T*> xrows(tiling.pixels), dyrows(tiling.pixels);
+  std::vector<T*> c(Cg);
+  for (int64_t m0 = 0; m0 < M; m0 += tiling.pixels) {
+    const int64_t nm = std::min(tiling.pixels, M - m0);
+    // Rows of one tap at a time.
+    for (int64_t row0 = begin; row0 < end;) {
+      const int64_t t = row0 / Cg, ci0 = row0 % Cg;
+      const int64_t nr = std::min(end - row0, Cg - ci0);
+      int64_t np = 0;
+      for (int64_t i = 0; i < nm; i++) {
+        const int64_t m = m0 + i, ow = m % s.OW, oh = m / s.OW % s.OH, n = m / (s.OW * s.OH);
+        const int64_t ih = oh * s.stride_h - s.pad_h + t / s.S * s.dilation_h;
+        const int64_t iw = ow * s.stride_w - s.pad_w + t % s.S * s.dilation_w;
+        if (ih < 0 || ih >= s.H || iw < 0 || iw >= s.W) continue;
+        xrows[np] = x + ((n * s.H + ih) * s.W + iw) * s.C;
+        dyrows[np++] = dy + m * s.K;
+      }
+      for (int64_t g = 0; g < s.groups; g++) {
+        for (int64_t i = 0; i < nr; i++) c[i] = dw + (row0 + i) * s.K + g * Kg;
+        const auto a = [&](int64_t p, int64_t i) { return xrows[p] + g * Cg + ci0 + i; };
+        const auto b = [&](int64_t p) { return dyrows[p] + g * Kg; };
+        conv_panel(tiling, nr, np, 1, a, b, 0, c.data(), Kg, static_cast<const T*>(nullptr),
+                   m0 > 0);
+      }
+      row0 += nr;
+    }
+  }
+}
+
+void conv2d(DType dtype, const ConvShape& s, const ConvTiling& tiling, const void* x,
+            const void* w, const void* bias, void* y, int64_t begin, int64_t end) {
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "conv2d", [&] {
+    conv2d_typed(s, tiling, static_cast<const scalar_t*>(x), static_cast<const scalar_t*>(w),
+                 static_cast<const scalar_t*>(bias), static_cast<scalar_t*>(y), begin, end);
+  });
+}
+
+void conv2d_backward_input(DType dtype, const ConvShape& s, const ConvTiling& tiling,
+                           const void* dy, const void* w, void* dx, int64_t begin, int64_t end) {
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "conv2d_backward", [&] {
+    conv2d_backward_input_typed(s, tiling, static_cast<const scalar_t*>(dy),
+                                static_cast<const scalar_t*>(w), static_cast<scalar_t*>(dx),
+                                begin, end);
+  });
+}
+
+void conv2d_backward_weight(DType dtype, const ConvShape& s, const ConvTiling& tiling,
+                            const void* x, const void* dy, void* dw, int64_t begin,
+                            int64_t end) {
+  XFT_DISPATCH_FLOATING_TYPES(dtype, "conv2d_backward", [&] {
+    conv2d_backward_weight_typed(s, tiling, static_cast<const scalar_t*>(x),
+                                 static_cast<const scalar_t*>(dy), static_cast<scalar_t*>(dw),
+                                 begin, end);
+  });
+}
+
+}  // namespace
+
+const CpuKernels& kernels() {
+  static const CpuKernels table{elementwise_loops(),
+                                register_elementwise,
+                                reduce,
+                                softmax,
+                                softmax_backward,
+                                layer_norm,
+                                layer_norm_backward,
+                                bias_gelu,
+                                bias_gelu_backward,
+                                dropout_add,
+                                attention,
+                                attention_backward_dq,
+                                attention_backward_dkv,
+                                paged_attention,
+                                quantized_linear,
+                                quantized_linear_dynamic,
+                                conv2d,
+                                conv2d_backward_input,
+                                conv2d_backward_weight};
+  return table;
+}
+
+}  // namespace xft::cpu::XFT_CPU_CAPABILITY
@@ -0,0 +1,269 @@
+#pragma once
+
+// SIMD building blocks for the CPU kernels, written with GCC/Clang vector
+// extensions so the same source lowers to SSE2/NEON, AVX2 or AVX-512
+// depending on the flags of the translation unit that includes it.
+//
+// Only kernels_impl.h includes this, once per ISA, with XFT_CPU_CAPABILITY
+// naming the namespace and XFT_CPU_VEC_BYTES the register width. Everything
+// here is inline; the per-ISA namespace keeps the differently compiled copies
+// from being merged by the linker.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if !defined(XFT_CPU_CAPABILITY) || !defined(XFT_CPU_VEC_BYTES)
+#error "vec.h is included through a per-ISA cpu/kernels_*.cpp"
+#endif
+
+namespace xft::cpu::XFT_CPU_CAPABILITY {
+
+template <typename T>
+struct VecType {
+  static constexpr bool kValid = false;
+};
+
+#define XFT_VEC_TYPE(T)                                                   \
+  template <>                                                             \
+  struct VecType<T> {                                                     \
+    typedef T type __attribute__((vector_size(XFT_CPU_VEC_BYTES)));       \
+    static constexpr bool kValid = true;                                  \
+  };
+
+XFT_VEC_TYPE(float)
+XFT_VEC_TYPE(double)
+XFT_VEC_TYPE(int32_t)
+XFT_VEC_TYPE(int64_t)
+XFT_VEC_TYPE(uint8_t)
+
+#undef XFT_VEC_TYPE
+
+template <typename T>
+using vec_t = typename VecType<T>::type;
+template <typename T>
+constexpr int64_t kLanes = XFT_CPU_VEC_BYTES / sizeof(T);
+
+using vfloat = vec_t<float>;
+using vdouble = vec_t<double>;
+using vint32 = vec_t<int32_t>;
+
+template <typename V>
+inline V load(const void* p) {
+  V v;
+  std::memcpy(&v, p, sizeof(V));
+  return v;
+}
+
+template <typename V>
+inline void store(void* p, V v) {
+  std::memcpy(p, &v, sizeof(V));
+}
+
+template <typename V, typename T>
+inline V splat(T x) {
+  return V{} + x;
+}
+
+template <typename To, typename From>
+inline To bitcast(From v) {
+  static_assert(sizeof(To) == sizeof(From));
+  To out;
+  std::memcpy(&out, &v, sizeof(To));
+  return out;
+}
+
+// Applies a scalar function lane by lane, for math the vector code below
+// does not approximate (fp64 transcendentals).
+template <typename V, typename F>
+inline V lanewise(V v, F f) {
+  constexpr int64_t n = sizeof(V) / sizeof(v[0]);
+  for (int64_t i = 0; i < n; i++) v[i] = f(v[i]);
+  return v;
+}
+
+// Works for both scalars and vectors. NaN wins, as in a scalar reduction.
+template <typename X>
+inline X max_op(X a, X b) {
+  if constexpr (std::is_arithmetic_v<X>) {
+    return (a > b || a != a) ? a : b;
+  } else {
+    return ((a > b) | (a != a)) ? a : b;
+  }
+}
+
+template <typename X>
+inline X min_op(X a, X b) {
+  if constexpr (std::is_arithmetic_v<X>) {
+    return (a < b || a != a) ? a : b;
+  } else {
+    return ((a < b) | (a != a)) ? a : b;
+  }
+}
+
+// 1 where the comparison holds, else 0; for both scalars and vectors.
+template <typename X>
+inline X ge_mask(X a, X b) {
+  if constexpr (std::is_arithmetic_v<X>) {
+    return a >= b ? X(1) : X(0);
+  } else {
+    return (a >= b) ? X{} + 1 : X{};
+  }
+}
+
+template <typename X>
+inline X eq_mask(X a, X b) {
+  if constexpr (std::is_arithmetic_v<X>) {
+    return a == b ? X(1) : X(0);
+  } else {
+    return (a == b) ? X{} + 1 : X{};
+  }
+}
+
+template <typename T, typename V>
+inline T hsum(V v) {
+  T acc = 0;
+  for (int64_t i = 0; i < kLanes<T>; i++) acc += v[i];
+  return acc;
+}
+
+template <typename T, typename V>
+inline T hmax(V v) {
+  T acc = v[0];
+  for (int64_t i = 1; i < kLanes<T>; i++) acc = max_op(acc, static_cast<T>(v[i]));
+  return acc;
+}
+
+// ---- fp32 transcendentals (Cephes polynomials, ~1-2 ulp) ----
+
+inline vfloat floor(vfloat x) {
+  const vfloat t = __builtin_convertvector(__builtin_convertvector(x, vint32), vfloat);
+  return t > x ? t - 1.f : t;
+}
+
+inline vfloat exp(vfloat x) {
+  const vfloat input = x;
+  x = x > 88.3762626647949f ? splat<vfloat>(88.3762626647949f) : x;
+  x = x < -87.3365447505531f ? splat<vfloat>(-87.3365447505531f) : x;
+
+  const vfloat fx = floor(x * 1.44269504088896341f + 0.5f);
+  x -= fx * 0.693359375f;
+  x -= fx * -2.12194440e-4f;
+  const vfloat z = x * x;
+  vfloat y = splat<vfloat>(1.9875691500e-4f);
+  y = y * x + 1.3981999507e-3f;
+  y = y * x + 8.3334519073e-3f;
+  y = y * x + 4.1665795894e-2f;
+  y = y * x + 1.6666665459e-1f;
+  y = y * x + 5.0000001201e-1f;
+  y = y * z + x + 1.f;
+
+  const vint32 n = __builtin_convertvector(fx, vint32);
+  y *= bitcast<vfloat>((n + 127) << 23);
+
+  y = input > 88.72283905206835f ? splat<vfloat>(INFINITY) : y;
+  // Results that would be subnormal flush to zero.
+  y = input < -87.3365447505531f ? splat<vfloat>(0.f) : y;
+  return input != input ? input : y;
+}
+
+inline vfloat log(vfloat x) {
+  const vfloat input = x;
+  // Scale subnormals into the normal range first.
+  const vint32 denormal = x < 1.17549435e-38f;
+  x = denormal ? x * 8388608.f : x;
+  vint32 bits = bitcast<vint32>(x);
+  vfloat e = __builtin_convertvector(((bits >> 23) & 0xff) - 126, vfloat);
+  e = denormal ? e - 23.f : e;
+  bits = (bits & 0x007fffff) | 0x3f000000;
+  x = bitcast<vfloat>(bits);  // mantissa in [0.5, 1)
+
+  const vint32 small = x < 0.707106781186547524f;
+  e = small ? e - 1.f : e;
+  x = small ? x + x - 1.f : x - 1.f;
+
+  const vfloat z = x * x;
+  vfloat y = splat<vfloat>(7.0376836292e-2f);
+  y = y * x - 1.1514610310e-1f;
+  y = y * x + 1.1676998740e-1f;
+  y = y * x - 1.2420140846e-1f;
+  y = y * x + 1.4249322787e-1f;
+  y = y * x - 1.6668057665e-1f;
+  y = y * x + 2.0000714765e-1f;
+  y = y * x - 2.4999993993e-1f;
+  y = y * x + 3.3333331174e-1f;
+  y = y * x * z;
+  y += e * -2.12194440e-4f;
+  y -= z * 0.5f;
+  vfloat r = x + y + e * 0.693359375f;
+
+  r = input == INFINITY ? input : r;
+  r = input == 0.f ? splat<vfloat>(-INFINITY) : r;
+  r = input < 0.f ? splat<vfloat>(NAN) : r;
+  return input != input ? input : r;
+}
+
+inline vfloat tanh(vfloat x) {
+  // Small |x|: odd polynomial; elsewhere 1 - 2 / (exp(2|x|) + 1) with the
+  // sign restored. exp saturates to inf, which gives exactly +-1.
+  const vfloat z = x * x;
+  vfloat p = splat<vfloat>(-5.70498872745e-3f);
+  p = p * z + 2.06390887954e-2f;
+  p = p * z - 5.37397155531e-2f;
+  p = p * z + 1.33314422036e-1f;
+  p = p * z - 3.33332819422e-1f;
+  const vfloat small = p * z * x + x;
+
+  const vfloat ax = x < 0.f ? -x : x;
+  vfloat big = 1.f - 2.f / (exp(ax + ax) + 1.f);
+  big = x < 0.f ? -big : big;
+  return ax < 0.625f ? small : big;
+}
+
+inline vfloat sigmoid(vfloat x) { return 1.f / (1.f + exp(-x)); }
+
+inline vdouble exp(vdouble x) { return lanewise(x, [](double v) { return std::exp(v); }); }
+inline vdouble log(vdouble x) { return lanewise(x, [](double v) { return std::log(v); }); }
+inline vdouble tanh(vdouble x) { return lanewise(x, [](double v) { return std::tanh(v); }); }
+inline vdouble sigmoid(vdouble x) {
+  return lanewise(x, [](double v) { return 1.0 / (1.0 + std::exp(-v)); });
+}
+
+template <typename V>
+inline V sqrt(V x) {
+  return lanewise(x, [](auto v) { return std::sqrt(v); });
+}
+
+template <typename V>
+inline V relu(V x) {
+  return x > 0 ? x : V{};
+}
+
+// tanh approximation: 0.5 x (1 + tanh(sqrt(2 / pi) (x + 0.044715 x^3))).
+template <typename V>
+inline V gelu(V x) {
+  return 0.5f * x * (1.f + tanh(0.7978845608028654f * (x + 0.044715f * x * x * x)));
+}
+
+inline vdouble gelu(vdouble x) {
+  return 0.5 * x * (1.0 + tanh(0.7978845608028654 * (x + 0.044715 * x * x * x)));
+}
+
+// Derivative of gelu() above.
+template <typename V>
+inline V gelu_grad(V x) {
+  const V x2 = x * x;
+  const V t = tanh(0.7978845608028654f * (x + 0.044715f * x2 * x));
+  const V du = 0.7978845608028654f * (1.f + 0.134145f * x2);
+  return 0.5f * (1.f + t) + 0.5f * x * (1.f - t * t) * du;
+}
+
+inline vdouble gelu_grad(vdouble x) {
+  const vdouble x2 = x * x;
+  const vdouble t = tanh(0.7978845608028654 * (x + 0.044715 * x2 * x));
+  const vdouble du = 0.7978845608028654 * (1.0 + 0.134145 * x2);
+  return 0.5 * (1.0 + t) + 0.5 * x * (1.0 - t * t) * du;
+}
+
+}  // namespace xft::cpu::XFT_CPU_CAPABILITY
@@ -0,0 +1,39 @@
+#include "cuda/amp.h"
+
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+template <typename T, typename A = opmath_t<T>>
+__global__ void unscale_kernel(T* data, int64_t n, A inv_scale, int32_t* found_inf) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    const A v = to_op(data[i]) * inv_scale;
+    // Every writer stores the same value, so the race is harmless.
+    if (!isfinite(v)) *found_inf = 1;
+    data[i] = from_op<T>(v);
+  }
+}
+
+}  // namespace
+
+void unscale_(Tensor& t, double inv_scale, Tensor& found_inf) {
+  const int64_t n = t.numel();
+  if (n == 0) return;
+  DeviceGuard guard(t.device().index);
+  cudaStream_t stream = current_stream(t.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(t.dtype(), "unscale_", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    unscale_kernel<T><<<grid_size(n), kNumThreads, 0, stream>>>(
+        device_ptr<scalar_t>(t), n, static_cast<A>(inv_scale),
+        static_cast<int32_t*>(found_inf.data_ptr()));
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
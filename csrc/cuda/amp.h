@@ -0,0 +1,12 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+// t *= inv_scale on the current stream of t's device, setting found_inf (an
+// int32 [1] tensor on the same device) to 1 if any result is not finite. The
+// flag is never cleared here, so one flag can collect several tensors.
+void unscale_(Tensor& t, double inv_scale, Tensor& found_inf);
+
+}  // namespace xft::cuda
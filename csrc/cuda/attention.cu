@@ -0,0 +1,355 @@
+#include "cuda/attention.h"
+
+#include <type_traits>
+
+#include "cuda/dtype_utils.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// Every kernel pairs a warp's lanes with the kTile rows of the other side
+// (keys in the forward and dq passes, queries in the dk/dv pass), staged
+// in shared memory; each warp owns a few rows of its own side and keeps
+// their accumulators in registers, kHD / kWarpSize columns per lane. kHD is
+// the head-dim bucket (32, 64 or 128) >= D and Dv.
+constexpr int kTile = kWarpSize;
+constexpr int kWarps = 4;
+constexpr int kFwdRows = 16;  // query rows per block in the forward pass
+constexpr int kBwdRows = 8;   // rows per block in the backward passes
+
+// q, k, v, o, dout and the gradients are in the storage type T; lse, delta,
+// the shared tiles and every accumulator are in A = opmath_t<T>.
+template <typename T, typename A = opmath_t<T>>
+struct Args {
+  const T *q, *k, *v, *o, *dout;
+  const A *lse, *delta;
+  T *out, *dq, *dk, *dv;
+  A *out_lse, *delta_out;
+  int64_t L, S, D, Dv;
+  A scale;
+  bool causal;
+};
+
+// Copies rows [row0, row0 + rows) x [0, cols) of a dense [n, cols] head into
+// a [rows][ld] shared tile of its opmath type, zero-filling rows past n.
+template <typename T>
+__device__ void stage(opmath_t<T>* tile, int ld, const T* src, int64_t row0, int rows, int64_t n,
+                      int64_t cols) {
+  for (int idx = threadIdx.x; idx < rows * cols; idx += blockDim.x) {
+    const int r = idx / static_cast<int>(cols), c = idx % static_cast<int>(cols);
+    tile[r * ld + c] = row0 + r < n ? to_op(src[(row0 + r) * cols + c]) : opmath_t<T>(0);
+  }
+}
+
+template <typename T>
+__device__ inline T dot_shared(const T* a, const T* b, int64_t n) {
+  T s = T(0);
+  for (int64_t d = 0; d < n; d++) s += a[d] * b[d];
+  return s;
+}
+
+template <typename T, int kHD>
+__global__ void __launch_bounds__(kWarps* kWarpSize)
+    attention_fwd_kernel(Args<T> a, int64_t tiles) {
+  using A = opmath_t<T>;
+  constexpr int kRows = kFwdRows / kWarps, kCols = kHD / kWarpSize;
+  __shared__ A qs[kFwdRows][kHD];
+  __shared__ A ks[kTile][kHD + 1];  // read one row per lane: padded
+  __shared__ A vs[kTile][kHD];
+  const int64_t head = blockIdx.x / tiles;
+  const int64_t q0 = (blockIdx.x % tiles) * kFwdRows;
+  const int lane = threadIdx.x % kWarpSize, warp = threadIdx.x / kWarpSize;
+  const T* q = a.q + head * a.L * a.D;
+  const T* k = a.k + head * a.S * a.D;
+  const T* v = a.v + head * a.S * a.Dv;
+  stage(&qs[0][0], kHD, q, q0, kFwdRows, a.L, a.D);
+
+  A acc[kRows][kCols] = {};
+  A m[kRows], l[kRows];
+  for (int r = 0; r < kRows; r++) {
+    m[r] = -INFINITY;
+    l[r] = A(0);
+  }
+  const int64_t q_end = q0 + kFwdRows < a.L ? q0 + kFwdRows : a.L;
+  const int64_t k_end = a.causal && q_end < a.S ? q_end : a.S;
+  for (int64_t k0 = 0; k0 < k_end; k0 += kTile) {
+    __syncthreads();
+    stage(&ks[0][0], kHD + 1, k, k0, kTile, a.S, a.D);
+    stage(&vs[0][0], kHD, v, k0, kTile, a.S, a.Dv);
+    __syncthreads();
+#pragma unroll
+    for (int r = 0; r < kRows; r++) {
+      const int row = warp * kRows + r;
+      const int64_t i = q0 + row;
+      const int64_t j = k0 + lane;
+      const bool valid = i < a.L && j < a.S && (!a.causal || j <= i);
+      const A s = valid ? dot_shared(&qs[row][0], &ks[lane][0], a.D) * a.scale : -INFINITY;
+      const A mnew = fmax(m[r], warp_max(s));
+      if (mnew == -INFINITY) continue;  // nothing visible yet (warp-uniform)
+      const A p = valid ? exp_(s - mnew) : A(0);
+      const A alpha = exp_(m[r] - mnew);
+      l[r] = l[r] * alpha + warp_sum(p);
+      m[r] = mnew;
+#pragma unroll
+      for (int c = 0; c < kCols; c++) acc[r][c] *= alpha;
+      for (int jj = 0; jj < kTile; jj++) {
+        const A pj = __shfl_sync(0xffffffff, p, jj);
+#pragma unroll
+        for (int c = 0; c < kCols; c++) acc[r][c] += pj * vs[jj][lane + c * kWarpSize];
+      }
+    }
+  }
+#pragma unroll
+  for (int r = 0; r < kRows; r++) {
+    const int64_t i = q0 + warp * kRows + r;
+    if (i >= a.L) continue;
+    const A inv = l[r] > A(0) ? A(1) / l[r] : A(0);
+    T* o = a.out + (head * a.L + i) * a.Dv;
+#pragma unroll
+    for (int c = 0; c < kCols; c++) {
+      const int64_t col = lane + c * kWarpSize;
+      if (col < a.Dv) o[col] = from_op<T>(acc[r][c] * inv);
+    }
+    if (lane == 0) a.out_lse[head * a.L + i] = l[r] > A(0) ? m[r] + log(l[r]) : A(-INFINITY);
+  }
+}
+
+// delta = rowsum(dout * o), one warp per row.
+template <typename T>
+__global__ void attention_delta_kernel(Args<T> a, int64_t rows) {
+  using A = opmath_t<T>;
+  const int lane = threadIdx.x % kWarpSize;
+  const int64_t row = blockIdx.x * static_cast<int64_t>(kWarps) + threadIdx.x / kWarpSize;
+  if (row >= rows) return;
+  A s = A(0);
+  const T* g = a.dout + row * a.Dv;
+  const T* o = a.o + row * a.Dv;
+  for (int64_t c = lane; c < a.Dv; c += kWarpSize) s += to_op(g[c]) * to_op(o[c]);
+  s = warp_sum(s);
+  if (lane == 0) a.delta_out[row] = s;
+}
+
+// dq_i = scale * sum_j p_ij (dp_ij - delta_i) k_j, lanes over the keys.
+template <typename T, int kHD>
+__global__ void __launch_bounds__(kWarps* kWarpSize)
+    attention_dq_kernel(Args<T> a, int64_t tiles) {
+  using A = opmath_t<T>;
+  constexpr int kRows = kBwdRows / kWarps, kCols = kHD / kWarpSize;
+  __shared__ A qs[kBwdRows][kHD];
+  __shared__ A gs[kBwdRows][kHD];
+  __shared__ A ks[kTile][kHD + 1];
+  __shared__ A vs[kTile][kHD + 1];
+  const int64_t head = blockIdx.x / tiles;
+  const int64_t q0 = (blockIdx.x % tiles) * kBwdRows;
+  const int lane = threadIdx.x % kWarpSize, warp = threadIdx.x / kWarpSize;
+  const T* k = a.k + head * a.S * a.D;
+  const T* v = a.v + head * a.S * a.Dv;
+  stage(&qs[0][0], kHD, a.q + head * a.L * a.D, q0, kBwdRows, a.L, a.D);
+  stage(&gs[0][0], kHD, a.dout + head * a.L * a.Dv, q0, kBwdRows, a.L, a.Dv);
+
+  A lse[kRows], delta[kRows], acc[kRows][kCols] = {};
+#pragma unroll
+  for (int r = 0; r < kRows; r++) {
+    const int64_t i = q0 + warp * kRows + r;
+    lse[r] = i < a.L ? a.lse[head * a.L + i] : A(0);
+    delta[r] = i < a.L ? a.delta[head * a.L + i] : A(0);
+  }
+  const int64_t q_end = q0 + kBwdRows < a.L ? q0 + kBwdRows : a.L;
+  const int64_t k_end = a.causal && q_end < a.S ? q_end : a.S;
+  for (int64_t k0 = 0; k0 < k_end; k0 += kTile) {
+    __syncthreads();
+    stage(&ks[0][0], kHD + 1, k, k0, kTile, a.S, a.D);
+    stage(&vs[0][0], kHD + 1, v, k0, kTile, a.S, a.Dv);
+    __syncthreads();
+#pragma unroll
+    for (int r = 0; r < kRows; r++) {
+      const int row = warp * kRows + r;
+      const int64_t i = q0 + row, j = k0 + lane;
+      const bool valid = i < a.L && j < a.S && (!a.causal || j <= i);
+      A ds = A(0);
+      if (valid) {
+        const A p = exp_(dot_shared(&qs[row][0], &ks[lane][0], a.D) * a.scale - lse[r]);
+        const A dp = dot_shared(&gs[row][0], &vs[lane][0], a.Dv);
+        ds = p * (dp - delta[r]) * a.scale;
+      }
+      for (int jj = 0; jj < kTile; jj++) {
+        const A dsj = __shfl_sync(0xffffffff, ds, jj);
+#pragma unroll
+        for (int c = 0; c < kCols; c++) acc[r][c] += dsj * ks[jj][lane + c * kWarpSize];
+      }
+    }
+  }
+#pragma unroll
+  for (int r = 0; r < kRows; r++) {
+    const int64_t i = q0 + warp * kRows + r;
+    if (i >= a.L) continue;
+#pragma unroll
+    for (int c = 0; c < kCols; c++) {
+      const int64_t col = lane + c * kWarpSize;
+      if (col < a.D) a.dq[(head * a.L + i) * a.D + col] = from_op<T>(acc[r][c]);
+    }
+  }
+}
+
+// dv_j = sum_i p_ij dout_i and dk_j = scale * sum_i p_ij (dp_ij - delta_i)
+// q_i, lanes over the queries.
+template <typename T, int kHD>
+__global__ void __launch_bounds__(kWarps* kWarpSize)
+    attention_dkv_kernel(Args<T> a, int64_t tiles) {
+  using A = opmath_t<T>;
+  constexpr int kRows = kBwdRows / kWarps, kCols = kHD / kWarpSize;
+  __shared__ A ks[kBwdRows][kHD];
+  __shared__ A vs[kBwdRows][kHD];
+  __shared__ A qs[kTile][kHD + 1];
+  __shared__ A gs[kTile][kHD + 1];
+  __shared__ A lse_s[kTile], delta_s[kTile];
+  const int64_t head = blockIdx.x / tiles;
+  const int64_t k0 = (blockIdx.x % tiles) * kBwdRows;
+  const int lane = threadIdx.x % kWarpSize, warp = threadIdx.x / kWarpSize;
+  const T* q = a.q + head * a.L * a.D;
+  const T* g = a.dout + head * a.L * a.Dv;
+  stage(&ks[0][0], kHD, a.k + head * a.S * a.D, k0, kBwdRows, a.S, a.D);
+  stage(&vs[0][0], kHD, a.v + head * a.S * a.Dv, k0, kBwdRows, a.S, a.Dv);
+
+  A dk[kRows][kCols] = {}, dv[kRows][kCols] = {};
+  // Under the causal mask queries before k0 see none of these keys.
+  for (int64_t q0 = a.causal ? k0 : 0; q0 < a.L; q0 += kTile) {
+    __syncthreads();
+    stage(&qs[0][0], kHD + 1, q, q0, kTile, a.L, a.D);
+    stage(&gs[0][0], kHD + 1, g, q0, kTile, a.L, a.Dv);
+    if (threadIdx.x < kTile) {
+      const int64_t i = q0 + threadIdx.x;
+      lse_s[threadIdx.x] = i < a.L ? a.lse[head * a.L + i] : A(0);
+      delta_s[threadIdx.x] = i < a.L ? a.delta[head * a.L + i] : A(0);
+    }
+    __syncthreads();
+#pragma unroll
+    for (int r = 0; r < kRows; r++) {
+      const int row = warp * kRows + r;
+      const int64_t j = k0 + row, i = q0 + lane;
+      const bool valid = j < a.S && i < a.L && (!a.causal || j <= i);
+      A p = A(0), ds = A(0);
+      if (valid) {
+        p = exp_(dot_shared(&qs[lane][0], &ks[row][0], a.D) * a.scale - lse_s[lane]);
+        const A dp = dot_shared(&gs[lane][0], &vs[row][0], a.Dv);
+        ds = p * (dp - delta_s[lane]) * a.scale;
+      }
+      for (int ii = 0; ii < kTile; ii++) {
+        const A pi = __shfl_sync(0xffffffff, p, ii);
+        const A dsi = __shfl_sync(0xffffffff, ds, ii);
+#pragma unroll
+        for (int c = 0; c < kCols; c++) {
+          dv[r][c] += pi * gs[ii][lane + c * kWarpSize];
+          dk[r][c] += dsi * qs[ii][lane + c * kWarpSize];
+        }
+      }
+    }
+  }
+#pragma unroll
+  for (int r = 0; r < kRows; r++) {
+    const int64_t j = k0 + warp * kRows + r;
+    if (j >= a.S) continue;
+#pragma unroll
+    for (int c = 0; c < kCols; c++) {
+      const int64_t col = lane + c * kWarpSize;
+      if (col < a.D) a.dk[(head * a.S + j) * a.D + col] = from_op<T>(dk[r][c]);
+      if (col < a.Dv) a.dv[(head * a.S + j) * a.Dv + col] = from_op<T>(dv[r][c]);
+    }
+  }
+}
+
+// Calls f(std::integral_constant<int, kHD>) with the smallest bucket that
+// holds both head dims.
+template <typename T, typename F>
+void dispatch_head_dim(int64_t D, int64_t Dv, F&& f) {
+  const int64_t hd = D > Dv ? D : Dv;
+  constexpr int kMax = sizeof(opmath_t<T>) > 4 ? 64 : 128;
+  XFT_CHECK(hd <= kMax, "scaled_dot_product_attention: CUDA supports head dims up to ", kMax,
+            " for this dtype, got ", hd);
+  if (hd <= 32) {
+    f(std::integral_constant<int, 32>());
+  } else if (hd <= 64) {
+    f(std::integral_constant<int, 64>());
+  } else {
+    if constexpr (kMax >= 128) f(std::integral_constant<int, 128>());
+  }
+}
+
+template <typename T>
+const T* cptr(const Tensor& t) {
+  return static_cast<const T*>(t.data_ptr());
+}
+
+template <typename T>
+T* mptr(Tensor& t) {
+  return static_cast<T*>(t.data_ptr());
+}
+
+}  // namespace
+
+void attention(const Tensor& q, const Tensor& k, const Tensor& v, Tensor& o, Tensor& lse,
+               int64_t heads, int64_t L, int64_t S, int64_t D, int64_t Dv, double scale,
+               bool causal) {
+  if (heads * L == 0) return;
+  DeviceGuard guard(q.device().index);
+  cudaStream_t stream = current_stream(q.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(q.dtype(), "scaled_dot_product_attention", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    Args<T> a{};
+    a.q = cptr<T>(q), a.k = cptr<T>(k), a.v = cptr<T>(v);
+    a.out = mptr<T>(o), a.out_lse = mptr<A>(lse);
+    a.L = L, a.S = S, a.D = D, a.Dv = Dv;
+    a.scale = static_cast<A>(scale), a.causal = causal;
+    const int64_t tiles = ceil_div(L, kFwdRows);
+    const auto blocks = static_cast<unsigned int>(heads * tiles);
+    dispatch_head_dim<T>(D, Dv, [&](auto hd) {
+      constexpr int kHD = decltype(hd)::value;
+      attention_fwd_kernel<T, kHD><<<blocks, kWarps * kWarpSize, 0, stream>>>(a, tiles);
+    });
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void attention_backward(const Tensor& dout, const Tensor& q, const Tensor& k, const Tensor& v,
+                        const Tensor& o, const Tensor& lse, Tensor& delta, Tensor& dq, Tensor& dk,
+                        Tensor& dv, int64_t heads, int64_t L, int64_t S, int64_t D, int64_t Dv,
+                        double scale, bool causal) {
+  if (heads == 0) return;
+  DeviceGuard guard(q.device().index);
+  cudaStream_t stream = current_stream(q.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(q.dtype(), "scaled_dot_product_attention_backward", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    Args<T> a{};
+    a.q = cptr<T>(q), a.k = cptr<T>(k), a.v = cptr<T>(v);
+    a.o = cptr<T>(o), a.dout = cptr<T>(dout), a.lse = cptr<A>(lse);
+    a.delta = cptr<A>(delta), a.delta_out = mptr<A>(delta);
+    a.dq = mptr<T>(dq), a.dk = mptr<T>(dk), a.dv = mptr<T>(dv);
+    a.L = L, a.S = S, a.D = D, a.Dv = Dv;
+    a.scale = static_cast<A>(scale), a.causal = causal;
+    dispatch_head_dim<T>(D, Dv, [&](auto hd) {
+      constexpr int kHD = decltype(hd)::value;
+      constexpr int kThreads = kWarps * kWarpSize;
+      // The dq and dk/dv passes both read delta, so it is computed first.
+      if (L > 0) {
+        const auto rows = static_cast<unsigned int>(ceil_div(heads * L, kWarps));
+        attention_delta_kernel<T><<<rows, kThreads, 0, stream>>>(a, heads * L);
+        const int64_t tiles = ceil_div(L, kBwdRows);
+        const auto blocks = static_cast<unsigned int>(heads * tiles);
+        attention_dq_kernel<T, kHD><<<blocks, kThreads, 0, stream>>>(a, tiles);
+      }
+      if (S > 0) {
+        const int64_t tiles = ceil_div(S, kBwdRows);
+        const auto blocks = static_cast<unsigned int>(heads * tiles);
+        attention_dkv_kernel<T, kHD><<<blocks, kThreads, 0, stream>>>(a, tiles);
+      }
+    });
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+// Flash-style attention over `heads` dense heads: q [L, D], k [S, D],
+// v [S, Dv] and o [L, Dv] each, with lse [L] the logsumexp of every row's
+// scaled scores. Runs on the current stream of q's device; D and Dv are at
+// most 128 (64 for float64). The 16-bit dtypes compute in float32 and keep
+// lse and delta in float32 tensors.
+void attention(const Tensor& q, const Tensor& k, const Tensor& v, Tensor& o, Tensor& lse,
+               int64_t heads, int64_t L, int64_t S, int64_t D, int64_t Dv, double scale,
+               bool causal);
+// Writes delta (rowsum(dout * o), [heads, L]) and then dq, dk and dv,
+// recomputing the probabilities from lse.
+void attention_backward(const Tensor& dout, const Tensor& q, const Tensor& k, const Tensor& v,
+                        const Tensor& o, const Tensor& lse, Tensor& delta, Tensor& dq, Tensor& dk,
+                        Tensor& dv, int64_t heads, int64_t L, int64_t S, int64_t D, int64_t Dv,
+                        double scale, bool causal);
+
+}  // namespace xft::cuda
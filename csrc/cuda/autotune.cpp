@@ -0,0 +1,51 @@
+#include "cuda/autotune.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "cuda/cuda_utils.h"
+#include "cuda/gemm.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// Timed runs per candidate, as on the CPU: the minimum drops the first
+// run's warmup (module load, cold L2), and a run of kLongRun seconds is
+// timed once.
+constexpr int kRuns = 3;
+constexpr double kLongRun = 0.05;
+
+}  // namespace
+
+std::string autotune_arch(int device) {
+  return "sm_" + std::to_string(compute_capability(device) / 10);
+}
+
+bool can_time(cudaStream_t stream) {
+  cudaStreamCaptureStatus status = cudaStreamCaptureStatusNone;
+  XFT_CUDA_CHECK(cudaStreamIsCapturing(stream, &status));
+  return status == cudaStreamCaptureStatusNone;
+}
+
+double time_on_stream(cudaStream_t stream, const std::function<void()>& fn) {
+  cudaEvent_t start, end;
+  XFT_CUDA_CHECK(cudaEventCreate(&start));
+  XFT_CUDA_CHECK(cudaEventCreate(&end));
+  double best = std::numeric_limits<double>::infinity();
+  for (int r = 0; r < kRuns; r++) {
+    XFT_CUDA_CHECK(cudaEventRecord(start, stream));
+    fn();
+    XFT_CUDA_CHECK(cudaEventRecord(end, stream));
+    XFT_CUDA_CHECK(cudaEventSynchronize(end));
+    float ms = 0.f;
+    XFT_CUDA_CHECK(cudaEventElapsedTime(&ms, start, end));
+    best = std::min(best, 1e-3 * ms);
+    if (1e-3 * ms >= kLongRun) break;
+  }
+  XFT_CUDA_CHECK(cudaEventDestroy(start));
+  XFT_CUDA_CHECK(cudaEventDestroy(end));
+  return best;
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cuda_runtime.h>
+
+#include <functional>
+#include <string>
+
+namespace xft::cuda {
+
+// The CUDA side of core/autotune.h.
+
+// "sm_XX" for the device's compute capability: the arch part of a key.
+std::string autotune_arch(int device);
+
+// Whether work on `stream` can be timed now: not while the stream is being
+// captured into a graph, where nothing runs until replay.
+bool can_time(cudaStream_t stream);
+
+// Seconds for one call of fn, which enqueues work on `stream`: the best of
+// a few runs (one for long ones) timed with events. Waits for the stream.
+double time_on_stream(cudaStream_t stream, const std::function<void()>& fn);
+
+}  // namespace xft::cuda
@@ -0,0 +1,117 @@
+#include "cuda/blas.h"
+
+#include <cublas_v2.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "cuda/cuda_utils.h"
+#include "cuda/stream.h"
+
+#define XFT_CUBLAS_CHECK(expr)                                                        \
+  do {                                                                                \
+    cublasStatus_t status__ = (expr);                                                 \
+    XFT_CHECK(status__ == CUBLAS_STATUS_SUCCESS, "cuBLAS error: ",                    \
+              cublasGetStatusString(status__), " in ", #expr);                        \
+  } while (0)
+
+namespace xft::cuda {
+
+namespace {
+
+// One handle per (thread, device): handles are not safe to share between
+// threads that set different streams. They are deliberately never destroyed;
+// thread-exit destructors can run after the CUDA context is gone.
+cublasHandle_t get_handle(int device) {
+  thread_local std::vector<cublasHandle_t> handles;
+  if (static_cast<size_t>(device) >= handles.size()) handles.resize(device + 1, nullptr);
+  if (handles[device] == nullptr) XFT_CUBLAS_CHECK(cublasCreate(&handles[device]));
+  return handles[device];
+}
+
+struct BlasMatrix {
+  cublasOperation_t op;
+  int ld;
+};
+
+bool fits_int(int64_t v) { return v >= 0 && v <= std::numeric_limits<int>::max(); }
+
+// cuBLAS is column-major, so a row-major [rows, cols] matrix is handed over as
+// its transpose: unit column stride reads as an untransposed column-major
+// [cols, rows] matrix, unit row stride as a transposed [rows, cols] one.
+std::optional<BlasMatrix> as_blas(int64_t rows, int64_t cols, int64_t row_stride,
+                                  int64_t col_stride) {
+  if (col_stride == 1 || cols == 1) {
+    const int64_t ld = rows == 1 ? std::max<int64_t>(cols, 1) : row_stride;
+    if (ld >= std::max<int64_t>(cols, 1) && fits_int(ld)) {
+      return BlasMatrix{CUBLAS_OP_N, static_cast<int>(ld)};
+    }
+  }
+  if (row_stride == 1 || rows == 1) {
+    const int64_t ld = cols == 1 ? std::max<int64_t>(rows, 1) : col_stride;
+    if (ld >= std::max<int64_t>(rows, 1) && fits_int(ld)) {
+      return BlasMatrix{CUBLAS_OP_T, static_cast<int>(ld)};
+    }
+  }
+  return std::nullopt;
+}
+
+template <typename T>
+struct BlasType;
+template <>
+struct BlasType<float> {
+  using Scale = float;
+  static constexpr cudaDataType_t kData = CUDA_R_32F;
+  static constexpr cublasComputeType_t kCompute = CUBLAS_COMPUTE_32F;
+};
+template <>
+struct BlasType<double> {
+  using Scale = double;
+  static constexpr cudaDataType_t kData = CUDA_R_64F;
+  static constexpr cublasComputeType_t kCompute = CUBLAS_COMPUTE_64F;
+};
+// 16-bit operands accumulate in fp32, which also makes alpha / beta floats.
+template <>
+struct BlasType<Half> {
+  using Scale = float;
+  static constexpr cudaDataType_t kData = CUDA_R_16F;
+  static constexpr cublasComputeType_t kCompute = CUBLAS_COMPUTE_32F;
+};
+template <>
+struct BlasType<BFloat16> {
+  using Scale = float;
+  static constexpr cudaDataType_t kData = CUDA_R_16BF;
+  static constexpr cublasComputeType_t kCompute = CUBLAS_COMPUTE_32F;
+};
+
+}  // namespace
+
+bool blas_bmm(const Tensor& a, const Tensor& b, const Tensor& out) {
+  const int64_t batch = out.size(0), m = out.size(1), n = out.size(2), k = a.size(2);
+  if (!fits_int(batch) || !fits_int(m) || !fits_int(n) || !fits_int(k)) return false;
+  if (!out.is_contiguous()) return false;
+  const auto ma = as_blas(m, k, a.stride(1), a.stride(2));
+  const auto mb = as_blas(k, n, b.stride(1), b.stride(2));
+  if (!ma || !mb) return false;
+
+  const int device = out.device().index;
+  DeviceGuard guard(device);
+  cublasHandle_t handle = get_handle(device);
+  XFT_CUBLAS_CHECK(cublasSetStream(handle, current_stream(device)));
+
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(out.dtype(), "bmm", [&] {
+    using Blas = BlasType<scalar_t>;
+    const typename Blas::Scale alpha = 1, beta = 0;
+    // Row-major C = A @ B is column-major C^T = B^T @ A^T.
+    XFT_CUBLAS_CHECK(cublasGemmStridedBatchedEx(
+        handle, mb->op, ma->op, static_cast<int>(n), static_cast<int>(m), static_cast<int>(k),
+        &alpha, b.data_ptr(), Blas::kData, mb->ld, b.stride(0), a.data_ptr(), Blas::kData,
+        ma->ld, a.stride(0), &beta, out.data_ptr(), Blas::kData, std::max<int>(n, 1), m * n,
+        static_cast<int>(batch), Blas::kCompute, CUBLAS_GEMM_DEFAULT));
+  });
+  return true;
+}
+
+}  // namespace xft::cuda
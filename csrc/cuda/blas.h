@@ -0,0 +1,13 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+// cuBLAS strided-batched GEMM on the current stream, with the same operand
+// contract as bmm(). cuBLAS needs every matrix to have a unit stride in one
+// of its two dims and 32-bit sizes; returns false (and leaves out untouched)
+// when an operand does not fit, so the caller can fall back.
+bool blas_bmm(const Tensor& a, const Tensor& b, const Tensor& out);
+
+}  // namespace xft::cuda
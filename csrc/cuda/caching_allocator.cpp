@@ -0,0 +1,463 @@
+#include "cuda/caching_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cuda/cuda_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr size_t kMinBlockSize = 512;              // every block is a multiple of this
+constexpr size_t kSmallSize = 1 << 20;             // requests up to 1 MiB use the small pool
+constexpr size_t kSmallBuffer = 2 << 20;           // small-pool segments are 2 MiB
+constexpr size_t kLargeBuffer = 20 << 20;          // mid-size requests share 20 MiB segments
+constexpr size_t kMinLargeAlloc = 10 << 20;        // ... up to this size
+constexpr size_t kRoundLarge = 2 << 20;            // bigger requests round up to 2 MiB
+
+struct BlockPool;
+struct PrivatePool;
+
+struct Block {
+  int device;
+  cudaStream_t stream;
+  size_t size;
+  void* ptr;
+  BlockPool* pool;
+  bool allocated = false;
+  Block* prev = nullptr;  // neighbours carved from the same cudaMalloc segment
+  Block* next = nullptr;
+  std::unordered_set<cudaStream_t> stream_uses;  // other streams that touched it
+  int event_count = 0;                           // outstanding events before reuse
+
+  Block(int device, cudaStream_t stream, size_t size, void* ptr, BlockPool* pool)
+      : device(device), stream(stream), size(size), ptr(ptr), pool(pool) {}
+
+  bool is_split() const { return prev != nullptr || next != nullptr; }
+};
+
+// Orders by (stream, size, address) so lower_bound finds the best fit for a
+// stream in O(log n).
+bool block_less(const Block* a, const Block* b) {
+  if (a->stream != b->stream) {
+    return reinterpret_cast<uintptr_t>(a->stream) < reinterpret_cast<uintptr_t>(b->stream);
+  }
+  if (a->size != b->size) return a->size < b->size;
+  return reinterpret_cast<uintptr_t>(a->ptr) < reinterpret_cast<uintptr_t>(b->ptr);
+}
+
+struct BlockPool {
+  std::set<Block*, bool (*)(const Block*, const Block*)> blocks{block_less};
+  const bool is_small;
+  PrivatePool* const owner;  // null for the device's shared pools
+  explicit BlockPool(bool small, PrivatePool* owner = nullptr) : is_small(small), owner(owner) {}
+};
+
+// The free lists of one graph memory pool.
+struct PrivatePool {
+  BlockPool small{true, this};
+  BlockPool large{false, this};
+  int use_count = 0;             // graphs holding the pool
+  int64_t allocated_blocks = 0;  // blocks from it still handed out
+};
+
+struct CaptureRoute {
+  cudaStream_t stream;
+  MempoolId id;
+  PrivatePool* pool;
+};
+
+struct DeviceState {
+  BlockPool small{true};
+  BlockPool large{false};
+  std::unordered_map<void*, Block*> active;
+  // Blocks freed while other streams may still use them, in record order.
+  std::deque<std::pair<cudaEvent_t, Block*>> events;
+  std::unordered_map<MempoolId, std::unique_ptr<PrivatePool>> private_pools;
+  // Streams being captured, whose allocations go to a private pool. Event
+  // calls are illegal during capture, so while this is non-empty frees that
+  // need events wait in `deferred`.
+  std::vector<CaptureRoute> routes;
+  std::vector<Block*> deferred;
+  MemoryStats stats;
+};
+
+size_t round_size(size_t n) {
+  if (n < kMinBlockSize) return kMinBlockSize;
+  return (n + kMinBlockSize - 1) / kMinBlockSize * kMinBlockSize;
+}
+
+size_t segment_size(size_t n) {
+  if (n <= kSmallSize) return kSmallBuffer;
+  if (n < kMinLargeAlloc) return kLargeBuffer;
+  return (n + kRoundLarge - 1) / kRoundLarge * kRoundLarge;
+}
+
+// cudaMalloc is one of the calls a capturing thread may not make in the
+// default capture mode; it does not touch the captured streams, so relax
+// the mode around it.
+cudaError_t device_malloc(void** ptr, size_t nbytes) {
+  cudaStreamCaptureMode mode = cudaStreamCaptureModeRelaxed;
+  XFT_CUDA_CHECK(cudaThreadExchangeStreamCaptureMode(&mode));
+  const cudaError_t err = cudaMalloc(ptr, nbytes);
+  XFT_CUDA_CHECK(cudaThreadExchangeStreamCaptureMode(&mode));
+  return err;
+}
+
+class AllocatorState {
+ public:
+  void* malloc(size_t nbytes, int device, cudaStream_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& dev = state(device);
+    if (dev.routes.empty()) process_events(dev);
+    const size_t size = round_size(nbytes);
+    PrivatePool* route = nullptr;
+    for (const CaptureRoute& r : dev.routes) {
+      if (r.stream == stream) route = r.pool;
+    }
+    BlockPool& pool = route != nullptr ? (size <= kSmallSize ? route->small : route->large)
+                                       : (size <= kSmallSize ? dev.small : dev.large);
+
+    Block* block = find_free(pool, stream, size);
+    if (block != nullptr) {
+      dev.stats.num_cache_hits++;
+    } else {
+      block = new_segment(dev, pool, device, stream, size);
+    }
+
+    const size_t remaining = block->size - size;
+    if (pool.is_small ? remaining >= kMinBlockSize : remaining > kSmallSize) {
+      auto* rest = new Block(device, stream, remaining, static_cast<char*>(block->ptr) + size,
+                             &pool);
+      rest->prev = block;
+      rest->next = block->next;
+      if (rest->next) rest->next->prev = rest;
+      block->next = rest;
+      block->size = size;
+      pool.blocks.insert(rest);
+    }
+
+    block->allocated = true;
+    if (pool.owner != nullptr) pool.owner->allocated_blocks++;
+    dev.active[block->ptr] = block;
+    dev.stats.num_allocs++;
+    dev.stats.allocated_bytes += static_cast<int64_t>(block->size);
+    dev.stats.peak_allocated_bytes =
+        std::max(dev.stats.peak_allocated_bytes, dev.stats.allocated_bytes);
+    return block->ptr;
+  }
+
+  void free(void* ptr, int device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& dev = state(device);
+    auto it = dev.active.find(ptr);
+    XFT_CHECK(it != dev.active.end(), "caching allocator: freeing unknown pointer");
+    Block* block = it->second;
+    dev.active.erase(it);
+    dev.stats.num_frees++;
+    if (block->stream_uses.empty()) {
+      free_block(dev, block);
+    } else if (!dev.routes.empty()) {
+      dev.deferred.push_back(block);
+    } else {
+      record_events(dev, block);
+    }
+  }
+
+  void record_stream(void* ptr, int device, cudaStream_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& dev = state(device);
+    auto it = dev.active.find(ptr);
+    XFT_CHECK(it != dev.active.end(), "record_stream: pointer was not allocated by xft");
+    if (stream != it->second->stream) it->second->stream_uses.insert(stream);
+  }
+
+  void begin_route(int device, MempoolId id, cudaStream_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& dev = state(device);
+    for (const CaptureRoute& r : dev.routes) {
+      XFT_CHECK(r.stream != stream, "caching allocator: stream is already being captured");
+    }
+    auto& pool = dev.private_pools[id];
+    if (!pool) pool = std::make_unique<PrivatePool>();
+    pool->use_count++;
+    dev.routes.push_back({stream, id, pool.get()});
+  }
+
+  void end_route(int device, MempoolId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& dev = state(device);
+    auto it = std::find_if(dev.routes.begin(), dev.routes.end(),
+                           [&](const CaptureRoute& r) { return r.id == id; });
+    XFT_CHECK(it != dev.routes.end(), "caching allocator: pool ", id, " is not being captured");
+    dev.routes.erase(it);
+    if (!dev.routes.empty()) return;
+    for (Block* block : dev.deferred) record_events(dev, block);
+    dev.deferred.clear();
+  }
+
+  void drop_pool_use(int device, MempoolId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& dev = state(device);
+    auto it = dev.private_pools.find(id);
+    XFT_CHECK(it != dev.private_pools.end() && it->second->use_count > 0,
+              "caching allocator: pool ", id, " is not in use");
+    it->second->use_count--;
+    release_private(dev, it->second.get());
+  }
+
+  void release_cached() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t d = 0; d < devices_.size(); d++) {
+      if (!devices_[d]) continue;
+      XFT_CHECK(devices_[d]->routes.empty(),
+                "empty_cache: not allowed while a CUDA graph is being captured");
+      synchronize_events(*devices_[d]);
+      release_pool(*devices_[d], devices_[d]->small);
+      release_pool(*devices_[d], devices_[d]->large);
+    }
+  }
+
+  MemoryStats stats(int device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state(device).stats;
+  }
+
+  void reset_peak(int device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryStats& s = state(device).stats;
+    s.peak_allocated_bytes = s.allocated_bytes;
+    s.peak_reserved_bytes = s.reserved_bytes;
+  }
+
+ private:
+  DeviceState& state(int device) {
+    XFT_CHECK(device >= 0, "caching allocator: invalid device ", device);
+    if (static_cast<size_t>(device) >= devices_.size()) devices_.resize(device + 1);
+    if (!devices_[device]) devices_[device] = std::make_unique<DeviceState>();
+    return *devices_[device];
+  }
+
+  // Another stream may still be reading or writing the block; give it back
+  // only once the work enqueued there so far has finished.
+  void record_events(DeviceState& dev, Block* block) {
+    DeviceGuard guard(block->device);
+    for (cudaStream_t stream : block->stream_uses) {
+      cudaEvent_t event;
+      XFT_CUDA_CHECK(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+      XFT_CUDA_CHECK(cudaEventRecord(event, stream));
+      block->event_count++;
+      dev.events.emplace_back(event, block);
+    }
+    block->stream_uses.clear();
+  }
+
+  void free_block(DeviceState& dev, Block* block) {
+    dev.stats.allocated_bytes -= static_cast<int64_t>(block->size);
+    block->allocated = false;
+    BlockPool& pool = *block->pool;
+    merge(block, block->prev, pool);
+    merge(block, block->next, pool);
+    pool.blocks.insert(block);
+    if (pool.owner != nullptr) {
+      pool.owner->allocated_blocks--;
+      release_private(dev, pool.owner);
+    }
+  }
+
+  // Once no graph holds a private pool, its cached segments go back to the
+  // driver, and the pool itself once nothing allocated from it is alive.
+  // Not while capturing: cudaFree would break the capture.
+  void release_private(DeviceState& dev, PrivatePool* pool) {
+    if (pool->use_count > 0 || !dev.routes.empty()) return;
+    release_pool(dev, pool->small);
+    release_pool(dev, pool->large);
+    if (pool->allocated_blocks > 0) return;
+    for (auto it = dev.private_pools.begin(); it != dev.private_pools.end(); ++it) {
+      if (it->second.get() == pool) {
+        dev.private_pools.erase(it);
+        return;
+      }
+    }
+  }
+
+  // Returns blocks whose cross-stream events have all completed.
+  void process_events(DeviceState& dev) {
+    while (!dev.events.empty()) {
+      auto [event, block] = dev.events.front();
+      cudaError_t err = cudaEventQuery(event);
+      if (err == cudaErrorNotReady) {
+        cudaGetLastError();
+        break;
+      }
+      XFT_CUDA_CHECK(err);
+      XFT_CUDA_CHECK(cudaEventDestroy(event));
+      dev.events.pop_front();
+      if (--block->event_count == 0) free_block(dev, block);
+    }
+  }
+
+  void synchronize_events(DeviceState& dev) {
+    for (auto& [event, block] : dev.events) {
+      XFT_CUDA_CHECK(cudaEventSynchronize(event));
+      XFT_CUDA_CHECK(cudaEventDestroy(event));
+      if (--block->event_count == 0) free_block(dev, block);
+    }
+    dev.events.clear();
+  }
+
+  static Block* find_free(BlockPool& pool, cudaStream_t stream, size_t size) {
+    Block key(0, stream, size, nullptr, &pool);
+    auto it = pool.blocks.lower_bound(&key);
+    if (it == pool.blocks.end() || (*it)->stream != stream) return nullptr;
+    Block* block = *it;
+    pool.blocks.erase(it);
+    return block;
+  }
+
+  Block* new_segment(DeviceState& dev, BlockPool& pool, int device, cudaStream_t stream,
+                     size_t size) {
+    const size_t alloc = segment_size(size);
+    DeviceGuard guard(device);
+    void* ptr = nullptr;
+    cudaError_t err = device_malloc(&ptr, alloc);
+    if (err == cudaErrorMemoryAllocation && dev.routes.empty()) {
+      // Give cached memory back to the driver and try once more.
+      cudaGetLastError();
+      dev.stats.num_ooms++;
+      synchronize_events(dev);
+      release_pool(dev, dev.small);
+      release_pool(dev, dev.large);
+      err = device_malloc(&ptr, alloc);
+    }
+    if (err != cudaSuccess) {
+      cudaGetLastError();
+      XFT_FAIL("CUDA out of memory: tried to allocate ", alloc, " bytes on device ", device,
+               " (", dev.stats.allocated_bytes, " allocated, ", dev.stats.reserved_bytes,
+               " reserved)");
+    }
+    dev.stats.num_device_mallocs++;
+    dev.stats.reserved_bytes += static_cast<int64_t>(alloc);
+    dev.stats.peak_reserved_bytes =
+        std::max(dev.stats.peak_reserved_bytes, dev.stats.reserved_bytes);
+    return new Block(device, stream, alloc, ptr, &pool);
+  }
+
+  // Absorbs a free neighbour into `block`.
+  static void merge(Block* block, Block* neighbour, BlockPool& pool) {
+    if (neighbour == nullptr || neighbour->allocated) return;
+    if (neighbour == block->prev) {
+      block->ptr = neighbour->ptr;
+      block->prev = neighbour->prev;
+      if (block->prev) block->prev->next = block;
+    } else {
+      block->next = neighbour->next;
+      if (block->next) block->next->prev = block;
+    }
+    block->size += neighbour->size;
+    pool.blocks.erase(neighbour);
+    delete neighbour;
+  }
+
+  // Frees every segment that is entirely cached. Split segments still have a
+  // live block somewhere and stay put.
+  static void release_pool(DeviceState& dev, BlockPool& pool) {
+    for (auto it = pool.blocks.begin(); it != pool.blocks.end();) {
+      Block* block = *it;
+      if (block->is_split()) {
+        ++it;
+        continue;
+      }
+      DeviceGuard guard(block->device);
+      XFT_CUDA_CHECK(cudaFree(block->ptr));
+      dev.stats.num_device_frees++;
+      dev.stats.reserved_bytes -= static_cast<int64_t>(block->size);
+      it = pool.blocks.erase(it);
+      delete block;
+    }
+  }
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<DeviceState>> devices_;
+};
+
+AllocatorState& allocator_state() {
+  // Leaked on purpose: tensors may be released during interpreter teardown,
+  // after static destructors would have run.
+  static auto* state = new AllocatorState();
+  return *state;
+}
+
+[[maybe_unused]] const bool registered = [] {
+  set_allocator(DeviceType::CUDA, caching_allocator());
+  return true;
+}();
+
+}  // namespace
+
+void* CachingAllocator::allocate(size_t nbytes, Device device) {
+  return allocate(nbytes, device.index, current_stream(device.index));
+}
+
+void* CachingAllocator::allocate(size_t nbytes, int device, cudaStream_t stream) {
+  if (nbytes == 0) return nullptr;
+  return allocator_state().malloc(nbytes, device, stream);
+}
+
+void CachingAllocator::deallocate(void* ptr, Device device) {
+  if (ptr == nullptr) return;
+  allocator_state().free(ptr, device.index);
+}
+
+void CachingAllocator::record_stream(void* ptr, int device, cudaStream_t stream) {
+  if (ptr == nullptr) return;
+  allocator_state().record_stream(ptr, device, stream);
+}
+
+MempoolId CachingAllocator::new_pool_id() {
+  static std::atomic<MempoolId> next{1};
+  return next++;
+}
+
+void CachingAllocator::begin_allocate_to_pool(int device, MempoolId pool, cudaStream_t stream) {
+  allocator_state().begin_route(device, pool, stream);
+}
+
+void CachingAllocator::end_allocate_to_pool(int device, MempoolId pool) {
+  allocator_state().end_route(device, pool);
+}
+
+void CachingAllocator::release_pool(int device, MempoolId pool) {
+  allocator_state().drop_pool_use(device, pool);
+}
+
+void CachingAllocator::empty_cache() { allocator_state().release_cached(); }
+
+MemoryStats CachingAllocator::stats(int device) { return allocator_state().stats(device); }
+
+void CachingAllocator::reset_peak_stats(int device) { allocator_state().reset_peak(device); }
+
+CachingAllocator* caching_allocator() {
+  static CachingAllocator allocator;
+  return &allocator;
+}
+
+int device_count() {
+  int n = 0;
+  if (cudaGetDeviceCount(&n) != cudaSuccess) {
+    cudaGetLastError();
+    return 0;
+  }
+  return n;
+}
+
+}  // namespace xft::cuda
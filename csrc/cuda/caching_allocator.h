@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cuda_runtime.h>
+
+#include <cstdint>
+
+#include "core/allocator.h"
+
+namespace xft::cuda {
+
+// Counters for one device, in bytes unless noted otherwise. The order of the
+// fields is the order xft_cuda_memory_stats() writes them in.
+struct MemoryStats {
+  int64_t allocated_bytes = 0;       // handed out to live tensors
+  int64_t reserved_bytes = 0;        // obtained from cudaMalloc, cached or not
+  int64_t peak_allocated_bytes = 0;
+  int64_t peak_reserved_bytes = 0;
+  int64_t num_allocs = 0;            // count
+  int64_t num_frees = 0;             // count
+  int64_t num_cache_hits = 0;        // count: allocations served without cudaMalloc
+  int64_t num_device_mallocs = 0;    // count
+  int64_t num_device_frees = 0;      // count
+  int64_t num_ooms = 0;              // count: cudaMalloc failures (before retry)
+};
+
+constexpr int kNumMemoryStats = sizeof(MemoryStats) / sizeof(int64_t);
+
+// Names a private memory pool (see begin_allocate_to_pool); 0 is "none".
+using MempoolId = uint64_t;
+
+// A PyTorch-style caching allocator. Memory is obtained from cudaMalloc in
+// segments and carved into blocks; freed blocks go back to a per-device,
+// per-stream free list (small and large pools, ordered by size) and are
+// reused without touching the driver. Oversized blocks are split on
+// allocation and coalesced with free neighbours on release.
+//
+// A block belongs to the stream that was current when it was allocated and
+// is only reused by work on that stream, which keeps reuse stream-ordered
+// without synchronization. When a tensor is also used on another stream,
+// record_stream() marks it; on free, an event is recorded on each such stream
+// and the block returns to the pool once those events complete.
+//
+// CUDA graph capture bakes device addresses into the graph, so memory used
+// by a captured graph must not be handed to anyone else while the graph can
+// still be replayed. During capture, allocations on the capturing stream
+// come from a private pool with its own free lists and segments; blocks
+// freed there go back to that pool only. A pool lives while any graph holds
+// a use of it; its cached segments are returned to the driver after the
+// last use is released. While any capture is underway on a device, event
+// polling (illegal inside a capture) is postponed until it ends.
+class CachingAllocator final : public Allocator {
+ public:
+  void* allocate(size_t nbytes, Device device) override;
+  void deallocate(void* ptr, Device device) override;
+
+  void* allocate(size_t nbytes, int device, cudaStream_t stream);
+  // `ptr` is a storage base pointer returned by allocate().
+  void record_stream(void* ptr, int device, cudaStream_t stream);
+
+  // A fresh pool id, for graphs that should share one pool.
+  static MempoolId new_pool_id();
+  // Until end_allocate_to_pool(), allocations on `stream` come from private
+  // pool `pool`, created on first use. Each call takes a use of the pool.
+  void begin_allocate_to_pool(int device, MempoolId pool, cudaStream_t stream);
+  void end_allocate_to_pool(int device, MempoolId pool);
+  // Drops a use of the pool; its memory is released once the last use is
+  // dropped and every block allocated from it has been freed.
+  void release_pool(int device, MempoolId pool);
+
+  // Returns every cached, unsplit segment to the driver.
+  void empty_cache();
+  MemoryStats stats(int device);
+  void reset_peak_stats(int device);
+};
+
+CachingAllocator* caching_allocator();
+
+}  // namespace xft::cuda
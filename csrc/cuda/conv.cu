@@ -0,0 +1,586 @@
+#include "cuda/conv.h"
+
+#include <mma.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "core/autotune.h"
+#include "cuda/autotune.h"
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/gemm.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// Each pass is a GEMM C [M, N] = A [M, K] @ B [K, N] per group (blockIdx.z
+// carries the group), with A and B gathered straight from the
+// channels-last tensors by a Problem, so no unfolded copy of x exists:
+//  - forward: rows are output pixels, columns the group's output channels
+//    and K runs over (tap, input channel);
+//  - backward input: rows are input pixels, columns the group's input
+//    channels and K runs over (tap, output channel);
+//  - backward weight: rows are (tap, input channel), columns the group's
+//    output channels and K runs over output pixels, split across blocks.
+// A Problem gives a(m, k, g), b(k, n, g) and store(m, n, g, value), and
+// kAKFast when A is contiguous along k (so consecutive threads load along
+// k and coalesce) rather than along m. B is contiguous along n in all
+// three.
+
+template <typename T>
+__device__ __forceinline__ T zero_of() {
+  return from_op<T>(opmath_t<T>(0));
+}
+
+template <typename T>
+struct ForwardProblem {
+  using Scalar = T;
+  static constexpr bool kAKFast = true;
+  ConvShape s;
+  const T* x;
+  const T* w;  // [R, S, Cg, K]
+  const T* bias;
+  T* y;
+
+  __device__ T a(int64_t m, int64_t k, int64_t g) const {
+    const int64_t Cg = s.C / s.groups, t = k / Cg, ci = k - t * Cg;
+    const int64_t ow = m % s.OW, oh = m / s.OW % s.OH, n = m / (s.OW * s.OH);
+    const int64_t ih = oh * s.stride_h - s.pad_h + t / s.S * s.dilation_h;
+    const int64_t iw = ow * s.stride_w - s.pad_w + t % s.S * s.dilation_w;
+    if (ih < 0 || ih >= s.H || iw < 0 || iw >= s.W) return zero_of<T>();
+    return x[((n * s.H + ih) * s.W + iw) * s.C + g * Cg + ci];
+  }
+  __device__ T b(int64_t k, int64_t n, int64_t g) const {
+    return w[k * s.K + g * (s.K / s.groups) + n];
+  }
+  __device__ void store(int64_t m, int64_t n, int64_t g, opmath_t<T> v) const {
+    const int64_t co = g * (s.K / s.groups) + n;
+    if (bias != nullptr) v += to_op(bias[co]);
+    y[m * s.K + co] = from_op<T>(v);
+  }
+};
+
+template <typename T>
+struct BackwardInputProblem {
+  using Scalar = T;
+  static constexpr bool kAKFast = true;
+  ConvShape s;
+  const T* dy;
+  const T* w;  // [R, S, K, Cg]
+  T* dx;
+
+  __device__ T a(int64_t m, int64_t k, int64_t g) const {
+    const int64_t Kg = s.K / s.groups, t = k / Kg, co = k - t * Kg;
+    const int64_t iw = m % s.W, ih = m / s.W % s.H, n = m / (s.W * s.H);
+    const int64_t hs = ih + s.pad_h - t / s.S * s.dilation_h;
+    const int64_t ws = iw + s.pad_w - t % s.S * s.dilation_w;
+    if (hs < 0 || ws < 0 || hs % s.stride_h != 0 || ws % s.stride_w != 0) return zero_of<T>();
+    const int64_t oh = hs / s.stride_h, ow = ws / s.stride_w;
+    if (oh >= s.OH || ow >= s.OW) return zero_of<T>();
+    return dy[((n * s.OH + oh) * s.OW + ow) * s.K + g * Kg + co];
+  }
+  __device__ T b(int64_t k, int64_t n, int64_t g) const {
+    const int64_t Kg = s.K / s.groups, Cg = s.C / s.groups, t = k / Kg;
+    return w[(t * s.K + g * Kg + (k - t * Kg)) * Cg + n];
+  }
+  __device__ void store(int64_t m, int64_t n, int64_t g, opmath_t<T> v) const {
+    dx[m * s.C + g * (s.C / s.groups) + n] = from_op<T>(v);
+  }
+};
+
+// atomicAdd on double needs sm_60; older targets retry a compare-and-swap.
+template <typename A>
+__device__ __forceinline__ void atomic_add(A* p, A v) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 600
+  if constexpr (std::is_same_v<A, double>) {
+    auto* word = reinterpret_cast<unsigned long long*>(p);
+    unsigned long long seen = *word, expected;
+    do {
+      expected = seen;
+      const double sum = __longlong_as_double(static_cast<long long>(expected)) + v;
+      seen = atomicCAS(word, expected, static_cast<unsigned long long>(__double_as_longlong(sum)));
+    } while (seen != expected);
+    return;
+  }
+#endif
+  atomicAdd(p, v);
+}
+
+template <typename T>
+struct BackwardWeightProblem {
+  using Scalar = T;
+  static constexpr bool kAKFast = false;
+  ConvShape s;
+  const T* x;
+  const T* dy;
+  opmath_t<T>* dw;  // [R * S * Cg, K], zeroed; blocks add their share
+
+  __device__ T a(int64_t r, int64_t m, int64_t g) const {
+    const int64_t Cg = s.C / s.groups, t = r / Cg, ci = r - t * Cg;
+    const int64_t ow = m % s.OW, oh = m / s.OW % s.OH, n = m / (s.OW * s.OH);
+    const int64_t ih = oh * s.stride_h - s.pad_h + t / s.S * s.dilation_h;
+    const int64_t iw = ow * s.stride_w - s.pad_w + t % s.S * s.dilation_w;
+    if (ih < 0 || ih >= s.H || iw < 0 || iw >= s.W) return zero_of<T>();
+    return x[((n * s.H + ih) * s.W + iw) * s.C + g * Cg + ci];
+  }
+  __device__ T b(int64_t m, int64_t n, int64_t g) const {
+    return dy[m * s.K + g * (s.K / s.groups) + n];
+  }
+  __device__ void store(int64_t r, int64_t n, int64_t g, opmath_t<T> v) const {
+    atomic_add(dw + r * s.K + g * (s.K / s.groups) + n, v);
+  }
+};
+
+// The GEMM shape of a launch; K is cut into `splits` ranges of whole slabs,
+// one per block along z next to the group.
+struct GemmDims {
+  int64_t m, n, k;
+  int64_t groups;
+  int splits;
+};
+
+// Maps a thread-linear load index to a (row, col) inside a rows x cols
+// slab, walking col when col_fast.
+__device__ __forceinline__ void slab_coord(int idx, int rows, int cols, bool col_fast, int& r,
+                                           int& c) {
+  if (col_fast) {
+    r = idx / cols;
+    c = idx % cols;
+  } else {
+    r = idx % rows;
+    c = idx / rows;
+  }
+}
+
+// The K range [k_begin, k_end) of this block's split.
+__device__ __forceinline__ void split_range(const GemmDims& d, int bk, int64_t& k_begin,
+                                            int64_t& k_end) {
+  const int64_t slabs = (d.k + bk - 1) / bk;
+  const int64_t per = (slabs + d.splits - 1) / d.splits * bk;
+  k_begin = static_cast<int64_t>(blockIdx.z % d.splits) * per;
+  k_end = k_begin + per < d.k ? k_begin + per : d.k;
+}
+
+// ---------------------------------------------------------------------------
+// SIMT kernel: a BM x BN tile per block over BK-deep slabs, double-buffered
+// through shared memory as in cuda/gemm.cu, TM x TN outputs per thread, in
+// a few tile shapes.
+// ---------------------------------------------------------------------------
+
+template <int BM_, int BN_, int BK_, int TM_, int TN_>
+struct ConvTile {
+  static constexpr int BM = BM_, BN = BN_, BK = BK_, TM = TM_, TN = TN_;
+  static constexpr int kThreads = (BM / TM) * (BN / TN);
+  static constexpr int kALoads = BM * BK / kThreads;
+  static constexpr int kBLoads = BK * BN / kThreads;
+  static_assert(BM * BK % kThreads == 0 && BK * BN % kThreads == 0, "tile/thread mismatch");
+};
+
+// The medium tile is the default; core/autotune.h times the others per
+// shape.
+using MediumTile = ConvTile<64, 64, 16, 4, 4>;
+using LargeTile = ConvTile<128, 128, 8, 8, 8>;
+using SmallTile = ConvTile<32, 32, 16, 2, 2>;
+
+template <typename Cfg, typename P>
+__global__ void __launch_bounds__(Cfg::kThreads) conv_simt_kernel(P p, GemmDims d) {
+  using T = typename P::Scalar;
+  using AccT = opmath_t<T>;
+  constexpr int kBM = Cfg::BM, kBN = Cfg::BN, kBK = Cfg::BK, kTM = Cfg::TM, kTN = Cfg::TN;
+  constexpr int kSimtThreads = Cfg::kThreads, kSimtALoads = Cfg::kALoads,
+                kSimtBLoads = Cfg::kBLoads;
+  __shared__ T As[2][kBK][kBM];
+  __shared__ T Bs[2][kBK][kBN];
+
+  const int tid = threadIdx.x;
+  const int tr = tid / (kBN / kTN), tc = tid % (kBN / kTN);
+  const int64_t row0 = static_cast<int64_t>(blockIdx.x) * kBM;
+  const int64_t col0 = static_cast<int64_t>(blockIdx.y) * kBN;
+  const int64_t g = blockIdx.z / d.splits;
+  int64_t k_begin, k_end;
+  split_range(d, kBK, k_begin, k_end);
+
+  T a_reg[kSimtALoads];
+  T b_reg[kSimtBLoads];
+  auto load = [&](int64_t k0) {
+#pragma unroll
+    for (int i = 0; i < kSimtALoads; i++) {
+      int m, kk;
+      slab_coord(tid + i * kSimtThreads, kBM, kBK, P::kAKFast, m, kk);
+      const int64_t gm = row0 + m, gk = k0 + kk;
+      a_reg[i] = gm < d.m && gk < k_end ? p.a(gm, gk, g) : zero_of<T>();
+    }
+#pragma unroll
+    for (int i = 0; i < kSimtBLoads; i++) {
+      int kk, n;
+      slab_coord(tid + i * kSimtThreads, kBK, kBN, true, kk, n);
+      const int64_t gk = k0 + kk, gn = col0 + n;
+      b_reg[i] = gk < k_end && gn < d.n ? p.b(gk, gn, g) : zero_of<T>();
+    }
+  };
+  auto store = [&](int buf) {
+#pragma unroll
+    for (int i = 0; i < kSimtALoads; i++) {
+      int m, kk;
+      slab_coord(tid + i * kSimtThreads, kBM, kBK, P::kAKFast, m, kk);
+      As[buf][kk][m] = a_reg[i];
+    }
+#pragma unroll
+    for (int i = 0; i < kSimtBLoads; i++) {
+      int kk, n;
+      slab_coord(tid + i * kSimtThreads, kBK, kBN, true, kk, n);
+      Bs[buf][kk][n] = b_reg[i];
+    }
+  };
+
+  AccT acc[kTM][kTN];
+#pragma unroll
+  for (int i = 0; i < kTM; i++)
+#pragma unroll
+    for (int j = 0; j < kTN; j++) acc[i][j] = AccT(0);
+
+  if (k_begin < k_end) {
+    load(k_begin);
+    store(0);
+  }
+  __syncthreads();
+
+  int buf = 0;
+  for (int64_t k0 = k_begin; k0 < k_end; k0 += kBK) {
+    const bool has_next = k0 + kBK < k_end;
+    if (has_next) load(k0 + kBK);
+#pragma unroll
+    for (int kk = 0; kk < kBK; kk++) {
+      AccT ra[kTM], rb[kTN];
+#pragma unroll
+      for (int i = 0; i < kTM; i++) ra[i] = to_op(As[buf][kk][tr * kTM + i]);
+#pragma unroll
+      for (int j = 0; j < kTN; j++) rb[j] = to_op(Bs[buf][kk][tc * kTN + j]);
+#pragma unroll
+      for (int i = 0; i < kTM; i++)
+#pragma unroll
+        for (int j = 0; j < kTN; j++) acc[i][j] += ra[i] * rb[j];
+    }
+    if (has_next) store(buf ^ 1);
+    __syncthreads();
+    buf ^= 1;
+  }
+
+#pragma unroll
+  for (int i = 0; i < kTM; i++) {
+    const int64_t gm = row0 + tr * kTM + i;
+    if (gm >= d.m) continue;
+#pragma unroll
+    for (int j = 0; j < kTN; j++) {
+      const int64_t gn = col0 + tc * kTN + j;
+      if (gn < d.n) p.store(gm, gn, g, acc[i][j]);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Tensor-core kernel (fp16 / bf16, fp32 accumulation) via WMMA, laid out
+// like the one in cuda/gemm.cu: a 64x64 tile, BK = 32, four warps of 2x2
+// 16x16x16 fragments, padded shared rows, and the fp32 tile staged through
+// shared memory for the Problem's store.
+// ---------------------------------------------------------------------------
+
+constexpr int kWmmaBM = 64, kWmmaBN = 64, kWmmaBK = 32, kWmmaPad = 8, kWmmaThreads = 128;
+
+template <typename T>
+struct WmmaArch {
+  static constexpr int kMin = 700;
+};
+template <>
+struct WmmaArch<__nv_bfloat16> {
+  static constexpr int kMin = 800;
+};
+
+template <typename P>
+__global__ void __launch_bounds__(kWmmaThreads) conv_wmma_kernel(P p, GemmDims d) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 700
+  using T = typename P::Scalar;
+  if constexpr (__CUDA_ARCH__ >= WmmaArch<T>::kMin) {
+    using namespace nvcuda;
+    constexpr int BM = kWmmaBM, BN = kWmmaBN, BK = kWmmaBK, LDA = BK + kWmmaPad,
+                  LDB = BN + kWmmaPad;
+    constexpr int kALoads = BM * BK / kWmmaThreads;
+    constexpr int kBLoads = BK * BN / kWmmaThreads;
+    __shared__ __align__(32) T As[2][BM][LDA];
+    __shared__ __align__(32) T Bs[2][BK][LDB];
+    __shared__ __align__(32) float Cs[BM][BN];
+
+    const int tid = threadIdx.x;
+    const int warp = tid / 32;
+    const int wm = warp / 2, wn = warp % 2;
+    const int64_t row0 = static_cast<int64_t>(blockIdx.x) * BM;
+    const int64_t col0 = static_cast<int64_t>(blockIdx.y) * BN;
+    const int64_t g = blockIdx.z / d.splits;
+    int64_t k_begin, k_end;
+    split_range(d, BK, k_begin, k_end);
+
+    T a_reg[kALoads];
+    T b_reg[kBLoads];
+    auto load = [&](int64_t k0) {
+#pragma unroll
+      for (int i = 0; i < kALoads; i++) {
+        int m, kk;
+        slab_coord(tid + i * kWmmaThreads, BM, BK, P::kAKFast, m, kk);
+        const int64_t gm = row0 + m, gk = k0 + kk;
+        a_reg[i] = gm < d.m && gk < k_end ? p.a(gm, gk, g) : zero_of<T>();
+      }
+#pragma unroll
+      for (int i = 0; i < kBLoads; i++) {
+        int kk, n;
+        slab_coord(tid + i * kWmmaThreads, BK, BN, true, kk, n);
+        const int64_t gk = k0 + kk, gn = col0 + n;
+        b_reg[i] = gk < k_end && gn < d.n ? p.b(gk, gn, g) : zero_of<T>();
+      }
+    };
+    auto store = [&](int buf) {
+#pragma unroll
+      for (int i = 0; i < kALoads; i++) {
+        int m, kk;
+        slab_coord(tid + i * kWmmaThreads, BM, BK, P::kAKFast, m, kk);
+        As[buf][m][kk] = a_reg[i];
+      }
+#pragma unroll
+      for (int i = 0; i < kBLoads; i++) {
+        int kk, n;
+        slab_coord(tid + i * kWmmaThreads, BK, BN, true, kk, n);
+        Bs[buf][kk][n] = b_reg[i];
+      }
+    };
+
+    wmma::fragment<wmma::accumulator, 16, 16, 16, float> acc[2][2];
+#pragma unroll
+    for (int i = 0; i < 2; i++)
+#pragma unroll
+      for (int j = 0; j < 2; j++) wmma::fill_fragment(acc[i][j], 0.f);
+
+    if (k_begin < k_end) {
+      load(k_begin);
+      store(0);
+    }
+    __syncthreads();
+
+    int buf = 0;
+    for (int64_t k0 = k_begin; k0 < k_end; k0 += BK) {
+      const bool has_next = k0 + BK < k_end;
+      if (has_next) load(k0 + BK);
+#pragma unroll
+      for (int kk = 0; kk < BK; kk += 16) {
+        wmma::fragment<wmma::matrix_a, 16, 16, 16, T, wmma::row_major> fa[2];
+        wmma::fragment<wmma::matrix_b, 16, 16, 16, T, wmma::row_major> fb[2];
+#pragma unroll
+        for (int i = 0; i < 2; i++)
+          wmma::load_matrix_sync(fa[i], &As[buf][wm * 32 + i * 16][kk], LDA);
+#pragma unroll
+        for (int j = 0; j < 2; j++)
+          wmma::load_matrix_sync(fb[j], &Bs[buf][kk][wn * 32 + j * 16], LDB);
+#pragma unroll
+        for (int i = 0; i < 2; i++)
+#pragma unroll
+          for (int j = 0; j < 2; j++) wmma::mma_sync(acc[i][j], fa[i], fb[j], acc[i][j]);
+      }
+      if (has_next) store(buf ^ 1);
+      __syncthreads();
+      buf ^= 1;
+    }
+
+#pragma unroll
+    for (int i = 0; i < 2; i++)
+#pragma unroll
+      for (int j = 0; j < 2; j++)
+        wmma::store_matrix_sync(&Cs[wm * 32 + i * 16][wn * 32 + j * 16], acc[i][j], BN,
+                                wmma::mem_row_major);
+    __syncthreads();
+
+    for (int idx = tid; idx < BM * BN; idx += kWmmaThreads) {
+      const int r = idx / BN, c = idx % BN;
+      const int64_t gm = row0 + r, gn = col0 + c;
+      if (gm < d.m && gn < d.n) p.store(gm, gn, g, Cs[r][c]);
+    }
+  }
+#endif
+}
+
+// The weight gradient has few output tiles and a reduction over every
+// pixel: split that reduction until about this many blocks are in flight,
+// keeping at least kMinSplitPixels pixels per split.
+constexpr int64_t kTargetBlocks = 256;
+constexpr int64_t kMinSplitPixels = 256;
+constexpr int64_t kMaxGridZ = 65535;
+
+int weight_splits(int64_t tiles, int64_t groups, int64_t pixels) {
+  int64_t splits = ceil_div(kTargetBlocks, tiles * groups);
+  splits = std::min(splits, ceil_div(pixels, kMinSplitPixels));
+  splits = std::min(splits, kMaxGridZ / groups);
+  return static_cast<int>(std::max<int64_t>(splits, 1));
+}
+
+enum class ConvKernel { MediumTile, LargeTile, SmallTile, Wmma };
+// Passes with fewer multiply-adds run the default kernel untimed.
+constexpr int64_t kMinTuneMacs = int64_t(1) << 24;
+
+const char* kernel_name(ConvKernel kernel) {
+  switch (kernel) {
+    case ConvKernel::MediumTile:
+      return "simt64x64";
+    case ConvKernel::LargeTile:
+      return "simt128x128";
+    case ConvKernel::SmallTile:
+      return "simt32x32";
+    case ConvKernel::Wmma:
+      return "wmma64x64";
+  }
+  return "unknown";
+}
+
+// With split_k the K range is split across blocks for this kernel's tile
+// count (weight_splits).
+template <typename Cfg, typename P>
+void launch_simt(const P& p, GemmDims d, bool split_k, cudaStream_t stream) {
+  if (split_k) {
+    d.splits = weight_splits(ceil_div(d.m, Cfg::BM) * ceil_div(d.n, Cfg::BN), d.groups, d.k);
+  }
+  dim3 grid(static_cast<unsigned>(ceil_div(d.m, Cfg::BM)),
+            static_cast<unsigned>(ceil_div(d.n, Cfg::BN)),
+            static_cast<unsigned>(d.groups * d.splits));
+  conv_simt_kernel<Cfg, P><<<grid, Cfg::kThreads, 0, stream>>>(p, d);
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+template <typename P>
+void launch_kernel(ConvKernel kernel, const P& p, GemmDims d, bool split_k,
+                   cudaStream_t stream) {
+  using T = typename P::Scalar;
+  switch (kernel) {
+    case ConvKernel::Wmma:
+      if constexpr (std::is_same_v<T, __half> || std::is_same_v<T, __nv_bfloat16>) {
+        if (split_k) {
+          d.splits = weight_splits(ceil_div(d.m, kWmmaBM) * ceil_div(d.n, kWmmaBN), d.groups,
+                                   d.k);
+        }
+        dim3 grid(static_cast<unsigned>(ceil_div(d.m, kWmmaBM)),
+                  static_cast<unsigned>(ceil_div(d.n, kWmmaBN)),
+                  static_cast<unsigned>(d.groups * d.splits));
+        conv_wmma_kernel<P><<<grid, kWmmaThreads, 0, stream>>>(p, d);
+        XFT_CUDA_KERNEL_LAUNCH_CHECK();
+        return;
+      }
+      break;
+    case ConvKernel::MediumTile:
+      launch_simt<MediumTile>(p, d, split_k, stream);
+      return;
+    case ConvKernel::LargeTile:
+      launch_simt<LargeTile>(p, d, split_k, stream);
+      return;
+    case ConvKernel::SmallTile:
+      launch_simt<SmallTile>(p, d, split_k, stream);
+      return;
+  }
+  XFT_FAIL("conv2d: no ", kernel_name(kernel), " kernel for this dtype");
+}
+
+// Runs one pass. The default kernel is the tensor-core one where the
+// device has it, else the medium tile; for large passes the others are
+// timed against it once per shape (core/autotune.h) and the winner kept.
+// `reset` runs before every launch, for passes that accumulate.
+template <typename P>
+void launch(const char* op, const P& p, const GemmDims& d, bool split_k, const ConvShape& s,
+            DType dtype, int device, cudaStream_t stream,
+            const std::function<void()>& reset = nullptr) {
+  using T = typename P::Scalar;
+  if (d.m == 0 || d.n == 0) return;
+  std::vector<ConvKernel> kernels;
+  if constexpr (std::is_same_v<T, __half> || std::is_same_v<T, __nv_bfloat16>) {
+    if (compute_capability(device) >= WmmaArch<T>::kMin) kernels.push_back(ConvKernel::Wmma);
+  }
+  for (ConvKernel k : {ConvKernel::MediumTile, ConvKernel::LargeTile, ConvKernel::SmallTile}) {
+    kernels.push_back(k);
+  }
+  const auto run = [&](ConvKernel kernel) {
+    if (reset) reset();
+    launch_kernel(kernel, p, d, split_k, stream);
+  };
+  int choice = 0;
+  if (d.m * d.n * d.k * d.groups >= kMinTuneMacs) {
+    std::vector<std::string> names;
+    for (ConvKernel k : kernels) names.push_back(kernel_name(k));
+    const std::string key = autotune::make_key(
+        autotune_arch(device), op, dtype,
+        {s.N, s.H, s.W, s.C, s.K, s.R, s.S, s.stride_h, s.stride_w, s.pad_h, s.pad_w,
+         s.dilation_h, s.dilation_w, s.groups});
+    std::function<double(int)> time;
+    if (can_time(stream)) {
+      time = [&](int i) { return time_on_stream(stream, [&] { run(kernels[i]); }); };
+    }
+    choice = autotune::select(key, names, time);
+  }
+  run(kernels[choice]);
+}
+
+void check_groups(const ConvShape& s) {
+  XFT_CHECK(s.groups <= kMaxGridZ, "conv2d: CUDA supports at most ", kMaxGridZ,
+            " groups, got ", s.groups);
+}
+
+}  // namespace
+
+void conv2d(const Tensor& x, const Tensor& w, const Tensor& bias, Tensor& y, const ConvShape& s) {
+  check_groups(s);
+  const int device = x.device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  const GemmDims d{s.N * s.OH * s.OW, s.K / s.groups, s.R * s.S * (s.C / s.groups), s.groups, 1};
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "conv2d", [&] {
+    using T = device_t<scalar_t>;
+    ForwardProblem<T> p{s, device_ptr<scalar_t>(x), device_ptr<scalar_t>(w),
+                        device_ptr_or_null<scalar_t>(bias), device_ptr<scalar_t>(y)};
+    launch("conv2d", p, d, false, s, x.dtype(), device, stream);
+  });
+}
+
+void conv2d_backward_input(const Tensor& dy, const Tensor& w, Tensor& dx, const ConvShape& s) {
+  check_groups(s);
+  const int device = dy.device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  const GemmDims d{s.N * s.H * s.W, s.C / s.groups, s.R * s.S * (s.K / s.groups), s.groups, 1};
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(dy.dtype(), "conv2d_backward", [&] {
+    using T = device_t<scalar_t>;
+    BackwardInputProblem<T> p{s, device_ptr<scalar_t>(dy), device_ptr<scalar_t>(w),
+                              device_ptr<scalar_t>(dx)};
+    launch("conv2d_backward_input", p, d, false, s, dy.dtype(), device, stream);
+  });
+}
+
+void conv2d_backward_weight(const Tensor& x, const Tensor& dy, Tensor& dw, const ConvShape& s) {
+  check_groups(s);
+  const int device = x.device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  const GemmDims d{s.R * s.S * (s.C / s.groups), s.K / s.groups, s.N * s.OH * s.OW, s.groups,
+                   1};
+  // Blocks add into an opmath-typed sum, zeroed before every launch; 16-bit
+  // results are rounded from it once at the end.
+  const bool reduced = is_reduced_floating(dw.dtype());
+  Tensor sum = reduced ? Tensor::empty(dw.sizes(), DType::Float32, dw.device()) : dw;
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "conv2d_backward", [&] {
+    using T = device_t<scalar_t>;
+    BackwardWeightProblem<T> p{s, device_ptr<scalar_t>(x), device_ptr<scalar_t>(dy),
+                               static_cast<opmath_t<T>*>(sum.data_ptr())};
+    launch("conv2d_backward_weight", p, d, true, s, x.dtype(), device, stream,
+           [&] { sum.fill_(0.0); });
+  });
+  if (reduced) dw.copy_(sum);
+}
+
+}  // namespace xft::cuda
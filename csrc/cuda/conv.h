@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core/tensor.h"
+#include "ops/conv.h"
+
+namespace xft::cuda {
+
+// The conv2d passes behind ops/conv.cpp as implicit GEMMs, on the current
+// stream of the inputs' device. Activations are dense channels-last
+// buffers (x [N, H, W, C], y and dy [N, OH, OW, K]); Cg = C / groups and
+// Kg = K / groups. 16-bit dtypes accumulate in float32, on tensor cores
+// (WMMA) where the device has them.
+//
+// y = conv(x, w) + bias, w being dense [R, S, Cg, K] and bias [K] or
+// undefined.
+void conv2d(const Tensor& x, const Tensor& w, const Tensor& bias, Tensor& y, const ConvShape& s);
+// dx from dy and w dense [R, S, K, Cg].
+void conv2d_backward_input(const Tensor& dy, const Tensor& w, Tensor& dx, const ConvShape& s);
+// dw, dense [R, S, Cg, K], from x and dy; the pixel sum is split across
+// blocks and combined with atomics.
+void conv2d_backward_weight(const Tensor& x, const Tensor& dy, Tensor& dw, const ConvShape& s);
+
+}  // namespace xft::cuda
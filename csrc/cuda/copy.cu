@@ -0,0 +1,180 @@
+#include "cuda/copy.h"
+
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/host_allocator.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr int kMaxDims = 8;
+
+// Maps a linear element index onto the element offsets of two strided
+// tensors sharing one shape.
+struct PairIndexer {
+  int ndim;
+  int64_t sizes[kMaxDims];
+  int64_t strides[2][kMaxDims];
+
+  __device__ void offsets(int64_t linear, int64_t& a, int64_t& b) const {
+    a = 0;
+    b = 0;
+    for (int d = ndim - 1; d >= 0; d--) {
+      const int64_t i = linear % sizes[d];
+      linear /= sizes[d];
+      a += i * strides[0][d];
+      b += i * strides[1][d];
+    }
+  }
+};
+
+PairIndexer make_indexer(const Shape& sizes, const Shape& a, const Shape& b) {
+  XFT_CHECK(sizes.size() <= kMaxDims, "cuda copy: at most ", kMaxDims, " dims are supported");
+  PairIndexer idx{};
+  idx.ndim = static_cast<int>(sizes.size());
+  for (int d = 0; d < idx.ndim; d++) {
+    idx.sizes[d] = sizes[d];
+    idx.strides[0][d] = a[d];
+    idx.strides[1][d] = b[d];
+  }
+  return idx;
+}
+
+template <typename dst_t, typename src_t>
+__global__ void strided_copy_kernel(dst_t* dst, const src_t* src, PairIndexer idx, int64_t n) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    int64_t d, s;
+    idx.offsets(i, d, s);
+    dst[d] = convert<dst_t>(src[s]);
+  }
+}
+
+template <typename T>
+__global__ void fill_kernel(T* out, PairIndexer idx, int64_t n, opmath_t<T> v) {
+  const T value = from_op<T>(v);
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    int64_t o, unused;
+    idx.offsets(i, o, unused);
+    out[o] = value;
+  }
+}
+
+// Both tensors on the same CUDA device; ordered on its current stream.
+void device_copy(const Tensor& dst, const Tensor& src) {
+  const int device = dst.device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  if (dst.dtype() == src.dtype() && dst.is_contiguous() && src.is_contiguous()) {
+    XFT_CUDA_CHECK(cudaMemcpyAsync(dst.data_ptr(), src.data_ptr(), dst.nbytes(),
+                                   cudaMemcpyDeviceToDevice, stream));
+    return;
+  }
+  const int64_t n = dst.numel();
+  PairIndexer idx = make_indexer(dst.sizes(), dst.strides(), src.strides());
+  XFT_DISPATCH_ALL_TYPES_AND_HALF(dst.dtype(), "copy_", [&] {
+    using dst_t = scalar_t;
+    XFT_DISPATCH_ALL_TYPES_AND_HALF(src.dtype(), "copy_", [&] {
+      strided_copy_kernel<device_t<dst_t>, device_t<scalar_t>>
+          <<<grid_size(n), kNumThreads, 0, stream>>>(device_ptr<dst_t>(dst),
+                                                     device_ptr<scalar_t>(src), idx, n);
+    });
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+// A dense tensor on src's device holding src's values as `dtype`; src itself
+// when it already is one.
+Tensor dense_on_device(const Tensor& src, DType dtype) {
+  if (src.dtype() == dtype && src.is_contiguous()) return src;
+  Tensor out = Tensor::empty(src.sizes(), dtype, src.device());
+  device_copy(out, src);
+  return out;
+}
+
+void host_to_device(const Tensor& dst, const Tensor& src, bool non_blocking) {
+  const int device = dst.device().index;
+  // Convert and compact on the host, then one bulk transfer.
+  Tensor host = src.to(dst.dtype()).contiguous();
+  if (non_blocking) host = pin_memory(host);
+  Tensor staged =
+      dst.is_contiguous() ? dst : Tensor::empty(dst.sizes(), dst.dtype(), dst.device());
+
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  XFT_CUDA_CHECK(cudaMemcpyAsync(staged.data_ptr(), host.data_ptr(), host.nbytes(),
+                                 cudaMemcpyHostToDevice, stream));
+  if (!dst.is_contiguous()) device_copy(dst, staged);
+  if (non_blocking) {
+    host_allocator()->record_stream(host.storage()->data(), device, stream);
+  } else {
+    XFT_CUDA_CHECK(cudaStreamSynchronize(stream));
+  }
+}
+
+void device_to_host(const Tensor& dst, const Tensor& src, bool non_blocking) {
+  const int device = src.device().index;
+  // Convert and compact on the device, then one bulk transfer.
+  Tensor dense = dense_on_device(src, dst.dtype());
+  const bool async = non_blocking && dst.is_contiguous() && is_pinned(dst);
+  Tensor staged = dst.is_contiguous() ? dst : Tensor::empty(dst.sizes(), dst.dtype());
+
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  XFT_CUDA_CHECK(cudaMemcpyAsync(staged.data_ptr(), dense.data_ptr(), dense.nbytes(),
+                                 cudaMemcpyDeviceToHost, stream));
+  if (async) {
+    host_allocator()->record_stream(dst.storage()->data(), device, stream);
+    return;
+  }
+  XFT_CUDA_CHECK(cudaStreamSynchronize(stream));
+  if (!dst.is_contiguous()) Tensor(dst).copy_(staged);
+}
+
+}  // namespace
+
+void copy_(const Tensor& dst, const Tensor& src, bool non_blocking) {
+  const Device dd = dst.device();
+  const Device sd = src.device();
+  if (dd.is_cuda() && sd.is_cpu()) {
+    host_to_device(dst, src, non_blocking);
+  } else if (dd.is_cpu() && sd.is_cuda()) {
+    device_to_host(dst, src, non_blocking);
+  } else if (dd == sd) {
+    device_copy(dst, src);
+  } else {
+    // Peer copy between two devices, ordered after pending work on the source.
+    Tensor dense = dense_on_device(src, dst.dtype());
+    Tensor staged =
+        dst.is_contiguous() ? dst : Tensor::empty(dst.sizes(), dst.dtype(), dd);
+    {
+      DeviceGuard guard(sd.index);
+      XFT_CUDA_CHECK(cudaStreamSynchronize(current_stream(sd.index)));
+    }
+    DeviceGuard guard(dd.index);
+    XFT_CUDA_CHECK(cudaMemcpyPeerAsync(staged.data_ptr(), dd.index, dense.data_ptr(), sd.index,
+                                       dense.nbytes(), current_stream(dd.index)));
+    if (!dst.is_contiguous()) device_copy(dst, staged);
+    if (!non_blocking) XFT_CUDA_CHECK(cudaStreamSynchronize(current_stream(dd.index)));
+  }
+}
+
+void fill_(const Tensor& t, double value) {
+  const int device = t.device().index;
+  DeviceGuard guard(device);
+  const int64_t n = t.numel();
+  if (n == 0) return;
+  PairIndexer idx = make_indexer(t.sizes(), t.strides(), t.strides());
+  cudaStream_t stream = current_stream(device);
+  XFT_DISPATCH_ALL_TYPES_AND_HALF(t.dtype(), "fill_", [&] {
+    using T = device_t<scalar_t>;
+    fill_kernel<T><<<grid_size(n), kNumThreads, 0, stream>>>(
+        device_ptr<scalar_t>(t), idx, n, static_cast<opmath_t<T>>(value));
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
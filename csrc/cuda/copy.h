@@ -0,0 +1,20 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+// Elementwise copy with dtype conversion where at least one side lives on a
+// CUDA device. Handles H2D, D2H, D2D and peer copies of any strides. All work
+// goes on the device's current stream; unless non_blocking, the call returns
+// only once the copy is complete.
+//
+// With non_blocking, host-to-device copies stage through the pinned pool
+// (unless the source is already pinned) and device-to-host copies are async
+// when the destination is pinned. Pinned blocks record the copy so they are
+// not recycled before it finishes.
+void copy_(const Tensor& dst, const Tensor& src, bool non_blocking = false);
+
+void fill_(const Tensor& t, double value);
+
+}  // namespace xft::cuda
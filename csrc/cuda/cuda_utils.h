@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cuda_runtime.h>
+
+#include "core/macros.h"
+
+#define XFT_CUDA_CHECK(expr)                                                     \
+  do {                                                                           \
+    cudaError_t err__ = (expr);                                                  \
+    XFT_CHECK(err__ == cudaSuccess, "CUDA error: ", cudaGetErrorString(err__), \
+              " in ", #expr);                                                    \
+  } while (0)
+
+// Checks the launch configuration of the kernel that was just enqueued.
+#define XFT_CUDA_KERNEL_LAUNCH_CHECK() XFT_CUDA_CHECK(cudaGetLastError())
+
+namespace xft::cuda {
+
+// Makes `device` current for the guard's lifetime.
+class DeviceGuard {
+ public:
+  explicit DeviceGuard(int device) {
+    XFT_CUDA_CHECK(cudaGetDevice(&prev_));
+    if (prev_ != device) XFT_CUDA_CHECK(cudaSetDevice(device));
+  }
+  ~DeviceGuard() { cudaSetDevice(prev_); }
+
+  DeviceGuard(const DeviceGuard&) = delete;
+  DeviceGuard& operator=(const DeviceGuard&) = delete;
+
+ private:
+  int prev_ = 0;
+};
+
+int device_count();
+
+// Both are called from kernels as well as from host launch code.
+__host__ __device__ inline int64_t ceil_div(int64_t a, int64_t b) { return (a + b - 1) / b; }
+
+// Elementwise kernels use grid-stride loops with this block size.
+constexpr int kNumThreads = 256;
+
+__host__ __device__ inline unsigned int grid_size(int64_t n) {
+  int64_t blocks = ceil_div(n, kNumThreads);
+  return static_cast<unsigned int>(blocks < 1 ? 1 : (blocks > 65535 ? 65535 : blocks));
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,85 @@
+#pragma once
+
+// Device-side views of the 16-bit dtypes. Dispatch binds scalar_t to the
+// host storage types in core/half.h; kernels take device_t<scalar_t> (the
+// CUDA types with the same bits) and do their arithmetic in opmath_t,
+// float for the 16-bit types, so only loads and stores see reduced
+// precision. Include from .cu files only.
+
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+#include <cuda_runtime.h>
+
+#include "core/half.h"
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+template <typename T>
+struct DeviceType {
+  using type = T;
+};
+template <>
+struct DeviceType<Half> {
+  using type = __half;
+};
+template <>
+struct DeviceType<BFloat16> {
+  using type = __nv_bfloat16;
+};
+template <typename T>
+using device_t = typename DeviceType<T>::type;
+
+template <typename T>
+struct OpMath {
+  using type = T;
+};
+template <>
+struct OpMath<__half> {
+  using type = float;
+};
+template <>
+struct OpMath<__nv_bfloat16> {
+  using type = float;
+};
+template <typename T>
+using opmath_t = typename OpMath<T>::type;
+
+// T -> opmath_t<T> and back; the identity for every other type.
+template <typename T>
+__device__ __forceinline__ T to_op(T v) {
+  return v;
+}
+__device__ __forceinline__ float to_op(__half v) { return __half2float(v); }
+__device__ __forceinline__ float to_op(__nv_bfloat16 v) { return __bfloat162float(v); }
+
+template <typename T>
+__device__ __forceinline__ T from_op(opmath_t<T> v) {
+  return v;
+}
+template <>
+__device__ __forceinline__ __half from_op<__half>(float v) {
+  return __float2half(v);
+}
+template <>
+__device__ __forceinline__ __nv_bfloat16 from_op<__nv_bfloat16>(float v) {
+  return __float2bfloat16(v);
+}
+
+// static_cast between any two element types, 16-bit ones going via float.
+template <typename To, typename From>
+__device__ __forceinline__ To convert(From v) {
+  return from_op<To>(static_cast<opmath_t<To>>(to_op(v)));
+}
+
+// Typed device pointers into a tensor whose dtype dispatched to T.
+template <typename T>
+device_t<T>* device_ptr(const Tensor& t) {
+  return static_cast<device_t<T>*>(t.data_ptr());
+}
+template <typename T>
+const device_t<T>* device_ptr_or_null(const Tensor& t) {
+  return t.defined() ? static_cast<const device_t<T>*>(t.data_ptr()) : nullptr;
+}
+
+}  // namespace xft::cuda
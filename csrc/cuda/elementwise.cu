@@ -0,0 +1,277 @@
+#include "cuda/elementwise.h"
+
+#include <type_traits>
+
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr int kMaxDims = 8;
+
+// Maps a linear element index onto the byte offsets of N operands over the
+// iterator's coalesced shape (innermost dim first).
+template <int N>
+struct OffsetCalc {
+  int ndim;
+  int64_t sizes[kMaxDims];
+  int64_t strides[N][kMaxDims];
+
+  __device__ void offsets(int64_t linear, int64_t (&out)[N]) const {
+    for (int k = 0; k < N; k++) out[k] = 0;
+    for (int d = 0; d < ndim; d++) {
+      const int64_t i = linear % sizes[d];
+      linear /= sizes[d];
+      for (int k = 0; k < N; k++) out[k] += i * strides[k][d];
+    }
+  }
+};
+
+template <int N>
+struct Pointers {
+  char* data[N];
+};
+
+template <int N>
+OffsetCalc<N> make_offset_calc(const TensorIterator& iter) {
+  XFT_CHECK(iter.ndim() <= kMaxDims, "cuda elementwise: at most ", kMaxDims,
+            " non-coalescable dims are supported");
+  OffsetCalc<N> calc{};
+  calc.ndim = iter.ndim();
+  for (int d = 0; d < calc.ndim; d++) {
+    calc.sizes[d] = iter.shape()[d];
+    for (int k = 0; k < N; k++) calc.strides[k][d] = iter.strides(k)[d];
+  }
+  return calc;
+}
+
+// kTrivial: a single dim, so offsets are linear * stride with no div/mod.
+// T is the storage type; f works on opmath_t<T>.
+template <bool kTrivial, typename T, typename F>
+__global__ void unary_kernel(Pointers<2> ptrs, OffsetCalc<2> calc, int64_t n, F f) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    int64_t off[2];
+    if (kTrivial) {
+      off[0] = i * calc.strides[0][0];
+      off[1] = i * calc.strides[1][0];
+    } else {
+      calc.offsets(i, off);
+    }
+    const auto x = to_op(*reinterpret_cast<const T*>(ptrs.data[1] + off[1]));
+    *reinterpret_cast<T*>(ptrs.data[0] + off[0]) = from_op<T>(f(x));
+  }
+}
+
+template <bool kTrivial, typename T, typename F>
+__global__ void binary_kernel(Pointers<3> ptrs, OffsetCalc<3> calc, int64_t n, F f) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    int64_t off[3];
+    if (kTrivial) {
+      off[0] = i * calc.strides[0][0];
+      off[1] = i * calc.strides[1][0];
+      off[2] = i * calc.strides[2][0];
+    } else {
+      calc.offsets(i, off);
+    }
+    const auto a = to_op(*reinterpret_cast<const T*>(ptrs.data[1] + off[1]));
+    const auto b = to_op(*reinterpret_cast<const T*>(ptrs.data[2] + off[2]));
+    *reinterpret_cast<T*>(ptrs.data[0] + off[0]) = from_op<T>(f(a, b));
+  }
+}
+
+// ---- functors ----
+
+__device__ inline float exp_(float x) { return expf(x); }
+__device__ inline double exp_(double x) { return ::exp(x); }
+__device__ inline float log_(float x) { return logf(x); }
+__device__ inline double log_(double x) { return ::log(x); }
+__device__ inline float sqrt_(float x) { return sqrtf(x); }
+__device__ inline double sqrt_(double x) { return ::sqrt(x); }
+__device__ inline float tanh_(float x) { return tanhf(x); }
+__device__ inline double tanh_(double x) { return ::tanh(x); }
+
+template <typename T>
+struct ExpFn {
+  __device__ T operator()(T x) const { return exp_(x); }
+};
+template <typename T>
+struct LogFn {
+  __device__ T operator()(T x) const { return log_(x); }
+};
+template <typename T>
+struct SqrtFn {
+  __device__ T operator()(T x) const { return sqrt_(x); }
+};
+template <typename T>
+struct TanhFn {
+  __device__ T operator()(T x) const { return tanh_(x); }
+};
+template <typename T>
+struct SigmoidFn {
+  __device__ T operator()(T x) const { return T(1) / (T(1) + exp_(-x)); }
+};
+template <typename T>
+struct ReluFn {
+  __device__ T operator()(T x) const { return x > T(0) ? x : T(0); }
+};
+// Tanh approximation, matching the CPU kernels.
+template <typename T>
+struct GeluFn {
+  __device__ T operator()(T x) const {
+    const T k = T(0.7978845608028654);  // sqrt(2 / pi)
+    return T(0.5) * x * (T(1) + tanh_(k * (x + T(0.044715) * x * x * x)));
+  }
+};
+
+template <typename T>
+struct AddFn {
+  __device__ T operator()(T a, T b) const { return a + b; }
+};
+template <typename T>
+struct SubFn {
+  __device__ T operator()(T a, T b) const { return a - b; }
+};
+template <typename T>
+struct MulFn {
+  __device__ T operator()(T a, T b) const { return a * b; }
+};
+template <typename T>
+struct DivFn {
+  __device__ T operator()(T a, T b) const { return a / b; }
+};
+// NaN-propagating, like the CPU kernels; x != x is false for integers.
+template <typename T>
+struct MaximumFn {
+  __device__ T operator()(T a, T b) const { return a != a ? a : (b != b ? b : (a > b ? a : b)); }
+};
+template <typename T>
+struct MinimumFn {
+  __device__ T operator()(T a, T b) const { return a != a ? a : (b != b ? b : (a < b ? a : b)); }
+};
+
+template <typename T>
+struct GeMaskFn {
+  __device__ T operator()(T a, T b) const { return a >= b ? T(1) : T(0); }
+};
+template <typename T>
+struct EqMaskFn {
+  __device__ T operator()(T a, T b) const { return a == b ? T(1) : T(0); }
+};
+
+// (grad, saved) -> grad * f'(x); see BinaryOp in ops/op_kinds.h.
+template <typename T>
+struct ReluBackwardFn {
+  __device__ T operator()(T g, T y) const { return y > T(0) ? g : T(0); }
+};
+template <typename T>
+struct SigmoidBackwardFn {
+  __device__ T operator()(T g, T y) const { return g * y * (T(1) - y); }
+};
+template <typename T>
+struct TanhBackwardFn {
+  __device__ T operator()(T g, T y) const { return g * (T(1) - y * y); }
+};
+template <typename T>
+struct GeluBackwardFn {
+  __device__ T operator()(T g, T x) const {
+    const T k = T(0.7978845608028654);
+    const T t = tanh_(k * (x + T(0.044715) * x * x * x));
+    const T du = k * (T(1) + T(0.134145) * x * x);
+    return g * (T(0.5) * (T(1) + t) + T(0.5) * x * (T(1) - t * t) * du);
+  }
+};
+
+template <typename T, typename F>
+void launch_unary(const TensorIterator& iter, F f) {
+  const int64_t n = iter.numel();
+  Pointers<2> ptrs{{iter.data(0), iter.data(1)}};
+  OffsetCalc<2> calc = make_offset_calc<2>(iter);
+  cudaStream_t stream = current_stream(iter.device().index);
+  if (iter.is_trivial_1d()) {
+    unary_kernel<true, T><<<grid_size(n), kNumThreads, 0, stream>>>(ptrs, calc, n, f);
+  } else {
+    unary_kernel<false, T><<<grid_size(n), kNumThreads, 0, stream>>>(ptrs, calc, n, f);
+  }
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+template <typename T, typename F>
+void launch_binary(const TensorIterator& iter, F f) {
+  const int64_t n = iter.numel();
+  Pointers<3> ptrs{{iter.data(0), iter.data(1), iter.data(2)}};
+  OffsetCalc<3> calc = make_offset_calc<3>(iter);
+  cudaStream_t stream = current_stream(iter.device().index);
+  if (iter.is_trivial_1d()) {
+    binary_kernel<true, T><<<grid_size(n), kNumThreads, 0, stream>>>(ptrs, calc, n, f);
+  } else {
+    binary_kernel<false, T><<<grid_size(n), kNumThreads, 0, stream>>>(ptrs, calc, n, f);
+  }
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+// The functor of each op, computing in C.
+template <UnaryOp kOp, typename C>
+auto unary_functor() {
+  if constexpr (kOp == UnaryOp::Exp) return ExpFn<C>{};
+  if constexpr (kOp == UnaryOp::Log) return LogFn<C>{};
+  if constexpr (kOp == UnaryOp::Sqrt) return SqrtFn<C>{};
+  if constexpr (kOp == UnaryOp::Tanh) return TanhFn<C>{};
+  if constexpr (kOp == UnaryOp::Sigmoid) return SigmoidFn<C>{};
+  if constexpr (kOp == UnaryOp::Relu) return ReluFn<C>{};
+  if constexpr (kOp == UnaryOp::Gelu) return GeluFn<C>{};
+}
+
+template <BinaryOp kOp, typename C>
+auto binary_functor() {
+  if constexpr (kOp == BinaryOp::Add) return AddFn<C>{};
+  if constexpr (kOp == BinaryOp::Sub) return SubFn<C>{};
+  if constexpr (kOp == BinaryOp::Mul) return MulFn<C>{};
+  if constexpr (kOp == BinaryOp::Div) return DivFn<C>{};
+  if constexpr (kOp == BinaryOp::Maximum) return MaximumFn<C>{};
+  if constexpr (kOp == BinaryOp::Minimum) return MinimumFn<C>{};
+  if constexpr (kOp == BinaryOp::GeMask) return GeMaskFn<C>{};
+  if constexpr (kOp == BinaryOp::EqMask) return EqMaskFn<C>{};
+  if constexpr (kOp == BinaryOp::ReluBackward) return ReluBackwardFn<C>{};
+  if constexpr (kOp == BinaryOp::SigmoidBackward) return SigmoidBackwardFn<C>{};
+  if constexpr (kOp == BinaryOp::TanhBackward) return TanhBackwardFn<C>{};
+  if constexpr (kOp == BinaryOp::GeluBackward) return GeluBackwardFn<C>{};
+}
+
+// The table's kernels. T is the host element type the table is keyed by;
+// device_t<T> has the same bits.
+template <auto kOp, typename T>
+struct UnaryKernelFor {
+  static void run(const TensorIterator& iter) {
+    using D = device_t<T>;
+    if (iter.numel() == 0) return;
+    DeviceGuard guard(iter.device().index);
+    launch_unary<D>(iter, unary_functor<kOp, opmath_t<D>>());
+  }
+};
+
+template <auto kOp, typename T>
+struct BinaryKernelFor {
+  static void run(const TensorIterator& iter) {
+    using D = device_t<T>;
+    if (iter.numel() == 0) return;
+    DeviceGuard guard(iter.device().index);
+    launch_binary<D>(iter, binary_functor<kOp, opmath_t<D>>());
+  }
+};
+
+}  // namespace
+
+void register_elementwise(ElementwiseKernels& t) {
+  // xft::DeviceType: this namespace has a DeviceType<T> of its own.
+  constexpr auto kCuda = xft::DeviceType::CUDA;
+  register_kernels<UnaryKernelFor>(t.unary, kCuda, UnaryOps(), FloatingTypes());
+  register_kernels<BinaryKernelFor>(t.binary, kCuda, ArithmeticOps(), NumericTypes());
+  register_kernels<BinaryKernelFor>(t.binary, kCuda, BackwardOps(), FloatingTypes());
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "core/dispatch.h"
+
+namespace xft::cuda {
+
+// Fills the CUDA slots of the elementwise table. The kernels read operands
+// through the iterator's coalesced strides, so broadcast and non-contiguous
+// inputs need no copies.
+void register_elementwise(ElementwiseKernels& table);
+
+}  // namespace xft::cuda
@@ -0,0 +1,144 @@
+#include "cuda/fused.h"
+
+#include "core/philox.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// Tanh approximation, matching GeluFn in elementwise.cu and the CPU kernels.
+template <typename T>
+__device__ inline T gelu(T x) {
+  const T k = T(0.7978845608028654);  // sqrt(2 / pi)
+  return T(0.5) * x * (T(1) + tanh_(k * (x + T(0.044715) * x * x * x)));
+}
+
+template <typename T>
+__device__ inline T gelu_grad(T x) {
+  const T k = T(0.7978845608028654);
+  const T t = tanh_(k * (x + T(0.044715) * x * x * x));
+  const T du = k * (T(1) + T(0.134145) * x * x);
+  return T(0.5) * (T(1) + t) + T(0.5) * x * (T(1) - t * t) * du;
+}
+
+// T is the storage type; the math runs in opmath_t<T>.
+template <typename T>
+__global__ void bias_gelu_kernel(const T* x, const T* bias, T* y, int64_t n, int64_t cols) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    y[i] = from_op<T>(gelu(to_op(x[i]) + to_op(bias[i % cols])));
+  }
+}
+
+template <typename T>
+__global__ void bias_gelu_backward_kernel(const T* dy, const T* x, const T* bias, T* dx,
+                                          int64_t n, int64_t cols) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    dx[i] = from_op<T>(to_op(dy[i]) * gelu_grad(to_op(x[i]) + to_op(bias[i % cols])));
+  }
+}
+
+// One thread per Philox block, so element i sees the same random word as
+// in the CPU kernel and in random_fill.
+template <typename T>
+__global__ void dropout_add_kernel(const T* x, const T* bias, const T* residual, T* y, int64_t n,
+                                   int64_t cols, opmath_t<T> keep, opmath_t<T> scale,
+                                   uint64_t seed, uint64_t offset,
+                                   const uint64_t* graph_base) {
+  philox_resolve(graph_base, seed, offset);
+  using A = opmath_t<T>;
+  constexpr int kPer = kPhiloxPerBlock<A>;
+  const bool drop = keep < A(1);
+  const int64_t blocks = (n + kPer - 1) / kPer;
+  for (int64_t blk = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; blk < blocks;
+       blk += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    A u[kPer] = {};
+    if (drop) philox_uniform(philox(seed, offset + blk), u);
+    const int64_t base = blk * kPer;
+#pragma unroll
+    for (int i = 0; i < kPer; i++) {
+      const int64_t idx = base + i;
+      if (idx >= n) break;
+      A v = to_op(x[idx]);
+      if (bias != nullptr) v += to_op(bias[idx % cols]);
+      v = !drop || u[i] < keep ? v * scale : A(0);
+      y[idx] = from_op<T>(residual != nullptr ? to_op(residual[idx]) + v : v);
+    }
+  }
+}
+
+template <typename T>
+struct ColumnTerm {
+  const T* in;
+  int64_t cols;
+  __device__ opmath_t<T> operator()(int64_t r, int64_t c) const { return to_op(in[r * cols + c]); }
+};
+
+template <typename T>
+const T* ptr(const Tensor& t) {
+  return t.defined() ? static_cast<const T*>(t.data_ptr()) : nullptr;
+}
+
+}  // namespace
+
+void bias_gelu(const Tensor& x, const Tensor& bias, Tensor& y, int64_t rows, int64_t cols) {
+  const int64_t n = rows * cols;
+  if (n == 0) return;
+  DeviceGuard guard(x.device().index);
+  cudaStream_t stream = current_stream(x.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "bias_gelu", [&] {
+    using T = device_t<scalar_t>;
+    bias_gelu_kernel<T><<<grid_size(n), kNumThreads, 0, stream>>>(
+        ptr<T>(x), ptr<T>(bias), device_ptr<scalar_t>(y), n, cols);
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void bias_gelu_backward(const Tensor& dy, const Tensor& x, const Tensor& bias, Tensor& dx,
+                        int64_t rows, int64_t cols) {
+  const int64_t n = rows * cols;
+  if (n == 0) return;
+  DeviceGuard guard(x.device().index);
+  cudaStream_t stream = current_stream(x.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "bias_gelu_backward", [&] {
+    using T = device_t<scalar_t>;
+    bias_gelu_backward_kernel<T><<<grid_size(n), kNumThreads, 0, stream>>>(
+        ptr<T>(dy), ptr<T>(x), ptr<T>(bias), device_ptr<scalar_t>(dx), n, cols);
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void dropout_add(const Tensor& x, const Tensor& bias, const Tensor& residual, Tensor& y,
+                 int64_t cols, double keep, double scale, GeneratorState rng) {
+  const int64_t n = x.numel();
+  if (n == 0) return;
+  DeviceGuard guard(x.device().index);
+  cudaStream_t stream = current_stream(x.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "dropout_add", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    const int64_t blocks = ceil_div(n, kPhiloxPerBlock<A>);
+    dropout_add_kernel<T><<<grid_size(blocks), kNumThreads, 0, stream>>>(
+        ptr<T>(x), ptr<T>(bias), ptr<T>(residual), device_ptr<scalar_t>(y), n, cols,
+        static_cast<A>(keep), static_cast<A>(scale), rng.seed, rng.offset,
+        rng.graph_base);
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void column_sum(const Tensor& in, Tensor& out, int64_t rows, int64_t cols) {
+  if (cols == 0) return;
+  DeviceGuard guard(in.device().index);
+  cudaStream_t stream = current_stream(in.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(in.dtype(), "column_sum", [&] {
+    using T = device_t<scalar_t>;
+    launch_col_sum(ColumnTerm<T>{ptr<T>(in), cols}, device_ptr<scalar_t>(out), in.dtype(),
+                   in.device(), rows, cols, stream);
+  });
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/generator.h"
+#include "core/tensor.h"
+#include "ops/op_kinds.h"
+
+namespace xft::cuda {
+
+// Fused row kernels behind ops/reduce.cpp and ops/fused.cpp, on the current
+// stream of the tensors' device. Every tensor is dense; row kernels see x
+// as [rows, cols] and weight / bias as [cols], either undefined when absent.
+
+// Sum or max of `in` viewed as [outer, r, inner] along r into the dense
+// [outer, inner] `out`: int64 for integer sums, in's dtype otherwise. The
+// launch shape is picked per shape and sm_XX by core/autotune.h.
+void reduce(ReduceOp op, const Tensor& in, Tensor& out, int64_t outer, int64_t r, int64_t inner);
+
+// Softmax of `in` viewed as [outer, r, inner] along r, and its backward
+// given the forward output.
+void softmax(const Tensor& in, Tensor& out, int64_t outer, int64_t r, int64_t inner);
+void softmax_backward(const Tensor& grad, const Tensor& out, Tensor& grad_in, int64_t outer,
+                      int64_t r, int64_t inner);
+
+// mean is undefined (and ignored) when rms.
+void layer_norm(bool rms, const Tensor& x, const Tensor& weight, const Tensor& bias, double eps,
+                Tensor& y, Tensor& mean, Tensor& rstd, int64_t rows, int64_t cols);
+// Writes dweight / dbias when defined (not accumulating).
+void layer_norm_backward(bool rms, const Tensor& dy, const Tensor& x, const Tensor& mean,
+                         const Tensor& rstd, const Tensor& weight, Tensor& dx, Tensor& dweight,
+                         Tensor& dbias, int64_t rows, int64_t cols);
+
+void bias_gelu(const Tensor& x, const Tensor& bias, Tensor& y, int64_t rows, int64_t cols);
+void bias_gelu_backward(const Tensor& dy, const Tensor& x, const Tensor& bias, Tensor& dx,
+                        int64_t rows, int64_t cols);
+
+// y = residual + mask * (x + bias), the mask drawn from Philox at rng
+// element for element like the CPU kernel; residual may be undefined.
+void dropout_add(const Tensor& x, const Tensor& bias, const Tensor& residual, Tensor& y,
+                 int64_t cols, double keep, double scale, GeneratorState rng);
+
+// out[c] = sum over rows of in[r, c].
+void column_sum(const Tensor& in, Tensor& out, int64_t rows, int64_t cols);
+
+}  // namespace xft::cuda
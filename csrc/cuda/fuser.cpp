@@ -0,0 +1,303 @@
+#include "cuda/fuser.h"
+
+#include <cuda.h>
+#include <nvrtc.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cuda/cuda_utils.h"
+#include "cuda/stream.h"
+
+#define XFT_NVRTC_CHECK(expr)                                                 \
+  do {                                                                        \
+    nvrtcResult result__ = (expr);                                            \
+    XFT_CHECK(result__ == NVRTC_SUCCESS, "NVRTC error: ",                     \
+              nvrtcGetErrorString(result__), " in ", #expr);                  \
+  } while (0)
+
+#define XFT_CU_CHECK(expr)                                                     \
+  do {                                                                         \
+    CUresult result__ = (expr);                                                \
+    const char* msg__ = nullptr;                                               \
+    if (result__ != CUDA_SUCCESS) cuGetErrorString(result__, &msg__);          \
+    XFT_CHECK(result__ == CUDA_SUCCESS, "CUDA driver error: ",                 \
+              msg__ != nullptr ? msg__ : "unknown", " in ", #expr);            \
+  } while (0)
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr int kMaxDims = 8;
+constexpr int kMaxArgs = TensorIterator::kMaxOperands;
+
+// Kernel arguments. The generated source declares the same struct.
+struct Params {
+  char* data[kMaxArgs];
+  int64_t n;
+  int32_t ndim;
+  int64_t sizes[kMaxDims];
+  int64_t strides[kMaxArgs][kMaxDims];
+};
+
+// Everything a generated kernel needs, with no headers: NVRTC does not see
+// the CUDA toolkit includes by default. The op functions match the functors
+// in cuda/elementwise.cu; 16-bit values are widened to float on load.
+const char* kPrelude = R"(
+typedef long long int64_t;
+typedef int int32_t;
+
+struct Params {
+  char* data[8];
+  int64_t n;
+  int32_t ndim;
+  int64_t sizes[8];
+  int64_t strides[8][8];
+};
+
+__device__ inline float load_f32(const char* p) { return *(const float*)p; }
+__device__ inline void store_f32(char* p, float v) { *(float*)p = v; }
+__device__ inline double load_f64(const char* p) { return *(const double*)p; }
+__device__ inline void store_f64(char* p, double v) { *(double*)p = v; }
+__device__ inline float load_f16(const char* p) {
+  float v;
+  asm("cvt.f32.f16 %0, %1;" : "=f"(v) : "h"(*(const unsigned short*)p));
+  return v;
+}
+__device__ inline void store_f16(char* p, float v) {
+  unsigned short bits;
+  asm("cvt.rn.f16.f32 %0, %1;" : "=h"(bits) : "f"(v));
+  *(unsigned short*)p = bits;
+}
+__device__ inline float load_bf16(const char* p) {
+  return __uint_as_float((unsigned int)(*(const unsigned short*)p) << 16);
+}
+__device__ inline void store_bf16(char* p, float v) {
+  unsigned int u = __float_as_uint(v);
+  // Round to nearest even; NaN stays a quiet NaN.
+  u = v != v ? 0x7fc00000u : u + 0x7fffu + ((u >> 16) & 1u);
+  *(unsigned short*)p = (unsigned short)(u >> 16);
+}
+
+__device__ inline float exp_(float x) { return expf(x); }
+__device__ inline double exp_(double x) { return exp(x); }
+__device__ inline float log_(float x) { return logf(x); }
+__device__ inline double log_(double x) { return log(x); }
+__device__ inline float sqrt_(float x) { return sqrtf(x); }
+__device__ inline double sqrt_(double x) { return sqrt(x); }
+__device__ inline float tanh_(float x) { return tanhf(x); }
+__device__ inline double tanh_(double x) { return tanh(x); }
+
+template <typename T> __device__ inline T op_exp(T x) { return exp_(x); }
+template <typename T> __device__ inline T op_log(T x) { return log_(x); }
+template <typename T> __device__ inline T op_sqrt(T x) { return sqrt_(x); }
+template <typename T> __device__ inline T op_tanh(T x) { return tanh_(x); }
+template <typename T> __device__ inline T op_sigmoid(T x) { return T(1) / (T(1) + exp_(-x)); }
+template <typename T> __device__ inline T op_relu(T x) { return x > T(0) ? x : T(0); }
+template <typename T> __device__ inline T op_gelu(T x) {
+  const T k = T(0.7978845608028654);
+  return T(0.5) * x * (T(1) + tanh_(k * (x + T(0.044715) * x * x * x)));
+}
+
+template <typename T> __device__ inline T op_add(T a, T b) { return a + b; }
+template <typename T> __device__ inline T op_sub(T a, T b) { return a - b; }
+template <typename T> __device__ inline T op_mul(T a, T b) { return a * b; }
+template <typename T> __device__ inline T op_div(T a, T b) { return a / b; }
+template <typename T> __device__ inline T op_maximum(T a, T b) {
+  return a != a ? a : (b != b ? b : (a > b ? a : b));
+}
+template <typename T> __device__ inline T op_minimum(T a, T b) {
+  return a != a ? a : (b != b ? b : (a < b ? a : b));
+}
+template <typename T> __device__ inline T op_ge_mask(T a, T b) { return a >= b ? T(1) : T(0); }
+template <typename T> __device__ inline T op_eq_mask(T a, T b) { return a == b ? T(1) : T(0); }
+template <typename T> __device__ inline T op_relu_backward(T g, T y) { return y > T(0) ? g : T(0); }
+template <typename T> __device__ inline T op_sigmoid_backward(T g, T y) {
+  return g * y * (T(1) - y);
+}
+template <typename T> __device__ inline T op_tanh_backward(T g, T y) { return g * (T(1) - y * y); }
+template <typename T> __device__ inline T op_gelu_backward(T g, T x) {
+  const T k = T(0.7978845608028654);
+  const T t = tanh_(k * (x + T(0.044715) * x * x * x));
+  const T du = k * (T(1) + T(0.134145) * x * x);
+  return g * (T(0.5) * (T(1) + t) + T(0.5) * x * (T(1) - t * t) * du);
+}
+)";
+
+const char* unary_name(UnaryOp op) {
+  switch (op) {
+    case UnaryOp::Exp: return "op_exp";
+    case UnaryOp::Log: return "op_log";
+    case UnaryOp::Sqrt: return "op_sqrt";
+    case UnaryOp::Tanh: return "op_tanh";
+    case UnaryOp::Sigmoid: return "op_sigmoid";
+    case UnaryOp::Relu: return "op_relu";
+    case UnaryOp::Gelu: return "op_gelu";
+  }
+  XFT_FAIL("fuser: unknown unary op");
+}
+
+const char* binary_name(BinaryOp op) {
+  switch (op) {
+    case BinaryOp::Add: return "op_add";
+    case BinaryOp::Sub: return "op_sub";
+    case BinaryOp::Mul: return "op_mul";
+    case BinaryOp::Div: return "op_div";
+    case BinaryOp::Maximum: return "op_maximum";
+    case BinaryOp::Minimum: return "op_minimum";
+    case BinaryOp::GeMask: return "op_ge_mask";
+    case BinaryOp::EqMask: return "op_eq_mask";
+    case BinaryOp::ReluBackward: return "op_relu_backward";
+    case BinaryOp::SigmoidBackward: return "op_sigmoid_backward";
+    case BinaryOp::TanhBackward: return "op_tanh_backward";
+    case BinaryOp::GeluBackward: return "op_gelu_backward";
+  }
+  XFT_FAIL("fuser: unknown binary op");
+}
+
+// Suffix of the load_/store_ helpers and the type arithmetic is done in.
+const char* storage_suffix(DType dtype) {
+  switch (dtype) {
+    case DType::Float32: return "f32";
+    case DType::Float64: return "f64";
+    case DType::Float16: return "f16";
+    case DType::BFloat16: return "bf16";
+    default: XFT_FAIL("fuser: unsupported dtype ", dtype_name(dtype));
+  }
+}
+
+// One thread per element, grid-stride like the eager kernels. Inputs are
+// loaded once into registers and scratch slots become local variables.
+std::string generate(const lazy::Program& p) {
+  const std::string acc = p.dtype == DType::Float64 ? "double" : "float";
+  const std::string sfx = storage_suffix(p.dtype);
+  const int nargs = static_cast<int>(p.inputs.size()) + 1;
+  std::string s = kPrelude;
+  s += "\nextern \"C\" __global__ void xft_fused(Params p) {\n";
+  s += "  for (int64_t i = blockIdx.x * (int64_t)blockDim.x + threadIdx.x; i < p.n;\n";
+  s += "       i += (int64_t)blockDim.x * gridDim.x) {\n";
+  s += "    int64_t off[" + std::to_string(nargs) + "] = {0};\n";
+  s += "    int64_t linear = i;\n";
+  s += "    for (int d = 0; d < p.ndim; d++) {\n";
+  s += "      const int64_t k = linear % p.sizes[d];\n";
+  s += "      linear /= p.sizes[d];\n";
+  s += "      for (int a = 0; a < " + std::to_string(nargs) + "; a++) "
+       "off[a] += k * p.strides[a][d];\n";
+  s += "    }\n";
+  for (int k = 1; k < nargs; k++) {
+    const std::string ks = std::to_string(k);
+    s += "    const " + acc + " in" + std::to_string(k - 1) + " = load_" + sfx + "(p.data[" + ks +
+         "] + off[" + ks + "]);\n";
+  }
+  if (p.num_slots > 0) {
+    s += "    " + acc + " s0";
+    for (int k = 1; k < p.num_slots; k++) s += ", s" + std::to_string(k);
+    s += ";\n";
+  }
+  auto operand = [](const lazy::Program::Operand& o) {
+    return (o.input ? "in" : "s") + std::to_string(o.index);
+  };
+  for (size_t i = 0; i < p.code.size(); i++) {
+    const lazy::Program::Instr& ins = p.code[i];
+    std::string expr = ins.binary ? std::string(binary_name(ins.binary_op)) + "<" + acc + ">(" +
+                                        operand(ins.a) + ", " + operand(ins.b) + ")"
+                                  : std::string(unary_name(ins.unary)) + "<" + acc + ">(" +
+                                        operand(ins.a) + ")";
+    if (i + 1 == p.code.size()) {
+      s += "    store_" + sfx + "(p.data[0] + off[0], " + expr + ");\n";
+    } else {
+      s += "    s" + std::to_string(ins.slot) + " = " + expr + ";\n";
+    }
+  }
+  s += "  }\n}\n";
+  return s;
+}
+
+CUfunction compile(const std::string& source, int device) {
+  int major = 0, minor = 0;
+  XFT_CUDA_CHECK(cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, device));
+  XFT_CUDA_CHECK(cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor, device));
+  const std::string arch = "--gpu-architecture=compute_" + std::to_string(major * 10 + minor);
+  const char* options[] = {arch.c_str(), "--std=c++17"};
+
+  nvrtcProgram prog;
+  XFT_NVRTC_CHECK(nvrtcCreateProgram(&prog, source.c_str(), "xft_fused.cu", 0, nullptr, nullptr));
+  const nvrtcResult result = nvrtcCompileProgram(prog, 2, options);
+  if (result != NVRTC_SUCCESS) {
+    size_t size = 0;
+    nvrtcGetProgramLogSize(prog, &size);
+    std::string log(size, '\0');
+    nvrtcGetProgramLog(prog, log.data());
+    nvrtcDestroyProgram(&prog);
+    XFT_FAIL("fuser: NVRTC failed to compile a fused kernel: ", nvrtcGetErrorString(result),
+             "\n", log);
+  }
+  size_t size = 0;
+  XFT_NVRTC_CHECK(nvrtcGetPTXSize(prog, &size));
+  std::vector<char> ptx(size);
+  XFT_NVRTC_CHECK(nvrtcGetPTX(prog, ptx.data()));
+  XFT_NVRTC_CHECK(nvrtcDestroyProgram(&prog));
+
+  // The driver API needs a current context; the runtime creates the
+  // primary one lazily.
+  CUcontext ctx = nullptr;
+  XFT_CU_CHECK(cuCtxGetCurrent(&ctx));
+  if (ctx == nullptr) XFT_CUDA_CHECK(cudaFree(nullptr));
+  CUmodule module;
+  CUfunction fn;
+  XFT_CU_CHECK(cuModuleLoadData(&module, ptx.data()));
+  XFT_CU_CHECK(cuModuleGetFunction(&fn, module, "xft_fused"));
+  return fn;
+}
+
+// Modules stay loaded for the life of the process, like cuBLAS handles.
+struct KernelCache {
+  std::mutex mutex;
+  std::unordered_map<std::string, CUfunction> kernels;
+};
+
+KernelCache& kernel_cache() {
+  static KernelCache* cache = new KernelCache();
+  return *cache;
+}
+
+CUfunction get_kernel(const lazy::Program& p, int device) {
+  const std::string key = std::to_string(device) + "/" + p.signature();
+  KernelCache& cache = kernel_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  auto it = cache.kernels.find(key);
+  lazy::count_kernel_lookup(it == cache.kernels.end());
+  if (it != cache.kernels.end()) return it->second;
+  CUfunction fn = compile(generate(p), device);
+  cache.kernels.emplace(key, fn);
+  return fn;
+}
+
+}  // namespace
+
+bool run_fused(const lazy::Program& program, const TensorIterator& iter) {
+  if (iter.ndim() > kMaxDims) return false;
+  const int device = iter.device().index;
+  DeviceGuard guard(device);
+  CUfunction fn = get_kernel(program, device);
+
+  Params params{};
+  params.n = iter.numel();
+  params.ndim = iter.ndim();
+  const int nargs = static_cast<int>(program.inputs.size()) + 1;
+  for (int k = 0; k < nargs; k++) params.data[k] = iter.data(k);
+  for (int d = 0; d < params.ndim; d++) {
+    params.sizes[d] = iter.shape()[d];
+    for (int k = 0; k < nargs; k++) params.strides[k][d] = iter.strides(k)[d];
+  }
+  void* args[] = {&params};
+  auto stream = reinterpret_cast<CUstream>(current_stream(device));
+  XFT_CU_CHECK(cuLaunchKernel(fn, grid_size(params.n), 1, 1, kNumThreads, 1, 1, 0, stream, args,
+                              nullptr));
+  return true;
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "core/tensor_iterator.h"
+#include "lazy/ir.h"
+
+namespace xft::cuda {
+
+// Runs a lowered lazy program as a single generated kernel over `iter`
+// (operand 0 the output, then the program's inputs), on the current stream
+// of the iterator's device. Kernels are compiled with NVRTC on first use
+// and cached per device by the program's signature, for any shape and
+// strides. Returns false when the iterator has more dims than the kernel
+// supports; the caller then runs the program another way.
+bool run_fused(const lazy::Program& program, const TensorIterator& iter);
+
+}  // namespace xft::cuda
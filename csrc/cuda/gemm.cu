@@ -0,0 +1,517 @@
+#include "cuda/gemm.h"
+
+#include <mma.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "core/autotune.h"
+#include "cuda/autotune.h"
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/stream.h"
+
+#ifdef XFT_USE_CUBLAS
+#include "cuda/blas.h"
+#endif
+
+namespace xft::cuda {
+
+namespace {
+
+// Row-major batched GEMM operands with explicit element strides, so views
+// never need a contiguous() copy before the kernel.
+template <typename T, typename AccT>
+struct GemmParams {
+  const T* a;
+  const T* b;
+  T* c;
+  int64_t batch, m, n, k;
+  int64_t a_batch, a_row, a_col;
+  int64_t b_batch, b_row, b_col;
+  int64_t c_batch, c_row, c_col;
+  AccT alpha, beta;
+};
+
+template <typename T, typename AccT>
+GemmParams<T, AccT> make_params(const Tensor& a, const Tensor& b, const Tensor& out) {
+  GemmParams<T, AccT> p;
+  p.a = static_cast<const T*>(a.data_ptr());
+  p.b = static_cast<const T*>(b.data_ptr());
+  p.c = static_cast<T*>(out.data_ptr());
+  p.batch = a.size(0);
+  p.m = a.size(1);
+  p.n = b.size(2);
+  p.k = a.size(2);
+  p.a_batch = a.stride(0), p.a_row = a.stride(1), p.a_col = a.stride(2);
+  p.b_batch = b.stride(0), p.b_row = b.stride(1), p.b_col = b.stride(2);
+  p.c_batch = out.stride(0), p.c_row = out.stride(1), p.c_col = out.stride(2);
+  p.alpha = AccT(1);
+  p.beta = AccT(0);
+  return p;
+}
+
+// ---------------------------------------------------------------------------
+// SIMT kernel (fp32 / fp64, and fp16 / bf16 with fp32 accumulation where
+// tensor cores are missing).
+//
+// Each block computes a BM x BN tile of C, looping over K in BK slabs. A and
+// B slabs are staged through double-buffered shared memory: the next slab is
+// fetched from global memory into registers while the current one is being
+// multiplied, then written to the other buffer, so one __syncthreads per slab
+// suffices. Every thread owns a TM x TN register tile of the accumulator.
+// ---------------------------------------------------------------------------
+
+template <int BM_, int BN_, int BK_, int TM_, int TN_>
+struct SimtConfig {
+  static constexpr int BM = BM_, BN = BN_, BK = BK_, TM = TM_, TN = TN_;
+  static constexpr int kThreads = (BM / TM) * (BN / TN);
+  static constexpr int kALoads = BM * BK / kThreads;
+  static constexpr int kBLoads = BK * BN / kThreads;
+  static_assert(BM * BK % kThreads == 0 && BK * BN % kThreads == 0, "tile/thread mismatch");
+};
+
+using LargeTile = SimtConfig<128, 128, 8, 8, 8>;
+using MediumTile = SimtConfig<64, 64, 8, 4, 4>;
+using SmallTile = SimtConfig<32, 32, 8, 2, 2>;
+
+// Maps a thread-linear load index to a (row, col) inside a rows x cols slab.
+// When the operand is contiguous along `col`, consecutive threads walk col so
+// global loads coalesce; otherwise they walk row.
+__device__ __forceinline__ void slab_coord(int idx, int rows, int cols, bool col_fast, int& r,
+                                           int& c) {
+  if (col_fast) {
+    r = idx / cols;
+    c = idx % cols;
+  } else {
+    r = idx % rows;
+    c = idx / rows;
+  }
+}
+
+template <typename Cfg, typename T, typename AccT>
+__global__ void __launch_bounds__(Cfg::kThreads) simt_gemm_kernel(GemmParams<T, AccT> p) {
+  constexpr int BM = Cfg::BM, BN = Cfg::BN, BK = Cfg::BK, TM = Cfg::TM, TN = Cfg::TN;
+  __shared__ T As[2][BK][BM];  // A slab, stored k-major for broadcast reads
+  __shared__ T Bs[2][BK][BN];
+
+  const int tid = threadIdx.x;
+  const int tr = tid / (BN / TN);
+  const int tc = tid % (BN / TN);
+  const int64_t row0 = static_cast<int64_t>(blockIdx.y) * BM;
+  const int64_t col0 = static_cast<int64_t>(blockIdx.x) * BN;
+  const bool a_k_fast = p.a_col == 1;
+  const bool b_n_fast = p.b_col == 1 || p.b_row != 1;
+  const T zero = from_op<T>(AccT(0));
+
+  for (int64_t z = blockIdx.z; z < p.batch; z += gridDim.z) {
+    const T* A = p.a + z * p.a_batch;
+    const T* B = p.b + z * p.b_batch;
+    T* C = p.c + z * p.c_batch;
+
+    T a_reg[Cfg::kALoads];
+    T b_reg[Cfg::kBLoads];
+    auto load = [&](int64_t k0) {
+#pragma unroll
+      for (int i = 0; i < Cfg::kALoads; i++) {
+        int m, kk;
+        slab_coord(tid + i * Cfg::kThreads, BM, BK, a_k_fast, m, kk);
+        const int64_t gm = row0 + m, gk = k0 + kk;
+        a_reg[i] = (gm < p.m && gk < p.k) ? A[gm * p.a_row + gk * p.a_col] : zero;
+      }
+#pragma unroll
+      for (int i = 0; i < Cfg::kBLoads; i++) {
+        int kk, n;
+        slab_coord(tid + i * Cfg::kThreads, BK, BN, b_n_fast, kk, n);
+        const int64_t gk = k0 + kk, gn = col0 + n;
+        b_reg[i] = (gk < p.k && gn < p.n) ? B[gk * p.b_row + gn * p.b_col] : zero;
+      }
+    };
+    auto store = [&](int buf) {
+#pragma unroll
+      for (int i = 0; i < Cfg::kALoads; i++) {
+        int m, kk;
+        slab_coord(tid + i * Cfg::kThreads, BM, BK, a_k_fast, m, kk);
+        As[buf][kk][m] = a_reg[i];
+      }
+#pragma unroll
+      for (int i = 0; i < Cfg::kBLoads; i++) {
+        int kk, n;
+        slab_coord(tid + i * Cfg::kThreads, BK, BN, b_n_fast, kk, n);
+        Bs[buf][kk][n] = b_reg[i];
+      }
+    };
+
+    AccT acc[TM][TN];
+#pragma unroll
+    for (int i = 0; i < TM; i++)
+#pragma unroll
+      for (int j = 0; j < TN; j++) acc[i][j] = AccT(0);
+
+    load(0);
+    store(0);
+    __syncthreads();
+
+    int buf = 0;
+    for (int64_t k0 = 0; k0 < p.k; k0 += BK) {
+      const bool has_next = k0 + BK < p.k;
+      if (has_next) load(k0 + BK);
+
+#pragma unroll
+      for (int kk = 0; kk < BK; kk++) {
+        AccT ra[TM], rb[TN];
+#pragma unroll
+        for (int i = 0; i < TM; i++) ra[i] = to_op(As[buf][kk][tr * TM + i]);
+#pragma unroll
+        for (int j = 0; j < TN; j++) rb[j] = to_op(Bs[buf][kk][tc * TN + j]);
+#pragma unroll
+        for (int i = 0; i < TM; i++)
+#pragma unroll
+          for (int j = 0; j < TN; j++) acc[i][j] += ra[i] * rb[j];
+      }
+
+      if (has_next) store(buf ^ 1);
+      __syncthreads();
+      buf ^= 1;
+    }
+
+#pragma unroll
+    for (int i = 0; i < TM; i++) {
+      const int64_t gm = row0 + tr * TM + i;
+      if (gm >= p.m) continue;
+#pragma unroll
+      for (int j = 0; j < TN; j++) {
+        const int64_t gn = col0 + tc * TN + j;
+        if (gn >= p.n) continue;
+        T* dst = C + gm * p.c_row + gn * p.c_col;
+        const AccT v = p.alpha * acc[i][j];
+        *dst = from_op<T>(p.beta == AccT(0) ? v : v + p.beta * to_op(*dst));
+      }
+    }
+    __syncthreads();
+  }
+}
+
+template <typename Cfg, typename T, typename AccT>
+void launch_simt(const GemmParams<T, AccT>& p, cudaStream_t stream) {
+  dim3 grid(static_cast<unsigned>(ceil_div(p.n, Cfg::BN)),
+            static_cast<unsigned>(ceil_div(p.m, Cfg::BM)),
+            static_cast<unsigned>(p.batch < 65535 ? p.batch : 65535));
+  simt_gemm_kernel<Cfg, T, AccT><<<grid, Cfg::kThreads, 0, stream>>>(p);
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+// ---------------------------------------------------------------------------
+// Tensor-core kernel (fp16 / bf16 inputs, fp32 accumulation) via WMMA.
+//
+// 64x64 block tile, BK = 32, four warps each owning a 32x32 quadrant as 2x2
+// 16x16x16 fragments. Slabs are double buffered like the SIMT kernel; rows
+// are padded by 8 elements to avoid shared-memory bank conflicts in
+// load_matrix_sync. The fp32 tile is staged through shared memory for the
+// alpha/beta epilogue and the down-conversion.
+// ---------------------------------------------------------------------------
+
+constexpr int kWmmaBM = 64, kWmmaBN = 64, kWmmaBK = 32, kWmmaPad = 8, kWmmaThreads = 128;
+
+template <typename T>
+struct WmmaArch {
+  static constexpr int kMin = 700;
+};
+template <>
+struct WmmaArch<__nv_bfloat16> {
+  static constexpr int kMin = 800;
+};
+
+template <typename T>
+__global__ void __launch_bounds__(kWmmaThreads) wmma_gemm_kernel(GemmParams<T, float> p) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 700
+  if constexpr (__CUDA_ARCH__ >= WmmaArch<T>::kMin) {
+    using namespace nvcuda;
+    constexpr int BM = kWmmaBM, BN = kWmmaBN, BK = kWmmaBK, LDA = BK + kWmmaPad,
+                  LDB = BN + kWmmaPad;
+    constexpr int kALoads = BM * BK / kWmmaThreads;
+    constexpr int kBLoads = BK * BN / kWmmaThreads;
+    __shared__ __align__(32) T As[2][BM][LDA];
+    __shared__ __align__(32) T Bs[2][BK][LDB];
+    __shared__ __align__(32) float Cs[BM][BN];
+
+    const int tid = threadIdx.x;
+    const int warp = tid / 32;
+    const int wm = warp / 2, wn = warp % 2;
+    const int64_t row0 = static_cast<int64_t>(blockIdx.y) * BM;
+    const int64_t col0 = static_cast<int64_t>(blockIdx.x) * BN;
+    const bool a_k_fast = p.a_col == 1;
+    const bool b_n_fast = p.b_col == 1 || p.b_row != 1;
+    const T zero = from_op<T>(0.f);
+
+    for (int64_t z = blockIdx.z; z < p.batch; z += gridDim.z) {
+      const T* A = p.a + z * p.a_batch;
+      const T* B = p.b + z * p.b_batch;
+      T* C = p.c + z * p.c_batch;
+
+      T a_reg[kALoads];
+      T b_reg[kBLoads];
+      auto load = [&](int64_t k0) {
+#pragma unroll
+        for (int i = 0; i < kALoads; i++) {
+          int m, kk;
+          slab_coord(tid + i * kWmmaThreads, BM, BK, a_k_fast, m, kk);
+          const int64_t gm = row0 + m, gk = k0 + kk;
+          a_reg[i] = (gm < p.m && gk < p.k) ? A[gm * p.a_row + gk * p.a_col] : zero;
+        }
+#pragma unroll
+        for (int i = 0; i < kBLoads; i++) {
+          int kk, n;
+          slab_coord(tid + i * kWmmaThreads, BK, BN, b_n_fast, kk, n);
+          const int64_t gk = k0 + kk, gn = col0 + n;
+          b_reg[i] = (gk < p.k && gn < p.n) ? B[gk * p.b_row + gn * p.b_col] : zero;
+        }
+      };
+      auto store = [&](int buf) {
+#pragma unroll
+        for (int i = 0; i < kALoads; i++) {
+          int m, kk;
+          slab_coord(tid + i * kWmmaThreads, BM, BK, a_k_fast, m, kk);
+          As[buf][m][kk] = a_reg[i];
+        }
+#pragma unroll
+        for (int i = 0; i < kBLoads; i++) {
+          int kk, n;
+          slab_coord(tid + i * kWmmaThreads, BK, BN, b_n_fast, kk, n);
+          Bs[buf][kk][n] = b_reg[i];
+        }
+      };
+
+      wmma::fragment<wmma::accumulator, 16, 16, 16, float> acc[2][2];
+#pragma unroll
+      for (int i = 0; i < 2; i++)
+#pragma unroll
+        for (int j = 0; j < 2; j++) wmma::fill_fragment(acc[i][j], 0.f);
+
+      load(0);
+      store(0);
+      __syncthreads();
+
+      int buf = 0;
+      for (int64_t k0 = 0; k0 < p.k; k0 += BK) {
+        const bool has_next = k0 + BK < p.k;
+        if (has_next) load(k0 + BK);
+
+#pragma unroll
+        for (int kk = 0; kk < BK; kk += 16) {
+          wmma::fragment<wmma::matrix_a, 16, 16, 16, T, wmma::row_major> fa[2];
+          wmma::fragment<wmma::matrix_b, 16, 16, 16, T, wmma::row_major> fb[2];
+#pragma unroll
+          for (int i = 0; i < 2; i++)
+            wmma::load_matrix_sync(fa[i], &As[buf][wm * 32 + i * 16][kk], LDA);
+#pragma unroll
+          for (int j = 0; j < 2; j++)
+            wmma::load_matrix_sync(fb[j], &Bs[buf][kk][wn * 32 + j * 16], LDB);
+#pragma unroll
+          for (int i = 0; i < 2; i++)
+#pragma unroll
+            for (int j = 0; j < 2; j++) wmma::mma_sync(acc[i][j], fa[i], fb[j], acc[i][j]);
+        }
+
+        if (has_next) store(buf ^ 1);
+        __syncthreads();
+        buf ^= 1;
+      }
+
+#pragma unroll
+      for (int i = 0; i < 2; i++)
+#pragma unroll
+        for (int j = 0; j < 2; j++)
+          wmma::store_matrix_sync(&Cs[wm * 32 + i * 16][wn * 32 + j * 16], acc[i][j], BN,
+                                  wmma::mem_row_major);
+      __syncthreads();
+
+      for (int idx = tid; idx < BM * BN; idx += kWmmaThreads) {
+        const int r = idx / BN, c = idx % BN;
+        const int64_t gm = row0 + r, gn = col0 + c;
+        if (gm >= p.m || gn >= p.n) continue;
+        T* dst = C + gm * p.c_row + gn * p.c_col;
+        float v = p.alpha * Cs[r][c];
+        if (p.beta != 0.f) v += p.beta * to_op(*dst);
+        *dst = from_op<T>(v);
+      }
+      __syncthreads();
+    }
+  }
+#endif
+}
+
+template <typename T>
+void launch_wmma(const GemmParams<T, float>& p, cudaStream_t stream) {
+  dim3 grid(static_cast<unsigned>(ceil_div(p.n, kWmmaBN)),
+            static_cast<unsigned>(ceil_div(p.m, kWmmaBM)),
+            static_cast<unsigned>(p.batch < 65535 ? p.batch : 65535));
+  wmma_gemm_kernel<T><<<grid, kWmmaThreads, 0, stream>>>(p);
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+// Small problems would leave most SMs idle with 128x128 tiles.
+bool use_small_tile(int64_t m, int64_t n) { return m <= 64 || n <= 64; }
+
+// The native kernels, timed against each other per shape by
+// core/autotune.h. Products with fewer multiply-adds than kMinTuneMacs run
+// the heuristic choice untimed.
+enum class NativeKernel { LargeTile, MediumTile, SmallTile, Wmma };
+constexpr int64_t kMinTuneMacs = int64_t(1) << 24;
+
+const char* kernel_name(NativeKernel kernel) {
+  switch (kernel) {
+    case NativeKernel::LargeTile:
+      return "simt128x128";
+    case NativeKernel::MediumTile:
+      return "simt64x64";
+    case NativeKernel::SmallTile:
+      return "simt32x32";
+    case NativeKernel::Wmma:
+      return "wmma64x64";
+  }
+  return "unknown";
+}
+
+template <typename T, typename AccT>
+void launch_native(NativeKernel kernel, const GemmParams<T, AccT>& p, cudaStream_t stream) {
+  switch (kernel) {
+    case NativeKernel::Wmma:
+      if constexpr (std::is_same_v<T, __half> || std::is_same_v<T, __nv_bfloat16>) {
+        launch_wmma(p, stream);
+        return;
+      }
+      break;
+    case NativeKernel::LargeTile:
+      launch_simt<LargeTile>(p, stream);
+      return;
+    case NativeKernel::MediumTile:
+      launch_simt<MediumTile>(p, stream);
+      return;
+    case NativeKernel::SmallTile:
+      launch_simt<SmallTile>(p, stream);
+      return;
+  }
+  XFT_FAIL("bmm: no ", kernel_name(kernel), " kernel for this dtype");
+}
+
+// The heuristic pick (tensor cores when there are any, else the tile for
+// the problem's size) first, then the other kernels for the tuner. c is
+// fully overwritten (beta is 0), so a rerun after timing is safe.
+template <typename T, typename AccT>
+void run_native(const GemmParams<T, AccT>& p, DType dtype, int device, bool wmma,
+                cudaStream_t stream) {
+  std::vector<NativeKernel> kernels;
+  if (wmma) kernels.push_back(NativeKernel::Wmma);
+  kernels.push_back(use_small_tile(p.m, p.n) ? NativeKernel::SmallTile : NativeKernel::LargeTile);
+  for (NativeKernel k :
+       {NativeKernel::LargeTile, NativeKernel::MediumTile, NativeKernel::SmallTile}) {
+    if (std::find(kernels.begin(), kernels.end(), k) == kernels.end()) kernels.push_back(k);
+  }
+  int choice = 0;
+  if (p.batch * p.m * p.n * p.k >= kMinTuneMacs) {
+    std::vector<std::string> names;
+    for (NativeKernel k : kernels) names.push_back(kernel_name(k));
+    // Operands read along k or across it load differently.
+    const std::string key = autotune::make_key(
+        autotune_arch(device), "bmm", dtype,
+        {p.batch, p.m, p.n, p.k, p.a_col == 1 ? 1 : 0, p.b_col == 1 ? 1 : 0});
+    std::function<double(int)> time;
+    if (can_time(stream)) {
+      time = [&](int i) {
+        return time_on_stream(stream, [&] { launch_native(kernels[i], p, stream); });
+      };
+    }
+    choice = autotune::select(key, names, time);
+  }
+  launch_native(kernels[choice], p, stream);
+}
+
+GemmBackend parse_backend(const char* value) {
+  if (value == nullptr || *value == '\0' || std::strcmp(value, "auto") == 0) {
+    return GemmBackend::Auto;
+  }
+  if (std::strcmp(value, "native") == 0) return GemmBackend::Native;
+  if (std::strcmp(value, "cublas") == 0) return GemmBackend::Cublas;
+  XFT_FAIL("XFT_GEMM_BACKEND must be auto, native or cublas, got '", value, "'");
+}
+
+#ifdef XFT_USE_CUBLAS
+// Below this many multiply-adds the in-house kernels keep up with cuBLAS
+// and skip its per-call heuristics; above it, and for fp64 (which the
+// tiles are not tuned for), the vendor kernels win.
+constexpr int64_t kNativeMaxMacs = int64_t(1) << 23;
+
+bool prefer_cublas(const Tensor& a, const Tensor& out) {
+  if (out.dtype() == DType::Float64) return true;
+  return out.numel() * a.size(2) > kNativeMaxMacs;
+}
+#endif
+
+}  // namespace
+
+int compute_capability(int device) {
+  thread_local std::vector<int> cache;
+  if (static_cast<size_t>(device) >= cache.size()) cache.resize(device + 1, 0);
+  if (cache[device] == 0) {
+    cudaDeviceProp prop;
+    XFT_CUDA_CHECK(cudaGetDeviceProperties(&prop, device));
+    cache[device] = prop.major * 100 + prop.minor * 10;
+  }
+  return cache[device];
+}
+
+GemmBackend gemm_backend() {
+  static const GemmBackend backend = parse_backend(std::getenv("XFT_GEMM_BACKEND"));
+  return backend;
+}
+
+void bmm(const Tensor& a, const Tensor& b, const Tensor& out) {
+  const GemmBackend backend = gemm_backend();
+#ifdef XFT_USE_CUBLAS
+  if (backend == GemmBackend::Cublas) {
+    if (blas_bmm(a, b, out)) return;
+    // Forced: give cuBLAS operands it can describe.
+    XFT_CHECK(blas_bmm(a.contiguous(), b.contiguous(), out), "bmm: cuBLAS cannot run a [",
+              out.size(0), ", ", out.size(1), ", ", out.size(2), "] product");
+    return;
+  }
+  if (backend == GemmBackend::Auto && a.size(2) > 0 && prefer_cublas(a, out) &&
+      blas_bmm(a, b, out)) {
+    return;
+  }
+#else
+  XFT_CHECK(backend != GemmBackend::Cublas,
+            "XFT_GEMM_BACKEND=cublas, but xft was built without cuBLAS (XFT_USE_CUBLAS=OFF)");
+#endif
+  bmm_native(a, b, out);
+}
+
+void bmm_native(const Tensor& a, const Tensor& b, const Tensor& out) {
+  const int device = out.device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  if (out.numel() == 0) return;
+  if (a.size(2) == 0) {
+    Tensor(out).fill_(0.0);
+    return;
+  }
+  if (is_reduced_floating(out.dtype())) {
+    XFT_DISPATCH_HALF_TYPES(out.dtype(), "bmm", [&] {
+      using T = device_t<scalar_t>;
+      run_native(make_params<T, float>(a, b, out), out.dtype(), device,
+                 compute_capability(device) >= WmmaArch<T>::kMin, stream);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(out.dtype(), "bmm", [&] {
+    run_native(make_params<scalar_t, scalar_t>(a, b, out), out.dtype(), device, false, stream);
+  });
+}
+
+}  // namespace xft::cuda
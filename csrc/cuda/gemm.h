@@ -0,0 +1,26 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+// Which implementation bmm() uses. Chosen once per process from the
+// XFT_GEMM_BACKEND environment variable ("auto", "native" or "cublas";
+// default "auto"). Auto only ever picks cuBLAS in builds with XFT_USE_CUBLAS.
+enum class GemmBackend { Auto, Native, Cublas };
+
+GemmBackend gemm_backend();
+
+// out[i] = a[i] @ b[i] for a: [B, M, K], b: [B, K, N], out: [B, M, N], on
+// the current stream. Operands may have any strides (transposed views and
+// stride-0 broadcast batches are read in place); out must be dense.
+void bmm(const Tensor& a, const Tensor& b, const Tensor& out);
+
+// The in-house tiled kernels, bypassing backend selection.
+void bmm_native(const Tensor& a, const Tensor& b, const Tensor& out);
+
+// The device's compute capability as major * 100 + minor * 10, the scale
+// of __CUDA_ARCH__; cached per thread.
+int compute_capability(int device);
+
+}  // namespace xft::cuda
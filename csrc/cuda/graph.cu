@@ -0,0 +1,118 @@
+#include "cuda/graph.h"
+
+#include "core/generator.h"
+#include "cuda/cuda_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+__global__ void set_rng_kernel(uint64_t* pair, uint64_t seed, uint64_t offset) {
+  pair[0] = seed;
+  pair[1] = offset;
+}
+
+uint64_t* rng_pair(const Tensor& t) { return static_cast<uint64_t*>(t.data_ptr()); }
+
+}  // namespace
+
+CUDAGraph::~CUDAGraph() { release(); }
+
+void CUDAGraph::capture_begin(int device, MempoolId pool) {
+  XFT_CHECK(!capturing_ && exec_ == nullptr,
+            "CUDAGraph: already captured; call reset() before capturing again");
+  cudaStream_t stream = current_stream(device);
+  XFT_CHECK(stream != nullptr,
+            "CUDAGraph: the legacy default stream cannot be captured; make a side stream "
+            "current first");
+  DeviceGuard guard(device);
+  // Allocated before routing starts, so it lives in the shared pool.
+  rng_ = Tensor::empty({2}, DType::Int64, Device(DeviceType::CUDA, device));
+
+  device_ = device;
+  stream_ = stream;
+  pool_ = pool != 0 ? pool : CachingAllocator::new_pool_id();
+  caching_allocator()->begin_allocate_to_pool(device, pool_, stream);
+  holds_pool_ = true;
+  Generator& gen = default_generator(Device(DeviceType::CUDA, device));
+  gen.begin_graph_capture(rng_pair(rng_));
+  // Thread-local mode: other threads may keep using CUDA (and cudaMalloc)
+  // while this one captures.
+  const cudaError_t err = cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal);
+  if (err != cudaSuccess) {
+    gen.end_graph_capture();
+    caching_allocator()->end_allocate_to_pool(device, pool_);
+    release();
+    XFT_CUDA_CHECK(err);
+  }
+  capturing_ = true;
+}
+
+void CUDAGraph::capture_end() {
+  XFT_CHECK(capturing_, "CUDAGraph: capture_end() without capture_begin()");
+  DeviceGuard guard(device_);
+  capturing_ = false;
+  const cudaError_t err = cudaStreamEndCapture(stream_, &graph_);
+  rng_blocks_ = default_generator(Device(DeviceType::CUDA, device_)).end_graph_capture();
+  caching_allocator()->end_allocate_to_pool(device_, pool_);
+  if (err != cudaSuccess) {
+    cudaGetLastError();
+    release();
+    XFT_FAIL("CUDAGraph: capture failed (", cudaGetErrorString(err),
+             "); the captured region must only enqueue work on the capturing stream, or "
+             "on streams that joined it through events, and must not synchronize");
+  }
+  XFT_CUDA_CHECK(cudaGraphInstantiateWithFlags(&exec_, graph_, 0));
+}
+
+void CUDAGraph::replay() {
+  XFT_CHECK(exec_ != nullptr, "CUDAGraph: nothing captured to replay");
+  DeviceGuard guard(device_);
+  cudaStream_t stream = current_stream(device_);
+  if (rng_blocks_ > 0) {
+    const GeneratorState rng =
+        default_generator(Device(DeviceType::CUDA, device_)).reserve(rng_blocks_);
+    set_rng_kernel<<<1, 1, 0, stream>>>(rng_pair(rng_), rng.seed, rng.offset);
+    XFT_CUDA_KERNEL_LAUNCH_CHECK();
+  }
+  caching_allocator()->record_stream(rng_.storage()->data(), device_, stream);
+  XFT_CUDA_CHECK(cudaGraphLaunch(exec_, stream));
+}
+
+void CUDAGraph::reset() {
+  XFT_CHECK(!capturing_, "CUDAGraph: reset() during capture");
+  release();
+}
+
+void CUDAGraph::release() noexcept {
+  if (capturing_) {
+    // Destroyed mid-capture (an exception unwound past capture_end()).
+    cudaGraph_t partial = nullptr;
+    cudaStreamEndCapture(stream_, &partial);
+    if (partial != nullptr) cudaGraphDestroy(partial);
+    cudaGetLastError();
+    try {
+      default_generator(Device(DeviceType::CUDA, device_)).end_graph_capture();
+      caching_allocator()->end_allocate_to_pool(device_, pool_);
+    } catch (...) {
+    }
+    capturing_ = false;
+  }
+  if (exec_ != nullptr) cudaGraphExecDestroy(exec_);
+  if (graph_ != nullptr) cudaGraphDestroy(graph_);
+  exec_ = nullptr;
+  graph_ = nullptr;
+  if (holds_pool_) {
+    try {
+      caching_allocator()->release_pool(device_, pool_);
+    } catch (...) {
+    }
+    holds_pool_ = false;
+  }
+  rng_ = Tensor();
+  rng_blocks_ = 0;
+  stream_ = nullptr;
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cuda_runtime.h>
+
+#include <cstdint>
+
+#include "core/tensor.h"
+#include "cuda/caching_allocator.h"
+
+namespace xft::cuda {
+
+// A captured CUDA graph: a fixed sequence of kernels and copies with fixed
+// device addresses that replays with one launch instead of one per kernel.
+//
+// Everything the calling thread enqueues on the capturing stream between
+// capture_begin() and capture_end() is recorded, not run. Tensors allocated
+// during capture come from a private pool of the caching allocator, so
+// their memory stays reserved for the graph; the tensors created inside
+// (inputs the capture wrote to, outputs it produced) are the graph's static
+// buffers. To run it on new data, copy into the static inputs, replay(),
+// and read the static outputs. Random ops draw fresh numbers on every
+// replay: their Philox seed and offset are read on the device from a pair
+// replay() rewrites (see GeneratorState::graph_base).
+class CUDAGraph {
+ public:
+  CUDAGraph() = default;
+  ~CUDAGraph();
+
+  CUDAGraph(const CUDAGraph&) = delete;
+  CUDAGraph& operator=(const CUDAGraph&) = delete;
+
+  // Starts capturing on the current stream of `device`, which must not be
+  // the legacy default stream. Allocations there come from pool `pool`, or
+  // a new one when it is 0; graphs that never run concurrently can share
+  // one to save memory.
+  void capture_begin(int device, MempoolId pool = 0);
+  void capture_end();
+  // Launches the graph on the current stream of its device.
+  void replay();
+  // Destroys the graph and gives up its use of the pool; static buffers
+  // still alive keep their memory until they are freed.
+  void reset();
+
+  MempoolId pool() const { return pool_; }
+  bool is_captured() const { return exec_ != nullptr; }
+
+ private:
+  void release() noexcept;
+
+  int device_ = -1;
+  cudaStream_t stream_ = nullptr;  // while capturing
+  bool capturing_ = false;
+  bool holds_pool_ = false;
+  MempoolId pool_ = 0;
+  cudaGraph_t graph_ = nullptr;
+  cudaGraphExec_t exec_ = nullptr;
+  Tensor rng_;  // {seed, offset} for the captured random ops
+  uint64_t rng_blocks_ = 0;
+};
+
+}  // namespace xft::cuda
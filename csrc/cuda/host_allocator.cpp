@@ -0,0 +1,186 @@
+#include "cuda/host_allocator.h"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "cuda/cuda_utils.h"
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr size_t kMinHostBlock = 4096;
+
+struct HostBlock {
+  void* ptr;
+  size_t size;
+  bool allocated = false;
+  std::vector<cudaEvent_t> events;  // outstanding copies touching this block
+};
+
+size_t round_host_size(size_t n) {
+  size_t size = kMinHostBlock;
+  while (size < n) size <<= 1;
+  return size;
+}
+
+class HostAllocatorState {
+ public:
+  void* malloc(size_t nbytes) {
+    if (nbytes == 0) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    poll_pending();
+    const size_t size = round_host_size(nbytes);
+    HostBlock* block = nullptr;
+    auto& bucket = free_[size];
+    if (!bucket.empty()) {
+      block = bucket.back();
+      bucket.pop_back();
+      stats_.num_cache_hits++;
+    } else {
+      void* ptr = nullptr;
+      XFT_CUDA_CHECK(cudaHostAlloc(&ptr, size, cudaHostAllocDefault));
+      block = new HostBlock{ptr, size, false, {}};
+      blocks_[ptr] = block;
+      stats_.reserved_bytes += static_cast<int64_t>(size);
+    }
+    block->allocated = true;
+    stats_.num_allocs++;
+    stats_.allocated_bytes += static_cast<int64_t>(block->size);
+    return block->ptr;
+  }
+
+  void free(void* ptr) {
+    if (ptr == nullptr) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    HostBlock* block = lookup(ptr);
+    block->allocated = false;
+    stats_.allocated_bytes -= static_cast<int64_t>(block->size);
+    if (block->events.empty()) {
+      free_[block->size].push_back(block);
+    } else {
+      pending_.push_back(block);
+    }
+  }
+
+  void record(void* ptr, int device, cudaStream_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    HostBlock* block = lookup(ptr);
+    DeviceGuard guard(device);
+    cudaEvent_t event;
+    XFT_CUDA_CHECK(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+    XFT_CUDA_CHECK(cudaEventRecord(event, stream));
+    block->events.push_back(event);
+  }
+
+  bool contains(const void* ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.count(const_cast<void*>(ptr)) != 0;
+  }
+
+  void release_cached() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    poll_pending();
+    for (auto& [size, bucket] : free_) {
+      for (HostBlock* block : bucket) {
+        XFT_CUDA_CHECK(cudaFreeHost(block->ptr));
+        stats_.reserved_bytes -= static_cast<int64_t>(block->size);
+        blocks_.erase(block->ptr);
+        delete block;
+      }
+      bucket.clear();
+    }
+  }
+
+  HostMemoryStats stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    HostMemoryStats s = stats_;
+    s.num_pending = static_cast<int64_t>(pending_.size());
+    return s;
+  }
+
+ private:
+  HostBlock* lookup(void* ptr) {
+    auto it = blocks_.find(ptr);
+    XFT_CHECK(it != blocks_.end(), "host allocator: pointer is not a pinned block");
+    return it->second;
+  }
+
+  // Moves pending blocks whose copies have all finished to the free lists.
+  void poll_pending() {
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      HostBlock* block = *it;
+      while (!block->events.empty()) {
+        cudaError_t err = cudaEventQuery(block->events.back());
+        if (err == cudaErrorNotReady) break;
+        XFT_CUDA_CHECK(err);
+        cudaEventDestroy(block->events.back());
+        block->events.pop_back();
+      }
+      if (block->events.empty()) {
+        free_[block->size].push_back(block);
+        it = pending_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<void*, HostBlock*> blocks_;
+  std::map<size_t, std::vector<HostBlock*>> free_;
+  std::deque<HostBlock*> pending_;
+  HostMemoryStats stats_;
+};
+
+HostAllocatorState& host_state() {
+  static auto* state = new HostAllocatorState();
+  return *state;
+}
+
+}  // namespace
+
+void* HostAllocator::allocate(size_t nbytes) { return host_state().malloc(nbytes); }
+
+void HostAllocator::free(void* ptr) { host_state().free(ptr); }
+
+void HostAllocator::record_stream(void* ptr, int device, cudaStream_t stream) {
+  host_state().record(ptr, device, stream);
+}
+
+bool HostAllocator::is_pinned(const void* ptr) { return host_state().contains(ptr); }
+
+void HostAllocator::empty_cache() { host_state().release_cached(); }
+
+HostMemoryStats HostAllocator::stats() { return host_state().stats(); }
+
+HostAllocator* host_allocator() {
+  static HostAllocator allocator;
+  return &allocator;
+}
+
+Tensor empty_pinned(const Shape& sizes, DType dtype) {
+  const size_t nbytes = shape_numel(sizes) * element_size(dtype);
+  void* ptr = host_allocator()->allocate(nbytes);
+  auto storage = std::make_shared<Storage>(ptr, nbytes, Device(),
+                                           [](void* p) { host_allocator()->free(p); });
+  return Tensor::from_storage(std::move(storage), sizes, contiguous_strides(sizes), 0, dtype);
+}
+
+Tensor pin_memory(const Tensor& t) {
+  XFT_CHECK(t.device().is_cpu(), "pin_memory: expected a CPU tensor, got ", t.device().str());
+  if (is_pinned(t)) return t;
+  Tensor out = empty_pinned(t.sizes(), t.dtype());
+  out.copy_(t.detach());
+  return out;
+}
+
+bool is_pinned(const Tensor& t) {
+  return t.device().is_cpu() && t.storage()->data() != nullptr &&
+         host_allocator()->is_pinned(t.storage()->data());
+}
+
+}  // namespace xft::cuda
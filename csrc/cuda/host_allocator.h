@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cuda_runtime.h>
+
+#include <cstdint>
+
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+struct HostMemoryStats {
+  int64_t allocated_bytes = 0;  // pinned blocks backing live tensors
+  int64_t reserved_bytes = 0;   // obtained from cudaHostAlloc, cached or not
+  int64_t num_allocs = 0;
+  int64_t num_cache_hits = 0;
+  int64_t num_pending = 0;      // freed blocks waiting on an in-flight copy
+};
+
+constexpr int kNumHostMemoryStats = sizeof(HostMemoryStats) / sizeof(int64_t);
+
+// A cache of page-locked host blocks, rounded to powers of two. A block used
+// by an async copy carries the events recorded after that copy; when freed it
+// is recycled only once every event has completed, so a staging buffer can
+// be released as soon as its cudaMemcpyAsync is enqueued.
+class HostAllocator {
+ public:
+  void* allocate(size_t nbytes);
+  void free(void* ptr);
+  // `ptr` is the base of a pinned block; marks it in use by work already
+  // enqueued on `stream` of `device`.
+  void record_stream(void* ptr, int device, cudaStream_t stream);
+  bool is_pinned(const void* ptr);
+  void empty_cache();
+  HostMemoryStats stats();
+};
+
+HostAllocator* host_allocator();
+
+// A CPU tensor backed by the pinned pool.
+Tensor empty_pinned(const Shape& sizes, DType dtype);
+// `t` itself when already pinned, otherwise a pinned copy.
+Tensor pin_memory(const Tensor& t);
+bool is_pinned(const Tensor& t);
+
+}  // namespace xft::cuda
@@ -0,0 +1,212 @@
+#include "cuda/fused.h"
+
+#include "cuda/dtype_utils.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr int kRowsPerBlock = 4;  // one warp per row
+
+// Running (count, mean, M2) over a lane's elements, merged across the warp
+// with Chan's parallel update so no pass over the row is spent on the mean.
+template <typename T>
+struct Welford {
+  T n = T(0), mean = T(0), m2 = T(0);
+
+  __device__ void add(T x) {
+    n += T(1);
+    const T d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+  }
+
+  __device__ void merge(const Welford& o) {
+    if (o.n == T(0)) return;
+    const T total = n + o.n;
+    const T d = o.mean - mean;
+    mean += d * (o.n / total);
+    m2 += o.m2 + d * d * (n * o.n / total);
+    n = total;
+  }
+};
+
+template <typename T>
+__device__ inline Welford<T> warp_welford(Welford<T> w) {
+#pragma unroll
+  for (int o = kWarpSize / 2; o > 0; o /= 2) {
+    Welford<T> other;
+    other.n = __shfl_xor_sync(0xffffffff, w.n, o);
+    other.mean = __shfl_xor_sync(0xffffffff, w.mean, o);
+    other.m2 = __shfl_xor_sync(0xffffffff, w.m2, o);
+    w.merge(other);
+  }
+  return w;
+}
+
+// T is the storage type of x, y, weight and bias; statistics, mean and rstd
+// are A = opmath_t<T>.
+template <typename T, bool kRms>
+__global__ void layer_norm_kernel(const T* x, const T* weight, const T* bias, opmath_t<T> eps,
+                                  T* y, opmath_t<T>* mean, opmath_t<T>* rstd, int64_t rows,
+                                  int64_t cols) {
+  using A = opmath_t<T>;
+  const int lane = threadIdx.x % kWarpSize;
+  const int64_t row = blockIdx.x * static_cast<int64_t>(kRowsPerBlock) + threadIdx.x / kWarpSize;
+  if (row >= rows) return;
+  const T* xr = x + row * cols;
+  A mu = A(0), rs;
+  if (kRms) {
+    A ss = A(0);
+    for (int64_t c = lane; c < cols; c += kWarpSize) ss += to_op(xr[c]) * to_op(xr[c]);
+    rs = rsqrt_(warp_sum(ss) / static_cast<A>(cols) + eps);
+  } else {
+    Welford<A> w;
+    for (int64_t c = lane; c < cols; c += kWarpSize) w.add(to_op(xr[c]));
+    w = warp_welford(w);
+    mu = w.mean;
+    rs = rsqrt_(w.m2 / static_cast<A>(cols) + eps);
+  }
+  T* yr = y + row * cols;
+  for (int64_t c = lane; c < cols; c += kWarpSize) {
+    A v = (to_op(xr[c]) - mu) * rs;
+    if (weight != nullptr) v *= to_op(weight[c]);
+    if (bias != nullptr) v += to_op(bias[c]);
+    yr[c] = from_op<T>(v);
+  }
+  if (lane == 0) {
+    if (!kRms) mean[row] = mu;
+    rstd[row] = rs;
+  }
+}
+
+// dx = rstd * (g - mean(g) - xhat * mean(g * xhat)) with g = dy * weight;
+// rms_norm drops the mean(g) term.
+template <typename T, bool kRms>
+__global__ void layer_norm_backward_kernel(const T* dy, const T* x, const opmath_t<T>* mean,
+                                           const opmath_t<T>* rstd, const T* weight, T* dx,
+                                           int64_t rows, int64_t cols) {
+  using A = opmath_t<T>;
+  const int lane = threadIdx.x % kWarpSize;
+  const int64_t row = blockIdx.x * static_cast<int64_t>(kRowsPerBlock) + threadIdx.x / kWarpSize;
+  if (row >= rows) return;
+  const T* gr = dy + row * cols;
+  const T* xr = x + row * cols;
+  const A mu = kRms ? A(0) : mean[row];
+  const A rs = rstd[row];
+  auto grad = [&](int64_t c) {
+    return weight != nullptr ? to_op(gr[c]) * to_op(weight[c]) : to_op(gr[c]);
+  };
+  A sg = A(0), sgx = A(0);
+  for (int64_t c = lane; c < cols; c += kWarpSize) {
+    const A g = grad(c);
+    sg += g;
+    sgx += g * (to_op(xr[c]) - mu) * rs;
+  }
+  const A inv = A(1) / static_cast<A>(cols);
+  const A c1 = kRms ? A(0) : warp_sum(sg) * inv;
+  const A c2 = warp_sum(sgx) * inv;
+  T* dr = dx + row * cols;
+  for (int64_t c = lane; c < cols; c += kWarpSize) {
+    dr[c] = from_op<T>(rs * (grad(c) - c1 - (to_op(xr[c]) - mu) * rs * c2));
+  }
+}
+
+// Column terms for dweight (dy * xhat) and dbias (dy).
+template <typename T, bool kRms>
+struct DWeightTerm {
+  const T *dy, *x;
+  const opmath_t<T>*mean, *rstd;
+  int64_t cols;
+  __device__ opmath_t<T> operator()(int64_t r, int64_t c) const {
+    const opmath_t<T> mu = kRms ? opmath_t<T>(0) : mean[r];
+    return to_op(dy[r * cols + c]) * (to_op(x[r * cols + c]) - mu) * rstd[r];
+  }
+};
+
+template <typename T>
+struct DBiasTerm {
+  const T* dy;
+  int64_t cols;
+  __device__ opmath_t<T> operator()(int64_t r, int64_t c) const { return to_op(dy[r * cols + c]); }
+};
+
+template <typename T>
+const T* ptr(const Tensor& t) {
+  return t.defined() ? static_cast<const T*>(t.data_ptr()) : nullptr;
+}
+
+unsigned int warp_grid(int64_t rows) {
+  return static_cast<unsigned int>(ceil_div(rows, kRowsPerBlock));
+}
+
+}  // namespace
+
+void layer_norm(bool rms, const Tensor& x, const Tensor& weight, const Tensor& bias, double eps,
+                Tensor& y, Tensor& mean, Tensor& rstd, int64_t rows, int64_t cols) {
+  if (rows == 0) return;
+  DeviceGuard guard(x.device().index);
+  cudaStream_t stream = current_stream(x.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "layer_norm", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    T* py = device_ptr<scalar_t>(y);
+    A* pm = rms ? nullptr : static_cast<A*>(mean.data_ptr());
+    A* pr = static_cast<A*>(rstd.data_ptr());
+    const A e = static_cast<A>(eps);
+    const dim3 grid(warp_grid(rows)), block(kRowsPerBlock * kWarpSize);
+    if (rms) {
+      layer_norm_kernel<T, true><<<grid, block, 0, stream>>>(
+          ptr<T>(x), ptr<T>(weight), ptr<T>(bias), e, py, pm, pr, rows, cols);
+    } else {
+      layer_norm_kernel<T, false><<<grid, block, 0, stream>>>(
+          ptr<T>(x), ptr<T>(weight), ptr<T>(bias), e, py, pm, pr, rows, cols);
+    }
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void layer_norm_backward(bool rms, const Tensor& dy, const Tensor& x, const Tensor& mean,
+                         const Tensor& rstd, const Tensor& weight, Tensor& dx, Tensor& dweight,
+                         Tensor& dbias, int64_t rows, int64_t cols) {
+  DeviceGuard guard(x.device().index);
+  cudaStream_t stream = current_stream(x.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "layer_norm_backward", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    const T* g = ptr<T>(dy);
+    const T* px = ptr<T>(x);
+    const A* pm = ptr<A>(mean);
+    const A* pr = ptr<A>(rstd);
+    T* pd = device_ptr<scalar_t>(dx);
+    if (rows > 0) {
+      const dim3 grid(warp_grid(rows)), block(kRowsPerBlock * kWarpSize);
+      if (rms) {
+        layer_norm_backward_kernel<T, true>
+            <<<grid, block, 0, stream>>>(g, px, pm, pr, ptr<T>(weight), pd, rows, cols);
+      } else {
+        layer_norm_backward_kernel<T, false>
+            <<<grid, block, 0, stream>>>(g, px, pm, pr, ptr<T>(weight), pd, rows, cols);
+      }
+      XFT_CUDA_KERNEL_LAUNCH_CHECK();
+    }
+    if (dweight.defined()) {
+      T* out = device_ptr<scalar_t>(dweight);
+      if (rms) {
+        launch_col_sum(DWeightTerm<T, true>{g, px, pm, pr, cols}, out, x.dtype(), x.device(),
+                       rows, cols, stream);
+      } else {
+        launch_col_sum(DWeightTerm<T, false>{g, px, pm, pr, cols}, out, x.dtype(), x.device(),
+                       rows, cols, stream);
+      }
+    }
+    if (dbias.defined()) {
+      launch_col_sum(DBiasTerm<T>{g, cols}, device_ptr<scalar_t>(dbias), x.dtype(), x.device(),
+                     rows, cols, stream);
+    }
+  });
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,246 @@
+#include "cuda/optim.h"
+
+#include <cmath>
+
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// Elements per block.
+constexpr int64_t kChunkSize = 65536;
+
+// The tensors of one launch, passed by value in the kernel arguments (4 KB
+// at most): Depth pointers per tensor, and which tensor and chunk each
+// block works on. The capacities keep every depth under the limit.
+constexpr int kMaxTensorsByDepth[] = {0, 110, 64, 48, 36};
+constexpr int kMaxBlocks = 320;
+
+template <int Depth>
+struct TensorListMeta {
+  static constexpr int kMaxTensors = kMaxTensorsByDepth[Depth];
+  void* addrs[Depth][kMaxTensors];
+  int64_t numel[kMaxTensors];
+  unsigned char block_tensor[kMaxBlocks];
+  int32_t block_chunk[kMaxBlocks];
+};
+
+template <int Depth, typename Op>
+__global__ void multi_tensor_kernel(TensorListMeta<Depth> meta, Op op) {
+  const int t = meta.block_tensor[blockIdx.x];
+  const int64_t lo = static_cast<int64_t>(meta.block_chunk[blockIdx.x]) * kChunkSize;
+  const int64_t n = meta.numel[t];
+  op(meta, t, lo, lo + kChunkSize < n ? lo + kChunkSize : n);
+}
+
+// Runs op over every chunk of lists[0][i], ..., lists[Depth - 1][i] for all
+// i, packing tensors and chunks into as few launches as the metadata allows.
+// A tensor whose chunks do not all fit continues in the next launch.
+template <int Depth, typename Op>
+void multi_tensor_apply(const std::vector<Tensor>* const (&lists)[Depth], const Op& op,
+                        cudaStream_t stream) {
+  using Meta = TensorListMeta<Depth>;
+  Meta meta;
+  int ntensors = 0, nblocks = 0;
+  auto launch = [&] {
+    multi_tensor_kernel<Depth, Op><<<nblocks, kNumThreads, 0, stream>>>(meta, op);
+    XFT_CUDA_KERNEL_LAUNCH_CHECK();
+    nblocks = 0;
+  };
+  const std::vector<Tensor>& first = *lists[0];
+  for (size_t i = 0; i < first.size(); i++) {
+    const int64_t n = first[i].numel();
+    if (n == 0) continue;
+    int slot = ntensors++;
+    for (int d = 0; d < Depth; d++) meta.addrs[d][slot] = (*lists[d])[i].data_ptr();
+    meta.numel[slot] = n;
+    const int64_t chunks = ceil_div(n, kChunkSize);
+    for (int64_t c = 0; c < chunks; c++) {
+      meta.block_tensor[nblocks] = static_cast<unsigned char>(slot);
+      meta.block_chunk[nblocks] = static_cast<int32_t>(c);
+      nblocks++;
+      const bool last_chunk = c == chunks - 1;
+      if (nblocks < kMaxBlocks && !(last_chunk && ntensors == Meta::kMaxTensors)) continue;
+      launch();
+      if (last_chunk) {
+        ntensors = 0;
+      } else {
+        for (int d = 0; d < Depth; d++) meta.addrs[d][0] = meta.addrs[d][slot];
+        meta.numel[0] = n;
+        slot = 0;
+        ntensors = 1;
+      }
+    }
+  }
+  if (nblocks > 0) launch();
+}
+
+template <typename T>
+struct SGDFunctor {
+  using A = opmath_t<T>;
+  A lr, momentum, dampening, weight_decay;
+  bool nesterov, first_step;
+
+  __device__ void operator()(const TensorListMeta<3>& meta, int t, int64_t lo,
+                             int64_t hi) const {
+    T* p = static_cast<T*>(meta.addrs[0][t]);
+    const T* g = static_cast<const T*>(meta.addrs[1][t]);
+    T* buf = static_cast<T*>(meta.addrs[2][t]);
+    for (int64_t i = lo + threadIdx.x; i < hi; i += blockDim.x) {
+      const A param = to_op(p[i]);
+      A grad = to_op(g[i]) + weight_decay * param;
+      if (momentum != A(0)) {
+        const A b = first_step ? grad : momentum * to_op(buf[i]) + (A(1) - dampening) * grad;
+        buf[i] = from_op<T>(b);
+        grad = nesterov ? grad + momentum * b : b;
+      }
+      p[i] = from_op<T>(param - lr * grad);
+    }
+  }
+};
+
+template <typename T>
+struct AdamFunctor {
+  using A = opmath_t<T>;
+  A lr, beta1, beta2, eps, weight_decay, step_size, bias_correction2_sqrt;
+  bool decoupled;
+
+  __device__ void operator()(const TensorListMeta<4>& meta, int t, int64_t lo,
+                             int64_t hi) const {
+    T* p = static_cast<T*>(meta.addrs[0][t]);
+    const T* g = static_cast<const T*>(meta.addrs[1][t]);
+    T* m = static_cast<T*>(meta.addrs[2][t]);
+    T* v = static_cast<T*>(meta.addrs[3][t]);
+    for (int64_t i = lo + threadIdx.x; i < hi; i += blockDim.x) {
+      A param = to_op(p[i]);
+      A grad = to_op(g[i]);
+      if (decoupled) {
+        param -= lr * weight_decay * param;
+      } else {
+        grad += weight_decay * param;
+      }
+      const A mi = beta1 * to_op(m[i]) + (A(1) - beta1) * grad;
+      const A vi = beta2 * to_op(v[i]) + (A(1) - beta2) * grad * grad;
+      m[i] = from_op<T>(mi);
+      v[i] = from_op<T>(vi);
+      p[i] = from_op<T>(param - step_size * mi / (sqrt(vi) / bias_correction2_sqrt + eps));
+    }
+  }
+};
+
+template <typename T>
+struct SumSquaresFunctor {
+  float* out;
+
+  __device__ void operator()(const TensorListMeta<1>& meta, int t, int64_t lo,
+                             int64_t hi) const {
+    __shared__ float scratch[kWarpSize];
+    const T* x = static_cast<const T*>(meta.addrs[0][t]);
+    float acc = 0;
+    for (int64_t i = lo + threadIdx.x; i < hi; i += blockDim.x) {
+      const float v = static_cast<float>(to_op(x[i]));
+      acc += v * v;
+    }
+    acc = block_sum(acc, scratch);
+    if (threadIdx.x == 0) atomicAdd(out, acc);
+  }
+};
+
+template <typename T>
+struct ClipFunctor {
+  const float* norm;
+  float max_norm;
+
+  __device__ void operator()(const TensorListMeta<1>& meta, int t, int64_t lo,
+                             int64_t hi) const {
+    const float coef = max_norm / (*norm + 1e-6f);
+    if (!(coef < 1.0f)) return;
+    T* x = static_cast<T*>(meta.addrs[0][t]);
+    for (int64_t i = lo + threadIdx.x; i < hi; i += blockDim.x) {
+      x[i] = from_op<T>(to_op(x[i]) * static_cast<opmath_t<T>>(coef));
+    }
+  }
+};
+
+}  // namespace
+
+void sgd_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+              const std::vector<Tensor>& momentum_buffers, const SGDOptions& options,
+              bool first_step) {
+  if (params.empty()) return;
+  const int device = params[0].device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  // Without momentum the buffer slot is never touched; grads fill it.
+  const std::vector<Tensor>* const lists[3] = {
+      &params, &grads, options.momentum != 0 ? &momentum_buffers : &grads};
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(params[0].dtype(), "sgd_step", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    const SGDFunctor<T> op{static_cast<A>(options.lr),
+                           static_cast<A>(options.momentum),
+                           static_cast<A>(options.dampening),
+                           static_cast<A>(options.weight_decay),
+                           options.nesterov,
+                           first_step};
+    multi_tensor_apply<3>(lists, op, stream);
+  });
+}
+
+void adam_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+               const std::vector<Tensor>& exp_avgs, const std::vector<Tensor>& exp_avg_sqs,
+               const AdamOptions& options, int64_t step) {
+  if (params.empty()) return;
+  const int device = params[0].device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  const double bias_correction1 = 1 - std::pow(options.beta1, static_cast<double>(step));
+  const double bias_correction2 = 1 - std::pow(options.beta2, static_cast<double>(step));
+  const std::vector<Tensor>* const lists[4] = {&params, &grads, &exp_avgs, &exp_avg_sqs};
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(params[0].dtype(), "adam_step", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    const AdamFunctor<T> op{static_cast<A>(options.lr),
+                            static_cast<A>(options.beta1),
+                            static_cast<A>(options.beta2),
+                            static_cast<A>(options.eps),
+                            static_cast<A>(options.weight_decay),
+                            static_cast<A>(options.lr / bias_correction1),
+                            static_cast<A>(std::sqrt(bias_correction2)),
+                            options.decoupled_weight_decay};
+    multi_tensor_apply<4>(lists, op, stream);
+  });
+}
+
+void sum_squares(const std::vector<Tensor>& tensors, const Tensor& sumsq) {
+  if (tensors.empty()) return;
+  const int device = tensors[0].device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  const std::vector<Tensor>* const lists[1] = {&tensors};
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(tensors[0].dtype(), "clip_grad_norm_", [&] {
+    using T = device_t<scalar_t>;
+    multi_tensor_apply<1>(lists, SumSquaresFunctor<T>{static_cast<float*>(sumsq.data_ptr())},
+                          stream);
+  });
+}
+
+void clip_by_norm_(const std::vector<Tensor>& tensors, const Tensor& norm, double max_norm) {
+  if (tensors.empty()) return;
+  const int device = tensors[0].device().index;
+  DeviceGuard guard(device);
+  cudaStream_t stream = current_stream(device);
+  const std::vector<Tensor>* const lists[1] = {&tensors};
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(tensors[0].dtype(), "clip_grad_norm_", [&] {
+    using T = device_t<scalar_t>;
+    const ClipFunctor<T> op{static_cast<const float*>(norm.data_ptr()),
+                            static_cast<float>(max_norm)};
+    multi_tensor_apply<1>(lists, op, stream);
+  });
+}
+
+}  // namespace xft::cuda
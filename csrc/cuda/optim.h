@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "core/tensor.h"
+#include "ops/optim.h"
+
+namespace xft::cuda {
+
+// Multi-tensor forms of ops/optim.h, on the current stream, for checked
+// lists whose tensors all share one CUDA device and dtype. Each launch
+// covers as many tensors as fit in its kernel arguments, one block per
+// 64K-element chunk.
+void sgd_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+              const std::vector<Tensor>& momentum_buffers, const SGDOptions& options,
+              bool first_step);
+void adam_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+               const std::vector<Tensor>& exp_avgs, const std::vector<Tensor>& exp_avg_sqs,
+               const AdamOptions& options, int64_t step);
+
+// Adds the sum of squares of every element of `tensors` to `sumsq`, a
+// float32 scalar on their device.
+void sum_squares(const std::vector<Tensor>& tensors, const Tensor& sumsq);
+// Multiplies `tensors` by min(1, max_norm / (norm + 1e-6)), reading `norm`
+// (a float32 scalar on their device) in the kernel.
+void clip_by_norm_(const std::vector<Tensor>& tensors, const Tensor& norm, double max_norm);
+
+}  // namespace xft::cuda
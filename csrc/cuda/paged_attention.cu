@@ -0,0 +1,164 @@
+#include "cuda/paged_attention.h"
+
+#include <type_traits>
+
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr int kWarps = 4;
+
+// Block (b * Hq + h) computes query head h of sequence b. Warp w walks
+// tokens w, w + kWarps, ...: each lane holds kHD / kWarpSize columns of the
+// query and of the warp's accumulator, a token's score is one warp_sum,
+// and the warp keeps its own running max and sum. The kWarps partial
+// results are then rescaled to a common max and summed through shared
+// memory.
+template <typename T, int kHD>
+__global__ void __launch_bounds__(kWarps* kWarpSize)
+    paged_attention_kernel(const T* q, const T* key_cache, const T* value_cache,
+                           const int32_t* block_tables, const int32_t* context_lens, T* out,
+                           PagedAttentionShape a) {
+  using A = opmath_t<T>;
+  constexpr int kCols = kHD / kWarpSize;
+  __shared__ A warp_m[kWarps], warp_l[kWarps];
+  __shared__ A warp_acc[kWarps][kHD];
+  const int64_t b = blockIdx.x / a.Hq, h = blockIdx.x % a.Hq;
+  const int64_t kvh = h / (a.Hq / a.Hkv);
+  const int warp = threadIdx.x / kWarpSize, lane = threadIdx.x % kWarpSize;
+  const int64_t n = context_lens[b];
+  const int32_t* table = block_tables + b * a.max_blocks;
+  const A scale = static_cast<A>(a.scale);
+
+  A qr[kCols], acc[kCols];
+#pragma unroll
+  for (int c = 0; c < kCols; c++) {
+    const int64_t col = lane + c * kWarpSize;
+    qr[c] = col < a.D ? to_op(q[(b * a.Hq + h) * a.D + col]) * scale : A(0);
+    acc[c] = A(0);
+  }
+  A m = -INFINITY, l = A(0);
+  for (int64_t t = warp; t < n; t += kWarps) {
+    const int64_t blk = table[t / a.block_size];
+    const int64_t row = ((blk * a.Hkv + kvh) * a.block_size + t % a.block_size) * a.D;
+    A partial = A(0);
+#pragma unroll
+    for (int c = 0; c < kCols; c++) {
+      const int64_t col = lane + c * kWarpSize;
+      if (col < a.D) partial += qr[c] * to_op(key_cache[row + col]);
+    }
+    const A s = warp_sum(partial);
+    const A mnew = s > m ? s : m;
+    const A alpha = exp_(m - mnew), p = exp_(s - mnew);
+    l = l * alpha + p;
+    m = mnew;
+#pragma unroll
+    for (int c = 0; c < kCols; c++) {
+      const int64_t col = lane + c * kWarpSize;
+      const A v = col < a.D ? to_op(value_cache[row + col]) : A(0);
+      acc[c] = acc[c] * alpha + p * v;
+    }
+  }
+  if (lane == 0) warp_m[warp] = m, warp_l[warp] = l;
+#pragma unroll
+  for (int c = 0; c < kCols; c++) warp_acc[warp][lane + c * kWarpSize] = acc[c];
+  __syncthreads();
+
+  A mx = warp_m[0];
+  for (int w = 1; w < kWarps; w++) mx = warp_m[w] > mx ? warp_m[w] : mx;
+  // A warp that saw no tokens has m = -inf and weighs 0; so does a whole
+  // sequence of length 0, which writes zeros.
+  A total = A(0), weight[kWarps];
+  for (int w = 0; w < kWarps; w++) {
+    weight[w] = n > 0 ? exp_(warp_m[w] - mx) : A(0);
+    total += warp_l[w] * weight[w];
+  }
+  const A inv = total > A(0) ? A(1) / total : A(0);
+  for (int64_t col = threadIdx.x; col < a.D; col += blockDim.x) {
+    A sum = A(0);
+    for (int w = 0; w < kWarps; w++) sum += warp_acc[w][col] * weight[w];
+    out[(b * a.Hq + h) * a.D + col] = from_op<T>(sum * inv);
+  }
+}
+
+// Element i of k and v [T, heads, D] goes to row slot % block_size of
+// block slot / block_size, head by head.
+template <typename T>
+__global__ void paged_kv_store_kernel(const T* k, const T* v, T* key_cache, T* value_cache,
+                                      const int64_t* slots, int64_t n, int64_t heads,
+                                      int64_t block_size, int64_t D) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(gridDim.x) * blockDim.x) {
+    const int64_t d = i % D, h = i / D % heads, t = i / (D * heads);
+    const int64_t slot = slots[t];
+    if (slot < 0) continue;
+    const int64_t dst =
+        ((slot / block_size * heads + h) * block_size + slot % block_size) * D + d;
+    key_cache[dst] = k[i];
+    value_cache[dst] = v[i];
+  }
+}
+
+// Calls f(std::integral_constant<int, kHD>) with the smallest bucket that
+// holds D.
+template <typename T, typename F>
+void dispatch_head_dim(int64_t D, F&& f) {
+  constexpr int kMax = sizeof(opmath_t<T>) > 4 ? 64 : 128;
+  XFT_CHECK(D <= kMax, "paged_attention: CUDA supports head dims up to ", kMax,
+            " for this dtype, got ", D);
+  if (D <= 32) {
+    f(std::integral_constant<int, 32>());
+  } else if (D <= 64) {
+    f(std::integral_constant<int, 64>());
+  } else {
+    if constexpr (kMax >= 128) f(std::integral_constant<int, 128>());
+  }
+}
+
+}  // namespace
+
+void paged_attention(const Tensor& q, const Tensor& key_cache, const Tensor& value_cache,
+                     const Tensor& block_tables, const Tensor& context_lens, Tensor& out,
+                     const PagedAttentionShape& a) {
+  if (a.B * a.Hq == 0) return;
+  DeviceGuard guard(q.device().index);
+  cudaStream_t stream = current_stream(q.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(q.dtype(), "paged_attention", [&] {
+    using T = device_t<scalar_t>;
+    dispatch_head_dim<T>(a.D, [&](auto hd) {
+      constexpr int kHD = decltype(hd)::value;
+      const auto blocks = static_cast<unsigned int>(a.B * a.Hq);
+      paged_attention_kernel<T, kHD><<<blocks, kWarps * kWarpSize, 0, stream>>>(
+          static_cast<const T*>(q.data_ptr()), static_cast<const T*>(key_cache.data_ptr()),
+          static_cast<const T*>(value_cache.data_ptr()),
+          static_cast<const int32_t*>(block_tables.data_ptr()),
+          static_cast<const int32_t*>(context_lens.data_ptr()), static_cast<T*>(out.data_ptr()),
+          a);
+    });
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void paged_kv_store(const Tensor& k, const Tensor& v, Tensor& key_cache, Tensor& value_cache,
+                    const Tensor& slots) {
+  const int64_t n = k.numel();
+  if (n == 0) return;
+  DeviceGuard guard(k.device().index);
+  cudaStream_t stream = current_stream(k.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(k.dtype(), "paged_kv_store", [&] {
+    using T = device_t<scalar_t>;
+    paged_kv_store_kernel<T><<<grid_size(n), kNumThreads, 0, stream>>>(
+        static_cast<const T*>(k.data_ptr()), static_cast<const T*>(v.data_ptr()),
+        static_cast<T*>(key_cache.data_ptr()), static_cast<T*>(value_cache.data_ptr()),
+        static_cast<const int64_t*>(slots.data_ptr()), n, k.size(1), key_cache.size(2),
+        k.size(2));
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
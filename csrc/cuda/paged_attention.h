@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core/tensor.h"
+#include "ops/paged_attention.h"
+
+namespace xft::cuda {
+
+// The paged decode attention behind ops/paged_attention.cpp, on the current
+// stream of q's device: q and out dense [B, Hq, D], the caches dense
+// [num_blocks, Hkv, block_size, D], block tables and context lengths int32.
+// One block per query head splits the sequence's tokens across its warps,
+// each keeping an online softmax, and merges them at the end. D is at most
+// 128 (64 for float64); the 16-bit dtypes compute in float32.
+void paged_attention(const Tensor& q, const Tensor& key_cache, const Tensor& value_cache,
+                     const Tensor& block_tables, const Tensor& context_lens, Tensor& out,
+                     const PagedAttentionShape& a);
+
+// Scatters the rows of dense k and v [T, Hkv, D] to int64 slots[t] of the
+// caches, skipping negative slots.
+void paged_kv_store(const Tensor& k, const Tensor& v, Tensor& key_cache, Tensor& value_cache,
+                    const Tensor& slots);
+
+}  // namespace xft::cuda
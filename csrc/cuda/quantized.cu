@@ -0,0 +1,220 @@
+#include "cuda/quantized.h"
+
+#include <cstdint>
+#include <type_traits>
+
+#include "cuda/dtype_utils.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// One warp per output column, kWarps columns per block. Lanes stride over
+// the row's chunks of kChunk weights, so a warp reads 256 consecutive
+// weights (256 or 128 bytes) per step.
+constexpr int kWarps = 4;
+constexpr int kChunk = 8;
+
+// Chunk c of row n as two words of four int8 values each. An int4 chunk
+// is the low nibbles of eight bytes in the first half of the row and the
+// high ones in the second.
+template <int kBits>
+__device__ __forceinline__ void load_chunk(const uint8_t* data, int64_t n, int64_t c, int64_t K,
+                                           int& lo, int& hi) {
+  if constexpr (kBits == 8) {
+    const int2 v = reinterpret_cast<const int2*>(data + n * K)[c];
+    lo = v.x;
+    hi = v.y;
+  } else {
+    const int64_t half = K / 2 / kChunk;  // chunks per half row
+    const int shift = c < half ? 0 : 4;
+    const uint2 v = reinterpret_cast<const uint2*>(data + n * (K / 2))[c < half ? c : c - half];
+    lo = static_cast<int>(__vsub4((v.x >> shift) & 0x0f0f0f0fu, 0x08080808u));
+    hi = static_cast<int>(__vsub4((v.y >> shift) & 0x0f0f0f0fu, 0x08080808u));
+  }
+}
+
+__device__ __forceinline__ int byte_of(int word, int i) {
+  return static_cast<int8_t>(static_cast<unsigned>(word) >> (8 * i));
+}
+
+// c plus the dot product of the four signed bytes of a and b: one dp4a on
+// sm_61 and newer, four multiply-adds on older targets.
+__device__ __forceinline__ int dot4(int a, int b, int c) {
+#if __CUDA_ARCH__ >= 610
+  return __dp4a(a, b, c);
+#else
+#pragma unroll
+  for (int i = 0; i < 4; i++) c += byte_of(a, i) * byte_of(b, i);
+  return c;
+#endif
+}
+
+// y[m, n] = sum_k x[m, k] * q[n, k] * scale[n, k / G] + bias[n].
+template <typename T, int kBits>
+__global__ void __launch_bounds__(kWarps* kWarpSize)
+    qlinear_kernel(const T* x, const uint8_t* data, const float* scales, const T* bias, T* y,
+                   int64_t M, int64_t N, int64_t K, int64_t G) {
+  using A = opmath_t<T>;
+  const int64_t n = static_cast<int64_t>(blockIdx.x) * kWarps + threadIdx.x / kWarpSize;
+  const int lane = threadIdx.x % kWarpSize;
+  if (n >= N) return;
+  const int64_t chunks = K / kChunk, groups = K / G;
+  const float* sc = scales + n * groups;
+  // Later rows find the weight row in cache.
+  for (int64_t m = 0; m < M; m++) {
+    const T* xr = x + m * K;
+    A acc = A(0);
+    for (int64_t c = lane; c < chunks; c += kWarpSize) {
+      int lo, hi;
+      load_chunk<kBits>(data, n, c, K, lo, hi);
+      const T* xc = xr + c * kChunk;
+      A s = A(0);
+#pragma unroll
+      for (int i = 0; i < 4; i++) {
+        s += to_op(xc[i]) * static_cast<A>(byte_of(lo, i));
+        s += to_op(xc[4 + i]) * static_cast<A>(byte_of(hi, i));
+      }
+      acc += s * static_cast<A>(sc[c * kChunk / G]);
+    }
+    acc = warp_sum(acc);
+    if (lane == 0) y[m * N + n] = from_op<T>(acc + (bias != nullptr ? to_op(bias[n]) : A(0)));
+  }
+}
+
+// Symmetric int8 quantization of each row of x: one block per row.
+template <typename T>
+__global__ void quantize_rows_kernel(const T* x, int8_t* q, float* scale, int64_t K) {
+  __shared__ float scratch[kWarpSize];
+  const T* xr = x + blockIdx.x * K;
+  float amax = 0.0f;
+  for (int64_t i = threadIdx.x; i < K; i += blockDim.x) {
+    amax = fmaxf(amax, fabsf(static_cast<float>(to_op(xr[i]))));
+  }
+  amax = block_max(amax, scratch);
+  const float inv = amax > 0.0f ? 127.0f / amax : 0.0f;
+  for (int64_t i = threadIdx.x; i < K; i += blockDim.x) {
+    const float v = rintf(static_cast<float>(to_op(xr[i])) * inv);
+    q[blockIdx.x * K + i] = static_cast<int8_t>(fminf(fmaxf(v, -127.0f), 127.0f));
+  }
+  if (threadIdx.x == 0) scale[blockIdx.x] = amax / 127.0f;
+}
+
+// The int8 product: dp4a over four-byte words, int32 per chunk, scaled per
+// group, then by the row's activation scale.
+template <typename T, int kBits>
+__global__ void __launch_bounds__(kWarps* kWarpSize)
+    qlinear_dp4a_kernel(const int8_t* xq, const float* xscale, const uint8_t* data,
+                        const float* scales, const T* bias, T* y, int64_t M, int64_t N, int64_t K,
+                        int64_t G) {
+  const int64_t n = static_cast<int64_t>(blockIdx.x) * kWarps + threadIdx.x / kWarpSize;
+  const int lane = threadIdx.x % kWarpSize;
+  if (n >= N) return;
+  const int64_t chunks = K / kChunk, groups = K / G;
+  const float* sc = scales + n * groups;
+  for (int64_t m = 0; m < M; m++) {
+    const int2* xr = reinterpret_cast<const int2*>(xq + m * K);
+    float acc = 0.0f;
+    for (int64_t c = lane; c < chunks; c += kWarpSize) {
+      int lo, hi;
+      load_chunk<kBits>(data, n, c, K, lo, hi);
+      const int2 xv = xr[c];
+      const int d = dot4(xv.y, hi, dot4(xv.x, lo, 0));
+      acc += static_cast<float>(d) * sc[c * kChunk / G];
+    }
+    acc = warp_sum(acc);
+    if (lane == 0) {
+      const float b = bias != nullptr ? static_cast<float>(to_op(bias[n])) : 0.0f;
+      y[m * N + n] = from_op<T>(static_cast<opmath_t<T>>(acc * xscale[m] + b));
+    }
+  }
+}
+
+template <int kBits>
+__global__ void dequantize_kernel(const uint8_t* data, const float* scales, float* out,
+                                  int64_t N, int64_t K, int64_t G) {
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < N * K;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    const int64_t r = i / K, c = i % K, half = K / 2;
+    int q;
+    if constexpr (kBits == 8) {
+      q = static_cast<int8_t>(data[i]);
+    } else {
+      q = c < half ? (data[r * half + c] & 15) - 8 : (data[r * half + c - half] >> 4) - 8;
+    }
+    out[i] = static_cast<float>(q) * scales[r * (K / G) + c / G];
+  }
+}
+
+template <typename F>
+void dispatch_bits(int bits, F&& fn) {
+  if (bits == 8) {
+    fn(std::integral_constant<int, 8>());
+  } else {
+    fn(std::integral_constant<int, 4>());
+  }
+}
+
+}  // namespace
+
+void quantized_linear(const Tensor& x, const Tensor& data, const Tensor& scales,
+                      const Tensor& bias, Tensor& y, int64_t M, int64_t N, int64_t K, int bits,
+                      int64_t group_size, bool dynamic) {
+  // A chunk must not straddle a group, nor (for int4) the two half rows.
+  const int64_t k_multiple = bits == 8 ? kChunk : 2 * kChunk;
+  XFT_CHECK(K % k_multiple == 0 && group_size % kChunk == 0, "quantized_linear: CUDA needs K (",
+            K, ") to be a multiple of ", k_multiple, " and group_size (", group_size,
+            ") one of ", kChunk);
+  XFT_CHECK(reinterpret_cast<uintptr_t>(data.data_ptr()) % 8 == 0,
+            "quantized_linear: weight data must be 8-byte aligned");
+  if (M == 0 || N == 0) return;
+  DeviceGuard guard(x.device().index);
+  cudaStream_t stream = current_stream(x.device().index);
+  const auto* pd = static_cast<const uint8_t*>(data.data_ptr());
+  const auto* ps = static_cast<const float*>(scales.data_ptr());
+  const auto blocks = static_cast<unsigned int>(ceil_div(N, kWarps));
+  Tensor xq, xs;
+  if (dynamic) {
+    xq = Tensor::empty({M, K}, DType::Int8, x.device());
+    xs = Tensor::empty({M}, DType::Float32, x.device());
+  }
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(x.dtype(), "quantized_linear", [&] {
+    using T = device_t<scalar_t>;
+    const T* pb = device_ptr_or_null<scalar_t>(bias);
+    dispatch_bits(bits, [&](auto b) {
+      constexpr int kBits = decltype(b)::value;
+      if (dynamic) {
+        auto* pq = static_cast<int8_t*>(xq.data_ptr());
+        auto* pxs = static_cast<float*>(xs.data_ptr());
+        quantize_rows_kernel<T><<<static_cast<unsigned int>(M), kNumThreads, 0, stream>>>(
+            device_ptr<scalar_t>(x), pq, pxs, K);
+        qlinear_dp4a_kernel<T, kBits><<<blocks, kWarps * kWarpSize, 0, stream>>>(
+            pq, pxs, pd, ps, pb, device_ptr<scalar_t>(y), M, N, K, group_size);
+      } else {
+        qlinear_kernel<T, kBits><<<blocks, kWarps * kWarpSize, 0, stream>>>(
+            device_ptr<scalar_t>(x), pd, ps, pb, device_ptr<scalar_t>(y), M, N, K, group_size);
+      }
+    });
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void dequantize_weight(const Tensor& data, const Tensor& scales, Tensor& out, int bits,
+                       int64_t group_size) {
+  const int64_t N = out.size(0), K = out.size(1);
+  if (N * K == 0) return;
+  DeviceGuard guard(data.device().index);
+  cudaStream_t stream = current_stream(data.device().index);
+  const auto* pd = static_cast<const uint8_t*>(data.data_ptr());
+  const auto* ps = static_cast<const float*>(scales.data_ptr());
+  auto* po = static_cast<float*>(out.data_ptr());
+  dispatch_bits(bits, [&](auto b) {
+    dequantize_kernel<decltype(b)::value>
+        <<<grid_size(N * K), kNumThreads, 0, stream>>>(pd, ps, po, N, K, group_size);
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
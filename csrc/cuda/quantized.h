@@ -0,0 +1,22 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft::cuda {
+
+// Quantized linear layers behind ops/quantized.cpp (which documents the
+// weight formats), on the current stream of x's device. x is dense [M, K]
+// and y dense [M, N], both floating of one dtype; bias is [N] in that dtype
+// or undefined. Each lane decodes eight weights at a time, so group_size
+// must be a multiple of 8 and K one of 8 (int8) or 16 (int4). Dynamic
+// quantizes x to int8 per row first and multiplies with dp4a (byte-wise
+// below sm_61).
+void quantized_linear(const Tensor& x, const Tensor& data, const Tensor& scales,
+                      const Tensor& bias, Tensor& y, int64_t M, int64_t N, int64_t K, int bits,
+                      int64_t group_size, bool dynamic);
+
+// Writes the float32 [N, K] weight into out.
+void dequantize_weight(const Tensor& data, const Tensor& scales, Tensor& out, int bits,
+                       int64_t group_size);
+
+}  // namespace xft::cuda
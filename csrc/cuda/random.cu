@@ -0,0 +1,68 @@
+#include "cuda/random.h"
+
+#include "core/philox.h"
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// One thread per Philox block, grid-stride. The 16-bit dtypes draw float
+// values, so they see the same stream as float32.
+template <typename T, typename A = opmath_t<T>>
+__global__ void random_kernel(T* out, int64_t n, RandomOp op, A a, A b, uint64_t seed,
+                              uint64_t offset, const uint64_t* graph_base) {
+  philox_resolve(graph_base, seed, offset);
+  constexpr int kPer = kPhiloxPerBlock<A>;
+  const int64_t blocks = (n + kPer - 1) / kPer;
+  for (int64_t blk = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; blk < blocks;
+       blk += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    const PhiloxBlock bits = philox(seed, offset + blk);
+    A v[kPer];
+    if (op == RandomOp::Normal) {
+      philox_normal(bits, v);
+    } else {
+      philox_uniform(bits, v);
+    }
+    const int64_t base = blk * kPer;
+#pragma unroll
+    for (int i = 0; i < kPer; i++) {
+      if (base + i >= n) break;
+      A r;
+      switch (op) {
+        case RandomOp::Uniform:
+          r = a + (b - a) * v[i];
+          break;
+        case RandomOp::Normal:
+          r = a + b * v[i];
+          break;
+        default:
+          r = v[i] < a ? b : A(0);
+          break;
+      }
+      out[base + i] = from_op<T>(r);
+    }
+  }
+}
+
+}  // namespace
+
+void random_fill(Tensor& out, RandomOp op, double a, double b, GeneratorState rng) {
+  const int64_t n = out.numel();
+  if (n == 0) return;
+  DeviceGuard guard(out.device().index);
+  cudaStream_t stream = current_stream(out.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(out.dtype(), "random", [&] {
+    using T = device_t<scalar_t>;
+    using A = opmath_t<T>;
+    const int64_t blocks = ceil_div(n, kPhiloxPerBlock<A>);
+    random_kernel<T><<<grid_size(blocks), kNumThreads, 0, stream>>>(
+        device_ptr<scalar_t>(out), n, op, static_cast<A>(a), static_cast<A>(b), rng.seed,
+        rng.offset, rng.graph_base);
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
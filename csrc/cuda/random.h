@@ -0,0 +1,14 @@
+#pragma once
+
+#include "core/generator.h"
+#include "core/tensor.h"
+#include "ops/op_kinds.h"
+
+namespace xft::cuda {
+
+// Fills the dense floating tensor `out` on the current stream of its device
+// from Philox counters starting at rng.offset, element for element the same
+// as the CPU path in ops/random.cpp.
+void random_fill(Tensor& out, RandomOp op, double a, double b, GeneratorState rng);
+
+}  // namespace xft::cuda
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "core/autotune.h"
+#include "cuda/autotune.h"
+#include "cuda/dtype_utils.h"
+#include "cuda/fused.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+// Sum and max over r of an [outer, r, inner] tensor. Values combine in Acc:
+// opmath_t for floats, int64 for integer sums (also the output type, as on
+// the CPU), and at least 32 bits for integer max, the narrowest type the
+// warp shuffles take.
+
+template <typename Acc>
+struct SumFn {
+  __device__ static Acc combine(Acc a, Acc b) { return a + b; }
+};
+
+// NaN-propagating, like the CPU kernels; x != x is false for integers.
+template <typename Acc>
+struct MaxFn {
+  __device__ static Acc combine(Acc a, Acc b) {
+    return a != a ? a : (b != b ? b : (a > b ? a : b));
+  }
+};
+
+template <typename Op, typename Acc>
+__device__ inline Acc warp_reduce(Acc v) {
+#pragma unroll
+  for (int o = kWarpSize / 2; o > 0; o /= 2) {
+    v = Op::combine(v, __shfl_xor_sync(0xffffffff, v, o));
+  }
+  return v;
+}
+
+// The [lo, hi) share of n that chunk `chunk` of `chunks` reduces.
+__device__ inline void chunk_range(int64_t n, unsigned int chunk, unsigned int chunks,
+                                   int64_t& lo, int64_t& hi) {
+  const int64_t per = (n + chunks - 1) / chunks;
+  lo = chunk * per;
+  hi = lo + per < n ? lo + per : n;
+}
+
+// inner == 1: rows of r contiguous elements. blockDim.x threads share a row
+// (a warp, with blockDim.y rows per block, or a whole block with one row);
+// gridDim.y splits every row into chunks, chunk c of row i going to
+// out[i * gridDim.y + c].
+template <typename In, typename Acc, typename Out, typename Op>
+__global__ void reduce_rows_kernel(const In* in, Out* out, int64_t rows, int64_t r, Acc init) {
+  __shared__ Acc scratch[kWarpSize];
+  const int64_t row = blockIdx.x * static_cast<int64_t>(blockDim.y) + threadIdx.y;
+  int64_t lo, hi;
+  chunk_range(r, blockIdx.y, gridDim.y, lo, hi);
+  Acc acc = init;
+  if (row < rows) {
+    const In* x = in + row * r;
+    for (int64_t c = lo + threadIdx.x; c < hi; c += blockDim.x) {
+      acc = Op::combine(acc, convert<Acc>(x[c]));
+    }
+  }
+  acc = warp_reduce<Op>(acc);
+  if (blockDim.x > kWarpSize) {
+    const int lane = threadIdx.x % kWarpSize, warp = threadIdx.x / kWarpSize;
+    if (lane == 0) scratch[warp] = acc;
+    __syncthreads();
+    acc = lane < static_cast<int>(blockDim.x / kWarpSize) ? scratch[lane] : init;
+    acc = warp_reduce<Op>(acc);
+  }
+  if (row < rows && threadIdx.x == 0) out[row * gridDim.y + blockIdx.y] = convert<Out>(acc);
+}
+
+// inner > 1: a block covers kWarpSize adjacent columns of one outer slab,
+// its blockDim.y thread rows striding r so loads coalesce along inner.
+// gridDim.z splits r into chunks, chunk c of column (o, i) going to
+// out[(o * gridDim.z + c) * inner + i]. Slabs beyond gridDim.y loop.
+constexpr int kMaxColRows = 32;
+
+template <typename In, typename Acc, typename Out, typename Op>
+__global__ void reduce_cols_kernel(const In* in, Out* out, int64_t outer, int64_t r,
+                                   int64_t inner, Acc init) {
+  __shared__ Acc tile[kMaxColRows][kWarpSize + 1];
+  const int64_t col = blockIdx.x * static_cast<int64_t>(kWarpSize) + threadIdx.x;
+  int64_t lo, hi;
+  chunk_range(r, blockIdx.z, gridDim.z, lo, hi);
+  for (int64_t o = blockIdx.y; o < outer; o += gridDim.y) {
+    Acc acc = init;
+    if (col < inner) {
+      const In* x = in + o * r * inner + col;
+      for (int64_t k = lo + threadIdx.y; k < hi; k += blockDim.y) {
+        acc = Op::combine(acc, convert<Acc>(x[k * inner]));
+      }
+    }
+    tile[threadIdx.y][threadIdx.x] = acc;
+    __syncthreads();
+    if (threadIdx.y == 0 && col < inner) {
+      for (unsigned int i = 1; i < blockDim.y; i++) acc = Op::combine(acc, tile[i][threadIdx.x]);
+      out[(o * gridDim.z + blockIdx.z) * inner + col] = convert<Out>(acc);
+    }
+    __syncthreads();
+  }
+}
+
+// A launch shape: tx threads along r per row (inner == 1) or kWarpSize
+// columns (inner > 1), by ty rows.
+struct Config {
+  int tx, ty;
+};
+
+// The candidates core/autotune.h times for large reductions, the default
+// (what smaller ones run) first: a warp per row up to kMaxWarpRow
+// elements and a 512-thread block per row past it; for columns, 8 thread
+// rows, or one when r is too short to share.
+constexpr int64_t kMaxWarpRow = 1024;
+constexpr int64_t kMinSharedRows = 64;
+constexpr int kWarpRowsPerBlock = 8;
+constexpr int64_t kMinTuneElements = int64_t(1) << 20;
+
+std::vector<Config> candidates(int64_t r, int64_t inner) {
+  std::vector<Config> c;
+  if (inner == 1) {
+    c = {{kWarpSize, kWarpRowsPerBlock}, {128, 1}, {256, 1}, {512, 1}, {1024, 1}};
+    if (r > kMaxWarpRow) std::swap(c[0], c[3]);
+  } else {
+    c = {{kWarpSize, 8}, {kWarpSize, 1}, {kWarpSize, 4}, {kWarpSize, 16},
+         {kWarpSize, kMaxColRows}};
+    if (r < kMinSharedRows) std::swap(c[0], c[1]);
+  }
+  return c;
+}
+
+std::string config_name(const Config& c, int64_t inner) {
+  return std::string(inner == 1 ? "rows" : "cols") + std::to_string(c.tx) + "x" +
+         std::to_string(c.ty);
+}
+
+int sm_count(int device) {
+  thread_local std::vector<int> cache;
+  if (static_cast<size_t>(device) >= cache.size()) cache.resize(device + 1, 0);
+  if (cache[device] == 0) {
+    XFT_CUDA_CHECK(
+        cudaDeviceGetAttribute(&cache[device], cudaDevAttrMultiProcessorCount, device));
+  }
+  return cache[device];
+}
+
+// Chunks of r per output when `blocks` blocks would leave the device short
+// of kWavesPerSm blocks per SM, each thread still getting at least
+// kMinPerThread elements; the chunks then combine in a second pass.
+constexpr int64_t kWavesPerSm = 4;
+constexpr int64_t kMinPerThread = 16;
+constexpr int64_t kMaxSplits = 64;
+constexpr int64_t kMaxGridY = 65535;
+
+int64_t num_splits(int64_t blocks, int64_t r, int64_t threads_along_r, int device) {
+  const int64_t want = kWavesPerSm * sm_count(device);
+  if (blocks >= want) return 1;
+  const int64_t by_work = r / (threads_along_r * kMinPerThread);
+  return std::max<int64_t>(1, std::min({ceil_div(want, blocks), by_work, kMaxSplits}));
+}
+
+template <typename T, typename Acc, typename Out, typename Op>
+void run(const Config& c, const T* x, Out* y, int64_t outer, int64_t r, int64_t inner, Acc init,
+         Device device, cudaStream_t stream) {
+  if (inner == 1) {
+    const int64_t blocks = ceil_div(outer, c.ty);
+    const int64_t splits = num_splits(blocks, r, c.tx, device.index);
+    const dim3 block(c.tx, c.ty);
+    if (splits == 1) {
+      reduce_rows_kernel<T, Acc, Out, Op>
+          <<<dim3(static_cast<unsigned int>(blocks)), block, 0, stream>>>(x, y, outer, r, init);
+      XFT_CUDA_KERNEL_LAUNCH_CHECK();
+      return;
+    }
+    Tensor part = Tensor::empty({outer, splits}, DTypeOf<Acc>::value, device);
+    Acc* p = static_cast<Acc*>(part.data_ptr());
+    reduce_rows_kernel<T, Acc, Acc, Op>
+        <<<dim3(static_cast<unsigned int>(blocks), static_cast<unsigned int>(splits)), block, 0,
+           stream>>>(x, p, outer, r, init);
+    XFT_CUDA_KERNEL_LAUNCH_CHECK();
+    reduce_rows_kernel<Acc, Acc, Out, Op>
+        <<<dim3(static_cast<unsigned int>(ceil_div(outer, kWarpRowsPerBlock))),
+           dim3(kWarpSize, kWarpRowsPerBlock), 0, stream>>>(p, y, outer, splits, init);
+    XFT_CUDA_KERNEL_LAUNCH_CHECK();
+    return;
+  }
+  const int64_t col_blocks = ceil_div(inner, kWarpSize);
+  const int64_t slabs = std::min(outer, kMaxGridY);
+  const int64_t splits = num_splits(col_blocks * slabs, r, c.ty, device.index);
+  const dim3 block(kWarpSize, c.ty);
+  const dim3 grid(static_cast<unsigned int>(col_blocks), static_cast<unsigned int>(slabs),
+                  static_cast<unsigned int>(splits));
+  if (splits == 1) {
+    reduce_cols_kernel<T, Acc, Out, Op><<<grid, block, 0, stream>>>(x, y, outer, r, inner, init);
+    XFT_CUDA_KERNEL_LAUNCH_CHECK();
+    return;
+  }
+  Tensor part = Tensor::empty({outer, splits, inner}, DTypeOf<Acc>::value, device);
+  Acc* p = static_cast<Acc*>(part.data_ptr());
+  reduce_cols_kernel<T, Acc, Acc, Op><<<grid, block, 0, stream>>>(x, p, outer, r, inner, init);
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+  const dim3 finish(static_cast<unsigned int>(col_blocks), static_cast<unsigned int>(slabs), 1);
+  reduce_cols_kernel<Acc, Acc, Out, Op>
+      <<<finish, dim3(kWarpSize, 1), 0, stream>>>(p, y, outer, splits, inner, init);
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+// Runs the default shape, or for large reductions the one core/autotune.h
+// found fastest for this (arch, op, dtype, shape). Shapes that split r
+// differently round differently, so the winner always runs last.
+template <typename T, typename Acc, typename Op, typename Out>
+void tuned(const char* op, const T* x, Out* y, int64_t outer, int64_t r, int64_t inner, Acc init,
+           DType dtype, Device device, cudaStream_t stream) {
+  const std::vector<Config> configs = candidates(r, inner);
+  int choice = 0;
+  if (outer * r * inner >= kMinTuneElements) {
+    std::vector<std::string> names;
+    for (const Config& c : configs) names.push_back(config_name(c, inner));
+    const std::string key =
+        autotune::make_key(autotune_arch(device.index), op, dtype, {outer, r, inner});
+    std::function<double(int)> time;
+    if (can_time(stream)) {
+      time = [&](int i) {
+        return time_on_stream(stream, [&] {
+          run<T, Acc, Out, Op>(configs[i], x, y, outer, r, inner, init, device, stream);
+        });
+      };
+    }
+    choice = autotune::select(key, names, time);
+  }
+  run<T, Acc, Out, Op>(configs[choice], x, y, outer, r, inner, init, device, stream);
+}
+
+template <typename T, typename Acc>
+Acc max_identity() {
+  if constexpr (std::is_floating_point_v<Acc>) {
+    return -std::numeric_limits<Acc>::infinity();
+  } else {
+    return static_cast<Acc>(std::numeric_limits<T>::lowest());
+  }
+}
+
+}  // namespace
+
+void reduce(ReduceOp op, const Tensor& in, Tensor& out, int64_t outer, int64_t r,
+            int64_t inner) {
+  if (outer * inner == 0) return;
+  XFT_CHECK(in.dtype() != DType::Int8, "reduce: unsupported dtype int8");
+  const Device device = in.device();
+  DeviceGuard guard(device.index);
+  cudaStream_t stream = current_stream(device.index);
+  XFT_DISPATCH_ALL_TYPES_AND_HALF(in.dtype(), "reduce", [&] {
+    using T = device_t<scalar_t>;
+    const T* x = device_ptr<scalar_t>(in);
+    if (op == ReduceOp::Sum) {
+      using Acc = std::conditional_t<std::is_integral_v<T>, int64_t, opmath_t<T>>;
+      using Out = std::conditional_t<std::is_integral_v<T>, int64_t, T>;
+      tuned<T, Acc, SumFn<Acc>>("sum", x, static_cast<Out*>(out.data_ptr()), outer, r, inner,
+                                Acc(0), in.dtype(), device, stream);
+    } else {
+      using Acc =
+          std::conditional_t<std::is_integral_v<T> && (sizeof(T) < 4), int32_t, opmath_t<T>>;
+      tuned<T, Acc, MaxFn<Acc>>("max", x, static_cast<T*>(out.data_ptr()), outer, r, inner,
+                                max_identity<scalar_t, Acc>(), in.dtype(), device, stream);
+    }
+  });
+}
+
+}  // namespace xft::cuda
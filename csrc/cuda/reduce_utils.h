@@ -0,0 +1,131 @@
+#pragma once
+
+// Device-side building blocks shared by the fused row kernels: warp and
+// block reductions and a two-pass column sum. Include from .cu files only.
+
+#include <cuda_runtime.h>
+
+#include <cstdint>
+
+#include "core/tensor.h"
+#include "cuda/cuda_utils.h"
+#include "cuda/dtype_utils.h"
+
+namespace xft::cuda {
+
+constexpr int kWarpSize = 32;
+
+__device__ inline float exp_(float x) { return expf(x); }
+__device__ inline double exp_(double x) { return ::exp(x); }
+__device__ inline float rsqrt_(float x) { return rsqrtf(x); }
+__device__ inline double rsqrt_(double x) { return ::rsqrt(x); }
+__device__ inline float tanh_(float x) { return tanhf(x); }
+__device__ inline double tanh_(double x) { return ::tanh(x); }
+
+template <typename T>
+__device__ inline T warp_sum(T v) {
+#pragma unroll
+  for (int o = kWarpSize / 2; o > 0; o /= 2) v += __shfl_xor_sync(0xffffffff, v, o);
+  return v;
+}
+
+template <typename T>
+__device__ inline T warp_max(T v) {
+#pragma unroll
+  for (int o = kWarpSize / 2; o > 0; o /= 2) {
+    const T w = __shfl_xor_sync(0xffffffff, v, o);
+    v = w > v ? w : v;
+  }
+  return v;
+}
+
+// Sum over a 1-D block of at most 1024 threads; every thread gets the
+// result. `scratch` holds kWarpSize values and is reused on return.
+template <typename T>
+__device__ inline T block_sum(T v, T* scratch) {
+  const int lane = threadIdx.x % kWarpSize, warp = threadIdx.x / kWarpSize;
+  v = warp_sum(v);
+  __syncthreads();
+  if (lane == 0) scratch[warp] = v;
+  __syncthreads();
+  const int nwarps = (blockDim.x + kWarpSize - 1) / kWarpSize;
+  v = lane < nwarps ? scratch[lane] : T(0);
+  return warp_sum(v);
+}
+
+template <typename T>
+__device__ inline T block_max(T v, T* scratch) {
+  const int lane = threadIdx.x % kWarpSize, warp = threadIdx.x / kWarpSize;
+  v = warp_max(v);
+  __syncthreads();
+  if (lane == 0) scratch[warp] = v;
+  __syncthreads();
+  const int nwarps = (blockDim.x + kWarpSize - 1) / kWarpSize;
+  v = lane < nwarps ? scratch[lane] : scratch[0];
+  return warp_max(v);
+}
+
+// Column sums of up to two [rows, cols] products, without atomics:
+//   pass 1: a (kWarpSize, kColRowsPerBlock) block per kWarpSize columns and
+//           row chunk writes one partial per chunk into part[chunk, col];
+//   pass 2: one thread per column adds its chunk partials.
+// F maps (row, col) to the value summed, in opmath_t of the output type;
+// partials stay in that type.
+constexpr int kColRowsPerBlock = 8;
+constexpr int kColMaxChunks = 64;
+
+inline int col_chunks(int64_t rows) {
+  const int64_t c = ceil_div(rows, 4 * kColRowsPerBlock);
+  return static_cast<int>(c < 1 ? 1 : (c > kColMaxChunks ? kColMaxChunks : c));
+}
+
+template <typename T, typename F>
+__global__ void col_partial_kernel(F f, T* part, int64_t rows, int64_t cols) {
+  __shared__ T tile[kColRowsPerBlock][kWarpSize + 1];
+  const int64_t col = blockIdx.x * static_cast<int64_t>(kWarpSize) + threadIdx.x;
+  const int64_t chunk = ceil_div(rows, gridDim.y);
+  const int64_t lo = blockIdx.y * chunk;
+  const int64_t hi = lo + chunk < rows ? lo + chunk : rows;
+  T acc = T(0);
+  if (col < cols) {
+    for (int64_t r = lo + threadIdx.y; r < hi; r += kColRowsPerBlock) acc += f(r, col);
+  }
+  tile[threadIdx.y][threadIdx.x] = acc;
+  __syncthreads();
+  if (threadIdx.y == 0 && col < cols) {
+    T s = T(0);
+#pragma unroll
+    for (int i = 0; i < kColRowsPerBlock; i++) s += tile[i][threadIdx.x];
+    part[blockIdx.y * cols + col] = s;
+  }
+}
+
+template <typename T>
+__global__ void col_finalize_kernel(const opmath_t<T>* part, T* out, int chunks, int64_t cols) {
+  for (int64_t c = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; c < cols;
+       c += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    opmath_t<T> s = 0;
+    for (int i = 0; i < chunks; i++) s += part[i * cols + c];
+    out[c] = from_op<T>(s);
+  }
+}
+
+// out[c] = sum over rows of f(r, c) for a dense [cols] `out` of device type
+// T, whose dtype is `dtype`.
+template <typename T, typename F>
+void launch_col_sum(F f, T* out, DType dtype, Device device, int64_t rows, int64_t cols,
+                    cudaStream_t stream) {
+  using A = opmath_t<T>;
+  const int chunks = col_chunks(rows);
+  Tensor part = Tensor::empty({chunks, cols}, is_reduced_floating(dtype) ? DType::Float32 : dtype,
+                              device);
+  A* p = static_cast<A*>(part.data_ptr());
+  const dim3 block(kWarpSize, kColRowsPerBlock);
+  const dim3 grid(static_cast<unsigned int>(ceil_div(cols, kWarpSize)), chunks);
+  col_partial_kernel<A><<<grid, block, 0, stream>>>(f, p, rows, cols);
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+  col_finalize_kernel<T><<<grid_size(cols), kNumThreads, 0, stream>>>(p, out, chunks, cols);
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,210 @@
+#include "cuda/fused.h"
+
+#include "cuda/dtype_utils.h"
+#include "cuda/reduce_utils.h"
+#include "cuda/stream.h"
+
+namespace xft::cuda {
+
+namespace {
+
+constexpr int kRowsPerBlock = 4;  // warps per block in the warp-per-row kernels
+constexpr int kMaxWarpCols = 1024;
+
+// T is the storage type; maxima, sums and exponentials are in A = opmath_t<T>.
+
+// ---- inner == 1: rows of r contiguous elements ----
+
+// One warp per row, the row held in registers: kPer values per lane, so the
+// input is read once and the output written once.
+template <typename T, int kPer>
+__global__ void softmax_warp_kernel(const T* in, T* out, int64_t rows, int64_t r) {
+  using A = opmath_t<T>;
+  const int lane = threadIdx.x % kWarpSize;
+  const int64_t row = blockIdx.x * static_cast<int64_t>(kRowsPerBlock) + threadIdx.x / kWarpSize;
+  if (row >= rows) return;
+  const T* x = in + row * r;
+  A v[kPer];
+  A m = -INFINITY;
+#pragma unroll
+  for (int i = 0; i < kPer; i++) {
+    const int64_t c = lane + i * kWarpSize;
+    v[i] = c < r ? to_op(x[c]) : A(-INFINITY);
+    m = v[i] > m ? v[i] : m;
+  }
+  m = warp_max(m);
+  A s = A(0);
+#pragma unroll
+  for (int i = 0; i < kPer; i++) {
+    v[i] = lane + i * kWarpSize < r ? exp_(v[i] - m) : A(0);
+    s += v[i];
+  }
+  const A inv = A(1) / warp_sum(s);
+  T* y = out + row * r;
+#pragma unroll
+  for (int i = 0; i < kPer; i++) {
+    const int64_t c = lane + i * kWarpSize;
+    if (c < r) y[c] = from_op<T>(v[i] * inv);
+  }
+}
+
+// One block per long row: an online max / rescaled-sum pass, then the
+// write pass (two reads of the row instead of three).
+template <typename T>
+__global__ void softmax_block_kernel(const T* in, T* out, int64_t r) {
+  using A = opmath_t<T>;
+  __shared__ A scratch[kWarpSize];
+  const T* x = in + blockIdx.x * r;
+  A m = -INFINITY, s = A(0);
+  for (int64_t c = threadIdx.x; c < r; c += blockDim.x) {
+    const A v = to_op(x[c]);
+    if (v > m) {
+      s = s * exp_(m - v) + A(1);
+      m = v;
+    } else {
+      s += exp_(v - m);
+    }
+  }
+  const A bm = block_max(m, scratch);
+  const A bs = block_sum(m == -INFINITY ? A(0) : s * exp_(m - bm), scratch);
+  const A inv = A(1) / bs;
+  T* y = out + blockIdx.x * r;
+  for (int64_t c = threadIdx.x; c < r; c += blockDim.x) {
+    y[c] = from_op<T>(exp_(to_op(x[c]) - bm) * inv);
+  }
+}
+
+template <typename T>
+__global__ void softmax_backward_warp_kernel(const T* grad, const T* out, T* grad_in, int64_t rows,
+                                             int64_t r) {
+  using A = opmath_t<T>;
+  const int lane = threadIdx.x % kWarpSize;
+  const int64_t row = blockIdx.x * static_cast<int64_t>(kRowsPerBlock) + threadIdx.x / kWarpSize;
+  if (row >= rows) return;
+  const T* g = grad + row * r;
+  const T* y = out + row * r;
+  A dot = A(0);
+  for (int64_t c = lane; c < r; c += kWarpSize) dot += to_op(g[c]) * to_op(y[c]);
+  dot = warp_sum(dot);
+  T* d = grad_in + row * r;
+  for (int64_t c = lane; c < r; c += kWarpSize) {
+    d[c] = from_op<T>(to_op(y[c]) * (to_op(g[c]) - dot));
+  }
+}
+
+// ---- inner > 1: one thread per (outer, inner) column, stride `inner` ----
+
+template <typename T>
+__global__ void softmax_columns_kernel(const T* in, T* out, int64_t outer, int64_t r,
+                                       int64_t inner) {
+  using A = opmath_t<T>;
+  const int64_t n = outer * inner;
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    const int64_t base = (i / inner) * r * inner + i % inner;
+    A m = -INFINITY, s = A(0);
+    for (int64_t k = 0; k < r; k++) {
+      const A v = to_op(in[base + k * inner]);
+      if (v > m) {
+        s = s * exp_(m - v) + A(1);
+        m = v;
+      } else {
+        s += exp_(v - m);
+      }
+    }
+    const A inv = A(1) / s;
+    for (int64_t k = 0; k < r; k++) {
+      const int64_t j = base + k * inner;
+      out[j] = from_op<T>(exp_(to_op(in[j]) - m) * inv);
+    }
+  }
+}
+
+template <typename T>
+__global__ void softmax_backward_columns_kernel(const T* grad, const T* out, T* grad_in,
+                                                int64_t outer, int64_t r, int64_t inner) {
+  using A = opmath_t<T>;
+  const int64_t n = outer * inner;
+  for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < n;
+       i += static_cast<int64_t>(blockDim.x) * gridDim.x) {
+    const int64_t base = (i / inner) * r * inner + i % inner;
+    A dot = A(0);
+    for (int64_t k = 0; k < r; k++) {
+      dot += to_op(grad[base + k * inner]) * to_op(out[base + k * inner]);
+    }
+    for (int64_t k = 0; k < r; k++) {
+      const int64_t j = base + k * inner;
+      grad_in[j] = from_op<T>(to_op(out[j]) * (to_op(grad[j]) - dot));
+    }
+  }
+}
+
+unsigned int warp_grid(int64_t rows) {
+  return static_cast<unsigned int>(ceil_div(rows, kRowsPerBlock));
+}
+
+template <typename T, int kPer>
+void launch_warp(const T* in, T* out, int64_t rows, int64_t r, cudaStream_t stream) {
+  softmax_warp_kernel<T, kPer>
+      <<<warp_grid(rows), kRowsPerBlock * kWarpSize, 0, stream>>>(in, out, rows, r);
+}
+
+}  // namespace
+
+void softmax(const Tensor& in, Tensor& out, int64_t outer, int64_t r, int64_t inner) {
+  if (outer * r * inner == 0) return;
+  DeviceGuard guard(in.device().index);
+  cudaStream_t stream = current_stream(in.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(in.dtype(), "softmax", [&] {
+    using T = device_t<scalar_t>;
+    const T* x = device_ptr<scalar_t>(in);
+    T* y = device_ptr<scalar_t>(out);
+    if (inner > 1) {
+      softmax_columns_kernel<T>
+          <<<grid_size(outer * inner), kNumThreads, 0, stream>>>(x, y, outer, r, inner);
+    } else if (r <= kMaxWarpCols) {
+      // Smallest power-of-two register bucket that holds the row.
+      const int64_t per = ceil_div(r, kWarpSize);
+      if (per <= 1) {
+        launch_warp<T, 1>(x, y, outer, r, stream);
+      } else if (per <= 2) {
+        launch_warp<T, 2>(x, y, outer, r, stream);
+      } else if (per <= 4) {
+        launch_warp<T, 4>(x, y, outer, r, stream);
+      } else if (per <= 8) {
+        launch_warp<T, 8>(x, y, outer, r, stream);
+      } else if (per <= 16) {
+        launch_warp<T, 16>(x, y, outer, r, stream);
+      } else {
+        launch_warp<T, 32>(x, y, outer, r, stream);
+      }
+    } else {
+      softmax_block_kernel<T>
+          <<<static_cast<unsigned int>(outer), 4 * kNumThreads, 0, stream>>>(x, y, r);
+    }
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+void softmax_backward(const Tensor& grad, const Tensor& out, Tensor& grad_in, int64_t outer,
+                      int64_t r, int64_t inner) {
+  if (outer * r * inner == 0) return;
+  DeviceGuard guard(out.device().index);
+  cudaStream_t stream = current_stream(out.device().index);
+  XFT_DISPATCH_FLOATING_AND_HALF_TYPES(out.dtype(), "softmax_backward", [&] {
+    using T = device_t<scalar_t>;
+    const T* g = device_ptr<scalar_t>(grad);
+    const T* y = device_ptr<scalar_t>(out);
+    T* d = device_ptr<scalar_t>(grad_in);
+    if (inner > 1) {
+      softmax_backward_columns_kernel<T>
+          <<<grid_size(outer * inner), kNumThreads, 0, stream>>>(g, y, d, outer, r, inner);
+    } else {
+      softmax_backward_warp_kernel<T>
+          <<<warp_grid(outer), kRowsPerBlock * kWarpSize, 0, stream>>>(g, y, d, outer, r);
+    }
+  });
+  XFT_CUDA_KERNEL_LAUNCH_CHECK();
+}
+
+}  // namespace xft::cuda
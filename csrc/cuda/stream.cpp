@@ -0,0 +1,38 @@
+#include "cuda/stream.h"
+
+#include <vector>
+
+#include "cuda/cuda_utils.h"
+
+namespace xft::cuda {
+
+namespace {
+thread_local std::vector<cudaStream_t> t_current_streams;
+}
+
+cudaStream_t current_stream(int device) {
+  XFT_CHECK(device >= 0, "invalid CUDA device ", device);
+  if (static_cast<size_t>(device) >= t_current_streams.size()) return nullptr;
+  return t_current_streams[device];
+}
+
+void set_current_stream(int device, cudaStream_t stream) {
+  XFT_CHECK(device >= 0, "invalid CUDA device ", device);
+  if (static_cast<size_t>(device) >= t_current_streams.size()) {
+    t_current_streams.resize(device + 1, nullptr);
+  }
+  t_current_streams[device] = stream;
+}
+
+cudaStream_t create_stream(int device, int priority) {
+  DeviceGuard guard(device);
+  cudaStream_t stream = nullptr;
+  XFT_CUDA_CHECK(cudaStreamCreateWithPriority(&stream, cudaStreamNonBlocking, priority));
+  return stream;
+}
+
+void destroy_stream(cudaStream_t stream) {
+  if (stream != nullptr) XFT_CUDA_CHECK(cudaStreamDestroy(stream));
+}
+
+}  // namespace xft::cuda
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cuda_runtime.h>
+
+namespace xft::cuda {
+
+// The stream that work for `device` is enqueued on from the calling thread.
+// Defaults to the legacy default stream (nullptr).
+cudaStream_t current_stream(int device);
+void set_current_stream(int device, cudaStream_t stream);
+
+// Streams created here never block on the legacy default stream; ordering
+// between streams is expressed with events.
+cudaStream_t create_stream(int device, int priority = 0);
+void destroy_stream(cudaStream_t stream);
+
+// Scoped current-stream override, restored on destruction.
+class StreamGuard {
+ public:
+  StreamGuard(int device, cudaStream_t stream) : device_(device), prev_(current_stream(device)) {
+    set_current_stream(device, stream);
+  }
+  ~StreamGuard() { set_current_stream(device_, prev_); }
+
+  StreamGuard(const StreamGuard&) = delete;
+  StreamGuard& operator=(const StreamGuard&) = delete;
+
+ private:
+  int device_;
+  cudaStream_t prev_;
+};
+
+}  // namespace xft::cuda
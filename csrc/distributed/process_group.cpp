@@ -0,0 +1,133 @@
+#include "distributed/process_group.h"
+
+#include "cuda/cuda_utils.h"
+#include "cuda/stream.h"
+
+#define XFT_NCCL_CHECK(expr)                                                     \
+  do {                                                                           \
+    ncclResult_t res__ = (expr);                                                 \
+    XFT_CHECK(res__ == ncclSuccess, "NCCL error: ", ncclGetErrorString(res__), \
+              " (", #expr, ")");                                                 \
+  } while (0)
+
+namespace xft::distributed {
+
+namespace {
+
+ncclDataType_t nccl_dtype(DType dtype) {
+  switch (dtype) {
+    case DType::Float32: return ncclFloat32;
+    case DType::Float64: return ncclFloat64;
+    case DType::Float16: return ncclFloat16;
+    case DType::BFloat16: return ncclBfloat16;
+    case DType::Int32: return ncclInt32;
+    case DType::Int64: return ncclInt64;
+    case DType::Int8: return ncclInt8;
+    case DType::UInt8:
+    case DType::Bool: return ncclUint8;
+  }
+  XFT_FAIL("unknown dtype");
+}
+
+}  // namespace
+
+std::string ProcessGroupNCCL::unique_id() {
+  ncclUniqueId id;
+  XFT_NCCL_CHECK(ncclGetUniqueId(&id));
+  return std::string(id.internal, sizeof(id.internal));
+}
+
+ProcessGroupNCCL::ProcessGroupNCCL(const std::string& unique_id, int rank, int world_size,
+                                   int device)
+    : rank_(rank), world_size_(world_size), device_(device) {
+  XFT_CHECK(world_size > 0 && rank >= 0 && rank < world_size, "ProcessGroupNCCL: rank ", rank,
+            " is out of range for world size ", world_size);
+  ncclUniqueId id;
+  XFT_CHECK(unique_id.size() == sizeof(id.internal), "ProcessGroupNCCL: the unique id must be ",
+            sizeof(id.internal), " bytes, got ", unique_id.size());
+  unique_id.copy(id.internal, sizeof(id.internal));
+  cuda::DeviceGuard guard(device);
+  XFT_NCCL_CHECK(ncclCommInitRank(&comm_, world_size, id, rank));
+  try {
+    stream_ = cuda::create_stream(device);
+    XFT_CUDA_CHECK(cudaEventCreateWithFlags(&event_, cudaEventDisableTiming));
+  } catch (...) {
+    cuda::destroy_stream(stream_);
+    ncclCommDestroy(comm_);
+    throw;
+  }
+}
+
+ProcessGroupNCCL::~ProcessGroupNCCL() {
+  cuda::DeviceGuard guard(device_);
+  cudaStreamSynchronize(stream_);
+  cudaEventDestroy(event_);
+  cudaStreamDestroy(stream_);
+  ncclCommDestroy(comm_);
+}
+
+void ProcessGroupNCCL::check_tensor(const char* op, const Tensor& t) const {
+  XFT_CHECK(t.defined() && t.device().is_cuda() && t.device().index == device_, op,
+            ": expected a tensor on cuda:", device_);
+  XFT_CHECK(t.is_contiguous(), op, ": expected a contiguous tensor");
+}
+
+void ProcessGroupNCCL::wait_for_current() {
+  XFT_CUDA_CHECK(cudaEventRecord(event_, cuda::current_stream(device_)));
+  XFT_CUDA_CHECK(cudaStreamWaitEvent(stream_, event_, 0));
+}
+
+void ProcessGroupNCCL::all_reduce_async(const Tensor& t, bool average) {
+  check_tensor("all_reduce", t);
+  XFT_CHECK(!average || is_floating(t.dtype()), "all_reduce: averaging needs a floating tensor");
+  if (t.numel() == 0) return;
+  cuda::DeviceGuard guard(device_);
+  wait_for_current();
+  t.storage()->bump_version();
+  XFT_NCCL_CHECK(ncclAllReduce(t.data_ptr(), t.data_ptr(), static_cast<size_t>(t.numel()),
+                               nccl_dtype(t.dtype()), average ? ncclAvg : ncclSum, comm_,
+                               stream_));
+}
+
+void ProcessGroupNCCL::broadcast_async(const Tensor& t, int root) {
+  broadcast_async(std::vector<Tensor>{t}, root);
+}
+
+void ProcessGroupNCCL::broadcast_async(const std::vector<Tensor>& tensors, int root) {
+  XFT_CHECK(root >= 0 && root < world_size_, "broadcast: root ", root,
+            " is out of range for world size ", world_size_);
+  for (const Tensor& t : tensors) check_tensor("broadcast", t);
+  cuda::DeviceGuard guard(device_);
+  wait_for_current();
+  XFT_NCCL_CHECK(ncclGroupStart());
+  for (const Tensor& t : tensors) {
+    if (t.numel() == 0) continue;
+    t.storage()->bump_version();
+    const ncclResult_t res = ncclBroadcast(t.data_ptr(), t.data_ptr(),
+                                           static_cast<size_t>(t.numel()), nccl_dtype(t.dtype()),
+                                           root, comm_, stream_);
+    if (res != ncclSuccess) {
+      ncclGroupEnd();
+      XFT_NCCL_CHECK(res);
+    }
+  }
+  XFT_NCCL_CHECK(ncclGroupEnd());
+}
+
+void ProcessGroupNCCL::wait() {
+  cuda::DeviceGuard guard(device_);
+  XFT_CUDA_CHECK(cudaEventRecord(event_, stream_));
+  XFT_CUDA_CHECK(cudaStreamWaitEvent(cuda::current_stream(device_), event_, 0));
+}
+
+void ProcessGroupNCCL::all_reduce_(const Tensor& t, bool average) {
+  all_reduce_async(t, average);
+  wait();
+}
+
+void ProcessGroupNCCL::broadcast_(const Tensor& t, int root) {
+  broadcast_async(t, root);
+  wait();
+}
+
+}  // namespace xft::distributed
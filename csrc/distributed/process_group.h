@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cuda_runtime.h>
+#include <nccl.h>
+
+#include <string>
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace xft::distributed {
+
+// One rank of an NCCL communicator over `world_size` processes, one GPU
+// each. Collectives run on the group's own communication stream, ordered
+// after the work already queued on the caller's current stream, so they
+// overlap with whatever the caller enqueues next.
+class ProcessGroupNCCL {
+ public:
+  // A fresh id for a new communicator: rank 0 makes it and every rank
+  // passes the same bytes (NCCL_UNIQUE_ID_BYTES of them) to the constructor.
+  static std::string unique_id();
+
+  // Blocks until all world_size ranks have joined.
+  ProcessGroupNCCL(const std::string& unique_id, int rank, int world_size, int device);
+  ~ProcessGroupNCCL();
+
+  ProcessGroupNCCL(const ProcessGroupNCCL&) = delete;
+  ProcessGroupNCCL& operator=(const ProcessGroupNCCL&) = delete;
+
+  int rank() const { return rank_; }
+  int world_size() const { return world_size_; }
+  int device() const { return device_; }
+  cudaStream_t stream() const { return stream_; }
+
+  // Asynchronous collectives on stream(), in place on dense tensors of this
+  // group's device. The comm stream first waits for the current stream;
+  // call wait() before using the results on it.
+  void all_reduce_async(const Tensor& t, bool average);
+  void broadcast_async(const Tensor& t, int root);
+  // Several asynchronous collectives fused into one NCCL group launch.
+  void broadcast_async(const std::vector<Tensor>& tensors, int root);
+  // Makes the current stream wait for everything queued on stream().
+  void wait();
+
+  // all_reduce_async / broadcast_async followed by wait().
+  void all_reduce_(const Tensor& t, bool average = false);
+  void broadcast_(const Tensor& t, int root);
+
+ private:
+  void check_tensor(const char* op, const Tensor& t) const;
+  // The comm stream waits for the current stream.
+  void wait_for_current();
+
+  int rank_;
+  int world_size_;
+  int device_;
+  ncclComm_t comm_ = nullptr;
+  cudaStream_t stream_ = nullptr;
+  cudaEvent_t event_ = nullptr;
+};
+
+}  // namespace xft::distributed
@@ -0,0 +1,158 @@
+#include "distributed/reducer.h"
+
+#include <unordered_set>
+
+#include "autograd/engine.h"
+#include "autograd/grad_mode.h"
+#include "autograd/node.h"
+
+namespace xft::distributed {
+
+namespace {
+
+// Views start on 16-byte boundaries, so kernels reading a grad get the
+// same alignment as from a buffer of its own.
+constexpr int64_t kViewAlignBytes = 16;
+
+}  // namespace
+
+Reducer::Reducer(std::shared_ptr<ProcessGroupNCCL> group, std::vector<Tensor> params,
+                 int64_t bucket_cap_bytes)
+    : group_(std::move(group)), params_(std::move(params)) {
+  XFT_CHECK(group_ != nullptr, "DistributedDataParallel: null process group");
+  XFT_CHECK(!params_.empty(), "DistributedDataParallel: got an empty parameter list");
+  XFT_CHECK(bucket_cap_bytes > 0, "DistributedDataParallel: bucket_cap_bytes must be positive");
+  std::unordered_set<const TensorImpl*> seen;
+  for (size_t i = 0; i < params_.size(); i++) {
+    const Tensor& p = params_[i];
+    XFT_CHECK(p.defined() && p.requires_grad() && p.is_leaf(), "DistributedDataParallel: "
+              "parameter ", i, " is not a leaf that requires grad");
+    XFT_CHECK(p.device().is_cuda() && p.device().index == group_->device(),
+              "DistributedDataParallel: parameter ", i, " is on ", p.device().str(),
+              ", expected cuda:", group_->device());
+    XFT_CHECK(is_floating(p.dtype()) && p.is_contiguous(), "DistributedDataParallel: "
+              "parameter ", i, " must be a dense floating tensor");
+    XFT_CHECK(seen.insert(p.impl()).second, "DistributedDataParallel: parameter ", i,
+              " appears twice");
+  }
+  {
+    autograd::NoGradGuard no_grad;
+    group_->broadcast_async(params_, 0);
+    group_->wait();
+  }
+  build_buckets(bucket_cap_bytes);
+  for (size_t i = 0; i < params_.size(); i++) {
+    slots_[i].hook_id = autograd::add_post_accumulate_grad_hook(
+        params_[i], [this, i](const Tensor&) { on_grad(i); });
+  }
+}
+
+Reducer::~Reducer() {
+  for (size_t i = 0; i < params_.size(); i++) {
+    if (slots_[i].hook_id >= 0) {
+      autograd::remove_post_accumulate_grad_hook(params_[i], slots_[i].hook_id);
+    }
+  }
+}
+
+void Reducer::build_buckets(int64_t bucket_cap_bytes) {
+  // Per bucket: the parameters and where each one's grad starts.
+  std::vector<std::vector<std::pair<size_t, int64_t>>> layout;
+  std::vector<int64_t> bucket_bytes;
+  std::vector<DType> bucket_dtype;
+  slots_.resize(params_.size());
+  for (size_t k = params_.size(); k-- > 0;) {
+    const Tensor& p = params_[k];
+    const int64_t esize = static_cast<int64_t>(p.element_size());
+    const int64_t bytes = p.numel() * esize;
+    // The newest bucket of this dtype, unless this parameter would overflow it.
+    size_t b = layout.size();
+    for (size_t j = layout.size(); j-- > 0;) {
+      if (bucket_dtype[j] != p.dtype()) continue;
+      if (bucket_bytes[j] + bytes <= bucket_cap_bytes) b = j;
+      break;
+    }
+    if (b == layout.size()) {
+      layout.emplace_back();
+      bucket_bytes.push_back(0);
+      bucket_dtype.push_back(p.dtype());
+    }
+    layout[b].emplace_back(k, bucket_bytes[b] / esize);
+    bucket_bytes[b] += (bytes + kViewAlignBytes - 1) / kViewAlignBytes * kViewAlignBytes;
+  }
+
+  autograd::NoGradGuard no_grad;
+  const Device device = params_[0].device();
+  buckets_.resize(layout.size());
+  for (size_t b = 0; b < layout.size(); b++) {
+    Bucket& bucket = buckets_[b];
+    const int64_t esize = static_cast<int64_t>(xft::element_size(bucket_dtype[b]));
+    bucket.buffer = Tensor::zeros({bucket_bytes[b] / esize}, bucket_dtype[b], device);
+    for (const auto& [k, offset] : layout[b]) {
+      const Tensor& p = params_[k];
+      Slot& slot = slots_[k];
+      slot.bucket = b;
+      slot.view = Tensor::from_storage(bucket.buffer.storage(), p.sizes(),
+                                       contiguous_strides(p.sizes()), offset, p.dtype());
+      const Tensor grad = p.grad();
+      if (grad.defined()) slot.view.copy_(grad);
+      params_[k].set_grad(slot.view);
+      bucket.params.push_back(k);
+    }
+  }
+}
+
+void Reducer::start_pass() {
+  pass_id_ = autograd::backward_pass_id();
+  next_bucket_ = 0;
+  for (Slot& slot : slots_) slot.ready = false;
+  for (Bucket& bucket : buckets_) bucket.pending = bucket.params.size();
+  autograd::queue_callback([this] { finalize(); });
+}
+
+void Reducer::on_grad(size_t index) {
+  if (!sync_) return;
+  if (pass_id_ != autograd::backward_pass_id()) start_pass();
+  Slot& slot = slots_[index];
+  XFT_CHECK(!slot.ready, "DistributedDataParallel: parameter ", index,
+            " got its gradient more than once in one backward pass, so its bucket may already "
+            "be reduced; use it once per pass, outside checkpointed segments");
+  Tensor& param = params_[index];
+  const Tensor grad = param.grad();
+  if (grad.impl() != slot.view.impl()) {
+    slot.view.copy_(grad);
+    param.set_grad(slot.view);
+  }
+  slot.ready = true;
+  if (--buckets_[slot.bucket].pending == 0) launch_ready();
+}
+
+void Reducer::launch_ready() {
+  while (next_bucket_ < buckets_.size() && buckets_[next_bucket_].pending == 0) {
+    group_->all_reduce_async(buckets_[next_bucket_].buffer, /*average=*/true);
+    next_bucket_++;
+  }
+}
+
+void Reducer::finalize() {
+  for (size_t i = 0; i < slots_.size(); i++) {
+    Slot& slot = slots_[i];
+    if (slot.ready) continue;
+    // Unused in this pass: other ranks may have used it, so it still
+    // takes part, with the grad it had or zeros.
+    Tensor& param = params_[i];
+    const Tensor grad = param.grad();
+    if (!grad.defined()) {
+      slot.view.fill_(0.0);
+    } else if (grad.impl() != slot.view.impl()) {
+      slot.view.copy_(grad);
+    }
+    param.set_grad(slot.view);
+    slot.ready = true;
+    buckets_[slot.bucket].pending--;
+  }
+  launch_ready();
+  group_->wait();
+}
+
+}  // namespace xft::distributed
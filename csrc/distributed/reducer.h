@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/tensor.h"
+#include "distributed/process_group.h"
+
+namespace xft::distributed {
+
+// The gradient side of DistributedDataParallel: averages the grads of
+// `params` across the ranks of a process group while backward is still
+// running.
+//
+// Parameters are packed, in reverse order (roughly the order backward
+// produces their grads), into buckets of about bucket_cap_bytes, one flat
+// buffer per bucket, and each parameter's grad() becomes a view into its
+// bucket. A post-accumulate-grad hook on each parameter moves its new grad
+// into place; when every grad of a bucket is in, the bucket is all-reduced
+// on the group's stream while backward goes on computing the rest.
+// Buckets launch in index order, so every rank issues the same sequence of
+// collectives. At the end of the pass, parameters backward never reached
+// contribute zeros (or the grad they already had), the remaining buckets
+// launch, and the current stream waits for all of them; after backward()
+// returns, every rank holds the same averaged grads.
+//
+// Every rank must construct its Reducer with the same parameters, in the
+// same order. Construction broadcasts the parameter values from rank 0.
+class Reducer {
+ public:
+  static constexpr int64_t kDefaultBucketCapBytes = 25 << 20;
+
+  Reducer(std::shared_ptr<ProcessGroupNCCL> group, std::vector<Tensor> params,
+          int64_t bucket_cap_bytes = kDefaultBucketCapBytes);
+  ~Reducer();
+
+  Reducer(const Reducer&) = delete;
+  Reducer& operator=(const Reducer&) = delete;
+
+  // With sync off, backward only accumulates local grads; the next pass
+  // with sync on reduces the sum (gradient accumulation without a
+  // collective per micro-batch).
+  void set_sync(bool enabled) { sync_ = enabled; }
+  bool sync() const { return sync_; }
+
+  size_t num_buckets() const { return buckets_.size(); }
+
+ private:
+  struct Bucket {
+    Tensor buffer;
+    std::vector<size_t> params;
+    size_t pending = 0;  // grads still missing in the current pass
+  };
+  struct Slot {
+    size_t bucket;
+    Tensor view;  // this parameter's grad, inside its bucket's buffer
+    int64_t hook_id = -1;
+    bool ready = false;
+  };
+
+  void build_buckets(int64_t bucket_cap_bytes);
+  void start_pass();
+  void on_grad(size_t index);
+  void launch_ready();
+  void finalize();
+
+  std::shared_ptr<ProcessGroupNCCL> group_;
+  std::vector<Tensor> params_;
+  std::vector<Slot> slots_;
+  std::vector<Bucket> buckets_;
+  size_t next_bucket_ = 0;  // first bucket not launched this pass
+  uint64_t pass_id_ = 0;  // the backward pass the state above belongs to
+  bool sync_ = true;
+};
+
+}  // namespace xft::distributed
@@ -0,0 +1,88 @@
+#pragma once
+
+// The lazy graph and the flat program it lowers to. Internal to csrc/lazy
+// and the backends that run programs (cuda/fuser.h).
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/tensor.h"
+#include "core/tensor_iterator.h"
+#include "lazy/memory_plan.h"
+#include "ops/op_kinds.h"
+
+namespace xft::lazy {
+
+// A program reads at most this many distinct inputs: one TensorIterator
+// carries them all, plus the output.
+constexpr int kMaxInputs = TensorIterator::kMaxOperands - 1;
+// Ops per graph before the argument of the next op is materialized.
+constexpr int kMaxOps = 64;
+
+// A node of the expression graph. Pending tensors point at their root;
+// nodes are immutable once built and shared between graphs.
+struct Expr {
+  enum class Kind { Input, Unary, Binary };
+
+  Kind kind = Kind::Input;
+  UnaryOp unary = UnaryOp::Exp;
+  BinaryOp binary = BinaryOp::Add;
+  std::shared_ptr<const Expr> a, b;
+
+  // Kind::Input: the materialized tensor and its storage version when it
+  // was traced.
+  Tensor input;
+  uint64_t version = 0;
+
+  Shape sizes;
+  DType dtype = DType::Float32;
+  Device device;
+
+  // Ops in the subtree (shared subtrees counted once per use, so an upper
+  // bound) and the distinct inputs it reads.
+  int ops = 0;
+  std::vector<const TensorImpl*> inputs;
+};
+
+using ExprPtr = std::shared_ptr<const Expr>;
+
+// A graph lowered to straight-line code. Operands are inputs (index into
+// `inputs`, operand 1 + index of the TensorIterator) or earlier results
+// held in scratch slots; the last instruction writes the output.
+struct Program {
+  struct Operand {
+    bool input = false;
+    int index = 0;  // input number, or scratch slot
+  };
+  struct Instr {
+    bool binary = false;
+    UnaryOp unary = UnaryOp::Exp;
+    BinaryOp binary_op = BinaryOp::Add;
+    Operand a, b;
+    int slot = 0;  // where the result goes, unless it is the last
+    Shape sizes;   // of the result
+  };
+
+  std::vector<Tensor> inputs;
+  std::vector<Instr> code;
+  // Slots hold one chunk (CPU) or one value (a fused CUDA kernel) per
+  // intermediate; a result may take the slot of an operand it consumes.
+  int num_slots = 0;
+  DType dtype = DType::Float32;
+  // The intermediates at full size, packed into one arena: how the CUDA
+  // op-by-op fallback runs, and the bound plan_stats() reports.
+  MemoryPlan arena;
+
+  // The program's structure (ops, operand wiring and dtype) without shapes
+  // or strides: programs with the same signature can share a kernel.
+  std::string signature() const;
+};
+
+Program lower(const Expr& root);
+
+// Backends report every kernel lookup: compiled (a cache miss) or not.
+void count_kernel_lookup(bool compiled);
+
+}  // namespace xft::lazy
@@ -0,0 +1,378 @@
+#include "lazy/lazy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+#include "autograd/grad_mode.h"
+#include "core/dispatch.h"
+#include "core/parallel.h"
+#include "cpu/kernels.h"
+#include "lazy/ir.h"
+
+#ifdef XFT_USE_NVRTC
+#include "cuda/fuser.h"
+#endif
+
+namespace xft::lazy {
+
+namespace {
+
+thread_local bool t_enabled = false;
+
+struct Counters {
+  std::atomic<int64_t> traced_ops{0};
+  std::atomic<int64_t> materializations{0};
+  std::atomic<int64_t> fused_ops{0};
+  std::atomic<int64_t> kernel_compiles{0};
+  std::atomic<int64_t> kernel_cache_hits{0};
+};
+
+Counters g_counters;
+
+// Elements per CPU chunk: every live intermediate gets a chunk of scratch,
+// which should stay in L1/L2 while the chunk's instructions run.
+constexpr int64_t kChunk = 512;
+// Arena buffers start on cache-line boundaries, like CPU allocations.
+constexpr int64_t kArenaAlignment = 64;
+
+bool traceable(const Tensor& t) {
+  return t.defined() && is_floating(t.dtype()) && t.numel() > 0;
+}
+
+bool records_grad(const Tensor& a, const Tensor& b = Tensor()) {
+  return autograd::GradMode::is_enabled() &&
+         (a.requires_grad() || (b.defined() && b.requires_grad()));
+}
+
+ExprPtr input_expr(const Tensor& t) {
+  auto e = std::make_shared<Expr>();
+  e->input = t;
+  e->version = t.storage()->version();
+  e->sizes = t.sizes();
+  e->dtype = t.dtype();
+  e->device = t.device();
+  e->inputs = {t.impl()};
+  return e;
+}
+
+// A pending tensor's own graph, or a fresh input.
+ExprPtr expr_of(const Tensor& t) { return t.is_lazy() ? t.impl()->lazy : input_expr(t); }
+
+int ops_of(const Tensor& t) { return t.is_lazy() ? t.impl()->lazy->ops : 0; }
+
+std::vector<const TensorImpl*> inputs_of(const Tensor& t) {
+  return t.is_lazy() ? t.impl()->lazy->inputs : std::vector<const TensorImpl*>{t.impl()};
+}
+
+std::vector<const TensorImpl*> merge(std::vector<const TensorImpl*> a,
+                                     const std::vector<const TensorImpl*>& b) {
+  for (const TensorImpl* p : b) {
+    if (std::find(a.begin(), a.end(), p) == a.end()) a.push_back(p);
+  }
+  return a;
+}
+
+// The storage is allocated when the graph runs, so intermediates that are
+// never materialized cost no memory.
+Tensor make_pending(std::shared_ptr<Expr> e) {
+  auto storage = std::make_shared<Storage>(
+      shape_numel(e->sizes) * element_size(e->dtype), e->device, /*deferred=*/true);
+  Tensor out = Tensor::from_storage(std::move(storage), e->sizes, contiguous_strides(e->sizes),
+                                    0, e->dtype);
+  out.impl()->inference = autograd::InferenceMode::is_enabled();
+  out.impl()->lazy = std::move(e);
+  g_counters.traced_ops++;
+  return out;
+}
+
+// Chunk by chunk through the kernel table: inputs are read in place through
+// their strides, intermediates live in per-thread scratch and the last
+// instruction writes the output.
+void run_cpu(const Program& p, const TensorIterator& iter) {
+  const cpu::ElementwiseLoops& table = *cpu::cpu_kernels().loops;
+  const DType dtype = p.dtype;
+  // Each instruction's loop, found once rather than per chunk.
+  std::vector<cpu::UnaryLoop> unary(p.code.size());
+  std::vector<cpu::BinaryLoop> binary(p.code.size());
+  for (size_t i = 0; i < p.code.size(); i++) {
+    const Program::Instr& ins = p.code[i];
+    if (ins.binary) {
+      binary[i] = table.binary.lookup(ins.binary_op, iter.device(), dtype, "lazy");
+    } else {
+      unary[i] = table.unary.lookup(ins.unary, iter.device(), dtype, "lazy");
+    }
+  }
+  const int64_t el = static_cast<int64_t>(element_size(dtype));
+  const size_t last = p.code.size() - 1;
+  const int64_t grain = std::max<int64_t>(kChunk, kGrainSize / static_cast<int64_t>(last + 1));
+  iter.for_each(
+      [&](char** data, const int64_t* strides, int64_t n) {
+        thread_local std::vector<char> scratch;
+        scratch.resize(static_cast<size_t>(std::max(p.num_slots, 1) * kChunk * el));
+        for (int64_t j = 0; j < n; j += kChunk) {
+          const int64_t m = std::min(kChunk, n - j);
+          auto operand = [&](const Program::Operand& o, int64_t& step) -> const void* {
+            if (o.input) {
+              step = strides[1 + o.index] / el;
+              return data[1 + o.index] + j * strides[1 + o.index];
+            }
+            step = 1;
+            return scratch.data() + o.index * kChunk * el;
+          };
+          for (size_t i = 0; i <= last; i++) {
+            const Program::Instr& ins = p.code[i];
+            void* dst = i == last ? static_cast<void*>(data[0] + j * strides[0])
+                                  : scratch.data() + ins.slot * kChunk * el;
+            const int64_t dst_step = i == last ? strides[0] / el : 1;
+            int64_t sa = 0, sb = 0;
+            const void* a = operand(ins.a, sa);
+            if (ins.binary) {
+              const void* b = operand(ins.b, sb);
+              binary[i](a, sa, b, sb, dst, dst_step, m);
+            } else {
+              unary[i](a, sa, dst, dst_step, m);
+            }
+          }
+        }
+      },
+      grain);
+}
+
+#ifdef XFT_USE_CUDA
+// One eager kernel per instruction: the fallback when the graph cannot be
+// compiled into a single kernel. The full-size intermediates are views of
+// one arena laid out by the program's memory plan, so the whole graph makes
+// a single allocation.
+void run_op_by_op(const Program& p, const TensorIterator& iter) {
+  const int64_t el = static_cast<int64_t>(element_size(p.dtype));
+  auto arena = std::make_shared<Storage>(p.arena.arena_bytes, iter.device());
+  // Results by slot, whose lifetimes the slot plan already keeps apart.
+  std::vector<Tensor> slots(p.num_slots);
+  auto value = [&](const Program::Operand& o) -> const Tensor& {
+    return o.input ? p.inputs[o.index] : slots[o.index];
+  };
+  for (size_t i = 0; i < p.code.size(); i++) {
+    const Program::Instr& ins = p.code[i];
+    const bool last = i + 1 == p.code.size();
+    const Tensor out =
+        last ? iter.output()
+             : Tensor::from_storage(arena, ins.sizes, contiguous_strides(ins.sizes),
+                                    p.arena.offsets[i] / el, p.dtype);
+    TensorIterator step;
+    step.add_output(out).add_input(value(ins.a));
+    if (ins.binary) step.add_input(value(ins.b));
+    step.build();
+    const auto& table = elementwise_kernels();
+    if (ins.binary) {
+      table.binary.lookup(ins.binary_op, step.device(), step.dtype(), "lazy")(step);
+    } else {
+      table.unary.lookup(ins.unary, step.device(), step.dtype(), "lazy")(step);
+    }
+    if (!last) slots[ins.slot] = out;
+  }
+}
+#endif
+
+}  // namespace
+
+bool LazyMode::is_enabled() { return t_enabled; }
+
+void LazyMode::set_enabled(bool enabled) { t_enabled = enabled; }
+
+Tensor trace_unary(UnaryOp op, const Tensor& t) {
+  if (!t_enabled || !traceable(t) || records_grad(t)) return Tensor();
+  Tensor arg = t;
+  if (ops_of(arg) + 1 > kMaxOps) arg.materialize();
+  ExprPtr a = expr_of(arg);
+  auto e = std::make_shared<Expr>();
+  e->kind = Expr::Kind::Unary;
+  e->unary = op;
+  e->sizes = a->sizes;
+  e->dtype = a->dtype;
+  e->device = a->device;
+  e->ops = a->ops + 1;
+  e->inputs = a->inputs;
+  e->a = std::move(a);
+  return make_pending(std::move(e));
+}
+
+Tensor trace_binary(BinaryOp op, const Tensor& a, const Tensor& b) {
+  if (!t_enabled || !traceable(a) || !traceable(b) || a.dtype() != b.dtype() ||
+      a.device() != b.device() || records_grad(a, b)) {
+    return Tensor();
+  }
+  // Keep the combined graph within one program, materializing the bigger
+  // pending side (at most twice) until it fits.
+  Tensor x = a, y = b;
+  auto fits = [&] {
+    return ops_of(x) + ops_of(y) + 1 <= kMaxOps &&
+           static_cast<int>(merge(inputs_of(x), inputs_of(y)).size()) <= kMaxInputs;
+  };
+  while (!fits()) {
+    Tensor& big = ops_of(x) >= ops_of(y) ? x : y;
+    big.materialize();
+  }
+  ExprPtr ex = expr_of(x), ey = expr_of(y);
+  auto e = std::make_shared<Expr>();
+  e->kind = Expr::Kind::Binary;
+  e->binary = op;
+  e->sizes = broadcast_shapes(ex->sizes, ey->sizes);
+  e->dtype = ex->dtype;
+  e->device = ex->device;
+  e->ops = ex->ops + ey->ops + 1;
+  e->inputs = merge(ex->inputs, ey->inputs);
+  e->a = std::move(ex);
+  e->b = std::move(ey);
+  return make_pending(std::move(e));
+}
+
+std::string Program::signature() const {
+  std::string s = dtype_name(dtype);
+  s += ":" + std::to_string(inputs.size());
+  auto operand = [](const Operand& o) {
+    return (o.input ? "i" : "s") + std::to_string(o.index);
+  };
+  for (const Instr& ins : code) {
+    s += ins.binary ? ";b" + std::to_string(static_cast<int>(ins.binary_op))
+                    : ";u" + std::to_string(static_cast<int>(ins.unary));
+    s += "(" + operand(ins.a);
+    if (ins.binary) s += "," + operand(ins.b);
+    s += ")s" + std::to_string(ins.slot);
+  }
+  return s;
+}
+
+Program lower(const Expr& root) {
+  XFT_CHECK(root.kind != Expr::Kind::Input, "lazy: nothing to run");
+  Program p;
+  p.dtype = root.dtype;
+  // Post-order, each shared node once. Results first refer to instructions
+  // by number; slots are assigned below.
+  std::unordered_map<const Expr*, Program::Operand> done;
+  std::unordered_map<const TensorImpl*, int> input_index;
+  std::function<Program::Operand(const Expr&)> visit = [&](const Expr& e) {
+    if (auto it = done.find(&e); it != done.end()) return it->second;
+    Program::Operand out;
+    if (e.kind == Expr::Kind::Input) {
+      XFT_CHECK(e.input.storage()->version() == e.version,
+                "lazy: an input of a pending tensor was modified in place; materialize "
+                "pending results before writing to their inputs");
+      auto [it, inserted] =
+          input_index.try_emplace(e.input.impl(), static_cast<int>(p.inputs.size()));
+      if (inserted) p.inputs.push_back(e.input);
+      out = {true, it->second};
+    } else {
+      Program::Instr ins;
+      ins.binary = e.kind == Expr::Kind::Binary;
+      ins.unary = e.unary;
+      ins.binary_op = e.binary;
+      ins.sizes = e.sizes;
+      ins.a = visit(*e.a);
+      if (ins.binary) ins.b = visit(*e.b);
+      p.code.push_back(ins);
+      out = {false, static_cast<int>(p.code.size()) - 1};
+    }
+    done.emplace(&e, out);
+    return out;
+  };
+  visit(root);
+
+  // Operands still name the instruction that produced them; plan the
+  // arena at full size and the slots at one unit per intermediate, then
+  // point operands at slots.
+  const int n = static_cast<int>(p.code.size());
+  std::vector<PlanNode> nodes(n), units(n);
+  for (int i = 0; i < n; i++) {
+    const Program::Instr& ins = p.code[i];
+    nodes[i].bytes = shape_numel(ins.sizes) * static_cast<int64_t>(element_size(p.dtype));
+    nodes[i].a = ins.a.input ? -1 : ins.a.index;
+    nodes[i].b = !ins.binary || ins.b.input ? -1 : ins.b.index;
+    units[i] = {1, nodes[i].a, nodes[i].b};
+  }
+  p.arena = plan_memory(nodes, kArenaAlignment);
+  const MemoryPlan slots = plan_memory(units, 1);
+  p.num_slots = static_cast<int>(slots.arena_bytes);
+  for (int i = 0; i < n; i++) {
+    Program::Instr& ins = p.code[i];
+    if (i + 1 < n) ins.slot = static_cast<int>(slots.offsets[i]);
+    if (!ins.a.input) ins.a.index = static_cast<int>(slots.offsets[ins.a.index]);
+    if (ins.binary && !ins.b.input) ins.b.index = static_cast<int>(slots.offsets[ins.b.index]);
+  }
+  return p;
+}
+
+void materialize(const Tensor& t) {
+  TensorImpl* impl = t.impl();
+  if (!impl->lazy) return;
+  // Lower first: if an input was overwritten the tensor stays pending.
+  const Program p = lower(*impl->lazy);
+  impl->lazy.reset();
+  impl->storage->allocate();
+  TensorIterator iter;
+  iter.add_output(t);
+  for (const Tensor& in : p.inputs) iter.add_input(in);
+  iter.build();
+  g_counters.materializations++;
+  g_counters.fused_ops += static_cast<int64_t>(p.code.size());
+#ifdef XFT_USE_CUDA
+  if (iter.device().is_cuda()) {
+#ifdef XFT_USE_NVRTC
+    if (cuda::run_fused(p, iter)) return;
+#endif
+    run_op_by_op(p, iter);
+    return;
+  }
+#endif
+  XFT_CHECK(iter.device().is_cpu(), "lazy: ", iter.device().str(),
+            " tensors are not supported yet");
+  run_cpu(p, iter);
+}
+
+void discard(const Tensor& t) {
+  TensorImpl* impl = t.impl();
+  if (!impl->lazy) return;
+  impl->lazy.reset();
+  impl->storage->allocate();
+}
+
+PlanStats plan_stats(const Tensor& t) {
+  PlanStats s;
+  s.output_bytes = static_cast<int64_t>(t.impl()->storage->nbytes());
+  if (!t.is_lazy()) return s;
+  const Program p = lower(*t.impl()->lazy);
+  const int64_t el = static_cast<int64_t>(element_size(p.dtype));
+  s.ops = static_cast<int64_t>(p.code.size());
+  s.arena_bytes = p.arena.arena_bytes;
+  s.unplanned_bytes = p.arena.unplanned_bytes;
+  s.in_place = p.arena.in_place;
+  s.scratch_bytes = p.num_slots * kChunk * el;
+  const bool cpu = t.device().is_cpu();
+  s.peak_bytes = s.output_bytes + (cpu ? s.scratch_bytes * get_num_threads() : s.arena_bytes);
+  return s;
+}
+
+void count_kernel_lookup(bool compiled) {
+  (compiled ? g_counters.kernel_compiles : g_counters.kernel_cache_hits)++;
+}
+
+Stats stats() {
+  Stats s;
+  s.traced_ops = g_counters.traced_ops.load();
+  s.materializations = g_counters.materializations.load();
+  s.fused_ops = g_counters.fused_ops.load();
+  s.kernel_compiles = g_counters.kernel_compiles.load();
+  s.kernel_cache_hits = g_counters.kernel_cache_hits.load();
+  return s;
+}
+
+void reset_stats() {
+  g_counters.traced_ops = 0;
+  g_counters.materializations = 0;
+  g_counters.fused_ops = 0;
+  g_counters.kernel_compiles = 0;
+  g_counters.kernel_cache_hits = 0;
+}
+
+}  // namespace xft::lazy
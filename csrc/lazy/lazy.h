@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/tensor.h"
+#include "ops/op_kinds.h"
+
+namespace xft::lazy {
+
+// Opt-in, per-thread trace-and-fuse mode for pointwise ops.
+//
+// While it is on, unary and (broadcasting) binary ops on floating tensors
+// return a pending tensor instead of running: its shape, dtype and device
+// are known and its storage is allocated, but nothing is computed. Ops on
+// pending tensors extend their expression graph. The first access to the
+// data (data_ptr(), storage(), any view, any other op) materializes it.
+// The whole graph then runs as one fused loop that reads each input once
+// and writes only the result, instead of one pass through memory per op.
+//
+// On CPU the fused loop evaluates the graph chunk by chunk through the
+// vectorized kernel table, keeping the intermediates in cache-sized
+// scratch. On CUDA built with XFT_USE_NVRTC each graph is compiled into
+// one kernel with NVRTC and cached by its signature. Without NVRTC the
+// graph runs op by op.
+//
+// Ops that autograd has to record (grad mode on and an input requiring
+// grad) always run eagerly, so training graphs are unaffected. A graph
+// reads its inputs when it is materialized. An input written in place in
+// between is reported as an error rather than silently read.
+struct LazyMode {
+  static bool is_enabled();
+  static void set_enabled(bool enabled);
+};
+
+// Sets lazy mode for a scope and restores the previous value on exit.
+class LazyModeGuard {
+ public:
+  explicit LazyModeGuard(bool enabled) : prev_(LazyMode::is_enabled()) {
+    LazyMode::set_enabled(enabled);
+  }
+  ~LazyModeGuard() { LazyMode::set_enabled(prev_); }
+
+  LazyModeGuard(const LazyModeGuard&) = delete;
+  LazyModeGuard& operator=(const LazyModeGuard&) = delete;
+
+ private:
+  bool prev_;
+};
+
+// The pending result of the op, or an undefined tensor when the op has to
+// run eagerly. Called by the elementwise ops while lazy mode is on.
+Tensor trace_unary(UnaryOp op, const Tensor& t);
+Tensor trace_binary(BinaryOp op, const Tensor& a, const Tensor& b);
+
+// Computes a pending tensor into its storage; Tensor::materialize() calls
+// this.
+void materialize(const Tensor& t);
+// Drops a pending tensor's graph without running it, for writers about to
+// overwrite all of it (copy_, fill_, out=), and allocates its storage.
+void discard(const Tensor& t);
+
+// What materializing a pending tensor will take, from the memory plan
+// lowering gives its graph (csrc/lazy/memory_plan.h), before anything runs.
+// Pending tensors hold no memory until then. The order of the fields is
+// the order xft_lazy_plan_stats() writes them in.
+struct PlanStats {
+  int64_t ops = 0;              // instructions in the program; 0 if not pending
+  int64_t output_bytes = 0;     // the result's own storage
+  int64_t arena_bytes = 0;      // every intermediate at full size, packed by the plan
+  int64_t unplanned_bytes = 0;  // the same intermediates with a buffer each
+  int64_t in_place = 0;         // intermediates written over an operand
+  int64_t scratch_bytes = 0;    // per CPU thread: one chunk per slot
+  // Output plus what the device runs the graph with: chunk scratch on
+  // every CPU thread, or the arena on CUDA (an upper bound: a kernel fused
+  // with NVRTC keeps intermediates in registers).
+  int64_t peak_bytes = 0;
+};
+
+constexpr int kNumPlanStats = sizeof(PlanStats) / sizeof(int64_t);
+
+PlanStats plan_stats(const Tensor& t);
+
+// Process-wide counters. The order of the fields is the order
+// xft_lazy_stats() writes them in.
+struct Stats {
+  int64_t traced_ops = 0;         // ops recorded instead of run
+  int64_t materializations = 0;   // graphs run
+  int64_t fused_ops = 0;          // ops run inside those graphs
+  int64_t kernel_compiles = 0;    // CUDA kernels generated and compiled
+  int64_t kernel_cache_hits = 0;  // CUDA graphs run by an already compiled kernel
+};
+
+constexpr int kNumStats = sizeof(Stats) / sizeof(int64_t);
+
+Stats stats();
+void reset_stats();
+
+}  // namespace xft::lazy
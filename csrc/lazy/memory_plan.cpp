@@ -0,0 +1,92 @@
+#include "lazy/memory_plan.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace xft::lazy {
+
+namespace {
+
+// A buffer of the arena: one result, or a chain of results each written
+// over the last, live over [start, end] (instruction numbers, inclusive).
+struct Buffer {
+  int64_t bytes = 0;
+  int start = 0;
+  int end = 0;
+  int64_t offset = -1;
+};
+
+bool overlaps(const Buffer& x, const Buffer& y) { return x.start <= y.end && y.start <= x.end; }
+
+}  // namespace
+
+MemoryPlan plan_memory(const std::vector<PlanNode>& nodes, int64_t alignment) {
+  const int n = static_cast<int>(nodes.size());
+  MemoryPlan plan;
+  plan.offsets.assign(n, -1);
+  if (n <= 1) return plan;
+
+  std::vector<int> last_use(n, -1);
+  for (int i = 0; i < n; i++) {
+    if (nodes[i].a >= 0) last_use[nodes[i].a] = i;
+    if (nodes[i].b >= 0) last_use[nodes[i].b] = i;
+  }
+
+  // Lifetimes, merging each result into an operand's buffer when the
+  // operand dies here with the same size.
+  std::vector<Buffer> buffers;
+  std::vector<int> buffer_of(n, -1);
+  for (int i = 0; i + 1 < n; i++) {
+    const PlanNode& node = nodes[i];
+    plan.unplanned_bytes += node.bytes;
+    const int end = std::max(last_use[i], i);
+    for (int operand : {node.a, node.b}) {
+      if (operand < 0 || last_use[operand] != i || nodes[operand].bytes != node.bytes) continue;
+      Buffer& buf = buffers[buffer_of[operand]];
+      if (buf.end != i) continue;  // already taken over by the other operand
+      buf.end = end;
+      buffer_of[i] = buffer_of[operand];
+      plan.in_place++;
+      break;
+    }
+    if (buffer_of[i] < 0) {
+      buffer_of[i] = static_cast<int>(buffers.size());
+      buffers.push_back({(node.bytes + alignment - 1) / alignment * alignment, i, end, -1});
+    }
+  }
+
+  // Largest first, each at the tightest gap among the buffers it overlaps.
+  std::vector<int> order(buffers.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<int>(i);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int x, int y) { return buffers[x].bytes > buffers[y].bytes; });
+  std::vector<int> placed;
+  for (int idx : order) {
+    Buffer& buf = buffers[idx];
+    std::vector<const Buffer*> live;
+    for (int other : placed) {
+      if (overlaps(buf, buffers[other])) live.push_back(&buffers[other]);
+    }
+    std::sort(live.begin(), live.end(),
+              [](const Buffer* x, const Buffer* y) { return x->offset < y->offset; });
+    int64_t best = -1;
+    int64_t best_gap = std::numeric_limits<int64_t>::max();
+    int64_t cursor = 0;
+    for (const Buffer* other : live) {
+      const int64_t gap = other->offset - cursor;
+      if (gap >= buf.bytes && gap < best_gap) {
+        best = cursor;
+        best_gap = gap;
+      }
+      cursor = std::max(cursor, other->offset + other->bytes);
+    }
+    buf.offset = best >= 0 ? best : cursor;
+    plan.arena_bytes = std::max(plan.arena_bytes, buf.offset + buf.bytes);
+    placed.push_back(idx);
+  }
+
+  for (int i = 0; i + 1 < n; i++) plan.offsets[i] = buffers[buffer_of[i]].offset;
+  return plan;
+}
+
+}  // namespace xft::lazy
@@ -0,0 +1,42 @@
+#pragma once
+
+// Ahead-of-time memory planning for lowered lazy programs (csrc/lazy/ir.h).
+//
+// Every intermediate result of a program lives from the instruction that
+// computes it to its last use. The planner packs those lifetimes into one
+// arena before the program runs:
+//  - a result whose operand dies at the same instruction and has the same
+//    size is written over that operand (in place). Elementwise kernels read
+//    each element before writing it, so this is safe;
+//  - the remaining buffers are placed largest first, each at the smallest
+//    gap left by the already placed buffers whose lifetimes overlap its own
+//    (greedy best fit), or past the end when none fits.
+// The last instruction writes the program's output and takes no space.
+
+#include <cstdint>
+#include <vector>
+
+namespace xft::lazy {
+
+// One instruction, as the planner sees it.
+struct PlanNode {
+  int64_t bytes = 0;
+  // Instructions producing the operands; -1 for program inputs and for
+  // the missing second operand of a unary op.
+  int a = -1, b = -1;
+};
+
+struct MemoryPlan {
+  // Byte offset of each instruction's result in the arena; -1 for the last.
+  std::vector<int64_t> offsets;
+  int64_t arena_bytes = 0;
+  // The same intermediates with a buffer each, as eager ops allocate them.
+  int64_t unplanned_bytes = 0;
+  // Results written over one of their operands.
+  int in_place = 0;
+};
+
+// Buffers start at multiples of `alignment`.
+MemoryPlan plan_memory(const std::vector<PlanNode>& nodes, int64_t alignment);
+
+}  // namespace xft::lazy
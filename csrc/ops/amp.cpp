@@ -0,0 +1,80 @@
+#include "ops/amp.h"
+
+#include <atomic>
+#include <cmath>
+
+#include "core/parallel.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/amp.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// A computes the product: float for the 16-bit dtypes.
+template <typename T, typename A>
+bool unscale_cpu(T* data, int64_t n, A inv_scale) {
+  std::atomic<bool> found{false};
+  parallel_for(0, n, kGrainSize, [&](int64_t lo, int64_t hi) {
+    bool bad = false;
+    for (int64_t i = lo; i < hi; i++) {
+      const A v = static_cast<A>(data[i]) * inv_scale;
+      bad |= !std::isfinite(v);
+      data[i] = T(v);
+    }
+    if (bad) found.store(true, std::memory_order_relaxed);
+  });
+  return found.load();
+}
+
+}  // namespace
+
+bool unscale_(const std::vector<Tensor>& grads, double inv_scale) {
+  bool found = false;
+#ifdef XFT_USE_CUDA
+  // One flag per CUDA device among the grads, read back after all launches.
+  std::vector<Tensor> flags;
+  auto flag_for = [&](Device device) -> Tensor& {
+    for (Tensor& f : flags) {
+      if (f.device() == device) return f;
+    }
+    flags.push_back(Tensor::zeros({1}, DType::Int32, device));
+    return flags.back();
+  };
+#endif
+  for (const Tensor& g : grads) {
+    if (!g.defined()) continue;
+    XFT_CHECK(is_floating(g.dtype()), "unscale_: expected floating tensors, got ",
+              dtype_name(g.dtype()));
+    XFT_CHECK(g.is_contiguous(), "unscale_: expected dense tensors");
+    Tensor t = g;
+    t.storage()->bump_version();
+#ifdef XFT_USE_CUDA
+    if (t.device().is_cuda()) {
+      cuda::unscale_(t, inv_scale, flag_for(t.device()));
+      continue;
+    }
+#endif
+    XFT_CHECK(t.device().is_cpu(), "unscale_: ", t.device().str(),
+              " tensors are not supported yet");
+    bool bad = false;
+    if (is_reduced_floating(t.dtype())) {
+      XFT_DISPATCH_HALF_TYPES(t.dtype(), "unscale_", [&] {
+        bad = unscale_cpu(t.data<scalar_t>(), t.numel(), static_cast<float>(inv_scale));
+      });
+    } else {
+      XFT_DISPATCH_FLOATING_TYPES(t.dtype(), "unscale_", [&] {
+        bad = unscale_cpu(t.data<scalar_t>(), t.numel(), static_cast<scalar_t>(inv_scale));
+      });
+    }
+    found = found || bad;
+  }
+#ifdef XFT_USE_CUDA
+  for (const Tensor& f : flags) found = f.to(Device()).data<int32_t>()[0] != 0 || found;
+#endif
+  return found;
+}
+
+}  // namespace xft
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// Loss-scaling support for mixed precision (xft.amp.GradScaler). Multiplies
+// each dense floating tensor in `grads` in place by inv_scale, in float for
+// the 16-bit dtypes, and returns whether any result is inf or NaN. CUDA
+// tensors share one device-side flag, so the call synchronizes once however
+// many tensors it is given. Undefined tensors are skipped.
+bool unscale_(const std::vector<Tensor>& grads, double inv_scale);
+
+}  // namespace xft
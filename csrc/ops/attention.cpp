@@ -0,0 +1,200 @@
+#include "ops/attention.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "autograd/functions.h"
+#include "autograd/grad_mode.h"
+#include "core/autocast.h"
+#include "core/parallel.h"
+#include "core/profiler.h"
+#include "cpu/kernels.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/attention.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// Query (or key) rows per CPU task.
+constexpr int64_t kRowsPerTask = 32;
+
+struct Heads {
+  int64_t count;
+  cpu::AttentionShape shape;
+};
+
+Heads check_attention(const Tensor& q, const Tensor& k, const Tensor& v) {
+  constexpr const char* name = "scaled_dot_product_attention";
+  XFT_CHECK(is_floating(q.dtype()), name, ": expected a floating dtype, got ",
+            dtype_name(q.dtype()));
+  XFT_CHECK(k.dtype() == q.dtype() && v.dtype() == q.dtype(), name,
+            ": q, k and v must share a dtype");
+  XFT_CHECK(k.device() == q.device() && v.device() == q.device(), name,
+            ": q, k and v must be on the same device");
+  XFT_CHECK(q.dim() >= 2 && k.dim() == q.dim() && v.dim() == q.dim(), name,
+            ": q, k and v must have the same number of dims, at least 2");
+  const int64_t nd = q.dim();
+  for (int64_t d = 0; d < nd - 2; d++) {
+    XFT_CHECK(k.size(d) == q.size(d) && v.size(d) == q.size(d), name,
+              ": q, k and v must have the same leading dims");
+  }
+  Heads h;
+  h.shape.L = q.size(-2);
+  h.shape.D = q.size(-1);
+  h.shape.S = k.size(-2);
+  h.shape.Dv = v.size(-1);
+  XFT_CHECK(k.size(-1) == h.shape.D, name, ": k's last dim must match q's (", h.shape.D, ")");
+  XFT_CHECK(v.size(-2) == h.shape.S, name, ": k and v must have the same sequence length");
+  h.count = 1;
+  for (int64_t d = 0; d < nd - 2; d++) h.count *= q.size(d);
+  return h;
+}
+
+Shape with_last(const Tensor& t, int64_t drop, std::initializer_list<int64_t> tail) {
+  Shape s(t.sizes().begin(), t.sizes().end() - drop);
+  s.insert(s.end(), tail);
+  return s;
+}
+
+void check_cpu(const Tensor& t) {
+  XFT_CHECK(t.device().is_cpu(), "scaled_dot_product_attention: ", t.device().str(),
+            " tensors are not supported yet");
+}
+
+// lse and delta stay float32 for the 16-bit dtypes.
+DType stats_dtype(DType dtype) { return is_reduced_floating(dtype) ? DType::Float32 : dtype; }
+
+// The CPU kernels are float32 / float64 only: 16-bit operands are widened
+// into float32 copies, and results computed in one are copied back.
+Tensor cpu_operand(const Tensor& t) {
+  return is_reduced_floating(t.dtype()) ? t.to(DType::Float32) : t;
+}
+
+Tensor cpu_result(const Tensor& t) {
+  return is_reduced_floating(t.dtype()) ? Tensor::empty(t.sizes(), DType::Float32) : t;
+}
+
+void copy_back(Tensor& dst, const Tensor& src) {
+  if (src.dtype() != dst.dtype()) dst.copy_(src);
+}
+
+// Runs fn(head, begin, end) over every head's rows in tasks of
+// kRowsPerTask rows.
+template <typename F>
+void for_each_row_task(int64_t heads, int64_t rows, F&& fn) {
+  const int64_t tasks = (rows + kRowsPerTask - 1) / kRowsPerTask;
+  parallel_for(0, heads * tasks, 1, [&](int64_t lo, int64_t hi) {
+    for (int64_t t = lo; t < hi; t++) {
+      const int64_t begin = (t % tasks) * kRowsPerTask;
+      fn(t / tasks, begin, std::min(rows, begin + kRowsPerTask));
+    }
+  });
+}
+
+}  // namespace
+
+Tensor scaled_dot_product_attention(const Tensor& q_in, const Tensor& k_in, const Tensor& v_in,
+                                    bool is_causal, std::optional<double> scale) {
+  XFT_RECORD_OP("scaled_dot_product_attention", q_in, k_in, v_in);
+  const Tensor q = autocast::to_lower(q_in), k = autocast::to_lower(k_in),
+               v = autocast::to_lower(v_in);
+  Heads h = check_attention(q, k, v);
+  h.shape.scale = scale.value_or(1.0 / std::sqrt(static_cast<double>(std::max<int64_t>(
+                                           h.shape.D, 1))));
+  h.shape.causal = is_causal;
+  const cpu::AttentionShape& a = h.shape;
+  const Tensor qc = q.contiguous(), kc = k.contiguous(), vc = v.contiguous();
+  Tensor out = Tensor::empty(with_last(q, 1, {a.Dv}), q.dtype(), q.device());
+  Tensor lse = Tensor::empty(with_last(q, 1, {}), stats_dtype(q.dtype()), q.device());
+  if (out.numel() > 0 || lse.numel() > 0) {
+#ifdef XFT_USE_CUDA
+    if (q.device().is_cuda()) {
+      cuda::attention(qc, kc, vc, out, lse, h.count, a.L, a.S, a.D, a.Dv, a.scale, a.causal);
+    } else
+#endif
+    {
+      check_cpu(q);
+      autograd::NoGradGuard no_grad;
+      const Tensor q2 = cpu_operand(qc), k2 = cpu_operand(kc), v2 = cpu_operand(vc);
+      Tensor o2 = cpu_result(out);
+      const auto& kernels = cpu::cpu_kernels();
+      const int64_t el = static_cast<int64_t>(q2.element_size());
+      const char* pq = static_cast<const char*>(q2.data_ptr());
+      const char* pk = static_cast<const char*>(k2.data_ptr());
+      const char* pv = static_cast<const char*>(v2.data_ptr());
+      char* po = static_cast<char*>(o2.data_ptr());
+      char* pl = static_cast<char*>(lse.data_ptr());
+      for_each_row_task(h.count, a.L, [&](int64_t hd, int64_t begin, int64_t end) {
+        kernels.attention(q2.dtype(), a, pq + hd * a.L * a.D * el, pk + hd * a.S * a.D * el,
+                          pv + hd * a.S * a.Dv * el, po + hd * a.L * a.Dv * el,
+                          pl + hd * a.L * el, begin, end);
+      });
+      copy_back(out, o2);
+    }
+  }
+  autograd::record<autograd::AttentionBackward>(out, {q, k, v}, qc, kc, vc, out, lse, is_causal,
+                                                a.scale);
+  return out;
+}
+
+AttentionGrads scaled_dot_product_attention_backward(const Tensor& dout, const Tensor& q,
+                                                     const Tensor& k, const Tensor& v,
+                                                     const Tensor& out, const Tensor& lse,
+                                                     bool is_causal, double scale) {
+  XFT_RECORD_OP("scaled_dot_product_attention_backward", dout, q, k, v);
+  Heads h = check_attention(q, k, v);
+  h.shape.scale = scale;
+  h.shape.causal = is_causal;
+  const cpu::AttentionShape& a = h.shape;
+  const Tensor g = dout.contiguous();
+  AttentionGrads r;
+  r.dq = Tensor::empty(q.sizes(), q.dtype(), q.device());
+  r.dk = Tensor::empty(k.sizes(), k.dtype(), k.device());
+  r.dv = Tensor::empty(v.sizes(), v.dtype(), v.device());
+  Tensor delta = Tensor::empty(lse.sizes(), stats_dtype(q.dtype()), q.device());
+#ifdef XFT_USE_CUDA
+  if (q.device().is_cuda()) {
+    cuda::attention_backward(g, q, k, v, out, lse, delta, r.dq, r.dk, r.dv, h.count, a.L, a.S,
+                             a.D, a.Dv, a.scale, a.causal);
+    return r;
+  }
+#endif
+  check_cpu(q);
+  const Tensor q2 = cpu_operand(q), k2 = cpu_operand(k), v2 = cpu_operand(v);
+  const Tensor o2 = cpu_operand(out), g2 = cpu_operand(g);
+  Tensor dq2 = cpu_result(r.dq), dk2 = cpu_result(r.dk), dv2 = cpu_result(r.dv);
+  const auto& kernels = cpu::cpu_kernels();
+  const int64_t el = static_cast<int64_t>(q2.element_size());
+  const char* pq = static_cast<const char*>(q2.data_ptr());
+  const char* pk = static_cast<const char*>(k2.data_ptr());
+  const char* pv = static_cast<const char*>(v2.data_ptr());
+  const char* po = static_cast<const char*>(o2.data_ptr());
+  const char* pg = static_cast<const char*>(g2.data_ptr());
+  const char* pl = static_cast<const char*>(lse.data_ptr());
+  char* pd = static_cast<char*>(delta.data_ptr());
+  char* dq = static_cast<char*>(dq2.data_ptr());
+  char* dk = static_cast<char*>(dk2.data_ptr());
+  char* dv = static_cast<char*>(dv2.data_ptr());
+  // Query-side pass first: the key-side pass reads the deltas it writes.
+  for_each_row_task(h.count, a.L, [&](int64_t hd, int64_t begin, int64_t end) {
+    const int64_t qo = hd * a.L * a.D * el, oo = hd * a.L * a.Dv * el;
+    kernels.attention_backward_dq(q2.dtype(), a, pq + qo, pk + hd * a.S * a.D * el,
+                                  pv + hd * a.S * a.Dv * el, po + oo, pg + oo,
+                                  pl + hd * a.L * el, pd + hd * a.L * el, dq + qo, begin, end);
+  });
+  for_each_row_task(h.count, a.S, [&](int64_t hd, int64_t begin, int64_t end) {
+    const int64_t ko = hd * a.S * a.D * el, vo = hd * a.S * a.Dv * el;
+    kernels.attention_backward_dkv(q2.dtype(), a, pq + hd * a.L * a.D * el, pk + ko, pv + vo,
+                                   pg + hd * a.L * a.Dv * el, pl + hd * a.L * el,
+                                   pd + hd * a.L * el, dk + ko, dv + vo, begin, end);
+  });
+  copy_back(r.dq, dq2);
+  copy_back(r.dk, dk2);
+  copy_back(r.dv, dv2);
+  return r;
+}
+
+}  // namespace xft
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// softmax(q @ k^T * scale) @ v over the last two dims, computed in tiles
+// with an online softmax so the [L, S] score matrix is never formed: memory
+// is O(L + S) per head instead of O(L * S). q is [..., L, D], k [..., S, D]
+// and v [..., S, Dv] with identical leading dims; the result is [..., L, Dv].
+// scale defaults to 1 / sqrt(D). is_causal hides key j from query i when
+// j > i (the mask is aligned to the top-left corner, as in tril). Floating
+// dtypes, on CPU and CUDA, and differentiable; under autocast float32
+// inputs run in the lower dtype (core/autocast.h).
+Tensor scaled_dot_product_attention(const Tensor& q, const Tensor& k, const Tensor& v,
+                                    bool is_causal = false,
+                                    std::optional<double> scale = std::nullopt);
+
+// The backward, recomputing the probabilities tile by tile from the
+// forward's output and per-row logsumexp `lse` ([..., L], float32 for the
+// 16-bit dtypes). Not itself differentiable.
+struct AttentionGrads {
+  Tensor dq, dk, dv;
+};
+AttentionGrads scaled_dot_product_attention_backward(const Tensor& dout, const Tensor& q,
+                                                     const Tensor& k, const Tensor& v,
+                                                     const Tensor& out, const Tensor& lse,
+                                                     bool is_causal, double scale);
+
+}  // namespace xft
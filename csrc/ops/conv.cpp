@@ -0,0 +1,254 @@
+#include "ops/conv.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "autograd/functions.h"
+#include "autograd/grad_mode.h"
+#include "core/autocast.h"
+#include "core/autotune.h"
+#include "core/parallel.h"
+#include "core/profiler.h"
+#include "cpu/kernels.h"
+#include "ops/reduce.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/conv.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+constexpr const char* kName = "conv2d";
+
+ConvShape check_conv(const Tensor& x, const Tensor& w, const Tensor& bias,
+                     const Conv2dParams& p) {
+  XFT_CHECK(is_floating(x.dtype()), kName, ": expected a floating dtype, got ",
+            dtype_name(x.dtype()));
+  XFT_CHECK(w.dtype() == x.dtype(), kName, ": input and weight must share a dtype (",
+            dtype_name(x.dtype()), " vs ", dtype_name(w.dtype()), ")");
+  XFT_CHECK(w.device() == x.device(), kName, ": input and weight must be on the same device");
+  XFT_CHECK(x.dim() == 4 && w.dim() == 4, kName,
+            ": expected a 4-D input [N, C, H, W] and weight [K, C / groups, R, S], got ",
+            x.dim(), "-D and ", w.dim(), "-D");
+  for (int d = 0; d < 2; d++) {
+    XFT_CHECK(p.stride[d] > 0 && p.dilation[d] > 0 && p.padding[d] >= 0, kName,
+              ": stride and dilation must be positive and padding non-negative");
+  }
+  ConvShape s{};
+  s.N = x.size(0), s.C = x.size(1), s.H = x.size(2), s.W = x.size(3);
+  s.K = w.size(0), s.R = w.size(2), s.S = w.size(3);
+  s.stride_h = p.stride[0], s.stride_w = p.stride[1];
+  s.pad_h = p.padding[0], s.pad_w = p.padding[1];
+  s.dilation_h = p.dilation[0], s.dilation_w = p.dilation[1];
+  s.groups = p.groups;
+  XFT_CHECK(s.groups > 0 && s.C % s.groups == 0 && s.K % s.groups == 0, kName, ": groups (",
+            s.groups, ") must divide both ", s.C, " input and ", s.K, " output channels");
+  XFT_CHECK(w.size(1) == s.C / s.groups, kName, ": weight has ", w.size(1),
+            " input channels per group, the input ", s.C / s.groups);
+  const int64_t eff_h = s.dilation_h * (s.R - 1) + 1, eff_w = s.dilation_w * (s.S - 1) + 1;
+  XFT_CHECK(s.R > 0 && s.S > 0 && s.H + 2 * s.pad_h >= eff_h && s.W + 2 * s.pad_w >= eff_w,
+            kName, ": a ", s.R, "x", s.S, " filter does not fit a padded ", s.H + 2 * s.pad_h,
+            "x", s.W + 2 * s.pad_w, " input");
+  s.OH = (s.H + 2 * s.pad_h - eff_h) / s.stride_h + 1;
+  s.OW = (s.W + 2 * s.pad_w - eff_w) / s.stride_w + 1;
+  if (bias.defined()) {
+    XFT_CHECK(bias.dim() == 1 && bias.size(0) == s.K, kName, ": bias must be [", s.K, "]");
+    XFT_CHECK(bias.dtype() == x.dtype() && bias.device() == x.device(), kName,
+              ": bias must have the input's dtype and device");
+  }
+  return s;
+}
+
+void check_cpu(const Tensor& t) {
+  XFT_CHECK(t.device().is_cpu(), kName, ": ", t.device().str(),
+            " is not supported by this build");
+}
+
+// The CPU kernels are float32 / float64 only: 16-bit operands are widened
+// into float32 copies (keeping their layout), and results computed in one
+// are copied back.
+Tensor cpu_operand(const Tensor& t) {
+  if (!t.defined() || !is_reduced_floating(t.dtype())) return t;
+  Tensor out = Tensor::empty(t.sizes(), DType::Float32, t.device(), t.suggest_memory_format());
+  out.copy_(t);
+  return out;
+}
+
+Tensor cpu_result(const Tensor& t) {
+  return is_reduced_floating(t.dtype())
+             ? Tensor::empty(t.sizes(), DType::Float32, t.device(), t.suggest_memory_format())
+             : t;
+}
+
+void copy_back(Tensor& dst, const Tensor& src) {
+  if (src.dtype() != dst.dtype()) dst.copy_(src);
+}
+
+const void* data_or_null(const Tensor& t) { return t.defined() ? t.data_ptr() : nullptr; }
+
+// Pixels (GEMM rows) per parallel_for chunk: enough multiply-adds per task
+// to amortize the dispatch.
+int64_t pixel_grain(int64_t macs_per_pixel) {
+  return std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, macs_per_pixel));
+}
+
+// The CPU tilings autotune::select() picks from, the default first: panel
+// heights and register tiles for the passes over pixels, pass lengths and
+// register tiles for the weight gradient.
+constexpr ConvTiling kPanelTilings[] = {
+    {64, 256, 4, 2}, {32, 256, 4, 2}, {128, 256, 4, 2}, {64, 256, 6, 2}, {64, 256, 2, 4}};
+constexpr ConvTiling kPixelTilings[] = {
+    {64, 256, 4, 2}, {64, 128, 4, 2}, {64, 512, 4, 2}, {64, 256, 6, 2}, {64, 256, 2, 4}};
+// Passes with fewer multiply-adds run the default tiling untimed.
+constexpr int64_t kMinTuneMacs = int64_t(1) << 22;
+
+// The tiling for CPU pass `op` of shape s, with run(tiling) computing the
+// whole pass: every tiling gives the same result, so timing may leave any
+// of them in the output.
+template <size_t N>
+ConvTiling tune(const char* op, DType dtype, const ConvShape& s, const ConvTiling (&tilings)[N],
+                bool by_pixels, const std::function<void(const ConvTiling&)>& run) {
+  const int64_t macs = s.N * s.OH * s.OW * s.R * s.S * (s.C / s.groups) * s.K;
+  if (macs < kMinTuneMacs) return tilings[0];
+  std::vector<std::string> names;
+  for (const ConvTiling& t : tilings) {
+    names.push_back((by_pixels ? "x" + std::to_string(t.pixels) : "p" + std::to_string(t.panel)) +
+                    "-" + std::to_string(t.tile_rows) + "x" + std::to_string(t.tile_vecs));
+  }
+  const std::string key = autotune::make_key(
+      autotune::cpu_arch(), op, dtype,
+      {s.N, s.H, s.W, s.C, s.K, s.R, s.S, s.stride_h, s.stride_w, s.pad_h, s.pad_w,
+       s.dilation_h, s.dilation_w, s.groups});
+  return tilings[autotune::select(key, names, [&](int i) {
+    return autotune::time_cpu([&] { run(tilings[i]); });
+  })];
+}
+
+}  // namespace
+
+Tensor conv2d(const Tensor& x_in, const Tensor& w_in, const Tensor& b_in,
+              const Conv2dParams& params) {
+  XFT_RECORD_OP(kName, x_in, w_in, b_in);
+  const Tensor x = autocast::to_lower(x_in), w = autocast::to_lower(w_in);
+  const Tensor b = b_in.defined() ? autocast::to_lower(b_in) : b_in;
+  const ConvShape s = check_conv(x, w, b, params);
+  const MemoryFormat format = x.suggest_memory_format();
+  Tensor xc, wk, y;
+  {
+    autograd::NoGradGuard no_grad;
+    xc = x.contiguous(MemoryFormat::ChannelsLast);
+    // [K, Cg, R, S] -> [R, S, Cg, K]: each tap's slice is a [Cg, K] matrix.
+    wk = w.permute({2, 3, 1, 0}).contiguous();
+    y = Tensor::empty({s.N, s.K, s.OH, s.OW}, x.dtype(), x.device(), MemoryFormat::ChannelsLast);
+    if (y.numel() > 0) {
+      const Tensor bc = b.defined() ? b.contiguous() : b;
+#ifdef XFT_USE_CUDA
+      if (x.device().is_cuda()) {
+        cuda::conv2d(xc, wk, bc, y, s);
+      } else
+#endif
+      {
+        check_cpu(x);
+        const Tensor x2 = cpu_operand(xc), w2 = cpu_operand(wk), b2 = cpu_operand(bc);
+        Tensor y2 = cpu_result(y);
+        const auto& kernels = cpu::cpu_kernels();
+        const auto run = [&](const ConvTiling& tiling) {
+          parallel_for(0, s.N * s.OH * s.OW, pixel_grain(s.R * s.S * s.C / s.groups * s.K),
+                       [&](int64_t lo, int64_t hi) {
+                         kernels.conv2d(x2.dtype(), s, tiling, x2.data_ptr(), w2.data_ptr(),
+                                        data_or_null(b2), y2.data_ptr(), lo, hi);
+                       });
+        };
+        run(tune("conv2d", x2.dtype(), s, kPanelTilings, false, run));
+        copy_back(y, y2);
+      }
+    }
+    if (format == MemoryFormat::Contiguous) y = y.contiguous();
+  }
+  autograd::record<autograd::Conv2dBackward>(y, {x, w, b}, xc, w, params, format);
+  return y;
+}
+
+Conv2dGrads conv2d_backward(const Tensor& dy, const Tensor& x, const Tensor& weight,
+                            const Conv2dParams& params, MemoryFormat x_format, bool need_dx,
+                            bool need_dweight, bool need_dbias) {
+  XFT_RECORD_OP("conv2d_backward", dy, x, weight);
+  const ConvShape s = check_conv(x, weight, Tensor(), params);
+  XFT_CHECK(dy.dtype() == x.dtype() && dy.dim() == 4 && dy.size(0) == s.N &&
+                dy.size(1) == s.K && dy.size(2) == s.OH && dy.size(3) == s.OW,
+            "conv2d_backward: grad must be [", s.N, ", ", s.K, ", ", s.OH, ", ", s.OW, "] ",
+            dtype_name(x.dtype()));
+  autograd::NoGradGuard no_grad;
+  const Tensor g = dy.contiguous(MemoryFormat::ChannelsLast);
+  const Tensor xc = x.contiguous(MemoryFormat::ChannelsLast);
+  const int64_t Cg = s.C / s.groups, Kg = s.K / s.groups;
+  Conv2dGrads r;
+  Tensor dx, dwk;
+  if (need_dx) {
+    dx = Tensor::empty(x.sizes(), x.dtype(), x.device(), MemoryFormat::ChannelsLast);
+  }
+  if (need_dweight) {
+    dwk = Tensor::empty({s.R, s.S, Cg, s.K}, x.dtype(), x.device());
+  }
+  if (need_dx && dx.numel() > 0) {
+    // [K, Cg, R, S] -> [R, S, K, Cg]: each tap's slice is a [K, Cg] matrix.
+    const Tensor wt = weight.permute({2, 3, 0, 1}).contiguous();
+#ifdef XFT_USE_CUDA
+    if (x.device().is_cuda()) {
+      cuda::conv2d_backward_input(g, wt, dx, s);
+    } else
+#endif
+    {
+      check_cpu(x);
+      const Tensor g2 = cpu_operand(g), w2 = cpu_operand(wt);
+      Tensor dx2 = cpu_result(dx);
+      const auto& kernels = cpu::cpu_kernels();
+      const auto run = [&](const ConvTiling& tiling) {
+        parallel_for(0, s.N * s.H * s.W, pixel_grain(s.R * s.S * Kg * s.C),
+                     [&](int64_t lo, int64_t hi) {
+                       kernels.conv2d_backward_input(g2.dtype(), s, tiling, g2.data_ptr(),
+                                                     w2.data_ptr(), dx2.data_ptr(), lo, hi);
+                     });
+      };
+      run(tune("conv2d_backward_input", g2.dtype(), s, kPanelTilings, false, run));
+      copy_back(dx, dx2);
+    }
+  }
+  if (need_dweight && dwk.numel() > 0) {
+#ifdef XFT_USE_CUDA
+    if (x.device().is_cuda()) {
+      cuda::conv2d_backward_weight(xc, g, dwk, s);
+    } else
+#endif
+    {
+      check_cpu(x);
+      const Tensor x2 = cpu_operand(xc), g2 = cpu_operand(g);
+      Tensor dw2 = cpu_result(dwk);
+      const auto& kernels = cpu::cpu_kernels();
+      const auto run = [&](const ConvTiling& tiling) {
+        parallel_for(0, s.R * s.S * Cg, pixel_grain(s.N * s.OH * s.OW * s.K),
+                     [&](int64_t lo, int64_t hi) {
+                       kernels.conv2d_backward_weight(x2.dtype(), s, tiling, x2.data_ptr(),
+                                                      g2.data_ptr(), dw2.data_ptr(), lo, hi);
+                     });
+      };
+      run(tune("conv2d_backward_weight", x2.dtype(), s, kPixelTilings, true, run));
+      copy_back(dwk, dw2);
+    }
+  }
+  if (need_dx) r.dx = dx.contiguous(x_format);
+  if (need_dweight) {
+    r.dweight = dwk.permute({3, 2, 0, 1}).contiguous(weight.suggest_memory_format());
+  }
+  if (need_dbias) {
+    // dy as NHWC is a dense [pixels, K] matrix.
+    r.dbias = sum(g.permute({0, 2, 3, 1}).reshape({s.N * s.OH * s.OW, s.K}), 0);
+  }
+  return r;
+}
+
+}  // namespace xft
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+
+#include "core/tensor.h"
+
+namespace xft {
+
+struct Conv2dParams {
+  std::array<int64_t, 2> stride{1, 1};
+  std::array<int64_t, 2> padding{0, 0};
+  std::array<int64_t, 2> dilation{1, 1};
+  int64_t groups = 1;
+};
+
+// The geometry of one conv2d as the kernels see it, channels last: input
+// [N, H, W, C], an R x S filter, output [N, OH, OW, K], and the channels
+// split into `groups` independent groups of C / groups inputs and
+// K / groups outputs.
+struct ConvShape {
+  int64_t N, H, W, C, K, R, S, OH, OW;
+  int64_t stride_h, stride_w, pad_h, pad_w, dilation_h, dilation_w, groups;
+};
+
+// How the CPU kernels walk a conv's implicit GEMM, picked per shape by
+// core/autotune.h: `panel` output rows share each block of weights, the
+// register tile is tile_rows rows by tile_vecs vectors (4 x 2, 6 x 2 or
+// 2 x 4), and the weight gradient runs over the pixels `pixels` at a time.
+// None of them changes the order of any sum, so every tiling gives the
+// same result.
+struct ConvTiling {
+  int64_t panel = 64;
+  int64_t pixels = 256;
+  int tile_rows = 4;
+  int tile_vecs = 2;
+};
+
+// 2-D convolution (cross-correlation, as nn.Conv2d) of x [N, C, H, W] with
+// weight [K, C / groups, R, S] and bias [K] (or undefined), giving
+// [N, K, OH, OW] where OH = (H + 2 * pad_h - dilation_h * (R - 1) - 1) /
+// stride_h + 1, and likewise OW.
+//
+// Runs as an implicit GEMM over channels-last data: each filter tap reads
+// the C channels of an input pixel as one contiguous row, in place, so
+// there is no im2col buffer R * S times the size of x. NCHW inputs are
+// converted to channels last on the way in; the result takes x's memory
+// format (Tensor::suggest_memory_format), so a channels-last network never
+// transposes. Floating dtypes, on CPU and CUDA, and differentiable; under
+// autocast float32 inputs run in the lower dtype (core/autocast.h).
+Tensor conv2d(const Tensor& x, const Tensor& weight, const Tensor& bias,
+              const Conv2dParams& params = {});
+
+// The backward: dx in `x_format`, dweight in weight's memory format and
+// dbias [K], each computed only when asked for. x is the forward's input
+// in channels last. Not itself differentiable.
+struct Conv2dGrads {
+  Tensor dx, dweight, dbias;
+};
+Conv2dGrads conv2d_backward(const Tensor& dy, const Tensor& x, const Tensor& weight,
+                            const Conv2dParams& params, MemoryFormat x_format, bool need_dx,
+                            bool need_dweight, bool need_dbias);
+
+}  // namespace xft
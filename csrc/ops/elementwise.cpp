@@ -0,0 +1,275 @@
+#include <initializer_list>
+
+#include "ops/elementwise.h"
+
+#include "autograd/functions.h"
+#include "autograd/grad_mode.h"
+#include "core/autocast.h"
+#include "core/dispatch.h"
+#include "core/profiler.h"
+#include "core/tensor_iterator.h"
+#include "lazy/lazy.h"
+
+namespace xft {
+
+namespace {
+
+bool same_view(const Tensor& a, const Tensor& b) {
+  return a.impl() == b.impl() ||
+         (a.is_alias_of(b) && a.storage_offset() == b.storage_offset() &&
+          a.sizes() == b.sizes() && a.strides() == b.strides() && a.dtype() == b.dtype());
+}
+
+// Readies `out` for a *_out op: each element is read before it is written,
+// so out may be exactly one of the inputs, but a partial overlap would read
+// values the op already overwrote.
+void prepare_out(const char* name, const Tensor& out, std::initializer_list<Tensor> inputs) {
+  XFT_CHECK(out.defined(), name, ": undefined out tensor");
+  XFT_CHECK(!autograd::needs_grad(inputs) &&
+                !(autograd::GradMode::is_enabled() && out.requires_grad()),
+            name, ": out= is not recorded by autograd; use it under no_grad or inference_mode");
+  bool is_input = false;
+  for (const Tensor& t : inputs) {
+    if (!t.is_alias_of(out)) continue;
+    XFT_CHECK(same_view(t, out), name, ": out overlaps an input without being the same view");
+    is_input = true;
+  }
+  // Overwritten whole, so a pending lazy result need not be computed first.
+  if (!is_input) lazy::discard(out);
+  out.storage()->bump_version();
+}
+
+// Under inference mode nothing keeps an op's inputs for backward, so a cast
+// the op made of its own input is dead once it has been read and can take
+// the result instead of a new buffer. Undefined when there is none to reuse.
+Tensor dead_cast(const Tensor& a, const Tensor& a_in, const Tensor& b = Tensor(),
+                 const Tensor& b_in = Tensor()) {
+  if (!autograd::InferenceMode::is_enabled() || lazy::LazyMode::is_enabled()) return Tensor();
+  const bool a_cast = a.impl() != a_in.impl();
+  const bool b_cast = b.defined() && b.impl() != b_in.impl();
+  if (!a_cast && !b_cast) return Tensor();
+  const Shape sizes = b.defined() ? broadcast_shapes(a.sizes(), b.sizes()) : a.sizes();
+  if (a_cast && a.sizes() == sizes) return a;
+  if (b_cast && b.sizes() == sizes) return b;
+  return Tensor();
+}
+
+// Operands are read in place: broadcast dims have stride 0 and any other
+// layout is walked through its strides, so no inputs are materialized. The
+// kernel comes from the (op, device, dtype) table, specialized for both.
+// An undefined `out` allocates the result.
+Tensor binary_op(BinaryOp op, const char* name, const Tensor& a, const Tensor& b,
+                 const Tensor& out = Tensor()) {
+  XFT_RECORD_OP(name, a, b);
+  XFT_CHECK(a.dtype() == b.dtype(), name, ": dtype mismatch (", dtype_name(a.dtype()), " vs ",
+            dtype_name(b.dtype()), ")");
+  XFT_CHECK(a.dtype() != DType::Bool, name, ": unsupported dtype bool");
+  if (out.defined()) {
+    prepare_out(name, out, {a, b});
+  } else if (lazy::LazyMode::is_enabled()) {
+    Tensor pending = lazy::trace_binary(op, a, b);
+    if (pending.defined()) return pending;
+  }
+  TensorIterator iter;
+  iter.add_output(out).add_input(a).add_input(b).build();
+  if (iter.numel() > 0) {
+    elementwise_kernels().binary.lookup(op, iter.device(), iter.dtype(), name)(iter);
+  }
+  return iter.output();
+}
+
+Tensor floating_binary_op(BinaryOp op, const char* name, const Tensor& a, const Tensor& b) {
+  XFT_CHECK(is_floating(a.dtype()), name, ": expected a floating dtype, got ",
+            dtype_name(a.dtype()));
+  return binary_op(op, name, a, b);
+}
+
+Tensor unary_op(UnaryOp op, const char* name, const Tensor& t, const Tensor& out = Tensor()) {
+  XFT_RECORD_OP(name, t);
+  XFT_CHECK(is_floating(t.dtype()), name, ": expected a floating dtype, got ",
+            dtype_name(t.dtype()));
+  if (out.defined()) {
+    prepare_out(name, out, {t});
+  } else if (lazy::LazyMode::is_enabled()) {
+    Tensor pending = lazy::trace_unary(op, t);
+    if (pending.defined()) return pending;
+  }
+  TensorIterator iter;
+  iter.add_output(out).add_input(t).build();
+  if (iter.numel() > 0) {
+    elementwise_kernels().unary.lookup(op, iter.device(), iter.dtype(), name)(iter);
+  }
+  return iter.output();
+}
+
+}  // namespace
+
+Tensor add(const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  Tensor out = binary_op(BinaryOp::Add, "add", a, b, dead_cast(a, a_in, b, b_in));
+  autograd::record<autograd::AddBackward>(out, {a, b}, a, b);
+  return out;
+}
+
+Tensor sub(const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  Tensor out = binary_op(BinaryOp::Sub, "sub", a, b, dead_cast(a, a_in, b, b_in));
+  autograd::record<autograd::SubBackward>(out, {a, b}, a, b);
+  return out;
+}
+
+Tensor mul(const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  Tensor out = binary_op(BinaryOp::Mul, "mul", a, b, dead_cast(a, a_in, b, b_in));
+  autograd::record<autograd::MulBackward>(out, {a, b}, a, b);
+  return out;
+}
+
+Tensor div(const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  Tensor out = binary_op(BinaryOp::Div, "div", a, b, dead_cast(a, a_in, b, b_in));
+  autograd::record<autograd::DivBackward>(out, {a, b}, a, b);
+  return out;
+}
+
+Tensor maximum(const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  Tensor out = binary_op(BinaryOp::Maximum, "maximum", a, b, dead_cast(a, a_in, b, b_in));
+  autograd::record<autograd::MaximumBackward>(out, {a, b}, a, b, /*is_min=*/false);
+  return out;
+}
+
+Tensor minimum(const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  Tensor out = binary_op(BinaryOp::Minimum, "minimum", a, b, dead_cast(a, a_in, b, b_in));
+  autograd::record<autograd::MaximumBackward>(out, {a, b}, a, b, /*is_min=*/true);
+  return out;
+}
+
+Tensor exp(const Tensor& t_in) {
+  const Tensor t = autocast::to_float32(t_in);
+  Tensor out = unary_op(UnaryOp::Exp, "exp", t, dead_cast(t, t_in));
+  autograd::record<autograd::ExpBackward>(out, {t}, out);
+  return out;
+}
+
+Tensor log(const Tensor& t_in) {
+  const Tensor t = autocast::to_float32(t_in);
+  Tensor out = unary_op(UnaryOp::Log, "log", t, dead_cast(t, t_in));
+  autograd::record<autograd::LogBackward>(out, {t}, t);
+  return out;
+}
+
+Tensor sqrt(const Tensor& t) {
+  Tensor out = unary_op(UnaryOp::Sqrt, "sqrt", t);
+  autograd::record<autograd::SqrtBackward>(out, {t}, out);
+  return out;
+}
+
+Tensor tanh(const Tensor& t) {
+  Tensor out = unary_op(UnaryOp::Tanh, "tanh", t);
+  autograd::record<autograd::ActivationBackward>(out, {t}, BinaryOp::TanhBackward, out);
+  return out;
+}
+
+Tensor sigmoid(const Tensor& t) {
+  Tensor out = unary_op(UnaryOp::Sigmoid, "sigmoid", t);
+  autograd::record<autograd::ActivationBackward>(out, {t}, BinaryOp::SigmoidBackward, out);
+  return out;
+}
+
+Tensor relu(const Tensor& t) {
+  Tensor out = unary_op(UnaryOp::Relu, "relu", t);
+  autograd::record<autograd::ActivationBackward>(out, {t}, BinaryOp::ReluBackward, out);
+  return out;
+}
+
+Tensor gelu(const Tensor& t) {
+  Tensor out = unary_op(UnaryOp::Gelu, "gelu", t);
+  autograd::record<autograd::ActivationBackward>(out, {t}, BinaryOp::GeluBackward, t);
+  return out;
+}
+
+Tensor add_out(const Tensor& out, const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  return binary_op(BinaryOp::Add, "add", a, b, out);
+}
+
+Tensor sub_out(const Tensor& out, const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  return binary_op(BinaryOp::Sub, "sub", a, b, out);
+}
+
+Tensor mul_out(const Tensor& out, const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  return binary_op(BinaryOp::Mul, "mul", a, b, out);
+}
+
+Tensor div_out(const Tensor& out, const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  return binary_op(BinaryOp::Div, "div", a, b, out);
+}
+
+Tensor maximum_out(const Tensor& out, const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  return binary_op(BinaryOp::Maximum, "maximum", a, b, out);
+}
+
+Tensor minimum_out(const Tensor& out, const Tensor& a_in, const Tensor& b_in) {
+  const auto [a, b] = autocast::promote(a_in, b_in);
+  return binary_op(BinaryOp::Minimum, "minimum", a, b, out);
+}
+
+Tensor exp_out(const Tensor& out, const Tensor& t) {
+  return unary_op(UnaryOp::Exp, "exp", autocast::to_float32(t), out);
+}
+
+Tensor log_out(const Tensor& out, const Tensor& t) {
+  return unary_op(UnaryOp::Log, "log", autocast::to_float32(t), out);
+}
+
+Tensor sqrt_out(const Tensor& out, const Tensor& t) {
+  return unary_op(UnaryOp::Sqrt, "sqrt", t, out);
+}
+
+Tensor tanh_out(const Tensor& out, const Tensor& t) {
+  return unary_op(UnaryOp::Tanh, "tanh", t, out);
+}
+
+Tensor sigmoid_out(const Tensor& out, const Tensor& t) {
+  return unary_op(UnaryOp::Sigmoid, "sigmoid", t, out);
+}
+
+Tensor relu_out(const Tensor& out, const Tensor& t) {
+  return unary_op(UnaryOp::Relu, "relu", t, out);
+}
+
+Tensor gelu_out(const Tensor& out, const Tensor& t) {
+  return unary_op(UnaryOp::Gelu, "gelu", t, out);
+}
+
+Tensor ge_mask(const Tensor& a, const Tensor& b) {
+  return binary_op(BinaryOp::GeMask, "ge_mask", a, b);
+}
+
+Tensor eq_mask(const Tensor& a, const Tensor& b) {
+  return binary_op(BinaryOp::EqMask, "eq_mask", a, b);
+}
+
+Tensor relu_backward(const Tensor& grad, const Tensor& out) {
+  return floating_binary_op(BinaryOp::ReluBackward, "relu_backward", grad, out);
+}
+
+Tensor sigmoid_backward(const Tensor& grad, const Tensor& out) {
+  return floating_binary_op(BinaryOp::SigmoidBackward, "sigmoid_backward", grad, out);
+}
+
+Tensor tanh_backward(const Tensor& grad, const Tensor& out) {
+  return floating_binary_op(BinaryOp::TanhBackward, "tanh_backward", grad, out);
+}
+
+Tensor gelu_backward(const Tensor& grad, const Tensor& self) {
+  return floating_binary_op(BinaryOp::GeluBackward, "gelu_backward", grad, self);
+}
+
+}  // namespace xft
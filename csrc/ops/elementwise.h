@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// Binary ops broadcast their operands (NumPy rules) and require a common
+// dtype other than bool (under autocast, mixed floating dtypes promote to
+// the wider one). The result is a new dense tensor.
+Tensor add(const Tensor& a, const Tensor& b);
+Tensor sub(const Tensor& a, const Tensor& b);
+Tensor mul(const Tensor& a, const Tensor& b);
+Tensor div(const Tensor& a, const Tensor& b);
+Tensor maximum(const Tensor& a, const Tensor& b);
+Tensor minimum(const Tensor& a, const Tensor& b);
+
+// Unary math on floating dtypes. Under autocast exp and log run 16-bit
+// inputs in float32.
+Tensor exp(const Tensor& t);
+Tensor log(const Tensor& t);
+Tensor sqrt(const Tensor& t);
+Tensor tanh(const Tensor& t);
+Tensor sigmoid(const Tensor& t);
+Tensor relu(const Tensor& t);
+// The tanh approximation of GELU.
+Tensor gelu(const Tensor& t);
+
+// The same ops writing into `out`, which must already have the result's
+// shape, dtype and device, and return it. out may be one of the inputs
+// (exactly, for an in-place update) but must not otherwise overlap them.
+// They are not recorded by autograd, so they refuse inputs that require
+// grad while grad mode is on.
+Tensor add_out(const Tensor& out, const Tensor& a, const Tensor& b);
+Tensor sub_out(const Tensor& out, const Tensor& a, const Tensor& b);
+Tensor mul_out(const Tensor& out, const Tensor& a, const Tensor& b);
+Tensor div_out(const Tensor& out, const Tensor& a, const Tensor& b);
+Tensor maximum_out(const Tensor& out, const Tensor& a, const Tensor& b);
+Tensor minimum_out(const Tensor& out, const Tensor& a, const Tensor& b);
+Tensor exp_out(const Tensor& out, const Tensor& t);
+Tensor log_out(const Tensor& out, const Tensor& t);
+Tensor sqrt_out(const Tensor& out, const Tensor& t);
+Tensor tanh_out(const Tensor& out, const Tensor& t);
+Tensor sigmoid_out(const Tensor& out, const Tensor& t);
+Tensor relu_out(const Tensor& out, const Tensor& t);
+Tensor gelu_out(const Tensor& out, const Tensor& t);
+
+// Building blocks for backward formulas (csrc/autograd/functions.cpp); they
+// broadcast like the binary ops above and are not themselves differentiable.
+// 1 where a >= b (a == b), 0 elsewhere, in the operands' dtype.
+Tensor ge_mask(const Tensor& a, const Tensor& b);
+Tensor eq_mask(const Tensor& a, const Tensor& b);
+// grad * f'(x) for f = relu, sigmoid, tanh given the forward output, and for
+// gelu given the forward input.
+Tensor relu_backward(const Tensor& grad, const Tensor& out);
+Tensor sigmoid_backward(const Tensor& grad, const Tensor& out);
+Tensor tanh_backward(const Tensor& grad, const Tensor& out);
+Tensor gelu_backward(const Tensor& grad, const Tensor& self);
+
+}  // namespace xft
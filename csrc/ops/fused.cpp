@@ -0,0 +1,308 @@
+#include "ops/fused.h"
+
+#include <algorithm>
+
+#include "autograd/functions.h"
+#include "core/autocast.h"
+#include "core/parallel.h"
+#include "core/philox.h"
+#include "core/profiler.h"
+#include "cpu/kernels.h"
+#include "ops/reduce.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/fused.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// A dense tensor seen as [rows, cols] over its last dim.
+struct Rows {
+  int64_t rows = 1, cols = 1;
+};
+
+Rows check_rows(const char* name, const Tensor& x) {
+  XFT_CHECK(is_floating(x.dtype()), name, ": expected a floating dtype, got ",
+            dtype_name(x.dtype()));
+  XFT_CHECK(x.dim() >= 1, name, ": expected at least one dim");
+  Rows r;
+  r.cols = x.size(-1);
+  r.rows = r.cols == 0 ? 0 : x.numel() / r.cols;
+  return r;
+}
+
+void check_param(const char* name, const char* what, const Tensor& p, const Tensor& x) {
+  if (!p.defined()) return;
+  XFT_CHECK(p.dim() == 1 && p.size(0) == x.size(-1), name, ": ", what, " must be [",
+            x.size(-1), "]");
+  XFT_CHECK(p.dtype() == x.dtype() && p.device() == x.device(), name, ": ", what,
+            " must have the input's dtype and device");
+}
+
+void check_device(const char* name, const Tensor& x) {
+  XFT_CHECK(x.device().is_cpu(), name, ": ", x.device().str(), " tensors are not supported yet");
+}
+
+const void* ptr_or_null(const Tensor& t) { return t.defined() ? t.data_ptr() : nullptr; }
+
+// Per-row statistics stay float32 for the 16-bit dtypes.
+DType stats_dtype(DType dtype) { return is_reduced_floating(dtype) ? DType::Float32 : dtype; }
+
+// Rows per parallel_for chunk for a row kernel costing ~`cost` per element.
+int64_t row_grain(int64_t cols, int64_t cost) {
+  return std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, cost * cols));
+}
+
+Tensor norm_forward(bool rms, const char* name, const Tensor& x_in, const Tensor& weight_in,
+                    const Tensor& bias_in, double eps) {
+  XFT_RECORD_OP(name, x_in, weight_in, bias_in);
+  const Tensor x = autocast::to_float32(x_in);
+  const Tensor weight = autocast::to_float32(weight_in);
+  const Tensor bias = autocast::to_float32(bias_in);
+  const Rows r = check_rows(name, x);
+  check_param(name, "weight", weight, x);
+  check_param(name, "bias", bias, x);
+  const Tensor xc = x.contiguous();
+  const Tensor w = weight.defined() ? weight.contiguous() : Tensor();
+  const Tensor b = bias.defined() ? bias.contiguous() : Tensor();
+  Tensor y = Tensor::empty(x.sizes(), x.dtype(), x.device());
+  const DType sd = stats_dtype(x.dtype());
+  Tensor mean = rms ? Tensor() : Tensor::empty({r.rows}, sd, x.device());
+  Tensor rstd = Tensor::empty({r.rows}, sd, x.device());
+  if (r.rows > 0) {
+#ifdef XFT_USE_CUDA
+    if (x.device().is_cuda()) {
+      cuda::layer_norm(rms, xc, w, b, eps, y, mean, rstd, r.rows, r.cols);
+    } else
+#endif
+    {
+      check_device(name, x);
+      const auto& kernels = cpu::cpu_kernels();
+      const int64_t el = static_cast<int64_t>(x.element_size());
+      const int64_t sel = static_cast<int64_t>(rstd.element_size());
+      const char* px = static_cast<const char*>(xc.data_ptr());
+      char* py = static_cast<char*>(y.data_ptr());
+      char* pm = rms ? nullptr : static_cast<char*>(mean.data_ptr());
+      char* pr = static_cast<char*>(rstd.data_ptr());
+      parallel_for(0, r.rows, row_grain(r.cols, 3), [&](int64_t lo, int64_t hi) {
+        kernels.layer_norm(x.dtype(), rms, px + lo * r.cols * el, ptr_or_null(w), ptr_or_null(b),
+                           eps, py + lo * r.cols * el, pm != nullptr ? pm + lo * sel : nullptr,
+                           pr + lo * sel, hi - lo, r.cols);
+      });
+    }
+  }
+  autograd::record<autograd::LayerNormBackward>(y, {x, weight, bias}, rms, xc, w, mean, rstd);
+  return y;
+}
+
+}  // namespace
+
+Tensor layer_norm(const Tensor& x, const Tensor& weight, const Tensor& bias, double eps) {
+  return norm_forward(false, "layer_norm", x, weight, bias, eps);
+}
+
+Tensor rms_norm(const Tensor& x, const Tensor& weight, double eps) {
+  return norm_forward(true, "rms_norm", x, weight, Tensor(), eps);
+}
+
+NormGrads layer_norm_backward(bool rms, const Tensor& dy, const Tensor& x, const Tensor& mean,
+                              const Tensor& rstd, const Tensor& weight, bool need_dweight,
+                              bool need_dbias) {
+  XFT_RECORD_OP(rms ? "rms_norm_backward" : "layer_norm_backward", dy, x);
+  const Rows r = check_rows("layer_norm_backward", x);
+  const Tensor g = dy.contiguous();
+  NormGrads out;
+  out.dx = Tensor::empty(x.sizes(), x.dtype(), x.device());
+  const Shape param{r.cols};
+#ifdef XFT_USE_CUDA
+  if (x.device().is_cuda()) {
+    if (need_dweight) out.dweight = Tensor::empty(param, x.dtype(), x.device());
+    if (need_dbias) out.dbias = Tensor::empty(param, x.dtype(), x.device());
+    cuda::layer_norm_backward(rms, g, x, mean, rstd, weight, out.dx, out.dweight, out.dbias,
+                              r.rows, r.cols);
+    return out;
+  }
+#endif
+  check_device("layer_norm_backward", x);
+  // Each chunk of rows adds into its own row of partial dweight / dbias;
+  // the partials are summed at the end.
+  const int64_t chunks =
+      std::max<int64_t>(1, std::min<int64_t>(get_num_threads(), r.rows / row_grain(r.cols, 4)));
+  Tensor dw_part = need_dweight ? Tensor::zeros({chunks, r.cols}, x.dtype()) : Tensor();
+  Tensor db_part = need_dbias ? Tensor::zeros({chunks, r.cols}, x.dtype()) : Tensor();
+  if (r.rows > 0) {
+    const auto& kernels = cpu::cpu_kernels();
+    const int64_t el = static_cast<int64_t>(x.element_size());
+    const int64_t sel = static_cast<int64_t>(rstd.element_size());
+    const int64_t per = (r.rows + chunks - 1) / chunks;
+    const char* pg = static_cast<const char*>(g.data_ptr());
+    const char* px = static_cast<const char*>(x.data_ptr());
+    const char* pm = static_cast<const char*>(ptr_or_null(mean));
+    const char* pr = static_cast<const char*>(rstd.data_ptr());
+    char* pd = static_cast<char*>(out.dx.data_ptr());
+    char* pw = static_cast<char*>(const_cast<void*>(ptr_or_null(dw_part)));
+    char* pb = static_cast<char*>(const_cast<void*>(ptr_or_null(db_part)));
+    parallel_for(0, chunks, 1, [&](int64_t c0, int64_t c1) {
+      for (int64_t c = c0; c < c1; c++) {
+        const int64_t lo = c * per, hi = std::min(r.rows, lo + per);
+        if (lo >= hi) continue;
+        const int64_t off = lo * r.cols * el;
+        kernels.layer_norm_backward(x.dtype(), rms, pg + off, px + off,
+                                    pm != nullptr ? pm + lo * sel : nullptr, pr + lo * sel,
+                                    ptr_or_null(weight), pd + off,
+                                    pw != nullptr ? pw + c * r.cols * el : nullptr,
+                                    pb != nullptr ? pb + c * r.cols * el : nullptr, hi - lo,
+                                    r.cols);
+      }
+    });
+  }
+  if (need_dweight) out.dweight = sum(dw_part, 0);
+  if (need_dbias) out.dbias = sum(db_part, 0);
+  return out;
+}
+
+Tensor bias_gelu(const Tensor& x_in, const Tensor& bias_in) {
+  XFT_RECORD_OP("bias_gelu", x_in, bias_in);
+  const auto [x, bias] = autocast::promote(x_in, bias_in);
+  const Rows r = check_rows("bias_gelu", x);
+  XFT_CHECK(bias.defined(), "bias_gelu: bias is required");
+  check_param("bias_gelu", "bias", bias, x);
+  const Tensor xc = x.contiguous(), b = bias.contiguous();
+  Tensor y = Tensor::empty(x.sizes(), x.dtype(), x.device());
+  if (r.rows > 0) {
+#ifdef XFT_USE_CUDA
+    if (x.device().is_cuda()) {
+      cuda::bias_gelu(xc, b, y, r.rows, r.cols);
+    } else
+#endif
+    {
+      check_device("bias_gelu", x);
+      const auto& kernels = cpu::cpu_kernels();
+      const int64_t el = static_cast<int64_t>(x.element_size());
+      const char* px = static_cast<const char*>(xc.data_ptr());
+      char* py = static_cast<char*>(y.data_ptr());
+      parallel_for(0, r.rows, row_grain(r.cols, 4), [&](int64_t lo, int64_t hi) {
+        kernels.bias_gelu(x.dtype(), px + lo * r.cols * el, b.data_ptr(), py + lo * r.cols * el,
+                          hi - lo, r.cols);
+      });
+    }
+  }
+  autograd::record<autograd::BiasGeluBackward>(y, {x, bias}, xc, b);
+  return y;
+}
+
+std::pair<Tensor, Tensor> bias_gelu_backward(const Tensor& dy, const Tensor& x,
+                                             const Tensor& bias, bool need_dbias) {
+  XFT_RECORD_OP("bias_gelu_backward", dy, x);
+  const Rows r = check_rows("bias_gelu_backward", x);
+  const Tensor g = dy.contiguous();
+  Tensor dx = Tensor::empty(x.sizes(), x.dtype(), x.device());
+  if (r.rows > 0) {
+#ifdef XFT_USE_CUDA
+    if (x.device().is_cuda()) {
+      cuda::bias_gelu_backward(g, x, bias, dx, r.rows, r.cols);
+    } else
+#endif
+    {
+      check_device("bias_gelu_backward", x);
+      const auto& kernels = cpu::cpu_kernels();
+      const int64_t el = static_cast<int64_t>(x.element_size());
+      const char* pg = static_cast<const char*>(g.data_ptr());
+      const char* px = static_cast<const char*>(x.data_ptr());
+      char* pd = static_cast<char*>(dx.data_ptr());
+      parallel_for(0, r.rows, row_grain(r.cols, 6), [&](int64_t lo, int64_t hi) {
+        const int64_t off = lo * r.cols * el;
+        kernels.bias_gelu_backward(x.dtype(), pg + off, px + off, bias.data_ptr(), pd + off,
+                                   hi - lo, r.cols);
+      });
+    }
+  }
+  Tensor dbias = need_dbias ? sum_to_last_dim(dx) : Tensor();
+  return {dx, dbias};
+}
+
+namespace {
+
+// y = residual + mask * (x + bias) over the dense tensor, with the mask
+// drawn at `rng`; keep >= 1 keeps everything at `scale`.
+void dropout_add(const Tensor& x, const Tensor& bias, const Tensor& residual, Tensor& y,
+                 double keep, double scale, GeneratorState rng) {
+  const int64_t n = x.numel();
+  if (n == 0) return;
+  const int64_t cols = x.size(-1);
+#ifdef XFT_USE_CUDA
+  if (x.device().is_cuda()) {
+    cuda::dropout_add(x, bias, residual, y, cols, keep, scale, rng);
+    return;
+  }
+#endif
+  check_device("bias_dropout_residual", x);
+  const auto& kernels = cpu::cpu_kernels();
+  const int64_t el = static_cast<int64_t>(x.element_size());
+  const char* px = static_cast<const char*>(x.data_ptr());
+  const char* pr = static_cast<const char*>(ptr_or_null(residual));
+  char* py = static_cast<char*>(y.data_ptr());
+  parallel_for(0, n, kGrainSize / 8, [&](int64_t lo, int64_t hi) {
+    kernels.dropout_add(x.dtype(), px + lo * el, ptr_or_null(bias),
+                        pr != nullptr ? pr + lo * el : nullptr, py + lo * el, lo, hi - lo, cols,
+                        keep, scale, rng.seed, rng.offset);
+  });
+}
+
+}  // namespace
+
+Tensor bias_dropout_residual(const Tensor& x_in, const Tensor& bias_in, const Tensor& residual_in,
+                             double p, bool train) {
+  XFT_RECORD_OP("bias_dropout_residual", x_in, bias_in, residual_in);
+  // Promote pairwise; once x has risen to residual's dtype bias follows it.
+  auto [xb, bias] = autocast::promote(x_in, bias_in);
+  const auto [x, residual] = autocast::promote(xb, residual_in);
+  if (bias.defined() && bias.dtype() != x.dtype()) bias = autocast::promote(x, bias).second;
+  check_rows("bias_dropout_residual", x);
+  check_param("bias_dropout_residual", "bias", bias, x);
+  XFT_CHECK(p >= 0.0 && p <= 1.0, "bias_dropout_residual: p must be in [0, 1], got ", p);
+  XFT_CHECK(residual.sizes() == x.sizes() && residual.dtype() == x.dtype() &&
+                residual.device() == x.device(),
+            "bias_dropout_residual: residual must match x's shape, dtype and device");
+  const bool drop = train && p > 0.0;
+  const double keep = drop ? 1.0 - p : 1.0;
+  const double scale = !drop ? 1.0 : (p == 1.0 ? 0.0 : 1.0 / keep);
+  GeneratorState rng;
+  if (drop) {
+    // The 16-bit dtypes draw like float32, which they compute in.
+    const uint64_t per = x.dtype() == DType::Float64 ? kPhiloxPerBlock<double>
+                                                     : kPhiloxPerBlock<float>;
+    rng = default_generator(x.device()).reserve((x.numel() + per - 1) / per);
+  }
+  Tensor y = Tensor::empty(x.sizes(), x.dtype(), x.device());
+  dropout_add(x.contiguous(), bias.defined() ? bias.contiguous() : Tensor(),
+              residual.contiguous(), y, keep, scale, rng);
+  autograd::record<autograd::BiasDropoutResidualBackward>(y, {x, bias, residual}, keep, scale,
+                                                          rng);
+  return y;
+}
+
+Tensor dropout_mask_backward(const Tensor& dy, double keep, double scale, GeneratorState rng) {
+  XFT_RECORD_OP("dropout_mask_backward", dy);
+  if (keep >= 1.0 && scale == 1.0) return dy;
+  Tensor dx = Tensor::empty(dy.sizes(), dy.dtype(), dy.device());
+  dropout_add(dy.contiguous(), Tensor(), Tensor(), dx, keep, scale, rng);
+  return dx;
+}
+
+Tensor sum_to_last_dim(const Tensor& t) {
+  const Rows r = check_rows("sum_to_last_dim", t);
+  const Tensor flat = t.contiguous().view({r.rows, r.cols});
+#ifdef XFT_USE_CUDA
+  if (t.device().is_cuda()) {
+    Tensor out = Tensor::empty({r.cols}, t.dtype(), t.device());
+    cuda::column_sum(flat, out, r.rows, r.cols);
+    return out;
+  }
+#endif
+  return sum(flat, 0);
+}
+
+}  // namespace xft
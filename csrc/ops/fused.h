@@ -0,0 +1,45 @@
+#pragma once
+
+#include <utility>
+
+#include "core/generator.h"
+#include "core/tensor.h"
+
+namespace xft {
+
+// Single-pass replacements for chains of elementwise ops. Each reads and
+// writes the activation once instead of three to five times, which for
+// memory-bound ops is most of the cost. All work over the last dim, D =
+// x.size(-1); weight and bias are [D] and may be undefined. Floating
+// dtypes, on CPU and CUDA, and differentiable.
+
+// (x - mean) / sqrt(var + eps) * weight + bias, with the biased variance.
+// Backward keeps only x, weight and the per-row mean and rstd.
+Tensor layer_norm(const Tensor& x, const Tensor& weight, const Tensor& bias, double eps = 1e-5);
+// x / sqrt(mean(x^2) + eps) * weight.
+Tensor rms_norm(const Tensor& x, const Tensor& weight, double eps = 1e-6);
+// gelu(x + bias) (the tanh approximation, like gelu()). bias is required.
+Tensor bias_gelu(const Tensor& x, const Tensor& bias);
+// residual + dropout(x + bias, p). The mask is never stored: backward
+// regenerates it from the generator state the forward drew from. residual
+// has x's shape.
+Tensor bias_dropout_residual(const Tensor& x, const Tensor& bias, const Tensor& residual, double p,
+                             bool train = true);
+
+// Backward building blocks (csrc/autograd/functions.cpp); not themselves
+// differentiable. Gradients that are not asked for come back undefined.
+struct NormGrads {
+  Tensor dx, dweight, dbias;
+};
+NormGrads layer_norm_backward(bool rms, const Tensor& dy, const Tensor& x, const Tensor& mean,
+                              const Tensor& rstd, const Tensor& weight, bool need_dweight,
+                              bool need_dbias);
+// dx = dy * gelu'(x + bias), and dbias = dx summed over rows.
+std::pair<Tensor, Tensor> bias_gelu_backward(const Tensor& dy, const Tensor& x,
+                                             const Tensor& bias, bool need_dbias);
+// dy times the mask drawn at `rng`, i.e. the gradient w.r.t. x + bias.
+Tensor dropout_mask_backward(const Tensor& dy, double keep, double scale, GeneratorState rng);
+// Sums a tensor over every dim but the last: the gradient of a [D] bias.
+Tensor sum_to_last_dim(const Tensor& t);
+
+}  // namespace xft
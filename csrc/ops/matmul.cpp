@@ -0,0 +1,226 @@
+#include "ops/matmul.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "autograd/functions.h"
+#include "core/autocast.h"
+#include "core/autotune.h"
+#include "core/parallel.h"
+#include "core/profiler.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/gemm.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// Cache blocking for the CPU kernel: a k x n panel of b stays in L2 while
+// m rows of a stream past it, and tasks are m-row panels of out.
+struct GemmBlocking {
+  int64_t m, k, n;
+};
+
+// The blockings autotune::select() picks from per shape. The first, with a
+// 128 KiB fp32 panel of b, is the default; the others trade panel shape
+// for skinny or wide problems, and small m for more tasks when M is short.
+// Every blocking adds each c[i][j]'s products in the same (ascending k)
+// order, so all of them give identical results.
+constexpr GemmBlocking kBlockings[] = {
+    {64, 128, 256}, {32, 256, 128}, {64, 64, 512}, {128, 128, 128}, {16, 128, 1024}};
+// Below this much work per thread, waking workers costs more than it saves.
+constexpr int64_t kMinTaskMacs = int64_t(1) << 18;
+// Products smaller than this run the default blocking untimed.
+constexpr int64_t kMinTuneMacs = int64_t(1) << 22;
+
+// Row-major [M, K] @ [K, N] += into c with leading dims lda/ldb/ldc. The
+// i-k-j order keeps the innermost loop unit-stride over b and c.
+template <typename T>
+void gemm_cpu_kernel(const T* a, const T* b, T* c, int64_t m, int64_t n, int64_t k,
+                     int64_t lda, int64_t ldb, int64_t ldc, const GemmBlocking& blk) {
+  for (int64_t i0 = 0; i0 < m; i0 += blk.m) {
+    const int64_t i1 = std::min(i0 + blk.m, m);
+    for (int64_t k0 = 0; k0 < k; k0 += blk.k) {
+      const int64_t k1 = std::min(k0 + blk.k, k);
+      for (int64_t j0 = 0; j0 < n; j0 += blk.n) {
+        const int64_t j1 = std::min(j0 + blk.n, n);
+        for (int64_t i = i0; i < i1; i++) {
+          T* c_row = c + i * ldc;
+          for (int64_t p = k0; p < k1; p++) {
+            const T a_ip = a[i * lda + p];
+            const T* b_row = b + p * ldb;
+            for (int64_t j = j0; j < j1; j++) c_row[j] += a_ip * b_row[j];
+          }
+        }
+      }
+    }
+  }
+}
+
+// The CPU kernel needs unit column stride; row and batch strides (including
+// stride-0 broadcast batches) are used as they are.
+Tensor unit_col_stride(const Tensor& t) {
+  if (t.size(2) <= 1 || t.stride(2) == 1) return t;
+  return t.contiguous();
+}
+
+void bmm_blocked(const Tensor& a, const Tensor& b, const Tensor& out, const GemmBlocking& blk) {
+  const int64_t batch = out.size(0), m = out.size(1), n = out.size(2), k = a.size(2);
+  Tensor(out).fill_(0.0);
+  // Tasks are (batch, blk.m-row panel) pairs; each writes its own rows of
+  // out. A chunk gets at least kMinTaskMacs multiply-adds.
+  const int64_t panels = (m + blk.m - 1) / blk.m;
+  const int64_t task_macs = std::max<int64_t>(blk.m * n * k, 1);
+  const int64_t grain = std::max<int64_t>(1, kMinTaskMacs / task_macs);
+  XFT_DISPATCH_FLOATING_TYPES(out.dtype(), "bmm", [&] {
+    const scalar_t* pa = a.data<scalar_t>();
+    const scalar_t* pb = b.data<scalar_t>();
+    scalar_t* pc = out.data<scalar_t>();
+    parallel_for(0, batch * panels, grain, [&](int64_t lo, int64_t hi) {
+      for (int64_t task = lo; task < hi; task++) {
+        const int64_t z = task / panels, i0 = (task % panels) * blk.m;
+        const int64_t rows = std::min(blk.m, m - i0);
+        gemm_cpu_kernel(pa + z * a.stride(0) + i0 * a.stride(1), pb + z * b.stride(0),
+                        pc + z * m * n + i0 * n, rows, n, k, a.stride(1), b.stride(1), n, blk);
+      }
+    });
+  });
+}
+
+void bmm_cpu(const Tensor& a_in, const Tensor& b_in, const Tensor& out) {
+  if (is_reduced_floating(out.dtype())) {
+    // No 16-bit CPU GEMM: multiply float32 copies and round the result once.
+    Tensor out32 = Tensor::empty(out.sizes(), DType::Float32);
+    bmm_cpu(a_in.to(DType::Float32), b_in.to(DType::Float32), out32);
+    Tensor(out).copy_(out32);
+    return;
+  }
+  const Tensor a = unit_col_stride(a_in);
+  const Tensor b = unit_col_stride(b_in);
+  const int64_t batch = out.size(0), m = out.size(1), n = out.size(2), k = a.size(2);
+  int choice = 0;
+  if (batch * m * n * k >= kMinTuneMacs) {
+    std::vector<std::string> names;
+    for (const GemmBlocking& blk : kBlockings) {
+      names.push_back(std::to_string(blk.m) + "x" + std::to_string(blk.k) + "x" +
+                      std::to_string(blk.n));
+    }
+    choice = autotune::select(
+        autotune::make_key(autotune::cpu_arch(), "bmm", out.dtype(), {batch, m, n, k}), names,
+        [&](int i) { return autotune::time_cpu([&] { bmm_blocked(a, b, out, kBlockings[i]); }); });
+  }
+  bmm_blocked(a, b, out, kBlockings[choice]);
+}
+
+void check_operands(const char* op, const Tensor& a, const Tensor& b) {
+  XFT_CHECK(a.dtype() == b.dtype(), op, ": dtype mismatch (", dtype_name(a.dtype()), " vs ",
+            dtype_name(b.dtype()), ")");
+  XFT_CHECK(is_floating(a.dtype()), op, ": expected a floating dtype, got ",
+            dtype_name(a.dtype()));
+  XFT_CHECK(a.device() == b.device(), op, ": operands on different devices (",
+            a.device().str(), " vs ", b.device().str(), ")");
+}
+
+// a: [B, M, K], b: [B, K, N]; B may already be broadcast via stride 0.
+Tensor bmm_impl(const Tensor& a, const Tensor& b) {
+  XFT_CHECK(a.size(2) == b.size(1), "matmul: inner dimensions do not match (", a.size(2),
+            " vs ", b.size(1), ")");
+  Tensor out = Tensor::empty({a.size(0), a.size(1), b.size(2)}, a.dtype(), a.device());
+  if (out.numel() == 0) return out;
+#ifdef XFT_USE_CUDA
+  if (out.device().is_cuda()) {
+    cuda::bmm(a, b, out);
+    return out;
+  }
+#endif
+  XFT_CHECK(out.device().is_cpu(), "matmul: ", out.device().str(),
+            " is not supported by this build");
+  bmm_cpu(a, b, out);
+  return out;
+}
+
+// NumPy matmul semantics over bmm_impl.
+Tensor matmul_impl(const Tensor& a, const Tensor& b) {
+  if (a.dim() == 1 && b.dim() == 1) {
+    return bmm_impl(a.view({1, 1, a.size(0)}), b.view({1, b.size(0), 1})).view({});
+  }
+  // N-D @ 2-D: fold the leading dims of a into M and run one big mm.
+  if (b.dim() == 2 && a.dim() >= 2) {
+    Shape out_sizes(a.sizes().begin(), a.sizes().end() - 1);
+    Tensor a2 = a.reshape({1, shape_numel(out_sizes), a.size(-1)});
+    out_sizes.push_back(b.size(1));
+    return bmm_impl(a2, b.unsqueeze(0)).view(out_sizes);
+  }
+
+  const Tensor a_nd = a.dim() == 1 ? a.unsqueeze(0) : a;
+  const Tensor b_nd = b.dim() == 1 ? b.unsqueeze(-1) : b;
+  const int64_t m = a_nd.size(-2), k = a_nd.size(-1), n = b_nd.size(-1);
+  const Shape batch = broadcast_shapes(Shape(a_nd.sizes().begin(), a_nd.sizes().end() - 2),
+                                       Shape(b_nd.sizes().begin(), b_nd.sizes().end() - 2));
+  Shape a_sizes = batch, b_sizes = batch;
+  a_sizes.insert(a_sizes.end(), {m, k});
+  b_sizes.insert(b_sizes.end(), {b_nd.size(-2), n});
+  // Flattening the broadcast batch stays a view when the expanded dims line
+  // up (stride 0 throughout); otherwise reshape materializes it.
+  const int64_t nbatch = shape_numel(batch);
+  Tensor a3 = a_nd.expand(a_sizes).reshape({nbatch, m, k});
+  Tensor b3 = b_nd.expand(b_sizes).reshape({nbatch, b_nd.size(-2), n});
+
+  Shape out_sizes = batch;
+  if (a.dim() > 1) out_sizes.push_back(m);
+  if (b.dim() > 1) out_sizes.push_back(n);
+  return bmm_impl(a3, b3).view(out_sizes);
+}
+
+}  // namespace
+
+Tensor mm(const Tensor& a_in, const Tensor& b_in) {
+  XFT_RECORD_OP("mm", a_in, b_in);
+  const Tensor a = autocast::to_lower(a_in), b = autocast::to_lower(b_in);
+  check_operands("mm", a, b);
+  XFT_CHECK(a.dim() == 2 && b.dim() == 2, "mm: expected 2-D operands, got ", a.dim(), "-D and ",
+            b.dim(), "-D");
+  Tensor out;
+  {
+    autograd::NoGradGuard no_grad;
+    out = bmm_impl(a.unsqueeze(0), b.unsqueeze(0)).squeeze(0);
+  }
+  autograd::record<autograd::MatmulBackward>(out, {a, b}, a, b);
+  return out;
+}
+
+Tensor bmm(const Tensor& a_in, const Tensor& b_in) {
+  XFT_RECORD_OP("bmm", a_in, b_in);
+  const Tensor a = autocast::to_lower(a_in), b = autocast::to_lower(b_in);
+  check_operands("bmm", a, b);
+  XFT_CHECK(a.dim() == 3 && b.dim() == 3, "bmm: expected 3-D operands, got ", a.dim(),
+            "-D and ", b.dim(), "-D");
+  XFT_CHECK(a.size(0) == b.size(0), "bmm: batch sizes do not match (", a.size(0), " vs ",
+            b.size(0), ")");
+  Tensor out;
+  {
+    autograd::NoGradGuard no_grad;
+    out = bmm_impl(a, b);
+  }
+  autograd::record<autograd::MatmulBackward>(out, {a, b}, a, b);
+  return out;
+}
+
+Tensor matmul(const Tensor& a_in, const Tensor& b_in) {
+  XFT_RECORD_OP("matmul", a_in, b_in);
+  const Tensor a = autocast::to_lower(a_in), b = autocast::to_lower(b_in);
+  check_operands("matmul", a, b);
+  XFT_CHECK(a.dim() >= 1 && b.dim() >= 1, "matmul: operands must be at least 1-D");
+  Tensor out;
+  {
+    autograd::NoGradGuard no_grad;
+    out = matmul_impl(a, b);
+  }
+  autograd::record<autograd::MatmulBackward>(out, {a, b}, a, b);
+  return out;
+}
+
+}  // namespace xft
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// NumPy matmul semantics: 1-D operands are promoted (and the added dim
+// removed from the result), leading batch dims broadcast, and an N-D @ 2-D
+// product is folded into a single mm. Floating dtypes only; both operands
+// must share a dtype and device. Under autocast float32 operands run in
+// the lower dtype (core/autocast.h); float16 / bfloat16 accumulate in float32.
+Tensor matmul(const Tensor& a, const Tensor& b);
+// [M, K] @ [K, N] -> [M, N].
+Tensor mm(const Tensor& a, const Tensor& b);
+// [B, M, K] @ [B, K, N] -> [B, M, N].
+Tensor bmm(const Tensor& a, const Tensor& b);
+
+}  // namespace xft
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace xft {
+
+// Op selectors shared by the CPU kernel table and the CUDA kernels.
+enum class UnaryOp { Exp, Log, Sqrt, Tanh, Sigmoid, Relu, Gelu };
+constexpr int kNumUnaryOps = 7;
+// After the arithmetic ops:
+//  - GeMask / EqMask give 1 where a >= b (a == b) and 0 elsewhere, in the
+//    operands' dtype;
+//  - the *Backward ops (floating only) take (grad, saved) and give grad times
+//    the activation's derivative. The saved operand is the forward output,
+//    except for GeluBackward, which takes the forward input.
+enum class BinaryOp {
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Maximum,
+  Minimum,
+  GeMask,
+  EqMask,
+  ReluBackward,
+  SigmoidBackward,
+  TanhBackward,
+  GeluBackward,
+};
+constexpr int kNumBinaryOps = 12;
+enum class ReduceOp { Sum, Max };
+// Random fills with parameters (a, b): Uniform on [a, b), Normal with mean a
+// and standard deviation b, Bernoulli giving b with probability a and 0
+// otherwise.
+enum class RandomOp { Uniform, Normal, Bernoulli };
+
+}  // namespace xft
@@ -0,0 +1,273 @@
+#include "ops/optim.h"
+
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+#include "autograd/grad_mode.h"
+#include "core/parallel.h"
+#include "core/profiler.h"
+#include "ops/elementwise.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/optim.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// The CPU loops compute the 16-bit dtypes in float, like the CUDA kernels.
+template <typename T>
+using acc_t = std::conditional_t<std::is_same_v<T, Half> || std::is_same_v<T, BFloat16>, float, T>;
+
+void check_param(const char* op, const Tensor& p) {
+  XFT_CHECK(p.defined() && is_floating(p.dtype()) && p.is_contiguous(), op,
+            ": parameters must be dense floating tensors");
+}
+
+void check_like(const char* op, const char* what, const Tensor& t, const Tensor& p) {
+  XFT_CHECK(t.defined() && t.sizes() == p.sizes() && t.dtype() == p.dtype() &&
+                t.device() == p.device() && t.is_contiguous(),
+            op, ": each ", what, " must be dense and match its parameter's shape, dtype and "
+            "device");
+}
+
+void check_lists(const char* op, const std::vector<Tensor>& params,
+                 const std::vector<std::pair<const char*, const std::vector<Tensor>*>>& lists) {
+  for (const auto& [what, list] : lists) {
+    XFT_CHECK(list->size() == params.size(), op, ": got ", params.size(), " params but ",
+              list->size(), " ", what, "s");
+  }
+  for (size_t i = 0; i < params.size(); i++) {
+    check_param(op, params[i]);
+    for (const auto& [what, list] : lists) check_like(op, what, (*list)[i], params[i]);
+  }
+}
+
+// Every tensor below is written in place, behind autograd's back.
+void bump_versions(const std::vector<Tensor>& tensors) {
+  for (const Tensor& t : tensors) t.storage()->bump_version();
+}
+
+// Indices of `tensors` (undefined ones skipped) grouped by device and
+// dtype, groups in order of first appearance: each group is one batch of
+// multi-tensor launches.
+std::vector<std::vector<size_t>> group_by_device_and_dtype(const std::vector<Tensor>& tensors) {
+  std::vector<std::vector<size_t>> groups;
+  for (size_t i = 0; i < tensors.size(); i++) {
+    if (!tensors[i].defined()) continue;
+    auto it = groups.begin();
+    for (; it != groups.end(); ++it) {
+      const Tensor& head = tensors[it->front()];
+      if (head.device() == tensors[i].device() && head.dtype() == tensors[i].dtype()) break;
+    }
+    if (it == groups.end()) {
+      groups.emplace_back();
+      it = groups.end() - 1;
+    }
+    it->push_back(i);
+  }
+  return groups;
+}
+
+std::vector<Tensor> gather(const std::vector<Tensor>& list, const std::vector<size_t>& idx) {
+  std::vector<Tensor> out;
+  out.reserve(idx.size());
+  for (size_t i : idx) out.push_back(list[i]);
+  return out;
+}
+
+template <typename T>
+void sgd_cpu(T* p, const T* g, T* buf, int64_t n, const SGDOptions& o, bool first_step) {
+  using A = acc_t<T>;
+  const A lr = static_cast<A>(o.lr), momentum = static_cast<A>(o.momentum);
+  const A dampening = static_cast<A>(o.dampening), wd = static_cast<A>(o.weight_decay);
+  parallel_for(0, n, kGrainSize, [&](int64_t lo, int64_t hi) {
+    for (int64_t i = lo; i < hi; i++) {
+      const A param = static_cast<A>(p[i]);
+      A grad = static_cast<A>(g[i]) + wd * param;
+      if (buf != nullptr) {
+        const A b =
+            first_step ? grad : momentum * static_cast<A>(buf[i]) + (A(1) - dampening) * grad;
+        buf[i] = T(b);
+        grad = o.nesterov ? grad + momentum * b : b;
+      }
+      p[i] = T(param - lr * grad);
+    }
+  });
+}
+
+template <typename T>
+void adam_cpu(T* p, const T* g, T* m, T* v, int64_t n, const AdamOptions& o, int64_t step) {
+  using A = acc_t<T>;
+  const A lr = static_cast<A>(o.lr), wd = static_cast<A>(o.weight_decay);
+  const A beta1 = static_cast<A>(o.beta1), beta2 = static_cast<A>(o.beta2);
+  const A eps = static_cast<A>(o.eps);
+  const A step_size = static_cast<A>(o.lr / (1 - std::pow(o.beta1, static_cast<double>(step))));
+  const A bc2_sqrt =
+      static_cast<A>(std::sqrt(1 - std::pow(o.beta2, static_cast<double>(step))));
+  parallel_for(0, n, kGrainSize / 4, [&](int64_t lo, int64_t hi) {
+    for (int64_t i = lo; i < hi; i++) {
+      A param = static_cast<A>(p[i]);
+      A grad = static_cast<A>(g[i]);
+      if (o.decoupled_weight_decay) {
+        param -= lr * wd * param;
+      } else {
+        grad += wd * param;
+      }
+      const A mi = beta1 * static_cast<A>(m[i]) + (A(1) - beta1) * grad;
+      const A vi = beta2 * static_cast<A>(v[i]) + (A(1) - beta2) * grad * grad;
+      m[i] = T(mi);
+      v[i] = T(vi);
+      p[i] = T(param - step_size * mi / (std::sqrt(vi) / bc2_sqrt + eps));
+    }
+  });
+}
+
+template <typename T>
+double sum_squares_cpu(const T* x, int64_t n) {
+  std::atomic<double> total{0};
+  parallel_for(0, n, kGrainSize, [&](int64_t lo, int64_t hi) {
+    double acc = 0;
+    for (int64_t i = lo; i < hi; i++) {
+      const double v = static_cast<double>(static_cast<acc_t<T>>(x[i]));
+      acc += v * v;
+    }
+    double cur = total.load();
+    while (!total.compare_exchange_weak(cur, cur + acc)) {
+    }
+  });
+  return total.load();
+}
+
+template <typename T>
+void scale_cpu(T* x, int64_t n, double coef) {
+  using A = acc_t<T>;
+  const A c = static_cast<A>(coef);
+  parallel_for(0, n, kGrainSize, [&](int64_t lo, int64_t hi) {
+    for (int64_t i = lo; i < hi; i++) x[i] = T(static_cast<A>(x[i]) * c);
+  });
+}
+
+void check_cpu(const char* op, const Tensor& t) {
+  XFT_CHECK(t.device().is_cpu(), op, ": ", t.device().str(), " tensors are not supported yet");
+}
+
+}  // namespace
+
+void sgd_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+              const std::vector<Tensor>& momentum_buffers, const SGDOptions& options,
+              bool first_step) {
+  XFT_RECORD_OP("sgd_step", params);
+  const bool momentum = options.momentum != 0;
+  XFT_CHECK(!options.nesterov || (momentum && options.dampening == 0),
+            "sgd_step: nesterov needs momentum and zero dampening");
+  if (momentum) {
+    check_lists("sgd_step", params, {{"grad", &grads}, {"momentum buffer", &momentum_buffers}});
+  } else {
+    check_lists("sgd_step", params, {{"grad", &grads}});
+  }
+  autograd::NoGradGuard no_grad;
+  bump_versions(params);
+  if (momentum) bump_versions(momentum_buffers);
+  for (const auto& idx : group_by_device_and_dtype(params)) {
+    const std::vector<Tensor> p = gather(params, idx), g = gather(grads, idx);
+    const std::vector<Tensor> b = momentum ? gather(momentum_buffers, idx) : std::vector<Tensor>();
+#ifdef XFT_USE_CUDA
+    if (p[0].device().is_cuda()) {
+      cuda::sgd_step(p, g, b, options, first_step);
+      continue;
+    }
+#endif
+    check_cpu("sgd_step", p[0]);
+    for (size_t i = 0; i < p.size(); i++) {
+      XFT_DISPATCH_FLOATING_AND_HALF_TYPES(p[i].dtype(), "sgd_step", [&] {
+        sgd_cpu(p[i].data<scalar_t>(), g[i].data<scalar_t>(),
+                momentum ? b[i].data<scalar_t>() : nullptr, p[i].numel(), options, first_step);
+      });
+    }
+  }
+}
+
+void adam_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+               const std::vector<Tensor>& exp_avgs, const std::vector<Tensor>& exp_avg_sqs,
+               const AdamOptions& options, int64_t step) {
+  XFT_RECORD_OP("adam_step", params);
+  XFT_CHECK(step >= 1, "adam_step: steps count from 1, got ", step);
+  check_lists("adam_step", params,
+              {{"grad", &grads}, {"exp_avg", &exp_avgs}, {"exp_avg_sq", &exp_avg_sqs}});
+  autograd::NoGradGuard no_grad;
+  bump_versions(params);
+  bump_versions(exp_avgs);
+  bump_versions(exp_avg_sqs);
+  for (const auto& idx : group_by_device_and_dtype(params)) {
+    const std::vector<Tensor> p = gather(params, idx), g = gather(grads, idx);
+    const std::vector<Tensor> m = gather(exp_avgs, idx), v = gather(exp_avg_sqs, idx);
+#ifdef XFT_USE_CUDA
+    if (p[0].device().is_cuda()) {
+      cuda::adam_step(p, g, m, v, options, step);
+      continue;
+    }
+#endif
+    check_cpu("adam_step", p[0]);
+    for (size_t i = 0; i < p.size(); i++) {
+      XFT_DISPATCH_FLOATING_AND_HALF_TYPES(p[i].dtype(), "adam_step", [&] {
+        adam_cpu(p[i].data<scalar_t>(), g[i].data<scalar_t>(), m[i].data<scalar_t>(),
+                 v[i].data<scalar_t>(), p[i].numel(), options, step);
+      });
+    }
+  }
+}
+
+Tensor clip_grad_norm_(const std::vector<Tensor>& grads, double max_norm) {
+  XFT_RECORD_OP("clip_grad_norm_", grads);
+  autograd::NoGradGuard no_grad;
+  const auto groups = group_by_device_and_dtype(grads);
+  if (groups.empty()) return Tensor::zeros({}, DType::Float32);
+  const Device device = grads[groups[0][0]].device();
+  for (const auto& idx : groups) {
+    const Tensor& head = grads[idx[0]];
+    XFT_CHECK(head.device() == device, "clip_grad_norm_: grads on ", device.str(), " and ",
+              head.device().str());
+    for (size_t i : idx) {
+      XFT_CHECK(is_floating(grads[i].dtype()) && grads[i].is_contiguous(),
+                "clip_grad_norm_: grads must be dense floating tensors");
+    }
+  }
+  for (const auto& idx : groups) bump_versions(gather(grads, idx));
+#ifdef XFT_USE_CUDA
+  if (device.is_cuda()) {
+    Tensor sumsq = Tensor::zeros({}, DType::Float32, device);
+    for (const auto& idx : groups) cuda::sum_squares(gather(grads, idx), sumsq);
+    Tensor norm = sqrt(sumsq);
+    for (const auto& idx : groups) cuda::clip_by_norm_(gather(grads, idx), norm, max_norm);
+    return norm;
+  }
+#endif
+  check_cpu("clip_grad_norm_", grads[groups[0][0]]);
+  double total = 0;
+  for (const auto& idx : groups) {
+    for (size_t i : idx) {
+      XFT_DISPATCH_FLOATING_AND_HALF_TYPES(grads[i].dtype(), "clip_grad_norm_", [&] {
+        total += sum_squares_cpu(grads[i].data<scalar_t>(), grads[i].numel());
+      });
+    }
+  }
+  const double norm = std::sqrt(total);
+  const double coef = max_norm / (norm + 1e-6);
+  if (coef < 1) {
+    for (const auto& idx : groups) {
+      for (size_t i : idx) {
+        XFT_DISPATCH_FLOATING_AND_HALF_TYPES(grads[i].dtype(), "clip_grad_norm_", [&] {
+          scale_cpu(grads[i].data<scalar_t>(), grads[i].numel(), coef);
+        });
+      }
+    }
+  }
+  Tensor out = Tensor::empty({}, DType::Float32);
+  out.data<float>()[0] = static_cast<float>(norm);
+  return out;
+}
+
+}  // namespace xft
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// Fused optimizer steps (xft.optim). Each updates every parameter and its
+// state in place in one pass, reading the gradient once, instead of the
+// four to six elementwise ops per tensor of the unfused update. On CUDA,
+// tensors sharing a device and dtype are batched into multi-tensor launches
+// (cuda/optim.h), so a step costs a handful of launches however many
+// parameters there are. The lists are parallel: entry i of each belongs to
+// params[i]. Every tensor must be dense, floating (16-bit dtypes compute in
+// float) and match its parameter's shape, dtype and device. Not recorded
+// by autograd.
+
+struct SGDOptions {
+  double lr = 0.01;
+  double momentum = 0;
+  double dampening = 0;
+  double weight_decay = 0;
+  bool nesterov = false;
+};
+
+// g += weight_decay * p; with momentum, buf = momentum * buf +
+// (1 - dampening) * g (buf = g on the first step) and g becomes buf, or
+// g + momentum * buf with nesterov; then p -= lr * g. momentum_buffers may
+// be empty when momentum is 0.
+void sgd_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+              const std::vector<Tensor>& momentum_buffers, const SGDOptions& options,
+              bool first_step);
+
+struct AdamOptions {
+  double lr = 1e-3;
+  double beta1 = 0.9;
+  double beta2 = 0.999;
+  double eps = 1e-8;
+  double weight_decay = 0;
+  // AdamW: decay the parameter directly instead of adding it to the grad.
+  bool decoupled_weight_decay = false;
+};
+
+// One Adam step, the `step`-th (from 1) for every parameter given, with
+// bias-corrected moments: m = beta1 * m + (1 - beta1) * g, v = beta2 * v +
+// (1 - beta2) * g^2, p -= lr / (1 - beta1^step) * m /
+// (sqrt(v / (1 - beta2^step)) + eps).
+void adam_step(const std::vector<Tensor>& params, const std::vector<Tensor>& grads,
+               const std::vector<Tensor>& exp_avgs, const std::vector<Tensor>& exp_avg_sqs,
+               const AdamOptions& options, int64_t step);
+
+// Scales `grads` in place by min(1, max_norm / (norm + 1e-6)), norm being
+// their global L2 norm, and returns that norm as a float32 scalar on their
+// device, which they must all share. Undefined tensors are skipped. On CUDA
+// nothing synchronizes: the scale is read on the device.
+Tensor clip_grad_norm_(const std::vector<Tensor>& grads, double max_norm);
+
+}  // namespace xft
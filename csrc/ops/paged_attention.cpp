@@ -0,0 +1,286 @@
+#include "ops/paged_attention.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "autograd/node.h"
+#include "core/parallel.h"
+#include "core/profiler.h"
+#include "cpu/kernels.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/paged_attention.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+constexpr const char* kName = "paged_attention";
+
+void check_cache(const char* name, const Tensor& key_cache, const Tensor& value_cache) {
+  XFT_CHECK(is_floating(key_cache.dtype()), name, ": expected a floating cache, got ",
+            dtype_name(key_cache.dtype()));
+  XFT_CHECK(key_cache.dim() == 4, name,
+            ": caches must be [num_blocks, num_heads, block_size, head_dim], got ",
+            key_cache.dim(), "-D");
+  XFT_CHECK(value_cache.sizes() == key_cache.sizes() &&
+                value_cache.dtype() == key_cache.dtype() &&
+                value_cache.device() == key_cache.device(),
+            name, ": key and value caches must match in shape, dtype and device");
+  XFT_CHECK(key_cache.is_contiguous() && value_cache.is_contiguous(), name,
+            ": caches must be contiguous");
+}
+
+void check_cpu(const Tensor& t) {
+  XFT_CHECK(t.device().is_cpu(), kName, ": ", t.device().str(),
+            " is not supported by this build");
+}
+
+}  // namespace
+
+Tensor paged_attention(const Tensor& q, const Tensor& key_cache, const Tensor& value_cache,
+                       const Tensor& block_tables, const Tensor& context_lens,
+                       std::optional<double> scale) {
+  XFT_RECORD_OP(kName, q, key_cache, value_cache);
+  check_cache(kName, key_cache, value_cache);
+  XFT_CHECK(q.dtype() == key_cache.dtype() && q.device() == key_cache.device(), kName,
+            ": q must have the caches' dtype and device");
+  XFT_CHECK(q.dim() == 3 && q.size(2) == key_cache.size(3), kName, ": q must be [B, heads, ",
+            key_cache.size(3), "]");
+  PagedAttentionShape a{};
+  a.B = q.size(0), a.Hq = q.size(1), a.D = q.size(2);
+  a.num_blocks = key_cache.size(0), a.Hkv = key_cache.size(1), a.block_size = key_cache.size(2);
+  XFT_CHECK(a.Hkv > 0 && a.Hq % a.Hkv == 0, kName, ": ", a.Hq,
+            " query heads are not a multiple of ", a.Hkv, " kv heads");
+  XFT_CHECK(block_tables.dtype() == DType::Int32 && block_tables.dim() == 2 &&
+                block_tables.size(0) == a.B,
+            kName, ": block_tables must be int32 [", a.B, ", max_blocks]");
+  XFT_CHECK(context_lens.dtype() == DType::Int32 && context_lens.dim() == 1 &&
+                context_lens.size(0) == a.B,
+            kName, ": context_lens must be int32 [", a.B, "]");
+  XFT_CHECK(block_tables.device() == q.device() && context_lens.device() == q.device(), kName,
+            ": block_tables and context_lens must be on q's device");
+  XFT_CHECK(!autograd::needs_grad({q}), kName,
+            " is inference-only; run under no_grad or inference_mode");
+  a.max_blocks = block_tables.size(1);
+  a.scale = scale.value_or(1.0 / std::sqrt(static_cast<double>(std::max<int64_t>(a.D, 1))));
+
+  const Tensor qc = q.contiguous();
+  const Tensor tables = block_tables.contiguous(), lens = context_lens.contiguous();
+  Tensor out = Tensor::empty(q.sizes(), q.dtype(), q.device());
+  if (out.numel() == 0) return out;
+#ifdef XFT_USE_CUDA
+  if (q.device().is_cuda()) {
+    cuda::paged_attention(qc, key_cache, value_cache, tables, lens, out, a);
+    return out;
+  }
+#endif
+  check_cpu(q);
+  const int32_t* pt = static_cast<const int32_t*>(tables.data_ptr());
+  const int32_t* pl = static_cast<const int32_t*>(lens.data_ptr());
+  // The kernels trust the tables; a bad entry would read outside the pool.
+  for (int64_t b = 0; b < a.B; b++) {
+    XFT_CHECK(pl[b] >= 0 && pl[b] <= a.max_blocks * a.block_size, kName,
+              ": context length ", pl[b], " of sequence ", b, " does not fit its ",
+              a.max_blocks, " blocks");
+    for (int64_t i = 0; i * a.block_size < pl[b]; i++) {
+      const int32_t blk = pt[b * a.max_blocks + i];
+      XFT_CHECK(blk >= 0 && blk < a.num_blocks, kName, ": block ", blk, " of sequence ", b,
+                " is outside the cache's ", a.num_blocks, " blocks");
+    }
+  }
+  const auto& kernels = cpu::cpu_kernels();
+  const int64_t work = std::max<int64_t>(1, a.Hq / a.Hkv * a.D * a.max_blocks * a.block_size);
+  parallel_for(0, a.B * a.Hkv, std::max<int64_t>(1, kGrainSize / work),
+               [&](int64_t lo, int64_t hi) {
+                 kernels.paged_attention(q.dtype(), a, qc.data_ptr(), key_cache.data_ptr(),
+                                         value_cache.data_ptr(), pt, pl, out.data_ptr(), lo,
+                                         hi);
+               });
+  return out;
+}
+
+void paged_kv_store(const Tensor& k, const Tensor& v, Tensor& key_cache, Tensor& value_cache,
+                    const Tensor& slots) {
+  constexpr const char* name = "paged_kv_store";
+  XFT_RECORD_OP(name, k, v, slots);
+  check_cache(name, key_cache, value_cache);
+  const int64_t heads = key_cache.size(1), block_size = key_cache.size(2), D = key_cache.size(3);
+  XFT_CHECK(k.dim() == 3 && k.size(1) == heads && k.size(2) == D && v.sizes() == k.sizes(),
+            name, ": k and v must both be [T, ", heads, ", ", D, "]");
+  XFT_CHECK(k.dtype() == key_cache.dtype() && v.dtype() == key_cache.dtype() &&
+                k.device() == key_cache.device() && v.device() == key_cache.device(),
+            name, ": k and v must have the caches' dtype and device");
+  XFT_CHECK(slots.dtype() == DType::Int64 && slots.dim() == 1 && slots.size(0) == k.size(0) &&
+                slots.device() == k.device(),
+            name, ": slots must be int64 [", k.size(0), "] on the caches' device");
+  const int64_t T = k.size(0);
+  const int64_t num_slots = key_cache.size(0) * block_size;
+  if (T == 0) return;
+  const Tensor kc = k.contiguous(), vc = v.contiguous(), sc = slots.contiguous();
+#ifdef XFT_USE_CUDA
+  if (k.device().is_cuda()) {
+    cuda::paged_kv_store(kc, vc, key_cache, value_cache, sc);
+    return;
+  }
+#endif
+  XFT_CHECK(k.device().is_cpu(), name, ": ", k.device().str(), " is not supported by this build");
+  const size_t row_bytes = static_cast<size_t>(D) * k.element_size();
+  const int64_t* ps = static_cast<const int64_t*>(sc.data_ptr());
+  const char* pk = static_cast<const char*>(kc.data_ptr());
+  const char* pv = static_cast<const char*>(vc.data_ptr());
+  char* dk = static_cast<char*>(key_cache.data_ptr());
+  char* dv = static_cast<char*>(value_cache.data_ptr());
+  for (int64_t t = 0; t < T; t++) {
+    if (ps[t] < 0) continue;
+    XFT_CHECK(ps[t] < num_slots, name, ": slot ", ps[t], " is outside the cache's ", num_slots);
+    const int64_t blk = ps[t] / block_size, off = ps[t] % block_size;
+    for (int64_t h = 0; h < heads; h++) {
+      const int64_t dst = (blk * heads + h) * block_size + off, src = t * heads + h;
+      std::memcpy(dk + dst * row_bytes, pk + src * row_bytes, row_bytes);
+      std::memcpy(dv + dst * row_bytes, pv + src * row_bytes, row_bytes);
+    }
+  }
+}
+
+// ---- BlockAllocator ----
+
+BlockAllocator::BlockAllocator(int64_t num_blocks)
+    : num_blocks_(num_blocks), in_use_(std::max<int64_t>(num_blocks, 0), false) {
+  XFT_CHECK(num_blocks > 0, "BlockAllocator: num_blocks must be positive, got ", num_blocks);
+  // A stack, so block 0 is handed out first and freed blocks come back first.
+  free_.reserve(num_blocks);
+  for (int64_t b = num_blocks - 1; b >= 0; b--) free_.push_back(b);
+}
+
+int64_t BlockAllocator::allocate() {
+  XFT_CHECK(!free_.empty(), "BlockAllocator: all ", num_blocks_, " blocks are in use");
+  const int64_t b = free_.back();
+  free_.pop_back();
+  in_use_[b] = true;
+  return b;
+}
+
+void BlockAllocator::free(int64_t block) {
+  XFT_CHECK(block >= 0 && block < num_blocks_, "BlockAllocator: block ", block,
+            " is outside the pool's ", num_blocks_);
+  XFT_CHECK(in_use_[block], "BlockAllocator: block ", block, " is not allocated");
+  in_use_[block] = false;
+  free_.push_back(block);
+}
+
+// ---- PagedKVCache ----
+
+PagedKVCache::PagedKVCache(int64_t num_layers, int64_t num_blocks, int64_t block_size,
+                           int64_t num_heads, int64_t head_dim, DType dtype, Device device)
+    : block_size_(block_size), device_(device), allocator_(num_blocks) {
+  XFT_CHECK(num_layers > 0 && block_size > 0 && num_heads > 0 && head_dim > 0,
+            "PagedKVCache: layers, block size, heads and head dim must be positive");
+  XFT_CHECK(is_floating(dtype), "PagedKVCache: expected a floating dtype, got ",
+            dtype_name(dtype));
+  XFT_CHECK(num_blocks <= std::numeric_limits<int32_t>::max(),
+            "PagedKVCache: block ids are int32; ", num_blocks, " blocks is too many");
+  for (int64_t i = 0; i < num_layers; i++) {
+    key_caches_.push_back(
+        Tensor::empty({num_blocks, num_heads, block_size, head_dim}, dtype, device));
+    value_caches_.push_back(
+        Tensor::empty({num_blocks, num_heads, block_size, head_dim}, dtype, device));
+  }
+}
+
+int64_t PagedKVCache::add_sequence() {
+  const int64_t seq = next_seq_++;
+  sequences_.emplace(seq, Sequence());
+  return seq;
+}
+
+void PagedKVCache::remove_sequence(int64_t seq) {
+  const auto it = sequences_.find(seq);
+  XFT_CHECK(it != sequences_.end(), "PagedKVCache: no sequence ", seq);
+  for (int64_t b : it->second.blocks) allocator_.free(b);
+  sequences_.erase(it);
+}
+
+const PagedKVCache::Sequence& PagedKVCache::sequence(int64_t seq) const {
+  const auto it = sequences_.find(seq);
+  XFT_CHECK(it != sequences_.end(), "PagedKVCache: no sequence ", seq);
+  return it->second;
+}
+
+Tensor PagedKVCache::append_slots(const std::vector<int64_t>& seqs,
+                                  const std::vector<int64_t>& num_tokens) {
+  XFT_CHECK(seqs.size() == num_tokens.size(),
+            "PagedKVCache: append_slots needs one token count per sequence");
+  // Count first so a failure leaves every sequence as it was.
+  int64_t total = 0, needed = 0;
+  for (size_t i = 0; i < seqs.size(); i++) {
+    const Sequence& s = sequence(seqs[i]);
+    XFT_CHECK(num_tokens[i] >= 0, "PagedKVCache: negative token count ", num_tokens[i]);
+    for (size_t j = 0; j < i; j++) {
+      XFT_CHECK(seqs[j] != seqs[i], "PagedKVCache: sequence ", seqs[i], " appears twice");
+    }
+    const int64_t blocks = (s.length + num_tokens[i] + block_size_ - 1) / block_size_;
+    needed += blocks - static_cast<int64_t>(s.blocks.size());
+    total += num_tokens[i];
+  }
+  XFT_CHECK(needed <= allocator_.num_free(), "PagedKVCache: out of blocks (", needed,
+            " needed, ", allocator_.num_free(), " free)");
+  Tensor slots = Tensor::empty({total}, DType::Int64);
+  int64_t* ps = static_cast<int64_t*>(slots.data_ptr());
+  for (size_t i = 0; i < seqs.size(); i++) {
+    Sequence& s = sequences_.at(seqs[i]);
+    for (int64_t t = 0; t < num_tokens[i]; t++, s.length++) {
+      const int64_t j = s.length / block_size_;
+      if (j == static_cast<int64_t>(s.blocks.size())) s.blocks.push_back(allocator_.allocate());
+      *ps++ = s.blocks[j] * block_size_ + s.length % block_size_;
+    }
+  }
+  return device_.is_cpu() ? slots : slots.to(device_);
+}
+
+void PagedKVCache::store(int64_t layer, const Tensor& slots, const Tensor& k, const Tensor& v) {
+  XFT_CHECK(layer >= 0 && layer < static_cast<int64_t>(key_caches_.size()),
+            "PagedKVCache: no layer ", layer);
+  paged_kv_store(k, v, key_caches_[layer], value_caches_[layer], slots);
+}
+
+Tensor PagedKVCache::block_tables(const std::vector<int64_t>& seqs) const {
+  size_t width = 0;
+  for (int64_t seq : seqs) width = std::max(width, sequence(seq).blocks.size());
+  Tensor t = Tensor::empty({static_cast<int64_t>(seqs.size()), static_cast<int64_t>(width)},
+                           DType::Int32);
+  int32_t* p = static_cast<int32_t*>(t.data_ptr());
+  for (int64_t seq : seqs) {
+    const std::vector<int64_t>& blocks = sequence(seq).blocks;
+    for (size_t j = 0; j < width; j++) {
+      *p++ = j < blocks.size() ? static_cast<int32_t>(blocks[j]) : 0;
+    }
+  }
+  return device_.is_cpu() ? t : t.to(device_);
+}
+
+Tensor PagedKVCache::context_lens(const std::vector<int64_t>& seqs) const {
+  Tensor t = Tensor::empty({static_cast<int64_t>(seqs.size())}, DType::Int32);
+  int32_t* p = static_cast<int32_t*>(t.data_ptr());
+  for (int64_t seq : seqs) *p++ = static_cast<int32_t>(sequence(seq).length);
+  return device_.is_cpu() ? t : t.to(device_);
+}
+
+const Tensor& PagedKVCache::key_cache(int64_t layer) const {
+  XFT_CHECK(layer >= 0 && layer < static_cast<int64_t>(key_caches_.size()),
+            "PagedKVCache: no layer ", layer);
+  return key_caches_[layer];
+}
+
+const Tensor& PagedKVCache::value_cache(int64_t layer) const {
+  XFT_CHECK(layer >= 0 && layer < static_cast<int64_t>(value_caches_.size()),
+            "PagedKVCache: no layer ", layer);
+  return value_caches_[layer];
+}
+
+int64_t PagedKVCache::length(int64_t seq) const { return sequence(seq).length; }
+
+}  // namespace xft
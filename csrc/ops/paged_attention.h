@@ -0,0 +1,132 @@
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// Decode attention over a block-paged key/value cache.
+//
+// Autoregressive decoding adds one key and value row per generated token.
+// Keeping them as a growing tensor per sequence means a reallocation and a
+// copy of everything so far at every step (O(T^2) bytes over T tokens), and
+// a batch of sequences of different lengths fragments memory. A paged cache
+// instead preallocates one pool per layer, key_cache and value_cache of
+// [num_blocks, num_heads, block_size, head_dim], and hands every sequence
+// fixed-size blocks from it as it grows. A sequence's block table lists its
+// blocks in order, so token t lives at row t % block_size of block
+// table[t / block_size]; appending a token is a single row write per head.
+// Heads are outside the block's rows so that one head's keys in a block are
+// a single contiguous [block_size, head_dim] run.
+
+// The geometry of one paged_attention call as the kernels see it: q and out
+// [B, Hq, D], caches [num_blocks, Hkv, block_size, D], block tables int32
+// [B, max_blocks] and context lengths int32 [B]. Query head h reads kv head
+// h / (Hq / Hkv), so Hkv < Hq is grouped-query attention.
+struct PagedAttentionShape {
+  int64_t B, Hq, Hkv, D, num_blocks, block_size, max_blocks;
+  double scale;
+};
+
+// softmax(q . k^T * scale) @ v for one new query per sequence over the
+// first context_lens[b] tokens of sequence b in the cache, giving
+// [B, Hq, D] in q's dtype. Every token up to the context length is visible
+// (the new token's own key and value are expected to be stored already).
+// scale defaults to 1 / sqrt(D). Sequences of any mix of lengths share a
+// call; one of length 0 gives zeros. Floating dtypes (q and the caches
+// alike), on CPU and CUDA; 16-bit caches compute in float32. Inference
+// only: q must not require grad.
+Tensor paged_attention(const Tensor& q, const Tensor& key_cache, const Tensor& value_cache,
+                       const Tensor& block_tables, const Tensor& context_lens,
+                       std::optional<double> scale = std::nullopt);
+
+// Writes row t of k and v ([T, Hkv, D]) into slot slots[t] (int64 [T]) of
+// the caches, slot s being row s % block_size of block s / block_size in
+// every head.
+// Negative slots are skipped, for padded batches.
+void paged_kv_store(const Tensor& k, const Tensor& v, Tensor& key_cache, Tensor& value_cache,
+                    const Tensor& slots);
+
+// Fixed-size blocks 0 .. num_blocks - 1 of a pool, handed out and taken
+// back in O(1). Freed blocks are reused first, while they are still warm.
+class BlockAllocator {
+ public:
+  explicit BlockAllocator(int64_t num_blocks);
+
+  // Throws when every block is in use.
+  int64_t allocate();
+  void free(int64_t block);
+
+  int64_t num_blocks() const { return num_blocks_; }
+  int64_t num_free() const { return static_cast<int64_t>(free_.size()); }
+
+ private:
+  int64_t num_blocks_;
+  std::vector<int64_t> free_;
+  std::vector<bool> in_use_;
+};
+
+// A paged key/value cache for `num_layers` attention layers, with one
+// block allocator shared by all layers: a sequence's block table is the
+// same in every layer. Sequences are added and removed as requests come
+// and go; removing one returns its blocks to the pool.
+//
+// A decode step for sequences `seqs` is
+//   slots = cache.append_slots(seqs, {1, 1, ...});   // once per step
+//   tables = cache.block_tables(seqs), lens = cache.context_lens(seqs);
+//   per layer: cache.store(layer, slots, k, v);
+//              out = paged_attention(q, cache.key_cache(layer),
+//                                    cache.value_cache(layer), tables, lens);
+// and a prefill appends a prompt's tokens in one append_slots call.
+// Not thread-safe.
+class PagedKVCache {
+ public:
+  PagedKVCache(int64_t num_layers, int64_t num_blocks, int64_t block_size, int64_t num_heads,
+               int64_t head_dim, DType dtype, Device device = Device());
+
+  // A new, empty sequence's id.
+  int64_t add_sequence();
+  void remove_sequence(int64_t seq);
+
+  // Grows sequence seqs[i] by num_tokens[i] tokens, allocating blocks as
+  // they fill, and returns the new tokens' slots (int64 [sum(num_tokens)]
+  // on the cache's device, in order) for store(). All or nothing: throws
+  // without changing anything when the pool is too small.
+  Tensor append_slots(const std::vector<int64_t>& seqs, const std::vector<int64_t>& num_tokens);
+
+  // k and v [T, num_heads, head_dim] into layer `layer` at `slots`.
+  void store(int64_t layer, const Tensor& slots, const Tensor& k, const Tensor& v);
+
+  // int32 [seqs.size(), max blocks among them], padded with 0, and int32
+  // [seqs.size()] lengths, on the cache's device: paged_attention's
+  // arguments for that batch.
+  Tensor block_tables(const std::vector<int64_t>& seqs) const;
+  Tensor context_lens(const std::vector<int64_t>& seqs) const;
+
+  const Tensor& key_cache(int64_t layer) const;
+  const Tensor& value_cache(int64_t layer) const;
+
+  int64_t length(int64_t seq) const;
+  int64_t block_size() const { return block_size_; }
+  int64_t num_free_blocks() const { return allocator_.num_free(); }
+
+ private:
+  struct Sequence {
+    int64_t length = 0;
+    std::vector<int64_t> blocks;
+  };
+
+  const Sequence& sequence(int64_t seq) const;
+
+  int64_t block_size_;
+  Device device_;
+  BlockAllocator allocator_;
+  std::vector<Tensor> key_caches_, value_caches_;
+  std::unordered_map<int64_t, Sequence> sequences_;
+  int64_t next_seq_ = 0;
+};
+
+}  // namespace xft
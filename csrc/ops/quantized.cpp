@@ -0,0 +1,221 @@
+#include "ops/quantized.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "autograd/node.h"
+#include "core/parallel.h"
+#include "core/profiler.h"
+#include "cpu/kernels.h"
+#include "ops/elementwise.h"
+#include "ops/matmul.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/quantized.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+constexpr const char* kName = "quantized_linear";
+
+// Output columns per parallel_for chunk of the CPU kernels: enough weight
+// bytes per task to amortize the dispatch.
+int64_t col_grain(int64_t rows, int64_t k) {
+  return std::max<int64_t>(4, kGrainSize / std::max<int64_t>(1, rows * k));
+}
+
+cpu::QuantizedShape check_weight(const char* name, const QuantizedWeight& w) {
+  const Tensor& d = w.data;
+  const Tensor& s = w.scales;
+  XFT_CHECK(d.defined() && s.defined(), name, ": undefined quantized weight");
+  XFT_CHECK(d.dtype() == DType::Int8 || d.dtype() == DType::UInt8, name,
+            ": weight data must be int8 (8 bits) or uint8 (packed 4 bits), got ",
+            dtype_name(d.dtype()));
+  XFT_CHECK(d.dim() == 2 && s.dim() == 2 && s.dtype() == DType::Float32, name,
+            ": expected 2-D weight data and float32 [N, groups] scales");
+  XFT_CHECK(s.device() == d.device(), name, ": weight data and scales must be on one device");
+  cpu::QuantizedShape shape{};
+  shape.bits = w.bits();
+  shape.N = w.out_features();
+  shape.K = w.in_features();
+  XFT_CHECK(s.size(0) == shape.N && s.size(1) > 0 && shape.K % s.size(1) == 0, name,
+            ": scales must be [", shape.N, ", groups] with groups dividing ", shape.K, ", got [",
+            s.size(0), ", ", s.size(1), "]");
+  shape.group_size = w.group_size();
+  return shape;
+}
+
+// Rounds v / scale to the nearest integer in [lo, hi].
+inline int quantize_value(float v, float inv_scale, int lo, int hi) {
+  const float q = std::nearbyint(v * inv_scale);
+  return static_cast<int>(std::min(std::max(q, static_cast<float>(lo)), static_cast<float>(hi)));
+}
+
+// Per-row symmetric int8 quantization of a dense float32 [rows, k] buffer.
+void quantize_rows(const float* x, int8_t* q, float* scale, int64_t rows, int64_t k) {
+  parallel_for(0, rows, std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, k)),
+               [&](int64_t lo, int64_t hi) {
+                 for (int64_t r = lo; r < hi; r++) {
+                   const float* xr = x + r * k;
+                   float amax = 0.0f;
+                   for (int64_t i = 0; i < k; i++) amax = std::max(amax, std::fabs(xr[i]));
+                   scale[r] = amax / 127.0f;
+                   const float inv = amax > 0.0f ? 127.0f / amax : 0.0f;
+                   for (int64_t i = 0; i < k; i++) {
+                     q[r * k + i] = static_cast<int8_t>(quantize_value(xr[i], inv, -127, 127));
+                   }
+                 }
+               });
+}
+
+}  // namespace
+
+QuantizedWeight quantize_weight(const Tensor& weight, int bits, int64_t group_size) {
+  constexpr const char* name = "quantize_weight";
+  XFT_CHECK(is_floating(weight.dtype()) && weight.dim() == 2, name,
+            ": expected a 2-D floating weight, got ", weight.dim(), "-D ",
+            dtype_name(weight.dtype()));
+  XFT_CHECK(bits == 8 || bits == 4, name, ": bits must be 8 or 4, got ", bits);
+  const int64_t n = weight.size(0), k = weight.size(1);
+  const int64_t g = group_size == 0 ? k : group_size;
+  XFT_CHECK(g > 0 && k % g == 0, name, ": group_size ", group_size, " does not divide ", k);
+  XFT_CHECK(bits == 8 || k % 2 == 0, name, ": 4-bit rows must have an even length, got ", k);
+  const int qmax = bits == 8 ? 127 : 7;
+  const int qmin = bits == 8 ? -127 : -8;
+  const int64_t groups = k / g;
+
+  // A one-off conversion, done on the host.
+  const Tensor w = weight.to(Device()).to(DType::Float32).contiguous();
+  Tensor data = Tensor::empty({n, bits == 8 ? k : k / 2}, bits == 8 ? DType::Int8 : DType::UInt8);
+  Tensor scales = Tensor::empty({n, groups}, DType::Float32);
+  const float* pw = static_cast<const float*>(w.data_ptr());
+  auto* pd = static_cast<uint8_t*>(data.data_ptr());
+  auto* ps = static_cast<float*>(scales.data_ptr());
+  parallel_for(0, n, std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, k)),
+               [&](int64_t lo, int64_t hi) {
+                 for (int64_t r = lo; r < hi; r++) {
+                   for (int64_t gi = 0; gi < groups; gi++) {
+                     const float* src = pw + r * k + gi * g;
+                     float amax = 0.0f;
+                     for (int64_t i = 0; i < g; i++) amax = std::max(amax, std::fabs(src[i]));
+                     ps[r * groups + gi] = amax / qmax;
+                     const float inv = amax > 0.0f ? qmax / amax : 0.0f;
+                     for (int64_t i = 0; i < g; i++) {
+                       const int q = quantize_value(src[i], inv, qmin, qmax);
+                       const int64_t c = gi * g + i;
+                       if (bits == 8) {
+                         pd[r * k + c] = static_cast<uint8_t>(static_cast<int8_t>(q));
+                       } else if (c < k / 2) {  // the low nibbles come first
+                         pd[r * (k / 2) + c] = static_cast<uint8_t>(q + 8);
+                       } else {
+                         pd[r * (k / 2) + c - k / 2] |= static_cast<uint8_t>((q + 8) << 4);
+                       }
+                     }
+                   }
+                 }
+               });
+  if (!weight.device().is_cpu()) {
+    return {data.to(weight.device()), scales.to(weight.device())};
+  }
+  return {data, scales};
+}
+
+Tensor dequantize_weight(const QuantizedWeight& w) {
+  const cpu::QuantizedShape s = check_weight("dequantize_weight", w);
+  const Tensor data = w.data.contiguous(), scales = w.scales.contiguous();
+  Tensor out = Tensor::empty({s.N, s.K}, DType::Float32, data.device());
+#ifdef XFT_USE_CUDA
+  if (data.device().is_cuda()) {
+    cuda::dequantize_weight(data, scales, out, s.bits, s.group_size);
+    return out;
+  }
+#endif
+  XFT_CHECK(data.device().is_cpu(), "dequantize_weight: ", data.device().str(),
+            " is not supported by this build");
+  const auto* pd = static_cast<const uint8_t*>(data.data_ptr());
+  const float* ps = static_cast<const float*>(scales.data_ptr());
+  float* po = static_cast<float*>(out.data_ptr());
+  const int64_t groups = s.K / s.group_size;
+  parallel_for(0, s.N * s.K, kGrainSize, [&](int64_t lo, int64_t hi) {
+    for (int64_t i = lo; i < hi; i++) {
+      const int64_t r = i / s.K, c = i % s.K, half = s.K / 2;
+      const int q = s.bits == 8 ? static_cast<int8_t>(pd[i])
+                    : c < half  ? (pd[r * half + c] & 15) - 8
+                                : (pd[r * half + c - half] >> 4) - 8;
+      po[i] = static_cast<float>(q) * ps[r * groups + c / s.group_size];
+    }
+  });
+  return out;
+}
+
+Tensor quantized_linear(const Tensor& x, const QuantizedWeight& w, const Tensor& bias,
+                        bool dynamic) {
+  XFT_RECORD_OP(kName, x, w.data, bias);
+  cpu::QuantizedShape s = check_weight(kName, w);
+  XFT_CHECK(is_floating(x.dtype()), kName, ": expected a floating input, got ",
+            dtype_name(x.dtype()));
+  XFT_CHECK(x.dim() >= 1 && x.size(-1) == s.K, kName, ": input's last dim must be ", s.K);
+  XFT_CHECK(x.device() == w.data.device(), kName,
+            ": input and weight must be on the same device");
+  if (bias.defined()) {
+    XFT_CHECK(bias.dim() == 1 && bias.size(0) == s.N, kName, ": bias must be [", s.N, "]");
+    XFT_CHECK(bias.dtype() == x.dtype() && bias.device() == x.device(), kName,
+              ": bias must have the input's dtype and device");
+  }
+  XFT_CHECK(!autograd::needs_grad({x, bias}), kName,
+            ": quantized layers are inference-only; run under no_grad or inference_mode");
+  s.M = s.K == 0 ? 0 : x.numel() / s.K;
+  Shape out_shape = x.sizes();
+  out_shape.back() = s.N;
+
+  if (!dynamic && s.M > kQuantizedDirectRows) {
+    Tensor y = matmul(x, dequantize_weight(w).to(x.dtype()).transpose(0, 1));
+    return bias.defined() ? add(y, bias) : y;
+  }
+
+  const Tensor xc = x.contiguous();
+  const Tensor data = w.data.contiguous(), scales = w.scales.contiguous();
+  Tensor y = Tensor::empty(out_shape, x.dtype(), x.device());
+  if (y.numel() == 0) return y;
+#ifdef XFT_USE_CUDA
+  if (x.device().is_cuda()) {
+    const Tensor bc = bias.defined() ? bias.contiguous() : bias;
+    cuda::quantized_linear(xc, data, scales, bc, y, s.M, s.N, s.K, s.bits, s.group_size,
+                           dynamic);
+    return y;
+  }
+#endif
+  XFT_CHECK(x.device().is_cpu(), kName, ": ", x.device().str(),
+            " is not supported by this build");
+  // The kernels read float32 activations and bias and write float32.
+  const Tensor xf = xc.to(DType::Float32);
+  const Tensor bf = bias.defined() ? bias.to(DType::Float32).contiguous() : bias;
+  Tensor yf = y.dtype() == DType::Float32 ? y : Tensor::empty(out_shape, DType::Float32);
+  const float* pb = bf.defined() ? static_cast<const float*>(bf.data_ptr()) : nullptr;
+  float* py = static_cast<float*>(yf.data_ptr());
+  const auto& kernels = cpu::cpu_kernels();
+  if (dynamic) {
+    Tensor xq = Tensor::empty({s.M, s.K}, DType::Int8);
+    Tensor xs = Tensor::empty({s.M}, DType::Float32);
+    auto* pq = static_cast<int8_t*>(xq.data_ptr());
+    auto* pxs = static_cast<float*>(xs.data_ptr());
+    quantize_rows(static_cast<const float*>(xf.data_ptr()), pq, pxs, s.M, s.K);
+    parallel_for(0, s.N, col_grain(s.M, s.K), [&](int64_t lo, int64_t hi) {
+      kernels.quantized_linear_dynamic(s, pq, pxs, data.data_ptr(),
+                                       static_cast<const float*>(scales.data_ptr()), pb, py, lo,
+                                       hi);
+    });
+  } else {
+    const float* px = static_cast<const float*>(xf.data_ptr());
+    parallel_for(0, s.N, col_grain(s.M, s.K), [&](int64_t lo, int64_t hi) {
+      kernels.quantized_linear(s, px, data.data_ptr(),
+                               static_cast<const float*>(scales.data_ptr()), pb, py, lo, hi);
+    });
+  }
+  if (yf.dtype() != y.dtype()) y.copy_(yf);
+  return y;
+}
+
+}  // namespace xft
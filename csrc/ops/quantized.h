@@ -0,0 +1,50 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// A linear layer's weight stored in 8 or 4 bits, for inference.
+//
+// It stands for a floating [N, K] weight (N output features, K input
+// features, the nn.Linear layout) quantized symmetrically per group: each
+// row is cut into groups of group_size columns and every group has a scale
+// max|w| / qmax, so w ~= q * scale with no zero point.
+//  - int8: data is int8 [N, K], q in [-127, 127];
+//  - int4: data is uint8 [N, K / 2], q in [-8, 7] stored as q + 8, two to a
+//    byte: byte i of a row holds column i in its low nibble and column
+//    i + K / 2 in its high one, so unpacking is a mask and a shift with no
+//    interleaving. K must be even.
+// scales is float32 [N, K / group_size]; one group per row is per-channel
+// quantization. Both tensors are on one device.
+struct QuantizedWeight {
+  Tensor data;
+  Tensor scales;
+
+  int bits() const { return data.dtype() == DType::Int8 ? 8 : 4; }
+  int64_t out_features() const { return data.size(0); }
+  int64_t in_features() const { return bits() == 8 ? data.size(1) : 2 * data.size(1); }
+  int64_t group_size() const { return in_features() / scales.size(1); }
+};
+
+// Quantizes a 2-D floating weight to `bits` (8 or 4). group_size 0 means
+// one group per row; otherwise it must divide K. The result is on the
+// weight's device.
+QuantizedWeight quantize_weight(const Tensor& weight, int bits, int64_t group_size = 0);
+
+// The float32 [N, K] weight `w` stands for.
+Tensor dequantize_weight(const QuantizedWeight& w);
+
+// x [..., K] @ dequant(w)^T + bias ([N] or undefined), in x's dtype, on CPU
+// and CUDA. Weight-only (dynamic false): x stays floating and the kernels
+// widen the weights as they read them, so a decode step moves the quantized
+// bytes rather than float ones; past kQuantizedDirectRows rows of x, where
+// matmul is compute-bound, the weight is dequantized once and mm runs
+// instead. Dynamic: every row of x is quantized to int8 too (per-row
+// scale) and products accumulate in int32, with VNNI on AVX512-VNNI CPUs
+// and dp4a on CUDA. Not differentiable.
+constexpr int64_t kQuantizedDirectRows = 32;
+Tensor quantized_linear(const Tensor& x, const QuantizedWeight& w, const Tensor& bias,
+                        bool dynamic);
+
+}  // namespace xft
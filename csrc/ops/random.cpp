@@ -0,0 +1,126 @@
+#include "ops/random.h"
+
+#include <algorithm>
+
+#include "autograd/functions.h"
+#include "autograd/grad_mode.h"
+#include "core/parallel.h"
+#include "core/philox.h"
+#include "core/profiler.h"
+#include "ops/elementwise.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/random.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// Draws in A and stores as T; the 16-bit dtypes draw float values, so they
+// see the same stream as float32.
+template <typename T, typename A = T>
+void fill_cpu(T* out, int64_t n, RandomOp op, A a, A b, GeneratorState rng) {
+  constexpr int kPer = kPhiloxPerBlock<A>;
+  const int64_t blocks = (n + kPer - 1) / kPer;
+  // ~40 multiplies per block; split finer than plain elementwise work.
+  parallel_for(0, blocks, kGrainSize / 16, [&](int64_t lo, int64_t hi) {
+    A v[kPer];
+    for (int64_t blk = lo; blk < hi; blk++) {
+      const PhiloxBlock bits = philox(rng.seed, rng.offset + blk);
+      if (op == RandomOp::Normal) {
+        philox_normal(bits, v);
+      } else {
+        philox_uniform(bits, v);
+      }
+      const int64_t base = blk * kPer;
+      const int m = static_cast<int>(std::min<int64_t>(kPer, n - base));
+      for (int i = 0; i < m; i++) {
+        switch (op) {
+          case RandomOp::Uniform:
+            out[base + i] = T(a + (b - a) * v[i]);
+            break;
+          case RandomOp::Normal:
+            out[base + i] = T(a + b * v[i]);
+            break;
+          case RandomOp::Bernoulli:
+            out[base + i] = T(v[i] < a ? b : A(0));
+            break;
+        }
+      }
+    }
+  });
+}
+
+Tensor random_tensor(const char* name, const Shape& sizes, DType dtype, Device device,
+                     RandomOp op, double a, double b) {
+  XFT_CHECK(is_floating(dtype), name, ": expected a floating dtype, got ", dtype_name(dtype));
+  Tensor out = Tensor::empty(sizes, dtype, device);
+  random_fill_(out, op, a, b);
+  return out;
+}
+
+}  // namespace
+
+void random_fill_(Tensor& out, RandomOp op, double a, double b) {
+  XFT_CHECK(is_floating(out.dtype()), "random: expected a floating dtype, got ",
+            dtype_name(out.dtype()));
+  XFT_CHECK(out.is_contiguous(), "random: expected a contiguous output");
+  const int64_t n = out.numel();
+  if (n == 0) return;
+  const uint64_t per = out.dtype() == DType::Float64 ? kPhiloxPerBlock<double>
+                                                     : kPhiloxPerBlock<float>;
+  const GeneratorState rng = default_generator(out.device()).reserve((n + per - 1) / per);
+  out.storage()->bump_version();
+#ifdef XFT_USE_CUDA
+  if (out.device().is_cuda()) {
+    cuda::random_fill(out, op, a, b, rng);
+    return;
+  }
+#endif
+  XFT_CHECK(out.device().is_cpu(), "random: ", out.device().str(),
+            " tensors are not supported yet");
+  if (is_reduced_floating(out.dtype())) {
+    XFT_DISPATCH_HALF_TYPES(out.dtype(), "random", [&] {
+      fill_cpu<scalar_t, float>(static_cast<scalar_t*>(out.data_ptr()), n, op,
+                                static_cast<float>(a), static_cast<float>(b), rng);
+    });
+    return;
+  }
+  XFT_DISPATCH_FLOATING_TYPES(out.dtype(), "random", [&] {
+    fill_cpu<scalar_t>(static_cast<scalar_t*>(out.data_ptr()), n, op, static_cast<scalar_t>(a),
+                       static_cast<scalar_t>(b), rng);
+  });
+}
+
+Tensor rand(const Shape& sizes, DType dtype, Device device) {
+  XFT_RECORD_OP("rand", device);
+  return random_tensor("rand", sizes, dtype, device, RandomOp::Uniform, 0.0, 1.0);
+}
+
+Tensor randn(const Shape& sizes, DType dtype, Device device) {
+  XFT_RECORD_OP("randn", device);
+  return random_tensor("randn", sizes, dtype, device, RandomOp::Normal, 0.0, 1.0);
+}
+
+Tensor dropout(const Tensor& t, double p, bool train) {
+  XFT_RECORD_OP("dropout", t);
+  XFT_CHECK(p >= 0.0 && p <= 1.0, "dropout: p must be in [0, 1], got ", p);
+  XFT_CHECK(is_floating(t.dtype()), "dropout: expected a floating dtype, got ",
+            dtype_name(t.dtype()));
+  if (!train || p == 0.0) return t;
+  // The mask holds 0 or the survivor scale, so forward and backward are
+  // both a single multiply.
+  const double scale = p == 1.0 ? 0.0 : 1.0 / (1.0 - p);
+  Tensor mask = random_tensor("dropout", t.sizes(), t.dtype(), t.device(), RandomOp::Bernoulli,
+                              1.0 - p, scale);
+  Tensor out;
+  {
+    autograd::NoGradGuard no_grad;
+    out = mul(t, mask);
+  }
+  autograd::record<autograd::DropoutBackward>(out, {t}, mask);
+  return out;
+}
+
+}  // namespace xft
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/generator.h"
+#include "core/tensor.h"
+#include "ops/op_kinds.h"
+
+namespace xft {
+
+// Random tensors drawn from the default generator of their device. Values
+// depend only on the generator state (see core/philox.h), not on the thread
+// count or launch shape. Floating dtypes only.
+
+// Fills the dense floating tensor `out` in place and advances the generator.
+void random_fill_(Tensor& out, RandomOp op, double a, double b);
+
+// Uniform on [0, 1).
+Tensor rand(const Shape& sizes, DType dtype = DType::Float32, Device device = Device());
+// Standard normal.
+Tensor randn(const Shape& sizes, DType dtype = DType::Float32, Device device = Device());
+
+// Zeroes each element with probability p and scales the survivors by
+// 1 / (1 - p). Returns `t` itself when !train or p == 0. Backward multiplies
+// by the same mask, which is the only thing saved.
+Tensor dropout(const Tensor& t, double p, bool train = true);
+
+}  // namespace xft
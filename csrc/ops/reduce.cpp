@@ -0,0 +1,275 @@
+#include "ops/reduce.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "autograd/functions.h"
+#include "core/autocast.h"
+#include "core/autotune.h"
+#include "core/parallel.h"
+#include "core/profiler.h"
+#include "cpu/kernels.h"
+#include "ops/elementwise.h"
+
+#ifdef XFT_USE_CUDA
+#include "cuda/fused.h"
+#endif
+
+namespace xft {
+
+namespace {
+
+// A dense tensor seen as [outer, r, inner] around dimension `dim`.
+struct ReduceShape {
+  int64_t outer = 1, r = 1, inner = 1;
+};
+
+ReduceShape split_at(const Shape& sizes, int64_t dim) {
+  ReduceShape s;
+  for (int64_t d = 0; d < static_cast<int64_t>(sizes.size()); d++) {
+    if (d < dim) {
+      s.outer *= sizes[d];
+    } else if (d == dim) {
+      s.r = sizes[d];
+    } else {
+      s.inner *= sizes[d];
+    }
+  }
+  return s;
+}
+
+// Column blocks the kernel may combine rows in (0: all columns at once),
+// the default first; autotune::select() picks one per shape. Blocking
+// keeps every column's order of combination, so all give the same result.
+constexpr int64_t kReduceBlocks[] = {0, 1024, 4096, 16384};
+// Reductions over fewer elements, or with inner below the smallest block,
+// take the default untimed.
+constexpr int64_t kMinTuneElements = int64_t(1) << 22;
+
+// Rows of [outer, r, inner] go to different threads. A single slab (outer
+// == 1, e.g. a full reduction) is split along r instead: each thread reduces
+// its share into a row of partials, which one last pass combines.
+void reduce_blocked(ReduceOp op, const Tensor& in, const Tensor& out, const ReduceShape& s,
+                    int64_t block) {
+  const auto& kernels = cpu::cpu_kernels();
+  const char* pi = static_cast<const char*>(in.data_ptr());
+  char* po = static_cast<char*>(out.data_ptr());
+  const int64_t in_el = static_cast<int64_t>(in.element_size());
+  const int64_t out_el = static_cast<int64_t>(out.element_size());
+  const int64_t slab = std::max<int64_t>(s.r * s.inner, 1);
+
+  const int64_t splits = std::min({static_cast<int64_t>(get_num_threads()), s.r,
+                                   slab / kGrainSize});
+  if (s.outer == 1 && splits > 1) {
+    Tensor partials = Tensor::empty({splits, s.inner}, out.dtype());
+    char* pp = static_cast<char*>(partials.data_ptr());
+    const int64_t rows = (s.r + splits - 1) / splits;
+    parallel_for(0, splits, 1, [&](int64_t c0, int64_t c1) {
+      for (int64_t c = c0; c < c1; c++) {
+        const int64_t lo = c * rows, hi = std::min(s.r, lo + rows);
+        kernels.reduce(op, in.dtype(), pi + lo * s.inner * in_el, pp + c * s.inner * out_el, 1,
+                       hi - lo, s.inner, block);
+      }
+    });
+    kernels.reduce(op, out.dtype(), pp, po, 1, splits, s.inner, block);
+    return;
+  }
+  parallel_for(0, s.outer, std::max<int64_t>(1, kGrainSize / slab), [&](int64_t lo, int64_t hi) {
+    kernels.reduce(op, in.dtype(), pi + lo * slab * in_el, po + lo * s.inner * out_el, hi - lo,
+                   s.r, s.inner, block);
+  });
+}
+
+void reduce_cpu(ReduceOp op, const Tensor& in, const Tensor& out, const ReduceShape& s) {
+  int64_t block = kReduceBlocks[0];
+  if (is_floating(in.dtype()) && s.inner > kReduceBlocks[1] &&
+      s.outer * s.r * s.inner >= kMinTuneElements) {
+    std::vector<std::string> names;
+    for (int64_t b : kReduceBlocks) names.push_back(b == 0 ? "all" : std::to_string(b));
+    const std::string key =
+        autotune::make_key(autotune::cpu_arch(), op == ReduceOp::Sum ? "sum" : "max",
+                           in.dtype(), {s.outer, s.r, s.inner});
+    block = kReduceBlocks[autotune::select(key, names, [&](int i) {
+      return autotune::time_cpu([&] { reduce_blocked(op, in, out, s, kReduceBlocks[i]); });
+    })];
+  }
+  reduce_blocked(op, in, out, s, block);
+}
+
+Tensor reduce_op(ReduceOp op, const char* name, const Tensor& t, const ReduceShape& s,
+                 Shape out_sizes) {
+  XFT_RECORD_OP(name, t);
+  XFT_CHECK(op != ReduceOp::Max || s.r > 0, name, ": cannot reduce over an empty dimension");
+  const DType out_dtype =
+      op == ReduceOp::Sum && !is_floating(t.dtype()) ? DType::Int64 : t.dtype();
+  Tensor out = Tensor::empty(out_sizes, out_dtype, t.device());
+  if (out.numel() == 0) return out;
+  autograd::NoGradGuard no_grad;
+#ifdef XFT_USE_CUDA
+  if (t.device().is_cuda()) {
+    cuda::reduce(op, t.contiguous(), out, s.outer, s.r, s.inner);
+    return out;
+  }
+#endif
+  XFT_CHECK(t.device().is_cpu(), name, ": ", t.device().str(),
+            " tensors are not supported yet");
+  reduce_cpu(op, t.contiguous(), out, s);
+  return out;
+}
+
+Tensor reduce_all(ReduceOp op, const char* name, const Tensor& t) {
+  ReduceShape s;
+  s.r = t.numel();
+  return reduce_op(op, name, t, s, {});
+}
+
+Tensor reduce_dim(ReduceOp op, const char* name, const Tensor& t, int64_t dim, bool keepdim) {
+  dim = wrap_dim(dim, t.dim());
+  if (t.dim() == 0) return reduce_all(op, name, t);
+  Shape out_sizes = t.sizes();
+  if (keepdim) {
+    out_sizes[dim] = 1;
+  } else {
+    out_sizes.erase(out_sizes.begin() + dim);
+  }
+  return reduce_op(op, name, t, split_at(t.sizes(), dim), out_sizes);
+}
+
+Tensor scale(const Tensor& t, int64_t count) {
+  Tensor factor = Tensor::empty({}, t.dtype(), t.device());
+  factor.fill_(1.0 / static_cast<double>(count));
+  return mul(t, factor);
+}
+
+autograd::ReduceDims reduce_dims(const Tensor& t) { return {t.sizes(), 0, false, true}; }
+
+autograd::ReduceDims reduce_dims(const Tensor& t, int64_t dim, bool keepdim) {
+  if (t.dim() == 0) return reduce_dims(t);
+  return {t.sizes(), wrap_dim(dim, t.dim()), keepdim, false};
+}
+
+void check_floating(const char* name, const Tensor& t) {
+  XFT_CHECK(is_floating(t.dtype()), name, ": expected a floating dtype, got ",
+            dtype_name(t.dtype()));
+}
+
+}  // namespace
+
+Tensor sum(const Tensor& t_in) {
+  const Tensor t = autocast::to_float32(t_in);
+  Tensor out = reduce_all(ReduceOp::Sum, "sum", t);
+  autograd::record<autograd::SumBackward>(out, {t}, reduce_dims(t));
+  return out;
+}
+
+Tensor sum(const Tensor& t_in, int64_t dim, bool keepdim) {
+  const Tensor t = autocast::to_float32(t_in);
+  Tensor out = reduce_dim(ReduceOp::Sum, "sum", t, dim, keepdim);
+  autograd::record<autograd::SumBackward>(out, {t}, reduce_dims(t, dim, keepdim));
+  return out;
+}
+
+Tensor mean(const Tensor& t_in) {
+  const Tensor t = autocast::to_float32(t_in);
+  check_floating("mean", t);
+  Tensor out;
+  {
+    autograd::NoGradGuard no_grad;
+    out = scale(sum(t), t.numel());
+  }
+  autograd::record<autograd::MeanBackward>(out, {t}, reduce_dims(t), t.numel());
+  return out;
+}
+
+Tensor mean(const Tensor& t_in, int64_t dim, bool keepdim) {
+  const Tensor t = autocast::to_float32(t_in);
+  check_floating("mean", t);
+  const int64_t count = t.dim() == 0 ? 1 : t.size(dim);
+  Tensor out;
+  {
+    autograd::NoGradGuard no_grad;
+    out = scale(sum(t, dim, keepdim), count);
+  }
+  autograd::record<autograd::MeanBackward>(out, {t}, reduce_dims(t, dim, keepdim), count);
+  return out;
+}
+
+Tensor amax(const Tensor& t) {
+  Tensor out = reduce_all(ReduceOp::Max, "amax", t);
+  autograd::record<autograd::AmaxBackward>(out, {t}, reduce_dims(t), t, out);
+  return out;
+}
+
+Tensor amax(const Tensor& t, int64_t dim, bool keepdim) {
+  Tensor out = reduce_dim(ReduceOp::Max, "amax", t, dim, keepdim);
+  autograd::record<autograd::AmaxBackward>(out, {t}, reduce_dims(t, dim, keepdim), t, out);
+  return out;
+}
+
+Tensor softmax(const Tensor& t_in, int64_t dim) {
+  XFT_RECORD_OP("softmax", t_in);
+  const Tensor t = autocast::to_float32(t_in);
+  check_floating("softmax", t);
+  dim = wrap_dim(dim, t.dim());
+  const ReduceShape s = t.dim() == 0 ? ReduceShape{} : split_at(t.sizes(), dim);
+  Tensor out = Tensor::empty(t.sizes(), t.dtype(), t.device());
+  if (out.numel() > 0) {
+    autograd::NoGradGuard no_grad;
+    const Tensor in = t.contiguous();
+#ifdef XFT_USE_CUDA
+    if (t.device().is_cuda()) {
+      cuda::softmax(in, out, s.outer, s.r, s.inner);
+      autograd::record<autograd::SoftmaxBackward>(out, {t}, out, dim);
+      return out;
+    }
+#endif
+    XFT_CHECK(t.device().is_cpu(), "softmax: ", t.device().str(),
+              " tensors are not supported yet");
+    const auto& kernels = cpu::cpu_kernels();
+    const int64_t slab = s.r * s.inner * static_cast<int64_t>(t.element_size());
+    const char* pi = static_cast<const char*>(in.data_ptr());
+    char* po = static_cast<char*>(out.data_ptr());
+    // exp dominates, so a row is worth several times its element count.
+    const int64_t grain = std::max<int64_t>(1, kGrainSize / (4 * s.r * s.inner));
+    parallel_for(0, s.outer, grain, [&](int64_t lo, int64_t hi) {
+      kernels.softmax(t.dtype(), pi + lo * slab, po + lo * slab, hi - lo, s.r, s.inner);
+    });
+  }
+  autograd::record<autograd::SoftmaxBackward>(out, {t}, out, dim);
+  return out;
+}
+
+Tensor softmax_backward(const Tensor& grad, const Tensor& out, int64_t dim) {
+  XFT_RECORD_OP("softmax_backward", grad, out);
+  check_floating("softmax_backward", out);
+  XFT_CHECK(grad.sizes() == out.sizes() && grad.dtype() == out.dtype() &&
+                grad.device() == out.device(),
+            "softmax_backward: grad must match the output's shape, dtype and device");
+  dim = wrap_dim(dim, out.dim());
+  const ReduceShape s = out.dim() == 0 ? ReduceShape{} : split_at(out.sizes(), dim);
+  Tensor grad_in = Tensor::empty(out.sizes(), out.dtype(), out.device());
+  if (grad_in.numel() == 0) return grad_in;
+  const Tensor g = grad.contiguous(), y = out.contiguous();
+#ifdef XFT_USE_CUDA
+  if (out.device().is_cuda()) {
+    cuda::softmax_backward(g, y, grad_in, s.outer, s.r, s.inner);
+    return grad_in;
+  }
+#endif
+  XFT_CHECK(out.device().is_cpu(), "softmax_backward: ", out.device().str(),
+            " tensors are not supported yet");
+  const auto& kernels = cpu::cpu_kernels();
+  const int64_t slab = s.r * s.inner * static_cast<int64_t>(out.element_size());
+  const char* pg = static_cast<const char*>(g.data_ptr());
+  const char* py = static_cast<const char*>(y.data_ptr());
+  char* pd = static_cast<char*>(grad_in.data_ptr());
+  const int64_t grain = std::max<int64_t>(1, kGrainSize / (s.r * s.inner));
+  parallel_for(0, s.outer, grain, [&](int64_t lo, int64_t hi) {
+    kernels.softmax_backward(out.dtype(), pg + lo * slab, py + lo * slab, pd + lo * slab, hi - lo,
+                             s.r, s.inner);
+  });
+  return grad_in;
+}
+
+}  // namespace xft
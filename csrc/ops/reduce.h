@@ -0,0 +1,25 @@
+#pragma once
+
+#include "core/tensor.h"
+
+namespace xft {
+
+// Full reductions return a 0-d tensor; the dim overloads drop `dim` unless
+// keepdim. sum of an integer or bool tensor is int64; mean needs a floating
+// dtype; amax needs at least one element. Under autocast sum, mean and
+// softmax run float16 / bfloat16 inputs in float32 (core/autocast.h).
+Tensor sum(const Tensor& t);
+Tensor sum(const Tensor& t, int64_t dim, bool keepdim = false);
+Tensor mean(const Tensor& t);
+Tensor mean(const Tensor& t, int64_t dim, bool keepdim = false);
+Tensor amax(const Tensor& t);
+Tensor amax(const Tensor& t, int64_t dim, bool keepdim = false);
+
+// exp(t - max) / sum(exp(t - max)) along dim. Floating dtypes, on CPU and
+// CUDA.
+Tensor softmax(const Tensor& t, int64_t dim);
+// out * (grad - sum(grad * out)) along dim: the gradient of softmax given
+// its output, in one fused pass. Not itself differentiable.
+Tensor softmax_backward(const Tensor& grad, const Tensor& out, int64_t dim);
+
+}  // namespace xft
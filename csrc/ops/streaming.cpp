@@ -0,0 +1,141 @@
+#include "ops/streaming.h"
+
+#include <memory>
+
+#include "autograd/grad_mode.h"
+#include "ops/elementwise.h"
+#include "ops/matmul.h"
+#include "ops/reduce.h"
+
+namespace xft::streaming {
+
+namespace {
+
+enum class Reduction { Sum, Mean, Amax };
+
+Tensor reduce_chunk(Reduction op, const Tensor& t, std::optional<int64_t> dim, bool keepdim) {
+  switch (op) {
+    case Reduction::Sum: return dim ? xft::sum(t, *dim, keepdim) : xft::sum(t);
+    case Reduction::Mean: return dim ? xft::mean(t, *dim, keepdim) : xft::mean(t);
+    case Reduction::Amax: return dim ? xft::amax(t, *dim, keepdim) : xft::amax(t);
+  }
+  XFT_FAIL("unknown reduction");
+}
+
+Tensor reduce(Reduction op, const char* op_name, const std::string& path,
+              const std::string& name, std::optional<int64_t> dim, bool keepdim,
+              size_t chunk_bytes) {
+  autograd::NoGradGuard no_grad;
+  ChunkReader in(path, name, chunk_bytes);
+  const Shape& sizes = in.sizes();
+  if (dim) dim = wrap_dim(*dim, static_cast<int64_t>(sizes.size()));
+  XFT_CHECK(op != Reduction::Mean || is_floating(in.dtype()), op_name,
+            ": expected a floating dtype, got ", dtype_name(in.dtype()));
+
+  int64_t row = 0;
+  Tensor chunk = in.next(&row);
+  // No rows: the in-memory op on an empty tensor has the right result (or
+  // error).
+  if (!chunk.defined()) return reduce_chunk(op, Tensor::empty(sizes, in.dtype()), dim, keepdim);
+
+  if (dim && *dim > 0) {
+    // Rows reduce independently, straight into their slice of the result.
+    Tensor out;
+    for (; chunk.defined(); chunk = in.next(&row)) {
+      Tensor part = reduce_chunk(op, chunk, dim, keepdim);
+      if (!out.defined()) {
+        Shape out_sizes = part.sizes();
+        out_sizes[0] = sizes[0];
+        out = Tensor::empty(out_sizes, part.dtype());
+      }
+      out.slice(0, row, row + chunk.size(0)).copy_(part);
+    }
+    return out;
+  }
+
+  // Partials across rows combine as they arrive; a mean is a sum until the
+  // end.
+  const Reduction partial = op == Reduction::Mean ? Reduction::Sum : op;
+  Tensor acc;
+  DType out_dtype = in.dtype();
+  for (; chunk.defined(); chunk = in.next(&row)) {
+    Tensor part = reduce_chunk(partial, chunk, dim, keepdim);
+    out_dtype = part.dtype();
+    if (op != Reduction::Amax && is_reduced_floating(part.dtype())) part = part.to(DType::Float32);
+    if (!acc.defined()) {
+      acc = part;
+    } else {
+      acc = op == Reduction::Amax ? maximum(acc, part) : add(acc, part);
+    }
+  }
+  if (op == Reduction::Mean) {
+    const int64_t count = dim ? sizes[0] : shape_numel(sizes);
+    Tensor factor = Tensor::empty({}, acc.dtype());
+    factor.fill_(1.0 / static_cast<double>(count));
+    acc = mul(acc, factor);
+  }
+  return acc.dtype() == out_dtype ? acc : acc.to(out_dtype);
+}
+
+}  // namespace
+
+Tensor sum(const std::string& path, const std::string& name, std::optional<int64_t> dim,
+           bool keepdim, size_t chunk_bytes) {
+  return reduce(Reduction::Sum, "sum", path, name, dim, keepdim, chunk_bytes);
+}
+
+Tensor mean(const std::string& path, const std::string& name, std::optional<int64_t> dim,
+            bool keepdim, size_t chunk_bytes) {
+  return reduce(Reduction::Mean, "mean", path, name, dim, keepdim, chunk_bytes);
+}
+
+Tensor amax(const std::string& path, const std::string& name, std::optional<int64_t> dim,
+            bool keepdim, size_t chunk_bytes) {
+  return reduce(Reduction::Amax, "amax", path, name, dim, keepdim, chunk_bytes);
+}
+
+Tensor matvec(const std::string& path, const std::string& name, const Tensor& v,
+              size_t chunk_bytes) {
+  autograd::NoGradGuard no_grad;
+  XFT_CHECK(v.defined() && (v.dim() == 1 || v.dim() == 2),
+            "matvec: expected a vector or a [K, M] matrix");
+  ChunkReader in(path, name, chunk_bytes, v.device());
+  XFT_CHECK(in.sizes().size() == 2, "matvec: '", name, "' is not a matrix");
+  XFT_CHECK(in.sizes()[1] == v.size(0), "matvec: '", name, "' has ", in.sizes()[1],
+            " columns but v has ", v.size(0), " rows");
+  Shape out_sizes = {in.sizes()[0]};
+  if (v.dim() == 2) out_sizes.push_back(v.size(1));
+  Tensor out = Tensor::empty(out_sizes, v.dtype(), v.device());
+  int64_t row = 0;
+  for (Tensor chunk = in.next(&row); chunk.defined(); chunk = in.next(&row)) {
+    out.slice(0, row, row + chunk.size(0)).copy_(matmul(chunk, v));
+  }
+  return out;
+}
+
+int64_t map(const std::string& path, const std::string& name,
+            const std::function<Tensor(const Tensor&)>& fn, const std::string& out_path,
+            const std::string& out_name, size_t chunk_bytes, Device device) {
+  autograd::NoGradGuard no_grad;
+  ChunkReader in(path, name, chunk_bytes, device);
+  std::unique_ptr<ChunkWriter> out;
+  auto emit = [&](const Tensor& chunk) {
+    Tensor rows = fn(chunk);
+    XFT_CHECK(rows.defined() && rows.dim() >= 1 && rows.size(0) == chunk.size(0),
+              "map: fn must return one row per input row");
+    if (!out) {
+      Shape out_sizes = rows.sizes();
+      out_sizes[0] = in.sizes()[0];
+      out = std::make_unique<ChunkWriter>(out_path, out_name, out_sizes, rows.dtype());
+    }
+    out->write(rows);
+  };
+  Tensor chunk = in.next();
+  // With no rows, fn still sees an (empty) chunk to give the output's shape.
+  if (!chunk.defined()) emit(Tensor::empty(in.sizes(), in.dtype(), device));
+  for (; chunk.defined(); chunk = in.next()) emit(chunk);
+  out->close();
+  return out->rows_written();
+}
+
+}  // namespace xft::streaming
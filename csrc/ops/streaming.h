@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "core/streaming.h"
+#include "core/tensor.h"
+
+namespace xft::streaming {
+
+// Ops over tensor `name` of the checkpoint at `path` that never load it
+// whole: each reads the file once, front to back, through a ChunkReader
+// (core/streaming.h), running the in-memory op on one chunk of rows while
+// the next is read. Memory use is a few chunks of chunk_bytes plus the
+// result, whatever the size of the file. Results are not recorded by
+// autograd.
+
+// Reductions as in ops/reduce.h, on the CPU: with no dim over every
+// element, otherwise along `dim`. Across the rows (dim 0) the chunks'
+// partial results are combined as they arrive, in float32 for float16 /
+// bfloat16; along any other dim each chunk's rows reduce independently
+// into their slice of the result.
+Tensor sum(const std::string& path, const std::string& name,
+           std::optional<int64_t> dim = std::nullopt, bool keepdim = false,
+           size_t chunk_bytes = kDefaultChunkBytes);
+Tensor mean(const std::string& path, const std::string& name,
+            std::optional<int64_t> dim = std::nullopt, bool keepdim = false,
+            size_t chunk_bytes = kDefaultChunkBytes);
+Tensor amax(const std::string& path, const std::string& name,
+            std::optional<int64_t> dim = std::nullopt, bool keepdim = false,
+            size_t chunk_bytes = kDefaultChunkBytes);
+
+// X @ v for the stored matrix X [N, K] and v of [K] (or a few vectors at
+// once as the columns of a [K, M] matrix), giving [N] (or [N, M]) in v's
+// dtype on v's device. On CUDA the chunks are staged through pinned memory
+// and copied to the device asynchronously, so the copy of one chunk, the
+// read of the next and the product on the previous all overlap.
+Tensor matvec(const std::string& path, const std::string& name, const Tensor& v,
+              size_t chunk_bytes = kDefaultChunkBytes);
+
+// Writes fn(rows) for every chunk of rows, computed on `device`, to tensor
+// out_name of a new checkpoint at out_path. fn must keep the number of rows
+// (dim 0); the result's other dims and dtype are those of its first output,
+// and every later output must match them. Returns the number of rows
+// written.
+int64_t map(const std::string& path, const std::string& name,
+            const std::function<Tensor(const Tensor&)>& fn, const std::string& out_path,
+            const std::string& out_name, size_t chunk_bytes = kDefaultChunkBytes,
+            Device device = Device());
+
+}  // namespace xft::streaming
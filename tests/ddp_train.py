@@ -0,0 +1,57 @@
+"""One rank of the DistributedDataParallel run in test_distributed.py.
+
+Trains a linear regression on this rank's shard of a fixed batch. Before
+every step it checks that the loss is a 0-d CUDA tensor and that the grads
+backward leaves behind, averaged across ranks, equal the grads of the
+full-batch loss computed without DDP. Exits non-zero on a mismatch.
+"""
+
+import unittest
+
+import xft
+import xft.nn.functional as F
+from util import assert_close, make, randlist
+
+ROWS_PER_RANK, D_IN, D_OUT, STEPS = 8, 16, 4, 3
+
+
+def mse(x, y, w, b):
+    diff = F.linear(x, w, b) - y
+    return (diff * diff).mean()
+
+
+def main():
+    tc = unittest.TestCase()
+    pg = xft.distributed.init_process_group()
+    rank, world = pg.rank, pg.world_size
+    dev = "cuda:%d" % pg.device
+    n = ROWS_PER_RANK * world
+    x = make(randlist(n * D_IN, seed=1), [n, D_IN]).to(dev)
+    y = make(randlist(n * D_OUT, seed=2), [n, D_OUT]).to(dev)
+    # Different on each rank: DDP must broadcast rank 0's values.
+    w = make(randlist(D_OUT * D_IN, seed=3 + rank), [D_OUT, D_IN]).to(dev).requires_grad_()
+    b = xft.zeros(D_OUT, device=dev, requires_grad=True)
+
+    model = xft.distributed.DistributedDataParallel(lambda x, y: mse(x, y, w, b), [w, b])
+    opt = xft.optim.SGD([w, b], lr=0.1)
+    lo, hi = rank * ROWS_PER_RANK, (rank + 1) * ROWS_PER_RANK
+    for step in range(STEPS):
+        # Equal shards: the mean of the shard losses is the full-batch loss.
+        w_ref = w.detach().clone().requires_grad_()
+        b_ref = b.detach().clone().requires_grad_()
+        mse(x, y, w_ref, b_ref).backward()
+
+        opt.zero_grad()
+        loss = model(x[lo:hi], y[lo:hi])
+        tc.assertEqual(loss.shape, ())
+        tc.assertTrue(loss.is_cuda)
+        loss.backward()
+        tag = "rank %d step %d" % (rank, step)
+        assert_close(tc, w.grad.cpu(), w_ref.grad.cpu(), 1e-5, 1e-6, "w.grad " + tag)
+        assert_close(tc, b.grad.cpu(), b_ref.grad.cpu(), 1e-5, 1e-6, "b.grad " + tag)
+        opt.step()
+    print("rank %d: %d steps ok" % (rank, STEPS))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,144 @@
+"""Mixed precision: the float16 and bfloat16 dtypes, CPU autocast and
+GradScaler."""
+
+import unittest
+
+import xft
+from util import assert_close, flat, make, randlist, randt
+
+
+class DtypeTest(unittest.TestCase):
+    def test_dtype_conversions(self):
+        x = [0.5, -1.25, 3.0, 1e-3]
+        for dtype in (xft.float64, xft.float16, xft.bfloat16):
+            back = make(x, [4]).to(dtype).float()
+            assert_close(self, back, x, 1e-2, 1e-3, str(dtype))
+        self.assertEqual(flat(make(x, [4]).to(xft.int32)), [0, -1, 3, 0])
+
+    def test_round_to_nearest_even(self):
+        # Halfway cases go to the even mantissa; out of range goes to inf
+        # (float16) and below the smallest subnormal to zero.
+        h = [1 + 2 ** -11, 1 + 3 * 2 ** -11, 70000.0, 1e-8]
+        self.assertEqual(flat(make(h, [4]).to(xft.float16).float()),
+                         [1.0, 1 + 2 ** -9, float("inf"), 0.0])
+        b = [1 + 2 ** -8, 1 + 3 * 2 ** -8, -2.5]
+        self.assertEqual(flat(make(b, [3]).to(xft.bfloat16).float()), [1.0, 1 + 2 ** -6, -2.5])
+
+
+class AutocastTest(unittest.TestCase):
+    def test_cpu_dtype_choices(self):
+        a, b = randt(3, 4, seed=1), randt(4, 5, seed=2)
+        h = a.to(xft.bfloat16)
+        self.assertFalse(xft.amp.is_autocast_enabled("cpu"))
+        self.assertEqual(xft.amp.get_autocast_dtype("cpu"), xft.bfloat16)
+        with xft.amp.autocast("cpu"):
+            self.assertTrue(xft.amp.is_autocast_enabled("cpu"))
+            self.assertFalse(xft.amp.is_autocast_enabled("cuda"))
+            # Matmul-like ops run float32 inputs in the autocast dtype.
+            self.assertEqual(xft.matmul(a, b).dtype, xft.bfloat16)
+            q, k = randt(1, 2, 4, seed=3), randt(1, 3, 4, seed=4)
+            self.assertEqual(
+                xft.nn.functional.scaled_dot_product_attention(q, k, k).dtype, xft.bfloat16)
+            # ... but leave other dtypes alone.
+            self.assertEqual(xft.matmul(a.to(xft.float64), b.to(xft.float64)).dtype,
+                             xft.float64)
+            # Reductions, softmax, exp and the norms run 16-bit inputs in float32.
+            for got in (xft.sum(h), xft.mean(h), xft.softmax(h, -1), xft.exp(h),
+                        xft.layer_norm(h)):
+                self.assertEqual(got.dtype, xft.float32)
+            # Binary ops promote mixed inputs and keep matching ones.
+            self.assertEqual((h + a).dtype, xft.float32)
+            self.assertEqual((h * h).dtype, xft.bfloat16)
+        self.assertEqual(xft.matmul(a, b).dtype, xft.float32)
+
+    def test_nesting_and_dtype(self):
+        a, b = randt(2, 3, seed=1), randt(3, 2, seed=2)
+        with xft.amp.autocast("cpu"):
+            with xft.amp.autocast("cpu", dtype=xft.float16):
+                self.assertEqual(xft.matmul(a, b).dtype, xft.float16)
+                with xft.amp.autocast("cpu", enabled=False):
+                    self.assertEqual(xft.matmul(a, b).dtype, xft.float32)
+                self.assertEqual(xft.matmul(a, b).dtype, xft.float16)
+            self.assertEqual(xft.matmul(a, b).dtype, xft.bfloat16)
+        self.assertEqual(xft.amp.get_autocast_dtype("cpu"), xft.bfloat16)
+
+    def test_grads_in_leaf_dtype(self):
+        a = randt(3, 4, seed=1)
+        w = randt(4, 5, seed=2).requires_grad_()
+        with xft.amp.autocast("cpu"):
+            y = xft.matmul(a, w)
+        self.assertEqual(y.dtype, xft.bfloat16)
+        y.sum().backward()
+        self.assertEqual(w.grad.dtype, xft.float32)
+
+
+class GradScalerTest(unittest.TestCase):
+    def setup(self, grads, **kwargs):
+        """A scaler and an SGD(lr=1) over one parameter per grad, each grad
+        already multiplied by the scale as backward would leave it."""
+        scaler = xft.amp.GradScaler(**kwargs)
+        params = [xft.zeros(len(g)).requires_grad_() for g in grads]
+        for p, g in zip(params, grads):
+            p.grad = make([v * scaler.get_scale() for v in g], [len(g)])
+        return scaler, params, xft.optim.SGD(params, lr=1.0)
+
+    def test_step_unscales(self):
+        grads = [randlist(5, seed=1), randlist(3, seed=2)]
+        scaler, params, opt = self.setup(grads, init_scale=1024.0)
+        scaler.step(opt)
+        scaler.update()
+        for p, g in zip(params, grads):
+            assert_close(self, p.grad, g)
+            assert_close(self, p, [-v for v in g])
+        self.assertEqual(scaler.get_scale(), 1024.0)
+
+    def test_inf_or_nan_skips_step_and_backs_off(self):
+        for bad in (float("inf"), float("-inf"), float("nan")):
+            scaler, params, opt = self.setup([[1.0, 2.0], [3.0, bad]], init_scale=8.0,
+                                             backoff_factor=0.25)
+            self.assertIsNone(scaler.step(opt))
+            scaler.update()
+            # No parameter moves, even the one whose grads were finite.
+            for p in params:
+                self.assertEqual(flat(p), [0.0, 0.0], str(bad))
+            self.assertEqual(scaler.get_scale(), 2.0, str(bad))
+
+    def test_growth_interval(self):
+        scaler = xft.amp.GradScaler(init_scale=4.0, growth_interval=3)
+        p = xft.zeros(2).requires_grad_()
+        opt = xft.optim.SGD([p], lr=0.0)
+
+        def iteration(grad):
+            p.grad = make(grad, [2])
+            scaler.step(opt)
+            scaler.update()
+            return scaler.get_scale()
+
+        # Three clean steps in a row grow the scale; an overflow backs it
+        # off and starts the count again.
+        self.assertEqual([iteration([1.0, 1.0]) for _ in range(3)], [4.0, 4.0, 8.0])
+        self.assertEqual(iteration([1.0, 1.0]), 8.0)
+        self.assertEqual(iteration([float("inf"), 1.0]), 4.0)
+        self.assertEqual([iteration([1.0, 1.0]) for _ in range(3)], [4.0, 4.0, 8.0])
+        self.assertEqual(scaler.state_dict()["growth_tracker"], 0)
+
+    def test_unscale_once_per_iteration(self):
+        scaler, _, opt = self.setup([[1.0]])
+        scaler.unscale_(opt)
+        with self.assertRaisesRegex(RuntimeError, "already called"):
+            scaler.unscale_(opt)
+        scaler.step(opt)  # uses the unscale_ above
+        scaler.update()
+        scaler.unscale_(opt)
+
+    def test_disabled_passes_through(self):
+        scaler, params, opt = self.setup([[2.0]], enabled=False)
+        loss = make([3.0], [])
+        self.assertIs(scaler.scale(loss), loss)
+        self.assertEqual(scaler.get_scale(), 1.0)
+        scaler.step(opt)
+        self.assertEqual(flat(params[0]), [-2.0])
+
+
+if __name__ == "__main__":
+    unittest.main()
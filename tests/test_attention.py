@@ -0,0 +1,53 @@
+"""The fused scaled_dot_product_attention against a scalar reference and
+against the same computation composed from matmul and softmax.
+
+Run once per kernel table, like test_kernels. The longest query runs past
+one 32-row task, and every shape runs with and without the causal mask.
+"""
+
+import math
+import unittest
+
+import xft
+from util import TOL, assert_close, flat, make, pin_cpu_capability, randlist, randt, ref_attention
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class AttentionTest(unittest.TestCase):
+    def check(self, B, H, L, S, D, Dv, causal, dtype):
+        q = randlist(B * H * L * D, seed=1)
+        k = randlist(B * H * S * D, seed=2)
+        v = randlist(B * H * S * Dv, seed=3)
+        got = flat(xft.nn.functional.scaled_dot_product_attention(
+            make(q, [B, H, L, D], dtype), make(k, [B, H, S, D], dtype),
+            make(v, [B, H, S, Dv], dtype), is_causal=causal))
+        scale = 1.0 / math.sqrt(D)
+        rtol, atol = TOL[dtype]
+        for h in range(B * H):
+            want = ref_attention(q[h * L * D:(h + 1) * L * D], k[h * S * D:(h + 1) * S * D],
+                                 v[h * S * Dv:(h + 1) * S * Dv], L, S, D, Dv, scale, causal)
+            assert_close(self, got[h * L * Dv:(h + 1) * L * Dv], want, rtol * 10, atol * 10,
+                         "L=%d S=%d D=%d causal=%s %s" % (L, S, D, causal, dtype))
+
+    def test_against_reference(self):
+        for causal in (False, True):
+            for dtype in (xft.float32, xft.float64):
+                self.check(1, 2, 5, 5, 8, 8, causal, dtype)
+                self.check(2, 1, 3, 70, 16, 4, causal, dtype)
+                self.check(1, 1, 40, 33, 7, 9, causal, dtype)
+
+    def test_matches_composed_ops(self):
+        # The fused kernel against matmul and softmax in float64.
+        q, k, v = randt(3, 6, 5, seed=1, dtype=xft.float64), randt(3, 9, 5, seed=2,
+                                                                    dtype=xft.float64), \
+            randt(3, 9, 4, seed=3, dtype=xft.float64)
+        got = xft.nn.functional.scaled_dot_product_attention(q, k, v)
+        probs = xft.softmax(xft.matmul(q, k.transpose(1, 2)) * (1.0 / math.sqrt(5)), -1)
+        assert_close(self, got, xft.matmul(probs, v), 1e-13, 1e-13)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,234 @@
+"""Gradients from backward() against central finite differences, in float64.
+
+Each check reduces f(inputs) to a scalar through fixed random weights, so
+every output element carries a distinct weight, and compares d/dx of that
+scalar with (L(x + eps) - L(x - eps)) / (2 eps) for every element of every
+input.
+"""
+
+import unittest
+
+import xft
+import xft.nn.functional as F
+from util import assert_close, flat, make, numel, randlist
+
+F64 = xft.float64
+
+
+def leaf(shape, seed, lo=-1.0, hi=1.0):
+    return make(randlist(numel(shape), lo, hi, seed), list(shape), F64).requires_grad_()
+
+
+class GradcheckTest(unittest.TestCase):
+    EPS = 1e-6
+
+    def gradcheck(self, fn, inputs, rtol=1e-6, atol=1e-7, rng_state=None, msg=""):
+        """inputs: tensors that require grad. fn may draw random numbers if
+        rng_state is given; every evaluation then starts from it."""
+        values = [flat(t) for t in inputs]
+        shapes = [t.shape for t in inputs]
+
+        def loss_of(vals, record):
+            if rng_state is not None:
+                xft.set_rng_state(rng_state)
+            ts = [make(v, list(s), F64) for v, s in zip(vals, shapes)]
+            if record:
+                ts = [t.requires_grad_() for t in ts]
+            out = fn(*ts)
+            weights = make(randlist(out.numel(), seed=99), list(out.shape), F64)
+            return ts, (out * weights).sum()
+
+        ts, loss = loss_of(values, True)
+        loss.backward()
+        for i, t in enumerate(ts):
+            numeric = []
+            for j in range(len(values[i])):
+                plus = [list(v) for v in values]
+                minus = [list(v) for v in values]
+                plus[i][j] += self.EPS
+                minus[i][j] -= self.EPS
+                with xft.no_grad():
+                    hi = loss_of(plus, False)[1].item()
+                    lo = loss_of(minus, False)[1].item()
+                numeric.append((hi - lo) / (2 * self.EPS))
+            self.assertIsNotNone(t.grad, "%s: input %d has no grad" % (msg, i))
+            assert_close(self, t.grad, numeric, rtol, atol, "%s: input %d" % (msg, i))
+
+
+class ElementwiseGradTest(GradcheckTest):
+    def test_unary(self):
+        for name in ("exp", "tanh", "sigmoid", "gelu"):
+            self.gradcheck(getattr(xft, name), [leaf((3, 5), 1)], msg=name)
+        # Away from relu's kink and log/sqrt's pole.
+        self.gradcheck(xft.relu, [leaf((11,), 2, 0.1, 1.0)], msg="relu+")
+        self.gradcheck(xft.relu, [leaf((11,), 2, -1.0, -0.1)], msg="relu-")
+        self.gradcheck(xft.log, [leaf((7,), 3, 0.5, 2.0)], msg="log")
+        self.gradcheck(xft.sqrt, [leaf((7,), 4, 0.5, 2.0)], msg="sqrt")
+
+    def test_binary_broadcast(self):
+        for name in ("add", "sub", "mul", "div"):
+            op = getattr(xft, name)
+            self.gradcheck(op, [leaf((3, 4), 1), leaf((4,), 2, 0.5, 1.5)], msg=name + " row")
+            self.gradcheck(op, [leaf((3, 1), 3), leaf((1, 4), 4, 0.5, 1.5)], msg=name + " outer")
+        self.gradcheck(lambda a, b: xft.maximum(a, b), [leaf((9,), 5), leaf((9,), 6)],
+                       msg="maximum")
+
+    def test_scalar_operands(self):
+        self.gradcheck(lambda a: 2.0 * a - 1.0, [leaf((5,), 1)])
+        self.gradcheck(lambda a: 1.0 / a, [leaf((5,), 2, 0.5, 2.0)])
+        self.gradcheck(lambda a: -a, [leaf((5,), 3)])
+
+    def test_reused_input(self):
+        # Gradients from two uses of one tensor accumulate.
+        self.gradcheck(lambda a: a * a + a.exp() * a, [leaf((6,), 1)])
+
+
+class ReductionGradTest(GradcheckTest):
+    def test_sum_mean(self):
+        for dim in (None, 0, 1, -1):
+            self.gradcheck(lambda a: xft.sum(a, dim), [leaf((3, 4, 2), 1)], msg="sum %s" % dim)
+            self.gradcheck(lambda a: xft.mean(a, dim, keepdim=True), [leaf((3, 4, 2), 2)],
+                           msg="mean %s" % dim)
+
+    def test_amax(self):
+        # Distinct values: the max is unique and differentiable.
+        vals = [float(v) for v in (3, 1, 4, 1.5, 5, 9, 2, 6, 5.5, 3.5, 8, 7)]
+        x = make(vals, [3, 4], F64).requires_grad_()
+        self.gradcheck(lambda a: xft.amax(a, 1), [x], msg="amax dim")
+        self.gradcheck(lambda a: xft.amax(a), [x], msg="amax all")
+
+
+class MatmulGradTest(GradcheckTest):
+    def test_shapes(self):
+        self.gradcheck(xft.matmul, [leaf((3, 4), 1), leaf((4, 5), 2)], msg="mm")
+        self.gradcheck(xft.matmul, [leaf((2, 3, 4), 3), leaf((2, 4, 2), 4)], msg="bmm")
+        self.gradcheck(xft.matmul, [leaf((2, 3, 4), 5), leaf((4, 2), 6)], msg="broadcast")
+        self.gradcheck(xft.matmul, [leaf((3, 4), 7), leaf((4,), 8)], msg="matvec")
+        self.gradcheck(xft.matmul, [leaf((4,), 9), leaf((4,), 10)], msg="dot")
+
+    def test_transposed_operand(self):
+        self.gradcheck(lambda a, b: xft.matmul(a.T, b), [leaf((4, 3), 1), leaf((4, 2), 2)])
+
+    def test_linear(self):
+        self.gradcheck(F.linear, [leaf((5, 4), 1), leaf((3, 4), 2), leaf((3,), 3)])
+
+
+class ViewGradTest(GradcheckTest):
+    def test_views(self):
+        self.gradcheck(lambda a: a.transpose(0, 1) * make(randlist(12, seed=5), [4, 3], F64),
+                       [leaf((3, 4), 1)], msg="transpose")
+        self.gradcheck(lambda a: a.permute(2, 0, 1).reshape(4, 6), [leaf((2, 3, 4), 2)],
+                       msg="permute")
+        self.gradcheck(lambda a: a[1:, ::2].exp(), [leaf((3, 5), 3)], msg="slice")
+        self.gradcheck(lambda a: a.select(1, 2) * 3.0, [leaf((3, 4), 4)], msg="select")
+        self.gradcheck(lambda a: a.unsqueeze(1).expand(3, 4, 2).tanh(), [leaf((3, 2), 5)],
+                       msg="expand")
+        self.gradcheck(lambda a: a.view(6, 2).squeeze(), [leaf((3, 4), 6)], msg="view")
+
+    def test_contiguous(self):
+        self.gradcheck(lambda a: a.T.contiguous(), [leaf((3, 4), 1)], msg="contiguous")
+        self.gradcheck(lambda a: a.contiguous(xft.channels_last), [leaf((1, 2, 3, 2), 2)],
+                       msg="channels_last")
+
+
+class LayerGradTest(GradcheckTest):
+    def test_softmax(self):
+        for dim in (-1, 0, 1):
+            self.gradcheck(lambda a: xft.softmax(a, dim), [leaf((3, 5, 2), dim + 2)],
+                           msg="softmax %d" % dim)
+
+    def test_norms(self):
+        self.gradcheck(lambda x, w, b: xft.layer_norm(x, w, b),
+                       [leaf((4, 6), 1), leaf((6,), 2), leaf((6,), 3)], rtol=1e-5, atol=1e-6,
+                       msg="layer_norm")
+        self.gradcheck(xft.layer_norm, [leaf((3, 5), 4)], rtol=1e-5, atol=1e-6,
+                       msg="layer_norm no affine")
+        self.gradcheck(lambda x, w: xft.rms_norm(x, w), [leaf((4, 6), 5), leaf((6,), 6)],
+                       rtol=1e-5, atol=1e-6, msg="rms_norm")
+
+    def test_bias_gelu(self):
+        self.gradcheck(xft.bias_gelu, [leaf((3, 5), 1), leaf((5,), 2)])
+
+    def test_attention(self):
+        for causal in (False, True):
+            self.gradcheck(
+                lambda q, k, v: F.scaled_dot_product_attention(q, k, v, is_causal=causal),
+                [leaf((1, 2, 4, 3), 1), leaf((1, 2, 5, 3), 2), leaf((1, 2, 5, 2), 3)],
+                rtol=1e-5, atol=1e-6, msg="sdpa causal=%s" % causal)
+
+    def test_conv2d(self):
+        self.gradcheck(lambda x, w, b: F.conv2d(x, w, b, stride=1, padding=1),
+                       [leaf((1, 2, 4, 4), 1), leaf((3, 2, 3, 3), 2), leaf((3,), 3)],
+                       rtol=1e-5, atol=1e-6, msg="conv2d")
+        self.gradcheck(lambda x, w: F.conv2d(x, w, stride=2, groups=2),
+                       [leaf((1, 4, 5, 5), 4), leaf((2, 2, 2, 2), 5)], rtol=1e-5, atol=1e-6,
+                       msg="conv2d strided grouped")
+
+    def test_dropout(self):
+        # The same (seed, offset) gives the same mask in every evaluation.
+        xft.manual_seed(7)
+        state = xft.get_rng_state()
+        self.gradcheck(lambda a: xft.dropout(a, 0.4), [leaf((4, 5), 1)], rng_state=state,
+                       msg="dropout")
+        self.gradcheck(lambda x, b, r: xft.bias_dropout_residual(x, b, r, p=0.3),
+                       [leaf((3, 4), 2), leaf((4,), 3), leaf((3, 4), 4)], rng_state=state,
+                       msg="bias_dropout_residual")
+
+    def test_checkpoint(self):
+        def block(x, w):
+            return xft.matmul(x, w).gelu().softmax(-1)
+
+        self.gradcheck(lambda x, w: xft.checkpoint(block, x, w), [leaf((3, 4), 1),
+                                                                 leaf((4, 5), 2)],
+                       msg="checkpoint")
+
+
+class EngineTest(unittest.TestCase):
+    def test_accumulates_across_backward_calls(self):
+        w = leaf((3,), 1)
+        (w * 2.0).sum().backward()
+        (w * 3.0).sum().backward()
+        assert_close(self, w.grad, [5.0] * 3)
+
+    def test_retain_graph(self):
+        w = leaf((3,), 1)
+        loss = (w.exp() * w).sum()
+        loss.backward(retain_graph=True)
+        first = flat(w.grad)
+        loss.backward()
+        assert_close(self, w.grad, [2 * g for g in first], 1e-12, 1e-12)
+        with self.assertRaises(RuntimeError):
+            loss.backward()
+
+    def test_no_grad_and_detach(self):
+        w = leaf((3,), 1)
+        with xft.no_grad():
+            self.assertIsNone((w * 2.0).grad_fn)
+        self.assertIsNone(w.detach().grad_fn)
+        self.assertFalse(xft.ones(3).requires_grad)
+        self.assertIsNotNone((w * 2.0).grad_fn)
+
+    def test_gradient_argument(self):
+        w = leaf((2, 2), 1)
+        (w * 3.0).backward(make([1.0, 2.0, 3.0, 4.0], [2, 2], F64))
+        assert_close(self, w.grad, [3.0, 6.0, 9.0, 12.0])
+
+    def test_dtype_cast(self):
+        # Casts pass the gradient through, converted back.
+        w = leaf((4,), 1)
+        (w.float() * 2.0).sum().backward()
+        self.assertEqual(w.grad.dtype, F64)
+        assert_close(self, w.grad, [2.0] * 4)
+
+    def test_inplace_on_saved_tensor_is_rejected(self):
+        w = leaf((3,), 1)
+        x = make([1.0, 2.0, 3.0], [3], F64)
+        loss = (w * x).sum()
+        with xft.no_grad():
+            x.mul_(2.0)
+        with self.assertRaises(RuntimeError):
+            loss.backward()
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,132 @@
+"""The autotuner's on-disk cache, through CPU matmul.
+
+Each run is a fresh process pointed at its own cache file with
+XFT_AUTOTUNE_CACHE, as separate jobs sharing a cache would be. A run that
+tunes appends a line to the file; one that finds a usable winner leaves
+the file alone, which is how the tests tell the two apart.
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+# [128, 256] @ [256, 128]: just past the size below which matmul runs its
+# default blocking untimed.
+M, K, N = 128, 256, 128
+BLOCKINGS = ["64x128x256", "32x256x128", "64x64x512", "128x128x128", "16x128x1024"]
+
+RUN = """
+import unittest
+import xft
+from util import assert_close, randt
+a, b = randt({m}, {k}, seed=1), randt({k}, {n}, seed=2)
+got = xft.matmul(a, b)
+xft.autotune.set_enabled(False)  # the float64 reference would tune too
+ref = xft.matmul(a.to(xft.float64), b.to(xft.float64))
+assert_close(unittest.TestCase(), got, ref, 1e-5, 1e-5)
+print("cpu-%s-t%d/bmm/float32/1x{m}x{n}x{k}" % (xft.cpu_capability(), xft.get_num_threads()))
+""".format(m=M, k=K, n=N)
+
+
+class AutotuneCacheTest(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.mkdtemp()
+        self.path = os.path.join(self.dir, "autotune.txt")
+
+    def tearDown(self):
+        shutil.rmtree(self.dir)
+
+    def run_matmul(self, path=None):
+        """Runs and checks one matmul in a new process; returns its key."""
+        env = dict(os.environ, XFT_AUTOTUNE_CACHE=path or self.path)
+        env.pop("XFT_AUTOTUNE", None)
+        got = subprocess.run([sys.executable, "-c", RUN], env=env, capture_output=True,
+                             text=True)
+        self.assertEqual(got.returncode, 0, got.stderr)
+        return got.stdout.strip()
+
+    def lines(self):
+        with open(self.path, errors="replace") as f:
+            return f.read().splitlines()
+
+    def write(self, *lines):
+        with open(self.path, "w") as f:
+            f.write("".join(line + "\n" for line in lines))
+
+    def test_write_then_reload(self):
+        key = self.run_matmul()
+        lines = self.lines()
+        self.assertEqual(len(lines), 1)
+        got_key, winner = lines[0].split(" ")
+        self.assertEqual(got_key, key)
+        self.assertIn(winner, BLOCKINGS)
+        # A fresh process takes the winner from the file instead of tuning.
+        self.run_matmul()
+        self.assertEqual(self.lines(), lines)
+
+    def test_reload_uses_any_listed_winner(self):
+        # Not necessarily the fastest: whatever the file says is used.
+        key = self.run_matmul(os.path.join(self.dir, "probe.txt"))
+        self.write(key + " 16x128x1024")
+        self.run_matmul()
+        self.assertEqual(self.lines(), [key + " 16x128x1024"])
+
+    def test_later_lines_take_precedence(self):
+        key = self.run_matmul(os.path.join(self.dir, "probe.txt"))
+        self.write(key + " not-a-blocking", key + " 64x64x512")
+        self.run_matmul()
+        self.assertEqual(len(self.lines()), 2)
+
+    def test_stale_winner_is_retuned(self):
+        # A winner no longer among the candidates (an older release's, say)
+        # is timed again and the new winner appended after it.
+        key = self.run_matmul(os.path.join(self.dir, "probe.txt"))
+        self.write(key + " 999x999x999")
+        self.run_matmul()
+        lines = self.lines()
+        self.assertEqual(len(lines), 2)
+        new_key, winner = lines[1].split(" ")
+        self.assertEqual(new_key, key)
+        self.assertIn(winner, BLOCKINGS)
+
+    def test_corrupt_file_is_ignored(self):
+        with open(self.path, "wb") as f:
+            f.write(b"\x00\xff\xfe garbage\nno-space-here\n winner-without-key\nkey-only \n\n")
+        key = self.run_matmul()
+        last_key, winner = self.lines()[-1].split(" ")
+        self.assertEqual(last_key, key)
+        self.assertIn(winner, BLOCKINGS)
+
+    def test_truncated_last_line(self):
+        # A writer that died mid-line: the next winner still goes on a line
+        # of its own, so the run after that finds it.
+        key = self.run_matmul(os.path.join(self.dir, "probe.txt"))
+        with open(self.path, "w") as f:
+            f.write(key[:10])
+        self.run_matmul()
+        lines = self.lines()
+        self.assertEqual(lines[0], key[:10])
+        self.assertEqual(len(lines), 2)
+        self.run_matmul()
+        self.assertEqual(self.lines(), lines)
+
+    def test_unwritable_cache(self):
+        # A directory where the file should be: nothing is stored, and the
+        # op still runs.
+        os.mkdir(self.path)
+        self.run_matmul()
+        self.run_matmul(os.path.join(self.path, "sub", "autotune.txt"))
+
+    def test_disabled_writes_nothing(self):
+        env = dict(os.environ, XFT_AUTOTUNE_CACHE=self.path, XFT_AUTOTUNE="0")
+        got = subprocess.run([sys.executable, "-c", RUN], env=env, capture_output=True,
+                             text=True)
+        self.assertEqual(got.returncode, 0, got.stderr)
+        self.assertFalse(os.path.exists(self.path))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,70 @@
+"""TensorIterator: broadcasting, strided operands and output checks for the
+elementwise ops.
+
+Run once per kernel table, like test_kernels: a broadcast operand reaches
+the SIMD kernels as a step-0 input.
+"""
+
+import unittest
+
+import xft
+from util import assert_close, make, pin_cpu_capability, randlist, randt
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class BroadcastTest(unittest.TestCase):
+    def test_broadcast(self):
+        # [m, n] with [n] (step 0 across rows), [m, 1] (step 0 across
+        # columns) and a 0-d operand.
+        for m, n in ((3, 17), (5, 8), (2, 33)):
+            a = randlist(m * n, seed=m)
+            row = randlist(n, seed=n)
+            col = randlist(m, seed=m + n)
+            ta = make(a, [m, n])
+            assert_close(self, ta + make(row, [n]),
+                         [a[i * n + j] + row[j] for i in range(m) for j in range(n)])
+            assert_close(self, ta * make(col, [m, 1]),
+                         [a[i * n + j] * col[i] for i in range(m) for j in range(n)])
+            assert_close(self, ta - make([0.25], []), [v - 0.25 for v in a])
+            assert_close(self, make(col, [m, 1]) / make(row, [1, n]),
+                         [col[i] / row[j] for i in range(m) for j in range(n)])
+
+    def test_transposed_operands(self):
+        a = randlist(6 * 7, seed=1)
+        b = randlist(7 * 6, seed=2)
+        ta = make(a, [6, 7]).T
+        tb = make(b, [7, 6])
+        want = [a[j * 7 + i] * b[i * 6 + j] for i in range(7) for j in range(6)]
+        assert_close(self, ta * tb, want)
+
+    def test_rank_extension(self):
+        # [3, 1, 5] with [4, 1]: the shorter shape is aligned on the right.
+        a = randlist(3 * 5, seed=1)
+        b = randlist(4, seed=2)
+        got = make(a, [3, 1, 5]) + make(b, [4, 1])
+        self.assertEqual(got.shape, (3, 4, 5))
+        self.assertEqual(got.stride(), (20, 5, 1))
+        assert_close(self, got, [a[i * 5 + k] + b[j] for i in range(3) for j in range(4)
+                                 for k in range(5)])
+
+    def test_expanded_operand(self):
+        # A stride-0 view as an input, on either side.
+        row = randlist(5, seed=3)
+        e = make(row, [1, 5]).expand(3, 5)
+        self.assertEqual(e.stride(), (0, 1))
+        x = randlist(15, seed=4)
+        assert_close(self, e * make(x, [3, 5]), [row[i % 5] * x[i] for i in range(15)])
+        assert_close(self, make(x, [3, 5]) - e, [x[i] - row[i % 5] for i in range(15)])
+
+    def test_shape_errors(self):
+        with self.assertRaisesRegex(RuntimeError, "cannot be broadcast"):
+            randt(2, 3) + randt(4)
+        with self.assertRaisesRegex(RuntimeError, "output shape"):
+            xft.add(randt(2, 3), randt(3), out=xft.empty(3))
+
+
+if __name__ == "__main__":
+    unittest.main()
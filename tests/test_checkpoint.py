@@ -0,0 +1,103 @@
+"""Checkpoints: save/load round-trips and the errors for bad files."""
+
+import os
+import shutil
+import struct
+import tempfile
+import unittest
+
+import xft
+from util import flat, make, randt
+
+
+class CheckpointTest(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.dir)
+
+    def path(self, name):
+        return os.path.join(self.dir, name)
+
+    def test_round_trip(self):
+        tensors = {
+            "w": randt(7, 9, seed=1),
+            "b": randt(9, seed=2, dtype=xft.float64),
+            "h": randt(3, 5, seed=3, dtype=xft.float16),
+            "bf": randt(4, seed=4, dtype=xft.bfloat16),
+            "i": make([1, -2, 3], [3], xft.int64),
+            "u": make([0, 255, 7], [3], xft.uint8),
+            "q": make([-128, 0, 127], [3], xft.int8),
+            "scalar": make([2.5], []),
+            "empty": xft.empty(0, 4),
+        }
+        p = self.path("a.xft")
+        xft.save(tensors, p)
+        back = xft.load(p)
+        self.assertEqual(list(back), list(tensors))
+        for name, t in tensors.items():
+            self.assertEqual(back[name].dtype, t.dtype, name)
+            self.assertEqual(back[name].shape, t.shape, name)
+            self.assertEqual(flat(back[name]), flat(t), name)
+
+    def test_strided_tensors_are_saved_by_value(self):
+        t = randt(4, 6, seed=5)
+        p = self.path("b.xft")
+        xft.save({"t": t.T, "s": t[:, 1::2]}, p)
+        back = xft.load(p)
+        self.assertEqual(flat(back["t"]), flat(t.T))
+        self.assertEqual(flat(back["s"]), flat(t[:, 1::2]))
+        self.assertTrue(back["t"].is_contiguous())
+
+    def test_loaded_tensors_are_private(self):
+        p = self.path("c.xft")
+        xft.save({"x": make([1.0, 2.0], [2])}, p)
+        a = xft.load(p)["x"]
+        a.fill_(9.0)
+        self.assertEqual(flat(xft.load(p)["x"]), [1.0, 2.0])
+
+    def test_overwrite_and_errors(self):
+        p = self.path("d.xft")
+        xft.save({"x": make([1.0], [1])}, p)
+        xft.save([("y", make([2.0], [1]))], p)
+        self.assertEqual(list(xft.load(p)), ["y"])
+        with self.assertRaises(RuntimeError):
+            xft.load(self.path("missing.xft"))
+        with open(self.path("bad.xft"), "wb") as f:
+            f.write(b"not a checkpoint")
+        with self.assertRaises(RuntimeError):
+            xft.load(self.path("bad.xft"))
+        with self.assertRaises(TypeError):
+            xft.save({"x": 1.0}, p)
+
+    def test_corrupt_header(self):
+        # The preamble is the magic and the index size; the index starts
+        # with the entry count.
+        p = self.path("c.xft")
+        xft.save({"a": randt(3, 4, seed=1), "bb": randt(5, seed=2)}, p)
+        with open(p, "rb") as f:
+            good = f.read()
+        (index_bytes,) = struct.unpack_from("<Q", good, 8)
+
+        def load_with(offset, fmt, value):
+            bad = bytearray(good)
+            struct.pack_into(fmt, bad, offset, value)
+            with open(self.path("bad.xft"), "wb") as f:
+                f.write(bad)
+            xft.load(self.path("bad.xft"))
+
+        # Counts no index of this size can hold are rejected before any
+        # entry is allocated, however large.
+        for count in (2 ** 63, 2 ** 40, index_bytes, (index_bytes - 8) // 28 + 1):
+            with self.assertRaisesRegex(RuntimeError, "corrupt index"):
+                load_with(16, "<Q", count)
+        for size in (len(good), 2 ** 64 - 1):
+            with self.assertRaisesRegex(RuntimeError, "truncated index"):
+                load_with(8, "<Q", size)
+        with self.assertRaisesRegex(RuntimeError, "truncated index"):
+            load_with(24, "<I", 2 ** 31)  # the first name's length
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,85 @@
+"""Channels-last tensors and the implicit-GEMM conv2d against a direct
+convolution.
+
+Run once per kernel table, like test_kernels. Every case runs with the
+input in both memory formats.
+"""
+
+import unittest
+
+import xft
+from util import assert_close, flat, make, pin_cpu_capability, randlist
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class ChannelsLastTest(unittest.TestCase):
+    def test_layout(self):
+        t = make([float(i) for i in range(120)], [2, 3, 4, 5])
+        cl = t.contiguous(xft.channels_last)
+        self.assertEqual(cl.shape, (2, 3, 4, 5))
+        self.assertEqual(cl.stride(), (60, 1, 15, 3))
+        self.assertTrue(cl.is_contiguous(xft.channels_last))
+        self.assertFalse(cl.is_contiguous())
+        self.assertEqual(flat(cl), flat(t))
+        # Elementwise results keep the layout of their operand.
+        out = cl + 1.0
+        self.assertTrue(out.is_contiguous(xft.channels_last))
+        self.assertEqual(flat(out), [v + 1.0 for v in flat(t)])
+
+
+class ConvTest(unittest.TestCase):
+    def ref_conv(self, x, w, b, N, C, H, W, K, R, S, stride, pad, dil, groups):
+        OH = (H + 2 * pad - dil * (R - 1) - 1) // stride + 1
+        OW = (W + 2 * pad - dil * (S - 1) - 1) // stride + 1
+        Cg, Kg = C // groups, K // groups
+        out = []
+        for n in range(N):
+            for k in range(K):
+                g = k // Kg
+                for oh in range(OH):
+                    for ow in range(OW):
+                        acc = b[k] if b is not None else 0.0
+                        for c in range(Cg):
+                            for r in range(R):
+                                ih = oh * stride - pad + r * dil
+                                if not 0 <= ih < H:
+                                    continue
+                                for s in range(S):
+                                    iw = ow * stride - pad + s * dil
+                                    if 0 <= iw < W:
+                                        acc += (x[((n * C + g * Cg + c) * H + ih) * W + iw] *
+                                                w[((k * Cg + c) * R + r) * S + s])
+                        out.append(acc)
+        return out, [N, K, OH, OW]
+
+    def test_against_reference(self):
+        cases = [
+            # N, C, H, W, K, R, S, stride, pad, dil, groups
+            (1, 3, 7, 7, 4, 3, 3, 1, 1, 1, 1),
+            (2, 4, 8, 6, 6, 3, 3, 2, 1, 1, 2),
+            (1, 2, 9, 9, 3, 1, 1, 1, 0, 1, 1),
+            (1, 5, 10, 10, 8, 3, 3, 1, 2, 2, 1),
+            (1, 8, 5, 5, 8, 3, 3, 1, 1, 1, 8),
+            (1, 17, 6, 6, 33, 2, 2, 1, 0, 1, 1),
+        ]
+        for N, C, H, W, K, R, S, stride, pad, dil, groups in cases:
+            x = randlist(N * C * H * W, seed=C)
+            w = randlist(K * (C // groups) * R * S, seed=K)
+            b = randlist(K, seed=R)
+            want, shape = self.ref_conv(x, w, b, N, C, H, W, K, R, S, stride, pad, dil, groups)
+            for fmt in (xft.contiguous_format, xft.channels_last):
+                tx = make(x, [N, C, H, W]).contiguous(fmt)
+                got = xft.nn.functional.conv2d(tx, make(w, [K, C // groups, R, S]),
+                                               make(b, [K]), stride, pad, dil, groups)
+                self.assertEqual(list(got.shape), shape)
+                self.assertTrue(got.is_contiguous(fmt))
+                assert_close(self, got, want, 1e-5, 1e-5,
+                             "case %s %s" % ((N, C, H, W, K, R, S, stride, pad, dil, groups),
+                                             fmt))
+
+
+if __name__ == "__main__":
+    unittest.main()
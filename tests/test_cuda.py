@@ -0,0 +1,253 @@
+"""CUDA kernels against the CPU kernels on the same inputs.
+
+Every case builds its inputs on the CPU, runs the op there and on the
+device, and compares the results; the CPU kernels are themselves checked
+against scalar references by the CPU suites. The whole suite is skipped
+when the build or host has no CUDA device.
+"""
+
+import math
+import unittest
+
+import xft
+from util import TOL, assert_close, flat, make, numel, randlist, require_cuda, round_to
+
+FLOATS = [xft.float32, xft.float64, xft.float16, xft.bfloat16]
+
+
+def setUpModule():
+    require_cuda()
+
+
+def cuda(t):
+    return t.to("cuda")
+
+
+class ReduceTest(unittest.TestCase):
+    # Rows (inner == 1), columns, and shapes big enough to be tuned and to
+    # split r across blocks.
+    SHAPES = [[1], [31], [1000], [4, 9], [3, 33, 5], [2, 300, 17], [64, 129], [1 << 20],
+              [8, 1 << 17], [1 << 12, 300]]
+
+    def check(self, t, dim, rtol, atol, tag):
+        n = numel(t.shape)
+        count = n if dim is None else t.shape[dim]
+        tol = (rtol * 4, atol * math.sqrt(count) * 4)
+        # mean takes floating inputs only.
+        names = ("sum", "mean", "amax") if t.dtype.is_floating_point else ("sum", "amax")
+        for name in names:
+            op = getattr(xft, name)
+            want, got = op(t, dim), op(cuda(t), dim)
+            self.assertTrue(got.is_cuda, name + " " + tag)
+            self.assertEqual(got.dtype, want.dtype, name + " " + tag)
+            self.assertEqual(got.shape, want.shape, name + " " + tag)
+            if name == "amax" or not t.dtype.is_floating_point:
+                self.assertEqual(flat(got.cpu()), flat(want), name + " " + tag)
+            else:
+                assert_close(self, got.cpu(), want, *tol, msg=name + " " + tag)
+
+    def test_floats(self):
+        for dtype in FLOATS:
+            rtol, atol = TOL[dtype]
+            for shape in self.SHAPES:
+                x = round_to(dtype, randlist(numel(shape), seed=len(shape)))
+                t = make(x, shape, dtype)
+                for dim in [None] + list(range(len(shape))):
+                    self.check(t, dim, rtol, atol, "%s %s dim=%s" % (dtype, shape, dim))
+
+    def test_integers(self):
+        for dtype in (xft.int32, xft.int64, xft.uint8, xft.bool_):
+            hi = 2 if dtype == xft.bool_ else 100
+            for shape in ([300], [7, 129], [1 << 20]):
+                x = [int(v) for v in randlist(numel(shape), 0, hi, seed=5)]
+                t = make(x, shape, dtype)
+                for dim in [None] + list(range(len(shape))):
+                    self.check(t, dim, 0.0, 0.0, "%s %s dim=%s" % (dtype, shape, dim))
+
+    def test_nan_propagates_through_max(self):
+        x = randlist(5000, seed=3)
+        x[4321] = math.nan
+        self.assertTrue(math.isnan(xft.amax(cuda(make(x, [5000]))).cpu().item()))
+
+    def test_strided_and_keepdim(self):
+        t = make(randlist(64 * 48, seed=4), [64, 48])
+        got = xft.sum(cuda(t).T, 1, keepdim=True)
+        self.assertEqual(got.shape, (48, 1))
+        assert_close(self, got.cpu(), xft.sum(t.T, 1, keepdim=True), 1e-5, 1e-4)
+
+    def test_empty(self):
+        t = cuda(xft.zeros(3, 0))
+        self.assertEqual(flat(xft.sum(t, 1).cpu()), [0.0, 0.0, 0.0])
+        with self.assertRaises(RuntimeError):
+            xft.amax(t, 1)
+
+
+class QuantizedTest(unittest.TestCase):
+    # N = 13 leaves a partly used block of output columns.
+    N, K = 13, 256
+
+    def weight(self, bits, group_size):
+        w = make(randlist(self.N * self.K, seed=bits), [self.N, self.K])
+        return w, xft.quantization.quantize_weight(w, bits=bits, group_size=group_size)
+
+    def test_quantize_and_dequantize(self):
+        for bits in (8, 4):
+            w, qw = self.weight(bits, 32)
+            on_device = xft.quantization.quantize_weight(cuda(w), bits=bits, group_size=32)
+            self.assertEqual(flat(on_device.data.cpu()), flat(qw.data), "bits=%d" % bits)
+            self.assertEqual(flat(on_device.scales.cpu()), flat(qw.scales), "bits=%d" % bits)
+            self.assertEqual(flat(qw.to("cuda").dequantize().cpu()), flat(qw.dequantize()),
+                             "bits=%d" % bits)
+
+    def test_linear_matches_cpu(self):
+        # Both sides quantize x to the same int8 values, so dynamic results
+        # differ only in the order of the float32 sums. M = 40 takes the
+        # dequantize-then-matmul path for weight-only layers.
+        for bits in (8, 4):
+            for group_size in (32, 0):
+                _, qw = self.weight(bits, group_size)
+                for dynamic in (False, True):
+                    qw.dynamic = dynamic
+                    qd = qw.to("cuda")
+                    for dtype in FLOATS:
+                        rtol, atol = TOL[dtype]
+                        b = make(round_to(dtype, randlist(self.N, seed=2)), [self.N], dtype)
+                        for m in (1, 5, 40):
+                            x = make(round_to(dtype, randlist(m * self.K, seed=m)),
+                                     [m, self.K], dtype)
+                            tag = "bits=%d group=%d dynamic=%s %s M=%d" % (
+                                bits, group_size, dynamic, dtype, m)
+                            with xft.inference_mode():
+                                want = qw.linear(x, b)
+                                got = qd.linear(cuda(x), cuda(b))
+                            self.assertEqual(got.dtype, dtype, tag)
+                            assert_close(self, got.cpu(), want, rtol * 4,
+                                         max(atol, 1e-4) * math.sqrt(self.K), tag)
+
+    def test_unsupported_k(self):
+        # The CUDA kernels decode 8 (int8) or 16 (int4) weights per step.
+        w = make(randlist(4 * 24, seed=1), [4, 24])
+        qw = xft.quantization.quantize_weight(w, bits=4, group_size=0).to("cuda")
+        with self.assertRaises(RuntimeError):
+            with xft.inference_mode():
+                qw.linear(cuda(make(randlist(24, seed=2), [1, 24])))
+
+
+class ConvTest(unittest.TestCase):
+    CASES = [
+        # N, C, H, W, K, R, S, stride, pad, dil, groups
+        (1, 3, 7, 7, 4, 3, 3, 1, 1, 1, 1),
+        (2, 4, 8, 6, 6, 3, 3, 2, 1, 1, 2),
+        (1, 5, 10, 10, 8, 3, 3, 1, 2, 2, 1),
+        (1, 8, 5, 5, 8, 3, 3, 1, 1, 1, 8),
+        (1, 17, 6, 6, 33, 2, 2, 1, 0, 1, 1),
+        # Big enough to be tuned and to split the weight gradient's pixel sum
+        # across blocks; fills whole WMMA tiles for 16-bit dtypes.
+        (2, 64, 32, 32, 64, 3, 3, 1, 1, 1, 1),
+    ]
+
+    def run_conv(self, device, x, w, b, gy, case, dtype, fmt):
+        N, C, H, W, K, R, S, stride, pad, dil, groups = case
+        tx = make(x, [N, C, H, W], dtype).to(device).contiguous(fmt).requires_grad_()
+        tw = make(w, [K, C // groups, R, S], dtype).to(device).requires_grad_()
+        tb = make(b, [K], dtype).to(device).requires_grad_()
+        y = xft.nn.functional.conv2d(tx, tw, tb, stride, pad, dil, groups)
+        self.assertTrue(y.is_contiguous(fmt))
+        y.backward(make(gy, list(y.shape), dtype).to(device))
+        return [t.cpu() for t in (y, tx.grad, tw.grad, tb.grad)]
+
+    def test_forward_and_backward_match_cpu(self):
+        for case in self.CASES:
+            N, C, H, W, K, R, S, stride, pad, dil, groups = case
+            OH = (H + 2 * pad - dil * (R - 1) - 1) // stride + 1
+            OW = (W + 2 * pad - dil * (S - 1) - 1) // stride + 1
+            # The longest sum behind any output: a tap window, or every
+            # output pixel for the weight and bias grads.
+            depth = max(C // groups * R * S, K // groups * R * S, N * OH * OW)
+            for dtype in FLOATS:
+                rtol, atol = TOL[dtype]
+                x = round_to(dtype, randlist(N * C * H * W, seed=C))
+                w = round_to(dtype, randlist(K * (C // groups) * R * S, seed=K))
+                b = round_to(dtype, randlist(K, seed=R))
+                gy = round_to(dtype, randlist(N * K * OH * OW, seed=3))
+                for fmt in (xft.contiguous_format, xft.channels_last):
+                    want = self.run_conv("cpu", x, w, b, gy, case, dtype, fmt)
+                    got = self.run_conv("cuda", x, w, b, gy, case, dtype, fmt)
+                    for name, g, e in zip(("y", "dx", "dw", "db"), got, want):
+                        assert_close(self, g, e, rtol * 4, atol * 4 * math.sqrt(depth),
+                                     "%s %s %s %s" % (name, case, dtype, fmt))
+
+
+class PagedAttentionTest(unittest.TestCase):
+    # Partly filled last blocks, one full one and an empty sequence; 8
+    # query heads on 2 kv heads.
+    LENS = [37, 3, 16, 0]
+    HQ, HKV = 8, 2
+
+    def fill(self, device, dtype, block, D):
+        """A cache holding LENS tokens, stored in two rounds so that the
+        sequences' blocks interleave; also returns each one's k and v."""
+        num_blocks = sum(-(-n // block) for n in self.LENS) + 2
+        cache = xft.kv_cache.PagedKVCache(1, num_blocks=num_blocks, block_size=block,
+                                          num_heads=self.HKV, head_dim=D, dtype=dtype,
+                                          device=device)
+        seqs = [cache.add_sequence() for _ in self.LENS]
+        keys, values = [], []
+        for s, n in zip(seqs, self.LENS):
+            keys.append(make(round_to(dtype, randlist(n * self.HKV * D, seed=10 + n)),
+                             [n, self.HKV, D], dtype))
+            values.append(make(round_to(dtype, randlist(n * self.HKV * D, seed=20 + n)),
+                               [n, self.HKV, D], dtype))
+        for lo, hi in ((0, 0.5), (0.5, 1)):
+            for s, n, k, v in zip(seqs, self.LENS, keys, values):
+                a, b = int(n * lo), int(n * hi)
+                if b > a:
+                    cache.store(0, cache.append_slots([s], [b - a]), k[a:b].to(device),
+                                v[a:b].to(device))
+        return cache, seqs, keys, values
+
+    def stored(self, cache, seqs, block):
+        """Each sequence's k and v rows, token by token, read back through
+        its block table."""
+        tables = cache.block_tables(seqs).cpu().tolist()
+        kc, vc = cache.key_cache(0).cpu(), cache.value_cache(0).cpu()
+        rows = []
+        for table, n in zip(tables, self.LENS):
+            for t in range(n):
+                blk, slot = table[t // block], t % block
+                rows += flat(kc[blk, :, slot]) + flat(vc[blk, :, slot])
+        return rows
+
+    def test_against_contiguous_attention(self):
+        for dtype in FLOATS:
+            rtol, atol = TOL[dtype]
+            # float64 runs head dims up to 64 on CUDA.
+            for D in (8, 64) if dtype == xft.float64 else (8, 64, 128):
+                for block in (4, 16):
+                    tag = "%s D=%d block=%d" % (dtype, D, block)
+                    cache, seqs, keys, values = self.fill("cuda", dtype, block, D)
+                    self.assertEqual(self.stored(cache, seqs, block),
+                                     flat([[flat(k[t]) + flat(v[t]) for t in range(n)]
+                                           for k, v, n in zip(keys, values, self.LENS)]),
+                                     "cache " + tag)
+                    q = make(round_to(dtype, randlist(len(seqs) * self.HQ * D, seed=5)),
+                             [len(seqs), self.HQ, D], dtype)
+                    with xft.inference_mode():
+                        got = xft.nn.functional.paged_attention(
+                            cuda(q), cache.key_cache(0), cache.value_cache(0),
+                            cache.block_tables(seqs), cache.context_lens(seqs)).cpu()
+                    for b, n in enumerate(self.LENS):
+                        if n == 0:
+                            self.assertEqual(flat(got[b]), [0.0] * (self.HQ * D), tag)
+                            continue
+                        for h in range(self.HQ):
+                            kv = h // (self.HQ // self.HKV)
+                            want = xft.nn.functional.scaled_dot_product_attention(
+                                q[b, h].view(1, 1, D), keys[b][:, kv].contiguous().view(1, n, D),
+                                values[b][:, kv].contiguous().view(1, n, D))
+                            assert_close(self, got[b, h], want, rtol * 4, atol * 4,
+                                         "seq %d head %d %s" % (b, h, tag))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,114 @@
+"""The DataLoader: worker processes against in-process loading, worker
+errors, and the shared-memory segments batches travel in.
+
+Segments are named /xft_<pid>_<n> and appear under /dev/shm while they
+exist; every test checks that none it created are left behind.
+"""
+
+import os
+import unittest
+
+import xft
+from util import flat, randt
+
+SHM = "/dev/shm"
+
+
+def segments():
+    return {n for n in os.listdir(SHM) if n.startswith("xft_")}
+
+
+class Squares(xft.data.Dataset):
+    """Samples mixing a tensor, an int and a dict of floats."""
+
+    def __getitem__(self, i):
+        return xft.full([3], float(i)), i * i, {"half": i / 2}
+
+    def __len__(self):
+        return 11
+
+
+class Failing(Squares):
+    def __getitem__(self, i):
+        if i == 5:
+            raise ValueError("bad sample 5")
+        return super().__getitem__(i)
+
+
+def strided_collate(samples):
+    # Not contiguous and not in shared memory: workers copy it over.
+    out = xft.zeros([len(samples), 3])
+    for i, s in enumerate(samples):
+        out.select(0, i).copy_(s[0])
+    return out.transpose(0, 1)
+
+
+@unittest.skipUnless(os.path.isdir(SHM), "needs /dev/shm")
+class DataLoaderTest(unittest.TestCase):
+    def setUp(self):
+        self.before = segments()
+
+    def tearDown(self):
+        self.assertEqual(segments() - self.before, set())
+
+    def batches(self, loader):
+        return [[flat(t) if isinstance(t, xft.Tensor) else {k: flat(v) for k, v in t.items()}
+                 for t in b] for b in loader]
+
+    def test_workers_match_in_process(self):
+        for batch_size, drop_last in ((4, False), (4, True), (1, False)):
+            want = self.batches(xft.data.DataLoader(Squares(), batch_size, drop_last=drop_last))
+            for workers in (1, 3):
+                loader = xft.data.DataLoader(Squares(), batch_size, num_workers=workers,
+                                             prefetch_factor=1, drop_last=drop_last)
+                self.assertEqual(len(loader), len(want))
+                got = self.batches(loader)
+                self.assertEqual(got, want, "workers=%d batch_size=%d" % (workers, batch_size))
+        x, y = self.batches(xft.data.DataLoader(Squares(), 4))[0][:2]
+        self.assertEqual(x, [float(i) for i in range(4) for _ in range(3)])
+        self.assertEqual(y, [0, 1, 4, 9])
+
+    def test_tensor_dataset_shuffled(self):
+        data = randt(20, 2, seed=1)
+        loader = xft.data.DataLoader(xft.data.TensorDataset(data), 6, shuffle=True,
+                                     num_workers=2)
+        rows = sorted(tuple(r) for (b,) in loader for r in b.tolist())
+        self.assertEqual(rows, sorted(tuple(r) for r in data.tolist()))
+
+    def test_custom_collate(self):
+        loader = xft.data.DataLoader(Squares(), 4, num_workers=2, collate_fn=strided_collate)
+        got = [b.tolist() for b in loader]
+        self.assertEqual(got[0], [[0.0, 1.0, 2.0, 3.0]] * 3)
+        self.assertEqual(got[-1], [[8.0, 9.0, 10.0]] * 3)
+
+    def test_worker_error(self):
+        loader = xft.data.DataLoader(Failing(), 2, num_workers=2)
+        with self.assertRaisesRegex(RuntimeError, "(?s)worker 0 raised.*bad sample 5"):
+            list(loader)
+
+    def test_early_exit_frees_prefetched_batches(self):
+        # Batches the workers already wrote but nobody opened are unlinked
+        # at shutdown.
+        it = iter(xft.data.DataLoader(Squares(), 2, num_workers=2, prefetch_factor=2))
+        next(it)
+        it.shutdown()
+
+    def test_shared_round_trip(self):
+        # What a worker puts on the queue, opened as the main process does:
+        # the same pages, and the name is gone once they are mapped.
+        t = xft.data.empty_shared(2, 3)
+        name = xft.data.shared_name(t)
+        self.assertIn(name.lstrip("/"), segments())
+        self.assertIsNone(xft.data.shared_name(xft.zeros(2)))
+        ref = xft.data._to_ref(t)
+        self.assertEqual(ref.name, name)
+        t.fill_(2.5)
+        got = ref.open()
+        self.assertNotIn(name.lstrip("/"), segments())
+        self.assertEqual(flat(got), [2.5] * 6)
+        got.fill_(-1.0)
+        self.assertEqual(flat(t), [-1.0] * 6)
+
+
+if __name__ == "__main__":
+    unittest.main()
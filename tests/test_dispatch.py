@@ -0,0 +1,99 @@
+"""The (op, device, dtype) kernel table behind the elementwise ops: every
+registered CPU combination computes the right values, and a combination
+with no kernel fails with an error naming the op, dtype and device, eagerly
+and in lazy mode alike."""
+
+import math
+import unittest
+
+import xft
+from util import assert_close, flat, pin_cpu_capability, round_to
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+A = [7, 9, 0, 3, 12, 1]
+B = [2, 4, 3, 3, 5, 1]
+
+BINARY = {
+    "add": (xft.add, lambda x, y: x + y),
+    "sub": (xft.sub, lambda x, y: x - y),
+    "mul": (xft.mul, lambda x, y: x * y),
+    "maximum": (xft.maximum, max),
+    "minimum": (xft.minimum, min),
+}
+
+UNARY = {
+    "exp": (xft.exp, math.exp),
+    "log": (xft.log, math.log),
+    "sqrt": (xft.sqrt, math.sqrt),
+    "tanh": (xft.tanh, math.tanh),
+    "sigmoid": (xft.sigmoid, lambda x: 1 / (1 + math.exp(-x))),
+    "relu": (xft.relu, lambda x: max(x, 0.0)),
+}
+
+INTEGER = {xft.int32: None, xft.int64: None, xft.uint8: 256}
+FLOATING = {xft.float32: 1e-6, xft.float64: 1e-12, xft.float16: 1e-3, xft.bfloat16: 1e-2}
+
+
+def wrap(values, dtype):
+    mod = INTEGER.get(dtype)
+    return [v % mod for v in values] if mod else values
+
+
+class DispatchTableTest(unittest.TestCase):
+    def test_binary_ops_every_numeric_dtype(self):
+        for dtype in list(INTEGER) + list(FLOATING):
+            a, b = xft.tensor(A, dtype=dtype), xft.tensor(B, dtype=dtype)
+            for name, (op, ref) in BINARY.items():
+                got = op(a, b)
+                self.assertEqual(got.dtype, dtype)
+                self.assertEqual(flat(got), wrap([ref(x, y) for x, y in zip(A, B)], dtype),
+                                 "%s %s" % (name, dtype))
+            div = flat(xft.div(a, b))
+            if dtype in INTEGER:
+                self.assertEqual(div, [int(x / y) for x, y in zip(A, B)], dtype)
+            else:
+                want = round_to(dtype, [x / y for x, y in zip(A, B)])
+                assert_close(self, div, want, FLOATING[dtype], 0, "div %s" % dtype)
+
+    def test_unary_ops_every_floating_dtype(self):
+        x = [0.25, 0.5, 1.0, 2.0, 3.5]
+        for dtype, tol in FLOATING.items():
+            t = xft.tensor(x, dtype=dtype)
+            for name, (op, ref) in UNARY.items():
+                got = op(t)
+                self.assertEqual(got.dtype, dtype)
+                assert_close(self, got, [ref(v) for v in round_to(dtype, x)], 4 * tol, 4 * tol,
+                             "%s %s" % (name, dtype))
+
+    def test_missing_kernel(self):
+        # int8 is a storage type for quantized weights: no elementwise
+        # kernel is registered for it.
+        a = xft.tensor([1, 2], dtype=xft.int8)
+        for name, (op, _) in list(BINARY.items()) + [("div", (xft.div, None))]:
+            with self.assertRaisesRegex(RuntimeError, "^%s: no kernel for int8 tensors on cpu"
+                                        % name):
+                op(a, a)
+        with self.assertRaisesRegex(RuntimeError, "^mul: no kernel for int8 tensors on cpu"):
+            a * 2
+
+    def test_missing_kernel_in_lazy_mode(self):
+        # Caught when the op is recorded, not later when the chain runs.
+        a = xft.tensor([1, 2], dtype=xft.int8)
+        with xft.lazy_mode():
+            with self.assertRaisesRegex(RuntimeError, "^add: no kernel for int8 tensors on cpu"):
+                xft.add(a, a)
+
+    def test_dtypes_rejected_before_lookup(self):
+        # Floating-only ops and bool operands fail on the dtype itself.
+        with self.assertRaisesRegex(RuntimeError, "exp: expected a floating dtype, got int32"):
+            xft.exp(xft.tensor([1, 2], dtype=xft.int32))
+        with self.assertRaisesRegex(RuntimeError, "add: unsupported dtype bool"):
+            xft.add(xft.tensor([True]), xft.tensor([False]))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,52 @@
+"""DistributedDataParallel end to end: ddp_train.py on up to two GPUs.
+
+Each rank is its own process, as in a real job, rendezvousing on a free
+local port. Skipped without a CUDA device or an XFT_USE_NCCL build.
+"""
+
+import os
+import socket
+import subprocess
+import sys
+import unittest
+
+import xft
+from util import require_cuda
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+class DDPTest(unittest.TestCase):
+    def setUp(self):
+        require_cuda()
+        if not xft.distributed.is_available():
+            raise unittest.SkipTest("built without NCCL")
+
+    def test_training_run(self):
+        world = min(2, xft.cuda.device_count())
+        env = dict(os.environ, WORLD_SIZE=str(world), MASTER_ADDR="127.0.0.1",
+                   MASTER_PORT=str(free_port()))
+        procs = [
+            subprocess.Popen([sys.executable, os.path.join(HERE, "ddp_train.py")],
+                             env=dict(env, RANK=str(r), LOCAL_RANK=str(r)), cwd=HERE,
+                             stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+            for r in range(world)
+        ]
+        for r, p in enumerate(procs):
+            try:
+                out, _ = p.communicate(timeout=300)
+            except subprocess.TimeoutExpired:
+                for q in procs:
+                    q.kill()
+                raise
+            self.assertEqual(p.returncode, 0, "rank %d failed:\n%s" % (r, out))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,47 @@
+"""Dropout against a pure-Python Philox: the mask is a function of the
+generator state alone, which is what lets checkpointing replay it.
+
+Run once per kernel table, like test_kernels.
+"""
+
+import unittest
+
+import xft
+from util import assert_close, flat, make, philox_uniform_f32, pin_cpu_capability, randlist
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class DropoutTest(unittest.TestCase):
+    def test_mask_matches_philox(self):
+        # The mask is a pure function of the generator's (seed, offset):
+        # element i is kept when its Philox uniform is below 1 - p.
+        for n in (1, 5, 64, 257):
+            xft.manual_seed(1234 + n)
+            seed, offset = xft.get_rng_state()
+            x = randlist(n, 0.5, 1.5, seed=n)
+            p = 0.3
+            got = flat(xft.dropout(make(x, [n]), p))
+            keep = 1.0 - p
+            scale = 1.0 / keep
+            want = [v * scale if philox_uniform_f32(seed, offset, i) < keep else 0.0
+                    for i, v in enumerate(x)]
+            assert_close(self, got, want, 1e-6, 0.0, "n=%d" % n)
+
+    def test_set_rng_state_replays(self):
+        x = make(randlist(40, seed=5), [40])
+        state = xft.get_rng_state()
+        first = flat(xft.dropout(x, 0.5))
+        self.assertNotEqual(xft.get_rng_state(), state)
+        xft.set_rng_state(state)
+        self.assertEqual(flat(xft.dropout(x, 0.5)), first)
+
+    def test_eval_is_identity(self):
+        x = randlist(33, seed=4)
+        assert_close(self, xft.dropout(make(x, [33]), 0.5, training=False), x)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,109 @@
+"""The fused softmax, layer/RMS norm and bias epilogue kernels against
+scalar references.
+
+Run once per kernel table, like test_kernels.
+"""
+
+import math
+import unittest
+
+import xft
+from util import (TOL, assert_close, gelu, make, philox_uniform_f32, pin_cpu_capability,
+                  randlist, ref_softmax_rows, round_to)
+
+FLOATS = [xft.float32, xft.float64, xft.float16, xft.bfloat16]
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class SoftmaxTest(unittest.TestCase):
+    def test_last_dim(self):
+        for dtype in FLOATS:
+            rtol, atol = TOL[dtype]
+            for cols in (1, 7, 16, 33, 100):
+                x = round_to(dtype, randlist(3 * cols, -5, 5, seed=cols))
+                got = xft.softmax(make(x, [3, cols], dtype), -1)
+                assert_close(self, got, ref_softmax_rows(x, cols), rtol, atol,
+                             "%s cols=%d" % (dtype, cols))
+
+    def test_inner_dim(self):
+        x = randlist(2 * 5 * 3, -3, 3, seed=4)
+        got = xft.softmax(make(x, [2, 5, 3]), 1)
+        # Move dim 1 last, reference, and move it back.
+        perm = [x[(b * 5 + k) * 3 + i] for b in range(2) for i in range(3) for k in range(5)]
+        ref = ref_softmax_rows(perm, 5)
+        want = [ref[(b * 3 + i) * 5 + k] for b in range(2) for k in range(5) for i in range(3)]
+        assert_close(self, got, want)
+
+    def test_extremes(self):
+        got = xft.softmax(make([1000.0, 0.0, -1000.0, 1000.0], [4]), 0)
+        assert_close(self, got, [0.5, 0.0, 0.0, 0.5])
+
+
+class RowKernelTest(unittest.TestCase):
+    def ref_norm(self, x, cols, w, b, eps, rms):
+        out = []
+        for r in range(len(x) // cols):
+            row = x[r * cols:(r + 1) * cols]
+            mu = 0.0 if rms else sum(row) / cols
+            var = sum((v - mu) ** 2 for v in row) / cols
+            rstd = 1.0 / math.sqrt(var + eps)
+            for j, v in enumerate(row):
+                y = (v - mu) * rstd
+                if w is not None:
+                    y *= w[j]
+                if b is not None:
+                    y += b[j]
+                out.append(y)
+        return out
+
+    def test_layer_norm(self):
+        for dtype in FLOATS:
+            rtol, atol = TOL[dtype]
+            for cols in (1, 8, 17, 64, 130):
+                x = round_to(dtype, randlist(4 * cols, -2, 2, seed=cols))
+                w = round_to(dtype, randlist(cols, 0.5, 1.5, seed=cols + 1))
+                b = round_to(dtype, randlist(cols, seed=cols + 2))
+                got = xft.layer_norm(make(x, [4, cols], dtype), make(w, [cols], dtype),
+                                     make(b, [cols], dtype), eps=1e-5)
+                assert_close(self, got, self.ref_norm(x, cols, w, b, 1e-5, False), rtol * 4,
+                             atol * 4, "layer_norm %s cols=%d" % (dtype, cols))
+                got = xft.rms_norm(make(x, [4, cols], dtype), make(w, [cols], dtype), eps=1e-6)
+                assert_close(self, got, self.ref_norm(x, cols, w, None, 1e-6, True), rtol * 4,
+                             atol * 4, "rms_norm %s cols=%d" % (dtype, cols))
+
+    def test_layer_norm_no_affine(self):
+        x = randlist(3 * 20, seed=1)
+        assert_close(self, xft.layer_norm(make(x, [3, 20])),
+                     self.ref_norm(x, 20, None, None, 1e-5, False), 1e-5, 1e-5)
+
+
+class EpilogueTest(unittest.TestCase):
+    def test_bias_gelu(self):
+        for cols in (1, 9, 33):
+            x = randlist(5 * cols, -3, 3, seed=cols)
+            b = randlist(cols, seed=cols + 1)
+            got = xft.bias_gelu(make(x, [5, cols]), make(b, [cols]))
+            want = [gelu(x[i] + b[i % cols]) for i in range(5 * cols)]
+            assert_close(self, got, want, 2e-6, 2e-6, "cols=%d" % cols)
+
+    def test_bias_dropout_residual(self):
+        rows, cols = 7, 9
+        x = randlist(rows * cols, seed=1)
+        b = randlist(cols, seed=2)
+        res = randlist(rows * cols, seed=3)
+        xft.manual_seed(99)
+        seed, offset = xft.get_rng_state()
+        got = xft.bias_dropout_residual(make(x, [rows, cols]), make(b, [cols]),
+                                        make(res, [rows, cols]), p=0.5)
+        want = []
+        for i in range(rows * cols):
+            kept = philox_uniform_f32(seed, offset, i) < 0.5
+            want.append(res[i] + ((x[i] + b[i % cols]) * 2.0 if kept else 0.0))
+        assert_close(self, got, want, 1e-6, 1e-6)
+
+
+if __name__ == "__main__":
+    unittest.main()
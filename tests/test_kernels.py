@@ -0,0 +1,185 @@
+"""The SIMD elementwise and reduction kernels against scalar references,
+and the runtime choice of kernel table.
+
+ctest runs this suite once per kernel table the build has, pinned with
+XFT_CPU_CAPABILITY=default|avx2|avx512|avx512_vnni; a table the host
+cannot run is skipped. Sizes straddle the vector widths (4 to 16 lanes) so
+main loops, tails and single-element runs are all exercised, and the
+elementwise cases cover unit and gathered operands; test_broadcast covers
+step-0 ones.
+"""
+
+import math
+import os
+import subprocess
+import sys
+import unittest
+
+import xft
+from util import (TOL, assert_close, flat, gelu, make, numel, pin_cpu_capability, randlist,
+                  randt, ref_reduce, round_to)
+
+SIZES = [1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 64, 100, 257]
+FLOATS = [xft.float32, xft.float64, xft.float16, xft.bfloat16]
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+UNARY = {
+    "exp": (math.exp, (-3.0, 3.0)),
+    "log": (math.log, (0.05, 4.0)),
+    "sqrt": (math.sqrt, (0.0, 4.0)),
+    "tanh": (math.tanh, (-4.0, 4.0)),
+    "sigmoid": (lambda x: 1.0 / (1.0 + math.exp(-x)), (-6.0, 6.0)),
+    "relu": (lambda x: max(x, 0.0), (-1.0, 1.0)),
+    "gelu": (gelu, (-4.0, 4.0)),
+}
+
+BINARY = {
+    "add": lambda a, b: a + b,
+    "sub": lambda a, b: a - b,
+    "mul": lambda a, b: a * b,
+    "div": lambda a, b: a / b,
+    "maximum": max,
+    "minimum": min,
+}
+
+
+class ElementwiseTest(unittest.TestCase):
+    def test_unary(self):
+        for name, (fn, (lo, hi)) in UNARY.items():
+            op = getattr(xft, name)
+            for dtype in FLOATS:
+                rtol, atol = TOL[dtype]
+                # The SIMD exp/tanh/erf are polynomial approximations.
+                rtol, atol = max(rtol, 2e-6), max(atol, 2e-6)
+                for n in SIZES:
+                    x = round_to(dtype, randlist(n, lo, hi, seed=n))
+                    got = op(make(x, [n], dtype))
+                    assert_close(self, got, [fn(v) for v in x], rtol, atol,
+                                 "%s %s n=%d" % (name, dtype, n))
+
+    def test_unary_strided(self):
+        # Every other element of a [n, 2] buffer: the gather path.
+        for name, (fn, (lo, hi)) in UNARY.items():
+            op = getattr(xft, name)
+            for n in (5, 16, 33):
+                x = randlist(2 * n, lo, hi, seed=n)
+                t = make(x, [n, 2]).select(1, 1)
+                self.assertEqual(t.stride(), (2,))
+                assert_close(self, op(t), [fn(v) for v in x[1::2]], 2e-6, 2e-6, name)
+
+    def test_binary(self):
+        for name, fn in BINARY.items():
+            op = getattr(xft, name)
+            for dtype in FLOATS:
+                rtol, atol = TOL[dtype]
+                for n in SIZES:
+                    a = round_to(dtype, randlist(n, seed=n))
+                    b = round_to(dtype, randlist(n, 0.5, 2.0, seed=n + 1))
+                    got = op(make(a, [n], dtype), make(b, [n], dtype))
+                    want = round_to(dtype, [fn(x, y) for x, y in zip(a, b)])
+                    assert_close(self, got, want, rtol, atol, "%s %s n=%d" % (name, dtype, n))
+
+    def test_binary_integers(self):
+        for name, fn in BINARY.items():
+            if name == "div":
+                continue
+            op = getattr(xft, name)
+            for dtype, lo, hi in ((xft.int32, -1000, 1000), (xft.int64, -2 * 10 ** 9, 2 * 10 ** 9),
+                                  (xft.uint8, 0, 15)):
+                for n in (1, 9, 33, 100):
+                    a = [int(v) for v in randlist(n, lo, hi, seed=n)]
+                    b = [int(v) for v in randlist(n, lo, hi, seed=n + 7)]
+                    got = op(make(a, [n], dtype), make(b, [n], dtype))
+                    want = [fn(x, y) for x, y in zip(a, b)]
+                    if dtype == xft.uint8:
+                        want = [w & 0xFF for w in want]  # unsigned wraparound
+                    self.assertEqual(flat(got), want, "%s %s n=%d" % (name, dtype, n))
+
+    def test_out_and_inplace(self):
+        x = randlist(19, seed=3)
+        out = xft.empty(19)
+        xft.exp(make(x, [19]), out=out)
+        assert_close(self, out, [math.exp(v) for v in x], 2e-6, 2e-6)
+        t = make(x, [19])
+        t.mul_(2.0)
+        assert_close(self, t, [2 * v for v in x])
+
+
+class DispatchTest(unittest.TestCase):
+    TABLES = ["default", "avx2", "avx512", "avx512_vnni"]
+
+    def capability(self, pinned):
+        # The table is chosen once per process, so each pin needs its own.
+        env = dict(os.environ)
+        env.pop("XFT_CPU_CAPABILITY", None)
+        if pinned is not None:
+            env["XFT_CPU_CAPABILITY"] = pinned
+        return subprocess.run([sys.executable, "-c", "import xft; print(xft.cpu_capability())"],
+                              env=env, capture_output=True, text=True)
+
+    def test_pinning_only_steps_down(self):
+        native = self.capability(None).stdout.strip()
+        self.assertIn(native, self.TABLES)
+        for i, name in enumerate(self.TABLES):
+            got = self.capability(name)
+            self.assertEqual(got.returncode, 0, got.stderr)
+            want = name if i <= self.TABLES.index(native) else native
+            self.assertEqual(got.stdout.strip(), want, "pinned " + name)
+
+    def test_unknown_table_is_an_error(self):
+        got = self.capability("sse9")
+        self.assertNotEqual(got.returncode, 0)
+        self.assertIn("XFT_CPU_CAPABILITY must be", got.stderr)
+
+
+class ReduceTest(unittest.TestCase):
+    SHAPES = [[1], [17], [1000], [4, 9], [3, 33, 5], [2, 300, 17], [64, 129]]
+
+    def test_sum_amax_mean(self):
+        for dtype in FLOATS:
+            rtol, atol = TOL[dtype]
+            for shape in self.SHAPES:
+                x = round_to(dtype, randlist(numel(shape), seed=len(shape)))
+                t = make(x, shape, dtype)
+                n = numel(shape)
+                for dim in [None] + list(range(len(shape))):
+                    s, out_shape = ref_reduce(x, shape, dim, lambda a, b: a + b, 0.0)
+                    m, _ = ref_reduce(x, shape, dim, max, -math.inf)
+                    count = n if dim is None else shape[dim]
+                    tag = "%s %s dim=%s" % (dtype, shape, dim)
+                    # Reduced floats round the result once; sums of many
+                    # terms get a wider bound.
+                    tol = (rtol * 4, atol * math.sqrt(count) * 4)
+                    got = xft.sum(t, dim)
+                    self.assertEqual(list(got.shape), out_shape, tag)
+                    assert_close(self, got, s, *tol, msg="sum " + tag)
+                    assert_close(self, xft.mean(t, dim), [v / count for v in s], *tol,
+                                 msg="mean " + tag)
+                    assert_close(self, xft.amax(t, dim), m, msg="amax " + tag)
+
+    def test_keepdim(self):
+        t = randt(3, 4, 5)
+        self.assertEqual(xft.sum(t, 1, keepdim=True).shape, (3, 1, 5))
+        self.assertEqual(xft.amax(t, -1, keepdim=True).shape, (3, 4, 1))
+
+    def test_integer_sum(self):
+        for dtype in (xft.int32, xft.int64, xft.uint8):
+            x = [int(v) for v in randlist(300, 0, 100, seed=5)]
+            got = xft.sum(make(x, [300], dtype))
+            self.assertEqual(got.dtype, xft.int64)
+            self.assertEqual(got.item(), sum(x))
+
+    def test_strided_input(self):
+        x = randlist(8 * 6, seed=9)
+        t = make(x, [8, 6]).T  # [6, 8], not contiguous
+        s, _ = ref_reduce([x[j * 6 + i] for i in range(6) for j in range(8)], [6, 8], 1,
+                          lambda a, b: a + b, 0.0)
+        assert_close(self, xft.sum(t, 1), s)
+
+
+if __name__ == "__main__":
+    unittest.main()
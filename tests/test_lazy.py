@@ -0,0 +1,105 @@
+"""Lazy mode: pending graphs against the same ops run eagerly.
+
+Run once per kernel table, like test_kernels: the CPU fused loop goes
+through the vectorized kernels chunk by chunk.
+"""
+
+import unittest
+
+import xft
+from util import assert_close, make, pin_cpu_capability, randlist, randt
+
+KMAX_OPS = 64  # kMaxOps in csrc/lazy/ir.h
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+def chain(x, w, b):
+    return xft.sigmoid(x * w + b) * x - xft.tanh(b)
+
+
+class LazyTest(unittest.TestCase):
+    def setUp(self):
+        xft.lazy.reset_stats()
+
+    def lazy(self, fn, *args):
+        with xft.lazy_mode():
+            out = fn(*args)
+        self.assertTrue(out.is_lazy)
+        return out
+
+    def test_matches_eager(self):
+        # 1100 elements: two full 512-element chunks and a tail.
+        for n in (1, 7, 1100):
+            x = randt(n, seed=n)
+            w = randt(n, seed=n + 1)
+            b = randt(n, seed=n + 2)
+            got = self.lazy(chain, x, w, b)
+            assert_close(self, got, chain(x, w, b), 1e-6, 1e-6, "n=%d" % n)
+        self.assertEqual(xft.lazy.stats()["materializations"], 3)
+
+    def test_broadcast_inputs(self):
+        x = randt(5, 33, seed=1)
+        w = randt(33, seed=2)      # step 0 across rows
+        b = randt(5, 1, seed=3)    # step 0 across columns
+        got = self.lazy(chain, x, w, b)
+        self.assertEqual(got.shape, (5, 33))
+        assert_close(self, got, chain(x, w, b), 1e-6, 1e-6)
+        got = self.lazy(lambda s: xft.exp(x * s) + s, make([0.5], []))
+        assert_close(self, got, xft.exp(x * 0.5) + 0.5, 1e-6, 1e-6)
+
+    def test_strided_inputs(self):
+        base = randt(40, 30, seed=4)
+        x = base.T                  # transposed
+        w = base[::2, 1::3].T       # gathered both ways: [10, 20]
+        b = randt(20, 10, seed=5).T
+        self.assertFalse(x.is_contiguous())
+        got = self.lazy(chain, x[:10, :20], w, b)
+        assert_close(self, got, chain(x[:10, :20], w, b), 1e-6, 1e-6)
+
+    def test_chain_longer_than_max_ops(self):
+        # Past kMaxOps the pending operand is materialized and the chain
+        # goes on from its result.
+        x = randt(300, lo=0.5, hi=1.5, seed=6)
+        steps = 2 * KMAX_OPS + 22
+
+        def run(t):
+            y = t
+            for i in range(steps):
+                y = y * x if i % 2 == 0 else xft.tanh(y)
+            return y
+
+        got = self.lazy(run, x)
+        self.assertLessEqual(xft.lazy.memory_plan(got)["ops"], KMAX_OPS)
+        assert_close(self, got, run(x), 1e-6, 1e-6)
+        s = xft.lazy.stats()
+        self.assertEqual(s["traced_ops"], steps)
+        self.assertEqual(s["fused_ops"], steps)
+        self.assertEqual(s["materializations"], steps // KMAX_OPS + 1)
+
+    def test_inplace_write_to_input_is_an_error(self):
+        x = randt(16, seed=7)
+        y = self.lazy(lambda: x + 1.0)
+        x.add_(1.0)
+        with self.assertRaisesRegex(RuntimeError, "modified in place"):
+            y.tolist()
+        # Materialized first, the write is fine and leaves y alone.
+        x = make(randlist(16, seed=8), [16])
+        want = [v + 1.0 for v in x.tolist()]
+        y = self.lazy(lambda: x + 1.0)
+        y.materialize()
+        x.add_(1.0)
+        assert_close(self, y, want)
+
+    def test_grad_inputs_run_eagerly(self):
+        x = randt(8, seed=9).requires_grad_()
+        with xft.lazy_mode():
+            y = x * 2.0
+        self.assertFalse(y.is_lazy)
+        self.assertEqual(xft.lazy.stats()["traced_ops"], 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,57 @@
+"""CPU matmul, mm and bmm against a scalar reference.
+
+Run once per kernel table, like test_kernels. Shapes straddle the GEMM
+tile sizes so full tiles, edge tiles and single rows or columns are all
+exercised.
+"""
+
+import unittest
+
+import xft
+from util import TOL, assert_close, flat, make, pin_cpu_capability, randlist, ref_matmul, round_to
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class MatmulTest(unittest.TestCase):
+    def test_shapes(self):
+        for dtype in (xft.float32, xft.float64):
+            rtol, atol = TOL[dtype]
+            for m, k, n in ((1, 1, 1), (3, 5, 7), (16, 16, 16), (17, 33, 9), (65, 70, 129),
+                            (1, 300, 2)):
+                a = randlist(m * k, seed=m)
+                b = randlist(k * n, seed=n)
+                got = xft.matmul(make(a, [m, k], dtype), make(b, [k, n], dtype))
+                assert_close(self, got, ref_matmul(a, b, m, k, n), rtol * 10, atol * k,
+                             "%s %dx%dx%d" % (dtype, m, k, n))
+
+    def test_transposed_and_batched(self):
+        a = randlist(2 * 4 * 6, seed=1)
+        b = randlist(2 * 5 * 6, seed=2)
+        ta = make(a, [2, 4, 6])
+        tb = make(b, [2, 5, 6]).transpose(1, 2)  # [2, 6, 5], not contiguous
+        got = flat(xft.bmm(ta, tb))
+        for batch in range(2):
+            bt = [b[batch * 30 + j * 6 + p] for p in range(6) for j in range(5)]
+            want = ref_matmul(a[batch * 24:(batch + 1) * 24], bt, 4, 6, 5)
+            assert_close(self, got[batch * 20:(batch + 1) * 20], want, 1e-5, 1e-5)
+
+    def test_vector_operands(self):
+        a = randlist(4 * 3, seed=1)
+        v = randlist(3, seed=2)
+        assert_close(self, xft.matmul(make(a, [4, 3]), make(v, [3])), ref_matmul(a, v, 4, 3, 1))
+        assert_close(self, xft.matmul(make(v, [3]), make(v, [3])), [sum(x * x for x in v)])
+
+    def test_reduced_precision(self):
+        for dtype in (xft.float16, xft.bfloat16):
+            a = round_to(dtype, randlist(9 * 20, seed=1))
+            b = round_to(dtype, randlist(20 * 11, seed=2))
+            got = xft.matmul(make(a, [9, 20], dtype), make(b, [20, 11], dtype))
+            rtol, atol = TOL[dtype]
+            assert_close(self, got, ref_matmul(a, b, 9, 20, 11), rtol * 2, atol * 4, str(dtype))
+
+
+if __name__ == "__main__":
+    unittest.main()
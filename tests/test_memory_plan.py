@@ -0,0 +1,120 @@
+"""The lazy-mode memory planner: offsets against the lifetimes they must
+keep apart, the arena size, and in-place reuse.
+
+Programs are lists of (bytes, a, b) per instruction, as plan_memory takes
+them; a and b name the instructions producing the operands, -1 for none.
+"""
+
+import random
+import unittest
+
+import xft
+from util import randt
+
+
+def lifetimes(nodes):
+    """[start, end] per instruction: from itself to its last use."""
+    end = list(range(len(nodes)))
+    for i, (_, a, b) in enumerate(nodes):
+        for op in (a, b):
+            if op >= 0:
+                end[op] = i
+    return [(i, e) for i, e in enumerate(end)]
+
+
+def random_program(rng, n):
+    nodes = []
+    for i in range(n):
+        a = rng.randrange(-1, i)
+        b = rng.randrange(-1, i) if rng.random() < 0.6 else -1
+        nodes.append((rng.choice([8, 24, 64, 64, 100, 256]), a, b))
+    return nodes
+
+
+class PlanMemoryTest(unittest.TestCase):
+    def check(self, nodes, alignment):
+        plan = xft.lazy.plan_memory(nodes, alignment)
+        offsets = plan["offsets"]
+        life = lifetimes(nodes)
+        aligned = [(size + alignment - 1) // alignment * alignment for size, _, _ in nodes]
+        last = len(nodes) - 1
+        self.assertEqual(offsets[last], -1)
+        in_place = 0
+        for j in range(last):
+            self.assertEqual(offsets[j] % alignment, 0)
+            self.assertLessEqual(offsets[j] + aligned[j], plan["arena_bytes"])
+            shared = False
+            for i in range(j):
+                if life[i][1] < j:
+                    continue  # dead before j starts
+                if (offsets[i] + aligned[i] <= offsets[j] or
+                        offsets[j] + aligned[j] <= offsets[i]):
+                    continue
+                # The only overlap allowed: j written over an operand that
+                # dies at j, element for element.
+                self.assertIn(i, nodes[j][1:], "%d and %d overlap in %s" % (i, j, nodes))
+                self.assertEqual(life[i][1], j)
+                self.assertEqual((offsets[i], nodes[i][0]), (offsets[j], nodes[j][0]))
+                shared = True
+            in_place += shared
+        self.assertEqual(plan["in_place"], in_place)
+        self.assertEqual(plan["unplanned_bytes"], sum(size for size, _, _ in nodes[:last]))
+        # Never worse than a buffer per intermediate, never below what is
+        # live at once.
+        self.assertLessEqual(plan["arena_bytes"], sum(aligned[:last]))
+        for t in range(last):
+            live = {offsets[i]: aligned[i] for i in range(last) if life[i][0] <= t <= life[i][1]}
+            self.assertGreaterEqual(plan["arena_bytes"], sum(live.values()))
+        return plan
+
+    def test_random_programs(self):
+        rng = random.Random(0)
+        for _ in range(300):
+            nodes = random_program(rng, rng.randrange(1, 24))
+            self.check(nodes, rng.choice([1, 16, 64]))
+
+    def test_chain_reuses_one_buffer(self):
+        nodes = [(64, -1, -1)] + [(64, i, -1) for i in range(9)]
+        plan = self.check(nodes, 16)
+        self.assertEqual(plan["in_place"], 8)
+        self.assertEqual(plan["arena_bytes"], 64)
+
+    def test_in_place_needs_a_dying_operand_of_the_same_size(self):
+        # 2 = 0 + 1: 0 is read again by 3, and 1 has another size.
+        nodes = [(64, -1, -1), (32, -1, -1), (64, 0, 1), (64, 2, 0)]
+        plan = self.check(nodes, 16)
+        self.assertEqual(plan["in_place"], 0)
+        self.assertEqual(plan["arena_bytes"], 160)
+
+    def test_dead_buffers_are_reused(self):
+        # Two independent chains one after the other: the second fits in
+        # the space the first gives back.
+        nodes = [(256, -1, -1), (8, 0, -1), (256, -1, -1), (8, 2, 1), (8, 3, -1)]
+        plan = self.check(nodes, 1)
+        self.assertEqual(plan["offsets"][2], plan["offsets"][0])
+        self.assertEqual(plan["arena_bytes"], 264)
+
+    def test_rejects_forward_operands(self):
+        with self.assertRaisesRegex(RuntimeError, "earlier instructions"):
+            xft.lazy.plan_memory([(8, -1, -1), (8, 1, -1)])
+
+    def test_pending_tensor_plan(self):
+        # A chain of same-shape ops: every intermediate but the first is
+        # written over the one before it.
+        x = randt(1000, seed=1)
+        with xft.lazy_mode():
+            y = x
+            for _ in range(10):
+                y = xft.tanh(y * x)
+        plan = xft.lazy.memory_plan(y)
+        self.assertEqual(plan["ops"], 20)
+        self.assertEqual(plan["in_place"], 18)
+        self.assertEqual(plan["output_bytes"], 4000)
+        self.assertLess(plan["arena_bytes"], plan["unplanned_bytes"])
+        self.assertGreaterEqual(plan["arena_bytes"], 4000)
+        y.materialize()
+        self.assertEqual(xft.lazy.memory_plan(y)["ops"], 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,138 @@
+"""The fused optimizers and clip_grad_norm_ against plain-Python updates.
+
+Each test runs a few steps on two parameters of different sizes, with a
+fresh grad every step, and follows the same updates in float64 lists.
+"""
+
+import math
+import unittest
+
+import xft
+from util import assert_close, flat, make, randlist
+
+SIZES = (5, 37)
+STEPS = 4
+
+
+def grads_at(step):
+    return [randlist(n, seed=100 * step + n) for n in SIZES]
+
+
+class OptimizerTest(unittest.TestCase):
+    def params(self, dtype=xft.float64):
+        return [make(randlist(n, seed=n), [n], dtype).requires_grad_() for n in SIZES]
+
+    def run_steps(self, opt, params, dtype=xft.float64):
+        for step in range(STEPS):
+            for p, g in zip(params, grads_at(step)):
+                p.grad = make(g, [len(g)], dtype)
+            opt.step()
+
+    def test_sgd(self):
+        for momentum, dampening, wd, nesterov in ((0.0, 0.0, 0.0, False), (0.9, 0.0, 0.01, False),
+                                                  (0.9, 0.1, 0.0, False), (0.8, 0.0, 0.05, True)):
+            params = self.params()
+            ref = [flat(p) for p in params]
+            opt = xft.optim.SGD(params, lr=0.1, momentum=momentum, dampening=dampening,
+                                weight_decay=wd, nesterov=nesterov)
+            self.run_steps(opt, params)
+            bufs = [None] * len(ref)
+            for step in range(STEPS):
+                for k, g in enumerate(grads_at(step)):
+                    g = [gi + wd * pi for gi, pi in zip(g, ref[k])]
+                    if momentum:
+                        if bufs[k] is None:
+                            bufs[k] = g
+                        else:
+                            bufs[k] = [momentum * b + (1 - dampening) * gi
+                                       for b, gi in zip(bufs[k], g)]
+                        g = ([gi + momentum * b for gi, b in zip(g, bufs[k])] if nesterov
+                             else bufs[k])
+                    ref[k] = [pi - 0.1 * gi for pi, gi in zip(ref[k], g)]
+            tag = "momentum=%s dampening=%s wd=%s nesterov=%s" % (momentum, dampening, wd,
+                                                                   nesterov)
+            for p, want in zip(params, ref):
+                assert_close(self, p, want, 1e-12, 1e-12, tag)
+
+    def adam_reference(self, ref, lr, betas, eps, wd, decoupled, grads_by_step):
+        beta1, beta2 = betas
+        m = [[0.0] * len(r) for r in ref]
+        v = [[0.0] * len(r) for r in ref]
+        t = [0] * len(ref)
+        for grads in grads_by_step:
+            for k, g in enumerate(grads):
+                if g is None:
+                    continue
+                t[k] += 1
+                if decoupled:
+                    ref[k] = [pi - lr * wd * pi for pi in ref[k]]
+                else:
+                    g = [gi + wd * pi for gi, pi in zip(g, ref[k])]
+                m[k] = [beta1 * a + (1 - beta1) * gi for a, gi in zip(m[k], g)]
+                v[k] = [beta2 * a + (1 - beta2) * gi * gi for a, gi in zip(v[k], g)]
+                bc1, bc2 = 1 - beta1 ** t[k], 1 - beta2 ** t[k]
+                ref[k] = [pi - lr * (mi / bc1) / (math.sqrt(vi / bc2) + eps)
+                          for pi, mi, vi in zip(ref[k], m[k], v[k])]
+        return ref
+
+    def test_adam_and_adamw(self):
+        for cls, decoupled in ((xft.optim.Adam, False), (xft.optim.AdamW, True)):
+            for dtype, tol in ((xft.float64, 1e-12), (xft.float32, 1e-5)):
+                params = self.params(dtype)
+                ref = [flat(p) for p in params]
+                opt = cls(params, lr=0.01, betas=(0.8, 0.95), eps=1e-6, weight_decay=0.1)
+                self.run_steps(opt, params, dtype)
+                ref = self.adam_reference(ref, 0.01, (0.8, 0.95), 1e-6, 0.1, decoupled,
+                                          [grads_at(s) for s in range(STEPS)])
+                for p, want in zip(params, ref):
+                    assert_close(self, p, want, tol, tol, "%s %s" % (cls.__name__, dtype))
+
+    def test_adam_counts_steps_per_parameter(self):
+        # The second parameter has no grad at first: it is left alone, and
+        # its bias correction starts from its own first step.
+        params = self.params()
+        ref = [flat(p) for p in params]
+        opt = xft.optim.Adam(params, lr=0.05)
+        grads_by_step = []
+        for step in range(STEPS):
+            grads = grads_at(step)
+            if step == 0:
+                grads[1] = None
+            grads_by_step.append(grads)
+            for p, g in zip(params, grads):
+                p.grad = None if g is None else make(g, [len(g)], xft.float64)
+            opt.step()
+            if step == 0:
+                self.assertEqual(flat(params[1]), ref[1])
+        ref = self.adam_reference(ref, 0.05, (0.9, 0.999), 1e-8, 0.0, False, grads_by_step)
+        for p, want in zip(params, ref):
+            assert_close(self, p, want, 1e-12, 1e-12)
+
+
+class ClipGradNormTest(unittest.TestCase):
+    def test_clips_above_max_norm(self):
+        grads = [randlist(n, seed=n) for n in SIZES]
+        norm = math.sqrt(sum(x * x for g in grads for x in g))
+        for max_norm in (norm / 3, norm * 2):
+            params = [xft.zeros(n, dtype=xft.float64) for n in SIZES]
+            for p, g in zip(params, grads):
+                p.grad = make(g, [len(g)], xft.float64)
+            got = xft.optim.clip_grad_norm_(params, max_norm)
+            self.assertEqual(got.dtype, xft.float32)
+            self.assertAlmostEqual(got.item(), norm, places=5)
+            coef = min(1.0, max_norm / (norm + 1e-6))
+            for p, g in zip(params, grads):
+                assert_close(self, p.grad, [x * coef for x in g], 1e-12, 1e-12,
+                             "max_norm=%g" % max_norm)
+
+    def test_skips_missing_grads(self):
+        a, b = xft.zeros(3), xft.zeros(4)
+        a.grad = make([3.0, 0.0, 4.0], [3])
+        got = xft.optim.clip_grad_norm_([a, b], 1.0)
+        self.assertAlmostEqual(got.item(), 5.0, places=6)
+        assert_close(self, a.grad, [0.6, 0.0, 0.8], 1e-6, 1e-6)
+        self.assertIsNone(b.grad)
+
+
+if __name__ == "__main__":
+    unittest.main()
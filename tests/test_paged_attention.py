@@ -0,0 +1,67 @@
+"""The paged KV cache's block allocator, and paged decode attention against
+scaled_dot_product_attention over the same keys and values laid out
+contiguously.
+
+Run once per kernel table, like test_kernels.
+"""
+
+import unittest
+
+import xft
+from util import assert_close, pin_cpu_capability, randt
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class BlockAllocatorTest(unittest.TestCase):
+    def test_blocks_follow_length(self):
+        cache = xft.kv_cache.PagedKVCache(1, num_blocks=4, block_size=4, num_heads=1,
+                                          head_dim=2)
+        s = cache.add_sequence()
+        self.assertEqual(len(cache.append_slots([s], [10])), 10)
+        self.assertEqual((cache.length(s), cache.num_free_blocks), (10, 1))
+        cache.append_slots([s], [2])  # fills the third block
+        self.assertEqual(cache.num_free_blocks, 1)
+        cache.append_slots([s])
+        self.assertEqual((cache.length(s), cache.num_free_blocks), (13, 0))
+        # Running out leaves the sequence as it was.
+        with self.assertRaisesRegex(RuntimeError, "out of blocks"):
+            cache.append_slots([s], [4])
+        self.assertEqual(cache.length(s), 13)
+        cache.remove_sequence(s)
+        self.assertEqual(cache.num_free_blocks, 4)
+
+
+class PagedAttentionTest(unittest.TestCase):
+    def test_against_contiguous_attention(self):
+        # Two sequences with a partly filled last block each and shuffled
+        # blocks, grouped-query heads (4 query heads on 2 kv heads).
+        block, Hq, Hkv, D = 4, 4, 2, 8
+        lens = [10, 3]
+        cache = xft.kv_cache.PagedKVCache(1, num_blocks=8, block_size=block, num_heads=Hkv,
+                                          head_dim=D)
+        seqs = [cache.add_sequence() for _ in lens]
+        keys, values = [], []
+        for s, n in zip(seqs, lens):
+            k = randt(n, Hkv, D, seed=10 + n)
+            v = randt(n, Hkv, D, seed=20 + n)
+            cache.store(0, cache.append_slots([s], [n]), k, v)
+            keys.append(k)
+            values.append(v)
+        q = randt(2, Hq, D, seed=5)
+        got = xft.nn.functional.paged_attention(q, cache.key_cache(0), cache.value_cache(0),
+                                                cache.block_tables(seqs),
+                                                cache.context_lens(seqs))
+        for b, n in enumerate(lens):
+            for h in range(Hq):
+                kv = h // (Hq // Hkv)
+                want = xft.nn.functional.scaled_dot_product_attention(
+                    q[b, h].view(1, 1, D), keys[b][:, kv].contiguous().view(1, n, D),
+                    values[b][:, kv].contiguous().view(1, n, D))
+                assert_close(self, got[b, h], want, 1e-5, 1e-6, "seq %d head %d" % (b, h))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,86 @@
+"""The CPU thread pool: set_num_threads, how parallel_for splits a range,
+and ops agreeing whatever the thread count."""
+
+import os
+import subprocess
+import sys
+import unittest
+
+import xft
+from util import assert_close, flat, randt
+from xft.tensor import parallel_chunks
+
+
+class ParallelForTest(unittest.TestCase):
+    def setUp(self):
+        self.threads = xft.get_num_threads()
+
+    def tearDown(self):
+        xft.set_num_threads(self.threads)
+
+    def test_set_num_threads(self):
+        for n in (1, 3, 8, 2):
+            xft.set_num_threads(n)
+            self.assertEqual(xft.get_num_threads(), n)
+        for n in (0, -1):
+            with self.assertRaisesRegex(RuntimeError, "positive thread count"):
+                xft.set_num_threads(n)
+        self.assertEqual(xft.get_num_threads(), 2)
+
+    def test_chunks(self):
+        for threads in (1, 2, 3, 4, 7):
+            xft.set_num_threads(threads)
+            for begin, end, grain in ((0, 100, 1), (5, 15, 4), (0, 9, 4), (3, 1003, 100),
+                                      (0, 1 << 20, 32768), (0, 64, 64), (-7, 7, 2)):
+                tag = "threads=%d range=[%d, %d) grain=%d" % (threads, begin, end, grain)
+                chunks = parallel_chunks(begin, end, grain)
+                # Contiguous, in order, covering the range exactly once.
+                self.assertEqual(chunks[0][0], begin, tag)
+                self.assertEqual(chunks[-1][1], end, tag)
+                for (_, hi), (lo, _) in zip(chunks, chunks[1:]):
+                    self.assertEqual(hi, lo, tag)
+                # No more chunks than threads or grains, all the same size
+                # but a shorter last one.
+                grains = (end - begin + grain - 1) // grain
+                self.assertLessEqual(len(chunks), min(threads, grains), tag)
+                sizes = [hi - lo for lo, hi in chunks]
+                self.assertTrue(all(s == sizes[0] for s in sizes[:-1]), tag)
+                self.assertLessEqual(0, sizes[0] - sizes[-1], tag)
+                if threads > 1 and grains > 1:
+                    self.assertGreater(len(chunks), 1, tag)
+
+    def test_small_or_empty_ranges_run_inline(self):
+        xft.set_num_threads(4)
+        self.assertEqual(parallel_chunks(0, 100, 100), [(0, 100)])
+        self.assertEqual(parallel_chunks(0, 100, 1000), [(0, 100)])
+        self.assertEqual(parallel_chunks(0, 100, 0), [(0, 25), (25, 50), (50, 75), (75, 100)])
+        self.assertEqual(parallel_chunks(10, 10, 1), [])
+        self.assertEqual(parallel_chunks(10, 5, 1), [])
+
+    def test_ops_agree_across_thread_counts(self):
+        x = randt(300001, seed=1)
+        m = randt(257, 1031, seed=2)
+        got = {}
+        for threads in (1, 2, 5):
+            xft.set_num_threads(threads)
+            got[threads] = (flat(xft.exp(x)), flat(x * x + x), flat(m.sum(1)), m.sum().item())
+        for threads in (2, 5):
+            self.assertEqual(got[threads][:2], got[1][:2], "threads=%d" % threads)
+            assert_close(self, got[threads][2], got[1][2], 1e-5, 1e-5)
+            self.assertAlmostEqual(got[threads][3], got[1][3], places=2)
+
+    def test_env_default(self):
+        def threads_with(value):
+            env = dict(os.environ, XFT_NUM_THREADS=value)
+            out = subprocess.run([sys.executable, "-c", "import xft; print(xft.get_num_threads())"],
+                                 env=env, capture_output=True, text=True, check=True)
+            return int(out.stdout)
+
+        self.assertEqual(threads_with("3"), 3)
+        # Not a positive count: the hardware concurrency instead.
+        self.assertEqual(threads_with("0"), threads_with(""))
+        self.assertGreaterEqual(threads_with("junk"), 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
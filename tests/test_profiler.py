@@ -0,0 +1,95 @@
+"""The op-level profiler: recorded events, the summary table and the Chrome
+trace export, on a small forward and backward pass on the CPU."""
+
+import json
+import os
+import shutil
+import tempfile
+import unittest
+
+import xft
+from util import randt
+
+
+def profiled_step():
+    a = randt(4, 5, seed=1).requires_grad_()
+    b = randt(5, 3, seed=2)
+    with xft.profiler.profile() as prof:
+        xft.matmul(a, b).relu().sum().backward()
+    return prof
+
+
+class ProfilerTest(unittest.TestCase):
+    def test_events(self):
+        self.assertFalse(xft.profiler.is_enabled())
+        events = profiled_step().events()
+        self.assertFalse(xft.profiler.is_enabled())
+        top = [e.name for e in events if e.depth == 0]
+        self.assertEqual(top, ["matmul", "relu", "sum", "backward"])
+        mm = events[0]
+        self.assertEqual(mm.input_shapes, [(4, 5), (5, 3)])
+        self.assertEqual(mm.alloc_bytes, 4 * 3 * 4)
+        self.assertIsNone(mm.cuda_ns)
+        self.assertEqual([e.start_ns for e in events], sorted(e.start_ns for e in events))
+        # Each nested op lies inside the closest enclosing op before it,
+        # and self time excludes the children.
+        for i, e in enumerate(events):
+            self.assertLessEqual(e.self_ns, e.end_ns - e.start_ns)
+            if e.depth == 0:
+                continue
+            parent = next(p for p in reversed(events[:i]) if p.depth == e.depth - 1)
+            self.assertLessEqual(parent.start_ns, e.start_ns)
+            self.assertLessEqual(e.end_ns, parent.end_ns)
+        backward = [e for e in events if e.name == "backward"][0]
+        nested = [e.name for e in events if backward.start_ns <= e.start_ns < backward.end_ns]
+        self.assertIn("MatmulBackward", nested)
+        self.assertIn("AccumulateGrad", nested)
+
+    def test_table(self):
+        prof = profiled_step()
+        lines = prof.table(sort_by="count").splitlines()
+        self.assertEqual(lines[0].split()[:2], ["Name", "Calls"])
+        self.assertEqual(set(lines[1]), {"-"})
+        rows = {line.split()[0]: line.split() for line in lines[2:]}
+        # matmul ran forward and again in MatmulBackward.
+        self.assertEqual(rows["matmul"][1], "2")
+        self.assertEqual(rows["sum"][1], "1")
+        self.assertEqual(rows["matmul"][4], "-")  # no CUDA time
+        counts = [int(r[1]) for r in rows.values()]
+        self.assertEqual(counts, sorted(counts, reverse=True))
+        self.assertEqual(len(prof.table(row_limit=2).splitlines()), 4)
+        grouped = prof.table(group_by_input_shape=True)
+        self.assertIn("Input shapes", grouped.splitlines()[0])
+        self.assertIn("[[4, 5], [5, 3]]", grouped)
+
+    def test_chrome_trace(self):
+        prof = profiled_step()
+        d = tempfile.mkdtemp()
+        try:
+            path = os.path.join(d, "trace.json")
+            prof.export_chrome_trace(path)
+            with open(path) as f:
+                trace = json.load(f)
+        finally:
+            shutil.rmtree(d)
+        ops = [e for e in trace["traceEvents"] if e["ph"] == "X"]
+        events = prof.events()
+        self.assertEqual([e["name"] for e in ops], [e.name for e in events])
+        for got, ev in zip(ops, events):
+            self.assertAlmostEqual(got["ts"], ev.start_ns / 1e3, places=3)
+            self.assertAlmostEqual(got["dur"], (ev.end_ns - ev.start_ns) / 1e3, places=3)
+            self.assertEqual(got["tid"], ev.thread)
+            self.assertEqual(got["args"]["device"], "cpu")
+            self.assertEqual([tuple(s) for s in got["args"]["input_shapes"]], ev.input_shapes)
+
+    def test_results_need_a_session(self):
+        prof = xft.profiler.profile()
+        with self.assertRaisesRegex(RuntimeError, "no results yet"):
+            prof.events()
+        with prof:
+            pass
+        self.assertEqual(prof.events(), [])
+
+
+if __name__ == "__main__":
+    unittest.main()
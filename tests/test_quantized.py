@@ -0,0 +1,119 @@
+"""Int8/int4 weight quantization and the quantized linear kernels, against
+matmul with the dequantized weight.
+
+Run once per kernel table, like test_kernels: avx512_vnni has its own int8
+dot products.
+"""
+
+import unittest
+
+import xft
+from util import assert_close, flat, pin_cpu_capability, randt
+
+
+def setUpModule():
+    pin_cpu_capability()
+
+
+class QuantizedTest(unittest.TestCase):
+    def test_linear_matches_dequantized(self):
+        for bits in (8, 4):
+            for dynamic in (False, True):
+                w = randt(12, 64, seed=bits)
+                x = randt(5, 64, seed=1)
+                b = randt(12, seed=2)
+                qw = xft.quantization.quantize_weight(w, bits=bits, group_size=32,
+                                                      dynamic=dynamic)
+                got = qw.linear(x, b)
+                ref = xft.matmul(x, qw.dequantize().T) + b
+                # Dynamic mode also rounds x to int8 per row.
+                tol = 2e-2 if dynamic else 1e-5
+                assert_close(self, got, ref, tol, tol, "bits=%d dynamic=%s" % (bits, dynamic))
+
+    def test_dequantize_close_to_weight(self):
+        w = randt(8, 64, seed=3)
+        for bits, tol in ((8, 1e-2), (4, 0.15)):
+            qw = xft.quantization.quantize_weight(w, bits=bits, group_size=32)
+            assert_close(self, qw.dequantize(), w, 0.0, tol, "bits=%d" % bits)
+
+
+class QuantizeDynamicTest(unittest.TestCase):
+    def state(self):
+        return {
+            "fc1.weight": randt(16, 256, seed=1),
+            "fc1.bias": randt(16, seed=2),
+            "fc2.weight": randt(4, 16, seed=3),
+            "fc2.bias": randt(4, seed=4),
+            "embed.weight": randt(10, 256, seed=5),
+            "steps": xft.tensor([[3, 4]], dtype=xft.int64),
+            "config": {"hidden": 16},
+        }
+
+    def test_converts_floating_matrices_only(self):
+        state = self.state()
+        q = xft.quantization.quantize_dynamic(state)
+        self.assertEqual(set(q), set(state))
+        for name in ("fc1.weight", "fc2.weight", "embed.weight"):
+            self.assertIsInstance(q[name], xft.quantization.QuantizedWeight, name)
+            self.assertEqual(q[name].shape, state[name].shape, name)
+            self.assertEqual((q[name].bits, q[name].dynamic), (8, True), name)
+        for name in ("fc1.bias", "fc2.bias", "steps", "config"):
+            self.assertIs(q[name], state[name], name)
+
+    def test_int8_per_channel(self):
+        w = randt(6, 40, seed=7)
+        qw = xft.quantization.quantize_dynamic([w])[0]
+        self.assertEqual(qw.group_size, 40)
+        self.assertEqual(qw.data.dtype, xft.int8)
+        self.assertEqual(qw.scales.shape, (6, 1))
+        rows, data = w.tolist(), qw.data.tolist()
+        for row, q, (scale,) in zip(rows, data, qw.scales.tolist()):
+            amax = max(abs(v) for v in row)
+            self.assertAlmostEqual(scale, amax / 127, delta=1e-7 * amax)
+            self.assertEqual(max(abs(v) for v in q), 127)
+            for v, qv in zip(row, q):
+                self.assertLessEqual(abs(qv - v / scale), 0.5 + 1e-4)
+
+    def test_options(self):
+        state = self.state()
+        q = xft.quantization.quantize_dynamic(
+            state, bits=4, weight_only=True, filter=lambda name, t: not name.startswith("embed"))
+        self.assertIs(q["embed.weight"], state["embed.weight"])
+        # 4 bits defaults to groups of 128 columns where they divide
+        # in_features, per-channel otherwise.
+        self.assertEqual((q["fc1.weight"].bits, q["fc1.weight"].group_size), (4, 128))
+        self.assertEqual(q["fc2.weight"].group_size, 16)
+        self.assertFalse(q["fc1.weight"].dynamic)
+        self.assertEqual(q["fc1.weight"].data.shape, (16, 128))
+        q = xft.quantization.quantize_dynamic(state, group_size=64,
+                                              filter=lambda name, t: name == "fc1.weight")
+        self.assertEqual(q["fc1.weight"].group_size, 64)
+        # List entries are named by index.
+        ws = [randt(4, 8, seed=1), randt(4, 8, seed=2)]
+        q = xft.quantization.quantize_dynamic(ws, filter=lambda name, t: name == "1")
+        self.assertIs(q[0], ws[0])
+        self.assertIsInstance(q[1], xft.quantization.QuantizedWeight)
+
+    def test_quantized_model_close_to_float(self):
+        F = xft.nn.functional
+        state = self.state()
+        x = randt(3, 256, seed=9)
+
+        def forward(p):
+            h = F.linear(x, p["fc1.weight"], p["fc1.bias"]).relu()
+            return F.linear(h, p["fc2.weight"], p["fc2.bias"])
+
+        ref = flat(forward(state))
+        scale = max(abs(v) for v in ref)
+        for bits, weight_only, tol in ((8, False, 0.02), (8, True, 0.02), (4, False, 0.2),
+                                       (4, True, 0.2)):
+            q = xft.quantization.quantize_dynamic(state, bits=bits, weight_only=weight_only)
+            with xft.inference_mode():
+                got = forward(q)
+            self.assertEqual(got.shape, (3, 4))
+            assert_close(self, got, ref, 0.0, tol * scale,
+                         "bits=%d weight_only=%s" % (bits, weight_only))
+
+
+if __name__ == "__main__":
+    unittest.main()
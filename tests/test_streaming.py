@@ -0,0 +1,72 @@
+"""The out-of-core ops that stream checkpoint tensors, against the same ops
+on the tensor loaded whole."""
+
+import os
+import shutil
+import tempfile
+import unittest
+
+import xft
+from util import assert_close, flat, make, randlist, randt
+
+
+class StreamingTest(unittest.TestCase):
+    # 2 KiB chunks: 10 rows of 50 float32 each, so 100 rows is 10 chunks.
+    CHUNK = 2000
+
+    def setUp(self):
+        self.dir = tempfile.mkdtemp()
+        self.x = randlist(100 * 50, seed=7)
+        self.t = make(self.x, [100, 50])
+        self.path = os.path.join(self.dir, "x.xft")
+        xft.save({"x": self.t}, self.path)
+
+    def tearDown(self):
+        shutil.rmtree(self.dir)
+
+    def test_reader_chunks(self):
+        rows = []
+        for row, chunk in xft.streaming.ChunkReader(self.path, "x", chunk_bytes=self.CHUNK):
+            self.assertEqual(row, len(rows) // 50)
+            self.assertEqual(chunk.shape, (10, 50))
+            rows += flat(chunk)
+        self.assertEqual(rows, flat(self.t))
+
+    def test_partial_last_chunk(self):
+        # 95 rows: nine full chunks and one of 5 rows.
+        path = os.path.join(self.dir, "odd.xft")
+        xft.save({"x": self.t[:95]}, path)
+        chunks = list(xft.streaming.ChunkReader(path, "x", chunk_bytes=self.CHUNK))
+        self.assertEqual([(row, c.shape[0]) for row, c in chunks[-2:]], [(80, 10), (90, 5)])
+        assert_close(self, xft.streaming.sum(path, "x", dim=0, chunk_bytes=self.CHUNK),
+                     xft.sum(self.t[:95], 0), 1e-5, 1e-5)
+
+    def test_reductions_match_in_memory(self):
+        for name in ("sum", "mean", "amax"):
+            stream, eager = getattr(xft.streaming, name), getattr(xft, name)
+            for dim in (None, 0, 1):
+                got = stream(self.path, "x", dim=dim, chunk_bytes=self.CHUNK)
+                assert_close(self, got, eager(self.t, dim), 1e-5, 1e-5, "%s dim=%s" % (name, dim))
+
+    def test_matvec(self):
+        v = randt(50, seed=8)
+        got = xft.streaming.matvec(self.path, "x", v, chunk_bytes=self.CHUNK)
+        assert_close(self, got, xft.matmul(self.t, v), 1e-5, 1e-5)
+        m = randt(50, 3, seed=9)
+        got = xft.streaming.matvec(self.path, "x", m, chunk_bytes=self.CHUNK)
+        assert_close(self, got, xft.matmul(self.t, m), 1e-5, 1e-5)
+
+    def test_map(self):
+        out = os.path.join(self.dir, "y.xft")
+        shape = xft.streaming.map(lambda rows: rows[:, :3].relu(), self.path, "x", out,
+                                  chunk_bytes=self.CHUNK)
+        self.assertEqual(tuple(shape), (100, 3))
+        assert_close(self, xft.load(out)["x"], self.t[:, :3].relu())
+
+    def test_missing_tensor(self):
+        with self.assertRaises(RuntimeError):
+            xft.streaming.sum(self.path, "nope")
+
+
+if __name__ == "__main__":
+    unittest.main()
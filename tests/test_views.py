@@ -0,0 +1,113 @@
+"""Views: sizes, strides and offsets, and that every view aliases its base."""
+
+import unittest
+
+import xft
+from util import assert_close, flat, make, numel, randlist, randt, strides
+
+
+class ViewTest(unittest.TestCase):
+    def base(self, *shape):
+        return make([float(i) for i in range(numel(shape))], list(shape))
+
+    def assertAliases(self, view, base):
+        self.assertEqual(view.storage_ptr(), base.storage_ptr())
+
+    def test_view_and_reshape(self):
+        t = self.base(2, 3, 4)
+        v = t.view(6, 4)
+        self.assertEqual(v.shape, (6, 4))
+        self.assertEqual(v.stride(), (4, 1))
+        self.assertAliases(v, t)
+        self.assertEqual(t.view(-1, 2).shape, (12, 2))
+        # reshape of a non-viewable layout copies.
+        r = t.transpose(0, 2).reshape(-1)
+        self.assertNotEqual(r.storage_ptr(), t.storage_ptr())
+        self.assertEqual(flat(r), [float(i * 12 + j * 4 + k) for k in range(4)
+                                   for j in range(3) for i in range(2)])
+        with self.assertRaises(RuntimeError):
+            t.transpose(0, 2).view(-1)
+        with self.assertRaises(RuntimeError):
+            t.view(5, 5)
+
+    def test_transpose_permute(self):
+        t = self.base(2, 3, 4)
+        p = t.permute(2, 0, 1)
+        self.assertEqual(p.shape, (4, 2, 3))
+        self.assertEqual(p.stride(), (1, 12, 4))
+        self.assertFalse(p.is_contiguous())
+        self.assertAliases(p, t)
+        self.assertEqual(p[3, 1, 2].item(), 1 * 12 + 2 * 4 + 3)
+        self.assertEqual(t.T.shape, (4, 3, 2))
+        c = p.contiguous()
+        self.assertTrue(c.is_contiguous())
+        self.assertEqual(c.stride(), tuple(strides([4, 2, 3])))
+        self.assertEqual(flat(c), flat(p))
+
+    def test_slice_select_offsets(self):
+        t = self.base(5, 6)
+        s = t.slice(1, 1, 6, 2)
+        self.assertEqual(s.shape, (5, 3))
+        self.assertEqual(s.stride(), (6, 2))
+        self.assertEqual(s.storage_offset(), 1)
+        self.assertEqual(flat(s), [float(r * 6 + c) for r in range(5) for c in (1, 3, 5)])
+        row = t.select(0, 3)
+        self.assertEqual(row.storage_offset(), 18)
+        self.assertEqual(t[1:4, ::3].shape, (3, 2))
+        self.assertEqual(t[-1, -1].item(), 29.0)
+        self.assertEqual(t[..., 2].shape, (5,))
+        self.assertEqual(t[None, 0].shape, (1, 6))
+        # A view of a view composes offsets.
+        ss = s[2:, 1]
+        self.assertEqual(ss.storage_offset(), 2 * 6 + 3)
+        self.assertEqual(flat(ss), [15.0, 21.0, 27.0])
+
+    def test_expand_squeeze(self):
+        t = self.base(3, 1)
+        e = t.expand(3, 4)
+        self.assertEqual(e.stride(), (1, 0))
+        self.assertEqual(flat(e), [float(r) for r in range(3) for _ in range(4)])
+        self.assertEqual(t.squeeze().shape, (3,))
+        self.assertEqual(t.squeeze(1).unsqueeze(0).shape, (1, 3))
+        self.assertAliases(e, t)
+
+    def test_writes_through_views(self):
+        t = xft.zeros(4, 5)
+        t[1].fill_(1.0)
+        t[:, 2] = 2.0
+        t.T[4, 3] = 7.0
+        t.slice(0, 0, 4, 2)[:, 0].copy_(make([5.0, 6.0], [2]))
+        want = [[5.0, 0.0, 2.0, 0.0, 0.0],
+                [1.0, 1.0, 2.0, 1.0, 1.0],
+                [6.0, 0.0, 2.0, 0.0, 0.0],
+                [0.0, 0.0, 2.0, 0.0, 7.0]]
+        self.assertEqual(t.tolist(), want)
+
+    def test_inplace_ops_on_views(self):
+        x = randlist(12, seed=1)
+        t = make(x, [3, 4])
+        col = t[:, 1]
+        col.mul_(10.0)
+        col.add_(make([1.0, 2.0, 3.0], [3]))
+        want = list(x)
+        for r in range(3):
+            want[r * 4 + 1] = x[r * 4 + 1] * 10.0 + (r + 1)
+        assert_close(self, t, want)
+
+    def test_copy_between_layouts(self):
+        src = randt(3, 4, seed=2)
+        dst = xft.zeros(4, 3)
+        dst.T.copy_(src)
+        assert_close(self, dst.T, src)
+        self.assertEqual(dst.stride(), (3, 1))
+
+    def test_clone_does_not_alias(self):
+        t = self.base(2, 2)
+        c = t.clone()
+        c.fill_(0.0)
+        self.assertEqual(flat(t), [0.0, 1.0, 2.0, 3.0])
+
+
+
+if __name__ == "__main__":
+    unittest.main()
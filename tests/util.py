@@ -0,0 +1,182 @@
+"""Helpers shared by the test suites: pure-Python reference implementations
+and comparisons.
+
+The suites drive libxft.so through the Python bindings; ctest points
+XFT_LIBRARY at the library it just built and puts the source tree on
+PYTHONPATH (see CMakeLists.txt). References work on flat row-major lists
+plus a shape and never call into xft, so a kernel bug cannot hide in both
+sides of a comparison.
+"""
+
+import math
+import os
+import random
+import unittest
+
+import xft
+
+
+def flat(v):
+    """The values of a tensor, nested list or number, row-major."""
+    if isinstance(v, xft.Tensor):
+        v = v.tolist()
+    if isinstance(v, (list, tuple)):
+        return [z for y in v for z in flat(y)]
+    return [v]
+
+
+def numel(shape):
+    n = 1
+    for s in shape:
+        n *= s
+    return n
+
+
+def strides(shape):
+    out, n = [], 1
+    for s in reversed(shape):
+        out.append(n)
+        n *= s
+    return out[::-1]
+
+
+def make(values, shape, dtype=xft.float32, device="cpu"):
+    """A tensor of `shape` holding the flat list `values`."""
+    t = xft.tensor(list(values), dtype=dtype)
+    t = t.view(*shape) if shape else t.view(())
+    return t if device == "cpu" else t.to(device)
+
+
+def randlist(n, lo=-1.0, hi=1.0, seed=0):
+    rng = random.Random(seed)
+    return [rng.uniform(lo, hi) for _ in range(n)]
+
+
+def randt(*shape, lo=-1.0, hi=1.0, seed=0, dtype=xft.float32):
+    return make(randlist(numel(shape), lo, hi, seed), shape, dtype)
+
+
+# Tolerances per dtype for results computed in that dtype.
+TOL = {
+    xft.float64: (1e-12, 1e-12),
+    xft.float32: (1e-5, 1e-6),
+    xft.float16: (2e-3, 2e-3),
+    xft.bfloat16: (1.6e-2, 1.6e-2),
+}
+
+
+def round_to(dtype, values):
+    """values as `dtype` stores them, so references see the same inputs."""
+    if dtype in (xft.float16, xft.bfloat16):
+        return flat(xft.tensor(list(values), dtype=xft.float32).to(dtype).float())
+    return list(values)
+
+
+def assert_close(tc, actual, expected, rtol=1e-5, atol=1e-6, msg=None):
+    a, e = flat(actual), flat(expected)
+    tc.assertEqual(len(a), len(e), msg)
+    for i, (x, y) in enumerate(zip(a, e)):
+        if isinstance(y, float) and math.isnan(y):
+            tc.assertTrue(math.isnan(x), "%s: element %d is %r, expected nan" % (msg, i, x))
+            continue
+        if isinstance(y, float) and math.isinf(y):
+            tc.assertEqual(x, y, "%s: element %d" % (msg, i))
+            continue
+        if abs(x - y) > atol + rtol * abs(y):
+            tc.fail("%s: element %d is %r, expected %r (rtol %g, atol %g)"
+                    % (msg, i, x, y, rtol, atol))
+
+
+# ---- references over (flat list, shape) ----
+
+def ref_reduce(values, shape, dim, fn, init):
+    """Reduces dim `dim` (None for all) of row-major `values`."""
+    if dim is None:
+        acc = init
+        for v in values:
+            acc = fn(acc, v)
+        return [acc], []
+    dim %= len(shape)
+    outer = numel(shape[:dim])
+    r = shape[dim]
+    inner = numel(shape[dim + 1:])
+    out = []
+    for o in range(outer):
+        for i in range(inner):
+            acc = init
+            for k in range(r):
+                acc = fn(acc, values[(o * r + k) * inner + i])
+            out.append(acc)
+    return out, list(shape[:dim]) + list(shape[dim + 1:])
+
+
+def ref_matmul(a, b, m, k, n):
+    return [sum(a[i * k + p] * b[p * n + j] for p in range(k)) for i in range(m) for j in range(n)]
+
+
+def ref_softmax_rows(values, cols):
+    out = []
+    for r in range(len(values) // cols):
+        row = values[r * cols:(r + 1) * cols]
+        mx = max(row)
+        e = [math.exp(v - mx) for v in row]
+        s = sum(e)
+        out += [v / s for v in e]
+    return out
+
+
+def ref_attention(q, k, v, L, S, D, Dv, scale, causal):
+    """One head: q [L, D], k [S, D], v [S, Dv]."""
+    out = []
+    for i in range(L):
+        scores = []
+        for j in range(S):
+            if causal and j > i:
+                continue
+            scores.append((j, scale * sum(q[i * D + d] * k[j * D + d] for d in range(D))))
+        if not scores:
+            out += [0.0] * Dv
+            continue
+        mx = max(s for _, s in scores)
+        w = [(j, math.exp(s - mx)) for j, s in scores]
+        total = sum(x for _, x in w)
+        out += [sum(x * v[j * Dv + e] for j, x in w) / total for e in range(Dv)]
+    return out
+
+
+def gelu(x):
+    """The tanh approximation every backend implements."""
+    return 0.5 * x * (1.0 + math.tanh(0.7978845608028654 * (x + 0.044715 * x ** 3)))
+
+
+# Philox4x32-10 as in csrc/core/philox.h.
+def philox(seed, ctr):
+    m = 0xFFFFFFFF
+    c0, c1, c2, c3 = ctr & m, (ctr >> 32) & m, 0, 0
+    k0, k1 = seed & m, (seed >> 32) & m
+    for _ in range(10):
+        p0 = 0xD2511F53 * c0
+        p1 = 0xCD9E8D57 * c2
+        c0, c1, c2, c3 = ((p1 >> 32) ^ c1 ^ k0) & m, p1 & m, ((p0 >> 32) ^ c3 ^ k1) & m, p0 & m
+        k0 = (k0 + 0x9E3779B9) & m
+        k1 = (k1 + 0xBB67AE85) & m
+    return c0, c1, c2, c3
+
+
+def philox_uniform_f32(seed, offset, i):
+    """The float32 uniform element i of a random op draws."""
+    w = philox(seed, offset + i // 4)[i % 4]
+    return (w >> 8) * 2.0 ** -24
+
+
+def pin_cpu_capability():
+    """For a suite's setUpModule: skips the suite when ctest pinned a kernel
+    table (XFT_CPU_CAPABILITY) that this host cannot run."""
+    want = os.environ.get("XFT_CPU_CAPABILITY")
+    if want and xft.cpu_capability() != want:
+        raise unittest.SkipTest("host cannot run the %s kernels" % want)
+
+
+def require_cuda(tc=None):
+    if not xft.cuda.is_available():
+        raise unittest.SkipTest("no CUDA device")
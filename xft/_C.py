@@ -0,0 +1,226 @@
+"""ctypes binding to libxft.so.
+
+Every exported function returns 0 on success and -1 on failure; `call`
+turns a failure into a RuntimeError carrying xft_last_error(). Modules
+declare the signatures they use with `declare` so argument conversion is
+checked by ctypes rather than guessed.
+"""
+
+import ctypes
+import os
+import threading
+
+i32 = ctypes.c_int32
+i64 = ctypes.c_int64
+u64 = ctypes.c_uint64
+f64 = ctypes.c_double
+size_t = ctypes.c_size_t
+voidp = ctypes.c_void_p
+P = ctypes.POINTER
+
+
+class handle(ctypes.c_void_p):
+    """An owned xft_tensor_t; kept distinct from voidp so raw pointers unwrap to ints."""
+
+
+def _candidates():
+    env = os.environ.get("XFT_LIBRARY")
+    if env:
+        yield env
+    here = os.path.dirname(os.path.abspath(__file__))
+    yield os.path.join(here, "libxft.so")
+    yield os.path.join(os.path.dirname(here), "build", "libxft.so")
+
+
+def _load():
+    tried = []
+    for path in _candidates():
+        if os.path.exists(path):
+            return ctypes.CDLL(path)
+        tried.append(path)
+    raise ImportError(
+        "libxft.so not found (looked in: %s); build it with cmake or set XFT_LIBRARY"
+        % ", ".join(tried)
+    )
+
+
+lib = _load()
+lib.xft_last_error.restype = ctypes.c_char_p
+lib.xft_last_error.argtypes = []
+
+
+def declare(name, *argtypes):
+    fn = getattr(lib, name)
+    fn.argtypes = list(argtypes)
+    fn.restype = ctypes.c_int
+    return fn
+
+
+# An exception raised by a Python callback the core invoked (see
+# autograd.checkpoint); the C call that failed because of it re-raises it.
+_callback_error = threading.local()
+
+
+def set_callback_error(exc):
+    _callback_error.exc = exc
+
+
+def _raise():
+    msg = lib.xft_last_error().decode()
+    exc = getattr(_callback_error, "exc", None)
+    if exc is not None:
+        _callback_error.exc = None
+        raise exc from RuntimeError(msg)
+    raise RuntimeError(msg)
+
+
+def call(name, *args):
+    if getattr(lib, name)(*args) != 0:
+        _raise()
+
+
+def call_out(name, *args, out_type=handle):
+    """Calls a function whose last parameter is an out-pointer and returns it."""
+    out = out_type()
+    call(name, *args, ctypes.byref(out))
+    return out.value if out_type is not handle else out
+
+
+def bind(name):
+    """call, with the function looked up once."""
+    fn = getattr(lib, name)
+
+    def bound(*args):
+        if fn(*args) != 0:
+            _raise()
+
+    bound.__name__ = name
+    return bound
+
+
+def bind_out(name):
+    """call_out for a tensor-returning function, looked up once: the hot op
+    paths call the result with the other arguments and get the new handle."""
+    fn = getattr(lib, name)
+    byref = ctypes.byref
+
+    def bound(*args):
+        out = handle()
+        if fn(*args, byref(out)) != 0:
+            _raise()
+        return out
+
+    bound.__name__ = name
+    return bound
+
+
+def int64_array(values):
+    values = list(values)
+    return (i64 * max(len(values), 1))(*values), len(values)
+
+
+# ---- tensor core (csrc/api/c_api.h) ----
+declare("xft_tensor_empty", P(i64), i64, i32, i32, i32, P(handle))
+declare("xft_tensor_from_buffer", voidp, P(i64), i64, i32, P(handle))
+declare("xft_tensor_free", handle)
+declare("xft_tensor_new_handle", handle, P(handle))
+declare("xft_tensor_ndim", handle, P(i64))
+declare("xft_tensor_shape", handle, P(i64))
+declare("xft_tensor_strides", handle, P(i64))
+declare("xft_tensor_offset", handle, P(i64))
+declare("xft_tensor_dtype", handle, P(i32))
+declare("xft_tensor_device", handle, P(i32), P(i32))
+declare("xft_tensor_data_ptr", handle, P(voidp))
+declare("xft_tensor_storage_ptr", handle, P(voidp))
+declare("xft_tensor_is_contiguous", handle, i32, P(i32))
+declare("xft_tensor_to_buffer", handle, voidp, size_t)
+declare("xft_tensor_view", handle, P(i64), i64, P(handle))
+declare("xft_tensor_reshape", handle, P(i64), i64, P(handle))
+declare("xft_tensor_transpose", handle, i64, i64, P(handle))
+declare("xft_tensor_permute", handle, P(i64), i64, P(handle))
+declare("xft_tensor_slice", handle, i64, i64, i64, i64, P(handle))
+declare("xft_tensor_select", handle, i64, i64, P(handle))
+declare("xft_tensor_expand", handle, P(i64), i64, P(handle))
+declare("xft_tensor_squeeze", handle, i64, i32, P(handle))
+declare("xft_tensor_unsqueeze", handle, i64, P(handle))
+declare("xft_tensor_contiguous", handle, i32, P(handle))
+declare("xft_tensor_clone", handle, P(handle))
+declare("xft_tensor_to_dtype", handle, i32, P(handle))
+declare("xft_tensor_to_device", handle, i32, i32, i32, P(handle))
+declare("xft_tensor_copy_", handle, handle, i32)
+declare("xft_tensor_fill_", handle, f64)
+declare("xft_tensor_pin_memory", handle, P(handle))
+declare("xft_tensor_is_pinned", handle, P(i32))
+
+# ---- ops (csrc/api/ops_api.cpp) ----
+declare("xft_matmul", handle, handle, P(handle))
+declare("xft_mm", handle, handle, P(handle))
+declare("xft_bmm", handle, handle, P(handle))
+for _name in ("add", "sub", "mul", "div", "maximum", "minimum"):
+    declare("xft_" + _name, handle, handle, P(handle))
+    declare("xft_" + _name + "_scalar", handle, f64, i32, P(handle))
+    declare("xft_" + _name + "_out", handle, handle, handle)
+    declare("xft_" + _name + "_scalar_out", handle, f64, i32, handle)
+for _name in ("exp", "log", "sqrt", "tanh", "sigmoid", "relu", "gelu"):
+    declare("xft_" + _name, handle, P(handle))
+    declare("xft_" + _name + "_out", handle, handle)
+for _name in ("sum", "mean", "amax"):
+    declare("xft_" + _name, handle, i64, i32, i32, P(handle))
+declare("xft_softmax", handle, i64, P(handle))
+declare("xft_layer_norm", handle, handle, handle, f64, P(handle))
+declare("xft_rms_norm", handle, handle, f64, P(handle))
+declare("xft_bias_gelu", handle, handle, P(handle))
+declare("xft_bias_dropout_residual", handle, handle, handle, f64, i32, P(handle))
+declare("xft_scaled_dot_product_attention", handle, handle, handle, i32, f64, P(handle))
+declare("xft_conv2d", handle, handle, handle, i64, i64, i64, i64, i64, i64, i64, P(handle))
+declare("xft_quantize_weight", handle, i32, i64, P(handle), P(handle))
+declare("xft_dequantize_weight", handle, handle, P(handle))
+declare("xft_quantized_linear", handle, handle, handle, handle, i32, P(handle))
+declare("xft_paged_attention", handle, handle, handle, handle, handle, f64, P(handle))
+declare("xft_set_num_threads", i32)
+declare("xft_get_num_threads", P(i32))
+declare("xft_parallel_chunks", i64, i64, i64, P(i64), i64, P(i64))
+declare("xft_cpu_capability", P(ctypes.c_char_p))
+declare("xft_manual_seed", u64)
+declare("xft_rng_get_state", i32, i32, P(u64), P(u64))
+declare("xft_rng_set_state", i32, i32, u64, u64)
+declare("xft_rand", P(i64), i64, i32, i32, i32, P(handle))
+declare("xft_randn", P(i64), i64, i32, i32, i32, P(handle))
+declare("xft_dropout", handle, f64, i32, P(handle))
+declare("xft_autocast_set_enabled", i32, i32)
+declare("xft_autocast_is_enabled", i32, P(i32))
+declare("xft_autocast_set_dtype", i32, i32)
+declare("xft_autocast_get_dtype", i32, P(i32))
+declare("xft_amp_unscale_", P(handle), i64, f64, P(i32))
+
+# ---- lazy mode (csrc/api/lazy_api.cpp) ----
+declare("xft_set_lazy_enabled", i32)
+declare("xft_is_lazy_enabled", P(i32))
+declare("xft_tensor_is_lazy", handle, P(i32))
+declare("xft_tensor_materialize", handle)
+declare("xft_lazy_stats", P(i64), i64)
+declare("xft_lazy_reset_stats")
+declare("xft_lazy_plan_stats", handle, P(i64), i64)
+declare("xft_lazy_plan_memory", P(i64), P(i64), P(i64), i64, i64, P(i64), P(i64))
+
+# ---- autograd (csrc/api/autograd_api.cpp) ----
+declare("xft_tensor_requires_grad", handle, P(i32))
+declare("xft_tensor_set_requires_grad", handle, i32)
+declare("xft_tensor_is_leaf", handle, P(i32))
+declare("xft_tensor_grad", handle, P(handle))
+declare("xft_tensor_set_grad", handle, handle)
+declare("xft_tensor_grad_fn_name", handle, P(ctypes.c_char_p))
+declare("xft_tensor_detach", handle, P(handle))
+declare("xft_backward", handle, handle, i32)
+declare("xft_set_grad_enabled", i32)
+declare("xft_is_grad_enabled", P(i32))
+declare("xft_set_inference_mode", i32)
+declare("xft_is_inference_mode_enabled", P(i32))
+declare("xft_tensor_is_inference", handle, P(i32))
+
+SEGMENT_FN = ctypes.CFUNCTYPE(
+    ctypes.c_int, voidp, P(handle), i64, P(handle), i64, P(i64)
+)
+RELEASE_FN = ctypes.CFUNCTYPE(None, voidp)
+CHECKPOINT_MAX_OUTPUTS = 64
+declare("xft_checkpoint", SEGMENT_FN, RELEASE_FN, voidp, P(handle), i64, P(handle), i64, P(i64))
@@ -0,0 +1,89 @@
+"""xft: simple deep-learning framework."""
+
+from .autograd import (
+    checkpoint,
+    enable_grad,
+    inference_mode,
+    is_grad_enabled,
+    is_inference_mode_enabled,
+    no_grad,
+    set_grad_enabled,
+)
+from .device import device
+from .dtypes import (
+    bfloat16,
+    bool_,
+    dtype,
+    float16,
+    float32,
+    float64,
+    int8,
+    int32,
+    int64,
+    uint8,
+)
+from .tensor import (
+    Tensor,
+    add,
+    amax,
+    arange,
+    bias_dropout_residual,
+    bias_gelu,
+    bmm,
+    channels_last,
+    contiguous_format,
+    cpu_capability,
+    div,
+    dropout,
+    empty,
+    exp,
+    full,
+    gelu,
+    get_num_threads,
+    get_rng_state,
+    layer_norm,
+    log,
+    manual_seed,
+    matmul,
+    maximum,
+    mean,
+    memory_format,
+    minimum,
+    mm,
+    mul,
+    ones,
+    rand,
+    randn,
+    relu,
+    rms_norm,
+    set_num_threads,
+    set_rng_state,
+    sigmoid,
+    softmax,
+    sqrt,
+    sub,
+    sum,
+    tanh,
+    tensor,
+    zeros,
+)
+
+from .lazy import lazy_mode
+from .serialization import load, save
+
+from . import (
+    amp,
+    autograd,
+    autotune,
+    cuda,
+    data,
+    distributed,
+    kv_cache,
+    lazy,
+    nn,
+    optim,
+    profiler,
+    quantization,
+    serialization,
+    streaming,
+)
@@ -0,0 +1,180 @@
+"""Automatic mixed precision: autocast regions and dynamic loss scaling.
+
+The cast policy itself lives in csrc/core/autocast.h; this module only flips
+the per-thread switches and drives GradScaler's unscale-and-check kernel.
+"""
+
+import ctypes
+import functools
+
+from . import _C
+from . import dtypes as _dtype
+from .device import device as _device
+
+
+def is_autocast_enabled(device_type="cuda"):
+    dev = _device(device_type)
+    return bool(_C.call_out("xft_autocast_is_enabled", dev.type, out_type=_C.i32))
+
+
+def get_autocast_dtype(device_type="cuda"):
+    dev = _device(device_type)
+    return _dtype.from_code(_C.call_out("xft_autocast_get_dtype", dev.type, out_type=_C.i32))
+
+
+class autocast:
+    """Context manager / decorator: inside it, ops on `device_type` tensors
+    run in mixed precision on this thread.
+
+    matmul, mm, bmm and scaled_dot_product_attention cast float32 inputs to
+    `dtype` (float16 on CUDA and bfloat16 on CPU unless set); sum, mean,
+    softmax, exp, log and the norms run 16-bit inputs in float32; binary ops
+    promote mixed inputs. The casts are recorded, so gradients come back in
+    each leaf's own dtype. Regions nest and restore the outer state on exit.
+    """
+
+    def __init__(self, device_type="cuda", dtype=None, enabled=True):
+        self._type = _device(device_type).type
+        self._dtype = dtype
+        self._enabled = enabled
+
+    def __enter__(self):
+        self._prev_enabled = _C.call_out("xft_autocast_is_enabled", self._type, out_type=_C.i32)
+        self._prev_dtype = _C.call_out("xft_autocast_get_dtype", self._type, out_type=_C.i32)
+        if self._dtype is not None:
+            _C.call("xft_autocast_set_dtype", self._type, self._dtype.code)
+        _C.call("xft_autocast_set_enabled", self._type, int(bool(self._enabled)))
+        return self
+
+    def __exit__(self, *exc):
+        _C.call("xft_autocast_set_enabled", self._type, self._prev_enabled)
+        _C.call("xft_autocast_set_dtype", self._type, self._prev_dtype)
+        return False
+
+    def __call__(self, fn):
+        @functools.wraps(fn)
+        def wrapper(*args, **kwargs):
+            with autocast(self._type, self._dtype, self._enabled):
+                return fn(*args, **kwargs)
+
+        return wrapper
+
+
+def _parameters(optimizer):
+    """An optimizer's parameters (its `params`), or the iterable itself."""
+    return list(getattr(optimizer, "params", optimizer))
+
+
+class GradScaler:
+    """Dynamic loss scaling for float16 training.
+
+    Small float16 gradients underflow to zero; scaling the loss by S before
+    backward scales every gradient by S too, and unscale_ divides it back out
+    in float just before the optimizer runs. When any gradient overflowed to
+    inf or NaN the step is skipped and S is multiplied by backoff_factor;
+    after growth_interval clean steps in a row it grows by growth_factor.
+
+        scaler = GradScaler()
+        with autocast("cuda"):
+            loss = model(x)
+        scaler.scale(loss).backward()
+        scaler.step(optimizer)
+        scaler.update()
+
+    `optimizer` is anything with a `params` list and a `step()` method. With
+    enabled=False every method passes straight through.
+    """
+
+    def __init__(
+        self,
+        init_scale=2.0**16,
+        growth_factor=2.0,
+        backoff_factor=0.5,
+        growth_interval=2000,
+        enabled=True,
+    ):
+        if growth_factor <= 1.0:
+            raise ValueError("growth_factor must be > 1")
+        if not 0.0 < backoff_factor < 1.0:
+            raise ValueError("backoff_factor must be in (0, 1)")
+        self._scale = float(init_scale)
+        self._growth_factor = growth_factor
+        self._backoff_factor = backoff_factor
+        self._growth_interval = growth_interval
+        self._growth_tracker = 0
+        self._enabled = enabled
+        # Per-optimizer results of this iteration's unscale_, keyed by id().
+        self._found_inf = {}
+
+    def is_enabled(self):
+        return self._enabled
+
+    def get_scale(self):
+        return self._scale if self._enabled else 1.0
+
+    def scale(self, loss):
+        """Returns loss * scale, the tensor to call backward() on."""
+        if not self._enabled:
+            return loss
+        return loss * self._scale
+
+    def unscale_(self, optimizer):
+        """Divides the optimizer's gradients by the scale in place, e.g. to
+        clip them before step(). At most once per optimizer per iteration."""
+        if not self._enabled:
+            return
+        key = id(optimizer)
+        if key in self._found_inf:
+            raise RuntimeError("unscale_() was already called on this optimizer since update()")
+        grads = [p.grad for p in _parameters(optimizer)]
+        grads = [g for g in grads if g is not None]
+        arr = (_C.handle * max(len(grads), 1))(*[g._h for g in grads])
+        found = ctypes.c_int32()
+        _C.call("xft_amp_unscale_", arr, len(grads), 1.0 / self._scale, ctypes.byref(found))
+        self._found_inf[key] = bool(found.value)
+
+    def step(self, optimizer, *args, **kwargs):
+        """Unscales (if unscale_ was not called) and runs optimizer.step()
+        unless a gradient is inf or NaN. Returns step()'s result, or None
+        when the step was skipped."""
+        if not self._enabled:
+            return optimizer.step(*args, **kwargs)
+        if id(optimizer) not in self._found_inf:
+            self.unscale_(optimizer)
+        if self._found_inf[id(optimizer)]:
+            return None
+        return optimizer.step(*args, **kwargs)
+
+    def update(self, new_scale=None):
+        """Adjusts the scale from this iteration's steps, or sets it to
+        new_scale; call once per iteration after every step()."""
+        if not self._enabled:
+            return
+        if new_scale is not None:
+            self._scale = float(new_scale)
+            self._growth_tracker = 0
+        elif any(self._found_inf.values()):
+            self._scale *= self._backoff_factor
+            self._growth_tracker = 0
+        elif self._found_inf:
+            self._growth_tracker += 1
+            if self._growth_tracker == self._growth_interval:
+                self._scale *= self._growth_factor
+                self._growth_tracker = 0
+        self._found_inf = {}
+
+    def state_dict(self):
+        return {
+            "scale": self._scale,
+            "growth_factor": self._growth_factor,
+            "backoff_factor": self._backoff_factor,
+            "growth_interval": self._growth_interval,
+            "growth_tracker": self._growth_tracker,
+        }
+
+    def load_state_dict(self, state):
+        self._scale = float(state["scale"])
+        self._growth_factor = state["growth_factor"]
+        self._backoff_factor = state["backoff_factor"]
+        self._growth_interval = state["growth_interval"]
+        self._growth_tracker = state["growth_tracker"]
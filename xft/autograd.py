@@ -0,0 +1,184 @@
+"""Grad-mode switches and checkpointing. Recording and backward are done by
+csrc/autograd."""
+
+import ctypes
+import functools
+import itertools
+
+from . import _C
+from .tensor import Tensor
+
+
+def is_grad_enabled():
+    return bool(_C.call_out("xft_is_grad_enabled", out_type=_C.i32))
+
+
+class set_grad_enabled:
+    """Sets grad mode for this thread; also usable as a context manager,
+    which restores the previous mode on exit."""
+
+    def __init__(self, mode):
+        self._prev = is_grad_enabled()
+        _C.call("xft_set_grad_enabled", int(bool(mode)))
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        _C.call("xft_set_grad_enabled", int(self._prev))
+        return False
+
+
+class _GradModeContext:
+    _mode = True
+
+    def __enter__(self):
+        self._prev = is_grad_enabled()
+        _C.call("xft_set_grad_enabled", int(self._mode))
+        return self
+
+    def __exit__(self, *exc):
+        _C.call("xft_set_grad_enabled", int(self._prev))
+        return False
+
+    def __call__(self, fn):
+        @functools.wraps(fn)
+        def wrapper(*args, **kwargs):
+            with self.__class__():
+                return fn(*args, **kwargs)
+
+        return wrapper
+
+
+class no_grad(_GradModeContext):
+    """Context manager / decorator: ops inside record no graph."""
+
+    _mode = False
+
+
+class enable_grad(_GradModeContext):
+    """Context manager / decorator that turns recording back on."""
+
+    _mode = True
+
+
+def is_inference_mode_enabled():
+    return bool(_C.call_out("xft_is_inference_mode_enabled", out_type=_C.i32))
+
+
+class inference_mode:
+    """Context manager / decorator for code that never calls backward.
+
+    Grad mode is off inside. Tensors allocated in it are inference tensors
+    (Tensor.is_inference()): they can never require grad or be saved for
+    backward, so no graph keeps them alive. Elementwise ops write over the
+    casts they make of their own inputs instead of allocating again; use
+    out= or the in-place methods (relu_(), add_(), ...) to recycle your own
+    intermediates the same way. inference_mode(False) turns it off for a
+    nested block.
+    """
+
+    def __init__(self, mode=True):
+        self._mode = bool(mode)
+
+    def __enter__(self):
+        self._prev = (is_inference_mode_enabled(), is_grad_enabled())
+        _C.call("xft_set_inference_mode", int(self._mode))
+        return self
+
+    def __exit__(self, *exc):
+        _C.call("xft_set_inference_mode", int(self._prev[0]))
+        _C.call("xft_set_grad_enabled", int(self._prev[1]))
+        return False
+
+    def __call__(self, fn):
+        @functools.wraps(fn)
+        def wrapper(*args, **kwargs):
+            with inference_mode(self._mode):
+                return fn(*args, **kwargs)
+
+        return wrapper
+
+
+# ---- checkpointing (csrc/autograd/checkpoint.h) ----
+class _Segment:
+    def __init__(self, fn, args, tensor_pos):
+        self.fn = fn
+        # Tensor arguments arrive through the callback; keep only the rest.
+        self.args = [None if i in tensor_pos else a for i, a in enumerate(args)]
+        self.tensor_pos = tensor_pos
+        self.single = False
+
+    def __call__(self, tensors):
+        args = list(self.args)
+        for pos, t in zip(self.tensor_pos, tensors):
+            args[pos] = t
+        return self.fn(*args)
+
+
+_segments = {}
+_segment_ids = itertools.count(1)
+
+
+def _run_segment(ctx, inputs, n_inputs, outputs, max_outputs, n_outputs):
+    try:
+        seg = _segments[ctx]
+        # The core hands over ownership of the input handles.
+        tensors = [
+            Tensor(_C.handle(inputs[i].value)) if inputs[i] else None for i in range(n_inputs)
+        ]
+        result = seg(tensors)
+        seg.single = isinstance(result, Tensor)
+        outs = [result] if seg.single else list(result)
+        if len(outs) > max_outputs:
+            raise ValueError("checkpoint: at most %d outputs are supported" % max_outputs)
+        for i, t in enumerate(outs):
+            if not isinstance(t, Tensor):
+                raise TypeError("checkpoint: fn must return a tensor or a sequence of tensors")
+            outputs[i] = _C.call_out("xft_tensor_new_handle", t._h)
+        n_outputs[0] = len(outs)
+        return 0
+    except BaseException as e:  # re-raised by _C.call once the core unwinds
+        _C.set_callback_error(e)
+        return -1
+
+
+def _release_segment(ctx):
+    _segments.pop(ctx, None)
+
+
+# Module-level so ctypes keeps the trampolines alive.
+_run_segment_cb = _C.SEGMENT_FN(_run_segment)
+_release_segment_cb = _C.RELEASE_FN(_release_segment)
+
+
+def checkpoint(fn, *args):
+    """Runs fn(*args) without keeping its intermediate activations.
+
+    Backward recomputes the segment from its tensor arguments, with the random
+    generators rewound so dropout draws the same masks, and then
+    backpropagates through it. Use it on blocks whose activations dominate
+    memory: they cost one extra forward in exchange. At least one tensor
+    argument should require grad, or nothing in the segment is recorded.
+    Returns what fn returns: a tensor or a tuple of tensors.
+    """
+    tensor_pos = [i for i, a in enumerate(args) if isinstance(a, Tensor)]
+    key = next(_segment_ids)
+    seg = _segments[key] = _Segment(fn, args, tensor_pos)
+    n = len(tensor_pos)
+    inputs = (_C.handle * max(n, 1))(*[args[i]._h for i in tensor_pos])
+    outputs = (_C.handle * _C.CHECKPOINT_MAX_OUTPUTS)()
+    count = _C.i64()
+    _C.call(
+        "xft_checkpoint",
+        _run_segment_cb,
+        _release_segment_cb,
+        key,
+        inputs,
+        n,
+        outputs,
+        _C.CHECKPOINT_MAX_OUTPUTS,
+        ctypes.byref(count),
+    )
+    result = [Tensor(_C.handle(outputs[i].value)) for i in range(count.value)]
+    return result[0] if seg.single else tuple(result)
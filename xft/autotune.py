@@ -0,0 +1,52 @@
+"""Per-shape kernel autotuning (csrc/core/autotune.h).
+
+The GEMM, convolution and reduction kernels come in several tilings, and no
+one of them is fastest for every shape. The first time a large enough
+problem of a new shape runs, each tiling is timed on it and the fastest is
+kept, keyed by the hardware, op, dtype and shape. Winners are appended to a
+cache file, so later runs and other processes skip the timing:
+
+    xft.autotune.cache_path()             # ~/.cache/xft/autotune.txt
+    xft.autotune.set_enabled(False)       # heuristic defaults only
+
+The environment variables XFT_AUTOTUNE=0 and XFT_AUTOTUNE_CACHE=<path> set
+the same things at startup.
+"""
+
+import ctypes
+
+from . import _C
+
+_C.declare("xft_autotune_set_enabled", _C.i32)
+_C.declare("xft_autotune_is_enabled", _C.P(_C.i32))
+_C.declare("xft_autotune_set_cache_path", ctypes.c_char_p)
+_C.declare("xft_autotune_cache_path", _C.P(ctypes.c_char_p))
+_C.declare("xft_autotune_clear", _C.i32)
+
+
+def is_enabled():
+    return bool(_C.call_out("xft_autotune_is_enabled", out_type=_C.i32))
+
+
+def set_enabled(enabled):
+    """While off, every kernel runs its default tiling and the cache is not
+    consulted."""
+    _C.call("xft_autotune_set_enabled", int(bool(enabled)))
+
+
+def cache_path():
+    """The cache file, or None when winners are kept in memory only."""
+    path = _C.call_out("xft_autotune_cache_path", out_type=ctypes.c_char_p).decode()
+    return path or None
+
+
+def set_cache_path(path):
+    """Reads winners from (and appends new ones to) `path` from now on;
+    None keeps them in memory only."""
+    _C.call("xft_autotune_set_cache_path", ("" if path is None else str(path)).encode())
+
+
+def clear(remove_file=False):
+    """Forgets the winners found so far, so shapes are timed again; with
+    remove_file the cache file is deleted as well."""
+    _C.call("xft_autotune_clear", int(bool(remove_file)))
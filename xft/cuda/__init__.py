@@ -0,0 +1,35 @@
+"""CUDA device management, streams, graphs and the caching allocator."""
+
+import ctypes
+
+from .. import _C
+from .graphs import CUDAGraph, GraphedCallable, graph, graph_pool_handle, make_graphed_callable
+from .memory import (
+    empty_cache,
+    host_empty_cache,
+    host_memory_stats,
+    max_memory_allocated,
+    max_memory_reserved,
+    memory_allocated,
+    memory_reserved,
+    memory_stats,
+    reset_peak_memory_stats,
+)
+from .streams import Event, Stream, current_stream, default_stream, set_stream, stream
+
+_C.declare("xft_cuda_is_available", _C.P(_C.i32))
+_C.declare("xft_cuda_device_count", _C.P(_C.i32))
+_C.declare("xft_cuda_synchronize", _C.i32)
+
+
+def is_available():
+    return bool(_C.call_out("xft_cuda_is_available", out_type=_C.i32))
+
+
+def device_count():
+    return _C.call_out("xft_cuda_device_count", out_type=_C.i32)
+
+
+def synchronize(device=0):
+    """Waits for all work on every stream of `device`."""
+    _C.call("xft_cuda_synchronize", device)
@@ -0,0 +1,153 @@
+"""CUDA graph capture and replay (csrc/cuda/graph.h).
+
+A graph records the kernels a region enqueues, with their device addresses,
+and replays them with a single launch. Capture runs the region once without
+executing it; the tensors it reads and creates are the graph's static
+buffers. To run it again on new data, copy into the static inputs, replay()
+and read the static outputs, which are overwritten in place:
+
+    static_x = xft.zeros(8, 512, device="cuda")
+    s = xft.cuda.Stream()
+    s.wait_stream(xft.cuda.current_stream())
+    with s:                       # warm up outside the graph
+        model(static_x)
+    g = xft.cuda.CUDAGraph()
+    with xft.cuda.graph(g):
+        static_y = model(static_x)
+    static_x.copy_(batch)
+    g.replay()                    # static_y now holds model(batch)
+
+Memory allocated during capture comes from a private pool of the caching
+allocator and stays reserved while the graph exists. The captured region
+must not synchronize with the host (no item(), tolist() or device-to-host
+copies) and must not change shapes between replays.
+"""
+
+from .. import _C
+from .streams import Stream, current_stream
+
+_C.declare("xft_cuda_graph_create", _C.P(_C.voidp))
+_C.declare("xft_cuda_graph_destroy", _C.voidp)
+_C.declare("xft_cuda_graph_capture_begin", _C.voidp, _C.i32, _C.u64)
+_C.declare("xft_cuda_graph_capture_end", _C.voidp)
+_C.declare("xft_cuda_graph_replay", _C.voidp)
+_C.declare("xft_cuda_graph_reset", _C.voidp)
+_C.declare("xft_cuda_graph_pool", _C.voidp, _C.P(_C.u64))
+_C.declare("xft_cuda_graph_pool_handle", _C.P(_C.u64))
+
+
+def graph_pool_handle():
+    """A fresh memory pool id, for graphs that should share one pool. Only
+    share a pool between graphs that never replay concurrently."""
+    return _C.call_out("xft_cuda_graph_pool_handle", out_type=_C.u64)
+
+
+class CUDAGraph:
+    """A captured CUDA graph. Usually captured through `xft.cuda.graph`."""
+
+    def __init__(self):
+        self._ptr = _C.call_out("xft_cuda_graph_create", out_type=_C.voidp)
+
+    def __del__(self):
+        if getattr(self, "_ptr", None) is not None and _C.lib is not None:
+            _C.lib.xft_cuda_graph_destroy(self._ptr)
+
+    def capture_begin(self, pool=None, device=0):
+        """Starts capturing the current stream of `device`, which must not
+        be the default stream."""
+        _C.call("xft_cuda_graph_capture_begin", self._ptr, device, pool or 0)
+
+    def capture_end(self):
+        _C.call("xft_cuda_graph_capture_end", self._ptr)
+
+    def replay(self):
+        """Launches the captured work on the current stream."""
+        _C.call("xft_cuda_graph_replay", self._ptr)
+
+    def reset(self):
+        """Frees the graph; it can then be captured again."""
+        _C.call("xft_cuda_graph_reset", self._ptr)
+
+    def pool(self):
+        """The graph's memory pool id, to pass to another capture."""
+        return _C.call_out("xft_cuda_graph_pool", self._ptr, out_type=_C.u64)
+
+
+class graph:
+    """Context manager capturing its body into `cuda_graph`.
+
+    The body runs on `stream` (a new side stream by default) after it has
+    waited for the current stream, so tensors prepared before the region are
+    ready; the previous stream is current again afterwards.
+    """
+
+    def __init__(self, cuda_graph, pool=None, stream=None, device=0):
+        self.cuda_graph = cuda_graph
+        self.pool = pool
+        self.device = device
+        self.stream = stream
+
+    def __enter__(self):
+        if self.stream is None:
+            self.stream = Stream(self.device)
+        self.stream.wait_stream(current_stream(self.device))
+        self.stream.__enter__()
+        try:
+            self.cuda_graph.capture_begin(self.pool, self.device)
+        except BaseException:
+            self.stream.__exit__(None, None, None)
+            raise
+        return self
+
+    def __exit__(self, exc_type, *exc):
+        try:
+            self.cuda_graph.capture_end()
+        except Exception:
+            # The body's own error explains more than the broken capture.
+            if exc_type is None:
+                raise
+        finally:
+            prev = self.stream._prev[-1]
+            self.stream.__exit__(None, None, None)
+            # Later work on the outer stream may read the static outputs.
+            prev.wait_stream(self.stream)
+        return False
+
+
+class GraphedCallable:
+    """`fn` captured once over static copies of its sample inputs. Calling
+    it copies the arguments into those buffers, replays the graph and
+    returns the static outputs, overwritten on every call."""
+
+    def __init__(self, fn, sample_args, warmup_iters=3, pool=None, device=0):
+        self.static_inputs = tuple(a.clone() for a in sample_args)
+        side = Stream(device)
+        side.wait_stream(current_stream(device))
+        # Warm-up runs initialize whatever the first call sets up (lazy
+        # compilation, cached blocks) outside the graph.
+        with side:
+            for _ in range(warmup_iters):
+                fn(*self.static_inputs)
+        current_stream(device).wait_stream(side)
+        self.graph = CUDAGraph()
+        with graph(self.graph, pool=pool, stream=side, device=device):
+            out = fn(*self.static_inputs)
+        self._single = not isinstance(out, (tuple, list))
+        self.static_outputs = (out,) if self._single else tuple(out)
+
+    def __call__(self, *args):
+        if len(args) != len(self.static_inputs):
+            raise TypeError(
+                "expected %d inputs, got %d" % (len(self.static_inputs), len(args))
+            )
+        for static, a in zip(self.static_inputs, args):
+            if a is not static:
+                static.copy_(a)
+        self.graph.replay()
+        return self.static_outputs[0] if self._single else self.static_outputs
+
+
+def make_graphed_callable(fn, sample_args, warmup_iters=3, pool=None, device=0):
+    """Captures fn(*sample_args) into a graph; see GraphedCallable. For
+    fixed-shape inference: autograd state is not carried across replays."""
+    return GraphedCallable(fn, sample_args, warmup_iters, pool, device)
@@ -0,0 +1,74 @@
+"""Caching allocator introspection (csrc/cuda/caching_allocator.h)."""
+
+from .. import _C
+
+# Field order of xft::cuda::MemoryStats.
+_STAT_NAMES = (
+    "allocated_bytes",
+    "reserved_bytes",
+    "peak_allocated_bytes",
+    "peak_reserved_bytes",
+    "num_allocs",
+    "num_frees",
+    "num_cache_hits",
+    "num_device_mallocs",
+    "num_device_frees",
+    "num_ooms",
+)
+
+# Field order of xft::cuda::HostMemoryStats.
+_HOST_STAT_NAMES = (
+    "allocated_bytes",
+    "reserved_bytes",
+    "num_allocs",
+    "num_cache_hits",
+    "num_pending",
+)
+
+_C.declare("xft_cuda_empty_cache")
+_C.declare("xft_cuda_host_empty_cache")
+_C.declare("xft_cuda_host_memory_stats", _C.P(_C.i64), _C.i64)
+_C.declare("xft_cuda_memory_stats", _C.i32, _C.P(_C.i64), _C.i64)
+_C.declare("xft_cuda_reset_peak_memory_stats", _C.i32)
+
+
+def empty_cache():
+    """Releases cached, unused blocks back to the driver."""
+    _C.call("xft_cuda_empty_cache")
+
+
+def memory_stats(device=0):
+    buf = (_C.i64 * len(_STAT_NAMES))()
+    _C.call("xft_cuda_memory_stats", device, buf, len(_STAT_NAMES))
+    return dict(zip(_STAT_NAMES, buf))
+
+
+def memory_allocated(device=0):
+    return memory_stats(device)["allocated_bytes"]
+
+
+def memory_reserved(device=0):
+    return memory_stats(device)["reserved_bytes"]
+
+
+def max_memory_allocated(device=0):
+    return memory_stats(device)["peak_allocated_bytes"]
+
+
+def max_memory_reserved(device=0):
+    return memory_stats(device)["peak_reserved_bytes"]
+
+
+def reset_peak_memory_stats(device=0):
+    _C.call("xft_cuda_reset_peak_memory_stats", device)
+
+
+def host_empty_cache():
+    """Releases cached pinned host blocks whose copies have completed."""
+    _C.call("xft_cuda_host_empty_cache")
+
+
+def host_memory_stats():
+    buf = (_C.i64 * len(_HOST_STAT_NAMES))()
+    _C.call("xft_cuda_host_memory_stats", buf, len(_HOST_STAT_NAMES))
+    return dict(zip(_HOST_STAT_NAMES, buf))
@@ -0,0 +1,161 @@
+"""CUDA streams and events.
+
+Every CUDA op in xft enqueues on the current stream of its device, which is
+per thread and defaults to the legacy default stream. `with stream:` makes a
+stream current for the block; Events order work across streams.
+"""
+
+import ctypes
+
+from .. import _C
+
+_C.declare("xft_cuda_stream_create", _C.i32, _C.i32, _C.P(_C.voidp))
+_C.declare("xft_cuda_stream_destroy", _C.voidp)
+_C.declare("xft_cuda_current_stream", _C.i32, _C.P(_C.voidp))
+_C.declare("xft_cuda_set_current_stream", _C.i32, _C.voidp)
+_C.declare("xft_cuda_stream_synchronize", _C.voidp)
+_C.declare("xft_cuda_stream_query", _C.voidp, _C.P(_C.i32))
+_C.declare("xft_cuda_stream_wait_event", _C.voidp, _C.voidp)
+_C.declare("xft_cuda_event_create", _C.i32, _C.i32, _C.P(_C.voidp))
+_C.declare("xft_cuda_event_destroy", _C.voidp)
+_C.declare("xft_cuda_event_record", _C.voidp, _C.voidp)
+_C.declare("xft_cuda_event_synchronize", _C.voidp)
+_C.declare("xft_cuda_event_query", _C.voidp, _C.P(_C.i32))
+_C.declare("xft_cuda_event_elapsed_time", _C.voidp, _C.voidp, _C.P(ctypes.c_float))
+_C.declare("xft_tensor_record_stream", _C.handle, _C.voidp)
+
+
+class Stream:
+    """A CUDA stream on `device`. Lower priority numbers run first."""
+
+    def __init__(self, device=0, priority=0):
+        self.device = device
+        self._ptr = _C.call_out("xft_cuda_stream_create", device, priority, out_type=_C.voidp)
+        self._owned = True
+        self._prev = []
+
+    @classmethod
+    def _wrap(cls, device, ptr):
+        """A non-owning Stream around an existing cudaStream_t."""
+        s = cls.__new__(cls)
+        s.device, s._ptr, s._owned, s._prev = device, ptr, False, []
+        return s
+
+    def __del__(self):
+        if getattr(self, "_owned", False) and _C.lib is not None:
+            _C.lib.xft_cuda_stream_destroy(self._ptr)
+
+    @property
+    def cuda_stream(self):
+        """The raw cudaStream_t, as an int (0 for the default stream)."""
+        return self._ptr or 0
+
+    def synchronize(self):
+        _C.call("xft_cuda_stream_synchronize", self._ptr)
+
+    def query(self):
+        return bool(_C.call_out("xft_cuda_stream_query", self._ptr, out_type=_C.i32))
+
+    def wait_event(self, event):
+        """Makes future work on this stream wait for `event`."""
+        if event._ptr is not None:
+            _C.call("xft_cuda_stream_wait_event", self._ptr, event._ptr)
+
+    def wait_stream(self, stream):
+        """Makes future work on this stream wait for work already on `stream`."""
+        self.wait_event(stream.record_event())
+
+    def record_event(self, event=None):
+        event = event or Event()
+        event.record(self)
+        return event
+
+    def __enter__(self):
+        self._prev.append(current_stream(self.device))
+        _C.call("xft_cuda_set_current_stream", self.device, self._ptr)
+        return self
+
+    def __exit__(self, *exc):
+        _C.call("xft_cuda_set_current_stream", self.device, self._prev.pop()._ptr)
+        return False
+
+    def __eq__(self, other):
+        return isinstance(other, Stream) and self.cuda_stream == other.cuda_stream
+
+    def __hash__(self):
+        return hash((self.device, self.cuda_stream))
+
+    def __repr__(self):
+        return "<xft.cuda.Stream device=%d cuda_stream=0x%x>" % (self.device, self.cuda_stream)
+
+
+class Event:
+    """A CUDA event. Created lazily on the device of the first stream it is recorded on."""
+
+    def __init__(self, enable_timing=False):
+        self.enable_timing = enable_timing
+        self._ptr = None
+
+    def __del__(self):
+        if self._ptr is not None and _C.lib is not None:
+            _C.lib.xft_cuda_event_destroy(self._ptr)
+
+    def record(self, stream=None):
+        stream = stream or current_stream()
+        if self._ptr is None:
+            self._ptr = _C.call_out(
+                "xft_cuda_event_create", stream.device, int(self.enable_timing), out_type=_C.voidp
+            )
+        _C.call("xft_cuda_event_record", self._ptr, stream._ptr)
+
+    def wait(self, stream=None):
+        (stream or current_stream()).wait_event(self)
+
+    def query(self):
+        if self._ptr is None:
+            return True
+        return bool(_C.call_out("xft_cuda_event_query", self._ptr, out_type=_C.i32))
+
+    def synchronize(self):
+        if self._ptr is not None:
+            _C.call("xft_cuda_event_synchronize", self._ptr)
+
+    def elapsed_time(self, end):
+        """Milliseconds between this event and `end`; both must have timing enabled."""
+        return _C.call_out(
+            "xft_cuda_event_elapsed_time", self._ptr, end._ptr, out_type=ctypes.c_float
+        )
+
+
+def current_stream(device=0):
+    ptr = _C.call_out("xft_cuda_current_stream", device, out_type=_C.voidp)
+    return Stream._wrap(device, ptr)
+
+
+def default_stream(device=0):
+    return Stream._wrap(device, None)
+
+
+def set_stream(stream):
+    _C.call("xft_cuda_set_current_stream", stream.device, stream._ptr)
+
+
+class stream:
+    """Context manager form of `with s:` that also accepts None (no-op)."""
+
+    def __init__(self, s):
+        self.s = s
+
+    def __enter__(self):
+        if self.s is not None:
+            self.s.__enter__()
+        return self.s
+
+    def __exit__(self, *exc):
+        if self.s is not None:
+            self.s.__exit__(*exc)
+        return False
+
+
+def record_stream(tensor, s):
+    _C.call("xft_tensor_record_stream", tensor._h, s._ptr)
@@ -0,0 +1,408 @@
+"""Batched data loading with worker processes (csrc/core/shared_memory.h).
+
+A DataLoader turns a dataset (anything with __len__ and __getitem__) into
+batches. With num_workers > 0, worker processes fetch and collate samples
+and write each batch straight into shared-memory tensors; only segment
+names travel through the result queue, and the main process maps the same
+pages, so batches are never pickled or copied on the way. Up to
+prefetch_factor batches per worker are requested ahead of the one being
+consumed.
+
+With device="cuda", batches are also copied to the GPU ahead of use:
+through pinned staging memory, asynchronously on a side stream that the
+consumer's current stream waits on.
+
+    loader = xft.data.DataLoader(dataset, batch_size=64, shuffle=True,
+                                 num_workers=4, device="cuda")
+    for x, y in loader:
+        ...
+"""
+
+import ctypes
+import multiprocessing
+import queue
+import random
+import traceback
+
+from . import _C
+from . import dtypes as _dtype
+from .device import device as _device
+from .tensor import Tensor, empty, manual_seed, set_num_threads, tensor
+
+_C.declare("xft_tensor_empty_shared", _C.P(_C.i64), _C.i64, _C.i32, _C.P(_C.handle))
+_C.declare("xft_tensor_shared_name", _C.handle, _C.P(ctypes.c_char_p))
+_C.declare(
+    "xft_tensor_open_shared", ctypes.c_char_p, _C.P(_C.i64), _C.i64, _C.i32, _C.i32,
+    _C.P(_C.handle),
+)
+_C.declare("xft_unlink_shared", ctypes.c_char_p)
+
+# Seconds between checks that the workers are still alive.
+_POLL_INTERVAL = 5.0
+
+
+def empty_shared(*shape, dtype=_dtype.float32):
+    """A CPU tensor in a new POSIX shared-memory segment."""
+    if len(shape) == 1 and isinstance(shape[0], (tuple, list)):
+        shape = tuple(shape[0])
+    arr, n = _C.int64_array(shape)
+    return Tensor(_C.call_out("xft_tensor_empty_shared", arr, n, dtype.code))
+
+
+def shared_name(t):
+    """The shared-memory segment behind `t`, or None."""
+    name = _C.call_out("xft_tensor_shared_name", t._h, out_type=ctypes.c_char_p)
+    return name.decode() if name else None
+
+
+class Dataset:
+    """Map-style dataset: subclasses implement __getitem__ and __len__."""
+
+    def __getitem__(self, index):
+        raise NotImplementedError
+
+    def __len__(self):
+        raise NotImplementedError
+
+
+class TensorDataset(Dataset):
+    """Samples are the index-th rows of tensors sharing their first dim."""
+
+    def __init__(self, *tensors):
+        if not tensors or any(t.shape[:1] != tensors[0].shape[:1] for t in tensors):
+            raise ValueError("TensorDataset: tensors must share their first dim")
+        self.tensors = tensors
+
+    def __getitem__(self, index):
+        return tuple(t[index] for t in self.tensors)
+
+    def __len__(self):
+        return self.tensors[0].shape[0]
+
+
+# Set in worker processes: default_collate then allocates its batches in
+# shared memory.
+_in_worker = False
+
+
+def _alloc(shape, dtype):
+    if _in_worker:
+        return empty_shared(shape, dtype=dtype)
+    return empty(*shape, dtype=dtype)
+
+
+def default_collate(samples):
+    """Stacks a list of samples into a batch: tensors gain a leading batch
+    dim, Python numbers become 1-D tensors, and tuples, lists and dicts are
+    collated field by field. Anything else is returned as a list."""
+    first = samples[0]
+    if isinstance(first, Tensor):
+        out = _alloc((len(samples),) + first.shape, first.dtype)
+        for i, s in enumerate(samples):
+            if s.shape != first.shape:
+                raise ValueError(
+                    "default_collate: samples have shapes %s and %s" % (first.shape, s.shape)
+                )
+            out.select(0, i).copy_(s.detach())
+        return out
+    if isinstance(first, (bool, int, float)):
+        values = tensor(list(samples))
+        out = _alloc(values.shape, values.dtype)
+        out.copy_(values)
+        return out
+    if isinstance(first, dict):
+        return {k: default_collate([s[k] for s in samples]) for k in first}
+    if isinstance(first, (tuple, list)):
+        fields = [default_collate(list(f)) for f in zip(*samples)]
+        return tuple(fields) if isinstance(first, tuple) else fields
+    return list(samples)
+
+
+def _map_tensors(fn, obj):
+    if isinstance(obj, Tensor):
+        return fn(obj)
+    if isinstance(obj, dict):
+        return {k: _map_tensors(fn, v) for k, v in obj.items()}
+    if isinstance(obj, (tuple, list)):
+        return type(obj)(_map_tensors(fn, v) for v in obj)
+    return obj
+
+
+class _SharedRef:
+    """A shared-memory tensor in transit: what a worker puts on the queue."""
+
+    __slots__ = ("name", "shape", "dtype")
+
+    def __init__(self, name, shape, dtype):
+        self.name, self.shape, self.dtype = name, shape, dtype
+
+    def __getstate__(self):
+        return (self.name, self.shape, self.dtype)
+
+    def __setstate__(self, state):
+        self.name, self.shape, self.dtype = state
+
+    def open(self):
+        arr, n = _C.int64_array(self.shape)
+        h = _C.call_out("xft_tensor_open_shared", self.name.encode(), arr, n, self.dtype, 1)
+        return Tensor(h)
+
+    def unlink(self):
+        _C.call("xft_unlink_shared", self.name.encode())
+
+
+def _to_ref(t):
+    if t.device.is_cuda:
+        raise RuntimeError("DataLoader workers must produce CPU tensors")
+    name = shared_name(t)
+    if name is None or not t.is_contiguous() or t.storage_offset() != 0:
+        # A batch collate_fn built itself: one copy into shared memory.
+        shared = empty_shared(t.shape, dtype=t.dtype)
+        shared.copy_(t.detach())
+        t, name = shared, shared_name(shared)
+    return _SharedRef(name, t.shape, t.dtype.code)
+
+
+def _unlink_refs(obj):
+    if isinstance(obj, _SharedRef):
+        obj.unlink()
+    elif isinstance(obj, dict):
+        for v in obj.values():
+            _unlink_refs(v)
+    elif isinstance(obj, (tuple, list)):
+        for v in obj:
+            _unlink_refs(v)
+
+
+def _open_refs(obj):
+    if isinstance(obj, _SharedRef):
+        return obj.open()
+    if isinstance(obj, dict):
+        return {k: _open_refs(v) for k, v in obj.items()}
+    if isinstance(obj, (tuple, list)):
+        return type(obj)(_open_refs(v) for v in obj)
+    return obj
+
+
+class _WorkerError:
+    def __init__(self, worker_id, text):
+        self.worker_id, self.text = worker_id, text
+
+
+def _worker_loop(dataset, index_queue, result_queue, collate_fn, worker_id, seed, init_fn):
+    global _in_worker
+    _in_worker = True
+    # The workers together keep the cores busy; intra-op threads would only
+    # oversubscribe them.
+    set_num_threads(1)
+    random.seed(seed)
+    manual_seed(seed)
+    if init_fn is not None:
+        init_fn(worker_id)
+    while True:
+        task = index_queue.get()
+        if task is None:
+            return
+        idx, indices = task
+        try:
+            batch = collate_fn([dataset[i] for i in indices])
+            result_queue.put((idx, _map_tensors(_to_ref, batch)))
+        except Exception:
+            result_queue.put((idx, _WorkerError(worker_id, traceback.format_exc())))
+
+
+class _MultiWorkerIter:
+    def __init__(self, loader, batches):
+        self._batches = batches
+        self._next = 0  # next batch to hand out
+        self._sent = 0  # batches dispatched to workers
+        self._ready = {}
+        ctx = loader.multiprocessing_context
+        if ctx is None or isinstance(ctx, str):
+            ctx = multiprocessing.get_context(ctx)
+        self._result_queue = ctx.Queue()
+        self._index_queues = []
+        self._workers = []
+        base_seed = random.getrandbits(32)
+        for w in range(loader.num_workers):
+            iq = ctx.Queue()
+            p = ctx.Process(
+                target=_worker_loop,
+                args=(loader.dataset, iq, self._result_queue, loader.collate_fn, w,
+                      base_seed + w, loader.worker_init_fn),
+                daemon=True,
+            )
+            p.start()
+            self._index_queues.append(iq)
+            self._workers.append(p)
+        self._shutdown = False
+        for _ in range(loader.prefetch_factor * loader.num_workers):
+            self._dispatch()
+
+    def _dispatch(self):
+        if self._sent < len(self._batches):
+            iq = self._index_queues[self._sent % len(self._index_queues)]
+            iq.put((self._sent, self._batches[self._sent]))
+            self._sent += 1
+
+    def _get(self):
+        while True:
+            try:
+                return self._result_queue.get(timeout=_POLL_INTERVAL)
+            except queue.Empty:
+                dead = [w for w, p in enumerate(self._workers) if not p.is_alive()]
+                if dead:
+                    self.shutdown()
+                    raise RuntimeError("DataLoader worker %d exited unexpectedly" % dead[0])
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        if self._next >= len(self._batches):
+            self.shutdown()
+            raise StopIteration
+        while self._next not in self._ready:
+            idx, payload = self._get()
+            self._ready[idx] = payload
+        payload = self._ready.pop(self._next)
+        self._next += 1
+        self._dispatch()
+        if isinstance(payload, _WorkerError):
+            self.shutdown()
+            raise RuntimeError(
+                "DataLoader worker %d raised:\n%s" % (payload.worker_id, payload.text)
+            )
+        return _open_refs(payload)
+
+    def shutdown(self):
+        if self._shutdown:
+            return
+        self._shutdown = True
+        for iq in self._index_queues:
+            iq.put(None)
+        for p in self._workers:
+            p.join(timeout=_POLL_INTERVAL)
+            if p.is_alive():
+                p.terminate()
+        # Batches nobody will open: remove their segments.
+        for payload in self._ready.values():
+            _unlink_refs(payload)
+        self._ready.clear()
+        while True:
+            try:
+                _, payload = self._result_queue.get_nowait()
+            except (queue.Empty, OSError, EOFError):
+                break
+            _unlink_refs(payload)
+
+    def __del__(self):
+        self.shutdown()
+
+
+def _single_process_iter(loader, batches):
+    for indices in batches:
+        yield loader.collate_fn([loader.dataset[i] for i in indices])
+
+
+class _DevicePrefetcher:
+    """Keeps up to `depth` batches in flight to a CUDA device: each is copied
+    through pinned staging on a side stream, and the consumer's stream waits
+    for the copy when the batch is handed out."""
+
+    def __init__(self, source, device, depth):
+        from . import cuda
+
+        self._cuda = cuda
+        self._source = source
+        self._device = device
+        self._stream = cuda.Stream(device.index)
+        self._pending = []
+        for _ in range(depth):
+            self._fill()
+
+    def _fill(self):
+        try:
+            batch = next(self._source)
+        except StopIteration:
+            return
+        with self._stream:
+            batch = _map_tensors(lambda t: t.to(self._device, non_blocking=True), batch)
+        self._pending.append(batch)
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        if not self._pending:
+            raise StopIteration
+        batch = self._pending.pop(0)
+        self._fill()
+        current = self._cuda.current_stream(self._device.index)
+        current.wait_stream(self._stream)
+        # The batch was allocated on the side stream but is used on the
+        # consumer's, so its memory must not be reused before that work.
+        _map_tensors(lambda t: t.record_stream(current), batch)
+        return batch
+
+
+class DataLoader:
+    """Iterates `dataset` in batches.
+
+    batch_size: samples per batch (None yields single samples, uncollated).
+    shuffle: visit samples in a new random order each epoch.
+    num_workers: worker processes; 0 loads in the calling process.
+    collate_fn: builds a batch from a list of samples (default_collate).
+    prefetch_factor: batches requested ahead per worker, and batches kept in
+        flight to `device`.
+    pin_memory: hand out batches in pinned host memory.
+    device: a CUDA device to copy batches to ahead of use.
+    drop_last: drop a final batch smaller than batch_size.
+    """
+
+    def __init__(self, dataset, batch_size=1, shuffle=False, num_workers=0, collate_fn=None,
+                 prefetch_factor=2, pin_memory=False, device=None, drop_last=False,
+                 worker_init_fn=None, multiprocessing_context=None):
+        if num_workers < 0 or prefetch_factor < 1:
+            raise ValueError("DataLoader: need num_workers >= 0 and prefetch_factor >= 1")
+        self.dataset = dataset
+        self.batch_size = batch_size
+        self.shuffle = shuffle
+        self.num_workers = num_workers
+        self.collate_fn = collate_fn or (default_collate if batch_size is not None else _first)
+        self.prefetch_factor = prefetch_factor
+        self.pin_memory = pin_memory
+        self.device = _device(device) if device is not None else None
+        self.drop_last = drop_last
+        self.worker_init_fn = worker_init_fn
+        self.multiprocessing_context = multiprocessing_context
+
+    def _batches(self):
+        order = list(range(len(self.dataset)))
+        if self.shuffle:
+            random.shuffle(order)
+        size = self.batch_size or 1
+        batches = [order[i:i + size] for i in range(0, len(order), size)]
+        if self.drop_last and batches and len(batches[-1]) < size:
+            batches.pop()
+        return batches
+
+    def __len__(self):
+        n, size = len(self.dataset), self.batch_size or 1
+        return n // size if self.drop_last else (n + size - 1) // size
+
+    def __iter__(self):
+        batches = self._batches()
+        if self.num_workers > 0:
+            it = _MultiWorkerIter(self, batches)
+        else:
+            it = _single_process_iter(self, batches)
+        if self.device is not None and self.device.is_cuda:
+            return _DevicePrefetcher(it, self.device, self.prefetch_factor)
+        if self.pin_memory:
+            return (_map_tensors(lambda t: t.pin_memory(), b) for b in it)
+        return it
+
+
+def _first(samples):
+    return samples[0]
@@ -0,0 +1,30 @@
+"""Device descriptors. Type codes mirror xft::DeviceType in csrc/core/device.h."""
+
+CPU = 0
+CUDA = 1
+
+
+class device:
+    def __init__(self, spec="cpu", index=None):
+        if isinstance(spec, device):
+            self.type, self.index = spec.type, spec.index
+            return
+        name, _, idx = str(spec).partition(":")
+        if name not in ("cpu", "cuda"):
+            raise ValueError("unknown device %r" % spec)
+        self.type = CPU if name == "cpu" else CUDA
+        self.index = int(idx) if idx else (index or 0)
+
+    @property
+    def is_cuda(self):
+        return self.type == CUDA
+
+    def __eq__(self, other):
+        other = device(other)
+        return self.type == other.type and self.index == other.index
+
+    def __hash__(self):
+        return hash((self.type, self.index))
+
+    def __repr__(self):
+        return "cpu" if self.type == CPU else "cuda:%d" % self.index
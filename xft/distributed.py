@@ -0,0 +1,180 @@
+"""Multi-GPU data parallelism over NCCL (csrc/distributed/).
+
+One process per GPU. Launch N copies with RANK, WORLD_SIZE, LOCAL_RANK,
+MASTER_ADDR and MASTER_PORT set (any launcher that sets them works), then:
+
+    def forward(x, y):
+        diff = F.linear(x, w, b) - y
+        return (diff * diff).mean()  # a 0-d loss on this rank's GPU
+
+    pg = xft.distributed.init_process_group()
+    model = xft.distributed.DistributedDataParallel(forward, [w, b])
+    opt = xft.optim.SGD([w, b], lr=0.1)
+    for x, y in batches:  # this rank's shard of each batch
+        opt.zero_grad()
+        loss = model(x, y)
+        loss.backward()  # grads are averaged across ranks when it returns
+        opt.step()
+
+DistributedDataParallel packs the grads into buckets and all-reduces each
+bucket on the process group's own stream as soon as backward has produced
+all of its grads, so communication overlaps the rest of backward. Needs a
+build with XFT_USE_NCCL=ON.
+"""
+
+import contextlib
+import ctypes
+import os
+import socket
+import time
+
+from . import _C
+from .tensor import zeros
+
+_C.declare("xft_distributed_is_available", _C.P(_C.i32))
+_C.declare("xft_nccl_unique_id", ctypes.c_char_p, _C.i64)
+_C.declare("xft_process_group_create", ctypes.c_char_p, _C.i64, _C.i32, _C.i32, _C.i32,
+           _C.P(_C.voidp))
+_C.declare("xft_process_group_destroy", _C.voidp)
+_C.declare("xft_process_group_all_reduce_", _C.voidp, _C.handle, _C.i32)
+_C.declare("xft_process_group_broadcast_", _C.voidp, _C.handle, _C.i32)
+_C.declare("xft_ddp_create", _C.voidp, _C.P(_C.handle), _C.i64, _C.i64, _C.P(_C.voidp))
+_C.declare("xft_ddp_destroy", _C.voidp)
+_C.declare("xft_ddp_set_sync", _C.voidp, _C.i32)
+_C.declare("xft_ddp_num_buckets", _C.voidp, _C.P(_C.i64))
+
+_UNIQUE_ID_BYTES = 128
+_default_group = None
+
+
+def is_available():
+    """Whether this build has NCCL (XFT_USE_NCCL=ON)."""
+    return bool(_C.call_out("xft_distributed_is_available", out_type=_C.i32))
+
+
+def _recv_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise RuntimeError("init_process_group: rendezvous connection closed early")
+        buf += chunk
+    return buf
+
+
+def _rendezvous(rank, world_size, addr, port, timeout):
+    """Rank 0 makes the NCCL id and hands it to every other rank over TCP."""
+    if rank == 0:
+        buf = ctypes.create_string_buffer(_UNIQUE_ID_BYTES)
+        _C.call("xft_nccl_unique_id", buf, _UNIQUE_ID_BYTES)
+        uid = buf.raw
+        with socket.create_server((addr, port)) as server:
+            server.settimeout(timeout)
+            for _ in range(world_size - 1):
+                conn, _ = server.accept()
+                with conn:
+                    conn.sendall(uid)
+        return uid
+    deadline = time.monotonic() + timeout
+    while True:
+        try:
+            with socket.create_connection((addr, port), timeout=timeout) as conn:
+                return _recv_exact(conn, _UNIQUE_ID_BYTES)
+        except (ConnectionRefusedError, socket.timeout):
+            if time.monotonic() > deadline:
+                raise RuntimeError("init_process_group: rank 0 did not answer at %s:%d"
+                                   % (addr, port)) from None
+            time.sleep(0.1)
+
+
+class ProcessGroup:
+    """An NCCL communicator for this rank. Collectives are in place, and
+    later work on the current stream waits for them."""
+
+    def __init__(self, unique_id, rank, world_size, device):
+        self.rank, self.world_size, self.device = rank, world_size, device
+        self._ptr = _C.call_out("xft_process_group_create", unique_id, len(unique_id), rank,
+                                world_size, device, out_type=_C.voidp)
+
+    def __del__(self):
+        if getattr(self, "_ptr", None) and _C.lib is not None:
+            _C.lib.xft_process_group_destroy(self._ptr)
+
+    def all_reduce(self, t, average=False):
+        """Sums (or averages) t across ranks."""
+        _C.call("xft_process_group_all_reduce_", self._ptr, t._h, int(average))
+        return t
+
+    def broadcast(self, t, src=0):
+        _C.call("xft_process_group_broadcast_", self._ptr, t._h, src)
+        return t
+
+    def barrier(self):
+        """Returns once every rank has reached it."""
+        t = zeros([1], device="cuda:%d" % self.device)
+        self.all_reduce(t)
+        t.cpu()
+
+
+def init_process_group(rank=None, world_size=None, device=None, timeout=300.0):
+    """Joins the job's default process group. Arguments left out come from
+    RANK, WORLD_SIZE and LOCAL_RANK (the device); rendezvous goes through
+    MASTER_ADDR:MASTER_PORT, where rank 0 listens."""
+    global _default_group
+    rank = int(os.environ["RANK"]) if rank is None else rank
+    world_size = int(os.environ["WORLD_SIZE"]) if world_size is None else world_size
+    if device is None:
+        device = int(os.environ.get("LOCAL_RANK", rank))
+    addr = os.environ.get("MASTER_ADDR", "127.0.0.1")
+    port = int(os.environ.get("MASTER_PORT", "29500"))
+    uid = _rendezvous(rank, world_size, addr, port, timeout)
+    _default_group = ProcessGroup(uid, rank, world_size, device)
+    return _default_group
+
+
+def get_process_group():
+    if _default_group is None:
+        raise RuntimeError("init_process_group() has not been called")
+    return _default_group
+
+
+class DistributedDataParallel:
+    """Wraps a forward callable whose trainable tensors are `params`.
+    Calling it calls fn; the backward of its result averages the grads of
+    `params` across ranks, bucket by bucket while backward runs.
+
+    Every rank must pass the same params in the same order; their values
+    are broadcast from rank 0 here. Each param's grad becomes a view into a
+    flat bucket buffer; optimizers and zero_grad work on it as usual. Use a
+    param at most once per backward pass (not inside autograd.checkpoint).
+    """
+
+    def __init__(self, fn, params, process_group=None, bucket_cap_mb=25):
+        self.fn = fn
+        self.params = list(params)
+        self.process_group = process_group or get_process_group()
+        handles = (_C.handle * max(len(self.params), 1))(*[p._h for p in self.params])
+        self._ptr = _C.call_out("xft_ddp_create", self.process_group._ptr, handles,
+                                len(self.params), int(bucket_cap_mb * (1 << 20)),
+                                out_type=_C.voidp)
+
+    def __del__(self):
+        if getattr(self, "_ptr", None) and _C.lib is not None:
+            _C.lib.xft_ddp_destroy(self._ptr)
+
+    def __call__(self, *args, **kwargs):
+        return self.fn(*args, **kwargs)
+
+    @property
+    def num_buckets(self):
+        return _C.call_out("xft_ddp_num_buckets", self._ptr, out_type=_C.i64)
+
+    @contextlib.contextmanager
+    def no_sync(self):
+        """Backward inside the block only accumulates local grads; the first
+        backward after it reduces the accumulated sum."""
+        _C.call("xft_ddp_set_sync", self._ptr, 0)
+        try:
+            yield
+        finally:
+            _C.call("xft_ddp_set_sync", self._ptr, 1)
@@ -0,0 +1,42 @@
+"""Element types. Codes mirror xft::DType in csrc/core/dtype.h."""
+
+import ctypes
+
+
+class dtype:
+    def __init__(self, name, code, itemsize, ctype, is_floating_point):
+        self.name = name
+        self.code = code
+        self.itemsize = itemsize
+        self.ctype = ctype
+        self.is_floating_point = is_floating_point
+
+    def __repr__(self):
+        return "xft." + self.name
+
+
+float32 = dtype("float32", 0, 4, ctypes.c_float, True)
+float64 = dtype("float64", 1, 8, ctypes.c_double, True)
+int32 = dtype("int32", 2, 4, ctypes.c_int32, False)
+int64 = dtype("int64", 3, 8, ctypes.c_int64, False)
+uint8 = dtype("uint8", 4, 1, ctypes.c_uint8, False)
+bool_ = dtype("bool", 5, 1, ctypes.c_bool, False)
+# The 16-bit floats have no ctypes equivalent: their buffers hold raw bits,
+# and values cross to and from Python through float32.
+float16 = dtype("float16", 6, 2, ctypes.c_uint16, True)
+bfloat16 = dtype("bfloat16", 7, 2, ctypes.c_uint16, True)
+int8 = dtype("int8", 8, 1, ctypes.c_int8, False)
+
+_BY_CODE = {
+    d.code: d for d in (float32, float64, int32, int64, uint8, bool_, float16, bfloat16, int8)
+}
+_REDUCED = (float16, bfloat16)
+
+
+def from_code(code):
+    return _BY_CODE[code]
+
+
+def is_reduced(d):
+    """True for the 16-bit floating dtypes."""
+    return d in _REDUCED
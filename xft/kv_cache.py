@@ -0,0 +1,104 @@
+"""A block-paged key/value cache for autoregressive decoding
+(csrc/ops/paged_attention.h).
+
+Growing a K/V tensor per sequence copies everything so far at every
+generated token. The paged cache preallocates one pool of fixed-size
+blocks per layer and gives each sequence blocks as it grows, so a step
+writes one row per sequence and sequences of any lengths batch together:
+
+    cache = xft.kv_cache.PagedKVCache(num_layers, num_blocks=4096,
+                                      block_size=16, num_heads=8,
+                                      head_dim=128, device="cuda")
+    seqs = [cache.add_sequence() for _ in prompts]
+    ...
+    with xft.inference_mode():
+        slots = cache.append_slots(seqs)            # one token each
+        tables, lens = cache.block_tables(seqs), cache.context_lens(seqs)
+        for layer in range(num_layers):
+            q, k, v = ...                            # [B, heads, D] each
+            cache.store(layer, slots, k, v)
+            out = xft.nn.functional.paged_attention(
+                q, cache.key_cache(layer), cache.value_cache(layer),
+                tables, lens)
+
+remove_sequence returns a finished sequence's blocks to the pool.
+"""
+
+from . import _C
+from . import dtypes as _dtype
+from .device import device as _device
+from .tensor import Tensor
+
+_C.declare("xft_paged_kv_cache_create", _C.i64, _C.i64, _C.i64, _C.i64, _C.i64, _C.i32,
+           _C.i32, _C.i32, _C.P(_C.voidp))
+_C.declare("xft_paged_kv_cache_destroy", _C.voidp)
+_C.declare("xft_paged_kv_cache_add_sequence", _C.voidp, _C.P(_C.i64))
+_C.declare("xft_paged_kv_cache_remove_sequence", _C.voidp, _C.i64)
+_C.declare("xft_paged_kv_cache_append_slots", _C.voidp, _C.P(_C.i64), _C.P(_C.i64), _C.i64,
+           _C.P(_C.handle))
+_C.declare("xft_paged_kv_cache_store", _C.voidp, _C.i64, _C.handle, _C.handle, _C.handle)
+_C.declare("xft_paged_kv_cache_block_tables", _C.voidp, _C.P(_C.i64), _C.i64, _C.P(_C.handle))
+_C.declare("xft_paged_kv_cache_context_lens", _C.voidp, _C.P(_C.i64), _C.i64, _C.P(_C.handle))
+_C.declare("xft_paged_kv_cache_key_cache", _C.voidp, _C.i64, _C.P(_C.handle))
+_C.declare("xft_paged_kv_cache_value_cache", _C.voidp, _C.i64, _C.P(_C.handle))
+_C.declare("xft_paged_kv_cache_length", _C.voidp, _C.i64, _C.P(_C.i64))
+_C.declare("xft_paged_kv_cache_num_free_blocks", _C.voidp, _C.P(_C.i64))
+
+
+class PagedKVCache:
+    """Key and value pools of [num_blocks, num_heads, block_size, head_dim]
+    for each of num_layers layers, and the block allocator they share."""
+
+    def __init__(self, num_layers, num_blocks, block_size, num_heads, head_dim,
+                 dtype=_dtype.float32, device="cpu"):
+        dev = _device(device)
+        self._ptr = _C.call_out("xft_paged_kv_cache_create", num_layers, num_blocks, block_size,
+                                num_heads, head_dim, dtype.code, dev.type, dev.index,
+                                out_type=_C.voidp)
+        self.num_layers = num_layers
+        self.block_size = block_size
+
+    def __del__(self):
+        if getattr(self, "_ptr", None) and _C.lib is not None:
+            _C.lib.xft_paged_kv_cache_destroy(self._ptr)
+
+    def add_sequence(self):
+        """A new, empty sequence's id."""
+        return _C.call_out("xft_paged_kv_cache_add_sequence", self._ptr, out_type=_C.i64)
+
+    def remove_sequence(self, seq):
+        _C.call("xft_paged_kv_cache_remove_sequence", self._ptr, seq)
+
+    def append_slots(self, seqs, num_tokens=1):
+        """Grows each sequence by num_tokens (an int or one per sequence)
+        and returns the new tokens' int64 slots, in order, for store()."""
+        if isinstance(num_tokens, int):
+            num_tokens = [num_tokens] * len(seqs)
+        s, n = _C.int64_array(seqs)
+        t, _ = _C.int64_array(num_tokens)
+        return Tensor(_C.call_out("xft_paged_kv_cache_append_slots", self._ptr, s, t, n))
+
+    def store(self, layer, slots, k, v):
+        """Writes k and v ([T, num_heads, head_dim]) to layer's pools."""
+        _C.call("xft_paged_kv_cache_store", self._ptr, layer, slots._h, k._h, v._h)
+
+    def block_tables(self, seqs):
+        s, n = _C.int64_array(seqs)
+        return Tensor(_C.call_out("xft_paged_kv_cache_block_tables", self._ptr, s, n))
+
+    def context_lens(self, seqs):
+        s, n = _C.int64_array(seqs)
+        return Tensor(_C.call_out("xft_paged_kv_cache_context_lens", self._ptr, s, n))
+
+    def key_cache(self, layer):
+        return Tensor(_C.call_out("xft_paged_kv_cache_key_cache", self._ptr, layer))
+
+    def value_cache(self, layer):
+        return Tensor(_C.call_out("xft_paged_kv_cache_value_cache", self._ptr, layer))
+
+    def length(self, seq):
+        return _C.call_out("xft_paged_kv_cache_length", self._ptr, seq, out_type=_C.i64)
+
+    @property
+    def num_free_blocks(self):
+        return _C.call_out("xft_paged_kv_cache_num_free_blocks", self._ptr, out_type=_C.i64)
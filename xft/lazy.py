@@ -0,0 +1,129 @@
+"""Lazy trace-and-fuse mode for pointwise ops (csrc/lazy/lazy.h).
+
+Inside lazy_mode(), elementwise ops on floating tensors return pending
+tensors that record an expression graph instead of running. Reading the
+data (tolist(), item(), printing, views, any other op) or calling
+materialize() runs the whole graph as one fused loop, so a chain of small
+ops costs one pass through memory instead of one per op:
+
+    with xft.lazy_mode():
+        y = xft.sigmoid(x * w + b) * x   # nothing computed yet
+    y.tolist()                           # one fused kernel
+
+Ops that autograd records (grad mode on and an input requiring grad) still
+run eagerly. A pending tensor reads its inputs when it is materialized;
+writing to one of them in place before that is an error. Pending tensors
+hold no memory until then, and memory_plan() tells what running one will
+take.
+"""
+
+import functools
+
+from . import _C
+
+# Field order of xft::lazy::Stats.
+_STAT_NAMES = (
+    "traced_ops",
+    "materializations",
+    "fused_ops",
+    "kernel_compiles",
+    "kernel_cache_hits",
+)
+
+
+def is_enabled():
+    return bool(_C.call_out("xft_is_lazy_enabled", out_type=_C.i32))
+
+
+class lazy_mode:
+    """Context manager / decorator turning lazy mode on (or, with
+    enabled=False, off) for this thread; restores the previous mode on exit.
+    Pending tensors created inside stay pending after the region ends."""
+
+    def __init__(self, enabled=True):
+        self._enabled = enabled
+
+    def __enter__(self):
+        self._prev = is_enabled()
+        _C.call("xft_set_lazy_enabled", int(bool(self._enabled)))
+        return self
+
+    def __exit__(self, *exc):
+        _C.call("xft_set_lazy_enabled", int(self._prev))
+        return False
+
+    def __call__(self, fn):
+        @functools.wraps(fn)
+        def wrapper(*args, **kwargs):
+            with lazy_mode(self._enabled):
+                return fn(*args, **kwargs)
+
+        return wrapper
+
+
+def materialize(*tensors):
+    """Computes every pending tensor among `tensors`."""
+    for t in tensors:
+        t.materialize()
+
+
+# Field order of xft::lazy::PlanStats.
+_PLAN_NAMES = (
+    "ops",
+    "output_bytes",
+    "arena_bytes",
+    "unplanned_bytes",
+    "in_place",
+    "scratch_bytes",
+    "peak_bytes",
+)
+
+
+def memory_plan(t):
+    """The memory plan for materializing pending tensor t, without running it.
+
+    Intermediates are packed into one arena by lifetime, each result written
+    over an operand that dies with it when the sizes match. arena_bytes is
+    that arena at full size (what CUDA needs when the graph runs op by op)
+    against unplanned_bytes with a buffer per intermediate; CPU runs it in
+    scratch_bytes per thread instead. peak_bytes adds the output. Once t is
+    materialized, only output_bytes is set.
+    """
+    buf = (_C.i64 * len(_PLAN_NAMES))()
+    _C.call("xft_lazy_plan_stats", t._h, buf, len(_PLAN_NAMES))
+    return dict(zip(_PLAN_NAMES, buf))
+
+
+def plan_memory(nodes, alignment=1):
+    """Runs the planner behind memory_plan() on a program given as one
+    (bytes, a, b) per instruction: its result size and the instructions
+    producing its operands (-1 for a program input or no operand).
+
+    Returns each result's offset in the arena (-1 for the last, which
+    writes the output) with arena_bytes, unplanned_bytes and in_place.
+    """
+    nodes = list(nodes)
+    size, n = _C.int64_array(node[0] for node in nodes)
+    a, _ = _C.int64_array(node[1] for node in nodes)
+    b, _ = _C.int64_array(node[2] for node in nodes)
+    offsets = (_C.i64 * max(n, 1))()
+    out = (_C.i64 * 3)()
+    _C.call("xft_lazy_plan_memory", size, a, b, n, alignment, offsets, out)
+    return {
+        "offsets": list(offsets[:n]),
+        "arena_bytes": out[0],
+        "unplanned_bytes": out[1],
+        "in_place": out[2],
+    }
+
+
+def stats():
+    """Process-wide counters: ops traced, graphs run, ops fused into them,
+    and (CUDA with NVRTC) kernels compiled and kernel cache hits."""
+    buf = (_C.i64 * len(_STAT_NAMES))()
+    _C.call("xft_lazy_stats", buf, len(_STAT_NAMES))
+    return dict(zip(_STAT_NAMES, buf))
+
+
+def reset_stats():
+    _C.call("xft_lazy_reset_stats")
@@ -0,0 +1,109 @@
+"""Functional forms of the layers, in the torch.nn.functional spelling."""
+
+from .. import _C
+from ..quantization import QuantizedWeight
+from ..tensor import (
+    Tensor,
+    bias_dropout_residual,
+    bias_gelu,
+    dropout,
+    gelu,
+    layer_norm,
+    matmul,
+    relu,
+    rms_norm,
+    sigmoid,
+    softmax,
+    tanh,
+)
+
+
+def linear(input, weight, bias=None):
+    """input @ weight^T + bias, weight being [out_features, in_features].
+
+    weight may also be a xft.quantization.QuantizedWeight, which runs the
+    quantized kernels.
+    """
+    if isinstance(weight, QuantizedWeight):
+        return weight.linear(input, bias)
+    out = matmul(input, weight.T)
+    return out if bias is None else out + bias
+
+
+def _pair(v):
+    return (int(v), int(v)) if isinstance(v, int) else (int(v[0]), int(v[1]))
+
+
+def conv2d(input, weight, bias=None, stride=1, padding=0, dilation=1, groups=1):
+    """2-D convolution of input [N, C, H, W] with weight [K, C / groups, R, S].
+
+    stride, padding and dilation are ints or (h, w) pairs. Runs as an
+    implicit GEMM over channels-last data; the result takes the input's
+    memory format, so pass input.contiguous(xft.channels_last) to keep a
+    network in NHWC throughout.
+    """
+    sh, sw = _pair(stride)
+    ph, pw = _pair(padding)
+    dh, dw = _pair(dilation)
+    return Tensor(
+        _C.call_out(
+            "xft_conv2d",
+            input._h,
+            weight._h,
+            None if bias is None else bias._h,
+            sh,
+            sw,
+            ph,
+            pw,
+            dh,
+            dw,
+            int(groups),
+        )
+    )
+
+
+def paged_attention(query, key_cache, value_cache, block_tables, context_lens, scale=None):
+    """Decode attention of one new query per sequence over a paged KV cache.
+
+    query is [B, heads, D] and the caches [num_blocks, kv_heads,
+    block_size, D] (see xft.kv_cache.PagedKVCache, whose block_tables and
+    context_lens give the int32 [B, max_blocks] and [B] arguments).
+    Sequence b attends to its first context_lens[b] cached tokens; query
+    head h reads kv head h // (heads // kv_heads). Inference only.
+    """
+    if scale is not None and scale == 0:
+        raise ValueError("paged_attention: scale must be nonzero")
+    return Tensor(
+        _C.call_out(
+            "xft_paged_attention",
+            query._h,
+            key_cache._h,
+            value_cache._h,
+            block_tables._h,
+            context_lens._h,
+            0.0 if scale is None else float(scale),
+        )
+    )
+
+
+def scaled_dot_product_attention(query, key, value, is_causal=False, scale=None):
+    """softmax(query @ key^T * scale) @ value over the last two dims.
+
+    query is [..., L, D], key [..., S, D] and value [..., S, Dv] with the same
+    leading dims. scale defaults to 1 / sqrt(D); is_causal hides key j from
+    query i when j > i. The [L, S] score matrix is never materialized: the
+    work is tiled with an online softmax, and backward recomputes the
+    probabilities instead of saving them.
+    """
+    if scale is not None and scale == 0:
+        raise ValueError("scaled_dot_product_attention: scale must be nonzero")
+    return Tensor(
+        _C.call_out(
+            "xft_scaled_dot_product_attention",
+            query._h,
+            key._h,
+            value._h,
+            int(bool(is_causal)),
+            0.0 if scale is None else float(scale),
+        )
+    )
@@ -0,0 +1,150 @@
+"""Fused optimizers (csrc/ops/optim.h).
+
+step() updates every parameter with one C call: each tensor is read and
+written once, and on CUDA the parameters sharing a device and dtype are
+updated by multi-tensor kernels, a handful of launches per step however
+many parameters the model has.
+
+    opt = xft.optim.AdamW(params, lr=1e-3)
+    loss.backward()
+    xft.optim.clip_grad_norm_(params, 1.0)
+    opt.step()
+    opt.zero_grad()
+
+Optimizers expose their `params` list, so they work with amp.GradScaler.
+Parameters whose grad is None are left alone.
+"""
+
+from . import _C
+from .tensor import Tensor, zeros
+
+_C.declare(
+    "xft_sgd_step", _C.P(_C.handle), _C.P(_C.handle), _C.P(_C.handle), _C.i64, _C.f64, _C.f64,
+    _C.f64, _C.f64, _C.i32, _C.i32,
+)
+_C.declare(
+    "xft_adam_step", _C.P(_C.handle), _C.P(_C.handle), _C.P(_C.handle), _C.P(_C.handle), _C.i64,
+    _C.f64, _C.f64, _C.f64, _C.f64, _C.f64, _C.i32, _C.i64,
+)
+_C.declare("xft_clip_grad_norm_", _C.P(_C.handle), _C.i64, _C.f64, _C.P(_C.handle))
+
+
+def _handles(tensors):
+    return (_C.handle * max(len(tensors), 1))(*[t._h if t is not None else None for t in tensors])
+
+
+def clip_grad_norm_(params, max_norm):
+    """Scales the grads of `params` in place so that their global L2 norm is
+    at most max_norm, in two multi-tensor passes. Returns the norm before
+    clipping as a float32 scalar tensor; on CUDA it is computed and applied
+    on the device, so nothing synchronizes until it is read."""
+    grads = [p.grad for p in params]
+    return Tensor(_C.call_out("xft_clip_grad_norm_", _handles(grads), len(grads), max_norm))
+
+
+class Optimizer:
+    def __init__(self, params, defaults):
+        self.params = list(params)
+        if not self.params:
+            raise ValueError("optimizer got an empty parameter list")
+        self.defaults = dict(defaults)
+        # Per-parameter state, by position in `params`.
+        self.state = [{} for _ in self.params]
+
+    def zero_grad(self, set_to_none=True):
+        for p in self.params:
+            if set_to_none:
+                p.grad = None
+            else:
+                g = p.grad
+                if g is not None:
+                    g.fill_(0)
+
+    def _with_grads(self):
+        """(index, param, grad) for each parameter that has a grad."""
+        out = []
+        for i, p in enumerate(self.params):
+            g = p.grad
+            if g is not None:
+                out.append((i, p, g))
+        return out
+
+    def step(self):
+        raise NotImplementedError
+
+
+class SGD(Optimizer):
+    def __init__(self, params, lr, momentum=0.0, dampening=0.0, weight_decay=0.0,
+                 nesterov=False):
+        if nesterov and (momentum <= 0 or dampening != 0):
+            raise ValueError("nesterov needs momentum and zero dampening")
+        super().__init__(params, dict(lr=lr, momentum=momentum, dampening=dampening,
+                                      weight_decay=weight_decay, nesterov=nesterov))
+
+    def step(self):
+        d = self.defaults
+        entries = self._with_grads()
+        if d["momentum"] == 0:
+            self._step(entries, None, False)
+            return
+        # Parameters getting their first momentum buffer are a separate call:
+        # it starts as the grad itself.
+        fresh = [e for e in entries if "momentum_buffer" not in self.state[e[0]]]
+        for i, p, _ in fresh:
+            self.state[i]["momentum_buffer"] = zeros(p.shape, dtype=p.dtype, device=p.device)
+        fresh_ids = {e[0] for e in fresh}
+        for first in (True, False):
+            batch = [e for e in entries if (e[0] in fresh_ids) == first]
+            self._step(batch, [self.state[i]["momentum_buffer"] for i, _, _ in batch], first)
+
+    def _step(self, batch, bufs, first):
+        if not batch:
+            return
+        d = self.defaults
+        _C.call(
+            "xft_sgd_step", _handles([p for _, p, _ in batch]), _handles([g for _, _, g in batch]),
+            _handles(bufs) if bufs is not None else None, len(batch), d["lr"], d["momentum"],
+            d["dampening"], d["weight_decay"], int(d["nesterov"]), int(first),
+        )
+
+
+class Adam(Optimizer):
+    _decoupled = False
+
+    def __init__(self, params, lr=1e-3, betas=(0.9, 0.999), eps=1e-8, weight_decay=0.0):
+        super().__init__(params, dict(lr=lr, betas=tuple(betas), eps=eps,
+                                      weight_decay=weight_decay))
+
+    def step(self):
+        d = self.defaults
+        # Bias correction depends on each parameter's own step count; they
+        # are almost always equal, so this is almost always one call.
+        by_step = {}
+        for i, p, g in self._with_grads():
+            st = self.state[i]
+            if not st:
+                st["step"] = 0
+                st["exp_avg"] = zeros(p.shape, dtype=p.dtype, device=p.device)
+                st["exp_avg_sq"] = zeros(p.shape, dtype=p.dtype, device=p.device)
+            st["step"] += 1
+            by_step.setdefault(st["step"], []).append((i, p, g))
+        beta1, beta2 = d["betas"]
+        for step, batch in by_step.items():
+            states = [self.state[i] for i, _, _ in batch]
+            _C.call(
+                "xft_adam_step", _handles([p for _, p, _ in batch]),
+                _handles([g for _, _, g in batch]), _handles([s["exp_avg"] for s in states]),
+                _handles([s["exp_avg_sq"] for s in states]), len(batch), d["lr"], beta1, beta2,
+                d["eps"], d["weight_decay"], int(self._decoupled), step,
+            )
+
+
+class AdamW(Adam):
+    """Adam with decoupled weight decay: p -= lr * weight_decay * p each step,
+    instead of adding weight_decay * p to the grad."""
+
+    _decoupled = True
+
+    def __init__(self, params, lr=1e-3, betas=(0.9, 0.999), eps=1e-8, weight_decay=1e-2):
+        super().__init__(params, lr=lr, betas=betas, eps=eps, weight_decay=weight_decay)
+
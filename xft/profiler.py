@@ -0,0 +1,159 @@
+"""Op-level profiler (csrc/core/profiler.h).
+
+Every op records itself in C++ while a session is active: name, input
+shapes, device, wall time, the storage bytes it allocated and, on CUDA, the
+time its kernels took on the device, measured with events on the current
+stream rather than on the host clock:
+
+    with xft.profiler.profile() as prof:
+        loss = model(x)
+        loss.backward()
+    print(prof.table(sort_by="cuda_time_total"))
+    prof.export_chrome_trace("trace.json")   # chrome://tracing or Perfetto
+
+Autograd nodes show up under "backward", with the ops they run nested
+inside. Leaving the block waits for the timed CUDA work to finish.
+"""
+
+import ctypes
+import json
+from collections import namedtuple
+
+from . import _C
+from .device import CPU, device as _device
+
+_C.declare("xft_profiler_start", _C.i32, _C.i32)
+_C.declare("xft_profiler_stop", _C.P(_C.voidp))
+_C.declare("xft_profiler_is_enabled", _C.P(_C.i32))
+_C.declare("xft_profile_size", _C.voidp, _C.P(_C.i64))
+_C.declare("xft_profile_event", _C.voidp, _C.i64, _C.P(ctypes.c_char_p), _C.P(_C.i64), _C.i64)
+_C.declare("xft_profile_event_shapes", _C.voidp, _C.i64, _C.P(ctypes.c_char_p))
+_C.declare("xft_profile_export_chrome_trace", _C.voidp, ctypes.c_char_p)
+_C.declare("xft_profile_free", _C.voidp)
+
+_NUM_FIELDS = 10
+
+# Times are nanoseconds from the start of the session; cuda_* are None for
+# ops not timed on a device.
+Event = namedtuple(
+    "Event",
+    "name input_shapes device thread depth start_ns end_ns self_ns cuda_start_ns cuda_ns "
+    "alloc_bytes",
+)
+
+# One row of key_averages(): totals over every call with the same key.
+EventAverage = namedtuple(
+    "EventAverage",
+    "name input_shapes count cpu_time_total self_cpu_time_total cuda_time_total alloc_bytes",
+)
+
+
+def is_enabled():
+    return bool(_C.call_out("xft_profiler_is_enabled", out_type=_C.i32))
+
+
+class profile:
+    """Context manager that records every op run inside it, on any thread.
+    record_shapes=False skips the shapes; cuda_timing=False skips the CUDA
+    events (and the synchronization at exit)."""
+
+    def __init__(self, record_shapes=True, cuda_timing=True):
+        self.record_shapes = record_shapes
+        self.cuda_timing = cuda_timing
+        self._ptr = None
+        self._events = None
+
+    def __del__(self):
+        if self._ptr is not None and _C.lib is not None:
+            _C.lib.xft_profile_free(self._ptr)
+
+    def __enter__(self):
+        if self._ptr is not None:
+            raise RuntimeError("profile: this profile already holds a session")
+        _C.call("xft_profiler_start", int(self.record_shapes), int(self.cuda_timing))
+        return self
+
+    def __exit__(self, *exc):
+        self._ptr = _C.call_out("xft_profiler_stop", out_type=_C.voidp)
+        return False
+
+    def _check(self):
+        if self._ptr is None:
+            raise RuntimeError("profile: no results yet; use it as a context manager first")
+
+    def events(self):
+        """Every recorded op, ordered by start time."""
+        self._check()
+        if self._events is None:
+            n = _C.call_out("xft_profile_size", self._ptr, out_type=_C.i64)
+            name = ctypes.c_char_p()
+            fields = (_C.i64 * _NUM_FIELDS)()
+            shapes = ctypes.c_char_p()
+            out = []
+            for i in range(n):
+                _C.call("xft_profile_event", self._ptr, i, ctypes.byref(name), fields,
+                        _NUM_FIELDS)
+                _C.call("xft_profile_event_shapes", self._ptr, i, ctypes.byref(shapes))
+                dev_type, dev_index, thread, depth, start, end, self_ns, cstart, cns, alloc = fields
+                dev = "cpu" if dev_type == CPU else "cuda:%d" % dev_index
+                out.append(Event(
+                    name.value.decode(), [tuple(s) for s in json.loads(shapes.value)],
+                    _device(dev), thread, depth, start, end, self_ns,
+                    cstart if cns >= 0 else None, cns if cns >= 0 else None, alloc,
+                ))
+            self._events = out
+        return self._events
+
+    def key_averages(self, group_by_input_shape=False):
+        """Totals per op name (and input shapes, if asked), slowest first."""
+        rows = {}
+        for ev in self.events():
+            key = (ev.name, tuple(ev.input_shapes)) if group_by_input_shape else ev.name
+            row = rows.get(key)
+            if row is None:
+                shapes = ev.input_shapes if group_by_input_shape else None
+                row = rows[key] = [ev.name, shapes, 0, 0, 0, None, 0]
+            row[2] += 1
+            row[3] += ev.end_ns - ev.start_ns
+            row[4] += ev.self_ns
+            if ev.cuda_ns is not None:
+                row[5] = (row[5] or 0) + ev.cuda_ns
+            row[6] += ev.alloc_bytes
+        out = [EventAverage(*r) for r in rows.values()]
+        out.sort(key=lambda r: r.cpu_time_total, reverse=True)
+        return out
+
+    def table(self, sort_by="self_cpu_time_total", row_limit=50, group_by_input_shape=False):
+        """The key_averages() rows as aligned text, sorted by any
+        EventAverage field. Times are in microseconds."""
+        rows = self.key_averages(group_by_input_shape)
+        rows.sort(key=lambda r: getattr(r, sort_by) or 0, reverse=True)
+        rows = rows[:row_limit]
+        header = ["Name", "Calls", "CPU total us", "Self CPU us", "CUDA total us", "Alloc MB"]
+        if group_by_input_shape:
+            header.insert(1, "Input shapes")
+        lines = []
+        for r in rows:
+            line = [
+                r.name,
+                str(r.count),
+                "%.1f" % (r.cpu_time_total / 1e3),
+                "%.1f" % (r.self_cpu_time_total / 1e3),
+                "-" if r.cuda_time_total is None else "%.1f" % (r.cuda_time_total / 1e3),
+                "%.2f" % (r.alloc_bytes / float(1 << 20)),
+            ]
+            if group_by_input_shape:
+                line.insert(1, str([list(s) for s in r.input_shapes]))
+            lines.append(line)
+        widths = [max(len(x) for x in col) for col in zip(header, *lines)]
+        fmt = lambda cells: "  ".join(
+            c.ljust(w) if i == 0 else c.rjust(w) for i, (c, w) in enumerate(zip(cells, widths))
+        )
+        sep = "-" * (sum(widths) + 2 * (len(widths) - 1))
+        return "\n".join([fmt(header), sep] + [fmt(line) for line in lines])
+
+    def export_chrome_trace(self, path):
+        """Writes the events as Chrome trace JSON: one track per host thread
+        and, for CUDA ops, a track per device with their kernel time."""
+        self._check()
+        _C.call("xft_profile_export_chrome_trace", self._ptr, str(path).encode())
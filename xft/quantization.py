@@ -0,0 +1,128 @@
+"""Weight quantization for inference (csrc/ops/quantized.h).
+
+Decode-style inference is bound by reading weights, so storing linear
+weights in 8 or 4 bits makes each step move 4x or 8x fewer bytes:
+
+    params = xft.load("model.xft")
+    qparams = xft.quantization.quantize_dynamic(params)
+    with xft.inference_mode():
+        h = xft.nn.functional.linear(x, qparams["fc1.weight"], qparams["fc1.bias"])
+
+Weights are quantized symmetrically per group of columns of each output
+row, with a float32 scale per group and no zero point. A dynamic weight
+also quantizes the activations to int8 per row at run time and multiplies
+in int32 (VNNI on AVX512-VNNI CPUs, dp4a on CUDA); a weight-only one keeps
+the activations floating. Quantized layers are inference-only.
+"""
+
+import ctypes
+
+from . import _C
+from .tensor import Tensor
+
+_quantized_linear = _C.bind_out("xft_quantized_linear")
+
+
+def _default_group_size(bits, in_features):
+    # Per-channel scales lose too much at 4 bits; 128 columns is the usual
+    # group there.
+    if bits == 4 and in_features % 128 == 0:
+        return 128
+    return 0
+
+
+class QuantizedWeight:
+    """A [out_features, in_features] linear weight in 8 or 4 bits.
+
+    data is int8 [N, K] for 8 bits, or uint8 [N, K / 2] for 4 (byte i of
+    a row holds columns i and i + K / 2); scales is float32
+    [N, K / group_size].
+    """
+
+    def __init__(self, data, scales, dynamic=True):
+        self.data = data
+        self.scales = scales
+        self.dynamic = dynamic
+
+    @property
+    def bits(self):
+        return 8 if self.data.dtype.name == "int8" else 4
+
+    @property
+    def shape(self):
+        n, k = self.data.shape
+        return (n, k if self.bits == 8 else 2 * k)
+
+    @property
+    def group_size(self):
+        return self.shape[1] // self.scales.shape[1]
+
+    @property
+    def device(self):
+        return self.data.device
+
+    def to(self, device):
+        return QuantizedWeight(self.data.to(device), self.scales.to(device), self.dynamic)
+
+    def dequantize(self):
+        """The float32 weight this one stands for."""
+        return Tensor(_C.call_out("xft_dequantize_weight", self.data._h, self.scales._h))
+
+    def linear(self, x, bias=None):
+        """x @ weight^T + bias, in x's dtype."""
+        return Tensor(
+            _quantized_linear(
+                x._h,
+                self.data._h,
+                self.scales._h,
+                None if bias is None else bias._h,
+                int(bool(self.dynamic)),
+            )
+        )
+
+    def __repr__(self):
+        return "QuantizedWeight(shape=%s, bits=%d, group_size=%d, dynamic=%s, device=%s)" % (
+            self.shape,
+            self.bits,
+            self.group_size,
+            self.dynamic,
+            self.device,
+        )
+
+
+def quantize_weight(weight, bits=8, group_size=None, dynamic=True):
+    """Quantizes a 2-D floating weight to a QuantizedWeight on its device.
+
+    group_size None picks per-channel scales for 8 bits and groups of 128
+    columns (when they divide in_features) for 4; 0 means per-channel.
+    """
+    if group_size is None:
+        group_size = _default_group_size(bits, weight.shape[1])
+    data = _C.handle()
+    scales = _C.handle()
+    _C.call("xft_quantize_weight", weight._h, bits, group_size, ctypes.byref(data),
+            ctypes.byref(scales))
+    return QuantizedWeight(Tensor(data), Tensor(scales), dynamic)
+
+
+def quantize_dynamic(model, bits=8, group_size=None, weight_only=False, filter=None):
+    """Returns model with its linear weights quantized.
+
+    model is a dict of named tensors (a state dict, as xft.load returns) or
+    a list of tensors. Every 2-D floating tensor is replaced by a
+    QuantizedWeight; filter(name, tensor) -> bool narrows that, e.g. to
+    keep embedding tables (list entries are named by index). weight_only
+    keeps activations floating instead of quantizing them per call.
+    Other entries are passed through.
+    """
+
+    def convert(name, t):
+        if not isinstance(t, Tensor) or t.ndim != 2 or not t.dtype.is_floating_point:
+            return t
+        if filter is not None and not filter(name, t):
+            return t
+        return quantize_weight(t, bits, group_size, dynamic=not weight_only)
+
+    if isinstance(model, dict):
+        return {name: convert(name, t) for name, t in model.items()}
+    return [convert(str(i), t) for i, t in enumerate(model)]
@@ -0,0 +1,58 @@
+"""Flat checkpoint files (csrc/core/serialize.h).
+
+save() writes a dict of tensors as a small index followed by each tensor's
+raw, aligned bytes; load() gets them back without parsing anything:
+
+    xft.save(model_state, "model.xft")
+    state = xft.load("model.xft")                 # maps the file, no copy
+    state = xft.load("model.xft", device="cuda")  # streamed through pinned memory
+
+On the CPU, loaded tensors are views of a copy-on-write mapping of the
+file: pages are read on first touch and shared between processes loading
+the same checkpoint, and in-place writes stay private to this process.
+"""
+
+import ctypes
+
+from . import _C
+from .device import device as _device
+from .tensor import Tensor
+
+_C.declare("xft_save", ctypes.c_char_p, _C.P(ctypes.c_char_p), _C.P(_C.handle), _C.i64)
+_C.declare("xft_load", ctypes.c_char_p, _C.i32, _C.i32, _C.P(_C.voidp))
+_C.declare("xft_state_dict_size", _C.voidp, _C.P(_C.i64))
+_C.declare("xft_state_dict_entry", _C.voidp, _C.i64, _C.P(ctypes.c_char_p), _C.P(_C.handle))
+_C.declare("xft_state_dict_free", _C.voidp)
+
+
+def _path(path):
+    return str(path).encode()
+
+
+def save(tensors, path):
+    """Writes `tensors` (a dict, or (name, tensor) pairs) to `path`, in order.
+    The file is replaced only once it is completely written."""
+    items = list(tensors.items() if hasattr(tensors, "items") else tensors)
+    for name, t in items:
+        if not isinstance(t, Tensor):
+            raise TypeError("save: %r is not a tensor" % (name,))
+    n = len(items)
+    names = (ctypes.c_char_p * max(n, 1))(*[name.encode() for name, _ in items])
+    handles = (_C.handle * max(n, 1))(*[t._h for _, t in items])
+    _C.call("xft_save", _path(path), names, handles, n)
+
+
+def load(path, device="cpu"):
+    """Reads a checkpoint written by save() into a dict, in file order."""
+    dev = _device(device)
+    d = _C.call_out("xft_load", _path(path), dev.type, dev.index, out_type=_C.voidp)
+    try:
+        out = {}
+        for i in range(_C.call_out("xft_state_dict_size", d, out_type=_C.i64)):
+            name = ctypes.c_char_p()
+            h = _C.handle()
+            _C.call("xft_state_dict_entry", d, i, ctypes.byref(name), ctypes.byref(h))
+            out[name.value.decode()] = Tensor(h)
+        return out
+    finally:
+        _C.call("xft_state_dict_free", d)
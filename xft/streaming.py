@@ -0,0 +1,170 @@
+"""Out-of-core ops over checkpoint tensors larger than memory
+(csrc/core/streaming.h, csrc/ops/streaming.h).
+
+load() maps a checkpoint and lets page faults bring it in, which is fine
+for weights but not for a dataset bigger than host RAM. These read one
+tensor of a checkpoint a chunk of rows (dim 0) at a time instead: the next
+chunk is read on a background thread while the current one is computed on,
+and pages are dropped from the page cache once read.
+
+    xft.save({"x": features}, "features.xft")
+    mu = xft.streaming.mean("features.xft", "x", dim=0)       # per-feature
+    scores = xft.streaming.matvec("table.xft", "emb", query)  # [N]
+    xft.streaming.map(lambda rows: (rows - mu).relu(), "features.xft", "x",
+                      "centered.xft")
+    for row, chunk in xft.streaming.ChunkReader("features.xft", "x"):
+        ...
+
+chunk_bytes (default 64 MiB) bounds each chunk; a few chunks are in memory
+at once, whatever the size of the file.
+"""
+
+import ctypes
+
+from . import _C
+from . import dtypes as _dtype
+from .device import device as _device
+from .tensor import Tensor, empty
+
+_C.declare("xft_chunk_reader_create", ctypes.c_char_p, ctypes.c_char_p, _C.i64, _C.i32, _C.i32,
+           _C.P(_C.voidp))
+_C.declare("xft_chunk_reader_destroy", _C.voidp)
+_C.declare("xft_chunk_reader_info", _C.voidp, _C.P(_C.i32), _C.P(_C.i64), _C.P(_C.i64), _C.i64)
+_C.declare("xft_chunk_reader_next", _C.voidp, _C.P(_C.handle), _C.P(_C.i64))
+_C.declare("xft_chunk_writer_create", ctypes.c_char_p, ctypes.c_char_p, _C.P(_C.i64), _C.i64,
+           _C.i32, _C.P(_C.voidp))
+_C.declare("xft_chunk_writer_destroy", _C.voidp)
+_C.declare("xft_chunk_writer_write", _C.voidp, _C.handle)
+_C.declare("xft_chunk_writer_close", _C.voidp)
+for _name in ("sum", "mean", "amax"):
+    _C.declare("xft_stream_" + _name, ctypes.c_char_p, ctypes.c_char_p, _C.i64, _C.i32, _C.i32,
+               _C.i64, _C.P(_C.handle))
+_C.declare("xft_stream_matvec", ctypes.c_char_p, ctypes.c_char_p, _C.handle, _C.i64,
+           _C.P(_C.handle))
+
+# Enough for any checkpoint's rank (serialize.cpp caps it at 64).
+_MAX_NDIM = 64
+
+
+def _str(s):
+    return str(s).encode()
+
+
+class ChunkReader:
+    """Tensor `name` of the checkpoint at `path`, iterated as (row, chunk)
+    pairs: rows [row, row + len(chunk)) of the tensor, on `device`. Nothing
+    is read until iteration starts; a reader is iterated once."""
+
+    def __init__(self, path, name, chunk_bytes=0, device="cpu"):
+        dev = _device(device)
+        self._ptr = _C.call_out("xft_chunk_reader_create", _str(path), _str(name), chunk_bytes,
+                                dev.type, dev.index, out_type=_C.voidp)
+        code = _C.i32()
+        n = _C.i64()
+        buf = (_C.i64 * _MAX_NDIM)()
+        _C.call("xft_chunk_reader_info", self._ptr, ctypes.byref(code), ctypes.byref(n), buf,
+                _MAX_NDIM)
+        self.shape = tuple(buf[:n.value])
+        self.dtype = _dtype.from_code(code.value)
+
+    def __del__(self):
+        if getattr(self, "_ptr", None) and _C.lib is not None:
+            _C.lib.xft_chunk_reader_destroy(self._ptr)
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        h = _C.handle()
+        row = _C.i64()
+        _C.call("xft_chunk_reader_next", self._ptr, ctypes.byref(h), ctypes.byref(row))
+        if not h.value:
+            raise StopIteration
+        return row.value, Tensor(h)
+
+
+class ChunkWriter:
+    """Writes tensor `name` of `shape` and `dtype` as a new checkpoint at
+    `path`, a chunk of rows at a time, in order. The file replaces `path`
+    only on close(), once every row is written; as a context manager the
+    writer closes on success and discards the file on error."""
+
+    def __init__(self, path, name, shape, dtype=_dtype.float32):
+        s, n = _C.int64_array(shape)
+        self._ptr = _C.call_out("xft_chunk_writer_create", _str(path), _str(name), s, n,
+                                dtype.code, out_type=_C.voidp)
+
+    def __del__(self):
+        if getattr(self, "_ptr", None) and _C.lib is not None:
+            _C.lib.xft_chunk_writer_destroy(self._ptr)
+
+    def write(self, rows):
+        """Queues the next rows; CPU rows must not change until the next
+        write() or close()."""
+        _C.call("xft_chunk_writer_write", self._ptr, rows._h)
+
+    def close(self):
+        _C.call("xft_chunk_writer_close", self._ptr)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        if exc_type is None:
+            self.close()
+        else:
+            _C.lib.xft_chunk_writer_destroy(self._ptr)
+            self._ptr = None
+        return False
+
+
+def _reduction(name):
+    def op(path, name_, dim=None, keepdim=False, chunk_bytes=0):
+        args = (0, 1) if dim is None else (dim, 0)
+        return Tensor(_C.call_out("xft_stream_" + name, _str(path), _str(name_), *args,
+                                  int(keepdim), chunk_bytes))
+
+    op.__name__ = name
+    op.__doc__ = ("%s of tensor `name` of the checkpoint at `path`, over every element or "
+                  "along `dim`, streamed; the result is on the CPU." % name)
+    return op
+
+
+sum = _reduction("sum")
+mean = _reduction("mean")
+amax = _reduction("amax")
+
+
+def matvec(path, name, v, chunk_bytes=0):
+    """The stored [N, K] matrix times v ([K], or [K, M] for several vectors),
+    streamed to v's device."""
+    return Tensor(_C.call_out("xft_stream_matvec", _str(path), _str(name), v._h, chunk_bytes))
+
+
+def map(fn, path, name, out_path, out_name=None, chunk_bytes=0, device="cpu"):
+    """Writes fn(rows) for every chunk of tensor `name`, computed on
+    `device`, as tensor out_name (default `name`) of a new checkpoint at
+    out_path. fn must return one row per input row; the output's other dims
+    and dtype come from its first result. Returns the output's shape."""
+    reader = ChunkReader(path, name, chunk_bytes, device)
+    out_name = name if out_name is None else out_name
+    writer = None
+    try:
+        for _, chunk in reader:
+            rows = fn(chunk)
+            if writer is None:
+                shape = (reader.shape[0],) + tuple(rows.shape[1:])
+                writer = ChunkWriter(out_path, out_name, shape, rows.dtype)
+            writer.write(rows)
+        if writer is None:
+            # No rows: fn still decides the output's shape and dtype.
+            rows = fn(empty(*reader.shape, dtype=reader.dtype, device=device))
+            shape = (0,) + tuple(rows.shape[1:])
+            writer = ChunkWriter(out_path, out_name, shape, rows.dtype)
+        writer.close()
+        return shape
+    except BaseException:
+        if writer is not None:
+            _C.lib.xft_chunk_writer_destroy(writer._ptr)
+            writer._ptr = None
+        raise
@@ -0,0 +1,735 @@
+"""Python Tensor: a thin handle over an xft::Tensor in the C++ core."""
+
+import builtins
+import ctypes
+
+from . import _C
+from . import dtypes as _dtype
+from .device import device as _device
+
+class memory_format:
+    """A dense layout for the same logical sizes (core/tensor.h MemoryFormat)."""
+
+    def __init__(self, name, code):
+        self.name = name
+        self._code = code
+
+    def __repr__(self):
+        return "xft." + self.name
+
+
+# Row-major strides, and NHWC strides under NCHW sizes (4-D only).
+contiguous_format = memory_format("contiguous_format", 0)
+channels_last = memory_format("channels_last", 1)
+
+# Bound once; None if the library is gone at interpreter exit.
+_free = _C.lib.xft_tensor_free
+
+
+class Tensor:
+    def __init__(self, handle):
+        self._h = handle
+
+    def __del__(self):
+        if self._h and _free is not None:
+            _free(self._h)
+            self._h = None
+
+    # ---- metadata ----
+    @property
+    def ndim(self):
+        return _C.call_out("xft_tensor_ndim", self._h, out_type=_C.i64)
+
+    def dim(self):
+        return self.ndim
+
+    @property
+    def shape(self):
+        n = self.ndim
+        buf = (_C.i64 * max(n, 1))()
+        _C.call("xft_tensor_shape", self._h, buf)
+        return tuple(buf[:n])
+
+    def size(self, dim=None):
+        return self.shape if dim is None else self.shape[dim]
+
+    def stride(self, dim=None):
+        n = self.ndim
+        buf = (_C.i64 * max(n, 1))()
+        _C.call("xft_tensor_strides", self._h, buf)
+        strides = tuple(buf[:n])
+        return strides if dim is None else strides[dim]
+
+    def storage_offset(self):
+        return _C.call_out("xft_tensor_offset", self._h, out_type=_C.i64)
+
+    @property
+    def dtype(self):
+        return _dtype.from_code(_C.call_out("xft_tensor_dtype", self._h, out_type=_C.i32))
+
+    @property
+    def device(self):
+        t, i = _C.i32(), _C.i32()
+        _C.call("xft_tensor_device", self._h, ctypes.byref(t), ctypes.byref(i))
+        return _device("cpu" if t.value == 0 else "cuda:%d" % i.value)
+
+    @property
+    def is_cuda(self):
+        return self.device.is_cuda
+
+    def numel(self):
+        n = 1
+        for s in self.shape:
+            n *= s
+        return n
+
+    def data_ptr(self):
+        return _C.call_out("xft_tensor_data_ptr", self._h, out_type=_C.voidp) or 0
+
+    def storage_ptr(self):
+        return _C.call_out("xft_tensor_storage_ptr", self._h, out_type=_C.voidp) or 0
+
+    def is_contiguous(self, memory_format=contiguous_format):
+        return bool(
+            _C.call_out(
+                "xft_tensor_is_contiguous", self._h, memory_format._code, out_type=_C.i32
+            )
+        )
+
+    def __len__(self):
+        return self.shape[0]
+
+    # ---- views ----
+    def view(self, *shape):
+        arr, n = _C.int64_array(_flatten_shape(shape))
+        return Tensor(_C.call_out("xft_tensor_view", self._h, arr, n))
+
+    def reshape(self, *shape):
+        arr, n = _C.int64_array(_flatten_shape(shape))
+        return Tensor(_C.call_out("xft_tensor_reshape", self._h, arr, n))
+
+    def transpose(self, dim0, dim1):
+        return Tensor(_C.call_out("xft_tensor_transpose", self._h, dim0, dim1))
+
+    @property
+    def T(self):
+        return self.permute(*reversed(range(self.ndim)))
+
+    def permute(self, *dims):
+        arr, n = _C.int64_array(_flatten_shape(dims))
+        return Tensor(_C.call_out("xft_tensor_permute", self._h, arr, n))
+
+    def slice(self, dim, start=0, end=None, step=1):
+        end = self.shape[dim] if end is None else end
+        return Tensor(_C.call_out("xft_tensor_slice", self._h, dim, start, end, step))
+
+    def select(self, dim, index):
+        return Tensor(_C.call_out("xft_tensor_select", self._h, dim, index))
+
+    def expand(self, *shape):
+        arr, n = _C.int64_array(_flatten_shape(shape))
+        return Tensor(_C.call_out("xft_tensor_expand", self._h, arr, n))
+
+    def expand_as(self, other):
+        return self.expand(other.shape)
+
+    def squeeze(self, dim=None):
+        return Tensor(
+            _C.call_out("xft_tensor_squeeze", self._h, dim or 0, 1 if dim is None else 0)
+        )
+
+    def unsqueeze(self, dim):
+        return Tensor(_C.call_out("xft_tensor_unsqueeze", self._h, dim))
+
+    def flatten(self):
+        return self.reshape(-1)
+
+    def __getitem__(self, index):
+        if not isinstance(index, tuple):
+            index = (index,)
+        if any(i is Ellipsis for i in index):
+            at = index.index(Ellipsis)
+            used = builtins.sum(1 for i in index if i is not None and i is not Ellipsis)
+            index = index[:at] + (slice(None),) * (self.ndim - used) + index[at + 1 :]
+        out, dim = self, 0
+        for i in index:
+            if i is None:
+                out = out.unsqueeze(dim)
+                dim += 1
+            elif isinstance(i, int):
+                out = out.select(dim, i)
+            elif isinstance(i, slice):
+                start, stop, step = i.indices(out.shape[dim])
+                out = out.slice(dim, start, stop, step)
+                dim += 1
+            else:
+                raise TypeError("unsupported index %r" % (i,))
+        return out
+
+    def __setitem__(self, index, value):
+        dst = self[index]
+        if isinstance(value, Tensor):
+            dst.copy_(value)
+        else:
+            dst.fill_(value)
+
+    # ---- copies ----
+    def contiguous(self, memory_format=contiguous_format):
+        return Tensor(_C.call_out("xft_tensor_contiguous", self._h, memory_format._code))
+
+    def clone(self):
+        return Tensor(_C.call_out("xft_tensor_clone", self._h))
+
+    def to(self, target, non_blocking=False):
+        """Converts to a dtype or moves to a device.
+
+        With non_blocking=True the transfer is enqueued on the current CUDA
+        stream: host sources are staged through pinned memory, and results
+        copied to the CPU land in pinned memory and are valid only after the
+        stream is synchronized.
+        """
+        if isinstance(target, _dtype.dtype):
+            return Tensor(_C.call_out("xft_tensor_to_dtype", self._h, target.code))
+        dev = _device(target)
+        return Tensor(
+            _C.call_out(
+                "xft_tensor_to_device", self._h, dev.type, dev.index, int(non_blocking)
+            )
+        )
+
+    def cpu(self, non_blocking=False):
+        return self.to("cpu", non_blocking=non_blocking)
+
+    def cuda(self, index=0, non_blocking=False):
+        return self.to(_device("cuda", index), non_blocking=non_blocking)
+
+    def pin_memory(self):
+        """Returns a copy in page-locked host memory (self if already pinned)."""
+        return Tensor(_C.call_out("xft_tensor_pin_memory", self._h))
+
+    def record_stream(self, stream):
+        """Marks this tensor's memory as used by `stream`.
+
+        The caching allocator then holds the memory back from reuse, after the
+        tensor is freed, until work already enqueued on `stream` completes.
+        """
+        from .cuda.streams import record_stream
+
+        record_stream(self, stream)
+
+    def is_pinned(self):
+        return bool(_C.call_out("xft_tensor_is_pinned", self._h, out_type=_C.i32))
+
+    def float(self):
+        return self.to(_dtype.float32)
+
+    def double(self):
+        return self.to(_dtype.float64)
+
+    def long(self):
+        return self.to(_dtype.int64)
+
+    def half(self):
+        return self.to(_dtype.float16)
+
+    def bfloat16(self):
+        return self.to(_dtype.bfloat16)
+
+    def copy_(self, src, non_blocking=False):
+        _C.call("xft_tensor_copy_", self._h, src._h, int(non_blocking))
+        return self
+
+    def fill_(self, value):
+        _C.call("xft_tensor_fill_", self._h, float(value))
+        return self
+
+    def zero_(self):
+        return self.fill_(0)
+
+    # ---- lazy mode (csrc/lazy) ----
+    @property
+    def is_lazy(self):
+        """True while this is a pending lazy result (see xft.lazy)."""
+        return bool(_C.call_out("xft_tensor_is_lazy", self._h, out_type=_C.i32))
+
+    def materialize(self):
+        """Computes a pending lazy result now; a no-op otherwise."""
+        _C.call("xft_tensor_materialize", self._h)
+        return self
+
+    # ---- autograd (graph and backward pass live in csrc/autograd) ----
+    @property
+    def requires_grad(self):
+        return bool(_C.call_out("xft_tensor_requires_grad", self._h, out_type=_C.i32))
+
+    @requires_grad.setter
+    def requires_grad(self, flag):
+        _C.call("xft_tensor_set_requires_grad", self._h, int(bool(flag)))
+
+    def requires_grad_(self, flag=True):
+        self.requires_grad = flag
+        return self
+
+    @property
+    def is_leaf(self):
+        return bool(_C.call_out("xft_tensor_is_leaf", self._h, out_type=_C.i32))
+
+    @property
+    def grad(self):
+        h = _C.call_out("xft_tensor_grad", self._h)
+        return Tensor(h) if h else None
+
+    @grad.setter
+    def grad(self, value):
+        _C.call("xft_tensor_set_grad", self._h, None if value is None else value._h)
+
+    @property
+    def grad_fn(self):
+        """Name of the backward node that produced this tensor, or None."""
+        name = _C.call_out("xft_tensor_grad_fn_name", self._h, out_type=ctypes.c_char_p)
+        return name.decode() if name else None
+
+    def detach(self):
+        return Tensor(_C.call_out("xft_tensor_detach", self._h))
+
+    def is_inference(self):
+        """True for tensors allocated under xft.inference_mode(); they cannot
+        require grad or be saved for backward."""
+        return bool(_C.call_out("xft_tensor_is_inference", self._h, out_type=_C.i32))
+
+    def backward(self, gradient=None, retain_graph=False):
+        """Accumulates d(self)/d(leaf) into .grad of every leaf requiring grad.
+
+        The whole pass runs in C++; saved activations are freed as it goes
+        unless retain_graph is set.
+        """
+        _C.call(
+            "xft_backward",
+            self._h,
+            None if gradient is None else gradient._h,
+            int(bool(retain_graph)),
+        )
+
+    # ---- ops ----
+    def __add__(self, other):
+        return add(self, other)
+
+    def __radd__(self, other):
+        return add(other, self)
+
+    def __sub__(self, other):
+        return sub(self, other)
+
+    def __rsub__(self, other):
+        return sub(other, self)
+
+    def __mul__(self, other):
+        return mul(self, other)
+
+    def __rmul__(self, other):
+        return mul(other, self)
+
+    def __truediv__(self, other):
+        return div(self, other)
+
+    def __rtruediv__(self, other):
+        return div(other, self)
+
+    def __neg__(self):
+        return mul(self, -1)
+
+    def exp(self):
+        return exp(self)
+
+    def log(self):
+        return log(self)
+
+    def sqrt(self):
+        return sqrt(self)
+
+    def tanh(self):
+        return tanh(self)
+
+    def sigmoid(self):
+        return sigmoid(self)
+
+    def relu(self):
+        return relu(self)
+
+    def gelu(self):
+        return gelu(self)
+
+    # In place, through the ops' out= form: no new buffer is allocated.
+    def add_(self, other):
+        return add(self, other, out=self)
+
+    def sub_(self, other):
+        return sub(self, other, out=self)
+
+    def mul_(self, other):
+        return mul(self, other, out=self)
+
+    def div_(self, other):
+        return div(self, other, out=self)
+
+    def exp_(self):
+        return exp(self, out=self)
+
+    def log_(self):
+        return log(self, out=self)
+
+    def sqrt_(self):
+        return sqrt(self, out=self)
+
+    def tanh_(self):
+        return tanh(self, out=self)
+
+    def sigmoid_(self):
+        return sigmoid(self, out=self)
+
+    def relu_(self):
+        return relu(self, out=self)
+
+    def gelu_(self):
+        return gelu(self, out=self)
+
+    def sum(self, dim=None, keepdim=False):
+        return sum(self, dim, keepdim)
+
+    def mean(self, dim=None, keepdim=False):
+        return mean(self, dim, keepdim)
+
+    def amax(self, dim=None, keepdim=False):
+        return amax(self, dim, keepdim)
+
+    def max(self, dim=None, keepdim=False):
+        """Maximum values only (no indices), like amax."""
+        return amax(self, dim, keepdim)
+
+    def softmax(self, dim):
+        return softmax(self, dim)
+
+    def matmul(self, other):
+        return matmul(self, other)
+
+    def mm(self, other):
+        return mm(self, other)
+
+    def bmm(self, other):
+        return bmm(self, other)
+
+    def __matmul__(self, other):
+        return matmul(self, other)
+
+    # ---- host conversion ----
+    def _flat_values(self):
+        if _dtype.is_reduced(self.dtype):
+            return self.to(_dtype.float32)._flat_values()
+        n = self.numel()
+        buf = (self.dtype.ctype * max(n, 1))()
+        _C.call("xft_tensor_to_buffer", self._h, buf, n * self.dtype.itemsize)
+        return buf[:n]
+
+    def tolist(self):
+        flat = self._flat_values()
+        shape = self.shape
+        if not shape:
+            return flat[0]
+
+        def build(offset, dim):
+            if dim == len(shape) - 1:
+                return list(flat[offset : offset + shape[dim]]), offset + shape[dim]
+            out = []
+            for _ in range(shape[dim]):
+                row, offset = build(offset, dim + 1)
+                out.append(row)
+            return out, offset
+
+        return build(0, 0)[0]
+
+    def item(self):
+        if self.numel() != 1:
+            raise ValueError("item() needs a tensor with exactly one element")
+        return self._flat_values()[0]
+
+    def __repr__(self):
+        suffix = "" if self.dtype is _dtype.float32 else ", dtype=%s" % self.dtype.name
+        if self.is_cuda:
+            suffix += ", device='%s'" % self.device
+        if self.grad_fn is not None:
+            suffix += ", grad_fn=<%s>" % self.grad_fn
+        elif self.requires_grad:
+            suffix += ", requires_grad=True"
+        return "tensor(%s%s)" % (self.tolist(), suffix)
+
+
+def _flatten_shape(shape):
+    if len(shape) == 1 and isinstance(shape[0], (tuple, list)):
+        return tuple(shape[0])
+    return tuple(shape)
+
+
+def _infer(data):
+    shape = []
+    probe = data
+    while isinstance(probe, (list, tuple)):
+        shape.append(len(probe))
+        probe = probe[0] if probe else 0
+    flat = []
+
+    def walk(x, dim):
+        if dim == len(shape):
+            flat.append(x)
+            return
+        if not isinstance(x, (list, tuple)) or len(x) != shape[dim]:
+            raise ValueError("ragged nested sequence")
+        for v in x:
+            walk(v, dim + 1)
+
+    walk(data, 0)
+    return shape, flat
+
+
+def tensor(data, dtype=None, device=None, requires_grad=False):
+    shape, flat = _infer(data)
+    if dtype is None:
+        if all(isinstance(v, bool) for v in flat) and flat:
+            dtype = _dtype.bool_
+        elif all(isinstance(v, int) for v in flat) and flat:
+            dtype = _dtype.int64
+        else:
+            dtype = _dtype.float32
+    if _dtype.is_reduced(dtype):
+        t = tensor(data, dtype=_dtype.float32).to(dtype)
+        if device is not None:
+            t = t.to(device)
+        return t.requires_grad_() if requires_grad else t
+    buf = (dtype.ctype * max(len(flat), 1))(*flat)
+    arr, n = _C.int64_array(shape)
+    t = Tensor(_C.call_out("xft_tensor_from_buffer", buf, arr, n, dtype.code))
+    if device is not None:
+        t = t.to(device)
+    return t.requires_grad_() if requires_grad else t
+
+
+def empty(*shape, dtype=_dtype.float32, device="cpu", requires_grad=False):
+    dev = _device(device)
+    arr, n = _C.int64_array(_flatten_shape(shape))
+    t = Tensor(_C.call_out("xft_tensor_empty", arr, n, dtype.code, dev.type, dev.index))
+    return t.requires_grad_() if requires_grad else t
+
+
+def full(shape, value, dtype=_dtype.float32, device="cpu", requires_grad=False):
+    t = empty(shape, dtype=dtype, device=device).fill_(value)
+    return t.requires_grad_() if requires_grad else t
+
+
+def zeros(*shape, dtype=_dtype.float32, device="cpu", requires_grad=False):
+    return full(_flatten_shape(shape), 0, dtype=dtype, device=device, requires_grad=requires_grad)
+
+
+def ones(*shape, dtype=_dtype.float32, device="cpu", requires_grad=False):
+    return full(_flatten_shape(shape), 1, dtype=dtype, device=device, requires_grad=requires_grad)
+
+
+def arange(start, end=None, step=1, dtype=None, device="cpu"):
+    if end is None:
+        start, end = 0, start
+    if all(isinstance(v, int) for v in (start, end, step)):
+        values = list(range(start, end, step))
+    else:
+        n = max(0, int(-(-(end - start) // step)))
+        values = [start + i * step for i in range(n)]
+    return tensor(values, dtype=dtype, device=None if device == "cpu" else device)
+
+
+def _random(name, shape, dtype, device, requires_grad):
+    dev = _device(device)
+    arr, n = _C.int64_array(_flatten_shape(shape))
+    t = Tensor(_C.call_out(name, arr, n, dtype.code, dev.type, dev.index))
+    return t.requires_grad_() if requires_grad else t
+
+
+def rand(*shape, dtype=_dtype.float32, device="cpu", requires_grad=False):
+    """Uniform on [0, 1), from the device's default generator."""
+    return _random("xft_rand", shape, dtype, device, requires_grad)
+
+
+def randn(*shape, dtype=_dtype.float32, device="cpu", requires_grad=False):
+    """Standard normal, from the device's default generator."""
+    return _random("xft_randn", shape, dtype, device, requires_grad)
+
+
+_matmul = _C.bind_out("xft_matmul")
+_mm = _C.bind_out("xft_mm")
+_bmm = _C.bind_out("xft_bmm")
+
+
+def matmul(a, b):
+    """NumPy-style matrix product with batch broadcasting."""
+    return Tensor(_matmul(a._h, b._h))
+
+
+def mm(a, b):
+    return Tensor(_mm(a._h, b._h))
+
+
+def bmm(a, b):
+    return Tensor(_bmm(a._h, b._h))
+
+
+# The op wrappers below make one C call each. A Python scalar operand goes
+# to the op's _scalar variant rather than through a 0-d tensor built here.
+# With out=, the result is written into that tensor (which may be an input)
+# and it is returned; this is not recorded by autograd.
+def _binary(name):
+    fn = _C.bind_out("xft_" + name)
+    scalar_fn = _C.bind_out("xft_" + name + "_scalar")
+    out_fn = _C.bind("xft_" + name + "_out")
+    scalar_out_fn = _C.bind("xft_" + name + "_scalar_out")
+
+    def op(a, b, out=None):
+        if out is not None:
+            if not isinstance(a, Tensor):
+                scalar_out_fn(b._h, a, 1, out._h)
+            elif isinstance(b, Tensor):
+                out_fn(a._h, b._h, out._h)
+            else:
+                scalar_out_fn(a._h, b, 0, out._h)
+            return out
+        if isinstance(a, Tensor):
+            if isinstance(b, Tensor):
+                return Tensor(fn(a._h, b._h))
+            return Tensor(scalar_fn(a._h, b, 0))
+        return Tensor(scalar_fn(b._h, a, 1))
+
+    op.__name__ = name
+    op.__doc__ = "Elementwise %s with NumPy broadcasting." % name
+    return op
+
+
+def _unary(name):
+    fn = _C.bind_out("xft_" + name)
+    out_fn = _C.bind("xft_" + name + "_out")
+
+    def op(t, out=None):
+        if out is not None:
+            out_fn(t._h, out._h)
+            return out
+        return Tensor(fn(t._h))
+
+    op.__name__ = name
+    return op
+
+
+def _reduction(name):
+    fn = _C.bind_out("xft_" + name)
+
+    def op(t, dim=None, keepdim=False):
+        if dim is None:
+            return Tensor(fn(t._h, 0, 1, int(keepdim)))
+        return Tensor(fn(t._h, dim, 0, int(keepdim)))
+
+    op.__name__ = name
+    return op
+
+
+add = _binary("add")
+sub = _binary("sub")
+mul = _binary("mul")
+div = _binary("div")
+maximum = _binary("maximum")
+minimum = _binary("minimum")
+
+exp = _unary("exp")
+log = _unary("log")
+sqrt = _unary("sqrt")
+tanh = _unary("tanh")
+sigmoid = _unary("sigmoid")
+relu = _unary("relu")
+gelu = _unary("gelu")
+
+sum = _reduction("sum")
+mean = _reduction("mean")
+amax = _reduction("amax")
+
+
+def softmax(t, dim):
+    return Tensor(_C.call_out("xft_softmax", t._h, dim))
+
+
+def layer_norm(x, weight=None, bias=None, eps=1e-5):
+    """Normalizes over the last dim, then scales by weight and shifts by bias."""
+    w = None if weight is None else weight._h
+    b = None if bias is None else bias._h
+    return Tensor(_C.call_out("xft_layer_norm", x._h, w, b, float(eps)))
+
+
+def rms_norm(x, weight=None, eps=1e-6):
+    """x / sqrt(mean(x ** 2, -1) + eps) * weight."""
+    w = None if weight is None else weight._h
+    return Tensor(_C.call_out("xft_rms_norm", x._h, w, float(eps)))
+
+
+def bias_gelu(x, bias):
+    """gelu(x + bias) in one pass; bias has x's last dim."""
+    return Tensor(_C.call_out("xft_bias_gelu", x._h, bias._h))
+
+
+def bias_dropout_residual(x, bias, residual, p=0.1, training=True):
+    """residual + dropout(x + bias, p) in one pass; bias may be None. The mask is
+    regenerated in backward rather than saved."""
+    b = None if bias is None else bias._h
+    return Tensor(
+        _C.call_out(
+            "xft_bias_dropout_residual", x._h, b, residual._h, float(p), int(bool(training))
+        )
+    )
+
+
+def dropout(t, p=0.5, training=True):
+    """Zeroes each element with probability p and scales the rest by 1 / (1 - p)."""
+    return Tensor(_C.call_out("xft_dropout", t._h, float(p), int(bool(training))))
+
+
+def manual_seed(seed):
+    """Reseeds the default generator of every device."""
+    _C.call("xft_manual_seed", int(seed) & 0xFFFFFFFFFFFFFFFF)
+
+
+def get_rng_state(device="cpu"):
+    """The device generator's (seed, offset); set_rng_state() replays from it."""
+    dev = _device(device)
+    seed, offset = ctypes.c_uint64(), ctypes.c_uint64()
+    _C.call("xft_rng_get_state", dev.type, dev.index, ctypes.byref(seed), ctypes.byref(offset))
+    return seed.value, offset.value
+
+
+def set_rng_state(state, device="cpu"):
+    dev = _device(device)
+    seed, offset = state
+    _C.call("xft_rng_set_state", dev.type, dev.index, int(seed), int(offset))
+
+
+def set_num_threads(n):
+    """Sets how many threads CPU ops use (the calling thread included)."""
+    _C.call("xft_set_num_threads", int(n))
+
+
+def get_num_threads():
+    return _C.call_out("xft_get_num_threads", out_type=_C.i32)
+
+
+def parallel_chunks(begin, end, grain):
+    """The [lo, hi) chunks CPU ops would split the range [begin, end) into
+    with the given grain, as a sorted list of pairs."""
+    capacity = max(get_num_threads(), 1)
+    bounds = (_C.i64 * (2 * capacity))()
+    n = _C.call_out("xft_parallel_chunks", int(begin), int(end), int(grain), bounds, capacity,
+                    out_type=_C.i64)
+    return [(bounds[2 * i], bounds[2 * i + 1]) for i in range(n)]
+
+
+def cpu_capability():
+    """The SIMD kernel set picked for this CPU: "default", "avx2" or "avx512"."""
+    return _C.call_out("xft_cpu_capability", out_type=ctypes.c_char_p).decode()